@@ -0,0 +1,405 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "embedded/fonts.h"
+#include "embedded/icons.h"
+#include "visage_graphics/canvas.h"
+#include "visage_graphics/post_effects.h"
+#include "visage_ui/frame.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace visage;
+
+namespace {
+  constexpr int kWidth = 1280;
+  constexpr int kHeight = 800;
+  constexpr int kFarmCanvases = 64;
+  constexpr int kFarmCanvasSize = 256;
+
+  struct BenchmarkResult {
+    std::string name;
+    int frames = 0;
+    double frames_per_second = 0.0;
+    double cpu_microseconds_per_frame = 0.0;
+    double record_microseconds_per_frame = 0.0;
+    double canvases_per_second = 0.0;
+  };
+
+  struct Scene {
+    std::string name;
+    std::function<void(Canvas&)> draw;
+  };
+
+  class FrameScene {
+  public:
+    FrameScene(Canvas& canvas, std::unique_ptr<Frame> root) :
+        canvas_(canvas), root_(std::move(root)) {
+      handler_.request_redraw = [this](Frame* frame) { stale_.push_back(frame); };
+      root_->setEventHandler(&handler_);
+      root_->setBounds(0, 0, kWidth, kHeight);
+      canvas_.addRegion(root_->region());
+    }
+
+    ~FrameScene() {
+      root_->setEventHandler(nullptr);
+      root_->region()->parent()->removeRegion(root_->region());
+    }
+
+    void draw() {
+      root_->redrawAll();
+      for (Frame* frame : stale_)
+        frame->drawToRegion(canvas_);
+      stale_.clear();
+    }
+
+  private:
+    Canvas& canvas_;
+    std::unique_ptr<Frame> root_;
+    FrameEventHandler handler_;
+    std::vector<Frame*> stale_;
+  };
+
+  long long microsecondsSince(std::chrono::steady_clock::time_point start) {
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+  }
+
+  void drawRectangles(Canvas& canvas) {
+    for (int i = 0; i < 10000; ++i) {
+      canvas.setColor(0xff000000 | (i * 2654435761u >> 8));
+      canvas.rectangle((i * 37) % kWidth, (i * 53) % kHeight, 12, 8);
+    }
+  }
+
+  void drawPaths(Canvas& canvas) {
+    for (int i = 0; i < 1000; ++i) {
+      Path path;
+      float x = (i * 41) % (kWidth - 40);
+      float y = (i * 67) % (kHeight - 40);
+      path.moveTo(x, y);
+      path.lineTo(x + 30.0f, y + 5.0f);
+      path.lineTo(x + 20.0f + (i % 7), y + 35.0f);
+      path.lineTo(x + 2.0f, y + 20.0f + (i % 11));
+      path.close();
+      canvas.setColor(0xff4488ff + (i % 64));
+      canvas.fill(path);
+    }
+  }
+
+  void drawText(Canvas& canvas) {
+    Font font(12, fonts::Lato_Regular_ttf);
+    canvas.setColor(0xffdddddd);
+    for (int y = 0; y < kHeight; y += 14) {
+      for (int x = 0; x < kWidth; x += 160)
+        canvas.text("Dense text " + std::to_string(x + y), font, Font::kLeft, x, y, 160, 14);
+    }
+  }
+
+  void drawIcons(Canvas& canvas) {
+    const EmbeddedFile* icon_files[] = { &icons::check_circle_svg, &icons::menu_svg,
+                                         &icons::x_circle_svg };
+    canvas.setColor(0xffaaccff);
+    int index = 0;
+    for (int y = 0; y < kHeight; y += 32) {
+      for (int x = 0; x < kWidth; x += 32)
+        canvas.svg(*icon_files[index++ % 3], x, y, 24, 24);
+    }
+  }
+
+  Path envelopePath(int frame) {
+    static constexpr int kEnvelopePoints = 4000;
+    Path path;
+    path.moveTo(0.0f, kHeight * 0.5f);
+    for (int i = 1; i < kEnvelopePoints; ++i) {
+      float t = i / static_cast<float>(kEnvelopePoints);
+      float phase = t * 40.0f + frame * 0.05f;
+      path.lineTo(t * kWidth, kHeight * (0.5f + 0.4f * std::sin(phase) * std::cos(phase * 0.13f)));
+    }
+    return path;
+  }
+
+  void drawEnvelopeStroke(Canvas& canvas) {
+    canvas.setColor(0xff66ddaa);
+    canvas.stroke(envelopePath(canvas.frameCount()), 0, 0, kWidth, kHeight, 3.0f);
+  }
+
+  void drawEnvelopePathStroke(Canvas& canvas) {
+    canvas.setColor(0xff66ddaa);
+    canvas.fill(envelopePath(canvas.frameCount()).stroke(3.0f));
+  }
+
+  void drawEnvelopePolyline(Canvas& canvas) {
+    static constexpr int kEnvelopePoints = 4000;
+    static std::vector<Point> points(kEnvelopePoints);
+    int frame = canvas.frameCount();
+    for (int i = 0; i < kEnvelopePoints; ++i) {
+      float t = i / static_cast<float>(kEnvelopePoints);
+      float phase = t * 40.0f + frame * 0.05f;
+      points[i] = { t * kWidth, kHeight * (0.5f + 0.4f * std::sin(phase) * std::cos(phase * 0.13f)) };
+    }
+    canvas.setColor(0xff66ddaa);
+    canvas.polyline(points, 3.0f);
+  }
+
+  std::unique_ptr<Frame> createEffectFrame(PostEffect* post_effect) {
+    auto root = std::make_unique<Frame>();
+    auto content = std::make_unique<Frame>();
+    content->onDraw() = [](Canvas& canvas) {
+      for (int i = 0; i < 400; ++i) {
+        canvas.setColor(0xff000000 | (i * 2246822519u >> 8));
+        canvas.circle((i * 37) % kWidth, (i * 53) % kHeight, 24);
+      }
+    };
+    content->setPostEffect(post_effect);
+    root->addChild(std::move(content));
+    root->onResize() = [frame = root.get()] {
+      for (Frame* child : frame->children())
+        child->setBounds(frame->localBounds());
+    };
+    return root;
+  }
+
+  void addChildren(Frame* parent, int depth) {
+    if (depth == 0)
+      return;
+
+    for (int i = 0; i < 3; ++i) {
+      auto child = std::make_unique<Frame>();
+      Frame* child_frame = child.get();
+      child->onDraw() = [child_frame](Canvas& canvas) {
+        canvas.setColor(0x22ffffff);
+        canvas.roundedRectangle(0, 0, child_frame->width(), child_frame->height(), 4);
+      };
+      parent->addChild(std::move(child));
+      addChildren(child_frame, depth - 1);
+    }
+
+    parent->onResize() = [parent] {
+      int num_children = parent->children().size();
+      float width = parent->width() / std::max(1, num_children);
+      for (int i = 0; i < num_children; ++i)
+        parent->children()[i]->setBounds(i * width + 2, 2, width - 4, parent->height() - 4);
+    };
+  }
+
+  BenchmarkResult run(Canvas& canvas, const std::string& name, int frames,
+                      const std::function<void()>& record) {
+    BenchmarkResult result;
+    result.name = name;
+    result.frames = frames;
+
+    record();
+    canvas.takeScreenshot();
+
+    long long record_time = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; ++i) {
+      auto record_start = std::chrono::steady_clock::now();
+      canvas.clearDrawnShapes();
+      record();
+      record_time += microsecondsSince(record_start);
+      canvas.takeScreenshot();
+    }
+
+    long long total_time = std::max(1LL, microsecondsSince(start));
+    result.frames_per_second = frames * 1000000.0 / total_time;
+    result.cpu_microseconds_per_frame = total_time / static_cast<double>(frames);
+    result.record_microseconds_per_frame = record_time / static_cast<double>(frames);
+    return result;
+  }
+
+  void drawThumbnail(Canvas& canvas, int index) {
+    canvas.setColor(0xff000000 | (index * 2654435761u >> 8));
+    canvas.fill(0, 0, kFarmCanvasSize, kFarmCanvasSize);
+    for (int i = 0; i < 200; ++i) {
+      canvas.setColor(0xff000000 | ((index + i) * 2246822519u >> 8));
+      canvas.roundedRectangle((i * 37) % kFarmCanvasSize, (i * 53) % kFarmCanvasSize, 20, 14, 3);
+    }
+  }
+
+  BenchmarkResult runFarm(const std::string& name, int frames, bool batched) {
+    std::shared_ptr<CanvasResources> resources = std::make_shared<CanvasResources>();
+    std::vector<std::unique_ptr<Canvas>> canvases;
+    std::vector<Canvas*> farm;
+    for (int i = 0; i < kFarmCanvases; ++i) {
+      canvases.push_back(std::make_unique<Canvas>(resources));
+      canvases.back()->setWindowless(kFarmCanvasSize, kFarmCanvasSize);
+      farm.push_back(canvases.back().get());
+    }
+
+    auto render = [&](bool timed, long long& record_time) {
+      auto record_start = std::chrono::steady_clock::now();
+      for (int i = 0; i < kFarmCanvases; ++i) {
+        farm[i]->clearDrawnShapes();
+        drawThumbnail(*farm[i], i);
+      }
+      if (timed)
+        record_time += microsecondsSince(record_start);
+
+      if (batched)
+        Canvas::submitWindowless(farm);
+      else {
+        for (Canvas* canvas : farm)
+          canvas->submit();
+      }
+    };
+
+    long long record_time = 0;
+    render(false, record_time);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; ++i)
+      render(true, record_time);
+
+    long long total_time = std::max(1LL, microsecondsSince(start));
+    BenchmarkResult result;
+    result.name = name;
+    result.frames = frames;
+    result.frames_per_second = frames * 1000000.0 / total_time;
+    result.cpu_microseconds_per_frame = total_time / static_cast<double>(frames);
+    result.record_microseconds_per_frame = record_time / static_cast<double>(frames);
+    result.canvases_per_second = result.frames_per_second * kFarmCanvases;
+    return result;
+  }
+
+  std::string toJson(const std::vector<BenchmarkResult>& results) {
+    std::string json = "{\n  \"width\": " + std::to_string(kWidth) +
+                       ",\n  \"height\": " + std::to_string(kHeight) + ",\n  \"benchmarks\": [\n";
+    for (int i = 0; i < results.size(); ++i) {
+      const BenchmarkResult& result = results[i];
+      char buffer[512];
+      std::snprintf(buffer, sizeof(buffer),
+                    "    { \"name\": \"%s\", \"frames\": %d, \"fps\": %.3f, "
+                    "\"cpu_us_per_frame\": %.3f, \"record_us_per_frame\": %.3f, "
+                    "\"canvases_per_second\": %.3f }%s\n",
+                    result.name.c_str(), result.frames, result.frames_per_second,
+                    result.cpu_microseconds_per_frame, result.record_microseconds_per_frame,
+                    result.canvases_per_second, i + 1 < results.size() ? "," : "");
+      json += buffer;
+    }
+    return json + "  ]\n}\n";
+  }
+}
+
+int main(int argc, char** argv) {
+  int frames = 100;
+  const char* json_path = nullptr;
+  std::string filter;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+      frames = std::max(1, std::atoi(argv[++i]));
+    else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+      json_path = argv[++i];
+    else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+      filter = argv[++i];
+  }
+
+  std::vector<Scene> scenes = {
+    { "rectangles_10k", drawRectangles },
+    { "paths_1k", drawPaths },
+    { "dense_text", drawText },
+    { "svg_icon_grid", drawIcons },
+    { "envelope_stroke_4k", drawEnvelopeStroke },
+    { "envelope_path_stroke_4k", drawEnvelopePathStroke },
+    { "envelope_polyline_4k", drawEnvelopePolyline },
+  };
+
+  std::vector<BenchmarkResult> results;
+  for (const Scene& scene : scenes) {
+    if (!filter.empty() && scene.name.find(filter) == std::string::npos)
+      continue;
+
+    Canvas canvas;
+    canvas.setWindowless(kWidth, kHeight);
+    results.push_back(run(canvas, scene.name, frames, [&] { scene.draw(canvas); }));
+  }
+
+  auto run_frame_scene = [&](const std::string& name,
+                             const std::function<std::unique_ptr<Frame>()>& create) {
+    if (!filter.empty() && name.find(filter) == std::string::npos)
+      return;
+
+    Canvas canvas;
+    canvas.setWindowless(kWidth, kHeight);
+    FrameScene scene(canvas, create());
+    results.push_back(run(canvas, name, frames, [&] { scene.draw(); }));
+  };
+
+  BlurPostEffect blur;
+  blur.setBlurRadius(20.0f);
+  BlurPostEffect large_blur;
+  large_blur.setBlurRadius(120.0f);
+  BlurPostEffect large_kawase_blur;
+  large_kawase_blur.setBlurRadius(120.0f);
+  large_kawase_blur.setMode(BlurPostEffect::Mode::DualKawase);
+  BloomPostEffect bloom;
+  run_frame_scene("blur_post_effect", [&] { return createEffectFrame(&blur); });
+  run_frame_scene("large_blur_post_effect", [&] { return createEffectFrame(&large_blur); });
+  run_frame_scene("large_kawase_blur_post_effect",
+                  [&] { return createEffectFrame(&large_kawase_blur); });
+  run_frame_scene("bloom_post_effect", [&] { return createEffectFrame(&bloom); });
+  run_frame_scene("deep_frame_hierarchy", [] {
+    auto root = std::make_unique<Frame>();
+    addChildren(root.get(), 6);
+    return root;
+  });
+
+  std::string farm_suffix = "_" + std::to_string(kFarmCanvases);
+  for (const auto& [name, batched] : { std::pair { "windowless_sequential", false },
+                                       std::pair { "windowless_farm", true } }) {
+    std::string farm_name = name + farm_suffix;
+    if (filter.empty() || farm_name.find(filter) != std::string::npos)
+      results.push_back(runFarm(farm_name, frames, batched));
+  }
+
+  for (const BenchmarkResult& result : results) {
+    std::printf("%-24s %10.2f fps %12.2f us/frame %12.2f us record\n", result.name.c_str(),
+                result.frames_per_second, result.cpu_microseconds_per_frame,
+                result.record_microseconds_per_frame);
+    if (result.canvases_per_second > 0.0)
+      std::printf("%-24s %10.2f canvases/s\n", "", result.canvases_per_second);
+  }
+
+  std::string json = toJson(results);
+  if (json_path) {
+    FILE* file = std::fopen(json_path, "w");
+    if (file == nullptr) {
+      std::fprintf(stderr, "Could not write %s\n", json_path);
+      return 1;
+    }
+    std::fputs(json.c_str(), file);
+    std::fclose(file);
+  }
+  else
+    std::fputs(json.c_str(), stdout);
+
+  return 0;
+}
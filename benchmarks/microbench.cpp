@@ -0,0 +1,266 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "embedded/fonts.h"
+#include "visage_graphics/font.h"
+#include "visage_graphics/gradient.h"
+#include "visage_graphics/graphics_utils.h"
+#include "visage_graphics/palette.h"
+#include "visage_graphics/path.h"
+#include "visage_ui/layout.h"
+#include "visage_utils/space.h"
+#include "visage_utils/string_utils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace visage;
+
+namespace {
+  VISAGE_THEME_COLOR(MicrobenchColor, 0xff336699);
+  VISAGE_THEME_PALETTE_OVERRIDE(MicrobenchOverride);
+
+  // Results feed into this so the compiler can't drop the work being measured.
+  volatile double sink = 0.0;
+
+  struct Microbenchmark {
+    std::string name;
+    int iterations = 0;
+    std::function<void()> setup;
+    std::function<void(int)> run;
+  };
+
+  struct MicrobenchmarkResult {
+    std::string name;
+    int iterations = 0;
+    double total_microseconds = 0.0;
+    double nanoseconds_per_iteration = 0.0;
+  };
+
+  Path wavePath(int num_points) {
+    Path path;
+    path.moveTo(0.0f, 200.0f);
+    for (int i = 1; i < num_points; ++i) {
+      float t = i / static_cast<float>(num_points);
+      path.lineTo(t * 1000.0f, 200.0f + 150.0f * std::sin(t * 60.0f));
+    }
+    return path;
+  }
+
+  std::string svgPathData() {
+    std::string data;
+    for (int i = 0; i < 100; ++i) {
+      data += "M" + std::to_string(i) + " 10 l5.5-3.25 c1 2 3 4 5 6 s2-1 3 0 q1 1 2 0 ";
+      data += "a4 4 0 0 1 8 0 h10 v-5 H" + std::to_string(i * 2) + " z ";
+    }
+    return data;
+  }
+
+  std::string mixedText() {
+    std::string text;
+    for (int i = 0; i < 64; ++i)
+      text += "Visage renders text, \xc3\xa9t\xc3\xa9 \xe6\x97\xa5\xe6\x9c\xac \xf0\x9f\x8e\xb5 ";
+    return text;
+  }
+
+  std::vector<Microbenchmark> microbenchmarks() {
+    std::vector<Microbenchmark> result;
+
+    auto svg_data = std::make_shared<std::string>(svgPathData());
+    result.push_back({ "path_parse_svg", 2000, nullptr, [svg_data](int) {
+                        sink = sink + Path::parseSvgPath(*svg_data).size();
+                      } });
+
+    auto wave = std::make_shared<Path>(wavePath(1000));
+    result.push_back({ "path_offset_1k", 200, nullptr,
+                       [wave](int) { sink = sink + wave->offset(2.0f).numPoints(); } });
+    result.push_back({ "path_stroke_1k", 200, nullptr,
+                       [wave](int) { sink = sink + wave->stroke(3.0f).numPoints(); } });
+
+    auto layout = std::make_shared<Layout>();
+    auto children = std::make_shared<std::vector<Layout>>(100);
+    auto child_pointers = std::make_shared<std::vector<const Layout*>>();
+    result.push_back({ "layout_flex_positions_100", 5000,
+                       [=] {
+                         layout->setFlex(true);
+                         layout->setFlexWrap(true);
+                         layout->setFlexGap(4);
+                         for (Layout& child : *children) {
+                           child.setWidth(40);
+                           child.setHeight(20);
+                           child.setFlexGrow(1.0f);
+                           child_pointers->push_back(&child);
+                         }
+                       },
+                       [=](int i) {
+                         // Alternating widths keep the layout's cached positions from being used.
+                         IBounds bounds(0, 0, 800 + (i & 1), 600);
+                         sink = sink + layout->flexPositions(*child_pointers, bounds, 1.0f).size();
+                       } });
+
+    auto pieces = std::make_shared<std::vector<IBounds>>();
+    result.push_back({ "ibounds_break_into_non_overlapping", 200000, nullptr, [pieces](int i) {
+                        IBounds rect1(i % 64, i % 48, 120, 80);
+                        IBounds rect2((i * 7) % 96, (i * 5) % 64, 90, 110);
+                        pieces->clear();
+                        IBounds::breakIntoNonOverlapping(rect1, rect2, *pieces);
+                        sink = sink + pieces->size() + rect1.width() + rect2.width();
+                      } });
+
+    result.push_back({ "iregion_add_grid_64", 20000, nullptr, [](int i) {
+                        IRegion region;
+                        for (int y = 0; y < 8; ++y) {
+                          for (int x = 0; x < 8; ++x)
+                            region.add({ x * 24 + (i & 3), y * 24, 10, 10 });
+                        }
+                        region.subtract({ 30, 30, 100, 100 });
+                        sink = sink + region.numRects();
+                      } });
+
+    auto utf8_text = std::make_shared<std::string>(mixedText());
+    auto utf32_text = std::make_shared<std::u32string>(String::convertToUtf32(*utf8_text));
+    result.push_back({ "string_convert_to_utf32", 20000, nullptr, [utf8_text](int) {
+                        sink = sink + String::convertToUtf32(*utf8_text).size();
+                      } });
+    result.push_back({ "string_convert_to_utf8", 20000, nullptr, [utf32_text](int) {
+                        sink = sink + String::convertToUtf8(*utf32_text).size();
+                      } });
+
+    auto gradient = std::make_shared<Gradient>(0xff000000, 0xffff0000, 0xff00ff00, 0xff0000ff,
+                                               0xffffffff);
+    result.push_back({ "gradient_sample", 1000000, nullptr, [gradient](int i) {
+                        sink = sink + gradient->sample((i % 1024) / 1023.0f).red();
+                      } });
+
+    auto palette = std::make_shared<Palette>();
+    result.push_back({ "palette_color", 1000000,
+                       [palette] {
+                         palette->setColor(MicrobenchColor, Color(0xff445566));
+                         palette->setColor(MicrobenchOverride, MicrobenchColor, Color(0xff112233));
+                         palette->compile();
+                       },
+                       [palette](int i) {
+                         Brush brush;
+                         theme::OverrideId override_id;
+                         if (i & 1)
+                           override_id = MicrobenchOverride;
+                         palette->color(override_id, MicrobenchColor, brush);
+                         sink = sink + brush.gradient().colors().size();
+                       } });
+
+    auto rects = std::make_shared<std::vector<PackedRect>>();
+    result.push_back({ "atlas_packer_pack_500", 200,
+                       [rects] {
+                         for (int i = 0; i < 500; ++i)
+                           rects->push_back({ 0, 0, 4 + (i * 37) % 60, 4 + (i * 53) % 40 });
+                       },
+                       [rects](int) {
+                         AtlasPacker packer;
+                         sink = sink + packer.pack(*rects, 1024, 1024);
+                       } });
+
+    auto font = std::make_shared<Font>();
+    auto line_text = std::make_shared<std::u32string>();
+    result.push_back({ "font_native_line_breaks", 2000,
+                       [font, line_text, utf32_text] {
+                         *font = Font(14, fonts::Lato_Regular_ttf, 1.0f);
+                         *line_text = *utf32_text;
+                       },
+                       [font, line_text](int) {
+                         // At a dpi scale of 1 this measures nativeLineBreaks directly.
+                         std::vector<int> breaks = font->lineBreaks(line_text->c_str(),
+                                                                    line_text->size(), 300.0f);
+                         sink = sink + breaks.size();
+                       } });
+    return result;
+  }
+
+  MicrobenchmarkResult run(const Microbenchmark& benchmark) {
+    if (benchmark.setup)
+      benchmark.setup();
+
+    int warm_up = std::max(1, benchmark.iterations / 10);
+    for (int i = 0; i < warm_up; ++i)
+      benchmark.run(i);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < benchmark.iterations; ++i)
+      benchmark.run(i);
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+
+    MicrobenchmarkResult result;
+    result.name = benchmark.name;
+    result.iterations = benchmark.iterations;
+    result.total_microseconds = elapsed.count();
+    result.nanoseconds_per_iteration = elapsed.count() * 1000.0 / benchmark.iterations;
+    return result;
+  }
+
+  std::string toCsv(const std::vector<MicrobenchmarkResult>& results) {
+    std::string csv = "name,iterations,total_us,ns_per_iteration\n";
+    for (const MicrobenchmarkResult& result : results) {
+      char buffer[256];
+      std::snprintf(buffer, sizeof(buffer), "%s,%d,%.3f,%.3f\n", result.name.c_str(),
+                    result.iterations, result.total_microseconds, result.nanoseconds_per_iteration);
+      csv += buffer;
+    }
+    return csv;
+  }
+}
+
+int main(int argc, char** argv) {
+  const char* csv_path = nullptr;
+  std::string filter;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--csv") == 0 && i + 1 < argc)
+      csv_path = argv[++i];
+    else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+      filter = argv[++i];
+  }
+
+  std::vector<MicrobenchmarkResult> results;
+  for (const Microbenchmark& benchmark : microbenchmarks()) {
+    if (filter.empty() || benchmark.name.find(filter) != std::string::npos)
+      results.push_back(run(benchmark));
+  }
+
+  std::string csv = toCsv(results);
+  if (csv_path) {
+    FILE* file = std::fopen(csv_path, "w");
+    if (file == nullptr) {
+      std::fprintf(stderr, "Could not write %s\n", csv_path);
+      return 1;
+    }
+    std::fputs(csv.c_str(), file);
+    std::fclose(file);
+  }
+  else
+    std::fputs(csv.c_str(), stdout);
+
+  return 0;
+}
@@ -6,12 +6,23 @@ endif()
 
 if (EMSCRIPTEN)
   add_compile_options(-DVISAGE_EMSCRIPTEN=1)
+  if (VISAGE_EMSCRIPTEN_OFFSCREEN_CANVAS)
+    add_compile_options(-pthread)
+    add_link_options(-pthread -sOFFSCREENCANVAS_SUPPORT=1 "-sOFFSCREENCANVASES_TO_PTHREAD=#canvas"
+                     -sPTHREAD_POOL_SIZE=2)
+  endif ()
+  if (VISAGE_EMSCRIPTEN_FETCH_ASSETS)
+    add_link_options(-sFETCH=1)
+  endif ()
 elseif (WIN32)
   add_compile_options(${VISAGE_DEFINE_FLAG}VISAGE_WINDOWS=1)
 elseif (APPLE)
   add_compile_options(-DVISAGE_MAC=1)
 elseif (UNIX)
   add_compile_options(-DVISAGE_LINUX=1)
+  if (VISAGE_LINUX_WAYLAND)
+    add_compile_options(-DVISAGE_WAYLAND=1)
+  endif ()
 endif()
 
 if (MSVC)
@@ -20,4 +31,8 @@ else()
   add_compile_options(-Wno-conversion -Wno-sign-conversion)
 endif()
 
+if (VISAGE_ENABLE_TRACING)
+  add_compile_definitions(VISAGE_TRACING=1)
+endif ()
+
 add_compile_definitions(VISAGE_APPLICATION_NAME=\"${VISAGE_APPLICATION_NAME}\")
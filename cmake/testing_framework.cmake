@@ -1,4 +1,4 @@
-if (VISAGE_BUILD_TESTS AND NOT EMSCRIPTEN)
+if ((VISAGE_BUILD_TESTS OR VISAGE_BUILD_PERF_TESTS) AND NOT EMSCRIPTEN)
   message(STATUS "VISAGE: Downloading testing dependencies")
 
   include(FetchContent)
@@ -16,16 +16,39 @@ if (VISAGE_BUILD_TESTS AND NOT EMSCRIPTEN)
   set_target_properties(Catch2WithMain PROPERTIES FOLDER "visage/third_party/Catch2")
 endif ()
 
+# NOOP_RENDERER runs the target's tests on bgfx's Noop renderer. Frames still go through
+# Canvas::submit and record their statistics, but nothing is drawn so screenshots stay empty.
 function(visage_add_test_target)
+  set(options NOOP_RENDERER)
   set(single_options TARGET TEST_DIRECTORY)
-  cmake_parse_arguments(PARSE "" "${single_options}" "${multi_options}" ${ARGN})
+  cmake_parse_arguments(PARSE "${options}" "${single_options}" "${multi_options}" ${ARGN})
 
   if (VISAGE_BUILD_TESTS AND NOT EMSCRIPTEN)
     file(GLOB_RECURSE HEADERS ${PARSE_TEST_DIRECTORY}/*.h)
     file(GLOB_RECURSE SOURCE_FILES ${PARSE_TEST_DIRECTORY}/*.cpp)
+    if (PARSE_NOOP_RENDERER)
+      list(APPEND SOURCE_FILES ${CMAKE_CURRENT_FUNCTION_LIST_DIR}/noop_renderer_listener.cpp)
+    endif ()
     add_executable(${PARSE_TARGET} ${HEADERS} ${SOURCE_FILES})
     target_link_libraries(${PARSE_TARGET} PRIVATE Catch2::Catch2WithMain visage)
     catch_discover_tests(${PARSE_TARGET})
     set_target_properties(${PARSE_TARGET} PROPERTIES FOLDER "visage/tests")
   endif ()
 endfunction()
+
+# Performance tests fail when a hot path goes over its time or allocation budget. They link an
+# allocation counting operator new, so they get their own target and run serially under the
+# "perf" label. Timings are only meaningful in optimized builds.
+function(visage_add_perf_test_target)
+  set(single_options TARGET TEST_DIRECTORY)
+  cmake_parse_arguments(PARSE "" "${single_options}" "" ${ARGN})
+
+  if (VISAGE_BUILD_PERF_TESTS AND NOT EMSCRIPTEN)
+    file(GLOB_RECURSE HEADERS ${PARSE_TEST_DIRECTORY}/*.h)
+    file(GLOB_RECURSE SOURCE_FILES ${PARSE_TEST_DIRECTORY}/*.cpp)
+    add_executable(${PARSE_TARGET} ${HEADERS} ${SOURCE_FILES})
+    target_link_libraries(${PARSE_TARGET} PRIVATE Catch2::Catch2WithMain visage VisageGraphicsEmbeds)
+    catch_discover_tests(${PARSE_TARGET} PROPERTIES LABELS perf RUN_SERIAL TRUE)
+    set_target_properties(${PARSE_TARGET} PROPERTIES FOLDER "visage/tests")
+  endif ()
+endfunction()
@@ -35,7 +35,14 @@ clap_plugin_descriptor ClapPlugin::descriptor = { CLAP_VERSION,          "dev.vi
                                                   "visage.dev",          "0.0.1",
                                                   "Example Clap Plugin", kClapFeatures };
 
-ClapPlugin::ClapPlugin(const clap_host* host) : ClapPluginBase(&descriptor, host) { }
+// Hosts open and close plugin editors constantly, so packed images, paths and glyphs are shared
+// between instances and kept for a while after the last editor closes.
+static constexpr int kEditorResourceRetainMs = 30000;
+
+ClapPlugin::ClapPlugin(const clap_host* host) : ClapPluginBase(&descriptor, host) {
+  visage::ApplicationEditor::setShareCanvasResources(true);
+  visage::ApplicationEditor::setResourceRetainPeriod(kEditorResourceRetainMs);
+}
 
 ClapPlugin::~ClapPlugin() = default;
 
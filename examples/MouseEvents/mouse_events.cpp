@@ -62,7 +62,7 @@ public:
     visage::PopupMenu menu;
     menu.addOption(1, "Option 1");
     menu.addOption(2, "Option 2");
-    menu.show(this, { x_, y_ });
+    std::move(menu).show(this, { x_, y_ });
   }
   void mouseUp(const visage::MouseEvent& e) override {
     if (e.isMiddleButton()) {
@@ -244,6 +244,8 @@ ExamplesFrame::ExamplesFrame() {
                  image_container_.height());
     canvas.setBlendMode(visage::BlendMode::Mult);
     canvas.squircle(offset, 0, image_container_.height());
+    if (canvas.imagesLoading())
+      image_container_.redraw();
   };
 
   sections_.push_back(std::make_unique<ExampleSection>("Images", &image_container_));
@@ -329,14 +331,14 @@ void ExamplesFrame::setupButtons() {
     sub_menu.addOption(4, "Sub Item 2");
     sub_menu.addOption(5, "Sub Item 3");
     sub_menu.addOption(6, "Sub Item 4");
-    menu.addSubMenu(sub_menu);
+    menu.addSubMenu(std::move(sub_menu));
     visage::PopupMenu sub_menu2("Other Sub Menu");
     sub_menu2.addOption(7, "Other Sub Item 1");
     sub_menu2.addBreak();
     sub_menu2.addOption(8, "Other Sub Item 2");
     sub_menu2.addOption(9, "Other Sub Item 3");
     sub_menu2.addOption(10, "Other Sub Item 4");
-    menu.addSubMenu(sub_menu2);
+    menu.addSubMenu(std::move(sub_menu2));
     menu.addBreak();
     menu.addOption(12, "Force Crash");
     menu.addOption(13, "Close Application");
@@ -354,7 +356,7 @@ void ExamplesFrame::setupButtons() {
         visage::closeApplication();
     };
 
-    menu.show(action_button_.get());
+    std::move(menu).show(action_button_.get());
   };
   action_button_->setToggleOnMouseDown(true);
 
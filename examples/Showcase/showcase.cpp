@@ -105,6 +105,12 @@ Showcase::Showcase() : palette_color_window_(&palette_), palette_value_window_(&
 
   palette_.initWithDefaults();
   setPalette(&palette_);
+  palette_color_window_.editor().onEdit() = [this](bool colors_only) {
+    if (colors_only)
+      replayAll();
+    else
+      redrawAll();
+  };
 
   examples_ = std::make_unique<ExamplesFrame>();
   examples_->onShowOverlay() = [this] { overlay_.setVisible(true); };
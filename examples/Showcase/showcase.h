@@ -61,6 +61,8 @@ public:
     editor_.layout().setMargin(0);
   }
 
+  visage::PaletteColorEditor& editor() { return editor_; }
+
 private:
   visage::PaletteColorEditor editor_;
 };
@@ -0,0 +1,92 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "perf_budget.h"
+#include "visage_graphics/canvas.h"
+#include "visage_ui/frame.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace visage;
+
+namespace {
+  constexpr int kWidth = 800;
+  constexpr int kHeight = 600;
+  constexpr int kShapes = 2000;
+
+  class RedrawScene {
+  public:
+    explicit RedrawScene(Canvas& canvas) : canvas_(canvas) {
+      handler_.request_redraw = [](Frame*) { };
+      frame_.setEventHandler(&handler_);
+      frame_.setBounds(0, 0, kWidth, kHeight);
+      frame_.onDraw() = [](Canvas& canvas) {
+        for (int i = 0; i < kShapes; ++i) {
+          canvas.setColor(0xff000000 | (i * 2654435761u >> 8));
+          canvas.rectangle((i * 37) % kWidth, (i * 53) % kHeight, 12, 8);
+        }
+      };
+      canvas_.addRegion(frame_.region());
+    }
+
+    ~RedrawScene() {
+      frame_.setEventHandler(nullptr);
+      frame_.region()->parent()->removeRegion(frame_.region());
+    }
+
+    void redraw() {
+      frame_.redraw();
+      frame_.drawToRegion(canvas_);
+    }
+
+    int drawCount() const { return frame_.drawCount(); }
+
+  private:
+    Canvas& canvas_;
+    Frame frame_;
+    FrameEventHandler handler_;
+  };
+}
+
+TEST_CASE("Frame redraw with many shapes stays in budget", "[perf]") {
+  Canvas canvas;
+  canvas.setWindowless(kWidth, kHeight);
+  RedrawScene scene(canvas);
+
+  double microseconds = perf::medianMicroseconds(25, [&] { scene.redraw(); });
+  REQUIRE(scene.drawCount() > 25);
+  REQUIRE(microseconds < perf::budgetMicroseconds(1500.0));
+}
+
+TEST_CASE("Steady state frame redraw doesn't allocate", "[perf]") {
+  Canvas canvas;
+  canvas.setWindowless(kWidth, kHeight);
+  RedrawScene scene(canvas);
+
+  for (int i = 0; i < 3; ++i) {
+    scene.redraw();
+    canvas.submit();
+  }
+
+  perf::AllocationCounter counter;
+  scene.redraw();
+  REQUIRE(counter.allocations() == 0);
+}
@@ -0,0 +1,60 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "embedded/icons.h"
+#include "perf_budget.h"
+#include "visage_graphics/path.h"
+#include "visage_graphics/svg.h"
+
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+
+using namespace visage;
+
+TEST_CASE("Stroking a 10k point path stays in budget", "[perf]") {
+  static constexpr int kPoints = 10000;
+  Path path;
+  path.moveTo(0.0f, 300.0f);
+  for (int i = 1; i < kPoints; ++i) {
+    float t = i / static_cast<float>(kPoints);
+    path.lineTo(t * 1000.0f, 300.0f + 200.0f * std::sin(t * 80.0f));
+  }
+
+  int num_points = 0;
+  double microseconds = perf::medianMicroseconds(9, [&] {
+    num_points = path.stroke(3.0f).numPoints();
+  });
+  REQUIRE(num_points > kPoints);
+  REQUIRE(microseconds < perf::budgetMicroseconds(20000.0));
+}
+
+TEST_CASE("Parsing the bundled icons stays in budget", "[perf]") {
+  const EmbeddedFile* icon_files[] = { &icons::check_circle_svg, &icons::menu_svg,
+                                       &icons::x_circle_svg };
+
+  bool loaded = true;
+  double microseconds = perf::medianMicroseconds(25, [&] {
+    for (const EmbeddedFile* file : icon_files)
+      loaded = Svg(*file).drawable() != nullptr && loaded;
+  });
+  REQUIRE(loaded);
+  REQUIRE(microseconds < perf::budgetMicroseconds(2000.0));
+}
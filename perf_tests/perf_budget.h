@@ -0,0 +1,48 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <functional>
+
+namespace visage::perf {
+  // Heap allocations made through operator new on the calling thread so far.
+  long long threadAllocations();
+
+  // Counts the calling thread's allocations from construction.
+  class AllocationCounter {
+  public:
+    AllocationCounter() : start_(threadAllocations()) { }
+
+    long long allocations() const { return threadAllocations() - start_; }
+
+  private:
+    long long start_ = 0;
+  };
+
+  // Time budgets are written for optimized builds and scaled ten times for unoptimized ones.
+  // VISAGE_PERF_BUDGET_SCALE replaces the scale, so slower machines can loosen every budget.
+  double budgetScale();
+  inline double budgetMicroseconds(double microseconds) { return microseconds * budgetScale(); }
+
+  // Runs the function a few times to warm caches, then returns the median of the timed runs.
+  double medianMicroseconds(int runs, const std::function<void()>& function);
+}
@@ -0,0 +1,46 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "visage_graphics/svg.h"
+#include "visage_utils/file_system.h"
+
+#include <cstdio>
+
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    std::fprintf(stderr, "Usage: %s <input.svg> <output>\n", argv[0]);
+    return 1;
+  }
+
+  size_t size = 0;
+  auto data = visage::loadFileData(argv[1], size);
+  if (data == nullptr) {
+    std::fprintf(stderr, "Could not read %s\n", argv[1]);
+    return 1;
+  }
+
+  std::vector<unsigned char> compiled = visage::SvgParser::compile(data.get(), size);
+  if (!visage::replaceFileWithData(argv[2], compiled.data(), compiled.size())) {
+    std::fprintf(stderr, "Could not write %s\n", argv[2]);
+    return 1;
+  }
+  return 0;
+}
@@ -24,13 +24,17 @@
 #include "client_window_decoration.h"
 #include "visage_graphics/canvas.h"
 #include "visage_graphics/renderer.h"
+#include "visage_ui/animation_scheduler.h"
+#include "visage_ui/layer_cache.h"
 #include "visage_utils/time_utils.h"
+#include "visage_utils/trace.h"
 #include "visage_windowing/windowing.h"
 #include "window_event_handler.h"
 
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
+#include <limits>
 
 namespace {
   bool visageDebugEnabled() {
@@ -80,25 +84,34 @@ namespace visage {
 #endif
   }
 
+  bool ApplicationEditor::share_canvas_resources_ = false;
+
+  void ApplicationEditor::setResourceRetainPeriod(int ms) {
+    CanvasResources::setRetainPeriod(ms);
+    FontCache::setRetainPeriod(ms);
+  }
+
+  void ApplicationEditor::releaseRetainedResources() {
+    CanvasResources::releaseRetained();
+    FontCache::releaseRetainedFonts();
+  }
+
   ApplicationEditor::ApplicationEditor() :
-      canvas_(std::make_unique<Canvas>()), top_level_(std::make_unique<TopLevelFrame>(this)) {
+      canvas_(std::make_unique<Canvas>(share_canvas_resources_ ?
+                                           CanvasResources::shared() :
+                                           std::make_shared<CanvasResources>())),
+      top_level_(std::make_unique<TopLevelFrame>(this)) {
     canvas_->addRegion(top_level_->region());
     top_level_->addChild(this);
 
     event_handler_.request_redraw = [this](Frame* frame) {
-      if (visageDebugEnabled() && frame && frame->name() == "PhysicsGraph") {
-        static uint64_t last_redraw_log_us = 0;
-        const uint64_t now = time::microseconds();
-        if (now - last_redraw_log_us >= 1000000) {
-          last_redraw_log_us = now;
-          visageDebugLog("redraw",
-                         "frame=%s stale=%zu",
-                         frame->name().c_str(),
-                         stale_children_.size());
-        }
-      }
-      if (std::find(stale_children_.begin(), stale_children_.end(), frame) == stale_children_.end())
+      if (frame->redrawQueueIndex() < 0) {
+        VISAGE_TRACE_INSTANT("requestRedraw", frame->name().c_str());
+        if (stale_children_.empty() && window_ && window_->isVisible() && skip_idle_frames_)
+          window_->wakeDrawCallbacks();
+        frame->setRedrawQueueIndex(stale_children_.size());
         stale_children_.push_back(frame);
+      }
     };
     event_handler_.request_keyboard_focus = [this](Frame* frame) {
       if (window_event_handler_)
@@ -110,9 +123,28 @@ namespace visage {
 
       if (window_event_handler_)
         window_event_handler_->giveUpFocus(frame);
-      auto pos = std::find(stale_children_.begin(), stale_children_.end(), frame);
-      if (pos != stale_children_.end())
-        stale_children_.erase(pos);
+      if (frame->layoutDirty()) {
+        std::replace(layout_queue_.begin(), layout_queue_.end(), frame, static_cast<Frame*>(nullptr));
+        for (auto& resolving : resolving_layouts_) {
+          if (resolving.second == frame)
+            resolving.second = nullptr;
+        }
+      }
+
+      if (!deferred_children_.empty()) {
+        std::replace(deferred_children_.begin(), deferred_children_.end(), frame,
+                     static_cast<Frame*>(nullptr));
+      }
+      if (!idle_init_queue_.empty()) {
+        std::replace(idle_init_queue_.begin(), idle_init_queue_.end(), frame,
+                     static_cast<Frame*>(nullptr));
+      }
+
+      int index = frame->redrawQueueIndex();
+      if (index >= 0 && index < stale_children_.size() && stale_children_[index] == frame) {
+        stale_children_[index] = nullptr;
+        frame->setRedrawQueueIndex(-1);
+      }
     };
     event_handler_.set_mouse_relative_mode = [this](bool relative) {
       if (window_)
@@ -168,8 +200,10 @@ namespace visage {
     window_->setDrawCallback([this](double time) {
       canvas_->updateTime(time);
       EventManager::instance().checkEventTimers();
+      AnimationScheduler::instance().advance(static_cast<long long>(time * 1000.0));
       drawWindow();
     });
+    window_->setDrawDeadlineCallback([this] { return msUntilDrawNeeded(); });
 
     drawWindow();
     drawWindow();
@@ -192,51 +226,73 @@ namespace visage {
 
   void ApplicationEditor::drawWindow() {
     if (window_ && !window_->isVisible()) {
-      if (visageDebugEnabled()) {
-        static uint64_t last_hidden_log_us = 0;
-        const uint64_t now = time::microseconds();
-        if (now - last_hidden_log_us >= 1000000) {
-          last_hidden_log_us = now;
-          visageDebugLog("drawWindow", "skipped (window hidden)");
-        }
-      }
+      VISAGE_TRACE_INSTANT("drawWindow skipped", "window hidden");
       return;
     }
 
-    if (width() == 0 || height() == 0) {
-      if (visageDebugEnabled()) {
-        static uint64_t last_size_log_us = 0;
-        const uint64_t now = time::microseconds();
-        if (now - last_size_log_us >= 1000000) {
-          last_size_log_us = now;
-          visageDebugLog("drawWindow", "skipped (size=0x0)");
-        }
-      }
-      return;
+    if (resize_pending_) {
+      resize_pending_ = false;
+      top_level_->setNativeBounds(pending_window_bounds_);
+      top_level_->redraw();
     }
 
-    if (visageDebugEnabled()) {
-      static uint64_t last_log_us = 0;
-      const uint64_t now = time::microseconds();
-      if (now - last_log_us >= 1000000) {
-        last_log_us = now;
-        visageDebugLog("drawWindow",
-                       "visible=%d size=%.1fx%.1f initialized=%d stale=%zu",
-                       window_ ? (window_->isVisible() ? 1 : 0) : 0,
-                       width(),
-                       height(),
-                       initialized() ? 1 : 0,
-                       stale_children_.size());
-      }
+    if (width() == 0 || height() == 0) {
+      VISAGE_TRACE_INSTANT("drawWindow skipped", "empty size");
+      return;
     }
 
+    VISAGE_TRACE_SCOPE("ApplicationEditor::drawWindow");
     if (!initialized())
       init();
 
-    if (!stale_children_.empty()) {
-      drawStaleChildren();
+    resolveLayouts();
+    if (!stale_children_.empty() && !onlyThrottledChildrenStale()) {
+      bool dpi_changing = progressive_dpi_changes_ && submitted_dpi_scale_ &&
+                          submitted_dpi_scale_ != dpiScale();
+      bool resizing = live_resize_mode_ &&
+                      time::milliseconds() - last_resize_ms_ < kLiveResizeSettleMs;
+      bool progressive = window_ && (dpi_changing || resizing) && held_frames_ < kMaxHeldFrames;
+      canvas_->profiler().beginFrame();
+      {
+        FrameProfiler::ScopedSample sample(&canvas_->profiler(), "drawStaleChildren");
+        if (progressive) {
+          long long deadline = time::microseconds() + kProgressiveDrawBudgetMs * 1000;
+          if (!drawStaleChildren(deadline)) {
+            held_frames_++;
+            return;
+          }
+        }
+        else
+          drawStaleChildren();
+      }
+      if (layer_cache_policy_)
+        layer_cache_policy_->frameDrawn(this, &canvas_->profiler());
       canvas_->submit();
+      submitted_dpi_scale_ = dpiScale();
+      held_frames_ = 0;
+      defragment_pending_ = idle_atlas_defragmentation_;
+    }
+    else if (!idle_init_queue_.empty()) {
+      Frame* frame = idle_init_queue_.front();
+      idle_init_queue_.pop_front();
+      if (frame)
+        frame->initialize();
     }
+    else if (defragment_pending_)
+      defragment_pending_ = canvas_->defragmentAtlases(kIdleDefragmentMoves);
+  }
+
+  void ApplicationEditor::setLiveResizeMode(bool live_resize) {
+    live_resize_mode_ = live_resize;
+    canvas_->setFrameBufferBucket(live_resize ? kLiveResizeFrameBufferBucket : 0);
+  }
+
+  void ApplicationEditor::deferWindowResize(int width, int height) {
+    pending_window_bounds_ = { 0, 0, width, height };
+    resize_pending_ = true;
+    last_resize_ms_ = time::milliseconds();
+    if (window_)
+      window_->wakeDrawCallbacks();
   }
 
   void ApplicationEditor::setFixedAspectRatio(bool fixed) {
@@ -245,23 +301,204 @@ namespace visage {
       window_->setFixedAspectRatio(fixed);
   }
 
+  void ApplicationEditor::setDeferredLayout(bool deferred) {
+    if (deferred == deferredLayout())
+      return;
+
+    if (deferred)
+      event_handler_.request_layout = [this](Frame* frame) { layout_queue_.push_back(frame); };
+    else {
+      resolveLayouts();
+      event_handler_.request_layout = nullptr;
+    }
+  }
+
+  void ApplicationEditor::setAutoLayerCaching(bool enabled) {
+    if (enabled == autoLayerCaching())
+      return;
+
+    if (enabled)
+      layer_cache_policy_ = std::make_unique<LayerCachePolicy>();
+    else {
+      layer_cache_policy_ = nullptr;
+      LayerCachePolicy::clear(this);
+    }
+  }
+
+  long long ApplicationEditor::msUntilDrawNeeded() {
+    bool occluded = window_ && !window_->isVisible();
+    bool busy = !skip_idle_frames_ || stale_children_.size() > num_throttled_children_ ||
+                !layout_queue_.empty() || resize_pending_ || defragment_pending_ ||
+                !idle_init_queue_.empty() ||
+                !AnimationScheduler::instance().idle();
+    if (busy && !occluded)
+      return 0;
+
+    long long deadline = EventManager::instance().nextDeadline();
+    if (num_throttled_children_ && !occluded) {
+      long long slot = next_redraw_slot_ / 1000 + 1;
+      deadline = deadline < 0 ? slot : std::min(deadline, slot);
+    }
+    if (deadline < 0)
+      return -1;
+    return std::max(0LL, deadline - time::milliseconds());
+  }
+
+  void ApplicationEditor::resolveLayouts() {
+    while (!layout_queue_.empty()) {
+      resolving_layouts_.clear();
+      for (Frame* frame : layout_queue_) {
+        if (frame == nullptr)
+          continue;
+
+        int depth = 0;
+        for (const Frame* parent = frame->parent(); parent; parent = parent->parent())
+          ++depth;
+        resolving_layouts_.emplace_back(depth, frame);
+      }
+      layout_queue_.clear();
+
+      std::stable_sort(resolving_layouts_.begin(), resolving_layouts_.end(),
+                       [](const auto& a, const auto& b) { return a.first < b.first; });
+      for (int i = 0; i < resolving_layouts_.size(); ++i) {
+        if (Frame* frame = resolving_layouts_[i].second)
+          frame->resolveLayout();
+      }
+    }
+    resolving_layouts_.clear();
+  }
+
+  // Frames off screen or held by a snapshot stay stale until a later pass can draw them.
+  static bool drawingDeferred(const Frame* frame) {
+    return !frame->isOnScreen() || frame->isFrozenBySnapshot();
+  }
+
   void ApplicationEditor::drawStaleChildren() {
+    drawStaleChildren(std::numeric_limits<long long>::max());
+  }
+
+  bool ApplicationEditor::drawStaleChildren(long long deadline) {
+    VISAGE_TRACE_SCOPE("ApplicationEditor::drawStaleChildren");
+    uint64_t generation = ++draw_generation_;
+    requeueDeferredChildren();
     drawing_children_.clear();
     std::swap(stale_children_, drawing_children_);
     for (Frame* child : drawing_children_) {
-      if (child->isDrawing())
-        child->drawToRegion(*canvas_);
+      if (child) {
+        child->setRedrawQueueIndex(-1);
+        child->setRedrawGeneration(generation);
+      }
     }
-    for (auto it = stale_children_.begin(); it != stale_children_.end();) {
-      Frame* child = *it;
-      if (std::find(drawing_children_.begin(), drawing_children_.end(), child) == drawing_children_.end()) {
-        child->drawToRegion(*canvas_);
-        it = stale_children_.erase(it);
+
+    bool drew_child = false;
+    long long now = time::microseconds();
+    for (int i = 0; i < drawing_children_.size(); ++i) {
+      Frame* child = drawing_children_[i];
+      if (child == nullptr || !child->isDrawing())
+        continue;
+
+      if (drawingDeferred(child)) {
+        deferred_children_.push_back(child);
+        continue;
       }
-      else
-        ++it;
+
+      if (redrawSlot(child) > now) {
+        child->setRedrawQueueIndex(stale_children_.size());
+        stale_children_.push_back(child);
+        continue;
+      }
+
+      // Frames past the deadline are still waiting on a redraw, so they go back on the queue
+      // marked as drawn this pass and stay there for the next call.
+      if (drew_child && time::microseconds() >= deadline) {
+        for (; i < drawing_children_.size(); ++i) {
+          if (drawing_children_[i]) {
+            drawing_children_[i]->setRedrawQueueIndex(stale_children_.size());
+            stale_children_.push_back(drawing_children_[i]);
+          }
+        }
+        break;
+      }
+      child->setLastRedrawTime(now);
+      child->drawToRegion(*canvas_);
+      drew_child = true;
     }
+
+    // Frames that requested a redraw while drawing are drawn now unless they were just drawn or
+    // are over their redraw rate, those stay queued for the next frame.
+    int num_stale = 0;
+    num_throttled_children_ = 0;
+    next_redraw_slot_ = 0;
+    for (int i = 0; i < stale_children_.size(); ++i) {
+      Frame* child = stale_children_[i];
+      if (child == nullptr)
+        continue;
+
+      long long slot = redrawSlot(child);
+      if (child->redrawGeneration() == generation || slot > now) {
+        child->setRedrawGeneration(generation);
+        child->setRedrawQueueIndex(num_stale);
+        stale_children_[num_stale++] = child;
+        if (slot > now) {
+          num_throttled_children_++;
+          if (next_redraw_slot_ == 0 || slot < next_redraw_slot_)
+            next_redraw_slot_ = slot;
+        }
+      }
+      else {
+        child->setRedrawQueueIndex(-1);
+        child->setRedrawGeneration(generation);
+        stale_children_[i] = nullptr;
+        if (drawingDeferred(child))
+          deferred_children_.push_back(child);
+        else {
+          child->setLastRedrawTime(now);
+          child->drawToRegion(*canvas_);
+        }
+      }
+    }
+    stale_children_.resize(num_stale);
     drawing_children_.clear();
+    return stale_children_.size() == num_throttled_children_;
+  }
+
+  bool ApplicationEditor::onlyThrottledChildrenStale() const {
+    if (stale_children_.size() != num_throttled_children_)
+      return false;
+
+    long long now = time::microseconds();
+    for (const Frame* child : stale_children_) {
+      if (child && redrawSlot(child) <= now)
+        return false;
+    }
+    return true;
+  }
+
+  long long ApplicationEditor::redrawSlot(const Frame* frame) const {
+    float rate = frame->maxRedrawRate();
+    if (power_saving_ && power_saving_redraw_rate_ > 0.0f &&
+        (rate <= 0.0f || rate > power_saving_redraw_rate_))
+      rate = power_saving_redraw_rate_;
+
+    if (rate <= 0.0f || frame->lastRedrawTime() == 0)
+      return 0;
+    return frame->lastRedrawTime() + static_cast<long long>(1000000.0 / rate);
+  }
+
+  void ApplicationEditor::requeueDeferredChildren() {
+    int num_deferred = 0;
+    for (Frame* child : deferred_children_) {
+      if (child == nullptr || child->redrawQueueIndex() >= 0)
+        continue;
+
+      if (!drawingDeferred(child)) {
+        child->setRedrawQueueIndex(stale_children_.size());
+        stale_children_.push_back(child);
+      }
+      else
+        deferred_children_[num_deferred++] = child;
+    }
+    deferred_children_.resize(num_deferred);
   }
 
   void ApplicationEditor::adjustWindowDimensions(int* width, int* height, bool horizontal_resize,
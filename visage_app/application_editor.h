@@ -23,9 +23,12 @@
 
 #include "visage_ui/frame.h"
 
+#include <deque>
+
 namespace visage {
   class ApplicationEditor;
   class Canvas;
+  class LayerCachePolicy;
   class Window;
   class WindowEventHandler;
   class ClientWindowDecoration;
@@ -47,6 +50,22 @@ namespace visage {
   class ApplicationEditor : public Frame {
   public:
     static constexpr int kDefaultClientTitleBarHeight = 30;
+    static constexpr int kProgressiveDrawBudgetMs = 8;
+    static constexpr int kMaxHeldFrames = 6;
+    static constexpr int kLiveResizeSettleMs = 100;
+    static constexpr int kLiveResizeFrameBufferBucket = 256;
+    static constexpr float kDefaultPowerSavingRedrawRate = 30.0f;
+    static constexpr int kIdleDefragmentMoves = 16;
+
+    // Editors created while this is on draw into canvases built from CanvasResources::shared(),
+    // so windows and plugin instances keep one copy of their images, gradients and paths.
+    static void setShareCanvasResources(bool share) { share_canvas_resources_ = share; }
+    static bool shareCanvasResources() { return share_canvas_resources_; }
+    // Keeps shared canvas resources and unused fonts alive this many milliseconds after the last
+    // editor using them closes, so reopening one skips repacking images, gradients, paths and
+    // glyphs. The renderer and compiled shader programs already live for the whole process.
+    static void setResourceRetainPeriod(int ms);
+    static void releaseRetainedResources();
 
     ApplicationEditor();
     ~ApplicationEditor() override;
@@ -71,6 +90,58 @@ namespace visage {
     Window* window() const { return window_; }
 
     void drawStaleChildren();
+    // Draws stale frames until _deadline_, in time::microseconds(), and leaves the rest queued for
+    // the next call. At least one frame is drawn so the queue always drains. Returns true when
+    // nothing is left stale. Frames outside the visible area or held by a snapshot aren't drawn,
+    // they stay stale until a later call can draw them. Frames over their redraw rate stay queued for their next
+    // slot without counting as stale.
+    bool drawStaleChildren(long long deadline);
+
+    // After a DPI change every frame redraws at the new scale, recreating fonts and paths. With
+    // this on, that work is spread over several draw ticks within a time budget, and the window
+    // keeps showing its last frame until the new one is complete or too many ticks have passed.
+    void setProgressiveDpiChanges(bool progressive) { progressive_dpi_changes_ = progressive; }
+    bool progressiveDpiChanges() const { return progressive_dpi_changes_; }
+
+    // Keeps interactive window resizing smooth on heavy UIs. Resize events only record the new
+    // size, which is laid out once per drawn frame, and that frame is drawn progressively like a
+    // DPI change while the window system stretches or pads the last presented one. Intermediate
+    // frame buffers are allocated in size buckets so they aren't recreated on every event.
+    void setLiveResizeMode(bool live_resize);
+    bool liveResizeMode() const { return live_resize_mode_; }
+    void deferWindowResize(int width, int height);
+
+    // Caps every frame's redraw rate at _hz_ for battery use, on top of Frame::setMaxRedrawRate.
+    void setPowerSavingMode(bool power_saving, float hz = kDefaultPowerSavingRedrawRate) {
+      power_saving_ = power_saving;
+      power_saving_redraw_rate_ = hz;
+    }
+    bool powerSavingMode() const { return power_saving_; }
+
+    // Uses draw ticks with nothing stale to compact the image atlases a few images at a time,
+    // so a page with holes takes new images without a full repack.
+    void setIdleAtlasDefragmentation(bool enabled) { idle_atlas_defragmentation_ = enabled; }
+    bool idleAtlasDefragmentation() const { return idle_atlas_defragmentation_; }
+
+    // Queues a lazily initialized frame to be initialized on a draw tick with nothing stale,
+    // one frame per tick, so hidden pages are warm before they're first shown.
+    void initWhenIdle(Frame* frame) { idle_init_queue_.push_back(frame); }
+
+    // Defers child layout out of setBounds so every changed frame is laid out once, top-down,
+    // right before the next draw. resolveLayouts() runs that pass early.
+    void setDeferredLayout(bool deferred);
+    bool deferredLayout() const { return event_handler_.request_layout != nullptr; }
+    void resolveLayouts();
+
+    // Lets a LayerCachePolicy promote expensive, rarely changing frames into cached layers.
+    void setAutoLayerCaching(bool enabled);
+    bool autoLayerCaching() const { return layer_cache_policy_ != nullptr; }
+    LayerCachePolicy* layerCachePolicy() const { return layer_cache_policy_.get(); }
+
+    // Lets the window skip draw ticks while nothing is stale, animating or waiting on a timer.
+    void setSkipIdleFrames(bool skip) { skip_idle_frames_ = skip; }
+    bool skipIdleFrames() const { return skip_idle_frames_; }
+    long long msUntilDrawNeeded();
 
     void setMinimumDimensions(float width, float height) {
       min_width_ = std::max(0.0f, width);
@@ -102,6 +173,12 @@ namespace visage {
     }
 
   private:
+    void requeueDeferredChildren();
+    long long redrawSlot(const Frame* frame) const;
+    bool onlyThrottledChildrenStale() const;
+
+    static bool share_canvas_resources_;
+
     Window* window_ = nullptr;
     FrameEventHandler event_handler_;
     std::unique_ptr<Canvas> canvas_;
@@ -113,6 +190,26 @@ namespace visage {
     float min_height_ = 0.0f;
     std::vector<Frame*> stale_children_;
     std::vector<Frame*> drawing_children_;
+    std::vector<Frame*> deferred_children_;
+    int num_throttled_children_ = 0;
+    long long next_redraw_slot_ = 0;
+    uint64_t draw_generation_ = 0;
+    std::vector<Frame*> layout_queue_;
+    std::vector<std::pair<int, Frame*>> resolving_layouts_;
+    std::unique_ptr<LayerCachePolicy> layer_cache_policy_;
+    bool skip_idle_frames_ = false;
+    bool progressive_dpi_changes_ = true;
+    float submitted_dpi_scale_ = 0.0f;
+    int held_frames_ = 0;
+    bool live_resize_mode_ = false;
+    bool power_saving_ = false;
+    float power_saving_redraw_rate_ = kDefaultPowerSavingRedrawRate;
+    bool idle_atlas_defragmentation_ = true;
+    bool defragment_pending_ = false;
+    std::deque<Frame*> idle_init_queue_;
+    bool resize_pending_ = false;
+    IBounds pending_window_bounds_;
+    long long last_resize_ms_ = 0;
 
     VISAGE_LEAK_CHECKER(ApplicationEditor)
   };
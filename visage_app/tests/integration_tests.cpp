@@ -53,6 +53,43 @@ TEST_CASE("Screenshot solid color", "[integration]") {
   }
 }
 
+TEST_CASE("Debug draw outlines layer bounds", "[integration]") {
+  Canvas canvas;
+  canvas.setWindowless(10, 5);
+  canvas.setDebugDraw(DebugDraw::LayerBounds);
+  canvas.setColor(0xffff0000);
+  canvas.fill(0, 0, canvas.width(), canvas.height());
+  canvas.submit();
+
+  canvas.takeScreenshot();
+  const uint8_t* data = canvas.screenshot().data();
+  auto pixel = [&](int x, int y) {
+    int index = (y * 10 + x) * 4;
+    return (data[index] << 16) | (data[index + 1] << 8) | data[index + 2];
+  };
+  REQUIRE(pixel(0, 0) == 0x00ffff);
+  REQUIRE(pixel(9, 4) == 0x00ffff);
+  REQUIRE(pixel(5, 2) == 0xff0000);
+}
+
+TEST_CASE("Debug draw adds up overdraw", "[integration]") {
+  Canvas canvas;
+  canvas.setWindowless(10, 5);
+  canvas.setDebugDraw(DebugDraw::Overdraw);
+  canvas.setColor(0xff0000ff);
+  canvas.fill(0, 0, canvas.width(), canvas.height());
+  canvas.fill(0, 0, canvas.width() / 2, canvas.height());
+  canvas.submit();
+
+  canvas.takeScreenshot();
+  const uint8_t* data = canvas.screenshot().data();
+  int twice = (2 * 10 + 2) * 4;
+  int once = (2 * 10 + 7) * 4;
+  REQUIRE(data[once] > 0);
+  REQUIRE(data[twice] > data[once]);
+  REQUIRE(data[twice + 2] < data[twice]);
+}
+
 TEST_CASE("Screenshot vertical gradient", "[integration]") {
   Color source = 0xff345678;
   Color destination = 0xff88aacc;
@@ -189,4 +226,413 @@ TEST_CASE("Testing grandchild overlapping order", "[integration]") {
   REQUIRE(data[index + 1] == 0xff);
   REQUIRE(data[index + 2] == 0x00);
   REQUIRE(data[index + 3] == 0xff);
-}
\ No newline at end of file
+}
+
+TEST_CASE("Redraw queue dedupes and drops removed frames", "[integration]") {
+  ApplicationEditor editor;
+  editor.setWindowless(100, 100);
+
+  std::vector<std::unique_ptr<Frame>> frames;
+  std::vector<int> draw_counts(64, 0);
+  for (int i = 0; i < draw_counts.size(); ++i) {
+    frames.push_back(std::make_unique<Frame>());
+    frames.back()->setBounds(i % 8 * 10, i / 8 * 10, 10, 10);
+    frames.back()->onDraw() = [&draw_counts, i](Canvas& canvas) { draw_counts[i]++; };
+    editor.addChild(frames.back().get());
+  }
+  editor.drawWindow();
+  std::fill(draw_counts.begin(), draw_counts.end(), 0);
+
+  for (int repeat = 0; repeat < 3; ++repeat) {
+    for (auto& frame : frames)
+      frame->redraw();
+  }
+  editor.removeChild(frames[1].get());
+  editor.drawWindow();
+
+  REQUIRE(draw_counts[0] == 1);
+  REQUIRE(draw_counts[1] == 0);
+  REQUIRE(draw_counts[63] == 1);
+
+  int redraws = 0;
+  frames[2]->onDraw() = [&](Canvas& canvas) {
+    redraws++;
+    frames[2]->redraw();
+  };
+  frames[2]->redraw();
+  editor.drawWindow();
+  REQUIRE(redraws == 1);
+  editor.drawWindow();
+  REQUIRE(redraws == 2);
+}
+
+TEST_CASE("Stale frames past the draw deadline stay queued", "[integration]") {
+  ApplicationEditor editor;
+  editor.setWindowless(100, 100);
+
+  std::vector<std::unique_ptr<Frame>> frames;
+  int draws = 0;
+  for (int i = 0; i < 16; ++i) {
+    frames.push_back(std::make_unique<Frame>());
+    frames.back()->setBounds(i % 4 * 10, i / 4 * 10, 10, 10);
+    frames.back()->onDraw() = [&draws](Canvas& canvas) { draws++; };
+    editor.addChild(frames.back().get());
+  }
+  editor.drawWindow();
+  draws = 0;
+
+  for (auto& frame : frames)
+    frame->redraw();
+
+  REQUIRE_FALSE(editor.drawStaleChildren(0));
+  REQUIRE(draws == 1);
+  REQUIRE_FALSE(editor.drawStaleChildren(0));
+  REQUIRE(draws == 2);
+
+  for (auto& frame : frames)
+    frame->redraw();
+  REQUIRE(editor.drawStaleChildren(std::numeric_limits<long long>::max()));
+  REQUIRE(draws == 16);
+}
+
+TEST_CASE("Frames outside the visible area wait to draw until they're on screen", "[integration]") {
+  ApplicationEditor editor;
+  editor.setWindowless(100, 100);
+
+  Frame viewport;
+  Frame content;
+  Frame row;
+  viewport.setBounds(0, 0, 100, 50);
+  content.setBounds(0, 0, 100, 200);
+  row.setBounds(0, 150, 100, 20);
+  int draws = 0;
+  row.onDraw() = [&draws](Canvas& canvas) { draws++; };
+
+  editor.addChild(&viewport);
+  viewport.addChild(&content);
+  content.addChild(&row);
+  editor.drawWindow();
+  REQUIRE_FALSE(row.isOnScreen());
+  REQUIRE(draws == 0);
+
+  row.redraw();
+  editor.drawWindow();
+  REQUIRE(draws == 0);
+
+  content.setTopLeft(0, -120);
+  REQUIRE(row.isOnScreen());
+  editor.drawWindow();
+  REQUIRE(draws == 1);
+}
+
+TEST_CASE("Redraws over a frame's max redraw rate wait for the next slot", "[integration]") {
+  ApplicationEditor editor;
+  editor.setWindowless(100, 100);
+
+  Frame meter;
+  meter.setBounds(0, 0, 50, 50);
+  int draws = 0;
+  meter.onDraw() = [&draws](Canvas& canvas) { draws++; };
+  editor.addChild(&meter);
+  editor.drawWindow();
+  REQUIRE(draws == 1);
+
+  meter.setMaxRedrawRate(0.001f);
+  meter.redraw();
+  REQUIRE(editor.drawStaleChildren(std::numeric_limits<long long>::max()));
+  REQUIRE(draws == 1);
+  meter.redraw();
+  editor.drawWindow();
+  REQUIRE(draws == 1);
+
+  meter.setMaxRedrawRate(0.0f);
+  editor.drawWindow();
+  REQUIRE(draws == 2);
+
+  editor.setPowerSavingMode(true, 0.001f);
+  meter.redraw();
+  editor.drawWindow();
+  REQUIRE(draws == 2);
+  editor.setPowerSavingMode(false);
+  editor.drawWindow();
+  REQUIRE(draws == 3);
+}
+
+TEST_CASE("Snapshots hold redraws until released", "[integration]") {
+  ApplicationEditor editor;
+  editor.setWindowless(100, 100);
+
+  Frame page;
+  Frame child;
+  page.setBounds(0, 0, 100, 100);
+  child.setBounds(10, 10, 50, 50);
+  int page_draws = 0;
+  int child_draws = 0;
+  page.onDraw() = [&page_draws](Canvas& canvas) { page_draws++; };
+  child.onDraw() = [&child_draws](Canvas& canvas) { child_draws++; };
+  editor.addChild(&page);
+  page.addChild(&child);
+  editor.drawWindow();
+  page_draws = 0;
+  child_draws = 0;
+
+  page.snapshot();
+  editor.drawWindow();
+  REQUIRE(page.region()->needsLayer());
+  REQUIRE(page_draws == 1);
+
+  for (int i = 1; i <= 4; ++i) {
+    page.redraw();
+    child.redraw();
+    page.setTopLeft(i * 10, 0);
+    page.setSnapshotAlpha(1.0f - i * 0.2f);
+    page.setSnapshotScale(1.0f - i * 0.1f);
+    editor.drawWindow();
+  }
+  REQUIRE(page.isFrozenBySnapshot());
+  REQUIRE(child.isFrozenBySnapshot());
+  REQUIRE(page_draws == 1);
+  REQUIRE(child_draws == 0);
+
+  page.releaseSnapshot();
+  editor.drawWindow();
+  REQUIRE_FALSE(page.region()->needsLayer());
+  REQUIRE(page.region()->compositeAlpha() == 1.0f);
+  REQUIRE(page_draws == 2);
+  REQUIRE(child_draws == 1);
+}
+
+TEST_CASE("Deferred layout resolves each frame once", "[integration]") {
+  ApplicationEditor editor;
+  editor.setWindowless(100, 100);
+  editor.setDeferredLayout(true);
+
+  Frame parent;
+  Frame child;
+  Frame grandchild;
+  parent.setFlexLayout(true);
+  child.setFlexLayout(true);
+  child.layout().setFlexGrow(1.0f);
+  grandchild.layout().setFlexGrow(1.0f);
+  int child_resizes = 0;
+  int grandchild_resizes = 0;
+  child.onResize() += [&] { child_resizes++; };
+  grandchild.onResize() += [&] { grandchild_resizes++; };
+
+  editor.addChild(&parent);
+  parent.addChild(&child);
+  child.addChild(&grandchild);
+  editor.resolveLayouts();
+  child_resizes = 0;
+  grandchild_resizes = 0;
+
+  parent.setBounds(0, 0, 20, 20);
+  parent.setBounds(0, 0, 40, 40);
+  parent.setBounds(0, 0, 60, 60);
+  REQUIRE(child_resizes == 0);
+  REQUIRE(parent.layoutDirty());
+
+  editor.drawWindow();
+  REQUIRE_FALSE(parent.layoutDirty());
+  REQUIRE(child_resizes == 1);
+  REQUIRE(grandchild_resizes == 1);
+  REQUIRE(child.width() == 60);
+  REQUIRE(grandchild.height() == 60);
+
+  editor.setDeferredLayout(false);
+  parent.setBounds(0, 0, 30, 30);
+  REQUIRE(grandchild.width() == 30);
+}
+
+namespace {
+  class CoalescingTestWindow : public Window {
+  public:
+    void runEventLoop() override { }
+    void* nativeHandle() const override { return nullptr; }
+    void windowContentsResized(int width, int height) override { }
+    void show() override { }
+    void showMaximized() override { }
+    void hide() override { }
+    void close() override { }
+    bool isShowing() const override { return true; }
+    void setWindowTitle(const std::string& title) override { }
+    IPoint maxWindowDimensions() const override { return { 1000, 1000 }; }
+  };
+
+  class CoalescingTestHandler : public Window::EventHandler {
+  public:
+    explicit CoalescingTestHandler(Window& window) : window_(window) { }
+
+    HitTestResult handleHitTest(int x, int y) override { return HitTestResult::Client; }
+    HitTestResult currentHitTest() const override { return HitTestResult::Client; }
+    void handleMouseMove(int x, int y, int button_state, int modifiers) override {
+      moves.push_back({ x, y });
+      samples = window_.coalescedMousePositions();
+      history_size = samples.size();
+    }
+    void handleMouseDown(MouseButton button_id, int x, int y, int button_state, int modifiers,
+                         int repeat_clicks) override {
+      downs++;
+    }
+    void handleMouseUp(MouseButton button_id, int x, int y, int button_state, int modifiers,
+                       int repeat_clicks) override { }
+    void handleMouseEnter(int x, int y) override { }
+    void handleMouseLeave(int last_x, int last_y, int button_state, int modifiers) override { }
+    void handleMouseWheel(float delta_x, float delta_y, float precise_x, float precise_y,
+                          int mouse_x, int mouse_y, int button_state, int modifiers,
+                          bool momentum) override {
+      wheels.push_back(delta_y);
+    }
+    bool handleKeyDown(KeyCode key_code, int modifiers, bool repeat) override { return false; }
+    bool handleKeyUp(KeyCode key_code, int modifiers) override { return false; }
+    bool handleTextInput(const std::string& text) override { return false; }
+    bool hasActiveTextEntry() override { return false; }
+    void handleFocusLost() override { }
+    void handleFocusGained() override { }
+    void handleResized(int width, int height) override { }
+    bool handleFileDrag(int x, int y, const std::vector<std::string>& files) override {
+      return false;
+    }
+    void handleFileDragLeave() override { }
+    bool handleFileDrop(int x, int y, const std::vector<std::string>& files) override {
+      return false;
+    }
+    bool isDragDropSource() override { return false; }
+    std::string startDragDropSource() override { return {}; }
+    void cleanupDragDropSource() override { }
+
+    std::vector<IPoint> moves;
+    std::vector<MouseSample> samples;
+    std::vector<float> wheels;
+    int downs = 0;
+    size_t history_size = 0;
+
+  private:
+    Window& window_;
+  };
+}
+
+TEST_CASE("Window coalesces mouse moves and wheel deltas", "[integration]") {
+  CoalescingTestWindow window;
+  CoalescingTestHandler handler(window);
+  window.setEventHandler(&handler);
+  window.setCoalesceMouseEvents(true);
+
+  window.handleMouseMove(1, 1, 0, 0);
+  window.handleMouseMove(2, 3, 0, 0);
+  window.handleMouseMove(5, 8, 0, 0);
+  REQUIRE(handler.moves.empty());
+
+  window.drawCallback(0.0);
+  REQUIRE(handler.moves.size() == 1);
+  REQUIRE(handler.moves[0] == IPoint(5, 8));
+  REQUIRE(handler.history_size == 3);
+  REQUIRE(window.lastWindowMousePosition() == IPoint(5, 8));
+
+  window.handleMouseWheel(0.0f, 1.0f, 5, 8, 0, 0);
+  window.handleMouseWheel(0.0f, 2.0f, 5, 8, 0, 0);
+  window.handleMouseMove(6, 8, 0, 0);
+  window.handleMouseDown(kMouseButtonLeft, 6, 8, kMouseButtonLeft, 0);
+  REQUIRE(handler.wheels.size() == 1);
+  REQUIRE(handler.wheels[0] == 3.0f);
+  REQUIRE(handler.moves.size() == 2);
+  REQUIRE(handler.downs == 1);
+
+  window.setCoalesceMouseEvents(false);
+  window.handleMouseMove(7, 8, kMouseButtonLeft, 0);
+  REQUIRE(handler.moves.size() == 3);
+  REQUIRE(handler.history_size == 1);
+
+  window.addSkippedMousePosition(8, 8, 100);
+  window.addSkippedMousePosition(9, 8, 200);
+  window.handleMouseMove(10, 8, kMouseButtonLeft, 0, 300);
+  REQUIRE(handler.moves.size() == 4);
+  REQUIRE(handler.samples.size() == 3);
+  REQUIRE(handler.samples[0].position == IPoint(8, 8));
+  REQUIRE(handler.samples[2].time_us == 300);
+  window.clearEventHandler();
+}
+
+TEST_CASE("Opaque frames cover frames beneath them", "[integration]") {
+  ApplicationEditor editor;
+  Frame bottom;
+  Frame cover;
+  Frame partial;
+
+  editor.onDraw() = [](Canvas& canvas) {
+    canvas.setColor(0xff333333);
+    canvas.fill();
+  };
+  bottom.onDraw() = [](Canvas& canvas) {
+    canvas.setColor(0xffff0000);
+    canvas.fill();
+  };
+  cover.onDraw() = [](Canvas& canvas) {
+    canvas.setColor(0xff0000ff);
+    canvas.fill();
+  };
+  partial.onDraw() = [](Canvas& canvas) {
+    canvas.setColor(0xff00ff00);
+    canvas.fill();
+  };
+
+  bottom.setBounds(0, 0, 40, 20);
+  cover.setBounds(0, 0, 20, 20);
+  partial.setBounds(20, 0, 10, 20);
+  cover.setOpaque(true);
+  partial.setOpaque(true);
+  REQUIRE(cover.isOpaque());
+
+  editor.addChild(&bottom);
+  editor.addChild(&cover);
+  editor.addChild(&partial);
+  editor.setWindowless(40, 20);
+  Screenshot screenshot = editor.takeScreenshot();
+  const uint8_t* data = screenshot.data();
+
+  auto pixel = [&](int x, int y) {
+    int index = (y * 40 + x) * 4;
+    return (data[index] << 16) | (data[index + 1] << 8) | data[index + 2];
+  };
+  REQUIRE(pixel(10, 10) == 0x0000ff);
+  REQUIRE(pixel(25, 10) == 0x00ff00);
+  REQUIRE(pixel(35, 10) == 0xff0000);
+}
+
+TEST_CASE("Opaque children hide only the parent beneath them", "[integration]") {
+  ApplicationEditor editor;
+  Frame cover;
+  Frame translucent;
+
+  editor.onDraw() = [](Canvas& canvas) {
+    canvas.setColor(0xffff0000);
+    canvas.fill();
+  };
+  cover.onDraw() = [](Canvas& canvas) {
+    canvas.setColor(0xff0000ff);
+    canvas.fill();
+  };
+  translucent.onDraw() = [](Canvas& canvas) {
+    canvas.setColor(0x8000ff00);
+    canvas.fill();
+  };
+
+  cover.setBounds(0, 0, 20, 20);
+  translucent.setBounds(20, 0, 10, 20);
+  cover.setOpaque(true);
+
+  editor.addChild(&cover);
+  editor.addChild(&translucent);
+  editor.setWindowless(40, 20);
+  Screenshot screenshot = editor.takeScreenshot();
+  const uint8_t* data = screenshot.data();
+
+  auto pixel = [&](int x, int y) {
+    int index = (y * 40 + x) * 4;
+    return (data[index] << 16) | (data[index + 1] << 8) | data[index + 2];
+  };
+  REQUIRE(pixel(10, 10) == 0x0000ff);
+  REQUIRE((pixel(25, 10) >> 16) > 0x40);
+  REQUIRE(((pixel(25, 10) >> 8) & 0xff) > 0x40);
+  REQUIRE(pixel(35, 10) == 0xff0000);
+}
@@ -22,7 +22,9 @@
 #include "window_event_handler.h"
 
 #include "visage_ui/frame.h"
+#include "visage_utils/time_utils.h"
 
+#include <algorithm>
 #include <regex>
 
 namespace visage {
@@ -65,6 +67,8 @@ namespace visage {
       keyboard_focused_frame_ = nullptr;
     if (drag_drop_target_frame_ == frame)
       drag_drop_target_frame_ = nullptr;
+    if (last_hit_frame_ == frame)
+      last_hit_valid_ = false;
   }
 
   void WindowEventHandler::handleFocusLost() {
@@ -88,10 +92,20 @@ namespace visage {
 
   void WindowEventHandler::handleResized(int width, int height) {
     VISAGE_ASSERT(width >= 0 && height >= 0);
+    if (editor_->liveResizeMode()) {
+      editor_->deferWindowResize(width, height);
+      return;
+    }
+
     content_frame_->setNativeBounds(0, 0, width, height);
     content_frame_->redraw();
   }
 
+  void WindowEventHandler::handleVisibilityChanged(bool visible) {
+    if (visible)
+      content_frame_->redrawAll();
+  }
+
   void WindowEventHandler::handleAdjustResize(int* width, int* height, bool horizontal_resize,
                                               bool vertical_resize) {
     editor_->adjustWindowDimensions(width, height, horizontal_resize, vertical_resize);
@@ -229,9 +243,35 @@ namespace visage {
     return mouse_event;
   }
 
+  void WindowEventHandler::addPointerSample(Point window_position, long long time_us) {
+    pointer_history_.push_back({ window_position, time_us });
+    auto stale = [time_us](const PointerSample& sample) {
+      return time_us - sample.time_us > kPointerHistoryUs;
+    };
+    auto first_kept = std::find_if_not(pointer_history_.begin(), pointer_history_.end(), stale);
+    pointer_history_.erase(pointer_history_.begin(), first_kept);
+  }
+
+  void WindowEventHandler::setPointerHistory(MouseEvent& mouse_event) const {
+    mouse_event.time_us = pointer_history_.back().time_us;
+    mouse_event.history = &pointer_history_;
+  }
+
+  Frame* WindowEventHandler::frameAtPoint(Point point) {
+    uint64_t generation = Frame::hitTestGeneration();
+    if (last_hit_valid_ && last_hit_point_ == point && last_hit_generation_ == generation)
+      return last_hit_frame_;
+
+    last_hit_frame_ = content_frame_->frameAtPoint(point);
+    last_hit_point_ = point;
+    last_hit_generation_ = generation;
+    last_hit_valid_ = true;
+    return last_hit_frame_;
+  }
+
   HitTestResult WindowEventHandler::handleHitTest(int x, int y) {
     Point window_position = convertToLogical({ x, y });
-    Frame* hovered_frame = content_frame_->frameAtPoint(window_position);
+    Frame* hovered_frame = frameAtPoint(window_position);
     if (hovered_frame == nullptr)
       current_hit_test_ = HitTestResult::Client;
     else {
@@ -246,6 +286,20 @@ namespace visage {
     if (window_->mouseRelativeMode() && mouse_event.relative_position == Point(0, 0))
       return;
 
+    const std::vector<MouseSample>& coalesced_positions = window_->coalescedMousePositions();
+    if (coalesced_positions.size() > 1) {
+      coalesced_window_positions_.clear();
+      for (const MouseSample& sample : coalesced_positions)
+        coalesced_window_positions_.push_back(convertToLogical(sample.position));
+      mouse_event.coalesced_window_positions = &coalesced_window_positions_;
+    }
+
+    if (coalesced_positions.empty())
+      addPointerSample(mouse_event.window_position, time::microseconds());
+    for (const MouseSample& sample : coalesced_positions)
+      addPointerSample(convertToLogical(sample.position), sample.time_us);
+    setPointerHistory(mouse_event);
+
     if (mouse_down_frame_) {
       mouse_event.position = mouse_event.window_position - mouse_down_frame_->positionInWindow();
       mouse_event.event_frame = mouse_down_frame_;
@@ -253,7 +307,7 @@ namespace visage {
       return;
     }
 
-    temporary_frame_ = content_frame_->frameAtPoint(mouse_event.window_position);
+    temporary_frame_ = frameAtPoint(mouse_event.window_position);
     if (temporary_frame_ != mouse_hovered_frame_) {
       if (mouse_hovered_frame_) {
         mouse_event.position = mouse_event.window_position - mouse_hovered_frame_->positionInWindow();
@@ -280,6 +334,9 @@ namespace visage {
                                            int modifiers, int repeat) {
     MouseEvent mouse_event = buttonMouseEvent(button_id, x, y, button_state, modifiers);
     mouse_event.repeat_click_count = repeat;
+    pointer_history_.clear();
+    addPointerSample(mouse_event.window_position, time::microseconds());
+    setPointerHistory(mouse_event);
 
     // Debug: log coordinates and frame bounds
     if (std::getenv("NUPG_VISAGE_DEBUG") && std::getenv("NUPG_VISAGE_DEBUG")[0] != '0') {
@@ -291,7 +348,7 @@ namespace visage {
               cb.x(), cb.y(), cb.width(), cb.height());
     }
 
-    mouse_down_frame_ = content_frame_->frameAtPoint(mouse_event.window_position);
+    mouse_down_frame_ = frameAtPoint(mouse_event.window_position);
     temporary_frame_ = mouse_down_frame_;
     while (temporary_frame_ && !temporary_frame_->acceptsKeystrokes())
       temporary_frame_ = temporary_frame_->parent();
@@ -315,8 +372,10 @@ namespace visage {
                                          int modifiers, int repeat) {
     MouseEvent mouse_event = buttonMouseEvent(button_id, x, y, button_state, modifiers);
     mouse_event.repeat_click_count = repeat;
+    addPointerSample(mouse_event.window_position, time::microseconds());
+    setPointerHistory(mouse_event);
 
-    mouse_hovered_frame_ = content_frame_->frameAtPoint(mouse_event.window_position);
+    mouse_hovered_frame_ = frameAtPoint(mouse_event.window_position);
     bool exited = mouse_hovered_frame_ != mouse_down_frame_;
 
     if (mouse_down_frame_) {
@@ -359,7 +418,7 @@ namespace visage {
     mouse_event.precise_wheel_delta_y = precise_y;
     mouse_event.wheel_momentum = momentum;
 
-    mouse_hovered_frame_ = content_frame_->frameAtPoint(mouse_event.window_position);
+    mouse_hovered_frame_ = frameAtPoint(mouse_event.window_position);
     if (mouse_hovered_frame_) {
       temporary_frame_ = mouse_hovered_frame_;
       bool used = false;
@@ -30,6 +30,9 @@ namespace visage {
 
   class WindowEventHandler : public Window::EventHandler {
   public:
+    // How far back MouseEvent::history reaches.
+    static constexpr long long kPointerHistoryUs = 100000;
+
     WindowEventHandler() = delete;
     WindowEventHandler(const WindowEventHandler&) = delete;
 
@@ -72,6 +75,7 @@ namespace visage {
     void handleFocusLost() override;
     void handleFocusGained() override;
     void handleResized(int width, int height) override;
+    void handleVisibilityChanged(bool visible) override;
     void handleAdjustResize(int* width, int* height, bool horizontal_resize, bool vertical_resize) override;
 
     bool handleFileDrag(int x, int y, const std::vector<std::string>& files) override;
@@ -83,6 +87,9 @@ namespace visage {
     void cleanupDragDropSource() override;
 
   private:
+    void addPointerSample(Point window_position, long long time_us);
+    void setPointerHistory(MouseEvent& mouse_event) const;
+    Frame* frameAtPoint(Point point);
     Frame* dragDropFrame(Point point, const std::vector<std::string>& files) const;
 
     ApplicationEditor* editor_ = nullptr;
@@ -96,8 +103,15 @@ namespace visage {
     std::function<void()> resize_callback_ = [this] { onFrameResize(content_frame_); };
 
     Point last_mouse_position_ = { 0, 0 };
+    std::vector<Point> coalesced_window_positions_;
+    std::vector<PointerSample> pointer_history_;
     HitTestResult current_hit_test_ = HitTestResult::Client;
 
+    Frame* last_hit_frame_ = nullptr;
+    Point last_hit_point_ = { 0, 0 };
+    uint64_t last_hit_generation_ = 0;
+    bool last_hit_valid_ = false;
+
     VISAGE_LEAK_CHECKER(WindowEventHandler)
   };
 }
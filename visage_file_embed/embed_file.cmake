@@ -13,6 +13,75 @@ endif ()
 string(REGEX MATCH "([^/]+)$" VAR_NAME ${ORIGINAL_FILE})
 string(REGEX REPLACE "\\.| |-" "_" VAR_NAME ${VAR_NAME})
 
+if (EMBED_MODE STREQUAL "FETCH")
+  if (NOT DEFINED ASSET_FILE OR NOT DEFINED ASSET_URL)
+    message(FATAL_ERROR "FETCH mode requires ASSET_FILE and ASSET_URL")
+  endif ()
+
+  configure_file(${ORIGINAL_FILE} ${ASSET_FILE} COPYONLY)
+  file(SIZE ${ORIGINAL_FILE} DATA_SIZE)
+
+  set(FILE_CONTENTS "// Generated file, do not edit\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}#include \"embedded_file.h\"\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}namespace ${VAR_NAMESPACE} {\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}static const char ${VAR_NAME}_name[] = \"${VAR_NAME}\";\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}static const char ${VAR_NAME}_url[] = \"${ASSET_URL}\";\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}::visage::EmbeddedFile ${VAR_NAME} = { ${VAR_NAME}_name, nullptr, ")
+  set(FILE_CONTENTS "${FILE_CONTENTS}${DATA_SIZE}, ${VAR_NAME}_url };\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}}\n")
+
+  file(CONFIGURE OUTPUT ${DEST_FILE} CONTENT "${FILE_CONTENTS}" @ONLY)
+  return()
+endif ()
+
+if (EMBED_MODE STREQUAL "INCBIN")
+  get_filename_component(ORIGINAL_PATH ${ORIGINAL_FILE} ABSOLUTE)
+  file(SIZE ${ORIGINAL_PATH} DATA_SIZE)
+  string(REPLACE "::" "_" SYMBOL "visage_embed_${VAR_NAMESPACE}_${VAR_NAME}")
+
+  set(FILE_CONTENTS "// Generated file, do not edit\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}#include \"embedded_file.h\"\n\n")
+  # The data section is pushed and popped so the compiler's current section is left as it was.
+  # COFF assemblers only know .section, so Windows switches back to .text instead. Symbols are
+  # hidden on ELF and Mach-O so embedded files don't leak out of shared libraries and plugins.
+  set(FILE_CONTENTS "${FILE_CONTENTS}#if defined(__APPLE__)\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}#define VISAGE_EMBED_SECTION \".pushsection __DATA,__const\\n\"\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}#define VISAGE_EMBED_END_SECTION \".popsection\\n\"\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}#define VISAGE_EMBED_VISIBILITY \".private_extern \"\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}#define VISAGE_EMBED_PREFIX \"_\"\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}#define VISAGE_EMBED_HIDDEN __attribute__((visibility(\"hidden\")))\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}#elif defined(_WIN32)\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}#define VISAGE_EMBED_SECTION \".section .rdata,\\\"dr\\\"\\n\"\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}#define VISAGE_EMBED_END_SECTION \".text\\n\"\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}#define VISAGE_EMBED_VISIBILITY \".global \"\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}#define VISAGE_EMBED_HIDDEN\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}#if defined(_WIN64)\n#define VISAGE_EMBED_PREFIX \"\"\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}#else\n#define VISAGE_EMBED_PREFIX \"_\"\n#endif\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}#else\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}#define VISAGE_EMBED_SECTION \".pushsection .rodata,\\\"a\\\"\\n\"\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}#define VISAGE_EMBED_END_SECTION \".popsection\\n\"\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}#define VISAGE_EMBED_VISIBILITY \".hidden \"\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}#define VISAGE_EMBED_PREFIX \"\"\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}#define VISAGE_EMBED_HIDDEN __attribute__((visibility(\"hidden\")))\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}#endif\n\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}extern \"C\" VISAGE_EMBED_HIDDEN const unsigned char ${SYMBOL}[];\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}__asm__(VISAGE_EMBED_SECTION\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}        \".global \" VISAGE_EMBED_PREFIX \"${SYMBOL}\\n\"\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}        VISAGE_EMBED_VISIBILITY VISAGE_EMBED_PREFIX \"${SYMBOL}\\n\"\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}        \".balign 16\\n\"\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}        VISAGE_EMBED_PREFIX \"${SYMBOL}:\\n\"\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}        \".incbin \\\"${ORIGINAL_PATH}\\\"\\n\"\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}        \".byte 0\\n\"\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}        VISAGE_EMBED_END_SECTION);\n\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}namespace ${VAR_NAMESPACE} {\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}static const char ${VAR_NAME}_name[] = \"${VAR_NAME}\";\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}::visage::EmbeddedFile ${VAR_NAME} = { ${VAR_NAME}_name, ${SYMBOL}, ${DATA_SIZE} };\n")
+  set(FILE_CONTENTS "${FILE_CONTENTS}}\n")
+
+  file(CONFIGURE OUTPUT ${DEST_FILE} CONTENT "${FILE_CONTENTS}" @ONLY)
+  return()
+endif ()
+
 file(READ ${ORIGINAL_FILE} DATA HEX)
 string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," DATA ${DATA})
 set(FILE_CONTENTS_BEGIN "// Generated file, do not edit\n")
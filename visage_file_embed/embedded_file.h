@@ -26,5 +26,7 @@ namespace visage {
     const char* name = nullptr;
     const unsigned char* data = nullptr;
     int size = 0;
+    // Set for fetched resources, which have no data until FetchedFiles downloads them.
+    const char* url = nullptr;
   };
 }
@@ -104,12 +104,19 @@ namespace visage {
       return ease(*from, *to, t, easing);
     }
 
-    T update() {
-      long long ms = time::milliseconds();
+    T update() { return update(time::milliseconds()); }
+
+    T update(long long ms) {
+      long long elapsed_ms = ms - last_ms_;
+      last_ms_ = ms;
+      return advance(elapsed_ms);
+    }
+
+    // Steps by time measured on the caller's own clock instead of the one target() stamps.
+    T advance(long long elapsed_ms) {
       float delta = 1.0f;
       if (time_ > std::numeric_limits<float>::epsilon())
-        delta = (ms - last_ms_) / time_;
-      last_ms_ = ms;
+        delta = elapsed_ms / time_;
 
       if (targeting_)
         t_ = std::min(t_ + delta, 1.0f);
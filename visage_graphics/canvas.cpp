@@ -21,9 +21,12 @@
 
 #include "canvas.h"
 
+#include "graphics_caches.h"
 #include "palette.h"
 #include "renderer.h"
 #include "theme.h"
+#include "visage_utils/time_utils.h"
+#include "visage_utils/trace.h"
 
 #include <bgfx/bgfx.h>
 
@@ -32,9 +35,71 @@ namespace visage {
     return bgfx::getCaps()->supported & BGFX_CAPS_SWAP_CHAIN;
   }
 
-  Canvas::Canvas() :
-      image_atlas_(ImageAtlas::DataType::RGBA8), data_atlas_(ImageAtlas::DataType::Float32),
-      composite_layer_(&gradient_atlas_) {
+  namespace {
+    struct SharedCanvasResources {
+      // Retained resources are left for the OS on exit, the renderer may already be gone.
+      ~SharedCanvasResources() { (void)retained.release(); }
+
+      static SharedCanvasResources& instance() {
+        static SharedCanvasResources shared_resources;
+        return shared_resources;
+      }
+
+      std::shared_ptr<CanvasResources> use(CanvasResources* resources) {
+        return { resources, [](CanvasResources* released) { instance().release(released); } };
+      }
+
+      void release(CanvasResources* resources) {
+        if (retain_period <= 0) {
+          delete resources;
+          return;
+        }
+
+        retained.reset(resources);
+        expire_time = time::milliseconds() + retain_period;
+      }
+
+      void releaseExpired() {
+        if (retained && time::milliseconds() >= expire_time)
+          retained.reset();
+      }
+
+      std::weak_ptr<CanvasResources> shared;
+      std::unique_ptr<CanvasResources> retained;
+      long long expire_time = 0;
+      int retain_period = 0;
+    };
+  }
+
+  std::shared_ptr<CanvasResources> CanvasResources::shared() {
+    SharedCanvasResources& shared_resources = SharedCanvasResources::instance();
+    std::shared_ptr<CanvasResources> resources = shared_resources.shared.lock();
+    if (resources == nullptr) {
+      if (shared_resources.retained)
+        resources = shared_resources.use(shared_resources.retained.release());
+      else
+        resources = shared_resources.use(new CanvasResources());
+      shared_resources.shared = resources;
+    }
+    return resources;
+  }
+
+  void CanvasResources::setRetainPeriod(int ms) {
+    SharedCanvasResources::instance().retain_period = ms;
+  }
+
+  int CanvasResources::retainPeriod() {
+    return SharedCanvasResources::instance().retain_period;
+  }
+
+  void CanvasResources::releaseRetained() {
+    SharedCanvasResources::instance().retained.reset();
+  }
+
+  Canvas::Canvas() : Canvas(std::make_shared<CanvasResources>()) { }
+
+  Canvas::Canvas(std::shared_ptr<CanvasResources> resources) :
+      resources_(std::move(resources)), composite_layer_(&resources_->gradient_atlas) {
     state_.current_region = &default_region_;
     layers_.push_back(&composite_layer_);
     composite_layer_.addRegion(&window_region_);
@@ -60,7 +125,7 @@ namespace visage {
   }
 
   void Canvas::setDimensions(int width, int height) {
-    VISAGE_ASSERT(state_memory_.empty());
+    VISAGE_ASSERT(num_saved_states_ == 0);
     width = std::max(1, width);
     height = std::max(1, height);
     composite_layer_.setDimensions(width, height);
@@ -69,45 +134,466 @@ namespace visage {
     setClampBounds(0, 0, width, height);
   }
 
+  void Canvas::setInvalidRectCoalescing(const InvalidRectCoalescing& coalescing) {
+    invalid_rect_coalescing_ = coalescing;
+    for (Layer* layer : layers_)
+      layer->setInvalidRectCoalescing(coalescing);
+  }
+
+  void Canvas::setFrameBufferBucket(int bucket) {
+    frame_buffer_bucket_ = bucket;
+    for (auto& layer : intermediate_layers_)
+      layer->setFrameBufferBucket(bucket);
+  }
+
+  void Canvas::setDebugDraw(DebugDraw debug_draw) {
+    debug_draw_ = debug_draw;
+    for (Layer* layer : layers_) {
+      if (layer != &composite_layer_)
+        layer->setDebugDraw(debug_draw);
+    }
+  }
+
+  void Canvas::setVertexThreads(int num_threads) {
+    vertex_worker_pool_.reset();
+    if (num_threads > 0)
+      vertex_worker_pool_ = std::make_unique<WorkerPool>(num_threads);
+
+    for (Layer* layer : layers_)
+      layer->setWorkerPool(vertex_worker_pool_.get());
+  }
+
   int Canvas::submit(int submit_pass) {
-    default_region_.computeBackdropCount();
+    VISAGE_TRACE_SCOPE("Canvas::submit");
+    profiler_.beginFrame();
+    int submission = submit_pass;
+    {
+      FrameProfiler::ScopedSample sample(&profiler_, "Canvas::submit");
+      submission = submitLayers(submit_pass);
+
+      bool rendered = submission > submit_pass;
+      if (rendered || last_skipped_frame_ != render_frame_) {
+        uint32_t frame = Renderer::instance().frame();
+        if (rendered && render_frame_ == 0)
+          frame = Renderer::instance().frame();
+        finishFrame(frame, rendered);
+        nextFrame(rendered);
+      }
+    }
+
+    finishSubmit(submit_pass, submission);
+    return submission;
+  }
+
+  int Canvas::submitWindowless(const std::vector<Canvas*>& canvases) {
+    int max_views = maxViews();
+    int frames = 0;
+    size_t begin = 0;
+    while (begin < canvases.size()) {
+      int submission = 0;
+      bool rendered = false;
+      bool first_frame = false;
+      size_t end = begin;
+      for (; end < canvases.size(); ++end) {
+        Canvas* canvas = canvases[end];
+        VISAGE_ASSERT(canvas->composite_layer_.isHeadlessRender());
+        if (end > begin && submission + canvas->maxSubmitViews() > max_views)
+          break;
+
+        int submit_pass = submission;
+        canvas->profiler_.beginFrame();
+        {
+          FrameProfiler::ScopedSample sample(&canvas->profiler_, "Canvas::submit");
+          submission = canvas->submitLayers(submit_pass);
+        }
+        canvas->finishSubmit(submit_pass, submission);
+        rendered = rendered || canvas->views_used_ > 0;
+        first_frame = first_frame || (canvas->views_used_ > 0 && canvas->render_frame_ == 0);
+      }
+
+      uint32_t frame = Renderer::instance().frame();
+      if (first_frame)
+        frame = Renderer::instance().frame();
+      frames++;
+
+      for (size_t i = begin; i < end; ++i)
+        canvases[i]->finishFrame(frame, canvases[i]->views_used_ > 0);
+      nextFrame(rendered);
+      begin = end;
+    }
+    return frames;
+  }
+
+  bool Canvas::defragmentAtlases(int max_moves) {
+    VISAGE_TRACE_SCOPE("Canvas::defragmentAtlases");
+    ImageAtlas* atlases[] = { &resources_->image_atlas, &resources_->data_atlas,
+                              &resources_->half_data_atlas, &resources_->byte_data_atlas };
+    int moves = 0;
+    bool defragmenting = false;
+    for (ImageAtlas* atlas : atlases) {
+      moves += atlas->defragment(0, max_moves - moves);
+      defragmenting = defragmenting || atlas->defragmenting();
+    }
+
+    if (moves)
+      Renderer::instance().frame();
+    return moves || defragmenting;
+  }
+
+  int Canvas::maxSubmitViews() {
+    int layer_views = 0;
+    for (int i = 1; i < layers_.size(); ++i)
+      layer_views += layers_[i]->maxSubmitViews();
+
+    int path_atlas_views = 1;
+    int num_backdrops = default_region_.computeBackdropCount();
+    return path_atlas_views + (num_backdrops + 1) * layer_views + composite_layer_.maxSubmitViews();
+  }
+
+  void Canvas::finishSubmit(int submit_pass, int submission) {
+    views_used_ = submission - submit_pass;
+    peak_views_used_ = std::max(peak_views_used_, views_used_);
+    VISAGE_ASSERT(submission <= maxViews());
+    profiler_.endFrame(submission > submit_pass, views_used_);
+  }
+
+  void Canvas::finishFrame(uint32_t frame, bool rendered) {
+    composite_layer_.finishReadBacks(frame);
+    if (!rendered) {
+      last_skipped_frame_ = render_frame_;
+      return;
+    }
+
+    render_frame_++;
+    stroke_cache_.nextFrame();
+    shadow_cache_.nextFrame();
+    resources_->gradient_atlas.clearStaleGradients();
+    resources_->image_atlas.clearStaleImages();
+    resources_->data_atlas.clearStaleImages();
+    resources_->half_data_atlas.clearStaleImages();
+    resources_->byte_data_atlas.clearStaleImages();
+  }
+
+  void Canvas::nextFrame(bool rendered) {
+    if (rendered) {
+      FontCache::clearStaleFonts();
+      SharedCanvasResources::instance().releaseExpired();
+      FrameBufferPool::nextFrame();
+    }
+    UniformCache::nextFrame();
+    TransientBuffers::nextFrame();
+    SubmitBatchPool::instance().nextFrame();
+  }
+
+  int Canvas::maxViews() {
+    return bgfx::getCaps()->limits.maxViews;
+  }
+
+  int Canvas::submitLayers(int submit_pass) {
+    int num_backdrops = default_region_.computeBackdropCount();
     int submission = submit_pass;
     int last_submission = submission - 1;
+    DrawCounts start_counts = drawCounts();
+    frame_stats_ = {};
 
-    submission = path_atlas_.updatePaths(submission);
+    {
+      FrameProfiler::ScopedSample sample(&profiler_, "PathAtlas::updatePaths");
+      submission = resources_->path_atlas.updatePaths(submission);
+    }
 
     for (int i = 2; i < layers_.size(); ++i) {
       if (!layers_[1]->invalidRects().empty())
-        layers_[i]->checkBackdropInvalidation(layers_[1]->invalidRects().begin()->second);
+        layers_[i]->checkBackdropInvalidation(layers_[1]->invalidRects().area(&default_region_));
     }
 
-    for (int backdrop = 0; submission != last_submission; backdrop++) {
+    for (int backdrop = 0; backdrop <= num_backdrops && submission != last_submission; backdrop++) {
       last_submission = submission;
-      for (int i = layers_.size() - 1; i > 0; --i)
+      for (int i = layers_.size() - 1; i > 0; --i) {
+        FrameProfiler::ScopedSample sample(&profiler_, "Layer::submit", i);
         submission = layers_[i]->submit(submission, backdrop);
+        const Layer::SubmitStats& stats = layers_[i]->submitStats();
+        profiler_.addBatchSubmits(stats.batch_submits, stats.region_batches);
+        frame_stats_.batch_submits += stats.batch_submits;
+        frame_stats_.region_batches += stats.region_batches;
+      }
     }
 
-    for (int i = 1; i < layers_.size(); ++i)
+    present_damage_.clear();
+    if (submission > submit_pass && layers_.size() > 1) {
+      present_damage_ = layers_[1]->invalidRects().rects(&default_region_);
+    }
+
+    for (int i = 1; i < layers_.size(); ++i) {
       layers_[i]->clearInvalidRects();
+      layers_[i]->releaseIfIdle();
+    }
 
     if (submission > submit_pass) {
       composite_layer_.invalidate();
-      submission = composite_layer_.submit(submission, 0);
-      bgfx::frame();
-      if (render_frame_ == 0)
-        bgfx::frame();
+      {
+        FrameProfiler::ScopedSample sample(&profiler_, "Layer::submit", 0);
+        submission = composite_layer_.submit(submission, 0);
+      }
+    }
 
-      render_frame_++;
-      FontCache::clearStaleFonts();
-      gradient_atlas_.clearStaleGradients();
-      image_atlas_.clearStaleImages();
-      data_atlas_.clearStaleImages();
+    frame_stats_.draw_calls = static_cast<int>(drawCounts().draw_calls - start_counts.draw_calls);
+    frame_stats_.vertices = drawCounts().vertices - start_counts.vertices;
+    return submission;
+  }
+
+  void Canvas::bars(const float* extents, int num_bars, const Color* colors) {
+    if (extents == nullptr || num_bars <= 0)
+      return;
+
+    float scale = state_.scale;
+    const PackedBrush* brush = state_.brush;
+    bar_shapes_.clear();
+    bar_shapes_.reserve(num_bars);
+    for (int i = 0; i < num_bars; ++i) {
+      if (colors && (i == 0 || !(colors[i] == colors[i - 1]))) {
+        Brush solid = Brush::solid(colors[i]);
+        brush = state_.current_region->addBrush(gradientAtlas(), solid.gradient(),
+                                                solid.position() * scale);
+      }
+
+      const float* bar = extents + 4 * i;
+      float width = scale * (bar[2] - bar[0]);
+      float height = scale * (bar[3] - bar[1]);
+      if (width > 0.0f && height > 0.0f)
+        bar_shapes_.emplace_back(state_.clamp, brush, state_.x + scale * bar[0],
+                                 state_.y + scale * bar[1], width, height);
     }
-    else if (last_skipped_frame_ != render_frame_) {
-      last_skipped_frame_ = render_frame_;
-      bgfx::frame();
+
+    state_.current_region->shape_batcher_.addShapes(bar_shapes_.data(), bar_shapes_.size(),
+                                                    state_.blend_mode);
+  }
+
+  void Canvas::addPolyline(const Point* points, int num_points, float thickness) {
+    if (points == nullptr || num_points <= 0 || thickness <= 0.0f)
+      return;
+
+    float scale = state_.scale;
+    float left = points[0].x * scale;
+    float top = points[0].y * scale;
+    float right = left;
+    float bottom = top;
+    for (int i = 1; i < num_points; ++i) {
+      left = std::min(left, points[i].x * scale);
+      top = std::min(top, points[i].y * scale);
+      right = std::max(right, points[i].x * scale);
+      bottom = std::max(bottom, points[i].y * scale);
+    }
+
+    float half_thickness = 0.5f * thickness;
+    if (left == right && top == bottom) {
+      addShape(Circle(state_.clamp, state_.brush, state_.x + left - half_thickness,
+                      state_.y + top - half_thickness, thickness));
+      return;
+    }
+
+    // Segments overlap at the joins, which only looks right when drawing over a pixel twice
+    // doesn't change it. Anything else is stroked as one outline through the path atlas.
+    bool opaque_blend = state_.blend_mode == BlendMode::Alpha ||
+                        state_.blend_mode == BlendMode::Opaque;
+    if (!opaque_blend || !state_.set_brush.isOpaque()) {
+      Path path;
+      path.moveTo(points[0]);
+      for (int i = 1; i < num_points; ++i)
+        path.lineTo(points[i]);
+      addPathStroke(path, state_.x, state_.y, right + half_thickness + 1.0f,
+                    bottom + half_thickness + 1.0f, thickness, Path::Join::Round,
+                    Path::EndCap::Round, {}, 0.0f, Path::kDefaultMiterLimit);
+      return;
+    }
+
+    float line_left = state_.x + left - half_thickness;
+    float line_top = state_.y + top - half_thickness;
+    float line_right = state_.x + right + half_thickness;
+    float line_bottom = state_.y + bottom + half_thickness;
+    float shader_thickness = thickness + 1.0f;
+    float radius = 0.5f * shader_thickness + 1.0f;
+
+    Point a = points[0] * scale;
+    for (int i = 1; i < num_points; ++i) {
+      Point b = points[i] * scale;
+      Point delta = b - a;
+      float length = delta.length();
+      if (length == 0.0f)
+        continue;
+
+      float extent = radius * (std::abs(delta.x) + std::abs(delta.y)) / length;
+      float x = std::min(a.x, b.x) - extent;
+      float y = std::min(a.y, b.y) - extent;
+      float width = std::max(a.x, b.x) + extent - x;
+      float height = std::max(a.y, b.y) + extent - y;
+
+      float x1 = 2.0f * (a.x - x) / width - 1.0f;
+      float y1 = 2.0f * (a.y - y) / height - 1.0f;
+      float x2 = 2.0f * (b.x - x) / width - 1.0f;
+      float y2 = 2.0f * (b.y - y) / height - 1.0f;
+      addShape(PolylineSegment(state_.clamp, state_.brush, state_.x + x, state_.y + y, width, height,
+                               x1, y1, x2, y2, shader_thickness, line_left, line_top, line_right,
+                               line_bottom));
+      a = b;
     }
-    return submission;
+  }
+
+  void Canvas::addTransformedPath(const Path& path) {
+    if (path.numPoints() == 0)
+      return;
+
+    Transform transform(state_.transform.matrix, state_.transform.translate * state_.scale);
+    Path transformed = path.transformed(transform);
+    Bounds bounding_box = transformed.boundingBox();
+    transformed.translate(-bounding_box.x(), -bounding_box.y());
+
+    float scale = state_.scale;
+    state_.scale = 1.0f;
+    addPathFill(transformed, state_.x + bounding_box.x(), state_.y + bounding_box.y(),
+                bounding_box.width() + 1.0f, bounding_box.height() + 1.0f);
+    state_.scale = scale;
+  }
+
+  void Canvas::addPathStrips(const Path& path, float x, float y) {
+    Path adjusted_path = path.flattened(state_.scale);
+    if (state_.scale != 1.0f)
+      adjusted_path.scale(state_.scale);
+    Bounds bounding_box = adjusted_path.boundingBox();
+    float left = std::floor(x + bounding_box.x() - PathFillWrapper::kBuffer);
+    float top = std::floor(y + bounding_box.y() - PathFillWrapper::kBuffer);
+    int width = std::ceil(x + bounding_box.right() + PathFillWrapper::kBuffer) - left;
+    int height = std::ceil(y + bounding_box.bottom() + PathFillWrapper::kBuffer) - top;
+    adjusted_path.translate(Point(x - left, y - top));
+
+    auto strips = std::make_shared<PathStrips>();
+    strips->rasterize(adjusted_path, width, height);
+    if (strips->strips().empty())
+      return;
+
+    ImageAtlas::PackedImage packed_alphas = imageAtlas()->addData(strips->alphaData(),
+                                                                 strips->alphaWidth(),
+                                                                 strips->alphaHeight());
+    for (const PathStrips::Strip& strip : strips->strips())
+      addShape(PathStripWrapper(state_.clamp, state_.brush, left, top, strip, strips, packed_alphas,
+                                imageAtlas()));
+  }
+
+  bool Canvas::addCachedShadow(float x, float y, float width, float height, float rounding,
+                               float shadow_width) {
+    int extent = ShadowCache::extent(rounding, shadow_width);
+    if (width < 2 * extent || height < 2 * extent)
+      return false;
+
+    ShadowCache::Mask* mask = shadow_cache_.mask(rounding, shadow_width);
+    if (mask == nullptr)
+      return false;
+
+    int size = mask->extent + 1;
+    Image image(mask->pixels->data(), mask->pixels->size(), size, size);
+    image.raw = true;
+    bool upload = mask->uploaded_atlas != imageAtlas();
+    ImageAtlas::PackedImage packed_mask = imageAtlas()->addImage(image, upload);
+    mask->uploaded_atlas = imageAtlas();
+
+    // Corners map mask pixels one to one, mirrored for the right and bottom sides. Edges and the
+    // middle stretch the solid last row and column, sampled at their centers.
+    float corner = mask->extent;
+    float solid = corner + 0.5f;
+    float xs[] = { x, x + corner, x + width - corner, x + width };
+    float ys[] = { y, y + corner, y + height - corner, y + height };
+    float source_xs[][2] = { { 0.0f, corner }, { solid, solid }, { corner, 0.0f } };
+    float source_ys[][2] = { { 0.0f, corner }, { solid, solid }, { corner, 0.0f } };
+    Bounds gradient_bounds(x, y, width, height);
+
+    image_slices_.clear();
+    for (int row = 0; row < 3; ++row) {
+      for (int column = 0; column < 3; ++column) {
+        float slice_width = xs[column + 1] - xs[column];
+        float slice_height = ys[row + 1] - ys[row];
+        if (slice_width <= 0.0f || slice_height <= 0.0f)
+          continue;
+
+        image_slices_.emplace_back(state_.clamp, state_.brush, xs[column], ys[row], slice_width,
+                                   slice_height, packed_mask, imageAtlas(), source_xs[column][0],
+                                   source_ys[row][0], source_xs[column][1], source_ys[row][1],
+                                   gradient_bounds, mask->pixels);
+      }
+    }
+
+    state_.current_region->shape_batcher_.addShapes(image_slices_.data(), image_slices_.size(),
+                                                     state_.blend_mode);
+    image_slices_.clear();
+    return true;
+  }
+
+  void Canvas::addTiledImage(TiledImage& image, float x, float y, float width, float height) {
+    if (width <= 0.0f || height <= 0.0f || image.width() == 0 || image.height() == 0)
+      return;
+
+    x += state_.x;
+    y += state_.y;
+    const ClampBounds& clamp = state_.clamp;
+    float left = std::max(x, clamp.left);
+    float top = std::max(y, clamp.top);
+    float right = std::min(x + width, clamp.right);
+    float bottom = std::min(y + height, clamp.bottom);
+    if (right <= left || bottom <= top)
+      return;
+
+    float scale_x = width / image.width();
+    float scale_y = height / image.height();
+    Bounds visible((left - x) / scale_x, (top - y) / scale_y, (right - left) / scale_x,
+                   (bottom - top) / scale_y);
+    int level = image.levelForScale(std::max(scale_x, scale_y));
+    image.collectTiles(imageAtlas(), level, visible, tile_draws_);
+
+    Bounds gradient_bounds(x, y, width, height);
+    image_slices_.clear();
+    for (const TiledImage::TileDraw& tile : tile_draws_) {
+      image_slices_.emplace_back(state_.clamp, state_.brush, x + tile.bounds.x() * scale_x,
+                                 y + tile.bounds.y() * scale_y, tile.bounds.width() * scale_x,
+                                 tile.bounds.height() * scale_y, tile.packed_image, imageAtlas(),
+                                 tile.source.x(), tile.source.y(), tile.source.right(),
+                                 tile.source.bottom(), gradient_bounds, tile.pixels);
+    }
+
+    state_.current_region->shape_batcher_.addShapes(image_slices_.data(), image_slices_.size(),
+                                                     state_.blend_mode);
+    image_slices_.clear();
+    tile_draws_.clear();
+  }
+
+  bool Canvas::addSvgRaster(const Svg& svg, float x, float y, float width, float height) {
+    int raster_width = std::round(width);
+    int raster_height = std::round(height);
+    Brush current = state_.set_brush;
+    std::shared_ptr<const SvgRaster> raster = svg.sharedRaster(raster_width, raster_height,
+                                                               state_.scale,
+                                                               state_.brush ? &current : nullptr);
+    if (raster == nullptr)
+      return false;
+
+    // The atlas entry holds the raster so replacing it on the Svg doesn't free pixels it still
+    // uploads from.
+    Image image(raster->pixels.data(), raster->pixels.size(), raster_width, raster_height);
+    image.raw = true;
+    image.owner = raster;
+    if (raster->uploaded_atlas != imageAtlas()) {
+      imageAtlas()->addImage(image, true);
+      raster->uploaded_atlas = imageAtlas();
+    }
+
+    setColor(0xffffffff);
+    addImage(image, pixels(x), pixels(y));
+    return true;
+  }
+
+  void Canvas::addPathStroke(const Path& path, float x, float y, float width, float height,
+                             float stroke_width, Path::Join join, Path::EndCap end_cap,
+                             DashPattern dash_array, float dash_offset, float miter_limit) {
+    const Path& outline = stroke_cache_.stroke(path, state_.scale, stroke_width, join, end_cap,
+                                               dash_array, dash_offset, miter_limit);
+    addPathFill(outline, x, y, width, height);
   }
 
   const Screenshot& Canvas::takeScreenshot() {
@@ -121,11 +607,33 @@ namespace visage {
     return composite_layer_.screenshot();
   }
 
+  void Canvas::takeScreenshotAsync(Layer::ScreenshotCallback callback) {
+    if (!composite_layer_.canReadBackAsync()) {
+      callback(takeScreenshot());
+      return;
+    }
+
+    while (!composite_layer_.requestScreenshotAsync(callback))
+      composite_layer_.finishReadBacks(Renderer::instance().frame());
+
+    default_region_.invalidate();
+    submit();
+  }
+
+  void Canvas::finishScreenshots() {
+    while (composite_layer_.readBacksPending())
+      composite_layer_.finishReadBacks(Renderer::instance().frame());
+  }
+
   void Canvas::ensureLayerExists(int layer) {
     int layers_to_add = layer + 1 - layers_.size();
     for (int i = 0; i < layers_to_add; ++i) {
-      intermediate_layers_.push_back(std::make_unique<Layer>(&gradient_atlas_));
+      intermediate_layers_.push_back(std::make_unique<Layer>(&resources_->gradient_atlas));
       intermediate_layers_.back()->setIntermediateLayer(true);
+      intermediate_layers_.back()->setWorkerPool(vertex_worker_pool_.get());
+      intermediate_layers_.back()->setInvalidRectCoalescing(invalid_rect_coalescing_);
+      intermediate_layers_.back()->setFrameBufferBucket(frame_buffer_bucket_);
+      intermediate_layers_.back()->setDebugDraw(debug_draw_);
       layers_.push_back(intermediate_layers_.back().get());
     }
   }
@@ -155,11 +663,25 @@ namespace visage {
     addToPackedLayer(region, to);
   }
 
+  void Canvas::setColor(theme::ColorId color_id) {
+    theme::OverrideId override_id;
+    int palette_index = paletteColorIndex(color_id, &override_id);
+    if (palette_index < 0) {
+      setBrush(color(color_id));
+      return;
+    }
+
+    state_.set_brush = palette_->colorIndex(palette_index);
+    state_.brush = state_.current_region->addPaletteBrush(gradientAtlas(), state_.set_brush,
+                                                          palette_, override_id, color_id,
+                                                          state_.scale);
+  }
+
   Brush Canvas::color(theme::ColorId color_id) {
     if (palette_) {
       Brush result;
       theme::OverrideId last_check;
-      for (auto it = state_memory_.rbegin(); it != state_memory_.rend(); ++it) {
+      for (auto it = savedStatesBegin(); it != state_memory_.rend(); ++it) {
         theme::OverrideId override_id = it->palette_override;
         if (override_id.id != last_check.id && palette_->color(override_id, color_id, result))
           return result;
@@ -172,11 +694,33 @@ namespace visage {
     return Brush::solid(theme::ColorId::defaultColor(color_id));
   }
 
+  int Canvas::paletteColorIndex(theme::ColorId color_id, theme::OverrideId* resolved_override) {
+    if (palette_ == nullptr)
+      return Palette::kNotSetId;
+
+    theme::OverrideId last_check;
+    for (auto it = savedStatesBegin(); it != state_memory_.rend(); ++it) {
+      theme::OverrideId override_id = it->palette_override;
+      if (override_id.id != last_check.id) {
+        int index = palette_->resolvedColorIndex(override_id, color_id);
+        if (index != Palette::kNotSetId) {
+          if (resolved_override)
+            *resolved_override = override_id;
+          return index;
+        }
+      }
+      last_check = override_id;
+    }
+    if (resolved_override)
+      *resolved_override = {};
+    return palette_->resolvedColorIndex({}, color_id);
+  }
+
   float Canvas::value(theme::ValueId value_id) {
     if (palette_) {
       float result = 0.0f;
       theme::OverrideId last_check;
-      for (auto it = state_memory_.rbegin(); it != state_memory_.rend(); ++it) {
+      for (auto it = savedStatesBegin(); it != state_memory_.rend(); ++it) {
         theme::OverrideId override_id = it->palette_override;
         if (override_id.id != last_check.id && palette_->value(override_id, value_id, result))
           return result;
@@ -251,5 +795,7 @@ namespace visage {
 
     for (Layer* layer : layers_)
       layer->setTime(time);
+
+    resources_->image_atlas.uploadDecodedImages(time);
   }
 }
@@ -21,16 +21,21 @@
 
 #pragma once
 
+#include "fetched_files.h"
 #include "font.h"
 #include "graphics_utils.h"
 #include "layer.h"
 #include "path.h"
+#include "polyline_stroker.h"
+#include "profiler.h"
 #include "region.h"
 #include "screenshot.h"
 #include "shape_batcher.h"
+#include "shape_list.h"
 #include "svg.h"
 #include "text.h"
 #include "theme.h"
+#include "tiled_image.h"
 #include "visage_utils/dimension.h"
 #include "visage_utils/space.h"
 #include "visage_utils/time_utils.h"
@@ -41,9 +46,33 @@ namespace visage {
   class Palette;
   class Shader;
 
+  // The atlases a canvas packs gradients, images, data and paths into. Canvases built from the
+  // same resources reuse each other's packed entries and textures instead of duplicating them.
+  struct CanvasResources {
+    // Shared by every canvas that asks for it and released with the last one, before the
+    // renderer goes away.
+    static std::shared_ptr<CanvasResources> shared();
+    // With a retain period the shared resources outlive their last canvas by that many
+    // milliseconds, so an editor that's closed and reopened finds its images, gradients and
+    // paths still packed. Expired resources are released on the next rendered frame.
+    static void setRetainPeriod(int ms);
+    static int retainPeriod();
+    static void releaseRetained();
+
+    GradientAtlas gradient_atlas;
+    PathAtlas path_atlas;
+    ImageAtlas image_atlas { ImageAtlas::DataType::RGBA8 };
+    ImageAtlas data_atlas { ImageAtlas::DataType::Float32 };
+    ImageAtlas half_data_atlas { ImageAtlas::DataType::Float16 };
+    ImageAtlas byte_data_atlas { ImageAtlas::DataType::UNorm8 };
+  };
+
   class Canvas {
   public:
     static constexpr float kDefaultSquirclePower = 4.0f;
+    static constexpr float kDefaultAnalyticPathArea = 0.0f;
+    // Graphs with more points than this per pixel are drawn from min/max decimated points.
+    static constexpr int kGraphPointsPerPixel = 2;
 
     static bool swapChainSupported();
 
@@ -51,6 +80,7 @@ namespace visage {
       float x = 0;
       float y = 0;
       float scale = 1.0f;
+      Transform transform;
       theme::OverrideId palette_override;
       Brush set_brush;
       const PackedBrush* brush = nullptr;
@@ -60,14 +90,48 @@ namespace visage {
     };
 
     Canvas();
+    explicit Canvas(std::shared_ptr<CanvasResources> resources);
     Canvas(const Canvas& other) = delete;
     Canvas& operator=(const Canvas&) = delete;
 
     void clearDrawnShapes();
     int submit(int submit_pass = 0);
+    // Renders windowless canvases into shared bgfx frames, each canvas using its own range of
+    // views, and starts a new frame only when the view limit would be exceeded. Share one
+    // CanvasResources between the canvases so atlases are uploaded once. Returns frames used.
+    static int submitWindowless(const std::vector<Canvas*>& canvases);
+    // Call while nothing is drawing. Copies up to max_moves images into compacted image atlas
+    // pages and renders a frame holding only those copies. Returns true while there's more to do.
+    bool defragmentAtlases(int max_moves);
+    FrameProfiler& profiler() { return profiler_; }
+    const FrameProfiler& profiler() const { return profiler_; }
+    // What the last submit sent to the renderer, recorded whether or not the profiler is enabled.
+    // Counts are the same with the Noop renderer, so tests can check batching without a GPU.
+    struct FrameStats {
+      int batch_submits = 0;
+      int region_batches = 0;
+      int draw_calls = 0;
+      long long vertices = 0;
+    };
+    const FrameStats& frameStats() const { return frame_stats_; }
+    static int maxViews();
+    int viewsUsed() const { return views_used_; }
+    int peakViewsUsed() const { return peak_views_used_; }
+    // Most views the next submit can use given the current layers, backdrops and post effects.
+    // submitWindowless() reserves this much before adding a canvas to a frame.
+    int maxSubmitViews();
+    // Window pixels that changed in the last presented frame, empty when nothing was presented.
+    // Partial-present swap chains can limit their dirty rects to these.
+    const std::vector<IBounds>& presentDamage() const { return present_damage_; }
 
     const Screenshot& takeScreenshot();
     const Screenshot& screenshot() const;
+    // Captures the next frame without stalling on the GPU when rendering windowless, so captures
+    // can be pipelined. The callback runs from a later submit() once the pixels arrive and must
+    // copy anything it keeps. Other canvases fall back to takeScreenshot().
+    void takeScreenshotAsync(Layer::ScreenshotCallback callback);
+    bool screenshotsPending() const { return composite_layer_.readBacksPending(); }
+    void finishScreenshots();
 
     void ensureLayerExists(int layer);
     Layer* layer(int index) {
@@ -98,6 +162,45 @@ namespace visage {
 
     float dpiScale() const { return dpi_scale_; }
     void updateTime(double time);
+
+    void setInvalidRectCoalescing(const InvalidRectCoalescing& coalescing);
+    // Rounds intermediate layer sizes up to multiples of _bucket_ pixels, see
+    // Layer::setFrameBufferBucket().
+    void setFrameBufferBucket(int bucket);
+    int frameBufferBucket() const { return frame_buffer_bucket_; }
+    // Draws a debug view over everything the layers redraw, see DebugDraw for the modes.
+    void setDebugDraw(DebugDraw debug_draw);
+    DebugDraw debugDraw() const { return debug_draw_; }
+    void setVertexThreads(int num_threads);
+    int vertexThreads() const { return vertex_worker_pool_ ? vertex_worker_pool_->numThreads() : 0; }
+    // Path fills covering at least this many native pixels are drawn as analytic coverage strips
+    // instead of through the path atlas, 256 * 256 is a good starting point. Strips are placed
+    // from the path's own bounds, so a path spilling out of the width and height given to fill()
+    // is drawn in full, and a region clip is still needed to cut it. Zero, the default, disables.
+    void setAnalyticPathArea(float area) { analytic_path_area_ = area; }
+    float analyticPathArea() const { return analytic_path_area_; }
+    // Draws rectangles, circles, squircles, diamonds and arcs with one shared program so mixed
+    // primitives don't split into a batch per shape type. Each pixel pays for the type branch.
+    void setSdfPrimitiveBatching(bool batching) { sdf_primitive_batching_ = batching; }
+    bool sdfPrimitiveBatching() const { return sdf_primitive_batching_; }
+    // Rectangle shadows draw as nine slices of a cached mask in the image atlas instead of
+    // evaluating the falloff per pixel. Arc shadows and shadows too small to slice stay analytic.
+    void setCachedShadows(bool cached) { cached_shadows_ = cached; }
+    bool cachedShadows() const { return cached_shadows_; }
+    const ShadowCache& shadowCache() const { return shadow_cache_; }
+    // Images are decoded off the drawing thread and skipped until ready, then fade in over
+    // fade_seconds. Frames drawing images should keep redrawing while imagesLoading(), which
+    // also covers fetched image and svg files that are still downloading.
+    void setAsyncImageDecoding(bool async, float fade_seconds = 0.0f) {
+      resources_->image_atlas.setAsyncDecoding(async);
+      image_fade_seconds_ = fade_seconds;
+    }
+    bool asyncImageDecoding() const { return resources_->image_atlas.asyncDecoding(); }
+    bool imagesLoading() const {
+      return resources_->image_atlas.decoding() || FetchedFiles::fetching() ||
+             (resources_->image_atlas.lastDecodedTime() >= 0.0 &&
+              render_time_ < resources_->image_atlas.lastDecodedTime() + image_fade_seconds_);
+    }
     double time() const { return render_time_; }
     double deltaTime() const { return delta_time_; }
     int frameCount() const { return render_frame_; }
@@ -107,13 +210,24 @@ namespace visage {
     const Brush& brush() { return state_.set_brush; }
     void setBrush(const Brush& brush) {
       state_.set_brush = brush;
-      state_.brush = state_.current_region->addBrush(&gradient_atlas_, brush.gradient(),
+      state_.brush = state_.current_region->addBrush(gradientAtlas(), brush.gradient(),
                                                      brush.position() * state_.scale);
     }
+    // Draws with a GradientSlot, which animated brushes update in place without new atlas entries.
+    void setBrush(GradientSlot& slot, const GradientPosition& position) {
+      state_.set_brush = Brush(slot.gradient(), position);
+      state_.brush = state_.current_region->addBrush(gradientAtlas(), slot, position * state_.scale);
+    }
+    // Sets a solid color in place of the current brush, so it doesn't allocate a new gradient.
+    void setSolidColor(const Color& color) {
+      state_.set_brush.setSolid(color);
+      state_.brush = state_.current_region->addBrush(gradientAtlas(), state_.set_brush.gradient(),
+                                                     state_.set_brush.position() * state_.scale);
+    }
     void setColor(const Brush& brush) { setBrush(brush); }
-    void setColor(unsigned int color) { setBrush(Brush::solid(color)); }
-    void setColor(const Color& color) { setBrush(Brush::solid(color)); }
-    void setColor(theme::ColorId color_id) { setBrush(color(color_id)); }
+    void setColor(unsigned int color) { setSolidColor(color); }
+    void setColor(const Color& color) { setSolidColor(color); }
+    void setColor(theme::ColorId color_id);
 
     void setBlendedColor(theme::ColorId color_from, theme::ColorId color_to, float t) {
       setBrush(blendedColor(color_from, color_to, t));
@@ -130,12 +244,25 @@ namespace visage {
       float fill_y = pixels(y);
       float fill_w = pixels(width);
       float fill_h = pixels(height);
+      if (hasTransform()) {
+        Path path;
+        path.addRectangle(fill_x, fill_y, fill_w, fill_h);
+        addTransformedPath(path);
+        return;
+      }
       addShape(Fill(state_.clamp.clamp(fill_x, fill_y, fill_w, fill_h), state_.brush,
                     state_.x + fill_x, state_.y + fill_y, fill_w, fill_h));
     }
 
     template<typename T1, typename T2, typename T3>
     void circle(const T1& x, const T2& y, const T3& width) {
+      if (hasTransform()) {
+        float radius = 0.5f * pixels(width);
+        Path path;
+        path.addCircle(pixels(x) + radius, pixels(y) + radius, radius);
+        addTransformedPath(path);
+        return;
+      }
       addShape(Circle(state_.clamp, state_.brush, state_.x + pixels(x), state_.y + pixels(y),
                       pixels(width)));
     }
@@ -230,6 +357,18 @@ namespace visage {
       addSegment(pixels(a_x), pixels(a_y), pixels(b_x), pixels(b_y), pixels(thickness), rounded);
     }
 
+    // Opaque brushes draw a quad per segment, overlapping at the joins. Translucent brushes and
+    // other blend modes stroke one outline so the joins aren't blended twice.
+    template<typename T>
+    void polyline(const Point* points, int num_points, const T& thickness) {
+      addPolyline(points, num_points, pixels(thickness));
+    }
+
+    template<typename T>
+    void polyline(const std::vector<Point>& points, const T& thickness) {
+      polyline(points.data(), static_cast<int>(points.size()), thickness);
+    }
+
     template<typename T1, typename T2, typename T3, typename T4, typename T5, typename T6, typename T7>
     void quadratic(const T1& a_x, const T2& a_y, const T3& b_x, const T4& b_y, const T5& c_x,
                    const T6& c_y, const T7& thickness) {
@@ -239,10 +378,20 @@ namespace visage {
 
     template<typename T1, typename T2, typename T3, typename T4>
     void rectangle(const T1& x, const T2& y, const T3& width, const T4& height) {
+      if (hasTransform()) {
+        Path path;
+        path.addRectangle(pixels(x), pixels(y), pixels(width), pixels(height));
+        addTransformedPath(path);
+        return;
+      }
       addShape(Rectangle(state_.clamp, state_.brush, state_.x + pixels(x), state_.y + pixels(y),
                          pixels(width), pixels(height)));
     }
 
+    // Draws num_bars rectangles at once from extents packed as left, top, right, bottom per bar.
+    // Bars use the current brush, or colors[i] when colors is given.
+    void bars(const float* extents, int num_bars, const Color* colors = nullptr);
+
     template<typename T1, typename T2, typename T3, typename T4, typename T5>
     void rectangleBorder(const T1& x, const T2& y, const T3& width, const T4& height, const T5& thickness) {
       Rectangle border(state_.clamp, state_.brush, state_.x + pixels(x), state_.y + pixels(y),
@@ -253,10 +402,31 @@ namespace visage {
 
     template<typename T1, typename T2, typename T3, typename T4, typename T5>
     void roundedRectangle(const T1& x, const T2& y, const T3& width, const T4& height, const T5& rounding) {
+      if (hasTransform()) {
+        Path path;
+        path.addRoundedRectangle(pixels(x), pixels(y), pixels(width), pixels(height),
+                                 pixels(rounding));
+        addTransformedPath(path);
+        return;
+      }
       addShape(RoundedRectangle(state_.clamp, state_.brush, state_.x + pixels(x), state_.y + pixels(y),
                                 pixels(width), pixels(height), std::max(1.0f, pixels(rounding))));
     }
 
+    template<typename T1, typename T2, typename T3, typename T4>
+    void hueRectangle(const T1& x, const T2& y, const T3& width, const T4& height) {
+      addShape(HsvRectangle(state_.clamp, state_.brush, state_.x + pixels(x), state_.y + pixels(y),
+                            pixels(width), pixels(height), -1.0f));
+    }
+
+    template<typename T1, typename T2, typename T3, typename T4>
+    void saturationValueRectangle(const T1& x, const T2& y, const T3& width, const T4& height,
+                                  float hue) {
+      float normalized_hue = std::fmod(std::max(0.0f, hue), Color::kHueRange) / Color::kHueRange;
+      addShape(HsvRectangle(state_.clamp, state_.brush, state_.x + pixels(x), state_.y + pixels(y),
+                            pixels(width), pixels(height), normalized_hue));
+    }
+
     template<typename T1, typename T2, typename T3, typename T4>
     void diamond(const T1& x, const T2& y, const T3& width, const T4& rounding) {
       float w = pixels(width);
@@ -296,10 +466,17 @@ namespace visage {
     void roundedRectangleShadow(const T1& x, const T2& y, const T3& width, const T4& height,
                                 const T5& rounding, const T6& shadow_width) {
       float pixel_width = std::max(1.0f, pixels(shadow_width));
-      addShape(RoundedRectangle(state_.clamp, state_.brush, state_.x + pixels(x) - 0.5f * pixel_width,
-                                state_.y + pixels(y) - 0.5f * pixel_width,
-                                pixels(width) + pixel_width, pixels(height) + pixel_width,
-                                std::max(1.0f, pixels(rounding) + 0.5f * pixel_width), pixel_width));
+      float shadow_x = state_.x + pixels(x) - 0.5f * pixel_width;
+      float shadow_y = state_.y + pixels(y) - 0.5f * pixel_width;
+      float shadow_w = pixels(width) + pixel_width;
+      float shadow_h = pixels(height) + pixel_width;
+      float shadow_rounding = std::max(1.0f, pixels(rounding) + 0.5f * pixel_width);
+      if (cached_shadows_ &&
+          addCachedShadow(shadow_x, shadow_y, shadow_w, shadow_h, shadow_rounding, pixel_width))
+        return;
+
+      addShape(RoundedRectangle(state_.clamp, state_.brush, shadow_x, shadow_y, shadow_w, shadow_h,
+                                shadow_rounding, pixel_width));
     }
 
     template<typename T1, typename T2, typename T3, typename T4, typename T5, typename T6>
@@ -378,6 +555,11 @@ namespace visage {
       TextBlock text_block(state_.clamp, state_.brush, state_.x + pixels(x), state_.y + pixels(y),
                            pixels(width), pixels(height), text,
                            text->font().withDpiScale(state_.scale), dir);
+      for (const TextStyle& style : text->styles()) {
+        GradientPosition position = style.brush.position() * state_.scale;
+        text_block.style_brushes.push_back(
+            state_.current_region->addBrush(gradientAtlas(), style.brush.gradient(), position));
+      }
       addShape(std::move(text_block));
     }
 
@@ -403,16 +585,19 @@ namespace visage {
     template<typename T1, typename T2, typename T3, typename T4>
     void svg(const unsigned char* svg_data, int svg_size, const T1& x, const T2& y, const T3& width,
              const T4& height) {
-      Svg new_svg(svg_data, svg_size);
-      new_svg.setDimensions(pixels(width) / state_.scale, pixels(height) / state_.scale, state_.scale);
-      new_svg.setFillBrush(state_.set_brush);
-      new_svg.setStrokeBrush(state_.set_brush);
-      svg(new_svg, x, y, width, height);
+      int svg_width = pixels(width) / state_.scale;
+      int svg_height = pixels(height) / state_.scale;
+      std::shared_ptr<const Svg> cached = SvgCache::instance().svg(svg_data, svg_size, svg_width,
+                                                                   svg_height, state_.scale,
+                                                                   state_.set_brush);
+      svg(*cached, x, y, width, height);
     }
 
     template<typename T1, typename T2, typename T3, typename T4>
     void svg(const EmbeddedFile& file, const T1& x, const T2& y, const T3& width, const T4& height) {
-      svg(file.data, file.size, x, y, width, height);
+      EmbeddedFile resolved = FetchedFiles::resolve(file);
+      if (resolved.data)
+        svg(resolved.data, resolved.size, x, y, width, height);
     }
 
     template<typename T1, typename T2, typename T3, typename T4, typename T5>
@@ -439,7 +624,9 @@ namespace visage {
     void image(const Image& image, const T1& x, const T2& y) {
       int w = std::round(pixels(image.width));
       int h = std::round(pixels(image.height));
-      addImage({ image.data, image.data_size, w, h }, pixels(x), pixels(y));
+      Image scaled(image.data, image.data_size, w, h);
+      scaled.mipmapped = image.mipmapped;
+      addImage(scaled, pixels(x), pixels(y));
     }
 
     template<typename T1, typename T2, typename T3, typename T4>
@@ -452,7 +639,17 @@ namespace visage {
 
     template<typename T1, typename T2, typename T3, typename T4>
     void image(const EmbeddedFile& image_file, const T1& x, const T2& y, const T3& width, const T4& height) {
-      image(image_file.data, image_file.size, x, y, width, height);
+      EmbeddedFile resolved = FetchedFiles::resolve(image_file);
+      if (resolved.data)
+        image(resolved.data, resolved.size, x, y, width, height);
+    }
+
+    // Draws a TiledImage scaled into the rect. Only tiles inside the current clip are decoded
+    // and uploaded, at the level matching the drawn size. Keep redrawing while image.loading().
+    template<typename T1, typename T2, typename T3, typename T4>
+    void tiledImage(TiledImage& image, const T1& x, const T2& y, const T3& width,
+                    const T4& height) {
+      addTiledImage(image, pixels(x), pixels(y), pixels(width), pixels(height));
     }
 
     template<typename T1, typename T2, typename T3, typename T4>
@@ -461,13 +658,25 @@ namespace visage {
                              pixels(width), pixels(height), shader));
     }
 
+    // Draws a retained ShapeList, recording it first if it's stale. Lists only move and clip, so
+    // the current transform and brush don't apply to them.
+    template<typename T1, typename T2>
+    void shapeList(ShapeList& list, const T1& x, const T2& y) {
+      list.record(*this);
+      addShape(ShapeListWrapper(state_.clamp, state_.x + pixels(x), state_.y + pixels(y),
+                                list.nativeWidth(), list.nativeHeight(), &list));
+    }
+
     template<typename T1, typename T2, typename T3, typename T4>
     void fill(const Path& path, const T1& x, const T2& y, const T3& width, const T4& height) {
       if (path.numPoints() == 0)
         return;
 
-      addShape(PathFillWrapper(state_.clamp, state_.brush, state_.x + pixels(x), state_.y + pixels(y),
-                               pixels(width), pixels(height), path, pathAtlas(), state_.scale));
+      if (hasTransform()) {
+        addTransformedPath(path.transformed(nativeTransform(pixels(x), pixels(y))));
+        return;
+      }
+      addPathFill(path, state_.x + pixels(x), state_.y + pixels(y), pixels(width), pixels(height));
     }
 
     template<typename T1, typename T2>
@@ -475,11 +684,14 @@ namespace visage {
       if (path.numPoints() == 0)
         return;
 
+      if (hasTransform()) {
+        addTransformedPath(path.transformed(nativeTransform(pixels(x), pixels(y))));
+        return;
+      }
+
       auto bounding_box = path.boundingBox();
-      addShape(PathFillWrapper(state_.clamp, state_.brush, state_.x + pixels(x),
-                               state_.y + pixels(y), bounding_box.right() * state_.scale + 1.0f,
-                               bounding_box.bottom() * state_.scale + 1.0f, path, pathAtlas(),
-                               state_.scale));
+      addPathFill(path, state_.x + pixels(x), state_.y + pixels(y),
+                  bounding_box.right() * state_.scale + 1.0f, bounding_box.bottom() * state_.scale + 1.0f);
     }
 
     void fill(const Path& path) { fill(path, 0, 0); }
@@ -487,26 +699,37 @@ namespace visage {
     template<typename T1, typename T2, typename T3, typename T4, typename T5>
     void stroke(const Path& path, const T1& x, const T2& y, const T3& width, const T4& height,
                 const T5& stroke_width, Path::Join join = Path::Join::Round,
-                Path::EndCap end_cap = Path::EndCap::Round, std::vector<float> dash_array = {},
+                Path::EndCap end_cap = Path::EndCap::Round, DashPattern dash_array = {},
                 float dash_offset = 0.0f, float miter_limit = Path::kDefaultMiterLimit) {
       if (path.numPoints() == 0)
         return;
 
-      addShape(PathFillWrapper(state_.clamp, state_.brush, state_.x + pixels(x),
-                               state_.y + pixels(y), pixels(width), pixels(height),
-                               path.stroke(pixels(stroke_width), join, end_cap, dash_array,
-                                           dash_offset, miter_limit),
-                               state_.scale));
+      if (hasTransform()) {
+        Path native_path = path.transformed(nativeTransform(pixels(x), pixels(y)));
+        if (native_path.numCurves())
+          native_path = native_path.flattened(1.0f);
+        addTransformedPath(native_path.stroke(pixels(stroke_width), join, end_cap,
+                                              dash_array.toVector(), dash_offset, miter_limit));
+        return;
+      }
+      addPathStroke(path, state_.x + pixels(x), state_.y + pixels(y), pixels(width), pixels(height),
+                    pixels(stroke_width), join, end_cap, dash_array, dash_offset, miter_limit);
     }
 
-    void saveState() { state_memory_.push_back(state_); }
+    // Saved states stay allocated after they're restored, so the brush storage in them is
+    // reused by the next save instead of copied into a fresh state.
+    void saveState() {
+      if (num_saved_states_ == state_memory_.size())
+        state_memory_.push_back(state_);
+      else
+        state_memory_[num_saved_states_] = state_;
+      num_saved_states_++;
+    }
 
     void restoreState() {
-      VISAGE_ASSERT(!state_memory_.empty());
-      if (!state_memory_.empty()) {
-        state_ = state_memory_.back();
-        state_memory_.pop_back();
-      }
+      VISAGE_ASSERT(num_saved_states_ > 0);
+      if (num_saved_states_ > 0)
+        state_ = state_memory_[--num_saved_states_];
     }
 
     void setPosition(float x, float y) {
@@ -514,6 +737,18 @@ namespace visage {
       state_.y += y * state_.scale;
     }
 
+    // Affine transform in logical units, applied about the current position and kept with the
+    // saved state. Paths, fills, rectangles, rounded rectangles and circles follow it; other
+    // primitives are drawn untransformed.
+    void setTransform(const Transform& transform) { state_.transform = transform; }
+    void applyTransform(const Transform& transform) {
+      state_.transform = state_.transform * transform;
+    }
+    void rotate(float degrees) { applyTransform(Transform::rotation(degrees)); }
+    void resetTransform() { state_.transform = Transform::identity(); }
+    const Transform& transform() const { return state_.transform; }
+    bool hasTransform() const { return !state_.transform.isIdentity(); }
+
     void addRegion(Region* region) {
       default_region_.addRegion(region);
       region->setCanvas(this);
@@ -524,6 +759,7 @@ namespace visage {
       saveState();
       state_.x = 0;
       state_.y = 0;
+      state_.transform = Transform::identity();
       setLogicalPixelScale();
       state_.brush = nullptr;
       state_.blend_mode = BlendMode::Alpha;
@@ -533,6 +769,27 @@ namespace visage {
 
     void endRegion() { restoreState(); }
 
+    // Marks the current region's stencil clip for regions set to Region::setStencilClip. Call
+    // right after beginRegion, before anything else is drawn into the region.
+    template<typename T1, typename T2, typename T3, typename T4, typename T5>
+    void stencilClipRoundedRectangle(const T1& x, const T2& y, const T3& width, const T4& height,
+                                     const T5& rounding) {
+      addStencilClip(RoundedRectangle(state_.clamp, stencilBrush(), state_.x + pixels(x),
+                                      state_.y + pixels(y), pixels(width), pixels(height),
+                                      std::max(1.0f, pixels(rounding))));
+    }
+
+    void stencilClipPath(const Path& path) {
+      if (path.numPoints() == 0)
+        return;
+
+      auto bounding_box = path.boundingBox();
+      addStencilClip(PathFillWrapper(state_.clamp, stencilBrush(), state_.x, state_.y,
+                                     bounding_box.right() * state_.scale + 1.0f,
+                                     bounding_box.bottom() * state_.scale + 1.0f, path,
+                                     pathAtlas(), state_.scale));
+    }
+
     void setPalette(Palette* palette) { palette_ = palette; }
     void setPaletteOverride(theme::OverrideId override_id) {
       state_.palette_override = override_id;
@@ -556,6 +813,7 @@ namespace visage {
     bool totallyClamped() const { return state_.clamp.totallyClamped(); }
 
     Brush color(theme::ColorId color_id);
+    int paletteColorIndex(theme::ColorId color_id, theme::OverrideId* resolved_override = nullptr);
     Brush blendedColor(theme::ColorId color_from, theme::ColorId color_to, float t) {
       return color(color_from).interpolateWith(color(color_to), t);
     }
@@ -563,14 +821,25 @@ namespace visage {
     float value(theme::ValueId value_id);
     std::vector<std::string> debugInfo() const;
 
-    PathAtlas* pathAtlas() { return &path_atlas_; }
-    ImageAtlas* imageAtlas() { return &image_atlas_; }
-    ImageAtlas* dataAtlas() { return &data_atlas_; }
-    GradientAtlas* gradientAtlas() { return &gradient_atlas_; }
+    PathAtlas* pathAtlas() { return &resources_->path_atlas; }
+    ImageAtlas* imageAtlas() { return &resources_->image_atlas; }
+    ImageAtlas* dataAtlas(DataPrecision precision = DataPrecision::Float32) {
+      if (precision == DataPrecision::Float16)
+        return &resources_->half_data_atlas;
+      if (precision == DataPrecision::UNorm8)
+        return &resources_->byte_data_atlas;
+      return &resources_->data_atlas;
+    }
+    GradientAtlas* gradientAtlas() { return &resources_->gradient_atlas; }
+    const std::shared_ptr<CanvasResources>& resources() const { return resources_; }
 
     State* state() { return &state_; }
 
   private:
+    int submitLayers(int submit_pass);
+    void finishSubmit(int submit_pass, int submission);
+    void finishFrame(uint32_t frame, bool rendered);
+    static void nextFrame(bool rendered);
     void setClampBounds(const ClampBounds& bounds) { state_.clamp = bounds; }
 
     template<typename T>
@@ -584,9 +853,51 @@ namespace visage {
 
     template<typename T>
     void addShape(T shape) {
+      if constexpr (SdfPrimitiveSupport<T>::kSupported) {
+        if (sdf_primitive_batching_) {
+          state_.current_region->shape_batcher_.addShape(SdfPrimitive(shape), state_.blend_mode);
+          return;
+        }
+      }
       state_.current_region->shape_batcher_.addShape(std::move(shape), state_.blend_mode);
     }
 
+    const PackedBrush* stencilBrush() {
+      return state_.current_region->addBrush(gradientAtlas(), Brush::solid(0xffffffff));
+    }
+
+    // The clear resets the region's area to its parent's clip before the shape marks its own.
+    template<typename T>
+    void addStencilClip(T shape) {
+      Region* region = state_.current_region;
+      Fill clear(state_.clamp, shape.brush, 0.0f, 0.0f, region->width(), region->height());
+      region->shape_batcher_.appendShape(clear, BlendMode::StencilClear);
+      region->shape_batcher_.appendShape(std::move(shape), BlendMode::StencilClip);
+    }
+
+    void addPathFill(const Path& path, float x, float y, float width, float height) {
+      Bounds bounding_box = path.boundingBox();
+      float area = bounding_box.width() * bounding_box.height() * state_.scale * state_.scale;
+      if (analytic_path_area_ > 0.0f && area >= analytic_path_area_)
+        addPathStrips(path, x, y);
+      else
+        addShape(PathFillWrapper(state_.clamp, state_.brush, x, y, width, height, path, pathAtlas(),
+                                 state_.scale));
+    }
+
+    Transform nativeTransform(float x, float y) const {
+      return Transform::translation(x, y) * Transform::scale(state_.scale, state_.scale);
+    }
+
+    bool addCachedShadow(float x, float y, float width, float height, float rounding,
+                         float shadow_width);
+    void addTiledImage(TiledImage& image, float x, float y, float width, float height);
+    void addTransformedPath(const Path& path);
+    void addPathStrips(const Path& path, float x, float y);
+    void addPathStroke(const Path& path, float x, float y, float width, float height,
+                       float stroke_width, Path::Join join, Path::EndCap end_cap,
+                       DashPattern dash_array, float dash_offset, float miter_limit);
+
     void addSegment(float a_x, float a_y, float b_x, float b_y, float thickness,
                     bool rounded = false, float pixel_width = 1.0f) {
       if (thickness <= 0.0f)
@@ -612,6 +923,8 @@ namespace visage {
       }
     }
 
+    void addPolyline(const Point* points, int num_points, float thickness);
+
     void addQuadratic(float a_x, float a_y, float b_x, float b_y, float c_x, float c_y,
                       float thickness, float pixel_width = 1.0f) {
       if (thickness <= 0.0f)
@@ -770,32 +1083,63 @@ namespace visage {
     }
 
     void addSvg(const Svg& svg, float x, float y, float width, float height) {
-      SvgDrawable::ColorContext context;
+      if (svg.rasterized() && addSvgRaster(svg, x, y, width, height))
+        return;
+
+      const SvgDrawList* draw_list = svg.drawList();
+      if (draw_list == nullptr)
+        return;
+
       if (state_.brush) {
         Brush current = state_.set_brush;
-        context.current_color = &current;
+        draw_list->draw(*this, &current, x, y, width, height);
       }
-      svg.drawable()->drawAll(*this, &context, x, y, width, height);
+      else
+        draw_list->draw(*this, nullptr, x, y, width, height);
     }
 
+    bool addSvgRaster(const Svg& svg, float x, float y, float width, float height);
+
     void addImage(const Image& image, float x, float y) {
-      addShape(ImageWrapper(state_.clamp, state_.brush, state_.x + x, state_.y + y, image.width,
-                            image.height, image, imageAtlas()));
+      ImageWrapper wrapper(state_.clamp, state_.brush, state_.x + x, state_.y + y, image.width,
+                           image.height, image, imageAtlas());
+      if (wrapper.packed_image.loading())
+        return;
+
+      double decoded_time = wrapper.packed_image.decodedTime();
+      if (image_fade_seconds_ <= 0.0f || decoded_time < 0.0 ||
+          render_time_ >= decoded_time + image_fade_seconds_) {
+        addShape(std::move(wrapper));
+        return;
+      }
+
+      float fade = (render_time_ - decoded_time) / image_fade_seconds_;
+      saveState();
+      setBrush((state_.brush ? state_.set_brush : Brush::solid(0xffffffff)).withMultipliedAlpha(fade));
+      wrapper.brush = state_.brush;
+      addShape(std::move(wrapper));
+      restoreState();
     }
 
     void addGraphLine(const GraphData& data, float x, float y, float width, float height, float thickness) {
+      const GraphData& points = data.decimated(std::ceil(kGraphPointsPerPixel * width));
       addShape(GraphLineWrapper(state_.clamp, state_.brush, state_.x + x, state_.y + y, width,
-                                height, thickness, data, dataAtlas()));
+                                height, thickness, points, dataAtlas(data.precision())));
     }
 
     void addGraphFill(const GraphData& data, float x, float y, float width, float height, float center) {
+      const GraphData& points = data.decimated(std::ceil(kGraphPointsPerPixel * width));
       addShape(GraphFillWrapper(state_.clamp, state_.brush, state_.x + x, state_.y + y, width,
-                                height, center, data, dataAtlas()));
+                                height, center, points, dataAtlas(data.precision())));
     }
 
     void addHeatMap(const HeatMapData& data, float x, float y, float width, float height) {
       addShape(HeatMapWrapper(state_.clamp, state_.brush, state_.x + x, state_.y + y, width, height,
-                              data, dataAtlas()));
+                              data, dataAtlas(data.precision())));
+    }
+
+    std::vector<State>::reverse_iterator savedStatesBegin() {
+      return state_memory_.rbegin() + (state_memory_.size() - num_saved_states_);
     }
 
     Palette* palette_ = nullptr;
@@ -806,18 +1150,34 @@ namespace visage {
     int last_skipped_frame_ = 0;
 
     std::vector<State> state_memory_;
+    int num_saved_states_ = 0;
     State state_;
 
-    GradientAtlas gradient_atlas_;
-    PathAtlas path_atlas_;
-    ImageAtlas image_atlas_;
-    ImageAtlas data_atlas_;
+    std::shared_ptr<CanvasResources> resources_;
+    StrokeCache stroke_cache_;
+    ShadowCache shadow_cache_;
+    std::vector<Rectangle> bar_shapes_;
+    std::vector<ImageWrapper> image_slices_;
+    std::vector<TiledImage::TileDraw> tile_draws_;
 
     Region window_region_;
     Region default_region_;
     Layer composite_layer_;
     std::vector<std::unique_ptr<Layer>> intermediate_layers_;
     std::vector<Layer*> layers_;
+    std::unique_ptr<WorkerPool> vertex_worker_pool_;
+    InvalidRectCoalescing invalid_rect_coalescing_;
+    int frame_buffer_bucket_ = 0;
+    DebugDraw debug_draw_ = DebugDraw::None;
+    float analytic_path_area_ = kDefaultAnalyticPathArea;
+    bool sdf_primitive_batching_ = false;
+    bool cached_shadows_ = false;
+    float image_fade_seconds_ = 0.0f;
+    FrameProfiler profiler_;
+    FrameStats frame_stats_;
+    int views_used_ = 0;
+    int peak_views_used_ = 0;
+    std::vector<IBounds> present_damage_;
 
     float refresh_time_ = 0.0f;
 
@@ -21,6 +21,8 @@
 
 #include "color.h"
 
+#include "visage_utils/binary_data.h"
+
 #include <iomanip>
 #include <sstream>
 
@@ -51,4 +53,16 @@ namespace visage {
 
     stream >> hdr_;
   }
-}
\ No newline at end of file
+
+  void Color::encodeBinary(BinaryWriter& writer) const {
+    for (auto value : values_)
+      writer.write(value);
+    writer.write(hdr_);
+  }
+
+  bool Color::decodeBinary(BinaryReader& reader) {
+    for (auto& value : values_)
+      reader.read(value);
+    return reader.read(hdr_);
+  }
+}
@@ -30,6 +30,9 @@
 #include <string>
 
 namespace visage {
+  class BinaryReader;
+  class BinaryWriter;
+
   class Color {
   public:
     enum {
@@ -130,23 +133,51 @@ namespace visage {
       if (color_string.empty())
         return 0;
 
-      std::string hex = color_string[0] == '#' ? color_string.substr(1) : color_string;
-      if (hex.size() == 3)
-        hex = std::string("ff") + hex[0] + hex[0] + hex[1] + hex[1] + hex[2] + hex[2];
-      else if (hex.size() == 4)
-        hex = std::string() + hex[0] + hex[0] + hex[1] + hex[1] + hex[2] + hex[2] + hex[3] + hex[3];
-      else if (hex.size() == 6)
-        hex = "ff" + hex;
-      else if (hex.size() != 8)
-        return {};
-      try {
-        return fromARGB(std::stoul(hex, nullptr, 16));
+      const char* hex = color_string.c_str();
+      int length = color_string.size();
+      if (hex[0] == '#') {
+        hex++;
+        length--;
       }
-      catch (...) {
+
+      if (length != 3 && length != 4 && length != 6 && length != 8)
         return {};
+
+      bool short_form = length <= 4;
+      int digits = short_form ? length : length / 2;
+      unsigned int argb = digits == 3 ? 0xff : 0;
+      for (int i = 0; i < digits; ++i) {
+        int high = hexDigitValue(hex[short_form ? i : 2 * i]);
+        int low = hexDigitValue(hex[short_form ? i : 2 * i + 1]);
+        if (high < 0 || low < 0)
+          return {};
+        argb = (argb << kBitsPerColor) | (high << 4) | low;
+      }
+      return fromARGB(argb);
+    }
+
+    static void interpolate(const Color* from, const Color* to, Color* results, int count,
+                            float t) {
+      for (int i = 0; i < count; ++i) {
+        for (int c = 0; c < kNumChannels; ++c)
+          results[i].values_[c] = from[i].values_[c] + (to[i].values_[c] - from[i].values_[c]) * t;
+        results[i].hdr_ = from[i].hdr_ + (to[i].hdr_ - from[i].hdr_) * t;
+      }
+    }
+
+    static void multiply(const Color* a, const Color* b, Color* results, int count) {
+      for (int i = 0; i < count; ++i) {
+        for (int c = 0; c < kNumChannels; ++c)
+          results[i].values_[c] = a[i].values_[c] * b[i].values_[c];
+        results[i].hdr_ = a[i].hdr_ * b[i].hdr_;
       }
     }
 
+    static void toABGR16F(const Color* colors, uint64_t* results, int count) {
+      for (int i = 0; i < count; ++i)
+        results[i] = colors[i].toABGR16F();
+    }
+
     Color() = default;
     Color(float alpha, float red, float green, float blue, float hdr = 1.0f) {
       values_[kAlpha] = alpha;
@@ -324,6 +355,17 @@ namespace visage {
              hdr_ == other.hdr_;
     }
 
+    uint64_t hash() const {
+      uint64_t result = 0xcbf29ce484222325ull;
+      for (int i = 0; i <= kNumChannels; ++i) {
+        float value = (i < kNumChannels ? values_[i] : hdr_) + 0.0f;
+        uint32_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(bits));
+        result = (result ^ bits) * 0x100000001b3ull;
+      }
+      return result;
+    }
+
     bool operator<(const Color& other) const { return compare(*this, other) < 0; }
     bool operator>(const Color& other) const { return compare(*this, other) > 0; }
 
@@ -331,6 +373,8 @@ namespace visage {
     void encode(std::ostringstream& stream) const;
     void decode(const std::string& data);
     void decode(std::istringstream& stream);
+    void encodeBinary(BinaryWriter& writer) const;
+    bool decodeBinary(BinaryReader& reader);
 
     Color interpolateWith(const Color& other, float t) const {
       Color result;
@@ -391,6 +435,16 @@ namespace visage {
       return sign;  // Underflow to zero
     }
 
+    static int hexDigitValue(char digit) {
+      if (digit >= '0' && digit <= '9')
+        return digit - '0';
+      if (digit >= 'a' && digit <= 'f')
+        return digit - 'a' + 10;
+      if (digit >= 'A' && digit <= 'F')
+        return digit - 'A' + 10;
+      return -1;
+    }
+
     static char hexCharacter(int value) {
       if (value < 10)
         return '0' + value;
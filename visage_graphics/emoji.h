@@ -22,10 +22,17 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 
 namespace visage {
   class EmojiRasterizerImpl;
 
+  struct EmojiPlacement {
+    char32_t emoji = 0;
+    int x = 0;
+    int y = 0;
+  };
+
   class EmojiRasterizer {
   public:
     static EmojiRasterizer& instance() {
@@ -34,7 +41,13 @@ namespace visage {
     }
 
     void drawIntoBuffer(char32_t emoji, int font_size, int write_width, unsigned int* dest,
-                        int dest_width, int x, int y);
+                        int dest_width, int x, int y) {
+      drawIntoBuffer({ { emoji, x, y } }, font_size, write_width, dest, dest_width);
+    }
+
+    // Draws every emoji at the same size, setting up the platform drawing context once.
+    void drawIntoBuffer(const std::vector<EmojiPlacement>& emojis, int font_size, int write_width,
+                        unsigned int* dest, int dest_width);
 
   private:
     EmojiRasterizer();
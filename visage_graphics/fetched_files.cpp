@@ -0,0 +1,118 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "fetched_files.h"
+
+#include "visage_utils/file_system.h"
+
+#include <cstring>
+
+#if VISAGE_EMSCRIPTEN
+#include <emscripten/fetch.h>
+#endif
+
+namespace visage {
+  EmbeddedFile FetchedFiles::resolveFile(const EmbeddedFile& file) {
+    if (file.data || file.url == nullptr)
+      return file;
+
+    EmbeddedFile result = file;
+    std::string url = file.url;
+    {
+      std::lock_guard lock(mutex_);
+      auto found = entries_.find(url);
+      if (found != entries_.end()) {
+        if (found->second.state == State::Loaded) {
+          result.data = found->second.data.get();
+          result.size = found->second.size;
+        }
+        return result;
+      }
+
+      entries_[url];
+      num_fetching_++;
+    }
+
+    startFetch(url);
+
+    std::lock_guard lock(mutex_);
+    Entry& entry = entries_[url];
+    if (entry.state == State::Loaded) {
+      result.data = entry.data.get();
+      result.size = entry.size;
+    }
+    return result;
+  }
+
+  int FetchedFiles::numFetching() const {
+    std::lock_guard lock(mutex_);
+    return num_fetching_;
+  }
+
+  bool FetchedFiles::failed(const EmbeddedFile& file) const {
+    if (file.url == nullptr)
+      return false;
+
+    std::lock_guard lock(mutex_);
+    auto found = entries_.find(file.url);
+    return found != entries_.end() && found->second.state == State::Failed;
+  }
+
+  void FetchedFiles::startFetch(const std::string& url) {
+#if VISAGE_EMSCRIPTEN
+    emscripten_fetch_attr_t attributes;
+    emscripten_fetch_attr_init(&attributes);
+    std::strcpy(attributes.requestMethod, "GET");
+    attributes.attributes = EMSCRIPTEN_FETCH_LOAD_TO_MEMORY | EMSCRIPTEN_FETCH_PERSIST_FILE;
+    attributes.onsuccess = [](emscripten_fetch_t* fetch) {
+      instance().finishFetch(fetch->url, reinterpret_cast<const unsigned char*>(fetch->data),
+                             fetch->numBytes);
+      emscripten_fetch_close(fetch);
+    };
+    attributes.onerror = [](emscripten_fetch_t* fetch) {
+      instance().finishFetch(fetch->url, nullptr, 0);
+      emscripten_fetch_close(fetch);
+    };
+    emscripten_fetch(&attributes, url.c_str());
+#else
+    size_t size = 0;
+    std::unique_ptr<unsigned char[]> data = loadFileData(url, size);
+    finishFetch(url, data.get(), size);
+#endif
+  }
+
+  void FetchedFiles::finishFetch(const std::string& url, const unsigned char* data, size_t size) {
+    std::lock_guard lock(mutex_);
+    Entry& entry = entries_[url];
+    if (entry.state == State::Fetching)
+      num_fetching_--;
+
+    if (data == nullptr || size == 0) {
+      entry.state = State::Failed;
+      return;
+    }
+
+    entry.data = std::make_unique<unsigned char[]>(size);
+    std::memcpy(entry.data.get(), data, size);
+    entry.size = static_cast<int>(size);
+    entry.state = State::Loaded;
+  }
+}
@@ -0,0 +1,74 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "visage_file_embed/embedded_file.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace visage {
+  // Owns the data of files added with add_fetched_resources. Those start without data on
+  // Emscripten and are downloaded from their url the first time they're resolved. Downloads
+  // persist in IndexedDB so later visits skip the network. Elsewhere the url is read from disk.
+  // Data is kept for the life of the process since caches key drawn resources by data pointer.
+  class FetchedFiles {
+  public:
+    static FetchedFiles& instance() {
+      static FetchedFiles fetched_files;
+      return fetched_files;
+    }
+
+    // Returns the file with its data filled in, or with null data while it's still downloading
+    // or if the download failed. Files that already have data are returned unchanged.
+    static EmbeddedFile resolve(const EmbeddedFile& file) { return instance().resolveFile(file); }
+    static bool fetching() { return instance().numFetching() > 0; }
+
+    EmbeddedFile resolveFile(const EmbeddedFile& file);
+    int numFetching() const;
+    bool failed(const EmbeddedFile& file) const;
+
+  private:
+    enum class State {
+      Fetching,
+      Loaded,
+      Failed
+    };
+
+    struct Entry {
+      State state = State::Fetching;
+      std::unique_ptr<unsigned char[]> data;
+      int size = 0;
+    };
+
+    FetchedFiles() = default;
+
+    void startFetch(const std::string& url);
+    void finishFetch(const std::string& url, const unsigned char* data, size_t size);
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Entry> entries_;
+    int num_fetching_ = 0;
+  };
+}
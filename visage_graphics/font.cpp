@@ -22,12 +22,26 @@
 #include "font.h"
 
 #include "emoji.h"
+#include "resource_usage.h"
+#include "upload_memory.h"
 #include "visage_utils/file_system.h"
 #include "visage_utils/thread_utils.h"
+#include "visage_utils/time_utils.h"
+#include "visage_utils/trace.h"
 
 #include <bgfx/bgfx.h>
 #include <freetype/freetype.h>
+#include <freetype/ftmodapi.h>
+#include <freetype/tttables.h>
+#include <freetype/tttags.h>
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <limits>
+#include <list>
+#include <mutex>
 #include <set>
+#include <unordered_map>
 #include <vector>
 
 namespace visage {
@@ -55,15 +69,12 @@ namespace visage {
       instance().faces_.erase(face);
     }
 
-    static std::string idForFont(const unsigned char* data, int data_size) {
-      FT_Face face = newMemoryFace(data, data_size);
-      std::string id = std::string(face->family_name) + "-" + std::string(face->style_name);
-      doneFace(face);
-      return id;
-    }
-
   private:
-    FreeTypeLibrary() { FT_Init_FreeType(&library_); }
+    FreeTypeLibrary() {
+      FT_Init_FreeType(&library_);
+      FT_Int spread = FontCache::kSdfSpread;
+      FT_Property_Set(library_, "sdf", "spread", &spread);
+    }
     ~FreeTypeLibrary() {
       for (FT_Face face : faces_)
         FT_Done_Face(face);
@@ -74,14 +85,209 @@ namespace visage {
     FT_Library library_ = nullptr;
   };
 
+  class GposKerning {
+  public:
+    void load(FT_Face face) {
+      FT_ULong length = 0;
+      if (FT_Load_Sfnt_Table(face, TTAG_GPOS, 0, nullptr, &length) || length == 0)
+        return;
+
+      table_.resize(length);
+      if (FT_Load_Sfnt_Table(face, TTAG_GPOS, 0, table_.data(), &length)) {
+        table_.clear();
+        return;
+      }
+
+      int feature_list = u16(6);
+      int lookup_list = u16(8);
+      std::set<int> lookups;
+      int num_features = u16(feature_list);
+      for (int i = 0; i < num_features; ++i) {
+        int record = feature_list + 2 + i * 6;
+        if (size_t(record + 4) > table_.size() || std::memcmp(&table_[record], "kern", 4))
+          continue;
+
+        int feature = feature_list + u16(record + 4);
+        int num_lookups = u16(feature + 2);
+        for (int l = 0; l < num_lookups; ++l)
+          lookups.insert(u16(feature + 4 + 2 * l));
+      }
+
+      int num_lookup_tables = u16(lookup_list);
+      for (int index : lookups) {
+        if (index >= num_lookup_tables)
+          continue;
+
+        int lookup = lookup_list + u16(lookup_list + 2 + 2 * index);
+        int type = u16(lookup);
+        int num_subtables = u16(lookup + 4);
+        std::vector<int> subtables;
+        for (int t = 0; t < num_subtables; ++t) {
+          int subtable = lookup + u16(lookup + 6 + 2 * t);
+          if (type == kExtensionLookup && u16(subtable + 2) == kPairLookup)
+            subtables.push_back(subtable + u32(subtable + 4));
+          else if (type == kPairLookup)
+            subtables.push_back(subtable);
+        }
+        if (!subtables.empty())
+          lookups_.push_back(std::move(subtables));
+      }
+    }
+
+    bool hasKerning() const { return !lookups_.empty(); }
+
+    int kerning(int left_glyph, int right_glyph) const {
+      int result = 0;
+      for (const std::vector<int>& subtables : lookups_) {
+        for (int subtable : subtables) {
+          int value = 0;
+          if (pairValue(subtable, left_glyph, right_glyph, value)) {
+            result += value;
+            break;
+          }
+        }
+      }
+      return result;
+    }
+
+  private:
+    static constexpr int kPairLookup = 2;
+    static constexpr int kExtensionLookup = 9;
+    static constexpr int kXAdvance = 0x4;
+
+    int u16(int offset) const {
+      if (offset < 0 || size_t(offset) + 2 > table_.size())
+        return 0;
+      return (table_[offset] << 8) | table_[offset + 1];
+    }
+
+    int u32(int offset) const { return (u16(offset) << 16) | u16(offset + 2); }
+    int s16(int offset) const { return static_cast<short>(u16(offset)); }
+
+    static int valueSize(int format) { return 2 * std::bitset<8>(format & 0xff).count(); }
+
+    int xAdvance(int record, int format) const {
+      if ((format & kXAdvance) == 0)
+        return 0;
+      return s16(record + 2 * std::bitset<2>(format & 0x3).count());
+    }
+
+    int coverageIndex(int coverage, int glyph) const {
+      int format = u16(coverage);
+      int count = u16(coverage + 2);
+      int low = 0;
+      int high = count - 1;
+      while (low <= high) {
+        int mid = (low + high) / 2;
+        if (format == 1) {
+          int value = u16(coverage + 4 + 2 * mid);
+          if (value == glyph)
+            return mid;
+          if (value < glyph)
+            low = mid + 1;
+          else
+            high = mid - 1;
+        }
+        else {
+          int range = coverage + 4 + 6 * mid;
+          if (glyph < u16(range))
+            high = mid - 1;
+          else if (glyph > u16(range + 2))
+            low = mid + 1;
+          else
+            return u16(range + 4) + glyph - u16(range);
+        }
+      }
+      return -1;
+    }
+
+    int glyphClass(int class_def, int glyph) const {
+      int format = u16(class_def);
+      if (format == 1) {
+        int start = u16(class_def + 2);
+        if (glyph < start || glyph >= start + u16(class_def + 4))
+          return 0;
+        return u16(class_def + 6 + 2 * (glyph - start));
+      }
+
+      int low = 0;
+      int high = u16(class_def + 2) - 1;
+      while (low <= high) {
+        int mid = (low + high) / 2;
+        int range = class_def + 4 + 6 * mid;
+        if (glyph < u16(range))
+          high = mid - 1;
+        else if (glyph > u16(range + 2))
+          low = mid + 1;
+        else
+          return u16(range + 4);
+      }
+      return 0;
+    }
+
+    bool pairValue(int subtable, int left_glyph, int right_glyph, int& value) const {
+      int coverage = coverageIndex(subtable + u16(subtable + 2), left_glyph);
+      if (coverage < 0)
+        return false;
+
+      int format = u16(subtable);
+      int value_format1 = u16(subtable + 4);
+      int value_format2 = u16(subtable + 6);
+      int record_size = valueSize(value_format1) + valueSize(value_format2);
+
+      if (format == 1) {
+        if (coverage >= u16(subtable + 8))
+          return false;
+
+        int pair_set = subtable + u16(subtable + 10 + 2 * coverage);
+        int pair_size = 2 + record_size;
+        int low = 0;
+        int high = u16(pair_set) - 1;
+        while (low <= high) {
+          int mid = (low + high) / 2;
+          int pair = pair_set + 2 + mid * pair_size;
+          int glyph = u16(pair);
+          if (glyph == right_glyph) {
+            value = xAdvance(pair + 2, value_format1);
+            return true;
+          }
+          if (glyph < right_glyph)
+            low = mid + 1;
+          else
+            high = mid - 1;
+        }
+        return false;
+      }
+
+      if (format == 2) {
+        int class1 = glyphClass(subtable + u16(subtable + 8), left_glyph);
+        int class2 = glyphClass(subtable + u16(subtable + 10), right_glyph);
+        int class1_count = u16(subtable + 12);
+        int class2_count = u16(subtable + 14);
+        if (class1 >= class1_count || class2 >= class2_count)
+          return false;
+
+        int record = subtable + 16 + (class1 * class2_count + class2) * record_size;
+        value = xAdvance(record, value_format1);
+        return true;
+      }
+      return false;
+    }
+
+    std::vector<unsigned char> table_;
+    std::vector<std::vector<int>> lookups_;
+  };
+
   class TypeFace {
   public:
     TypeFace(const TypeFace&) = delete;
     TypeFace& operator=(const TypeFace&) = delete;
 
-    TypeFace(int size, const unsigned char* data, int data_size) {
+    TypeFace(int size, const unsigned char* data, int data_size, bool sdf) : sdf_(sdf) {
       face_ = FreeTypeLibrary::newMemoryFace(data, data_size);
       FT_Set_Pixel_Sizes(face_, 0, std::max(0, size));
+      if (!FT_HAS_KERNING(face_))
+        gpos_kerning_.load(face_);
     }
 
     ~TypeFace() { FreeTypeLibrary::doneFace(face_); }
@@ -92,15 +298,48 @@ namespace visage {
 
     int glyphIndex(char32_t character) const { return FT_Get_Char_Index(face_, character); }
     bool hasCharacter(char32_t character) const { return glyphIndex(character); }
+    bool hasKerning() const { return FT_HAS_KERNING(face_) || gpos_kerning_.hasKerning(); }
+    float kerning(char32_t left, char32_t right) const {
+      static constexpr float kKerningMult = 1.0f / (1 << 6);
+
+      int left_glyph = glyphIndex(left);
+      int right_glyph = glyphIndex(right);
+      if (left_glyph == 0 || right_glyph == 0)
+        return 0.0f;
+
+      if (gpos_kerning_.hasKerning()) {
+        FT_Pos units = gpos_kerning_.kerning(left_glyph, right_glyph);
+        FT_Pos scaled = FT_MulFix(units, face_->size->metrics.x_scale);
+        return std::round(scaled * kKerningMult);
+      }
+
+      FT_Vector delta {};
+      FT_Get_Kerning(face_, left_glyph, right_glyph, FT_KERNING_DEFAULT, &delta);
+      return delta.x * kKerningMult;
+    }
     int lineHeight() const { return face_->size->metrics.height >> 6; }
 
     FT_GlyphSlot characterInfo(char32_t character) const {
+      if (sdf_)
+        return characterRasterData(character);
+
       FT_Load_Char(face_, character, 0);
       return face_->glyph;
     }
 
+    float characterAdvance(char32_t character) const {
+      static constexpr float kAdvanceMult = 1.0f / (1 << 6);
+      FT_Load_Char(face_, character, 0);
+      return face_->glyph->advance.x * kAdvanceMult;
+    }
+
     FT_GlyphSlot characterRasterData(char32_t character) const {
-      FT_Load_Char(face_, character, FT_LOAD_RENDER);
+      if (sdf_) {
+        FT_Load_Char(face_, character, FT_LOAD_DEFAULT);
+        FT_Render_Glyph(face_->glyph, FT_RENDER_MODE_SDF);
+      }
+      else
+        FT_Load_Char(face_, character, FT_LOAD_RENDER);
       return face_->glyph;
     }
 
@@ -108,68 +347,462 @@ namespace visage {
 
   private:
     FT_Face face_ = nullptr;
+    GposKerning gpos_kerning_;
+    bool sdf_ = false;
   };
 
-  class PackedFont {
+  struct AtlasGlyph {
+    char32_t character = 0;
+    PackedGlyph* glyph = nullptr;
+    PackedFont* font = nullptr;
+  };
+
+  using GlyphList = std::vector<AtlasGlyph>;
+
+  template<typename T>
+  class GlyphAtlas {
   public:
-    static constexpr int kChannels = 4;
+    explicit GlyphAtlas(bgfx::TextureFormat::Enum format) : format_(format) { }
+    ~GlyphAtlas() { destroyTexture(); }
+
+    GlyphAtlas(const GlyphAtlas&) = delete;
+    GlyphAtlas& operator=(const GlyphAtlas&) = delete;
+
+    void addGlyph(PackedFont* font, char32_t character, PackedGlyph* packed_glyph) {
+      glyphs_.push_back({ character, packed_glyph, font });
+      if (!atlas_map_.addRect(packed_glyph, packed_glyph->width, packed_glyph->height)) {
+        repack();
+        return;
+      }
 
-    PackedFont(const std::string& id, int size, const unsigned char* data, int data_size) :
-        id_(id), size_(size), data_size_(data_size) {
-      data_ = std::make_unique<unsigned char[]>(data_size);
-      std::memcpy(data_.get(), data, data_size);
-      type_face_ = std::make_unique<TypeFace>(size, data_.get(), data_size);
-      std::unique_ptr<PackedGlyph[]> glyphs = std::make_unique<PackedGlyph[]>(type_face_->numGlyphs());
+      const PackedRect& rect = atlas_map_.rectForId(packed_glyph);
+      packed_glyph->atlas_left = rect.x;
+      packed_glyph->atlas_top = rect.y;
+      if (has_pixels_)
+        pending_glyphs_.push_back(glyphs_.back());
+    }
 
-      packed_glyphs_['\n'] = Font::kNullPackedGlyph;
+    // The space of removed glyphs is reclaimed the next time the atlas repacks.
+    void removeGlyphs(const PackedFont* font) {
+      auto owned = [font](const AtlasGlyph& glyph) { return glyph.font == font; };
+      for (const AtlasGlyph& glyph : glyphs_) {
+        if (owned(glyph))
+          atlas_map_.removeRect(glyph.glyph);
+      }
+      glyphs_.erase(std::remove_if(glyphs_.begin(), glyphs_.end(), owned), glyphs_.end());
+      pending_glyphs_.erase(std::remove_if(pending_glyphs_.begin(), pending_glyphs_.end(), owned),
+                            pending_glyphs_.end());
+
+      if (glyphs_.empty()) {
+        destroyTexture();
+        atlas_map_.clear();
+        pixels_.clear();
+        has_pixels_ = false;
+      }
     }
 
-    ~PackedFont() {
-      if (bgfx::isValid(texture_handle_))
-        bgfx::destroy(texture_handle_);
-      type_face_ = nullptr;
+    template<typename F>
+    void checkInit(F rasterize) {
+      int width = this->width();
+      int height = this->height();
+      if (width == 0 || height == 0)
+        return;
+
+      rasterizePixels(rasterize);
+      if (!hasTexture()) {
+        texture_handle_ = bgfx::createTexture2D(width, height, false, 1, textureFormat());
+        texture_memory_.reset(ResourceCategory::FontAtlas,
+                              ResourceTracker::textureBytes(width, height, textureFormat()));
+        upload(0, 0, width, height);
+      }
+      else if (dirty_right_ > dirty_left_ && dirty_bottom_ > dirty_top_)
+        upload(dirty_left_, dirty_top_, dirty_right_ - dirty_left_, dirty_bottom_ - dirty_top_);
+
+      clearDirty();
+    }
+
+    // rasterize is called per glyph, or once with every glyph to draw if it takes a GlyphList.
+    // Rasterized glyphs are remembered as dirty until the next checkInit uploads them.
+    template<typename F>
+    void rasterizePixels(F rasterize) {
+      VISAGE_TRACE_SCOPE("GlyphAtlas::rasterizePixels");
+      int width = atlas_map_.width();
+      if (!has_pixels_)
+        pixels_.assign(width * atlas_map_.height(), 0);
+
+      const GlyphList& glyphs = has_pixels_ ? pending_glyphs_ : glyphs_;
+      for (const AtlasGlyph& atlas_glyph : glyphs) {
+        const PackedGlyph* glyph = atlas_glyph.glyph;
+        if (glyph->width <= 0 || glyph->height <= 0)
+          continue;
+
+        dirty_left_ = std::min(dirty_left_, glyph->atlas_left);
+        dirty_top_ = std::min(dirty_top_, glyph->atlas_top);
+        dirty_right_ = std::max(dirty_right_, glyph->atlas_left + glyph->width);
+        dirty_bottom_ = std::max(dirty_bottom_, glyph->atlas_top + glyph->height);
+      }
+
+      if constexpr (std::is_invocable_v<F, const GlyphList&, T*, int>)
+        rasterize(glyphs, pixels_.data(), width);
+      else {
+        for (const AtlasGlyph& glyph : glyphs)
+          rasterize(glyph, pixels_.data(), width);
+      }
+
+      pending_glyphs_.clear();
+      has_pixels_ = true;
+    }
+
+    bool hasTexture() const { return bgfx::isValid(texture_handle_); }
+    const bgfx::TextureHandle& textureHandle() const { return texture_handle_; }
+    const GlyphList& glyphs() const { return glyphs_; }
+    const std::vector<T>& pixels() const { return pixels_; }
+    // An emptied atlas keeps its map's last dimensions until a glyph is added and it repacks.
+    int width() const { return glyphs_.empty() ? 0 : atlas_map_.width(); }
+    int height() const { return glyphs_.empty() ? 0 : atlas_map_.height(); }
+
+  private:
+    bool expandToBgra() const {
+      return sizeof(T) == 1 && (bgfx::getCaps()->formats[format_] & BGFX_CAPS_FORMAT_TEXTURE_2D) == 0;
+    }
+
+    bgfx::TextureFormat::Enum textureFormat() const {
+      return expandToBgra() ? bgfx::TextureFormat::BGRA8 : format_;
+    }
+
+    void upload(int x, int y, int width, int height) {
+      int atlas_width = atlas_map_.width();
+      const T* start = pixels_.data() + y * atlas_width + x;
+      if (expandToBgra()) {
+        const bgfx::Memory* memory = UploadMemoryPool::instance().allocate(width * height *
+                                                                           sizeof(unsigned int));
+        auto dest = reinterpret_cast<unsigned int*>(memory->data);
+        for (int r = 0; r < height; ++r) {
+          for (int c = 0; c < width; ++c)
+            dest[r * width + c] = start[r * atlas_width + c] * 0x01010101u;
+        }
+        bgfx::updateTexture2D(texture_handle_, 0, 0, x, y, width, height, memory);
+        return;
+      }
+
+      int size = (height - 1) * atlas_width + width;
+      bgfx::updateTexture2D(texture_handle_, 0, 0, x, y, width, height,
+                            UploadMemoryPool::instance().copy(start, size * sizeof(T)),
+                            atlas_width * sizeof(T));
     }
 
-    void resize() {
-      if (bgfx::isValid(texture_handle_)) {
+    void destroyTexture() {
+      if (hasTexture()) {
         bgfx::destroy(texture_handle_);
         texture_handle_ = BGFX_INVALID_HANDLE;
+        texture_memory_.reset();
       }
+    }
 
+    void clearDirty() {
+      dirty_left_ = std::numeric_limits<int>::max();
+      dirty_top_ = std::numeric_limits<int>::max();
+      dirty_right_ = 0;
+      dirty_bottom_ = 0;
+    }
+
+    void repack() {
+      destroyTexture();
       atlas_map_.pack();
-      for (auto& glyph : packed_glyphs_) {
-        if (glyph.second.width == 0)
+      for (const AtlasGlyph& atlas_glyph : glyphs_) {
+        PackedGlyph* glyph = atlas_glyph.glyph;
+        if (glyph->width == 0)
+          continue;
+
+        const PackedRect& rect = atlas_map_.rectForId(glyph);
+        glyph->atlas_left = rect.x;
+        glyph->atlas_top = rect.y;
+      }
+      pending_glyphs_.clear();
+      has_pixels_ = false;
+      clearDirty();
+    }
+
+    bgfx::TextureFormat::Enum format_;
+    PackedAtlasMap<const PackedGlyph*> atlas_map_;
+    GlyphList glyphs_;
+    GlyphList pending_glyphs_;
+    std::vector<T> pixels_;
+    bool has_pixels_ = false;
+    int dirty_left_ = std::numeric_limits<int>::max();
+    int dirty_top_ = std::numeric_limits<int>::max();
+    int dirty_right_ = 0;
+    int dirty_bottom_ = 0;
+    bgfx::TextureHandle texture_handle_ = { bgfx::kInvalidHandle };
+    TrackedResource texture_memory_;
+  };
+
+  // Every bitmap font packs into one coverage atlas and every font packs emoji into one emoji
+  // atlas, so text in any of these fonts and sizes draws with the same textures. Distance field
+  // fonts keep their own atlas because they draw with a different shader.
+  struct SharedGlyphAtlases {
+    static SharedGlyphAtlases& instance() {
+      static SharedGlyphAtlases instance;
+      return instance;
+    }
+
+    GlyphAtlas<unsigned char> coverage { bgfx::TextureFormat::R8 };
+    GlyphAtlas<unsigned int> emoji { bgfx::TextureFormat::BGRA8 };
+  };
+
+  // Writes go to a temporary file that's renamed into place, so a font loading the same cache
+  // file while it's written reads the old file or the new one and never a partial one.
+  class DiskCacheWriter {
+  public:
+    static DiskCacheWriter& instance() {
+      static DiskCacheWriter instance;
+      return instance;
+    }
+
+    void write(File file, std::vector<unsigned char> data) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_++;
+      }
+
+      auto task = [this, file = std::move(file), data = std::move(data)] {
+        {
+          std::lock_guard<std::mutex> file_lock(file_mutex_);
+          std::error_code error;
+          std::filesystem::create_directories(file.parent_path(), error);
+          File temporary = file;
+          temporary += ".tmp";
+          if (replaceFileWithData(temporary, data.data(), data.size()))
+            std::filesystem::rename(temporary, file, error);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--pending_ == 0)
+          done_.notify_all();
+      };
+      ThreadPool::shared().post(std::move(task), TaskPriority::Background);
+    }
+
+    void flush() {
+      std::unique_lock<std::mutex> lock(mutex_);
+      done_.wait(lock, [this] { return pending_ == 0; });
+    }
+
+  private:
+    std::mutex mutex_;
+    std::mutex file_mutex_;
+    std::condition_variable done_;
+    int pending_ = 0;
+  };
+
+  class PackedFont {
+  public:
+    static constexpr unsigned int kDiskCacheMagic = 0x56474331;
+    static constexpr unsigned int kDiskCacheVersion = 2;
+
+    struct DiskCacheHeader {
+      unsigned int magic = kDiskCacheMagic;
+      unsigned int version = kDiskCacheVersion;
+      int size = 0;
+      int sdf = 0;
+      int num_glyphs = 0;
+    };
+
+    // Each glyph's bitmap follows the glyph records, in the same order.
+    struct DiskCacheGlyph {
+      char32_t character = 0;
+      int width = 0;
+      int height = 0;
+      float x_offset = 0.0f;
+      float y_offset = 0.0f;
+      float x_advance = 0.0f;
+    };
+
+    static unsigned long long dataHash(const unsigned char* data, int data_size) {
+      unsigned long long hash = 0xcbf29ce484222325ull;
+      for (int i = 0; i < data_size; ++i)
+        hash = (hash ^ data[i]) * 0x100000001b3ull;
+      return hash;
+    }
+
+    static size_t bitmapSize(int width, int height) {
+      return static_cast<size_t>(std::max(0, width)) * std::max(0, height);
+    }
+
+    // The font data is owned by the FontCache type face and outlives this packed font.
+    PackedFont(int type_face_id, int size, const unsigned char* data, int data_size, bool sdf,
+               const File& cache_directory) :
+        type_face_id_(type_face_id), size_(size), data_(data), data_size_(data_size), sdf_(sdf) {
+      type_face_ = std::make_unique<TypeFace>(size, data_, data_size, sdf);
+
+      SharedGlyphAtlases& shared_atlases = SharedGlyphAtlases::instance();
+      if (sdf) {
+        sdf_atlas_ = std::make_unique<GlyphAtlas<unsigned char>>(bgfx::TextureFormat::R8);
+        coverage_atlas_ = sdf_atlas_.get();
+      }
+      else
+        coverage_atlas_ = &shared_atlases.coverage;
+      emoji_atlas_ = &shared_atlases.emoji;
+
+      *packed_glyphs_['\n'] = Font::kNullPackedGlyph;
+
+      if (!cache_directory.empty()) {
+        char hash[17];
+        std::snprintf(hash, sizeof(hash), "%016llx", dataHash(data, data_size));
+        std::string size_name = sdf ? "sdf" : std::to_string(size);
+        disk_cache_file_ = cache_directory / (std::string(hash) + "-" + size_name + ".glyphs");
+        loadDiskCache();
+      }
+    }
+
+    ~PackedFont() {
+      if (disk_cache_dirty_)
+        saveDiskCache();
+      coverage_atlas_->removeGlyphs(this);
+      emoji_atlas_->removeGlyphs(this);
+      type_face_ = nullptr;
+    }
+
+    void loadDiskCache() {
+      size_t file_size = 0;
+      std::unique_ptr<unsigned char[]> file_data;
+      if (fileExists(disk_cache_file_))
+        file_data = loadFileData(disk_cache_file_, file_size);
+      if (file_data == nullptr || file_size < sizeof(DiskCacheHeader))
+        return;
+
+      DiskCacheHeader header;
+      std::memcpy(&header, file_data.get(), sizeof(DiskCacheHeader));
+      size_t glyphs_size = std::max(0, header.num_glyphs) * sizeof(DiskCacheGlyph);
+      if (header.magic != kDiskCacheMagic || header.version != kDiskCacheVersion ||
+          header.size != size_ || header.sdf != sdf_ ||
+          file_size < sizeof(DiskCacheHeader) + glyphs_size)
+        return;
+
+      const unsigned char* read = file_data.get() + sizeof(DiskCacheHeader);
+      std::vector<DiskCacheGlyph> cached(std::max(0, header.num_glyphs));
+      size_t pixels_size = 0;
+      for (int i = 0; i < header.num_glyphs; ++i) {
+        std::memcpy(&cached[i], read + i * sizeof(DiskCacheGlyph), sizeof(DiskCacheGlyph));
+        pixels_size += bitmapSize(cached[i].width, cached[i].height);
+      }
+      if (file_size != sizeof(DiskCacheHeader) + glyphs_size + pixels_size)
+        return;
+
+      const unsigned char* pixels = read + glyphs_size;
+      cached_pixels_.assign(pixels, pixels + pixels_size);
+      size_t offset = 0;
+      for (const DiskCacheGlyph& cached_glyph : cached) {
+        size_t glyph_offset = offset;
+        offset += bitmapSize(cached_glyph.width, cached_glyph.height);
+        PackedGlyph* packed_glyph = packed_glyphs_[cached_glyph.character];
+        if (packed_glyph->atlas_left >= 0)
           continue;
 
-        const PackedRect& rect = atlas_map_.rectForId(glyph.first);
-        glyph.second.atlas_left = rect.x;
-        glyph.second.atlas_top = rect.y;
+        packed_glyph->width = cached_glyph.width;
+        packed_glyph->height = cached_glyph.height;
+        packed_glyph->x_offset = cached_glyph.x_offset;
+        packed_glyph->y_offset = cached_glyph.y_offset;
+        packed_glyph->x_advance = cached_glyph.x_advance;
+        packed_glyph->type_face = type_face_.get();
+        cached_bitmaps_[cached_glyph.character] = glyph_offset;
+        coverage_atlas_->addGlyph(this, cached_glyph.character, packed_glyph);
       }
     }
 
-    void rasterizeGlyph(char32_t character, const PackedGlyph* packed_glyph) {
-      int size = packed_glyph->width * packed_glyph->height;
-      if (size == 0)
+    void saveDiskCache() {
+      if (coverage_atlas_->width() == 0 || coverage_atlas_->height() == 0)
         return;
 
-      std::unique_ptr<unsigned int[]> texture = std::make_unique<unsigned int[]>(size);
-      if (packed_glyph->type_face) {
-        FT_GlyphSlot glyph = packed_glyph->type_face->characterRasterData(character);
-        for (int y = 0; y < packed_glyph->height; ++y) {
-          for (int x = 0; x < packed_glyph->width; ++x) {
-            int i = y * packed_glyph->width + x;
-            texture[i] = (glyph->bitmap.buffer[y * glyph->bitmap.pitch + x] << 24) + 0xffffff;
-          }
+      coverage_atlas_->rasterizePixels(rasterizeCoverage);
+      GlyphList glyphs;
+      size_t pixels_size = 0;
+      for (const AtlasGlyph& glyph : coverage_atlas_->glyphs()) {
+        if (glyph.font == this) {
+          glyphs.push_back(glyph);
+          pixels_size += bitmapSize(glyph.glyph->width, glyph.glyph->height);
         }
       }
-      else {
-        EmojiRasterizer::instance().drawIntoBuffer(character, size_, packed_glyph->width,
-                                                   texture.get(), packed_glyph->width, 0, 0);
+      if (glyphs.empty())
+        return;
+
+      DiskCacheHeader header;
+      header.size = size_;
+      header.sdf = sdf_;
+      header.num_glyphs = glyphs.size();
+
+      std::vector<unsigned char> file_data(sizeof(DiskCacheHeader) +
+                                           glyphs.size() * sizeof(DiskCacheGlyph) + pixels_size);
+      std::memcpy(file_data.data(), &header, sizeof(DiskCacheHeader));
+      unsigned char* write = file_data.data() + sizeof(DiskCacheHeader);
+      for (const AtlasGlyph& glyph : glyphs) {
+        const PackedGlyph* packed = glyph.glyph;
+        DiskCacheGlyph cached = { glyph.character, packed->width,     packed->height,
+                                  packed->x_offset, packed->y_offset, packed->x_advance };
+        std::memcpy(write, &cached, sizeof(DiskCacheGlyph));
+        write += sizeof(DiskCacheGlyph);
+      }
+
+      const std::vector<unsigned char>& pixels = coverage_atlas_->pixels();
+      int atlas_width = coverage_atlas_->width();
+      for (const AtlasGlyph& glyph : glyphs) {
+        const PackedGlyph* packed = glyph.glyph;
+        if (packed->width <= 0 || packed->height <= 0)
+          continue;
+
+        const unsigned char* source = pixels.data() + packed->atlas_top * atlas_width +
+                                      packed->atlas_left;
+        for (int y = 0; y < packed->height; ++y) {
+          std::memcpy(write, source + y * atlas_width, packed->width);
+          write += packed->width;
+        }
+      }
+
+      DiskCacheWriter::instance().write(disk_cache_file_, std::move(file_data));
+      disk_cache_dirty_ = false;
+    }
+
+    static void rasterizeCoverage(const AtlasGlyph& glyph, unsigned char* pixels, int atlas_width) {
+      glyph.font->rasterizeGlyph(glyph.character, glyph.glyph, pixels, atlas_width);
+    }
+
+    // Emoji from fonts of different sizes share an atlas, so each font's emoji draw at its size.
+    static void rasterizeEmoji(const GlyphList& glyphs, unsigned int* pixels, int atlas_width) {
+      std::vector<EmojiPlacement> placements;
+      placements.reserve(glyphs.size());
+      for (size_t i = 0; i < glyphs.size();) {
+        const PackedFont* font = glyphs[i].font;
+        placements.clear();
+        for (; i < glyphs.size() && glyphs[i].font == font; ++i) {
+          const PackedGlyph* glyph = glyphs[i].glyph;
+          if (glyph->width > 0)
+            placements.push_back({ glyphs[i].character, glyph->atlas_left, glyph->atlas_top });
+        }
+
+        EmojiRasterizer& rasterizer = EmojiRasterizer::instance();
+        if (!placements.empty()) {
+          rasterizer.drawIntoBuffer(placements, font->size(), font->lineHeight(), pixels,
+                                    atlas_width);
+        }
       }
+    }
 
-      bgfx::updateTexture2D(texture_handle_, 0, 0, packed_glyph->atlas_left,
-                            packed_glyph->atlas_top, packed_glyph->width, packed_glyph->height,
-                            bgfx::copy(texture.get(), size * kChannels));
+    void rasterizeGlyph(char32_t character, const PackedGlyph* packed_glyph,
+                        unsigned char* pixels, int atlas_width) const {
+      unsigned char* dest = pixels + packed_glyph->atlas_top * atlas_width + packed_glyph->atlas_left;
+      auto cached = cached_bitmaps_.find(character);
+      if (cached != cached_bitmaps_.end()) {
+        const unsigned char* source = cached_pixels_.data() + cached->second;
+        int width = packed_glyph->width;
+        for (int y = 0; y < packed_glyph->height; ++y)
+          std::memcpy(dest + y * atlas_width, source + y * width, width);
+        return;
+      }
+
+      FT_GlyphSlot glyph = packed_glyph->type_face->characterRasterData(character);
+      for (int y = 0; y < packed_glyph->height; ++y)
+        std::memcpy(dest + y * atlas_width, glyph->bitmap.buffer + y * glyph->bitmap.pitch,
+                    packed_glyph->width);
     }
 
     PackedGlyph* packCharacterGlyph(PackedGlyph* packed_glyph, const TypeFace* type_face, char32_t character) {
@@ -183,7 +816,8 @@ namespace visage {
       packed_glyph->x_advance = glyph->advance.x * kAdvanceMult;
       packed_glyph->type_face = type_face;
 
-      packGlyph(packed_glyph, character);
+      coverage_atlas_->addGlyph(this, character, packed_glyph);
+      disk_cache_dirty_ = !disk_cache_file_.empty();
       return packed_glyph;
     }
 
@@ -195,12 +829,47 @@ namespace visage {
       packed_glyph->y_offset = size_;
       packed_glyph->x_advance = raster_width;
 
-      packGlyph(packed_glyph, emoji);
+      emoji_atlas_->addGlyph(this, emoji, packed_glyph);
       return packed_glyph;
     }
 
+    bool hasKerning() const { return type_face_->hasKerning(); }
+
+    float kerning(char32_t left, char32_t right) const {
+      if (!Font::isPrintable(left) || !Font::isPrintable(right))
+        return 0.0f;
+      return type_face_->kerning(left, right);
+    }
+
+    const float* kerning(const char32_t* string, int length) {
+      static constexpr int kMaxShapedRuns = 512;
+
+      if (length < 2 || !type_face_->hasKerning())
+        return nullptr;
+
+      std::u32string text(string, length);
+      auto found = shaped_run_lookup_.find(text);
+      if (found != shaped_run_lookup_.end()) {
+        shaped_runs_.splice(shaped_runs_.begin(), shaped_runs_, found->second);
+        return found->second->kerning.data();
+      }
+
+      if (shaped_runs_.size() >= kMaxShapedRuns) {
+        shaped_run_lookup_.erase(shaped_runs_.back().text);
+        shaped_runs_.pop_back();
+      }
+
+      ShapedRun& run = shaped_runs_.emplace_front();
+      run.text = std::move(text);
+      run.kerning.resize(length, 0.0f);
+      for (int i = 0; i < length - 1; ++i)
+        run.kerning[i] = kerning(string[i], string[i + 1]);
+      shaped_run_lookup_[run.text] = shaped_runs_.begin();
+      return run.kerning.data();
+    }
+
     const PackedGlyph* packedGlyph(char32_t character) {
-      PackedGlyph* packed_glyph = &packed_glyphs_[character];
+      PackedGlyph* packed_glyph = packed_glyphs_[character];
       if (packed_glyph->atlas_left >= 0)
         return packed_glyph;
 
@@ -210,52 +879,71 @@ namespace visage {
       return packEmojiGlyph(packed_glyph, character);
     }
 
-    void checkInit() {
-      if (!bgfx::isValid(texture_handle_)) {
-        texture_handle_ = bgfx::createTexture2D(atlas_map_.width(), atlas_map_.height(), false, 1,
-                                                bgfx::TextureFormat::BGRA8);
-        int width = atlas_map_.width();
-        int height = atlas_map_.height();
-        std::unique_ptr<unsigned int[]> clear = std::make_unique<unsigned int[]>(width * height);
-        bgfx::updateTexture2D(texture_handle_, 0, 0, 0, 0, width, height,
-                              bgfx::copy(clear.get(), width * height * kChannels));
+    // Advances for measuring text, loaded without rendering or packing glyphs that may never
+    // be drawn.
+    float advance(char32_t character) {
+      const PackedGlyph* packed_glyph = packed_glyphs_.find(character);
+      if (packed_glyph && packed_glyph->atlas_left >= 0)
+        return packed_glyph->x_advance;
 
-        for (auto& glyph : packed_glyphs_)
-          rasterizeGlyph(glyph.first, &glyph.second);
-      }
+      auto found = advances_.find(character);
+      if (found != advances_.end())
+        return found->second;
+
+      float advance = lineHeight();
+      if (type_face_->hasCharacter(character))
+        advance = type_face_->characterAdvance(character);
+      advances_[character] = advance;
+      return advance;
+    }
+
+    void checkInit() {
+      coverage_atlas_->checkInit(rasterizeCoverage);
+      emoji_atlas_->checkInit(rasterizeEmoji);
     }
 
-    int atlasWidth() const { return atlas_map_.width(); }
-    int atlasHeight() const { return atlas_map_.height(); }
-    bgfx::TextureHandle& textureHandle() { return texture_handle_; }
+    int atlasWidth() const { return coverage_atlas_->width(); }
+    int atlasHeight() const { return coverage_atlas_->height(); }
+    const bgfx::TextureHandle& textureHandle() const { return coverage_atlas_->textureHandle(); }
+    int emojiAtlasWidth() const { return emoji_atlas_->width(); }
+    int emojiAtlasHeight() const { return emoji_atlas_->height(); }
+    const bgfx::TextureHandle& emojiTextureHandle() const {
+      return emoji_atlas_->hasTexture() ? emoji_atlas_->textureHandle()
+                                      : coverage_atlas_->textureHandle();
+    }
     int lineHeight() const { return type_face_->lineHeight(); }
     int size() const { return size_; }
-    const unsigned char* data() const { return data_.get(); }
+    bool sdf() const { return sdf_; }
+    int sdfPadding() const { return sdf_ ? FontCache::kSdfSpread : 0; }
+    const unsigned char* data() const { return data_; }
     int dataSize() const { return data_size_; }
-    const std::string& id() const { return id_; }
+    int typeFaceId() const { return type_face_id_; }
+    const void* atlasId() const { return coverage_atlas_; }
 
   private:
-    void packGlyph(PackedGlyph* packed_glyph, char32_t character) {
-      if (!atlas_map_.addRect(character, packed_glyph->width, packed_glyph->height))
-        resize();
-
-      const PackedRect& rect = atlas_map_.rectForId(character);
-      packed_glyph->atlas_left = rect.x;
-      packed_glyph->atlas_top = rect.y;
+    struct ShapedRun {
+      std::u32string text;
+      std::vector<float> kerning;
+    };
 
-      if (bgfx::isValid(texture_handle_))
-        rasterizeGlyph(character, packed_glyph);
-    }
-
-    PackedAtlasMap<char32_t> atlas_map_;
     std::unique_ptr<TypeFace> type_face_;
-    std::string id_;
+    int type_face_id_ = 0;
     int size_ = 0;
-    std::unique_ptr<unsigned char[]> data_;
+    const unsigned char* data_ = nullptr;
     int data_size_ = 0;
-
-    std::map<char32_t, PackedGlyph> packed_glyphs_;
-    bgfx::TextureHandle texture_handle_ = { bgfx::kInvalidHandle };
+    bool sdf_ = false;
+    File disk_cache_file_;
+    bool disk_cache_dirty_ = false;
+
+    PackedGlyphTable packed_glyphs_;
+    std::unordered_map<char32_t, float> advances_;
+    std::list<ShapedRun> shaped_runs_;
+    std::unordered_map<std::u32string, std::list<ShapedRun>::iterator> shaped_run_lookup_;
+    std::unordered_map<char32_t, size_t> cached_bitmaps_;
+    std::vector<unsigned char> cached_pixels_;
+    std::unique_ptr<GlyphAtlas<unsigned char>> sdf_atlas_;
+    GlyphAtlas<unsigned char>* coverage_atlas_ = nullptr;
+    GlyphAtlas<unsigned int>* emoji_atlas_ = nullptr;
   };
 
   bool Font::hasNewLine(const char32_t* string, int length) {
@@ -288,6 +976,7 @@ namespace visage {
     size_ = other.size_;
     native_size_ = other.native_size_;
     dpi_scale_ = other.dpi_scale_;
+    kerning_ = other.kerning_;
     packed_font_ = FontCache::loadPackedFont(other.packed_font_);
   }
 
@@ -296,6 +985,7 @@ namespace visage {
     std::swap(size_, copy.size_);
     std::swap(native_size_, copy.native_size_);
     std::swap(dpi_scale_, copy.dpi_scale_);
+    std::swap(kerning_, copy.kerning_);
     std::swap(packed_font_, copy.packed_font_);
     return *this;
   }
@@ -307,31 +997,54 @@ namespace visage {
 
   Font Font::withDpiScale(float dpi_scale) const {
     if (dpi_scale_ == dpi_scale)
-      return *this;  // Fast path: avoid allocation when scale unchanged
-    if (packed_font_ == nullptr)
-      return { size_, nullptr, 0, dpi_scale };
-    return { size_, packed_font_->data(), packed_font_->dataSize(), dpi_scale };
+      return *this;
+    return withSameTypeFace(size_, dpi_scale);
   }
 
   Font Font::withSize(float size) const {
-    if (packed_font_ == nullptr)
-      return { size, nullptr, 0, dpi_scale_ };
-    return { size, packed_font_->data(), packed_font_->dataSize(), dpi_scale_ };
+    return withSameTypeFace(size, dpi_scale_);
+  }
+
+  Font Font::withSameTypeFace(float size, float dpi_scale) const {
+    Font font;
+    font.size_ = size;
+    font.dpi_scale_ = dpi_scale;
+    font.native_size_ = std::round(size * (dpi_scale ? dpi_scale : 1.0f));
+    font.kerning_ = kerning_;
+    if (packed_font_)
+      font.packed_font_ = FontCache::loadPackedFont(font.native_size_, packed_font_->typeFaceId());
+    return font;
+  }
+
+  Font Font::withKerning(bool kerning) const {
+    Font font(*this);
+    font.kerning_ = kerning;
+    return font;
+  }
+
+  const float* Font::kerningOffsets(const char32_t* string, int length,
+                                    int character_override) const {
+    if (!kerning_ || character_override || packed_font_ == nullptr)
+      return nullptr;
+    return packed_font_->kerning(string, length);
   }
 
   int Font::nativeWidthOverflowIndex(const char32_t* string, int string_length, float width,
                                      bool round, int character_override) const {
+    float scale = glyphScale();
+    bool kerning = kerning_ && !character_override && packed_font_->hasKerning();
     float string_width = 0;
     for (int i = 0; i < string_length; ++i) {
       char32_t character = string[i];
       if (character_override)
         character = character_override;
-      const PackedGlyph* packed_char = &kNullPackedGlyph;
+      float advance = 0.0f;
       if (!isIgnored(character))
-        packed_char = packed_font_->packedGlyph(character);
+        advance = packed_font_->advance(character) * scale;
 
-      float advance = packed_char->x_advance;
       float break_point = advance;
+      if (kerning && i < string_length - 1)
+        advance += packed_font_->kerning(character, string[i + 1]) * scale;
       if (round)
         break_point = advance * 0.5f;
 
@@ -348,18 +1061,22 @@ namespace visage {
     if (length <= 0)
       return 0.0f;
 
+    float scale = glyphScale();
     if (character_override) {
-      float advance = packed_font_->packedGlyph(character_override)->x_advance;
-      return advance * length;
+      float advance = packed_font_->advance(character_override);
+      return advance * scale * length;
     }
 
+    const float* kerning = kerningOffsets(string, length);
     float width = 0.0f;
     for (int i = 0; i < length; ++i) {
       if (!isNewLine(string[i]) && !isIgnored(string[i]))
-        width += packed_font_->packedGlyph(string[i])->x_advance;
+        width += packed_font_->advance(string[i]);
+      if (kerning && i < length - 1)
+        width += kerning[i];
     }
 
-    return width;
+    return width * scale;
   }
 
   void Font::setVertexPositions(FontAtlasQuad* quads, const char32_t* text, int length, float x,
@@ -382,46 +1099,56 @@ namespace visage {
     else if (justification & kBottom)
       pen_y = y + static_cast<int>(height);
 
+    float scale = glyphScale();
+    const float* kerning = kerningOffsets(text, length, character_override);
     for (int i = 0; i < length; ++i) {
       char32_t character = character_override ? character_override : text[i];
       const PackedGlyph* packed_glyph = packed_font_->packedGlyph(character);
 
       quads[i].packed_glyph = packed_glyph;
-      quads[i].x = pen_x + packed_glyph->x_offset;
-      quads[i].y = pen_y - packed_glyph->y_offset;
-      quads[i].width = packed_glyph->width;
-      quads[i].height = packed_glyph->height;
-
-      pen_x += packed_glyph->x_advance;
+      quads[i].x = pen_x + packed_glyph->x_offset * scale;
+      quads[i].y = pen_y - packed_glyph->y_offset * scale;
+      quads[i].width = packed_glyph->width * scale;
+      quads[i].height = packed_glyph->height * scale;
+
+      pen_x += packed_glyph->x_advance * scale;
+      if (kerning)
+        pen_x += kerning[i] * scale;
     }
   }
 
-  std::vector<int> Font::nativeLineBreaks(const char32_t* string, int length, float width) const {
-    std::vector<int> line_breaks;
-    int break_index = 0;
-    while (break_index < length) {
-      int overflow_index = nativeWidthOverflowIndex(string + break_index, length - break_index, width) +
-                           break_index;
-      if (overflow_index == length && !hasNewLine(string + break_index, overflow_index - break_index))
-        break;
+  int Font::nativeNextLineBreak(const char32_t* string, int length, int break_index, float width) const {
+    if (break_index >= length)
+      return -1;
 
-      int next_break_index = overflow_index;
-      while (next_break_index < length && next_break_index > break_index &&
-             isPrintable(string[next_break_index - 1])) {
-        next_break_index--;
-      }
+    int overflow_index = nativeWidthOverflowIndex(string + break_index, length - break_index, width) +
+                         break_index;
+    if (overflow_index == length && !hasNewLine(string + break_index, overflow_index - break_index))
+      return -1;
+
+    int next_break_index = overflow_index;
+    while (next_break_index < length && next_break_index > break_index &&
+           isPrintable(string[next_break_index - 1])) {
+      next_break_index--;
+    }
 
-      if (next_break_index == break_index)
-        next_break_index = overflow_index;
+    if (next_break_index == break_index)
+      next_break_index = overflow_index;
 
-      for (int i = break_index; i < next_break_index; ++i) {
-        if (isNewLine(string[i]))
-          next_break_index = i + 1;
-      }
+    for (int i = break_index; i < next_break_index; ++i) {
+      if (isNewLine(string[i]))
+        next_break_index = i + 1;
+    }
 
-      next_break_index = std::max(next_break_index, break_index + 1);
-      line_breaks.push_back(next_break_index);
-      break_index = next_break_index;
+    return std::max(next_break_index, break_index + 1);
+  }
+
+  std::vector<int> Font::nativeLineBreaks(const char32_t* string, int length, float width) const {
+    std::vector<int> line_breaks;
+    int break_index = nativeNextLineBreak(string, length, 0, width);
+    while (break_index >= 0) {
+      line_breaks.push_back(break_index);
+      break_index = nativeNextLineBreak(string, length, break_index, width);
     }
 
     return line_breaks;
@@ -458,16 +1185,36 @@ namespace visage {
   }
 
   int Font::nativeLineHeight() const {
+    if (packed_font_->sdf())
+      return std::round(packed_font_->lineHeight() * glyphScale());
     return packed_font_->lineHeight();
   }
 
   float Font::nativeCapitalHeight() const {
-    return packed_font_->packedGlyph('T')->y_offset;
+    return (packed_font_->packedGlyph('T')->y_offset - packed_font_->sdfPadding()) * glyphScale();
   }
 
   float Font::nativeLowerDipHeight() const {
+    // SDF bitmaps grow by the spread on every side, raising y_offset by one padding and adding
+    // two to the height.
+    static constexpr int kSdfBottomPaddings = 3;
     const PackedGlyph* glyph = packed_font_->packedGlyph('y');
-    return glyph->y_offset + glyph->height;
+    int padding = kSdfBottomPaddings * packed_font_->sdfPadding();
+    return (glyph->y_offset + glyph->height - padding) * glyphScale();
+  }
+
+  bool Font::sdf() const {
+    return packed_font_ && packed_font_->sdf();
+  }
+
+  float Font::glyphScale() const {
+    if (packed_font_ == nullptr || !packed_font_->sdf())
+      return 1.0f;
+    return native_size_ / static_cast<float>(packed_font_->size());
+  }
+
+  const void* Font::atlasId() const {
+    return packed_font_ ? packed_font_->atlasId() : nullptr;
   }
 
   int Font::atlasWidth() const {
@@ -478,88 +1225,200 @@ namespace visage {
     return packed_font_->atlasHeight();
   }
 
+  int Font::emojiAtlasWidth() const {
+    return packed_font_->emojiAtlasWidth();
+  }
+
+  int Font::emojiAtlasHeight() const {
+    return packed_font_->emojiAtlasHeight();
+  }
+
   const bgfx::TextureHandle& Font::textureHandle() const {
     packed_font_->checkInit();
     return packed_font_->textureHandle();
   }
 
+  const bgfx::TextureHandle& Font::emojiTextureHandle() const {
+    packed_font_->checkInit();
+    return packed_font_->emojiTextureHandle();
+  }
+
   FontCache::FontCache() {
+    // Constructed first so they outlive every packed font this cache destroys.
     FreeTypeLibrary::instance();
+    SharedGlyphAtlases::instance();
+    DiskCacheWriter::instance();
+    ThreadPool::shared();
   }
 
-  FontCache::~FontCache() = default;
+  FontCache::~FontCache() {
+    cache_.clear();
+    flushDiskCache();
+  }
+
+  void FontCache::flushDiskCache() {
+    DiskCacheWriter::instance().flush();
+  }
+
+  PackedFont* FontCache::loadPackedFont(int size, const EmbeddedFile& font) {
+    FontCache* cache = instance();
+    auto found = cache->embedded_type_faces_.find(font.data);
+    if (found != cache->embedded_type_faces_.end())
+      return cache->createOrLoadPackedFont(found->second, size);
+
+    int type_face_id = cache->internTypeFace(font);
+    cache->embedded_type_faces_[font.data] = type_face_id;
+    return cache->createOrLoadPackedFont(type_face_id, size);
+  }
 
   PackedFont* FontCache::loadPackedFont(int size, const std::string& file_path) {
-    std::string id = "file: " + file_path + " - " + std::to_string(size);
-    File file(file_path);
-    size_t file_size = 0;
-    std::unique_ptr<unsigned char[]> data = loadFileData(file, file_size);
-    return instance()->createOrLoadPackedFont(id, size, data.get(), file_size);
+    FontCache* cache = instance();
+    auto found = cache->file_type_faces_.find(file_path);
+    if (found != cache->file_type_faces_.end())
+      return cache->createOrLoadPackedFont(found->second, size);
+
+    auto mapped_file = std::make_unique<MappedFile>(File(file_path));
+    if (mapped_file->data() == nullptr || mapped_file->size() == 0)
+      return nullptr;
+
+    int type_face_id = cache->internTypeFace(std::move(mapped_file));
+    cache->file_type_faces_[file_path] = type_face_id;
+    return cache->createOrLoadPackedFont(type_face_id, size);
   }
 
   PackedFont* FontCache::loadPackedFont(const PackedFont* packed_font) {
     if (packed_font == nullptr)
       return nullptr;
-    return instance()->incrementPackedFont(packed_font->id());
+    return instance()->incrementPackedFont(const_cast<PackedFont*>(packed_font));
   }
 
   PackedFont* FontCache::loadPackedFont(int size, const unsigned char* font_data, int data_size) {
     if (font_data == nullptr)
       return nullptr;
-    std::string id = FreeTypeLibrary::idForFont(font_data, data_size) + " - " + std::to_string(size);
-    return instance()->createOrLoadPackedFont(id, size, font_data, data_size);
+    FontCache* cache = instance();
+    return cache->createOrLoadPackedFont(cache->internTypeFace(font_data, data_size), size);
   }
 
-  PackedFont* FontCache::incrementPackedFont(const std::string& id) {
-    ref_count_[cache_[id].get()]++;
-    return cache_[id].get();
+  int FontCache::findTypeFace(const unsigned char* font_data, int data_size) const {
+    auto found = type_face_lookup_.find(TypeFaceData(font_data, data_size));
+    return found == type_face_lookup_.end() ? 0 : found->second;
   }
 
-  PackedFont* FontCache::createOrLoadPackedFont(const std::string& id, int size,
-                                                const unsigned char* font_data, int data_size) {
-    VISAGE_ASSERT(Thread::isMainThread());
+  int FontCache::addTypeFace(InternedTypeFace type_face) {
+    int type_face_id = next_type_face_++;
+    type_face_lookup_[TypeFaceData(type_face.data, type_face.data_size)] = type_face_id;
+    type_faces_[type_face_id] = std::move(type_face);
+    return type_face_id;
+  }
 
-    if (cache_.count(id) == 0) {
-      TypeFaceData type_face_data(font_data, data_size);
-      if (type_face_data_lookup_.count(type_face_data) == 0) {
-        auto saved_data = std::make_unique<unsigned char[]>(data_size);
-        std::memcpy(saved_data.get(), font_data, data_size);
-        type_face_data.data = saved_data.get();
-        type_face_data_lookup_[type_face_data] = std::move(saved_data);
-      }
+  int FontCache::internTypeFace(const unsigned char* font_data, int data_size) {
+    if (int type_face_id = findTypeFace(font_data, data_size))
+      return type_face_id;
+
+    InternedTypeFace type_face;
+    type_face.copied_data = std::make_unique<unsigned char[]>(data_size);
+    std::memcpy(type_face.copied_data.get(), font_data, data_size);
+    type_face.data = type_face.copied_data.get();
+    type_face.data_size = data_size;
+    return addTypeFace(std::move(type_face));
+  }
+
+  int FontCache::internTypeFace(const EmbeddedFile& font) {
+    if (int type_face_id = findTypeFace(font.data, font.size))
+      return type_face_id;
+
+    InternedTypeFace type_face;
+    type_face.data = font.data;
+    type_face.data_size = font.size;
+    return addTypeFace(std::move(type_face));
+  }
 
-      type_face_data.data = type_face_data_lookup_[type_face_data].get();
-      type_face_data_ref_count_[type_face_data]++;
-      cache_[id] = std::make_unique<PackedFont>(id, size, font_data, data_size);
+  int FontCache::internTypeFace(std::unique_ptr<MappedFile> mapped_file) {
+    int data_size = static_cast<int>(mapped_file->size());
+    if (int type_face_id = findTypeFace(mapped_file->data(), data_size))
+      return type_face_id;
+
+    InternedTypeFace type_face;
+    type_face.data = mapped_file->data();
+    type_face.data_size = data_size;
+    type_face.mapped_file = std::move(mapped_file);
+    return addTypeFace(std::move(type_face));
+  }
+
+  void FontCache::removeTypeFace(int type_face_id) {
+    auto type_face = type_faces_.find(type_face_id);
+    if (type_face == type_faces_.end())
+      return;
+
+    const InternedTypeFace& interned = type_face->second;
+    type_face_lookup_.erase(TypeFaceData(interned.data, interned.data_size));
+    for (auto it = embedded_type_faces_.begin(); it != embedded_type_faces_.end();)
+      it = it->second == type_face_id ? embedded_type_faces_.erase(it) : std::next(it);
+    for (auto it = file_type_faces_.begin(); it != file_type_faces_.end();)
+      it = it->second == type_face_id ? file_type_faces_.erase(it) : std::next(it);
+    type_faces_.erase(type_face);
+  }
+
+  PackedFont* FontCache::incrementPackedFont(PackedFont* packed_font) {
+    if (++ref_count_[packed_font] == 1)
+      release_times_.erase(packed_font);
+    return packed_font;
+  }
+
+  PackedFont* FontCache::createOrLoadPackedFont(int type_face_id, int size) {
+    VISAGE_ASSERT(Thread::isMainThread());
+
+    bool sdf = useSdf(size);
+    uint64_t key = packedFontKey(type_face_id, size, sdf);
+    auto found = cache_.find(key);
+    if (found == cache_.end()) {
+      InternedTypeFace& type_face = type_faces_[type_face_id];
+      type_face.num_packed_fonts++;
+      auto packed_font = std::make_unique<PackedFont>(type_face_id, sdf ? kSdfSize : size,
+                                                      type_face.data, type_face.data_size,
+                                                      sdf, disk_cache_directory_);
+      found = cache_.emplace(key, std::move(packed_font)).first;
     }
 
-    return incrementPackedFont(id);
+    return incrementPackedFont(found->second.get());
   }
 
   void FontCache::decrementPackedFont(PackedFont* packed_font) {
     VISAGE_ASSERT(Thread::isMainThread());
-    ref_count_[packed_font]--;
-    int count = ref_count_[packed_font];
-    has_stale_fonts_ = has_stale_fonts_ || count == 0;
-    VISAGE_ASSERT(ref_count_[packed_font] >= 0);
+    int count = --ref_count_[packed_font];
+    VISAGE_ASSERT(count >= 0);
+    if (count == 0) {
+      has_stale_fonts_ = true;
+      if (retain_period_ > 0)
+        release_times_[packed_font] = time::milliseconds() + retain_period_;
+    }
   }
 
-  void FontCache::removeStaleFonts() {
+  void FontCache::removeStaleFonts(bool release_retained) {
+    long long now = time::milliseconds();
+    bool retained = false;
     for (auto it = ref_count_.begin(); it != ref_count_.end();) {
+      auto release_time = release_times_.find(it->first);
+      bool retain = !release_retained && release_time != release_times_.end() &&
+                    now < release_time->second;
       if (it->second)
         ++it;
+      else if (retain) {
+        retained = true;
+        ++it;
+      }
       else {
-        TypeFaceData type_face_data(it->first->data(), it->first->dataSize());
-        type_face_data_ref_count_[type_face_data]--;
-        if (type_face_data_ref_count_[type_face_data] == 0) {
-          type_face_data_ref_count_.erase(type_face_data);
-          type_face_data_lookup_.erase(type_face_data);
-        }
-
-        cache_.erase(it->first->id());
+        PackedFont* packed_font = it->first;
+        int type_face_id = packed_font->typeFaceId();
+        if (release_time != release_times_.end())
+          release_times_.erase(release_time);
+        cache_.erase(packedFontKey(type_face_id, packed_font->size(), packed_font->sdf()));
         it = ref_count_.erase(it);
+
+        if (--type_faces_[type_face_id].num_packed_fonts == 0)
+          removeTypeFace(type_face_id);
       }
     }
-    has_stale_fonts_ = false;
+    has_stale_fonts_ = retained;
   }
-}
\ No newline at end of file
+}
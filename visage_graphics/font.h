@@ -24,8 +24,15 @@
 #include "color.h"
 #include "graphics_utils.h"
 #include "visage_file_embed/embedded_file.h"
+#include "visage_utils/file_system.h"
 
+#include <algorithm>
+#include <bitset>
+#include <deque>
 #include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace visage {
@@ -43,12 +50,120 @@ namespace visage {
     const TypeFace* type_face = nullptr;
   };
 
+  class PackedGlyphTable {
+  public:
+    static constexpr int kPageBits = 8;
+    static constexpr int kPageSize = 1 << kPageBits;
+    static constexpr char32_t kNumDirectCharacters = 0x10000;
+    static constexpr int kNumPages = kNumDirectCharacters >> kPageBits;
+    static constexpr char32_t kEmptyKey = 0xffffffff;
+
+    PackedGlyphTable() { page(0); }
+
+    PackedGlyphTable(const PackedGlyphTable&) = delete;
+    PackedGlyphTable& operator=(const PackedGlyphTable&) = delete;
+
+    const PackedGlyph* find(char32_t character) const {
+      if (character < kNumDirectCharacters) {
+        const Page* page = pages_[character >> kPageBits].get();
+        int index = character & (kPageSize - 1);
+        if (page == nullptr || !page->used[index])
+          return nullptr;
+        return &page->glyphs[index];
+      }
+
+      if (hash_keys_.empty())
+        return nullptr;
+
+      for (int i = hashIndex(character);; i = (i + 1) & (hash_keys_.size() - 1)) {
+        if (hash_keys_[i] == character)
+          return hash_values_[i];
+        if (hash_keys_[i] == kEmptyKey)
+          return nullptr;
+      }
+    }
+
+    PackedGlyph* operator[](char32_t character) {
+      if (character < kNumDirectCharacters) {
+        Page* page = this->page(character >> kPageBits);
+        int index = character & (kPageSize - 1);
+        PackedGlyph* glyph = &page->glyphs[index];
+        if (!page->used[index]) {
+          page->used[index] = true;
+          entries_.emplace_back(character, glyph);
+        }
+        return glyph;
+      }
+
+      if (2 * (overflow_glyphs_.size() + 1) > hash_keys_.size())
+        growHash();
+
+      int i = hashIndex(character);
+      for (; hash_keys_[i] != kEmptyKey; i = (i + 1) & (hash_keys_.size() - 1)) {
+        if (hash_keys_[i] == character)
+          return hash_values_[i];
+      }
+
+      PackedGlyph* glyph = &overflow_glyphs_.emplace_back();
+      hash_keys_[i] = character;
+      hash_values_[i] = glyph;
+      entries_.emplace_back(character, glyph);
+      return glyph;
+    }
+
+    const std::vector<std::pair<char32_t, PackedGlyph*>>& entries() const { return entries_; }
+    int size() const { return entries_.size(); }
+
+  private:
+    struct Page {
+      PackedGlyph glyphs[kPageSize];
+      std::bitset<kPageSize> used;
+    };
+
+    Page* page(int index) {
+      if (pages_[index] == nullptr)
+        pages_[index] = std::make_unique<Page>();
+      return pages_[index].get();
+    }
+
+    int hashIndex(char32_t character) const {
+      return (character * 0x9e3779b1u) & (hash_keys_.size() - 1);
+    }
+
+    void growHash() {
+      std::vector<char32_t> keys = std::move(hash_keys_);
+      std::vector<PackedGlyph*> values = std::move(hash_values_);
+      int capacity = std::max<int>(16, 2 * keys.size());
+      hash_keys_.assign(capacity, kEmptyKey);
+      hash_values_.assign(capacity, nullptr);
+
+      for (int k = 0; k < keys.size(); ++k) {
+        if (keys[k] == kEmptyKey)
+          continue;
+
+        int i = hashIndex(keys[k]);
+        while (hash_keys_[i] != kEmptyKey)
+          i = (i + 1) & (capacity - 1);
+        hash_keys_[i] = keys[k];
+        hash_values_[i] = values[k];
+      }
+    }
+
+    std::unique_ptr<Page> pages_[kNumPages];
+    std::vector<char32_t> hash_keys_;
+    std::vector<PackedGlyph*> hash_values_;
+    std::deque<PackedGlyph> overflow_glyphs_;
+    std::vector<std::pair<char32_t, PackedGlyph*>> entries_;
+  };
+
   struct FontAtlasQuad {
     const PackedGlyph* packed_glyph;
     float x;
     float y;
     float width;
     float height;
+    // Index of the Text style plus one, 0 draws with the block's brush.
+    int style = 0;
   };
 
   class Font {
@@ -95,6 +210,8 @@ namespace visage {
     }
     Font withDpiScale(float dpi_scale) const;
     Font withSize(float size) const;
+    Font withKerning(bool kerning = true) const;
+    bool kerning() const { return kerning_; }
 
     int widthOverflowIndex(const char32_t* string, int string_length, float width,
                            bool round = false, int character_override = 0) const {
@@ -103,6 +220,9 @@ namespace visage {
     std::vector<int> lineBreaks(const char32_t* string, int length, float width) const {
       return nativeLineBreaks(string, length, width * dpiScale());
     }
+    int nextLineBreak(const char32_t* string, int length, int start, float width) const {
+      return nativeNextLineBreak(string, length, start, width * dpiScale());
+    }
 
     float stringWidth(const char32_t* string, int length, int character_override = 0) const {
       return nativeStringWidth(string, length, character_override) / dpiScale();
@@ -114,10 +234,16 @@ namespace visage {
     float capitalHeight() const { return nativeCapitalHeight() / dpiScale(); }
     float lowerDipHeight() const { return nativeLowerDipHeight() / dpiScale(); }
 
+    // Bitmap fonts of every type face and size share one glyph atlas, so text drawn in any of
+    // them batches together. Each distance field type face has its own atlas.
+    const void* atlasId() const;
     int atlasWidth() const;
     int atlasHeight() const;
+    int emojiAtlasWidth() const;
+    int emojiAtlasHeight() const;
     int size() const { return size_; }
     const bgfx::TextureHandle& textureHandle() const;
+    const bgfx::TextureHandle& emojiTextureHandle() const;
 
     void setVertexPositions(FontAtlasQuad* quads, const char32_t* text, int length, float x,
                             float y, float width, float height,
@@ -128,19 +254,27 @@ namespace visage {
                                      Justification justification = kCenter) const;
 
     const PackedFont* packedFont() const { return packed_font_; }
+    int nativeSize() const { return native_size_; }
+    bool sdf() const;
+    float glyphScale() const;
 
   private:
+    const float* kerningOffsets(const char32_t* string, int length,
+                                int character_override = 0) const;
     int nativeWidthOverflowIndex(const char32_t* string, int string_length, float width,
                                  bool round = false, int character_override = 0) const;
     float nativeStringWidth(const char32_t* string, int length, int character_override = 0) const;
     int nativeLineHeight() const;
     float nativeCapitalHeight() const;
     float nativeLowerDipHeight() const;
+    int nativeNextLineBreak(const char32_t* string, int length, int break_index, float width) const;
     std::vector<int> nativeLineBreaks(const char32_t* string, int length, float width) const;
+    Font withSameTypeFace(float size, float dpi_scale) const;
 
     float size_ = 0.0f;
     int native_size_ = 0;
     float dpi_scale_ = 0.0f;
+    bool kerning_ = false;
     PackedFont* packed_font_ = nullptr;
   };
 
@@ -150,10 +284,34 @@ namespace visage {
 
     ~FontCache();
 
+    static constexpr int kSdfSize = 64;
+    static constexpr int kSdfSpread = 8;
+
     static void clearStaleFonts() {
       if (instance()->has_stale_fonts_)
-        instance()->removeStaleFonts();
+        instance()->removeStaleFonts(false);
+    }
+
+    // Fonts no Font uses anymore are kept packed this many milliseconds before they're cleared,
+    // so an editor that's closed and reopened doesn't rasterize its glyphs again.
+    static void setRetainPeriod(int ms) { instance()->retain_period_ = ms; }
+    static int retainPeriod() { return instance()->retain_period_; }
+    static void releaseRetainedFonts() { instance()->removeStaleFonts(true); }
+
+    // Fonts at or above this native size share one signed-distance-field atlas per typeface.
+    // Zero disables distance field fonts.
+    static void setSdfThreshold(int native_size) { instance()->sdf_threshold_ = native_size; }
+    static int sdfThreshold() { return instance()->sdf_threshold_; }
+
+    // Packed glyphs are saved here when fonts are released and reloaded the next time the same
+    // font data and size are requested. An empty path disables the disk cache.
+    static void setDiskCacheDirectory(const File& directory) {
+      instance()->disk_cache_directory_ = directory;
     }
+    static const File& diskCacheDirectory() { return instance()->disk_cache_directory_; }
+    // Released fonts write their disk cache files on the shared thread pool. Blocks until the
+    // queued writes are done, for callers about to read the directory or exit.
+    static void flushDiskCache();
 
   private:
     struct TypeFaceData {
@@ -175,14 +333,23 @@ namespace visage {
       return &cache;
     }
 
-    static PackedFont* loadPackedFont(int size, const EmbeddedFile& font) {
-      std::string id = "embed: " + std::string(font.name) + " - " + std::to_string(size);
-      return instance()->createOrLoadPackedFont(id, size, font.data, font.size);
+    static bool useSdf(int size) {
+      return instance()->sdf_threshold_ > 0 && size >= instance()->sdf_threshold_;
+    }
+
+    // Packed fonts are cached by type face id and size. Sizes at or above the distance field
+    // threshold all share one packed font.
+    static uint64_t packedFontKey(int type_face_id, int size, bool sdf) {
+      return (static_cast<uint64_t>(type_face_id) << 32) | static_cast<uint32_t>(sdf ? -1 : size);
     }
 
+    static PackedFont* loadPackedFont(int size, const EmbeddedFile& font);
     static PackedFont* loadPackedFont(int size, const std::string& file_path);
     static PackedFont* loadPackedFont(const PackedFont* packed_font);
     static PackedFont* loadPackedFont(int size, const unsigned char* font_data, int data_size);
+    static PackedFont* loadPackedFont(int size, int type_face_id) {
+      return instance()->createOrLoadPackedFont(type_face_id, size);
+    }
 
     static void returnPackedFont(PackedFont* packed_font) {
       instance()->decrementPackedFont(packed_font);
@@ -190,16 +357,43 @@ namespace visage {
 
     FontCache();
 
-    PackedFont* incrementPackedFont(const std::string& id);
-    PackedFont* createOrLoadPackedFont(const std::string& id, int size,
-                                       const unsigned char* font_data, int data_size);
+    int findTypeFace(const unsigned char* font_data, int data_size) const;
+    int internTypeFace(const unsigned char* font_data, int data_size);
+    int internTypeFace(const EmbeddedFile& font);
+    int internTypeFace(std::unique_ptr<MappedFile> mapped_file);
+    void removeTypeFace(int type_face_id);
+    PackedFont* incrementPackedFont(PackedFont* packed_font);
+    PackedFont* createOrLoadPackedFont(int type_face_id, int size);
     void decrementPackedFont(PackedFont* packed_font);
-    void removeStaleFonts();
+    void removeStaleFonts(bool release_retained);
+
+    // Every size of a type face reads the same font data. Embedded fonts are used in place,
+    // font files are memory mapped and only raw data passed in by the caller is copied.
+    struct InternedTypeFace {
+      const unsigned char* data = nullptr;
+      int data_size = 0;
+      std::unique_ptr<unsigned char[]> copied_data;
+      std::unique_ptr<MappedFile> mapped_file;
+      int num_packed_fonts = 0;
+    };
+
+    int addTypeFace(InternedTypeFace type_face);
+
+    // Font data is interned once into a small integer id. Embedded fonts and font files are
+    // also found by pointer and path, so constructing, copying and resizing fonts never goes back
+    // to FreeType or builds string keys.
+    std::unordered_map<int, InternedTypeFace> type_faces_;
+    std::map<TypeFaceData, int> type_face_lookup_;
+    std::unordered_map<const unsigned char*, int> embedded_type_faces_;
+    std::unordered_map<std::string, int> file_type_faces_;
+    int next_type_face_ = 1;
 
-    std::map<std::string, std::unique_ptr<PackedFont>> cache_;
-    std::map<PackedFont*, int> ref_count_;
-    std::map<TypeFaceData, std::unique_ptr<unsigned char[]>> type_face_data_lookup_;
-    std::map<TypeFaceData, int> type_face_data_ref_count_;
+    std::unordered_map<uint64_t, std::unique_ptr<PackedFont>> cache_;
+    std::unordered_map<PackedFont*, int> ref_count_;
+    std::unordered_map<PackedFont*, long long> release_times_;
     bool has_stale_fonts_ = false;
+    int retain_period_ = 0;
+    int sdf_threshold_ = 0;
+    File disk_cache_directory_;
   };
 }
\ No newline at end of file
@@ -21,6 +21,11 @@
 
 #include "gradient.h"
 
+#include "palette.h"
+#include "resource_usage.h"
+#include "upload_memory.h"
+#include "visage_utils/binary_data.h"
+
 #include <bgfx/bgfx.h>
 
 namespace visage {
@@ -82,6 +87,7 @@ namespace visage {
     stream >> repeat >> reflect >> size;
     repeat_ = repeat;
     reflect_ = reflect;
+    hash_ = 0;
 
     positions_.resize(size);
     colors_.resize(size);
@@ -91,8 +97,40 @@ namespace visage {
       color.decode(stream);
   }
 
+  void Gradient::encodeBinary(BinaryWriter& writer) const {
+    writer.write(static_cast<unsigned char>(repeat_));
+    writer.write(static_cast<unsigned char>(reflect_));
+    writer.write(static_cast<unsigned int>(colors_.size()));
+    for (float position : positions_)
+      writer.write(position);
+    for (const Color& color : colors_)
+      color.encodeBinary(writer);
+  }
+
+  bool Gradient::decodeBinary(BinaryReader& reader) {
+    static constexpr size_t kStopBytes = sizeof(float) * (Color::kNumChannels + 2);
+    unsigned char repeat = 0, reflect = 0;
+    unsigned int size = 0;
+    reader.read(repeat);
+    reader.read(reflect);
+    if (!reader.read(size) || !reader.canRead(size * kStopBytes))
+      return reader.fail();
+
+    repeat_ = repeat;
+    reflect_ = reflect;
+    hash_ = 0;
+    positions_.resize(size);
+    colors_.resize(size);
+    for (auto& position : positions_)
+      reader.read(position);
+    for (Color& color : colors_)
+      color.decodeBinary(reader);
+    return !reader.failed();
+  }
+
   struct GradientAtlasTexture {
     bgfx::TextureHandle handle = { bgfx::kInvalidHandle };
+    TrackedResource memory;
 
     ~GradientAtlasTexture() {
       if (bgfx::isValid(handle))
@@ -121,13 +159,12 @@ namespace visage {
     if (resolution == 0)
       return;
 
-    std::unique_ptr<uint64_t[]> color_data = std::make_unique<uint64_t[]>(resolution);
-    float step = 1.0f / std::max(1, resolution - 1);
-    for (int i = 0; i < resolution; ++i)
-      color_data[i] = gradient->gradient.sample(i * step).toABGR16F();
+    std::unique_ptr<Color[]> colors = std::make_unique<Color[]>(resolution);
+    gradient->gradient.sample(colors.get(), resolution);
+    const bgfx::Memory* memory = UploadMemoryPool::instance().allocate(resolution * sizeof(uint64_t));
+    Color::toABGR16F(colors.get(), reinterpret_cast<uint64_t*>(memory->data), resolution);
 
-    bgfx::updateTexture2D(texture_->handle, 0, 0, gradient->x, gradient->y, resolution, 1,
-                          bgfx::copy(color_data.get(), resolution * sizeof(uint64_t)));
+    bgfx::updateTexture2D(texture_->handle, 0, 0, gradient->x, gradient->y, resolution, 1, memory);
   }
 
   void GradientAtlas::checkInit() {
@@ -135,14 +172,20 @@ namespace visage {
       texture_ = std::make_unique<GradientAtlasTexture>();
 
     if (!bgfx::isValid(texture_->handle)) {
-      texture_->handle = bgfx::createTexture2D(atlas_map_.width(), atlas_map_.height(), false, 1,
-                                               bgfx::TextureFormat::RGBA16F);
+      static constexpr bgfx::TextureFormat::Enum kFormat = bgfx::TextureFormat::RGBA16F;
+      int width = std::max(1, atlas_map_.width());
+      int height = std::max(1, atlas_map_.height());
+      texture_->handle = bgfx::createTexture2D(width, height, false, 1, kFormat);
+      texture_->memory.reset(ResourceCategory::GradientAtlas,
+                             ResourceTracker::textureBytes(width, height, kFormat));
     }
 
     if (repacked_) {
       repacked_ = false;
       for (auto& gradient : gradients_)
         updateGradient(gradient.second.get());
+      for (auto& slot : slots_)
+        updateGradient(slot.second.get());
     }
   }
 
@@ -155,6 +198,7 @@ namespace visage {
     int prev_height = atlas_map_.height();
     atlas_map_.pack();
     repacked_ = true;
+    pack_version_++;
     if (atlas_map_.width() != prev_width && atlas_map_.height() != prev_height)
       texture_.reset();
 
@@ -163,6 +207,11 @@ namespace visage {
       gradient.second->x = rect.x;
       gradient.second->y = rect.y;
     }
+    for (auto& slot : slots_) {
+      const PackedRect& rect = atlas_map_.rectForId(slot.second.get());
+      slot.second->x = rect.x;
+      slot.second->y = rect.y;
+    }
   }
 
   const bgfx::TextureHandle& GradientAtlas::colorTextureHandle() {
@@ -199,6 +248,35 @@ namespace visage {
     stream >> point2.y;
   }
 
+  void GradientPosition::encodeBinary(BinaryWriter& writer) const {
+    writer.write(static_cast<int>(shape));
+    writer.write(point1.x);
+    writer.write(point1.y);
+    writer.write(point2.x);
+    writer.write(point2.y);
+    writer.write(focal_radius);
+    writer.write(coefficientx2);
+    writer.write(coefficienty2);
+    writer.write(coefficientxy);
+  }
+
+  bool GradientPosition::decodeBinary(BinaryReader& reader) {
+    int shape_int = 0;
+    if (!reader.read(shape_int) || shape_int < 0 ||
+        shape_int > static_cast<int>(InterpolationShape::Radial))
+      return reader.fail();
+
+    shape = static_cast<InterpolationShape>(shape_int);
+    reader.read(point1.x);
+    reader.read(point1.y);
+    reader.read(point2.x);
+    reader.read(point2.y);
+    reader.read(focal_radius);
+    reader.read(coefficientx2);
+    reader.read(coefficienty2);
+    return reader.read(coefficientxy);
+  }
+
   std::string Brush::encode() const {
     std::ostringstream stream;
     encode(stream);
@@ -219,4 +297,20 @@ namespace visage {
     gradient_.decode(stream);
     position_.decode(stream);
   }
-}
\ No newline at end of file
+
+  void Brush::encodeBinary(BinaryWriter& writer) const {
+    gradient_.encodeBinary(writer);
+    position_.encodeBinary(writer);
+  }
+
+  bool Brush::decodeBinary(BinaryReader& reader) {
+    return gradient_.decodeBinary(reader) && position_.decodeBinary(reader);
+  }
+
+  Color PackedBrush::paletteSolidColor() const {
+    const Brush* brush = palette_->findColor(palette_override_, palette_color_);
+    if (brush && isSolid(brush->gradient(), brush->position()))
+      return brush->gradient().sample(0.0f);
+    return solid_color_;
+  }
+}
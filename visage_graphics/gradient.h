@@ -23,15 +23,17 @@
 
 #include "color.h"
 #include "graphics_utils.h"
+#include "theme.h"
 
 #include <functional>
 #include <iosfwd>
-#include <map>
 #include <numeric>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace visage {
+  class Palette;
   struct GradientAtlasTexture;
 
   class Gradient {
@@ -63,6 +65,10 @@ namespace visage {
       return 0;
     }
 
+    struct Hash {
+      size_t operator()(const Gradient& gradient) const { return gradient.hash(); }
+    };
+
     static Gradient fromSampleFunction(int resolution, const std::function<Color(float)>& sample_function) {
       VISAGE_ASSERT(resolution > 0);
       Gradient result;
@@ -76,8 +82,16 @@ namespace visage {
     }
 
     static Gradient interpolate(const Gradient& from, const Gradient& to, float t) {
-      auto sample_function = [&](float s) { return from.sample(s).interpolateWith(to.sample(s), t); };
-      return fromSampleFunction(std::max(from.resolution(), to.resolution()), sample_function);
+      int resolution = std::max(from.resolution(), to.resolution());
+      std::vector<Color> to_colors(resolution);
+      Gradient result;
+      result.colors_.resize(resolution);
+      from.sample(result.colors_.data(), resolution);
+      to.sample(to_colors.data(), resolution);
+      Color* colors = result.colors_.data();
+      Color::interpolate(colors, to_colors.data(), colors, resolution, t);
+      result.evenlySpace();
+      return result;
     }
 
     Gradient() = default;
@@ -97,7 +111,16 @@ namespace visage {
       return true;
     }
 
+    bool isOpaque() const {
+      for (auto& color : colors_) {
+        if (color.alpha() < 1.0f)
+          return false;
+      }
+      return !colors_.empty();
+    }
+
     void evenlySpace() {
+      hash_ = 0;
       positions_.resize(colors_.size(), 0.0f);
       if (colors_.size() > 1) {
         float step = 1.0f / (colors_.size() - 1);
@@ -130,9 +153,52 @@ namespace visage {
       return colors_[index - 1].interpolateWith(colors_[index], local_t);
     }
 
+    // Samples count evenly spaced points from 0 to 1, walking the stops instead of searching them.
+    void sample(Color* results, int count) const {
+      if (count <= 0)
+        return;
+      if (colors_.size() <= 1) {
+        std::fill(results, results + count, colors_.empty() ? Color() : colors_[0]);
+        return;
+      }
+
+      int num_positions = positions_.size();
+      float step = 1.0f / std::max(1, count - 1);
+      int index = 0;
+      for (int i = 0; i < count; ++i) {
+        float t = i * step;
+        if (reflect_) {
+          t *= 2.0f;
+          if (t > 1.0f)
+            t = 2.0f - t;
+        }
+
+        while (index < num_positions && positions_[index] <= t)
+          index++;
+        while (index > 0 && positions_[index - 1] > t)
+          index--;
+
+        if (index == 0)
+          results[i] = colors_.front();
+        else if (index == num_positions)
+          results[i] = colors_.back();
+        else {
+          float t0 = positions_[index - 1];
+          float local_t = (t - t0) / std::max(0.000001f, positions_[index] - t0);
+          results[i] = colors_[index - 1].interpolateWith(colors_[index], local_t);
+        }
+      }
+    }
+
     int numColors() const { return colors_.size(); }
-    void setRepeat(bool repeat) { repeat_ = repeat; }
-    void setReflect(bool reflect) { reflect_ = reflect; }
+    void setRepeat(bool repeat) {
+      repeat_ = repeat;
+      hash_ = 0;
+    }
+    void setReflect(bool reflect) {
+      reflect_ = reflect;
+      hash_ = 0;
+    }
     bool repeat() const { return repeat_; }
     bool reflect() const { return reflect_; }
 
@@ -143,6 +209,7 @@ namespace visage {
     }
 
     void setResolution(int resolution) {
+      hash_ = 0;
       if (!colors_.empty())
         colors_.resize(resolution, colors_.back());
       else
@@ -150,11 +217,33 @@ namespace visage {
     }
 
     bool operator<(const Gradient& other) const { return compare(*this, other) < 0; }
+    bool operator==(const Gradient& other) const {
+      return hash() == other.hash() && compare(*this, other) == 0;
+    }
+    bool operator!=(const Gradient& other) const { return !(*this == other); }
+
+    // Cached until the gradient changes, so copies of a gradient hash for free.
+    uint64_t hash() const {
+      if (hash_ == 0)
+        hash_ = computeHash();
+      return hash_;
+    }
 
     const std::vector<Color>& colors() const { return colors_; }
     void setColor(int index, const Color& color) {
       VISAGE_ASSERT(index < colors_.size());
       colors_[index] = color;
+      hash_ = 0;
+    }
+
+    // Makes this a single color, keeping the color storage so it can be reset every frame.
+    void setSolid(const Color& color) {
+      colors_.assign(1, color);
+      positions_.assign(1, 0.0f);
+      custom_stops_ = false;
+      repeat_ = false;
+      reflect_ = false;
+      hash_ = 0;
     }
 
     void addColorStop(const Color& color, float position) {
@@ -164,14 +253,29 @@ namespace visage {
       positions_.insert(it, position);
       colors_.insert(colors_.begin() + index, color);
       custom_stops_ = true;
+      hash_ = 0;
     }
 
     Gradient interpolateWith(const Gradient& other, float t) const {
       return interpolate(*this, other, t);
     }
 
+    // Samples the gradient into _resolution_ evenly spaced colors, keeping its repeat modes.
+    Gradient resampled(int resolution) const {
+      Gradient unreflected = *this;
+      unreflected.reflect_ = false;
+      Gradient result;
+      result.colors_.resize(resolution);
+      unreflected.sample(result.colors_.data(), resolution);
+      result.evenlySpace();
+      result.repeat_ = repeat_;
+      result.reflect_ = reflect_;
+      return result;
+    }
+
     Gradient withMultipliedAlpha(float mult) const {
       Gradient result = *this;
+      result.hash_ = 0;
 
       for (int i = 0; i < colors_.size(); ++i)
         result.colors_[i] = colors_[i].withAlpha(colors_[i].alpha() * mult);
@@ -180,17 +284,47 @@ namespace visage {
     }
 
     Gradient operator*(const Gradient& other) const {
-      auto sample_function = [&](float s) { return sample(s) * other.sample(s); };
-      return fromSampleFunction(std::max(resolution(), other.resolution()), sample_function);
+      int resolution = std::max(this->resolution(), other.resolution());
+      std::vector<Color> other_colors(resolution);
+      Gradient result;
+      result.colors_.resize(resolution);
+      sample(result.colors_.data(), resolution);
+      other.sample(other_colors.data(), resolution);
+      Color* colors = result.colors_.data();
+      Color::multiply(colors, other_colors.data(), colors, resolution);
+      result.evenlySpace();
+      return result;
     }
 
     std::string encode() const;
     void encode(std::ostringstream& stream) const;
     void decode(const std::string& data);
     void decode(std::istringstream& stream);
+    void encodeBinary(BinaryWriter& writer) const;
+    bool decodeBinary(BinaryReader& reader);
 
   private:
+    uint64_t computeHash() const {
+      auto mix = [](uint64_t value) {
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+        return value ^ (value >> 31);
+      };
+
+      uint64_t result = mix(colors_.size() * 4 + (repeat_ ? 2 : 0) + (reflect_ ? 1 : 0));
+      for (const Color& color : colors_)
+        result = mix(result ^ color.hash());
+      for (float position : positions_) {
+        position += 0.0f;
+        uint32_t position_bits = 0;
+        std::memcpy(&position_bits, &position, sizeof(position_bits));
+        result = mix(result ^ position_bits);
+      }
+      return result ? result : 1;
+    }
+
     void sort() {
+      hash_ = 0;
       if (colors_.size() <= 1)
         return;
 
@@ -213,6 +347,7 @@ namespace visage {
     bool custom_stops_ = false;
     bool repeat_ = false;
     bool reflect_ = false;
+    mutable uint64_t hash_ = 0;
   };
 
   class GradientAtlas {
@@ -223,6 +358,7 @@ namespace visage {
       Gradient gradient;
       int x = 0;
       int y = 0;
+      bool slot = false;
     };
 
     struct PackedGradientReference {
@@ -252,9 +388,15 @@ namespace visage {
         return reference_->packed_gradient_rect->gradient;
       }
 
+      PackedGradient() = default;
       explicit PackedGradient(std::shared_ptr<PackedGradientReference> reference) :
           reference_(std::move(reference)) { }
 
+      bool valid() const { return reference_ && !reference_->atlas.expired(); }
+      const PackedGradientRect* rect() const {
+        return reference_ ? reference_->packed_gradient_rect : nullptr;
+      }
+
     private:
       std::shared_ptr<PackedGradientReference> reference_;
     };
@@ -263,7 +405,8 @@ namespace visage {
     ~GradientAtlas();
 
     PackedGradient addGradient(const Gradient& gradient) {
-      if (gradients_.count(gradient) == 0) {
+      auto found = gradients_.find(gradient);
+      if (found == gradients_.end()) {
         std::unique_ptr<PackedGradientRect> packed_gradient_rect = std::make_unique<PackedGradientRect>(gradient);
         if (!atlas_map_.addRect(packed_gradient_rect.get(), gradient.resolution(), 1))
           resize();
@@ -272,18 +415,50 @@ namespace visage {
         packed_gradient_rect->x = rect.x;
         packed_gradient_rect->y = rect.y;
         updateGradient(packed_gradient_rect.get());
-        gradients_[gradient] = std::move(packed_gradient_rect);
+        found = gradients_.emplace(gradient, std::move(packed_gradient_rect)).first;
       }
-      stale_gradients_.erase(gradient);
+      else if (!stale_gradients_.empty())
+        stale_gradients_.erase(gradient);
 
-      if (auto reference = references_[gradient].lock())
+      std::weak_ptr<PackedGradientReference>& weak_reference = references_[gradient];
+      if (auto reference = weak_reference.lock())
         return PackedGradient(reference);
 
-      auto reference = std::make_shared<PackedGradientReference>(reference_, gradients_[gradient].get());
-      references_[gradient] = reference;
+      auto reference = std::make_shared<PackedGradientReference>(reference_, found->second.get());
+      weak_reference = reference;
       return PackedGradient(reference);
     }
 
+    // Adds a row that isn't shared with equal gradients and can be rewritten in place with
+    // updateGradientSlot. The row keeps the resolution of _gradient_.
+    PackedGradient addGradientSlot(const Gradient& gradient) {
+      auto packed_gradient_rect = std::make_unique<PackedGradientRect>(gradient);
+      packed_gradient_rect->slot = true;
+      if (!atlas_map_.addRect(packed_gradient_rect.get(), gradient.resolution(), 1))
+        resize();
+
+      const PackedRect& rect = atlas_map_.rectForId(packed_gradient_rect.get());
+      packed_gradient_rect->x = rect.x;
+      packed_gradient_rect->y = rect.y;
+      updateGradient(packed_gradient_rect.get());
+      const PackedGradientRect* key = packed_gradient_rect.get();
+      slots_[key] = std::move(packed_gradient_rect);
+      return PackedGradient(std::make_shared<PackedGradientReference>(reference_, key));
+    }
+
+    // Rewrites a slot's row with _gradient_ resampled to the row's resolution. Brushes on the
+    // slot keep their atlas position, so this is one row upload and never a repack.
+    void updateGradientSlot(const PackedGradient& slot, const Gradient& gradient) {
+      auto found = slots_.find(slot.rect());
+      VISAGE_ASSERT(found != slots_.end());
+      if (found == slots_.end())
+        return;
+
+      PackedGradientRect* packed_gradient_rect = found->second.get();
+      packed_gradient_rect->gradient = gradient.resampled(packed_gradient_rect->gradient.resolution());
+      updateGradient(packed_gradient_rect);
+    }
+
     void clearStaleGradients() {
       for (const auto& stale : stale_gradients_) {
         gradients_.erase(stale.first);
@@ -291,6 +466,12 @@ namespace visage {
         references_.erase(stale.first);
       }
       stale_gradients_.clear();
+
+      for (const PackedGradientRect* stale : stale_slots_) {
+        atlas_map_.removeRect(stale);
+        slots_.erase(stale);
+      }
+      stale_slots_.clear();
     }
 
     void checkInit();
@@ -301,6 +482,7 @@ namespace visage {
     }
     int width() const { return atlas_map_.width(); }
     int height() const { return atlas_map_.height(); }
+    int packVersion() const { return pack_version_; }
 
     const bgfx::TextureHandle& colorTextureHandle();
 
@@ -314,15 +496,21 @@ namespace visage {
     }
 
     void removeGradient(const PackedGradientRect* packed_gradient_rect) {
-      removeGradient(packed_gradient_rect->gradient);
+      if (packed_gradient_rect->slot)
+        stale_slots_.push_back(packed_gradient_rect);
+      else
+        removeGradient(packed_gradient_rect->gradient);
     }
 
-    std::map<Gradient, std::weak_ptr<PackedGradientReference>> references_;
-    std::map<Gradient, std::unique_ptr<PackedGradientRect>> gradients_;
-    std::map<Gradient, const PackedGradientRect*> stale_gradients_;
+    std::unordered_map<Gradient, std::weak_ptr<PackedGradientReference>, Gradient::Hash> references_;
+    std::unordered_map<Gradient, std::unique_ptr<PackedGradientRect>, Gradient::Hash> gradients_;
+    std::unordered_map<Gradient, const PackedGradientRect*, Gradient::Hash> stale_gradients_;
+    std::unordered_map<const PackedGradientRect*, std::unique_ptr<PackedGradientRect>> slots_;
+    std::vector<const PackedGradientRect*> stale_slots_;
 
     bool hdr_ = false;
     bool repacked_ = false;
+    int pack_version_ = 0;
     PackedAtlasMap<const PackedGradientRect*> atlas_map_;
     std::unique_ptr<GradientAtlasTexture> texture_;
     std::shared_ptr<GradientAtlas*> reference_;
@@ -367,6 +555,13 @@ namespace visage {
     float coefficienty2 = 0.0f;
     float coefficientxy = 0.0f;
 
+    bool operator==(const GradientPosition& other) const {
+      return shape == other.shape && point1 == other.point1 && point2 == other.point2 &&
+             focal_radius == other.focal_radius && coefficientx2 == other.coefficientx2 &&
+             coefficienty2 == other.coefficienty2 && coefficientxy == other.coefficientxy;
+    }
+    bool operator!=(const GradientPosition& other) const { return !(*this == other); }
+
     GradientPosition interpolateWith(const GradientPosition& other, float t) const {
       return interpolate(*this, other, t);
     }
@@ -402,6 +597,8 @@ namespace visage {
     void encode(std::ostringstream& stream) const;
     void decode(const std::string& data);
     void decode(std::istringstream& stream);
+    void encodeBinary(BinaryWriter& writer) const;
+    bool decodeBinary(BinaryReader& reader);
 
     GradientPosition operator*(float mult) const {
       GradientPosition result = *this;
@@ -521,6 +718,11 @@ namespace visage {
     Brush(Gradient gradient, const GradientPosition& position) :
         gradient_(std::move(gradient)), position_(position) { }
 
+    void setSolid(const Color& color) {
+      gradient_.setSolid(color);
+      position_ = GradientPosition(GradientPosition::InterpolationShape::Solid);
+    }
+
     Brush interpolateWith(const Brush& other, float t) const {
       return interpolate(*this, other, t);
     }
@@ -529,6 +731,11 @@ namespace visage {
       return { gradient_.withMultipliedAlpha(mult), position_ };
     }
 
+    bool operator==(const Brush& other) const {
+      return position_ == other.position_ && gradient_ == other.gradient_;
+    }
+    bool operator!=(const Brush& other) const { return !(*this == other); }
+
     const Gradient& gradient() const { return gradient_; }
     Gradient& gradient() { return gradient_; }
     const GradientPosition& position() const { return position_; }
@@ -538,7 +745,10 @@ namespace visage {
     void encode(std::ostringstream& stream) const;
     void decode(const std::string& data);
     void decode(std::istringstream& stream);
+    void encodeBinary(BinaryWriter& writer) const;
+    bool decodeBinary(BinaryReader& reader);
     bool isNone() const { return gradient_.isNone(); }
+    bool isOpaque() const { return gradient_.isOpaque(); }
 
     void transform(const Transform& transform) { position_ = position_.transformed(transform); }
 
@@ -549,11 +759,58 @@ namespace visage {
     VISAGE_LEAK_CHECKER(Brush)
   };
 
+  // A gradient for animated brushes that keeps one row of the gradient atlas. Every
+  // setGradient() rewrites that row in place instead of adding an atlas entry per intermediate
+  // gradient, so blending colors on many frames doesn't churn or repack the atlas. Frames drawn
+  // with the slot still need a redraw to show the change.
+  class GradientSlot {
+  public:
+    static constexpr int kDefaultResolution = 64;
+
+    explicit GradientSlot(int resolution = kDefaultResolution) :
+        resolution_(std::clamp(resolution, 1, Gradient::kMaxGradientResolution)) { }
+    GradientSlot(const GradientSlot&) = delete;
+    GradientSlot& operator=(const GradientSlot&) = delete;
+
+    void setGradient(const Gradient& gradient) {
+      gradient_ = gradient.resampled(resolution_);
+      if (packed_.valid())
+        atlas_->updateGradientSlot(packed_, gradient_);
+    }
+    const Gradient& gradient() const { return gradient_; }
+    int resolution() const { return resolution_; }
+
+    // The slot's row in _atlas_, added the first time it's drawn with that atlas.
+    const GradientAtlas::PackedGradient& packedGradient(GradientAtlas* atlas) {
+      if (atlas_ != atlas || !packed_.valid()) {
+        if (gradient_.numColors() == 0)
+          gradient_ = Gradient(Color()).resampled(resolution_);
+        atlas_ = atlas;
+        packed_ = atlas->addGradientSlot(gradient_);
+      }
+      return packed_;
+    }
+
+  private:
+    int resolution_ = kDefaultResolution;
+    Gradient gradient_;
+    GradientAtlas* atlas_ = nullptr;
+    GradientAtlas::PackedGradient packed_;
+  };
+
   class PackedBrush {
   public:
     static void computeVertexGradientTexturePositions(GradientTexturePosition& result,
                                                       const PackedBrush* brush) {
-      if (brush) {
+      if (brush && brush->solid_) {
+        Color color = brush->solidColor();
+        float mult = color.hdr() / Color::kGradientNormalization;
+        result.from_x = -1.0f - color.red() * mult;
+        result.from_y = -1.0f - color.green() * mult;
+        result.to_x = -1.0f - color.blue() * mult;
+        result.to_y = -1.0f - color.alpha();
+      }
+      else if (brush) {
         float atlas_x_scale = 1.0f / brush->atlasWidth();
         float atlas_y_scale = 1.0f / brush->atlasHeight();
         const auto& gradient = brush->gradient()->gradient();
@@ -633,23 +890,71 @@ namespace visage {
       }
     }
 
+    // Solid brushes don't take an atlas entry. Their color is encoded in the gradient texture
+    // position as -1 - color, which the shaders recognize by the negative coordinate.
+    static bool isSolid(const Gradient& gradient, const GradientPosition& position) {
+      return position.shape == GradientPosition::InterpolationShape::Solid && gradient.numColors() <= 1;
+    }
+
     PackedBrush(GradientAtlas* atlas, const Gradient& gradient, const GradientPosition& position) :
-        atlas_(atlas), position_(position), gradient_(atlas->addGradient(gradient)) { }
+        atlas_(atlas), position_(position) {
+      if (isSolid(gradient, position)) {
+        solid_ = true;
+        solid_color_ = gradient.sample(0.0f);
+      }
+      else
+        gradient_ = atlas->addGradient(gradient);
+    }
+
+    PackedBrush(GradientAtlas* atlas, GradientSlot& slot, const GradientPosition& position) :
+        atlas_(atlas), position_(position), gradient_(slot.packedGradient(atlas)) { }
 
+    PackedBrush() = default;
     PackedBrush(GradientAtlas* atlas, const Brush& brush) :
-        atlas_(atlas), position_(brush.position()), gradient_(atlas->addGradient(brush.gradient())) { }
+        PackedBrush(atlas, brush.gradient(), brush.position()) { }
+
+    bool solid() const { return solid_; }
+
+    // Binds a solid brush to a palette color so replaying recorded drawing picks up edits and
+    // remaps of that color without calling draw() again.
+    void bindPaletteColor(const Palette* palette, theme::OverrideId override_id,
+                          theme::ColorId color_id) {
+      if (solid_) {
+        palette_ = palette;
+        palette_override_ = override_id;
+        palette_color_ = color_id;
+      }
+    }
+
+    static uint64_t paletteColorVersion() { return palette_color_version_; }
+    static void paletteColorsChanged() { palette_color_version_++; }
+
+    Color solidColor() const { return palette_ ? paletteSolidColor() : solid_color_; }
 
     const GradientAtlas::PackedGradient* gradient() const { return &gradient_; }
     const GradientPosition& position() const { return position_; }
     int atlasWidth() const { return atlas_->width(); }
     int atlasHeight() const { return atlas_->height(); }
 
-    Brush originalBrush() const { return Brush(gradient_.gradient(), position_); }
+    Brush originalBrush() const {
+      if (solid_)
+        return Brush(Gradient(solidColor()), position_);
+      return Brush(gradient_.gradient(), position_);
+    }
 
   private:
+    Color paletteSolidColor() const;
+
     GradientAtlas* atlas_ = nullptr;
     GradientPosition position_;
     GradientAtlas::PackedGradient gradient_;
+    bool solid_ = false;
+    Color solid_color_;
+    const Palette* palette_ = nullptr;
+    theme::OverrideId palette_override_;
+    theme::ColorId palette_color_;
+
+    inline static uint64_t palette_color_version_ = 0;
 
     VISAGE_LEAK_CHECKER(PackedBrush)
   };
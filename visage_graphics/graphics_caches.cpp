@@ -21,10 +21,58 @@
 
 #include "graphics_caches.h"
 
+#include "resource_usage.h"
+
+#include <algorithm>
+#include <atomic>
 #include <bgfx/bgfx.h>
+#include <cstring>
 #include <map>
+#include <tuple>
 
 namespace visage {
+  struct UniformViewValue {
+    int view = -1;
+    float values[4] {};
+  };
+
+  static thread_local bgfx::Encoder* thread_encoder = nullptr;
+  static thread_local std::vector<UniformViewValue> thread_view_values;
+
+  ScopedEncoder::ScopedEncoder() : previous_(thread_encoder) {
+    encoder_ = bgfx::begin(true);
+    VISAGE_ASSERT(encoder_);
+    thread_encoder = encoder_;
+    thread_view_values.clear();
+  }
+
+  ScopedEncoder::~ScopedEncoder() {
+    thread_encoder = previous_;
+    thread_view_values.clear();
+    if (encoder_)
+      bgfx::end(encoder_);
+  }
+
+  bgfx::Encoder* ScopedEncoder::current() {
+    return thread_encoder ? thread_encoder : bgfx::begin();
+  }
+
+  static DrawCounts draw_counts;
+
+  const DrawCounts& drawCounts() {
+    return draw_counts;
+  }
+
+  void submitDraw(int submit_pass, bgfx::ProgramHandle program, int num_vertices) {
+    submitDraw(submit_pass, program, num_vertices, BGFX_DISCARD_ALL);
+  }
+
+  void submitDraw(int submit_pass, bgfx::ProgramHandle program, int num_vertices, uint8_t discard) {
+    draw_counts.draw_calls++;
+    draw_counts.vertices += num_vertices;
+    encoder()->submit(submit_pass, program, 0, discard);
+  }
+
   struct ShaderCacheMap {
     std::map<const char*, bgfx::ShaderHandle> cache;
     std::map<const char*, bgfx::ShaderHandle> originals;
@@ -88,6 +136,8 @@ namespace visage {
     std::map<const char*, std::map<const char*, ProgramCache::ShaderPair>> shader_lookup;
     std::map<const char*, std::map<const char*, bgfx::ProgramHandle>> cache;
     std::map<const char*, std::map<const char*, bgfx::ProgramHandle>> originals;
+    std::map<const char*, std::map<const char*, ProgramCache::ShaderPair>> recorded;
+    bool recording = false;
   };
 
   ProgramCache::ProgramCache() {
@@ -112,7 +162,37 @@ namespace visage {
     return results;
   }
 
+  std::vector<ProgramCache::ShaderPair> ProgramCache::listRecorded() const {
+    std::vector<ShaderPair> results;
+    for (const auto& vertex : cache_->recorded) {
+      for (const auto& fragment : vertex.second)
+        results.push_back(fragment.second);
+    }
+    return results;
+  }
+
+  void ProgramCache::preload(const std::vector<ShaderPair>& programs) const {
+    for (const ShaderPair& program : programs)
+      findOrCreate(program.vertex, program.fragment);
+  }
+
+  void ProgramCache::record(bool recording) const {
+    cache_->recording = recording;
+    if (recording)
+      cache_->recorded.clear();
+  }
+
   bgfx::ProgramHandle& ProgramCache::handle(const EmbeddedFile& vertex, const EmbeddedFile& fragment) const {
+    if (cache_->recording) {
+      auto vertex_data = reinterpret_cast<const char*>(vertex.data);
+      auto fragment_data = reinterpret_cast<const char*>(fragment.data);
+      cache_->recorded[vertex_data][fragment_data] = { vertex, fragment };
+    }
+    return findOrCreate(vertex, fragment);
+  }
+
+  bgfx::ProgramHandle& ProgramCache::findOrCreate(const EmbeddedFile& vertex,
+                                                  const EmbeddedFile& fragment) const {
     auto vertex_data = reinterpret_cast<const char*>(vertex.data);
     auto fragment_data = reinterpret_cast<const char*>(fragment.data);
 
@@ -167,6 +247,8 @@ namespace visage {
 
   struct UniformCacheMap {
     std::map<std::string, bgfx::UniformHandle> cache;
+    std::atomic<int> uploads = 0;
+    std::atomic<int> skipped_uploads = 0;
   };
 
   UniformCache::UniformCache() {
@@ -193,4 +275,155 @@ namespace visage {
     cache_->cache[name] = bgfx::createUniform(name, bgfx_type, size);
     return cache_->cache[name];
   }
-}
\ No newline at end of file
+
+  void UniformCache::uploadForView(int view, const bgfx::UniformHandle& uniform,
+                                   const float* values) const {
+    if (uniform.idx >= thread_view_values.size())
+      thread_view_values.resize(uniform.idx + 1);
+
+    UniformViewValue& last = thread_view_values[uniform.idx];
+    if (last.view == view && std::memcmp(last.values, values, sizeof(last.values)) == 0) {
+      cache_->skipped_uploads++;
+      return;
+    }
+
+    last.view = view;
+    std::memcpy(last.values, values, sizeof(last.values));
+    cache_->uploads++;
+    encoder()->setUniform(uniform, values);
+  }
+
+  void UniformCache::upload(const bgfx::UniformHandle& uniform, const void* values, int num) const {
+    if (uniform.idx < thread_view_values.size())
+      thread_view_values[uniform.idx].view = -1;
+
+    cache_->uploads++;
+    encoder()->setUniform(uniform, values, num);
+  }
+
+  void UniformCache::resetViews() const {
+    for (auto& view_value : thread_view_values)
+      view_value.view = -1;
+  }
+
+  int UniformCache::uploads() const {
+    return cache_->uploads;
+  }
+
+  int UniformCache::skippedUploads() const {
+    return cache_->skipped_uploads;
+  }
+
+  void UniformCache::clearStats() const {
+    cache_->uploads = 0;
+    cache_->skipped_uploads = 0;
+  }
+
+  struct FrameBufferPoolMap {
+    struct Entry {
+      bgfx::FrameBufferHandle handle = BGFX_INVALID_HANDLE;
+      ResourceCategory category = ResourceCategory::EffectFrameBuffers;
+      bool kept = false;
+      int last_frame = -1;
+    };
+
+    std::map<std::tuple<int, int, int>, std::vector<Entry>> buffers;
+    int frame = 0;
+  };
+
+  FrameBufferPool::FrameBufferPool() {
+    pool_ = std::make_unique<FrameBufferPoolMap>();
+  }
+
+  static long long frameBufferBytes(const std::tuple<int, int, int>& key) {
+    return ResourceTracker::textureBytes(std::get<0>(key), std::get<1>(key), std::get<2>(key));
+  }
+
+  FrameBufferPool::~FrameBufferPool() {
+    for (const auto& buffers : pool_->buffers) {
+      for (const auto& entry : buffers.second) {
+        bgfx::destroy(entry.handle);
+        ResourceTracker::remove(entry.category, frameBufferBytes(buffers.first));
+      }
+    }
+  }
+
+  bgfx::FrameBufferHandle FrameBufferPool::scratchBuffer(int width, int height, int format) {
+    return instance()->acquire(width, height, format, false, ResourceCategory::EffectFrameBuffers);
+  }
+
+  bgfx::FrameBufferHandle FrameBufferPool::keepBuffer(int width, int height, int format,
+                                                      ResourceCategory category) {
+    return instance()->acquire(width, height, format, true, category);
+  }
+
+  void FrameBufferPool::releaseBuffer(bgfx::FrameBufferHandle handle) {
+    instance()->release(handle);
+  }
+
+  bgfx::FrameBufferHandle FrameBufferPool::acquire(int width, int height, int format, bool keep,
+                                                   ResourceCategory category) const {
+    static constexpr uint64_t kFrameBufferFlags = BGFX_TEXTURE_RT | BGFX_SAMPLER_U_CLAMP |
+                                                  BGFX_SAMPLER_V_CLAMP;
+
+    auto& buffers = pool_->buffers[{ width, height, format }];
+    long long bytes = ResourceTracker::textureBytes(width, height, format);
+    for (auto& entry : buffers) {
+      if (!entry.kept && entry.last_frame != pool_->frame) {
+        if (entry.category != category) {
+          ResourceTracker::remove(entry.category, bytes);
+          ResourceTracker::add(category, bytes);
+          entry.category = category;
+        }
+        entry.kept = keep;
+        entry.last_frame = pool_->frame;
+        return entry.handle;
+      }
+    }
+
+    FrameBufferPoolMap::Entry entry;
+    entry.handle = bgfx::createFrameBuffer(width, height, static_cast<bgfx::TextureFormat::Enum>(format),
+                                           kFrameBufferFlags);
+    entry.category = category;
+    entry.kept = keep;
+    entry.last_frame = pool_->frame;
+    buffers.push_back(entry);
+    ResourceTracker::add(category, bytes);
+    return entry.handle;
+  }
+
+  void FrameBufferPool::release(bgfx::FrameBufferHandle handle) const {
+    for (auto& buffers : pool_->buffers) {
+      for (auto& entry : buffers.second) {
+        if (entry.handle.idx == handle.idx) {
+          entry.kept = false;
+          entry.last_frame = pool_->frame;
+          return;
+        }
+      }
+    }
+  }
+
+  void FrameBufferPool::advanceFrame() const {
+    pool_->frame++;
+    for (auto it = pool_->buffers.begin(); it != pool_->buffers.end();) {
+      auto& buffers = it->second;
+      auto idle = std::partition(buffers.begin(), buffers.end(), [this](const auto& entry) {
+        return entry.kept || pool_->frame - entry.last_frame <= kMaxIdleFrames;
+      });
+      for (auto entry = idle; entry != buffers.end(); ++entry) {
+        bgfx::destroy(entry->handle);
+        ResourceTracker::remove(entry->category, frameBufferBytes(it->first));
+      }
+      buffers.erase(idle, buffers.end());
+      it = buffers.empty() ? pool_->buffers.erase(it) : std::next(it);
+    }
+  }
+
+  int FrameBufferPool::size() const {
+    int size = 0;
+    for (const auto& buffers : pool_->buffers)
+      size += buffers.second.size();
+    return size;
+  }
+}
@@ -22,12 +22,47 @@
 #pragma once
 
 #include "graphics_utils.h"
+#include "resource_usage.h"
 #include "visage_file_embed/embedded_file.h"
 
 namespace visage {
   struct ShaderCacheMap;
   struct ProgramCacheMap;
   struct UniformCacheMap;
+  struct FrameBufferPoolMap;
+
+  // Draw state and submits are recorded through the encoder bound to the calling thread. The
+  // thread that owns bgfx falls back to the main encoder, any other thread encoding views must
+  // hold a ScopedEncoder, which is handed back to bgfx before the frame ends.
+  class ScopedEncoder {
+  public:
+    ScopedEncoder();
+    ~ScopedEncoder();
+
+    ScopedEncoder(const ScopedEncoder&) = delete;
+    ScopedEncoder& operator=(const ScopedEncoder&) = delete;
+
+    static bgfx::Encoder* current();
+
+  private:
+    bgfx::Encoder* encoder_ = nullptr;
+    bgfx::Encoder* previous_ = nullptr;
+  };
+
+  inline bgfx::Encoder* encoder() {
+    return ScopedEncoder::current();
+  }
+
+  // Running totals of what went through submitDraw. Canvas records how much they grow over each
+  // submit, so its frame statistics don't depend on the renderer reporting anything back.
+  struct DrawCounts {
+    long long draw_calls = 0;
+    long long vertices = 0;
+  };
+
+  const DrawCounts& drawCounts();
+  void submitDraw(int submit_pass, bgfx::ProgramHandle program, int num_vertices);
+  void submitDraw(int submit_pass, bgfx::ProgramHandle program, int num_vertices, uint8_t discard);
 
   class ShaderCache {
   public:
@@ -105,13 +140,26 @@ namespace visage {
 
     static std::vector<ShaderPair> programList() { return instance()->listPrograms(); }
 
+    // Creates the programs ahead of their first draw. bgfx compiles them on the render thread
+    // so with a background graphics thread this doesn't block the caller.
+    static void warmUp(const std::vector<ShaderPair>& programs) { instance()->preload(programs); }
+
+    // While recording, every program requested through programHandle is remembered so an app can
+    // generate its warm up list from a real session.
+    static void setRecording(bool recording) { instance()->record(recording); }
+    static std::vector<ShaderPair> recordedPrograms() { return instance()->listRecorded(); }
+
   private:
     ProgramCache();
     ~ProgramCache();
 
     std::vector<ShaderPair> listPrograms() const;
+    std::vector<ShaderPair> listRecorded() const;
+    void preload(const std::vector<ShaderPair>& programs) const;
+    void record(bool recording) const;
 
     bgfx::ProgramHandle& handle(const EmbeddedFile& vertex, const EmbeddedFile& fragment) const;
+    bgfx::ProgramHandle& findOrCreate(const EmbeddedFile& vertex, const EmbeddedFile& fragment) const;
     void reload(const EmbeddedFile& vertex, const EmbeddedFile& fragment) const;
     void reloadAll(const char* shader_data) const;
     void reloadAll(const std::string& shader_name) const;
@@ -139,12 +187,70 @@ namespace visage {
       return instance()->handle(name, type);
     }
 
+    // Uploads a vec4 unless the same value was already set in this view since the last frame.
+    // bgfx keeps uniform values between draws, so this is only safe in Sequential views where
+    // every other write to the uniform goes through setUniform or setViewUniform. Values are
+    // tracked per encoding thread, so a view must be encoded from a single thread.
+    static void setViewUniform(int view, const bgfx::UniformHandle& uniform, const float* values) {
+      instance()->uploadForView(view, uniform, values);
+    }
+
+    // Always uploads and forgets the value tracked for the uniform.
+    static void setUniform(const bgfx::UniformHandle& uniform, const void* values, int num = 1) {
+      instance()->upload(uniform, values, num);
+    }
+
+    static void nextFrame() { instance()->resetViews(); }
+    static int numUploads() { return instance()->uploads(); }
+    static int numSkippedUploads() { return instance()->skippedUploads(); }
+    static void resetStats() { instance()->clearStats(); }
+
   private:
     UniformCache();
     ~UniformCache();
 
     bgfx::UniformHandle& handle(const char* name, Type type, int size = 1) const;
+    void uploadForView(int view, const bgfx::UniformHandle& uniform, const float* values) const;
+    void upload(const bgfx::UniformHandle& uniform, const void* values, int num) const;
+    void resetViews() const;
+    int uploads() const;
+    int skippedUploads() const;
+    void clearStats() const;
 
     std::unique_ptr<UniformCacheMap> cache_;
   };
+
+  // Render targets shared by all post effects and intermediate layers, keyed by size and format.
+  // Scratch buffers are handed to one caller per frame and their contents only last until the
+  // next frame. Kept buffers belong to the caller until they're released. A buffer's memory is
+  // tracked under the category of whoever holds it last.
+  class FrameBufferPool {
+  public:
+    static constexpr int kMaxIdleFrames = 60;
+
+    static FrameBufferPool* instance() {
+      static FrameBufferPool pool;
+      return &pool;
+    }
+
+    static bgfx::FrameBufferHandle scratchBuffer(int width, int height, int format);
+    static bgfx::FrameBufferHandle keepBuffer(
+        int width, int height, int format,
+        ResourceCategory category = ResourceCategory::EffectFrameBuffers);
+    static void releaseBuffer(bgfx::FrameBufferHandle handle);
+    static void nextFrame() { instance()->advanceFrame(); }
+    static int numBuffers() { return instance()->size(); }
+
+  private:
+    FrameBufferPool();
+    ~FrameBufferPool();
+
+    bgfx::FrameBufferHandle acquire(int width, int height, int format, bool keep,
+                                    ResourceCategory category) const;
+    void release(bgfx::FrameBufferHandle handle) const;
+    void advanceFrame() const;
+    int size() const;
+
+    std::unique_ptr<FrameBufferPoolMap> pool_;
+  };
 }
\ No newline at end of file
@@ -262,6 +262,8 @@ namespace visage {
 
   AtlasPacker::AtlasPacker() : data_(std::make_unique<PackedAtlasData>()) { }
 
+  AtlasPacker::AtlasPacker(AtlasPacker&& other) noexcept = default;
+  AtlasPacker& AtlasPacker::operator=(AtlasPacker&& other) noexcept = default;
   AtlasPacker::~AtlasPacker() = default;
 
   bool AtlasPacker::addRect(PackedRect& rect) {
@@ -308,6 +310,96 @@ namespace visage {
     return packed_;
   }
 
+  void ShelfPacker::reset(int width, int height) {
+    shelves_.clear();
+    slots_.clear();
+    recycled_slots_.clear();
+    width_ = width;
+    height_ = height;
+    shelves_end_ = 0;
+    num_allocated_ = 0;
+  }
+
+  int ShelfPacker::createSlot(int shelf_index, int x, int width) {
+    Slot slot = { shelf_index, x, width };
+    if (recycled_slots_.empty()) {
+      slots_.push_back(slot);
+      return slots_.size() - 1;
+    }
+
+    int index = recycled_slots_.back();
+    recycled_slots_.pop_back();
+    slots_[index] = slot;
+    return index;
+  }
+
+  int ShelfPacker::allocateInShelf(int shelf_index, int width) {
+    Shelf& shelf = shelves_[shelf_index];
+    for (int i = 0; i < shelf.free_slots.size(); ++i) {
+      int slot = shelf.free_slots[i];
+      if (slots_[slot].width >= width) {
+        shelf.free_slots[i] = shelf.free_slots.back();
+        shelf.free_slots.pop_back();
+        shelf.used++;
+        return slot;
+      }
+    }
+
+    if (shelf.end + width > width_)
+      return kInvalidSlot;
+
+    int slot = createSlot(shelf_index, shelf.end, width);
+    shelf.end += width;
+    shelf.used++;
+    return slot;
+  }
+
+  int ShelfPacker::allocate(int width, int height, PackedRect& rect) {
+    width = std::max(1, width);
+    height = std::max(1, height);
+    if (width > width_)
+      return kInvalidSlot;
+
+    int shelf_height = (height + kShelfRounding - 1) / kShelfRounding * kShelfRounding;
+    int max_shelf_height = shelf_height + std::max(kShelfRounding, shelf_height / 4);
+
+    int slot = kInvalidSlot;
+    for (int i = 0; i < shelves_.size() && slot == kInvalidSlot; ++i) {
+      if (shelves_[i].height >= shelf_height && shelves_[i].height <= max_shelf_height)
+        slot = allocateInShelf(i, width);
+    }
+
+    if (slot == kInvalidSlot) {
+      if (shelves_end_ + shelf_height > height_)
+        return kInvalidSlot;
+
+      Shelf shelf;
+      shelf.y = shelves_end_;
+      shelf.height = shelf_height;
+      shelves_end_ += shelf_height;
+      shelves_.push_back(std::move(shelf));
+      slot = allocateInShelf(shelves_.size() - 1, width);
+    }
+
+    rect.x = slots_[slot].x;
+    rect.y = shelves_[slots_[slot].shelf].y;
+    num_allocated_++;
+    return slot;
+  }
+
+  void ShelfPacker::release(int slot) {
+    VISAGE_ASSERT(slot >= 0 && slot < slots_.size());
+    Shelf& shelf = shelves_[slots_[slot].shelf];
+    num_allocated_--;
+    shelf.used--;
+    shelf.free_slots.push_back(slot);
+    if (shelf.used == 0) {
+      recycled_slots_.insert(recycled_slots_.end(), shelf.free_slots.begin(), shelf.free_slots.end());
+      shelf.free_slots.clear();
+      shelf.end = 0;
+    }
+  }
+
   bgfx::VertexLayout& UvVertex::layout() {
     static bgfx::VertexLayout layout;
     static bool initialized = false;
@@ -30,6 +30,7 @@
 #include <vector>
 
 namespace bgfx {
+  struct Encoder;
   struct VertexLayout;
   struct TextureHandle;
   struct ShaderHandle;
@@ -51,8 +52,14 @@ namespace visage {
     Mult,
     MaskAdd,
     MaskRemove,
+    StencilClear,
+    StencilClip,
   };
 
+  inline bool isStencilBlendMode(BlendMode blend_mode) {
+    return blend_mode == BlendMode::StencilClear || blend_mode == BlendMode::StencilClip;
+  }
+
   static constexpr float kHdrColorRange = 4.0f;
   static constexpr float kHdrColorMultiplier = 1.0f / kHdrColorRange;
   static constexpr int kVerticesPerQuad = 4;
@@ -84,6 +91,8 @@ namespace visage {
   class AtlasPacker {
   public:
     AtlasPacker();
+    AtlasPacker(AtlasPacker&& other) noexcept;
+    AtlasPacker& operator=(AtlasPacker&& other) noexcept;
     ~AtlasPacker();
 
     bool addRect(PackedRect& rect);
@@ -101,6 +110,47 @@ namespace visage {
     int rect_index_ = 0;
   };
 
+  class ShelfPacker {
+  public:
+    static constexpr int kShelfRounding = 8;
+    static constexpr int kInvalidSlot = -1;
+
+    void reset(int width, int height);
+    int allocate(int width, int height, PackedRect& rect);
+    void release(int slot);
+    void grow(int height) { height_ = std::max(height_, height); }
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    int numAllocated() const { return num_allocated_; }
+
+  private:
+    struct Shelf {
+      int y = 0;
+      int height = 0;
+      int end = 0;
+      int used = 0;
+      std::vector<int> free_slots;
+    };
+
+    struct Slot {
+      int shelf = 0;
+      int x = 0;
+      int width = 0;
+    };
+
+    int allocateInShelf(int shelf_index, int width);
+    int createSlot(int shelf_index, int x, int width);
+
+    std::vector<Shelf> shelves_;
+    std::vector<Slot> slots_;
+    std::vector<int> recycled_slots_;
+    int width_ = 0;
+    int height_ = 0;
+    int shelves_end_ = 0;
+    int num_allocated_ = 0;
+  };
+
   template<typename T = int>
   class PackedAtlasMap {
   public:
@@ -124,7 +174,7 @@ namespace visage {
       lookup_.erase(id);
     }
 
-    void pack(int start_width = kDefaultWidth, int start_height = kDefaultWidth) {
+    bool pack(int start_width = kDefaultWidth, int start_height = kDefaultWidth) {
       static constexpr int kMaxMultiples = 8;
       start_width = std::max(kDefaultWidth, start_width);
       start_height = std::max(kDefaultWidth, start_height);
@@ -137,16 +187,28 @@ namespace visage {
           VISAGE_ASSERT(false);
       }
       else if (!packed_rects_.empty()) {
+        int last_width = width_;
+        int last_height = height_;
         bool packed = false;
         for (int m = 0; !packed && m < kMaxMultiples; ++m) {
           width_ = start_width << m;
           height_ = start_height << m;
           if (fixed_width_)
             width_ = fixed_width_;
+          if (max_size_ && m > 0 && std::max(width_, height_) > max_size_)
+            break;
           packed = packer_.pack(packed_rects_, width_, height_);
         }
+
+        if (!packed && max_size_) {
+          width_ = last_width;
+          height_ = last_height;
+          return false;
+        }
         VISAGE_ASSERT(packed);
+        return packed;
       }
+      return true;
     }
 
     void clear() {
@@ -186,10 +248,25 @@ namespace visage {
     }
 
     void fixWidth(int width) { fixed_width_ = width; }
+    // With a max size, pack() gives up instead of growing past it and keeps the previous
+    // dimensions, leaving the caller to start another texture.
+    void setMaxSize(int max_size) { max_size_ = max_size; }
+    int maxSize() const { return max_size_; }
     int width() const { return width_; }
     int height() const { return height_; }
     bool packed() const { return packer_.packed(); }
     int numRects() const { return packed_rects_.size(); }
+    bool empty() const { return lookup_.empty(); }
+
+    // Removed rects keep their space until the next pack().
+    int removedArea() const {
+      int area = 0;
+      for (const PackedRect& rect : packed_rects_)
+        area += rect.w * rect.h;
+      for (const auto& packed : lookup_)
+        area -= packed_rects_[packed.second].w * packed_rects_[packed.second].h;
+      return area;
+    }
 
   private:
     void checkRemovedRects() {
@@ -206,6 +283,7 @@ namespace visage {
     }
 
     int fixed_width_ = 0;
+    int max_size_ = 0;
     int width_ = 0;
     int height_ = 0;
     std::vector<PackedRect> packed_rects_;
@@ -279,6 +357,46 @@ namespace visage {
     static bgfx::VertexLayout& layout();
   };
 
+  struct ShapeInstance {
+    float x;
+    float y;
+    float width;
+    float height;
+    float clamp_left;
+    float clamp_top;
+    float clamp_right;
+    float clamp_bottom;
+    GradientTexturePosition gradient_texture_position;
+    float gradient_from_x;
+    float gradient_from_y;
+    float gradient_to_x;
+    float gradient_to_y;
+    float thickness;
+    float fade;
+    float value1;
+    float value2;
+  };
+
+  struct TextInstance {
+    float x;
+    float y;
+    float width;
+    float height;
+    float texture_x;
+    float texture_y;
+    float texture_width;
+    float texture_height;
+    float clamp_left;
+    float clamp_top;
+    float clamp_right;
+    float clamp_bottom;
+    GradientTexturePosition gradient_texture_position;
+    float gradient_from_x;
+    float gradient_from_y;
+    float gradient_to_x;
+    float gradient_to_y;
+  };
+
   struct ComplexShapeVertex {
     float x;
     float y;
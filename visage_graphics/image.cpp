@@ -21,24 +21,506 @@
 
 #include "image.h"
 
+#include "graphics_caches.h"
+#include "resource_usage.h"
+#include "upload_memory.h"
+#include "visage_utils/thread_utils.h"
+#include "visage_utils/trace.h"
+
 #include <bgfx/bgfx.h>
 #include <bimg/decode.h>
+#include <algorithm>
 #include <bx/allocator.h>
 #include <cstring>
 
 #define STB_IMAGE_RESIZE_IMPLEMENTATION
 #include <stb_image_resize2.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define VISAGE_DATA_CONVERT_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define VISAGE_DATA_CONVERT_NEON 1
+#endif
+
 namespace visage {
   static bx::DefaultAllocator* allocator() {
     static bx::DefaultAllocator allocator;
     return &allocator;
   }
 
+  static std::vector<unsigned char> decodeImage(const Image& image, int width, int height) {
+    static constexpr int kChannels = 4;
+
+    bimg::ImageContainer* image_container = bimg::imageParse(allocator(), image.data, image.data_size,
+                                                             bimg::TextureFormat::RGBA8);
+    if (image_container == nullptr)
+      return {};
+
+    auto image_data = static_cast<const unsigned char*>(image_container->m_data);
+    std::vector<unsigned char> pixels(width * height * kChannels);
+    if (image_container->m_width == width && image_container->m_height == height)
+      std::memcpy(pixels.data(), image_data, pixels.size());
+    else {
+      stbir_resize_uint8_srgb(image_data, image_container->m_width, image_container->m_height,
+                              image_container->m_width * kChannels, pixels.data(), width, height,
+                              width * kChannels, STBIR_RGBA);
+    }
+    bimg::imageFree(image_container);
+    return pixels;
+  }
+
+  static int readBigEndian16(const unsigned char* data) {
+    return (data[0] << 8) | data[1];
+  }
+
+  static int readBigEndian32(const unsigned char* data) {
+    return (data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+  }
+
+  static bool encodedImageSize(const Image& image, int& width, int& height) {
+    static constexpr unsigned char kPngSignature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+    const unsigned char* data = image.data;
+    int size = image.data_size;
+    if (size >= 24 && std::memcmp(data, kPngSignature, sizeof(kPngSignature)) == 0 &&
+        std::memcmp(data + 12, "IHDR", 4) == 0) {
+      width = readBigEndian32(data + 16);
+      height = readBigEndian32(data + 20);
+      return width > 0 && height > 0;
+    }
+
+    if (size < 4 || data[0] != 0xff || data[1] != 0xd8)
+      return false;
+
+    int position = 2;
+    while (position + 4 <= size) {
+      if (data[position] != 0xff)
+        return false;
+
+      int marker = data[position + 1];
+      if (marker == 0xff) {
+        position++;
+        continue;
+      }
+      if (marker == 0x01 || (marker >= 0xd0 && marker <= 0xd8)) {
+        position += 2;
+        continue;
+      }
+
+      int length = readBigEndian16(data + position + 2);
+      bool start_of_frame = marker >= 0xc0 && marker <= 0xcf && marker != 0xc4 && marker != 0xc8 &&
+                            marker != 0xcc;
+      if (start_of_frame) {
+        if (position + 9 > size)
+          return false;
+
+        height = readBigEndian16(data + position + 5);
+        width = readBigEndian16(data + position + 7);
+        return width > 0 && height > 0;
+      }
+      position += 2 + length;
+    }
+    return false;
+  }
+
+  static bgfx::TextureFormat::Enum compressedTextureFormat(const Image& image, int& width, int& height) {
+    static constexpr unsigned char kKtxSignature[] = { 0xab, 'K', 'T', 'X', ' ', '1', '1', 0xbb };
+
+    bool ktx = image.data_size >= sizeof(kKtxSignature) &&
+               std::memcmp(image.data, kKtxSignature, sizeof(kKtxSignature)) == 0;
+    bool dds = image.data_size >= 4 && std::memcmp(image.data, "DDS ", 4) == 0;
+    if (!ktx && !dds)
+      return bgfx::TextureFormat::Unknown;
+
+    bimg::ImageContainer container;
+    if (!bimg::imageParse(container, image.data, image.data_size) || !bimg::isCompressed(container.m_format))
+      return bgfx::TextureFormat::Unknown;
+
+    auto format = static_cast<bgfx::TextureFormat::Enum>(container.m_format);
+    if ((bgfx::getCaps()->formats[format] & BGFX_CAPS_FORMAT_TEXTURE_2D) == 0)
+      return bgfx::TextureFormat::Unknown;
+
+    width = container.m_width;
+    height = container.m_height;
+    return format;
+  }
+
+  static const bgfx::Memory* compressedTextureMemory(const Image& image) {
+    bimg::ImageContainer container;
+    bimg::ImageMip mip;
+    if (!bimg::imageParse(container, image.data, image.data_size) ||
+        !bimg::imageGetRawData(container, 0, 0, image.data, image.data_size, mip)) {
+      VISAGE_ASSERT(false);
+      return nullptr;
+    }
+    return UploadMemoryPool::instance().copy(mip.m_data, mip.m_size);
+  }
+
+  const unsigned char* DecodedImageCache::find(const Image& image, int width, int height) {
+    auto found = lookup_.find(image);
+    if (found == lookup_.end())
+      return nullptr;
+
+    if (found->second->width != width || found->second->height != height) {
+      remove(image);
+      return nullptr;
+    }
+
+    entries_.splice(entries_.begin(), entries_, found->second);
+    return found->second->pixels.data();
+  }
+
+  void DecodedImageCache::add(const Image& image, int width, int height,
+                              std::vector<unsigned char> pixels) {
+    remove(image);
+    if (pixels.size() > max_bytes_)
+      return;
+
+    bytes_ += pixels.size();
+    entries_.push_front({ image, width, height, std::move(pixels) });
+    lookup_[image] = entries_.begin();
+    evict();
+  }
+
+  void DecodedImageCache::remove(const Image& image) {
+    auto found = lookup_.find(image);
+    if (found == lookup_.end())
+      return;
+
+    bytes_ -= found->second->pixels.size();
+    entries_.erase(found->second);
+    lookup_.erase(found);
+  }
+
+  void DecodedImageCache::clear() {
+    entries_.clear();
+    lookup_.clear();
+    bytes_ = 0;
+  }
+
+  void DecodedImageCache::evict() {
+    while (bytes_ > max_bytes_ && !entries_.empty()) {
+      bytes_ -= entries_.back().pixels.size();
+      lookup_.erase(entries_.back().image);
+      entries_.pop_back();
+    }
+  }
+
+  ShadowCache::Mask* ShadowCache::mask(float rounding, float shadow_width) {
+    rounding = quantize(rounding);
+    shadow_width = quantize(shadow_width);
+    int mask_extent = extent(rounding, shadow_width);
+    if (mask_extent > kMaxExtent || shadow_width <= 0.0f)
+      return nullptr;
+
+    std::pair<int, int> key(std::round(rounding * kStepsPerPixel),
+                            std::round(shadow_width * kStepsPerPixel));
+    Mask& mask = masks_[key];
+    mask.last_used = frame_;
+    if (mask.pixels)
+      return &mask;
+
+    mask.rounding = rounding;
+    mask.shadow_width = shadow_width;
+    mask.extent = mask_extent;
+
+    // Same falloff as the analytic shadow, sampled at pixel centers from the top left corner.
+    int size = mask_extent + 1;
+    mask.pixels = std::make_shared<std::vector<unsigned char>>(size * size * 4, 0xff);
+    unsigned char* alpha = mask.pixels->data() + 3;
+    for (int y = 0; y < size; ++y) {
+      float offset_y = rounding - y - 1.0f;
+      for (int x = 0; x < size; ++x) {
+        float offset_x = rounding - x - 1.0f;
+        float outside = std::sqrt(std::max(offset_x, 0.0f) * std::max(offset_x, 0.0f) +
+                                  std::max(offset_y, 0.0f) * std::max(offset_y, 0.0f));
+        float distance = std::min(std::max(offset_x, offset_y), 0.0f) + outside - rounding;
+        float t = std::clamp(-distance / shadow_width, 0.0f, 1.0f);
+        *alpha = std::round(255.0f * t * t * (3.0f - 2.0f * t));
+        alpha += 4;
+      }
+    }
+    return &mask;
+  }
+
+  void ShadowCache::nextFrame() {
+    frame_++;
+    for (auto it = masks_.begin(); it != masks_.end();) {
+      if (frame_ - it->second.last_used > kRetainedFrames)
+        it = masks_.erase(it);
+      else
+        ++it;
+    }
+  }
+
+  static uint16_t floatToHalf(float value) {
+    static constexpr uint32_t kHalfMax = (127 + 16) << 23;
+    static constexpr uint32_t kMinNormal = (127 - 14) << 23;
+    static constexpr uint32_t kSubnormalMagic = ((127 - 15) + (23 - 10) + 1) << 23;
+
+    uint32_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = bits & 0x80000000u;
+    bits ^= sign;
+
+    uint32_t result = 0;
+    if (bits >= kHalfMax)
+      result = bits > (255u << 23) ? 0x7e00 : 0x7c00;
+    else if (bits < kMinNormal) {
+      float magic = 0.0f;
+      std::memcpy(&magic, &kSubnormalMagic, sizeof(magic));
+      float absolute = 0.0f;
+      std::memcpy(&absolute, &bits, sizeof(absolute));
+      float rounded = absolute + magic;
+      std::memcpy(&result, &rounded, sizeof(result));
+      result -= kSubnormalMagic;
+    }
+    else {
+      uint32_t mantissa_odd = (bits >> 13) & 1;
+      result = (bits + (static_cast<uint32_t>(15 - 127) << 23) + 0xfff + mantissa_odd) >> 13;
+    }
+    return static_cast<uint16_t>(result | (sign >> 16));
+  }
+
+  static unsigned char floatToUNorm8(float value) {
+    return static_cast<unsigned char>(std::min(1.0f, std::max(0.0f, value)) * 255.0f + 0.5f);
+  }
+
+  static void convertToHalf(const float* source, uint16_t* dest, int num) {
+    int i = 0;
+#if VISAGE_DATA_CONVERT_SSE2
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    const __m128i half_max = _mm_set1_epi32((127 + 16) << 23);
+    const __m128i min_normal = _mm_set1_epi32((127 - 14) << 23);
+    const __m128i subnormal_magic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+    const __m128i normal_bias = _mm_set1_epi32(0xfff - ((127 - 15) << 23));
+    const __m128i nan_bit = _mm_set1_epi32(0x200);
+    const __m128i infinity = _mm_set1_epi32(0x7c00);
+
+    for (; i + 8 <= num; i += 8) {
+      __m128i halves[2];
+      for (int h = 0; h < 2; ++h) {
+        __m128 value = _mm_loadu_ps(source + i + 4 * h);
+        __m128 sign = _mm_and_ps(value, sign_mask);
+        __m128 absolute = _mm_xor_ps(value, sign);
+        __m128i bits = _mm_castps_si128(absolute);
+
+        __m128i is_nan = _mm_castps_si128(_mm_cmpunord_ps(absolute, absolute));
+        __m128i is_regular = _mm_cmpgt_epi32(half_max, bits);
+        __m128i special = _mm_or_si128(_mm_and_si128(is_nan, nan_bit), infinity);
+
+        __m128i is_subnormal = _mm_cmpgt_epi32(min_normal, bits);
+        __m128 subnormal_rounded = _mm_add_ps(absolute, _mm_castsi128_ps(subnormal_magic));
+        __m128i subnormal = _mm_sub_epi32(_mm_castps_si128(subnormal_rounded), subnormal_magic);
+
+        __m128i mantissa_odd = _mm_srai_epi32(_mm_slli_epi32(bits, 31 - 13), 31);
+        __m128i normal = _mm_add_epi32(bits, normal_bias);
+        normal = _mm_srli_epi32(_mm_sub_epi32(normal, mantissa_odd), 13);
+
+        __m128i result = _mm_or_si128(_mm_and_si128(subnormal, is_subnormal),
+                                      _mm_andnot_si128(is_subnormal, normal));
+        result = _mm_or_si128(_mm_and_si128(result, is_regular), _mm_andnot_si128(is_regular, special));
+        halves[h] = _mm_or_si128(result, _mm_srai_epi32(_mm_castps_si128(sign), 16));
+      }
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), _mm_packs_epi32(halves[0], halves[1]));
+    }
+#elif VISAGE_DATA_CONVERT_NEON
+    for (; i + 4 <= num; i += 4)
+      vst1_u16(dest + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(source + i))));
+#endif
+
+    for (; i < num; ++i)
+      dest[i] = floatToHalf(source[i]);
+  }
+
+  static void convertToUNorm8(const float* source, unsigned char* dest, int num) {
+    int i = 0;
+#if VISAGE_DATA_CONVERT_SSE2
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(255.0f);
+    const __m128 round = _mm_set1_ps(0.5f);
+    for (; i + 16 <= num; i += 16) {
+      __m128i words[4];
+      for (int w = 0; w < 4; ++w) {
+        __m128 value = _mm_min_ps(one, _mm_max_ps(zero, _mm_loadu_ps(source + i + 4 * w)));
+        words[w] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, scale), round));
+      }
+      __m128i low = _mm_packs_epi32(words[0], words[1]);
+      __m128i high = _mm_packs_epi32(words[2], words[3]);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), _mm_packus_epi16(low, high));
+    }
+#elif VISAGE_DATA_CONVERT_NEON
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t scale = vdupq_n_f32(255.0f);
+    const float32x4_t round = vdupq_n_f32(0.5f);
+    for (; i + 8 <= num; i += 8) {
+      uint16x4_t words[2];
+      for (int w = 0; w < 2; ++w) {
+        float32x4_t value = vminq_f32(one, vmaxq_f32(zero, vld1q_f32(source + i + 4 * w)));
+        words[w] = vmovn_u32(vcvtq_u32_f32(vmlaq_f32(round, value, scale)));
+      }
+      vst1_u8(dest + i, vmovn_u16(vcombine_u16(words[0], words[1])));
+    }
+#endif
+
+    for (; i < num; ++i)
+      dest[i] = floatToUNorm8(source[i]);
+  }
+
+  static void reduceMinMaxPairs(const float* min_source, const float* max_source, float* min_dest,
+                                float* max_dest, int num_pairs) {
+    int i = 0;
+#if VISAGE_DATA_CONVERT_SSE2
+    for (; i + 4 <= num_pairs; i += 4) {
+      __m128 mins0 = _mm_loadu_ps(min_source + 2 * i);
+      __m128 mins1 = _mm_loadu_ps(min_source + 2 * i + 4);
+      __m128 even_mins = _mm_shuffle_ps(mins0, mins1, _MM_SHUFFLE(2, 0, 2, 0));
+      __m128 odd_mins = _mm_shuffle_ps(mins0, mins1, _MM_SHUFFLE(3, 1, 3, 1));
+      _mm_storeu_ps(min_dest + i, _mm_min_ps(even_mins, odd_mins));
+
+      __m128 maxes0 = _mm_loadu_ps(max_source + 2 * i);
+      __m128 maxes1 = _mm_loadu_ps(max_source + 2 * i + 4);
+      __m128 even_maxes = _mm_shuffle_ps(maxes0, maxes1, _MM_SHUFFLE(2, 0, 2, 0));
+      __m128 odd_maxes = _mm_shuffle_ps(maxes0, maxes1, _MM_SHUFFLE(3, 1, 3, 1));
+      _mm_storeu_ps(max_dest + i, _mm_max_ps(even_maxes, odd_maxes));
+    }
+#elif VISAGE_DATA_CONVERT_NEON
+    for (; i + 4 <= num_pairs; i += 4) {
+      float32x4x2_t mins = vld2q_f32(min_source + 2 * i);
+      float32x4x2_t maxes = vld2q_f32(max_source + 2 * i);
+      vst1q_f32(min_dest + i, vminq_f32(mins.val[0], mins.val[1]));
+      vst1q_f32(max_dest + i, vmaxq_f32(maxes.val[0], maxes.val[1]));
+    }
+#endif
+
+    for (; i < num_pairs; ++i) {
+      min_dest[i] = std::min(min_source[2 * i], min_source[2 * i + 1]);
+      max_dest[i] = std::max(max_source[2 * i], max_source[2 * i + 1]);
+    }
+  }
+
+  static void reduceMinMaxRange(const float* min_source, const float* max_source, int source_count,
+                                float* min_dest, float* max_dest, int start, int end) {
+    int num_pairs = source_count / 2;
+    int pairs_end = std::min(end, num_pairs);
+    if (pairs_end > start) {
+      reduceMinMaxPairs(min_source + 2 * start, max_source + 2 * start, min_dest + start,
+                        max_dest + start, pairs_end - start);
+    }
+
+    if (source_count % 2 && end > num_pairs) {
+      min_dest[num_pairs] = min_source[2 * num_pairs];
+      max_dest[num_pairs] = max_source[2 * num_pairs];
+    }
+  }
+
+  struct GraphData::MinMaxPyramid {
+    std::vector<std::vector<float>> mins;
+    std::vector<std::vector<float>> maxes;
+    GraphData decimated;
+    int decimated_level = -1;
+  };
+
+  bool GraphData::updatePyramid() const {
+    if (pyramid_ == nullptr) {
+      pyramid_ = std::make_shared<MinMaxPyramid>();
+      for (int count = (num_points_ + 1) / 2;; count = (count + 1) / 2) {
+        pyramid_->mins.emplace_back(count);
+        pyramid_->maxes.emplace_back(count);
+        if (count <= 1)
+          break;
+      }
+      pyramid_dirty_start_ = 0;
+      pyramid_dirty_end_ = num_points_;
+    }
+
+    if (pyramid_dirty_start_ >= pyramid_dirty_end_)
+      return false;
+
+    const float* min_source = values_.values();
+    const float* max_source = values_.values();
+    int source_count = num_points_;
+    int start = pyramid_dirty_start_ / 2;
+    int end = (pyramid_dirty_end_ + 1) / 2;
+    for (int level = 0; level < pyramid_->mins.size(); ++level) {
+      std::vector<float>& mins = pyramid_->mins[level];
+      std::vector<float>& maxes = pyramid_->maxes[level];
+      reduceMinMaxRange(min_source, max_source, source_count, mins.data(), maxes.data(), start,
+                        end);
+      min_source = mins.data();
+      max_source = maxes.data();
+      source_count = mins.size();
+      start /= 2;
+      end = (end + 1) / 2;
+    }
+
+    pyramid_dirty_start_ = 0;
+    pyramid_dirty_end_ = 0;
+    return true;
+  }
+
+  const GraphData& GraphData::decimated(int max_points) const {
+    if (ring_ || max_points < 2 || num_points_ <= max_points)
+      return *this;
+
+    bool changed = updatePyramid();
+    int level = 0;
+    int num_levels = pyramid_->mins.size();
+    while (level + 1 < num_levels && 2 * pyramid_->mins[level].size() > max_points)
+      ++level;
+
+    GraphData& result = pyramid_->decimated;
+    if (!changed && level == pyramid_->decimated_level)
+      return result;
+
+    const std::vector<float>& mins = pyramid_->mins[level];
+    const std::vector<float>& maxes = pyramid_->maxes[level];
+    int num_buckets = mins.size();
+    result.setPrecision(precision_);
+    if (result.numPoints() != 2 * num_buckets)
+      result.setNumPoints(2 * num_buckets);
+    for (int i = 0; i < num_buckets; ++i) {
+      result.set(2 * i, mins[i]);
+      result.set(2 * i + 1, maxes[i]);
+    }
+    pyramid_->decimated_level = level;
+    return result;
+  }
+
+  static bgfx::TextureFormat::Enum dataTextureFormat(ImageAtlas::DataType data_type) {
+    switch (data_type) {
+    case ImageAtlas::DataType::Float32: return bgfx::TextureFormat::R32F;
+    case ImageAtlas::DataType::Float16: return bgfx::TextureFormat::R16F;
+    case ImageAtlas::DataType::UNorm8: return bgfx::TextureFormat::R8;
+    default: return bgfx::TextureFormat::RGBA8;
+    }
+  }
+
   class ImageAtlasTexture {
   public:
     explicit ImageAtlasTexture(int width, int height, ImageAtlas::DataType data_type) :
-        width_(width), height_(height), data_type_(data_type) { }
+        width_(width), height_(height), format_(dataTextureFormat(data_type)) { }
+
+    ImageAtlasTexture(const Image& compressed_image, int width, int height,
+                      bgfx::TextureFormat::Enum format) :
+        width_(width), height_(height), format_(format), compressed_image_(compressed_image) { }
+
+    static std::unique_ptr<ImageAtlasTexture> mipmapped(int width, int height) {
+      auto texture = std::make_unique<ImageAtlasTexture>(width, height, ImageAtlas::DataType::RGBA8);
+      texture->mipmapped_ = true;
+      return texture;
+    }
+
+    static std::unique_ptr<ImageAtlasTexture> blitDestination(int width, int height,
+                                                              ImageAtlas::DataType data_type) {
+      auto texture = std::make_unique<ImageAtlasTexture>(width, height, data_type);
+      texture->blit_destination_ = true;
+      return texture;
+    }
 
     ~ImageAtlasTexture() { destroyHandle(); }
 
@@ -47,6 +529,7 @@ namespace visage {
         bgfx::destroy(texture_handle_);
 
       texture_handle_ = BGFX_INVALID_HANDLE;
+      memory_.reset();
     }
 
     bool hasHandle() const { return bgfx::isValid(texture_handle_); }
@@ -54,25 +537,116 @@ namespace visage {
     bgfx::TextureHandle& handle() { return texture_handle_; }
 
     void checkHandle() {
-      if (!bgfx::isValid(texture_handle_)) {
-        if (data_type_ == ImageAtlas::DataType::Float32)
-          texture_handle_ = bgfx::createTexture2D(width_, height_, false, 1, bgfx::TextureFormat::R32F);
-        else
-          texture_handle_ = bgfx::createTexture2D(width_, height_, false, 1, bgfx::TextureFormat::RGBA8);
-      }
+      if (bgfx::isValid(texture_handle_))
+        return;
+
+      bool reduced = format_ == bgfx::TextureFormat::R16F || format_ == bgfx::TextureFormat::R8;
+      if (reduced && (bgfx::getCaps()->formats[format_] & BGFX_CAPS_FORMAT_TEXTURE_2D) == 0)
+        format_ = bgfx::TextureFormat::R32F;
+
+      const bgfx::Memory* memory = nullptr;
+      if (compressed_image_.data)
+        memory = compressedTextureMemory(compressed_image_);
+      uint64_t flags = BGFX_TEXTURE_NONE | BGFX_SAMPLER_NONE;
+      if (mipmapped_)
+        flags |= BGFX_SAMPLER_U_CLAMP | BGFX_SAMPLER_V_CLAMP;
+      if (blit_destination_)
+        flags |= BGFX_TEXTURE_BLIT_DST;
+      texture_handle_ = bgfx::createTexture2D(width_, height_, mipmapped_, 1, format_, flags, memory);
+      memory_.reset(ResourceCategory::ImageAtlas,
+                    ResourceTracker::textureBytes(width_, height_, format_, mipmapped_));
     }
 
     void updateTexture(const unsigned char* data, int x, int y, int width, int height) {
+      if (mipmapped_) {
+        VISAGE_ASSERT(x == 0 && y == 0 && width == width_ && height == height_);
+        updateMipmaps(data);
+        return;
+      }
+      updateTexture(data, x, y, width, height, width * 4);
+    }
+
+    void updateMipmaps(const unsigned char* pixels) {
+      VISAGE_ASSERT(bgfx::isValid(texture_handle_));
+      static constexpr int kChannels = 4;
+
+      // Each level is resized from the previous one's upload memory, which bgfx holds until the
+      // render thread consumes it.
+      UploadMemoryPool& upload_memory = UploadMemoryPool::instance();
+      int width = width_;
+      int height = height_;
+      const unsigned char* level = pixels;
+      bgfx::updateTexture2D(texture_handle_, 0, 0, 0, 0, width, height,
+                            upload_memory.copy(level, width * height * kChannels));
+      for (int mip = 1; width > 1 || height > 1; ++mip) {
+        int mip_width = std::max(1, width / 2);
+        int mip_height = std::max(1, height / 2);
+        const bgfx::Memory* memory = upload_memory.allocate(mip_width * mip_height * kChannels);
+        stbir_resize_uint8_srgb(level, width, height, width * kChannels, memory->data, mip_width,
+                                mip_height, mip_width * kChannels, STBIR_RGBA);
+        level = memory->data;
+        bgfx::updateTexture2D(texture_handle_, 0, mip, 0, 0, mip_width, mip_height, memory);
+        width = mip_width;
+        height = mip_height;
+      }
+    }
+
+    // Data is always four bytes per pixel, reduced precision formats are converted here.
+    void updateTexture(const unsigned char* data, int x, int y, int width, int height, int pitch) {
       VISAGE_ASSERT(bgfx::isValid(texture_handle_));
+      if (format_ == bgfx::TextureFormat::R16F) {
+        const bgfx::Memory* memory = UploadMemoryPool::instance().allocate(width * height *
+                                                                           sizeof(uint16_t));
+        auto dest = reinterpret_cast<uint16_t*>(memory->data);
+        for (int r = 0; r < height; ++r)
+          convertToHalf(reinterpret_cast<const float*>(data + r * pitch), dest + r * width, width);
+        bgfx::updateTexture2D(texture_handle_, 0, 0, x, y, width, height, memory);
+        return;
+      }
+      if (format_ == bgfx::TextureFormat::R8) {
+        const bgfx::Memory* memory = UploadMemoryPool::instance().allocate(width * height);
+        for (int r = 0; r < height; ++r)
+          convertToUNorm8(reinterpret_cast<const float*>(data + r * pitch), memory->data + r * width, width);
+        bgfx::updateTexture2D(texture_handle_, 0, 0, x, y, width, height, memory);
+        return;
+      }
+
+      int size = (height - 1) * pitch + width * 4;
       bgfx::updateTexture2D(texture_handle_, 0, 0, x, y, width, height,
-                            bgfx::copy(data, width * height * 4));
+                            UploadMemoryPool::instance().copy(data, size), pitch);
     }
 
   private:
     int width_ = 0;
     int height_ = 0;
-    ImageAtlas::DataType data_type_ = ImageAtlas::DataType::RGBA8;
+    bgfx::TextureFormat::Enum format_ = bgfx::TextureFormat::RGBA8;
+    Image compressed_image_;
+    bool mipmapped_ = false;
+    bool blit_destination_ = false;
     bgfx::TextureHandle texture_handle_ = BGFX_INVALID_HANDLE;
+    TrackedResource memory_;
+  };
+
+  struct ImageAtlas::Page {
+    PackedAtlasMap<const PackedImageRect*> atlas_map;
+    std::unique_ptr<ImageAtlasTexture> texture;
+    bool repacked = false;
+    bool compressed = false;
+    int version = 0;
+    int failed_migration_version = -1;
+  };
+
+  struct ImageAtlas::Migration {
+    Page* page = nullptr;
+    int page_version = 0;
+    PackedAtlasMap<const PackedImageRect*> atlas_map;
+    std::unique_ptr<ImageAtlasTexture> texture;
+    std::vector<const PackedImageRect*> remaining;
+  };
+
+  struct ImageAtlas::DecodeResults {
+    std::mutex mutex;
+    std::vector<std::pair<Image, std::vector<unsigned char>>> images;
   };
 
   ImageAtlas::PackedImageReference::~PackedImageReference() {
@@ -82,30 +656,61 @@ namespace visage {
 
   ImageAtlas::ImageAtlas(DataType data_type) : data_type_(data_type) {
     reference_ = std::make_shared<ImageAtlas*>(this);
-    atlas_map_.setPadding(kImageBuffer);
   }
 
   ImageAtlas::~ImageAtlas() = default;
 
-  ImageAtlas::PackedImage ImageAtlas::addImage(const Image& image, bool force_update) {
+  ImageAtlas::PackedImage ImageAtlas::addImage(const Image& draw_image, bool force_update) {
+    Image image = draw_image;
+    bool mipmapped = image.mipmapped && !image.raw && data_type_ == DataType::RGBA8;
+    image.mipmapped = mipmapped;
+    if (mipmapped) {
+      image.width = 0;
+      image.height = 0;
+    }
+
     if (images_.count(image) == 0) {
       int width = image.width;
       int height = image.height;
-      if (image.width == 0) {
-        bimg::ImageContainer* image_container = bimg::imageParse(allocator(), image.data, image.data_size);
-        if (image_container) {
-          width = image_container->m_width;
-          height = image_container->m_height;
-          bimg::imageFree(image_container);
-        }
-      }
-
       std::unique_ptr<PackedImageRect> packed_image_rect = std::make_unique<PackedImageRect>(image);
-      if (!atlas_map_.addRect(packed_image_rect.get(), width, height))
-        resize();
+      bgfx::TextureFormat::Enum compressed_format = bgfx::TextureFormat::Unknown;
+      if (!image.raw && data_type_ == DataType::RGBA8)
+        compressed_format = compressedTextureFormat(image, width, height);
 
-      loadImageRect(packed_image_rect.get());
-      updateImage(packed_image_rect.get());
+      if (compressed_format != bgfx::TextureFormat::Unknown) {
+        auto texture = std::make_unique<ImageAtlasTexture>(image, width, height, compressed_format);
+        packed_image_rect->page = addDedicatedPage(packed_image_rect.get(), width, height,
+                                                   std::move(texture), true);
+        loadImageRect(packed_image_rect.get());
+      }
+      else {
+        bool decode_async = async_decoding_ && !image.raw;
+        if (image.width == 0 && !(decode_async && encodedImageSize(image, width, height))) {
+          decode_async = false;
+          bimg::ImageContainer* image_container = bimg::imageParse(allocator(), image.data, image.data_size,
+                                                                   bimg::TextureFormat::RGBA8);
+          if (image_container) {
+            width = image_container->m_width;
+            height = image_container->m_height;
+            auto image_data = static_cast<const unsigned char*>(image_container->m_data);
+            decoded_cache_.add(image, width, height,
+                               std::vector<unsigned char>(image_data, image_data + width * height * 4));
+            bimg::imageFree(image_container);
+          }
+        }
+
+        if (mipmapped) {
+          packed_image_rect->page = addDedicatedPage(packed_image_rect.get(), width, height,
+                                                     ImageAtlasTexture::mipmapped(width, height), false);
+        }
+        else
+          packed_image_rect->page = addToPage(packed_image_rect.get(), width, height);
+        loadImageRect(packed_image_rect.get());
+        if (decode_async)
+          decodeAsync(packed_image_rect.get());
+        else
+          updateImage(packed_image_rect.get());
+      }
       images_[image] = std::move(packed_image_rect);
     }
     else if (force_update)
@@ -127,79 +732,344 @@ namespace visage {
     return addImage(image, true);
   }
 
-  void ImageAtlas::resize() {
-    clearStaleImages();
+  ImageAtlas::PackedImage ImageAtlas::addDataColumns(
+      const unsigned char* data, int width, int height,
+      const std::vector<std::pair<int, int>>& dirty_columns) {
+    Image image(data, width * height * 4, width, height);
+    image.raw = true;
+    bool existing = images_.count(image) > 0;
+    PackedImage packed_image = addImage(image);
+    if (existing) {
+      for (const auto& [start, end] : dirty_columns)
+        updateImageColumns(images_[image].get(), start, end);
+    }
+    return packed_image;
+  }
+
+  ImageAtlas::PackedImage ImageAtlas::addGraphData(const GraphData& data) {
+    PackedImage packed_image = addDataColumns(data.data(), data.dataWidth(), 1,
+                                              data.dirtyColumns());
+    data.markUploaded();
+    return packed_image;
+  }
+
+  ImageAtlas::PackedImage ImageAtlas::addHeatMapData(const HeatMapData& data) {
+    PackedImage packed_image = addDataColumns(data.data(), data.dataWidth(), data.height(),
+                                              data.dirtyColumns());
+    data.markUploaded();
+    return packed_image;
+  }
+
+  void ImageAtlas::clearStaleImages() {
+    for (const auto& stale : stale_images_) {
+      Page* page = stale.second->page;
+      page->atlas_map.removeRect(stale.second);
+      page->version++;
+      images_.erase(stale.first);
+      references_.erase(stale.first);
+      decoded_cache_.remove(stale.first);
+      if (page->atlas_map.empty()) {
+        page->atlas_map.clear();
+        page->texture = nullptr;
+        page->repacked = false;
+        page->compressed = false;
+      }
+    }
+    stale_images_.clear();
+  }
+
+  int ImageAtlas::numPages() const {
+    return std::count_if(pages_.begin(), pages_.end(),
+                         [](const std::unique_ptr<Page>& page) { return !page->atlas_map.empty(); });
+  }
+
+  ImageAtlas::Page* ImageAtlas::freePage() {
+    // Empty pages are reused rather than freed because shape batches are keyed by page.
+    for (auto& page : pages_) {
+      if (page.get() != open_page_ && page->atlas_map.empty())
+        return page.get();
+    }
+    pages_.push_back(std::make_unique<Page>());
+    return pages_.back().get();
+  }
+
+  ImageAtlas::Page* ImageAtlas::addToPage(const PackedImageRect* image, int width, int height) {
+    if (open_page_) {
+      Page* page = open_page_;
+      page->version++;
+      if (page->atlas_map.addRect(image, width, height))
+        return page;
+
+      page->atlas_map.removeRect(image);
+      clearStaleImages();
+
+      int last_width = page->atlas_map.width();
+      int last_height = page->atlas_map.height();
+      page->atlas_map.setMaxSize(max_page_size_);
+      page->atlas_map.addRect(image, width, height);
+      if (page->atlas_map.pack(last_width, last_height)) {
+        repackPage(page, last_width, last_height);
+        return page;
+      }
+      page->atlas_map.removeRect(image);
+    }
+
+    open_page_ = freePage();
+    Page* page = open_page_;
+    page->compressed = false;
+    page->atlas_map.setPadding(kImageBuffer);
+    page->atlas_map.setMaxSize(max_page_size_);
+    page->atlas_map.addRect(image, width, height);
+    page->atlas_map.pack();
+    page->texture = std::make_unique<ImageAtlasTexture>(page->atlas_map.width(),
+                                                        page->atlas_map.height(), data_type_);
+    page->repacked = false;
+    return page;
+  }
+
+  ImageAtlas::Page* ImageAtlas::addDedicatedPage(const PackedImageRect* image, int width, int height,
+                                                 std::unique_ptr<ImageAtlasTexture> texture,
+                                                 bool compressed) {
+    Page* page = freePage();
+    page->compressed = compressed;
+    page->atlas_map.setPadding(0);
+    page->atlas_map.setMaxSize(0);
+    page->atlas_map.addRect(image, width, height);
+    page->atlas_map.pack();
+    page->texture = std::move(texture);
+    page->repacked = false;
+    return page;
+  }
 
-    int last_width = atlas_map_.width();
-    int last_height = atlas_map_.height();
-    atlas_map_.pack();
-    for (auto& image : images_)
-      loadImageRect(image.second.get());
+  void ImageAtlas::repackPage(Page* page, int last_width, int last_height) {
+    for (auto& image : images_) {
+      if (image.second->page == page)
+        loadImageRect(image.second.get());
+    }
 
-    if (atlas_map_.width() != last_width || atlas_map_.height() != last_height)
-      texture_ = std::make_unique<ImageAtlasTexture>(atlas_map_.width(), atlas_map_.height(), data_type_);
+    if (page->texture == nullptr || page->atlas_map.width() != last_width ||
+        page->atlas_map.height() != last_height) {
+      page->texture = std::make_unique<ImageAtlasTexture>(page->atlas_map.width(),
+                                                          page->atlas_map.height(), data_type_);
+      page->repacked = false;
+    }
     else
-      repacked_ = true;
+      page->repacked = true;
+  }
+
+  bool ImageAtlas::startMigration() {
+    if (open_page_ == nullptr || num_decoding_ > 0 ||
+        (bgfx::getCaps()->supported & BGFX_CAPS_TEXTURE_BLIT) == 0)
+      return false;
+
+    clearStaleImages();
+    Page* page = open_page_;
+    if (page->atlas_map.empty() || page->texture == nullptr || !page->texture->hasHandle() ||
+        page->repacked || page->failed_migration_version == page->version)
+      return false;
+
+    int width = page->atlas_map.width();
+    int height = page->atlas_map.height();
+    if (page->atlas_map.removedArea() < width * height * kDefragmentHoleRatio)
+      return false;
+
+    auto migration = std::make_unique<Migration>();
+    migration->page = page;
+    migration->page_version = page->version;
+    migration->atlas_map.setPadding(kImageBuffer);
+    migration->atlas_map.setMaxSize(max_page_size_);
+    for (auto& image : images_) {
+      if (image.second->page == page) {
+        migration->atlas_map.addRect(image.second.get(), image.second->w, image.second->h);
+        migration->remaining.push_back(image.second.get());
+      }
+    }
+
+    if (!migration->atlas_map.pack(width, height) || migration->atlas_map.width() > width ||
+        migration->atlas_map.height() > height) {
+      page->failed_migration_version = page->version;
+      return false;
+    }
+
+    migration->texture = ImageAtlasTexture::blitDestination(migration->atlas_map.width(),
+                                                            migration->atlas_map.height(),
+                                                            data_type_);
+    migration->texture->checkHandle();
+    migration_ = std::move(migration);
+    return true;
+  }
+
+  int ImageAtlas::defragment(int submit_pass, int max_moves) {
+    if (migration_ && migration_->page_version != migration_->page->version)
+      migration_ = nullptr;
+
+    if (migration_ == nullptr && (max_moves <= 0 || !startMigration()))
+      return 0;
+
+    VISAGE_TRACE_SCOPE("ImageAtlas::defragment");
+    Page* page = migration_->page;
+    bgfx::TextureHandle source = page->texture->handle();
+    bgfx::TextureHandle destination = migration_->texture->handle();
+    int moves = 0;
+    while (moves < max_moves && !migration_->remaining.empty()) {
+      const PackedImageRect* image = migration_->remaining.back();
+      migration_->remaining.pop_back();
+      if (image->w <= 0 || image->h <= 0)
+        continue;
+
+      const PackedRect& rect = migration_->atlas_map.rectForId(image);
+      encoder()->blit(submit_pass, destination, rect.x, rect.y, source, image->x, image->y,
+                      image->w, image->h);
+      moves++;
+    }
+
+    // bgfx destroys the old texture after this frame's blits have read from it.
+    if (migration_->remaining.empty()) {
+      page->atlas_map = std::move(migration_->atlas_map);
+      page->texture = std::move(migration_->texture);
+      page->version++;
+      for (auto& image : images_) {
+        if (image.second->page == page)
+          loadImageRect(image.second.get());
+      }
+      migration_ = nullptr;
+    }
+    return moves;
   }
 
   void ImageAtlas::loadImageRect(PackedImageRect* image) const {
-    const PackedRect& rect = atlas_map_.rectForId(image);
+    const PackedRect& rect = image->page->atlas_map.rectForId(image);
     image->x = rect.x;
     image->y = rect.y;
     image->w = rect.w;
     image->h = rect.h;
   }
 
+  void ImageAtlas::decodeAsync(PackedImageRect* image) {
+    if (decode_results_ == nullptr)
+      decode_results_ = std::make_shared<DecodeResults>();
+
+    image->loading = true;
+    num_decoding_++;
+    std::shared_ptr<DecodeResults> results = decode_results_;
+    Image encoded = image->image;
+    int width = image->w;
+    int height = image->h;
+    // The caller owns the encoded data and can free it before the task runs, so it decodes a copy.
+    std::vector<unsigned char> bytes(encoded.data, encoded.data + encoded.data_size);
+    auto decode = [results, encoded, bytes = std::move(bytes), width, height] {
+      Image copy = encoded;
+      copy.data = bytes.data();
+      std::vector<unsigned char> pixels = decodeImage(copy, width, height);
+      std::lock_guard<std::mutex> lock(results->mutex);
+      results->images.emplace_back(encoded, std::move(pixels));
+    };
+    ThreadPool::shared().post(std::move(decode), TaskPriority::Background);
+  }
+
+  void ImageAtlas::uploadDecodedImages(double time) {
+    if (num_decoding_ == 0)
+      return;
+
+    std::vector<std::pair<Image, std::vector<unsigned char>>> decoded;
+    {
+      std::lock_guard<std::mutex> lock(decode_results_->mutex);
+      decoded.swap(decode_results_->images);
+    }
+
+    for (auto& [image, pixels] : decoded) {
+      num_decoding_--;
+      auto found = images_.find(image);
+      if (found == images_.end() || !found->second->loading)
+        continue;
+
+      PackedImageRect* packed_image_rect = found->second.get();
+      packed_image_rect->loading = false;
+      packed_image_rect->decoded_time = time;
+      last_decoded_time_ = time;
+      if (pixels.empty()) {
+        VISAGE_ASSERT(false);
+        continue;
+      }
+
+      Page* page = packed_image_rect->page;
+      page->version++;
+      if (page->texture && page->texture->hasHandle() && !page->repacked) {
+        page->texture->updateTexture(pixels.data(), packed_image_rect->x, packed_image_rect->y,
+                                packed_image_rect->w, packed_image_rect->h);
+      }
+      decoded_cache_.add(image, packed_image_rect->w, packed_image_rect->h, std::move(pixels));
+    }
+  }
+
   void ImageAtlas::updateImage(const PackedImageRect* image) const {
-    if (texture_ == nullptr || !bgfx::isValid(texture_->handle()))
+    ImageAtlasTexture* texture = image->page->texture.get();
+    if (texture == nullptr || !texture->hasHandle() || image->loading || image->page->compressed)
       return;
 
-    PackedRect packed_rect = atlas_map_.rectForId(image);
+    VISAGE_TRACE_SCOPE("ImageAtlas::updateImage");
+    image->page->version++;
+    PackedRect packed_rect = image->page->atlas_map.rectForId(image);
     if (image->image.raw) {
-      texture_->updateTexture(image->image.data, packed_rect.x, packed_rect.y, packed_rect.w,
+      texture->updateTexture(image->image.data, packed_rect.x, packed_rect.y, packed_rect.w,
                               packed_rect.h);
       return;
     }
-    bimg::ImageContainer* image_container = bimg::imageParse(allocator(), image->image.data,
-                                                             image->image.data_size,
-                                                             bimg::TextureFormat::RGBA8);
-    if (image_container) {
-      unsigned char* image_data = static_cast<unsigned char*>(image_container->m_data);
-      if (image_container->m_width == packed_rect.w && image_container->m_height == packed_rect.h)
-        texture_->updateTexture(image_data, packed_rect.x, packed_rect.y, packed_rect.w, packed_rect.h);
-      else {
-        int size = packed_rect.w * packed_rect.h * numChannels();
-        std::unique_ptr<unsigned char[]> resampled = std::make_unique<unsigned char[]>(size);
-        stbir_resize_uint8_srgb(image_data, image_container->m_width, image_container->m_height,
-                                image_container->m_width * numChannels(), resampled.get(),
-                                packed_rect.w, packed_rect.h, packed_rect.w * numChannels(), STBIR_RGBA);
-        texture_->updateTexture(resampled.get(), packed_rect.x, packed_rect.y, packed_rect.w,
-                                packed_rect.h);
-      }
-      bimg::imageFree(image_container);
+    const unsigned char* pixels = decoded_cache_.find(image->image, packed_rect.w, packed_rect.h);
+    if (pixels) {
+      texture->updateTexture(pixels, packed_rect.x, packed_rect.y, packed_rect.w, packed_rect.h);
+      return;
     }
-    else
+
+    std::vector<unsigned char> decoded = decodeImage(image->image, packed_rect.w, packed_rect.h);
+    if (decoded.empty()) {
       VISAGE_ASSERT(false);
+      return;
+    }
+
+    texture->updateTexture(decoded.data(), packed_rect.x, packed_rect.y, packed_rect.w, packed_rect.h);
+    decoded_cache_.add(image->image, packed_rect.w, packed_rect.h, std::move(decoded));
+  }
+
+  int ImageAtlas::width(const Page* page) const {
+    return page->atlas_map.width();
+  }
+
+  int ImageAtlas::height(const Page* page) const {
+    return page->atlas_map.height();
+  }
+
+  void ImageAtlas::updateImageColumns(const PackedImageRect* image, int start, int end) const {
+    VISAGE_ASSERT(image->image.raw);
+    ImageAtlasTexture* texture = image->page->texture.get();
+    if (texture == nullptr || !texture->hasHandle() || image->page->repacked || end <= start)
+      return;
+
+    image->page->version++;
+
+    texture->updateTexture(image->image.data + start * 4, image->x + start, image->y, end - start,
+                           image->h, image->w * 4);
   }
 
-  const bgfx::TextureHandle& ImageAtlas::textureHandle() {
-    VISAGE_ASSERT(texture_.get());
-    if (!texture_->hasHandle() || repacked_) {
-      texture_->checkHandle();
+  const bgfx::TextureHandle& ImageAtlas::textureHandle(Page* page) {
+    VISAGE_ASSERT(page && page->texture);
+    if (!page->texture->hasHandle() || page->repacked) {
+      page->texture->checkHandle();
       for (auto& image : images_) {
-        if (stale_images_.count(image.first) == 0)
+        if (image.second->page == page && stale_images_.count(image.first) == 0)
           updateImage(image.second.get());
       }
-      repacked_ = false;
+      page->repacked = false;
     }
-    return texture_->handle();
+    return page->texture->handle();
   }
 
-  void ImageAtlas::setImageCoordinates(TextureVertex* vertices, const PackedImage& image) const {
-    float left = image.x();
-    float top = image.y();
-    float right = left + image.w();
-    float bottom = top + image.h();
+  void ImageAtlas::setImageCoordinates(TextureVertex* vertices, const PackedImage& image,
+                                       float left, float top, float right, float bottom) const {
+    left += image.x();
+    top += image.y();
+    right += image.x();
+    bottom += image.y();
 
     vertices[0].texture_x = left;
     vertices[0].texture_y = top;
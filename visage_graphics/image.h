@@ -23,7 +23,11 @@
 
 #include "graphics_utils.h"
 
+#include <algorithm>
+#include <cmath>
+#include <list>
 #include <map>
+#include <memory>
 #include <utility>
 
 namespace visage {
@@ -37,83 +41,500 @@ namespace visage {
     int width = 0;
     int height = 0;
     bool raw = false;
+    // Mipmapped images keep one full resolution copy with mip levels in their own texture and are
+    // filtered on the GPU at any draw size, instead of taking an atlas entry per size.
+    bool mipmapped = false;
+    // Keeps data alive for as long as an atlas entry holds this image, for pixel buffers that can
+    // be replaced while the atlas still uploads from the old one. Not part of the image's identity.
+    std::shared_ptr<const void> owner;
 
     bool operator==(const Image& other) const {
       return data == other.data && data_size == other.data_size && width == other.width &&
-             height == other.height;
+             height == other.height && mipmapped == other.mipmapped;
     }
 
     bool operator<(const Image& other) const {
       return data < other.data || (data == other.data && data_size < other.data_size) ||
              (data == other.data && data_size == other.data_size && width < other.width) ||
              (data == other.data && data_size == other.data_size && width == other.width &&
-              height < other.height);
+              height < other.height) ||
+             (data == other.data && data_size == other.data_size && width == other.width &&
+              height == other.height && mipmapped < other.mipmapped);
     }
   };
 
+  // Texture precision for graph and heat map data. Values are always floats on the CPU and are
+  // converted when uploaded. UNorm8 clamps values to [0, 1].
+  enum class DataPrecision {
+    Float32,
+    Float16,
+    UNorm8,
+  };
+
+  // Ring buffer of data columns. Each column is mirrored num_columns later in its row so the
+  // window of num_columns starting at offset() is contiguous and needs no wrapping to sample.
+  class DataRing {
+  public:
+    DataRing(int num_columns, int num_rows) :
+        num_columns_(num_columns), num_rows_(num_rows), width_(std::max(0, 2 * num_columns - 1)),
+        values_(width_ * num_rows, 0.0f) { }
+
+    int width() const { return width_; }
+    int offset() const { return write_position_; }
+
+    float at(int column, int row) const {
+      return values_[row * width_ + (write_position_ + column) % num_columns_];
+    }
+
+    // Marks the column and its mirror for upload.
+    void set(int column, int row, float value) {
+      int ring_column = (write_position_ + column) % num_columns_;
+      write(ring_column, row, value);
+      markDirty(ring_column);
+    }
+
+    void markAllDirty() {
+      dirty_start_ = 0;
+      dirty_count_ = num_columns_;
+    }
+
+    // Values are column major, num_rows per pushed column.
+    void push(const float* values, int num_columns) {
+      if (num_columns_ == 0)
+        return;
+
+      if (dirty_count_ == 0)
+        dirty_start_ = write_position_;
+      for (int c = 0; c < num_columns; ++c) {
+        for (int r = 0; r < num_rows_; ++r)
+          write(write_position_, r, values[c * num_rows_ + r]);
+        write_position_ = (write_position_ + 1) % num_columns_;
+      }
+      if (dirty_count_ + num_columns >= num_columns_)
+        markAllDirty();
+      else
+        dirty_count_ += num_columns;
+    }
+
+    // Column ranges of data() written since the last markUploaded().
+    std::vector<std::pair<int, int>> dirtyColumns() const {
+      std::vector<std::pair<int, int>> columns;
+      if (dirty_count_ == 0)
+        return columns;
+
+      int end = dirty_start_ + dirty_count_;
+      auto add_range = [&](int range_start, int range_end) {
+        columns.emplace_back(range_start, range_end);
+        int mirror_end = std::min(range_end + num_columns_, width_);
+        if (range_start + num_columns_ < mirror_end)
+          columns.emplace_back(range_start + num_columns_, mirror_end);
+      };
+      add_range(dirty_start_, std::min(end, num_columns_));
+      if (end > num_columns_)
+        add_range(0, end - num_columns_);
+      return columns;
+    }
+
+    void markUploaded() { dirty_count_ = 0; }
+
+    const unsigned char* data() const { return (const unsigned char*)values_.data(); }
+
+  private:
+    void write(int ring_column, int row, float value) {
+      values_[row * width_ + ring_column] = value;
+      if (ring_column + num_columns_ < width_)
+        values_[row * width_ + ring_column + num_columns_] = value;
+    }
+
+    // Grows the dirty ring range by the shorter way around to cover ring_column.
+    void markDirty(int ring_column) {
+      if (dirty_count_ == 0) {
+        dirty_start_ = ring_column;
+        dirty_count_ = 1;
+        return;
+      }
+
+      int after = (ring_column - dirty_start_ + num_columns_) % num_columns_;
+      if (after < dirty_count_)
+        return;
+
+      int before = (dirty_start_ - ring_column + num_columns_) % num_columns_;
+      if (after + 1 - dirty_count_ <= before)
+        dirty_count_ = after + 1;
+      else {
+        dirty_start_ = ring_column;
+        dirty_count_ += before;
+      }
+      if (dirty_count_ >= num_columns_)
+        markAllDirty();
+    }
+
+    int num_columns_ = 0;
+    int num_rows_ = 0;
+    int width_ = 0;
+    std::vector<float> values_;
+    int write_position_ = 0;
+    int dirty_start_ = 0;
+    int dirty_count_ = 0;
+  };
+
+  // Row major values of graph and heat map data with the span of columns written since the last
+  // upload. Copies get their own values. Atlas entries drawing the data keep the values alive
+  // through shared(), so unchanged data keeps its atlas entry and only dirty columns are uploaded.
+  class DataBuffer {
+  public:
+    DataBuffer(int width = 0, int height = 1) :
+        width_(width), height_(height),
+        values_(std::make_shared<std::vector<float>>(width * height, 0.0f)) {
+      markAllDirty();
+    }
+
+    DataBuffer(const DataBuffer& other) : DataBuffer(other.width_, other.height_) {
+      *values_ = *other.values_;
+    }
+
+    DataBuffer& operator=(const DataBuffer& other) {
+      if (this != &other)
+        *this = DataBuffer(other);
+      return *this;
+    }
+
+    DataBuffer(DataBuffer&&) = default;
+    DataBuffer& operator=(DataBuffer&&) = default;
+
+    // Values move to a new allocation since atlas entries may still hold the old one.
+    void resize(int width, int height = 1) {
+      auto values = std::make_shared<std::vector<float>>(width * height, 0.0f);
+      std::copy_n(values_->begin(), std::min(values->size(), values_->size()), values->begin());
+      width_ = width;
+      height_ = height;
+      values_ = std::move(values);
+      markAllDirty();
+    }
+
+    float operator[](int index) const { return (*values_)[index]; }
+
+    float& at(int index) {
+      int column = index % width_;
+      if (dirty_start_ >= dirty_end_) {
+        dirty_start_ = column;
+        dirty_end_ = column + 1;
+      }
+      else {
+        dirty_start_ = std::min(dirty_start_, column);
+        dirty_end_ = std::max(dirty_end_, column + 1);
+      }
+      return (*values_)[index];
+    }
+
+    void fill(float value) {
+      std::fill(values_->begin(), values_->end(), value);
+      markAllDirty();
+    }
+
+    void markAllDirty() {
+      dirty_start_ = 0;
+      dirty_end_ = width_;
+    }
+
+    std::vector<std::pair<int, int>> dirtyColumns() const {
+      if (dirty_start_ >= dirty_end_)
+        return {};
+      return { { dirty_start_, dirty_end_ } };
+    }
+
+    void markUploaded() const {
+      dirty_start_ = 0;
+      dirty_end_ = 0;
+    }
+
+    const float* values() const { return values_->data(); }
+    const unsigned char* data() const { return (const unsigned char*)values_->data(); }
+    std::shared_ptr<const void> shared() const { return values_; }
+
+  private:
+    int width_ = 0;
+    int height_ = 0;
+    std::shared_ptr<std::vector<float>> values_;
+    mutable int dirty_start_ = 0;
+    mutable int dirty_end_ = 0;
+  };
+
   class GraphData {
   public:
-    GraphData(int num_points = 0) : num_points_(num_points), y_values_(num_points, 0.0f) { }
+    GraphData(int num_points = 0) : num_points_(num_points), values_(num_points) { }
 
     void setNumPoints(int num_points) {
+      bool streaming = ring_ != nullptr;
+      setStreaming(false);
       num_points_ = num_points;
-      y_values_.resize(num_points_, 0.0f);
+      values_.resize(num_points_);
+      pyramid_ = nullptr;
+      version_++;
+      if (streaming)
+        setStreaming(true);
     }
 
     int numPoints() const { return num_points_; }
 
-    void clear() { std::fill(y_values_.begin(), y_values_.end(), 0.0f); }
+    void setPrecision(DataPrecision precision) { precision_ = precision; }
+    DataPrecision precision() const { return precision_; }
+
+    // A streaming graph keeps its points in a DataRing. push() overwrites the oldest points
+    // and only the pushed points are uploaded on the next draw. While streaming, points can only
+    // be read through a const GraphData, and copies share the ring buffer.
+    void setStreaming(bool streaming) {
+      pyramid_ = nullptr;
+      version_++;
+      if (!streaming) {
+        for (int i = 0; ring_ && i < num_points_; ++i)
+          values_.at(i) = ring_->at(i, 0);
+        ring_ = nullptr;
+        return;
+      }
+
+      ring_ = std::make_shared<DataRing>(num_points_, 1);
+      for (int i = 0; i < num_points_; ++i)
+        ring_->set(i, 0, values_[i]);
+      ring_->markAllDirty();
+    }
+
+    bool streaming() const { return ring_ != nullptr; }
+    const DataRing* ring() const { return ring_.get(); }
+
+    void push(float value) { push(&value, 1); }
+
+    void push(const float* values, int count) {
+      VISAGE_ASSERT(ring_ != nullptr);
+      version_++;
+      if (ring_)
+        ring_->push(values, count);
+    }
+
+    // Index of the oldest point in the ring, added to the data position when drawing.
+    int ringOffset() const { return ring_ ? ring_->offset() : 0; }
+    int dataWidth() const { return ring_ ? ring_->width() : num_points_; }
+    std::vector<std::pair<int, int>> dirtyColumns() const {
+      return ring_ ? ring_->dirtyColumns() : values_.dirtyColumns();
+    }
+
+    void markUploaded() const {
+      if (ring_)
+        ring_->markUploaded();
+      else
+        values_.markUploaded();
+    }
+
+    // Changes whenever points may have changed, so callers can skip work for unchanged data.
+    int version() const { return version_; }
+
+    // Keeps the drawn points alive for the atlas entry they were uploaded to.
+    std::shared_ptr<const void> sharedData() const {
+      if (ring_)
+        return ring_;
+      return values_.shared();
+    }
+
+    void clear() {
+      values_.fill(0.0f);
+      pyramid_ = nullptr;
+      version_++;
+      if (ring_)
+        setStreaming(true);
+    }
 
     float& operator[](int index) {
       VISAGE_ASSERT(index >= 0 && index < num_points_);
-      return y_values_[index];
+      VISAGE_ASSERT(ring_ == nullptr);
+      markChanged(index);
+      version_++;
+      return values_.at(index);
+    }
+
+    void set(int index, float value) {
+      VISAGE_ASSERT(index >= 0 && index < num_points_);
+      if (ring_ || values_[index] != value)
+        (*this)[index] = value;
     }
 
-    const float& operator[](int index) const {
+    float operator[](int index) const {
       VISAGE_ASSERT(index >= 0 && index < num_points_);
-      return y_values_[index];
+      if (ring_)
+        return ring_->at(index, 0);
+      return values_[index];
     }
 
-    const unsigned char* data() const { return (const unsigned char*)y_values_.data(); }
+    const unsigned char* data() const {
+      if (ring_)
+        return ring_->data();
+      return values_.data();
+    }
+
+    // Returns at most max_points points holding the minimum and maximum of each bucket of points,
+    // so peaks survive when many points land in one pixel. Buckets come from a min/max pyramid
+    // that is only rebuilt where points changed. Streaming and small graphs return themselves.
+    const GraphData& decimated(int max_points) const;
 
   private:
+    struct MinMaxPyramid;
+
+    void markChanged(int index) {
+      if (pyramid_ == nullptr)
+        return;
+
+      if (pyramid_.use_count() > 1) {
+        pyramid_ = nullptr;
+        return;
+      }
+
+      if (pyramid_dirty_start_ >= pyramid_dirty_end_) {
+        pyramid_dirty_start_ = index;
+        pyramid_dirty_end_ = index + 1;
+      }
+      else {
+        pyramid_dirty_start_ = std::min(pyramid_dirty_start_, index);
+        pyramid_dirty_end_ = std::max(pyramid_dirty_end_, index + 1);
+      }
+    }
+
+    bool updatePyramid() const;
+
     int num_points_ = 0;
-    std::vector<float> y_values_;
+    DataPrecision precision_ = DataPrecision::Float32;
+    DataBuffer values_;
+    std::shared_ptr<DataRing> ring_;
+    int version_ = 0;
+    mutable std::shared_ptr<MinMaxPyramid> pyramid_;
+    mutable int pyramid_dirty_start_ = 0;
+    mutable int pyramid_dirty_end_ = 0;
   };
 
   class HeatMapData {
   public:
     HeatMapData(int width = 0, int height = 0) :
-        width_(width), height_(height), values_(width * height, 0.0f) { }
+        width_(width), height_(height), values_(width, height) { }
 
     void setDimensions(int width, int height) {
+      bool streaming = ring_ != nullptr;
+      setStreaming(false);
       width_ = width;
       height_ = height;
-      values_.resize(width * height, 0.0f);
+      values_.resize(width, height);
+      version_++;
+      if (streaming)
+        setStreaming(true);
     }
 
     void setOctaves(float octaves) { octaves_ = octaves; }
     float octaves() const { return octaves_; }
 
+    // Values from min to max map across the gradient, scaled in the shader when drawing. With
+    // decibels the values are linear magnitudes and min and max are in dB, so producers can push
+    // raw spectrum magnitudes without converting them.
+    void setValueRange(float min, float max, bool decibels = false) {
+      value_min_ = min;
+      value_max_ = max;
+      decibels_ = decibels;
+    }
+    float valueMin() const { return value_min_; }
+    float valueMax() const { return value_max_; }
+    bool decibels() const { return decibels_; }
+
+    void setPrecision(DataPrecision precision) { precision_ = precision; }
+    DataPrecision precision() const { return precision_; }
+
     int width() const { return width_; }
     int height() const { return height_; }
 
-    void clear() { std::fill(values_.begin(), values_.end(), 0.0f); }
+    // A streaming heat map scrolls horizontally: pushColumn() replaces the oldest column and
+    // only that column is uploaded on the next draw. While streaming, values can only be read
+    // through a const HeatMapData, and copies share the ring buffer.
+    void setStreaming(bool streaming) {
+      version_++;
+      if (!streaming) {
+        for (int y = 0; ring_ && y < height_; ++y) {
+          for (int x = 0; x < width_; ++x)
+            values_.at(y * width_ + x) = ring_->at(x, y);
+        }
+        ring_ = nullptr;
+        return;
+      }
 
-    const unsigned char* data() const { return (const unsigned char*)values_.data(); }
+      ring_ = std::make_shared<DataRing>(width_, height_);
+      for (int y = 0; y < height_; ++y) {
+        for (int x = 0; x < width_; ++x)
+          ring_->set(x, y, values_[y * width_ + x]);
+      }
+      ring_->markAllDirty();
+    }
+
+    bool streaming() const { return ring_ != nullptr; }
+
+    void pushColumn(const float* column) {
+      VISAGE_ASSERT(ring_ != nullptr);
+      version_++;
+      if (ring_)
+        ring_->push(column, 1);
+    }
+
+    int ringOffset() const { return ring_ ? ring_->offset() : 0; }
+    int dataWidth() const { return ring_ ? ring_->width() : width_; }
+    std::vector<std::pair<int, int>> dirtyColumns() const {
+      return ring_ ? ring_->dirtyColumns() : values_.dirtyColumns();
+    }
+
+    void markUploaded() const {
+      if (ring_)
+        ring_->markUploaded();
+      else
+        values_.markUploaded();
+    }
+
+    // Changes whenever values may have changed, so callers can skip work for unchanged data.
+    int version() const { return version_; }
+
+    std::shared_ptr<const void> sharedData() const {
+      if (ring_)
+        return ring_;
+      return values_.shared();
+    }
+
+    void clear() {
+      values_.fill(0.0f);
+      version_++;
+      if (ring_)
+        setStreaming(true);
+    }
+
+    const unsigned char* data() const {
+      if (ring_)
+        return ring_->data();
+      return values_.data();
+    }
 
     void set(int x, int y, float value) {
       VISAGE_ASSERT(x >= 0 && x < width_ && y >= 0 && y < height_);
-      values_[y * width_ + x] = value;
+      if (ring_ == nullptr && values_[y * width_ + x] == value)
+        return;
+
+      version_++;
+      if (ring_)
+        ring_->set(x, y, value);
+      else
+        values_.at(y * width_ + x) = value;
     }
 
     float& at(int x, int y) {
       VISAGE_ASSERT(x >= 0 && x < width_ && y >= 0 && y < height_);
-      return values_[y * width_ + x];
+      VISAGE_ASSERT(ring_ == nullptr);
+      version_++;
+      return values_.at(y * width_ + x);
     }
 
-    const float& at(int x, int y) const {
+    float at(int x, int y) const {
       VISAGE_ASSERT(x >= 0 && x < width_ && y >= 0 && y < height_);
+      if (ring_)
+        return ring_->at(x, y);
       return values_[y * width_ + x];
     }
 
@@ -121,7 +542,87 @@ namespace visage {
     int width_ = 0;
     int height_ = 0;
     float octaves_ = 0.0f;
-    std::vector<float> values_;
+    float value_min_ = 0.0f;
+    float value_max_ = 1.0f;
+    bool decibels_ = false;
+    DataPrecision precision_ = DataPrecision::Float32;
+    DataBuffer values_;
+    std::shared_ptr<DataRing> ring_;
+    int version_ = 0;
+  };
+
+  class DecodedImageCache {
+  public:
+    static constexpr size_t kDefaultMaxBytes = 64 * 1024 * 1024;
+
+    explicit DecodedImageCache(size_t max_bytes = kDefaultMaxBytes) : max_bytes_(max_bytes) { }
+
+    const unsigned char* find(const Image& image, int width, int height);
+    void add(const Image& image, int width, int height, std::vector<unsigned char> pixels);
+    void remove(const Image& image);
+    void clear();
+
+    void setMaxBytes(size_t max_bytes) {
+      max_bytes_ = max_bytes;
+      evict();
+    }
+    size_t maxBytes() const { return max_bytes_; }
+    size_t bytes() const { return bytes_; }
+    int size() const { return entries_.size(); }
+
+  private:
+    struct Entry {
+      Image image;
+      int width = 0;
+      int height = 0;
+      std::vector<unsigned char> pixels;
+    };
+
+    void evict();
+
+    std::list<Entry> entries_;
+    std::map<Image, std::list<Entry>::iterator> lookup_;
+    size_t bytes_ = 0;
+    size_t max_bytes_ = 0;
+  };
+
+  class ImageAtlas;
+
+  // Alpha masks for one corner of a rounded rectangle shadow, keyed by rounding and shadow width
+  // in native pixels so each DPI gets its own masks. The last row and column of a mask are the
+  // shadow's straight edge and solid middle, so a shadow of any size draws as nine slices of one
+  // mask. Masks unused for kRetainedFrames frames are dropped.
+  class ShadowCache {
+  public:
+    static constexpr int kRetainedFrames = 8;
+    static constexpr int kMaxExtent = 256;
+    static constexpr float kStepsPerPixel = 4.0f;
+
+    struct Mask {
+      std::shared_ptr<std::vector<unsigned char>> pixels;
+      float rounding = 0.0f;
+      float shadow_width = 0.0f;
+      // Distance from the shadow's edge where it becomes straight and solid. The mask is
+      // extent + 1 pixels square.
+      int extent = 0;
+      const ImageAtlas* uploaded_atlas = nullptr;
+      int last_used = 0;
+    };
+
+    static float quantize(float value) { return std::round(value * kStepsPerPixel) / kStepsPerPixel; }
+    static int extent(float rounding, float shadow_width) {
+      return std::ceil(std::max(quantize(rounding), quantize(shadow_width)));
+    }
+
+    // Returns nullptr when the mask would be larger than kMaxExtent.
+    Mask* mask(float rounding, float shadow_width);
+    void nextFrame();
+    void clear() { masks_.clear(); }
+    int size() const { return masks_.size(); }
+
+  private:
+    std::map<std::pair<int, int>, Mask> masks_;
+    int frame_ = 0;
   };
 
   class ImageAtlasTexture;
@@ -129,10 +630,16 @@ namespace visage {
   class ImageAtlas {
   public:
     static constexpr int kImageBuffer = 1;
+    static constexpr int kDefaultMaxPageSize = 4096;
+    static constexpr float kDefragmentHoleRatio = 0.125f;
+
+    struct Page;
 
     enum class DataType {
       RGBA8,
       Float32,
+      Float16,
+      UNorm8,
     };
 
     struct PackedImageRect {
@@ -143,6 +650,9 @@ namespace visage {
       int y = 0;
       int w = 0;
       int h = 0;
+      Page* page = nullptr;
+      bool loading = false;
+      double decoded_time = -1.0;
     };
 
     struct PackedImageReference {
@@ -181,6 +691,21 @@ namespace visage {
         return reference_->packed_image_rect->image;
       }
 
+      Page* page() const {
+        VISAGE_ASSERT(reference_->atlas.lock().get());
+        return reference_->packed_image_rect->page;
+      }
+
+      bool loading() const {
+        VISAGE_ASSERT(reference_->atlas.lock().get());
+        return reference_->packed_image_rect->loading;
+      }
+
+      double decodedTime() const {
+        VISAGE_ASSERT(reference_->atlas.lock().get());
+        return reference_->packed_image_rect->decoded_time;
+      }
+
       const PackedImageRect* packedImageRect() const {
         VISAGE_ASSERT(reference_->atlas.lock().get());
         return reference_->packed_image_rect;
@@ -196,28 +721,74 @@ namespace visage {
     ImageAtlas(DataType data_type);
     virtual ~ImageAtlas();
 
+    // KTX and DDS images in a compressed format the GPU supports get a page of their own and
+    // are uploaded as-is. Mipmapped images also get their own page at their natural size.
+    // Everything else is decoded into the shared RGBA8 pages.
     PackedImage addImage(const Image& image, bool force_update = false);
     PackedImage addData(const unsigned char* data, int width, int height = 1);
-    void clearStaleImages() {
-      for (const auto& stale : stale_images_) {
-        images_.erase(stale.first);
-        atlas_map_.removeRect(stale.second);
-        references_.erase(stale.first);
-      }
-      stale_images_.clear();
+    // Streaming data keeps its rect and only uploads the columns pushed since the last draw.
+    PackedImage addGraphData(const GraphData& data);
+    PackedImage addHeatMapData(const HeatMapData& data);
+    void clearStaleImages();
+
+    // Images are packed into pages of up to this size. A full page stays as it is and new
+    // images go into another page, so growing never rebuilds the textures already uploaded.
+    void setMaxPageSize(int max_page_size) { max_page_size_ = max_page_size; }
+    int maxPageSize() const { return max_page_size_; }
+    int numPages() const;
+
+    // Decoded and resampled pixels are kept up to this size so repacking the atlas
+    // re-uploads images without decoding them again.
+    void setDecodedCacheSize(size_t max_bytes) { decoded_cache_.setMaxBytes(max_bytes); }
+    const DecodedImageCache& decodedCache() const { return decoded_cache_; }
+
+    // Encoded images are decoded on background threads and stay loading until
+    // uploadDecodedImages() copies the finished pixels into the atlas.
+    void setAsyncDecoding(bool async) { async_decoding_ = async; }
+    bool asyncDecoding() const { return async_decoding_; }
+    void uploadDecodedImages(double time);
+    bool decoding() const { return num_decoding_ > 0; }
+    double lastDecodedTime() const { return last_decoded_time_; }
+
+    // Compacts the open page once removed images leave enough holes in it. Images are copied on
+    // the GPU, at most max_moves per call, into a second texture that replaces the page after
+    // the last one moves. Any change to the page restarts the compaction. Returns the number of
+    // images copied into submit_pass.
+    int defragment(int submit_pass, int max_moves);
+    bool defragmenting() const { return migration_ != nullptr; }
+
+    int width(const Page* page) const;
+    int height(const Page* page) const;
+    const bgfx::TextureHandle& textureHandle(Page* page);
+    void setImageCoordinates(TextureVertex* vertices, const PackedImage& image) const {
+      setImageCoordinates(vertices, image, 0.0f, 0.0f, image.w(), image.h());
+    }
+    // Coordinates are in image pixels, reversed coordinates mirror the image.
+    void setImageCoordinates(TextureVertex* vertices, const PackedImage& image, float left,
+                             float top, float right, float bottom) const;
+    int numChannels() const { return data_type_ == DataType::RGBA8 ? 4 : 1; }
+    int bytesPerChannel() const {
+      if (data_type_ == DataType::Float32)
+        return 4;
+      return data_type_ == DataType::Float16 ? 2 : 1;
     }
-
-    int width() const { return atlas_map_.width(); }
-    int height() const { return atlas_map_.height(); }
-    const bgfx::TextureHandle& textureHandle();
-    void setImageCoordinates(TextureVertex* vertices, const PackedImage& image) const;
-    int numChannels() const { return data_type_ == DataType::Float32 ? 1 : 4; }
-    int bytesPerChannel() const { return data_type_ == DataType::Float32 ? 4 : 1; }
 
   private:
-    void resize();
+    struct DecodeResults;
+    struct Migration;
+
+    Page* freePage();
+    Page* addToPage(const PackedImageRect* image, int width, int height);
+    Page* addDedicatedPage(const PackedImageRect* image, int width, int height,
+                           std::unique_ptr<ImageAtlasTexture> texture, bool compressed);
+    void repackPage(Page* page, int last_width, int last_height);
+    bool startMigration();
+    void decodeAsync(PackedImageRect* image);
     void loadImageRect(PackedImageRect* image) const;
     void updateImage(const PackedImageRect* image) const;
+    void updateImageColumns(const PackedImageRect* image, int start, int end) const;
+    PackedImage addDataColumns(const unsigned char* data, int width, int height,
+                               const std::vector<std::pair<int, int>>& dirty_columns);
 
     void removeImage(const Image& image) {
       VISAGE_ASSERT(images_.count(image));
@@ -233,9 +804,15 @@ namespace visage {
     std::map<Image, const PackedImageRect*> stale_images_;
 
     DataType data_type_ = DataType::RGBA8;
-    bool repacked_ = false;
-    PackedAtlasMap<const PackedImageRect*> atlas_map_;
-    std::unique_ptr<ImageAtlasTexture> texture_;
+    std::vector<std::unique_ptr<Page>> pages_;
+    Page* open_page_ = nullptr;
+    int max_page_size_ = kDefaultMaxPageSize;
+    mutable DecodedImageCache decoded_cache_;
+    bool async_decoding_ = false;
+    std::shared_ptr<DecodeResults> decode_results_;
+    std::unique_ptr<Migration> migration_;
+    int num_decoding_ = 0;
+    double last_decoded_time_ = -1.0;
     std::shared_ptr<ImageAtlas*> reference_;
   };
 }
\ No newline at end of file
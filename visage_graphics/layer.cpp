@@ -22,16 +22,35 @@
 #include "layer.h"
 
 #include "canvas.h"
+#include "graphics_caches.h"
 #include "region.h"
 #include "renderer.h"
+#include "resource_usage.h"
+#include "visage_utils/trace.h"
 
 #include <bgfx/bgfx.h>
+#include <limits>
 
 namespace visage {
+  struct ReadBack {
+    bgfx::TextureHandle handle = BGFX_INVALID_HANDLE;
+    Screenshot screenshot;
+    Layer::ScreenshotCallback callback;
+    TrackedResource memory;
+    uint32_t ready_frame = 0;
+    bool requested = false;
+    bool pending = false;
+  };
+
   struct FrameBufferData {
+    ReadBack read_backs[Layer::kReadBackPoolSize];
     bgfx::TextureHandle read_back_handle = BGFX_INVALID_HANDLE;
     bgfx::FrameBufferHandle handle = BGFX_INVALID_HANDLE;
     bgfx::TextureFormat::Enum format = bgfx::TextureFormat::RGBA8;
+    bool stencil = false;
+    bool pooled = false;
+    TrackedResource memory;
+    TrackedResource read_back_memory;
   };
 
   struct RegionPosition {
@@ -41,26 +60,129 @@ namespace visage {
 
     Region* region = nullptr;
     std::vector<IBounds> invalid_rects;
+    std::vector<IBounds> draw_rects;
+    bool covered = false;
     int position = 0;
     int x = 0;
     int y = 0;
+    // How many stencil clips the region draws inside, counting its own, and whether it marks
+    // one. Clips past the stencil's bits don't mark and only get their rect clipping.
+    int clip_depth = 0;
+    bool clips = false;
 
+    // The region's own shapes skip what opaque children cover, but children still get every rect.
+    std::vector<IBounds>& drawRects() { return covered ? draw_rects : invalid_rects; }
     SubmitBatch* currentBatch() const { return region->submitBatchAtPosition(position); }
     bool isDone() const { return position >= region->numSubmitBatches(); }
+    int stencilKey() const { return clip_depth * 2 + (clips ? 1 : 0); }
+
+    void setParentClipDepth(int parent_depth) {
+      clips = region->stencilClip() && !region->isEmpty() && parent_depth < kMaxStencilClipDepth;
+      clip_depth = parent_depth + (clips ? 1 : 0);
+    }
   };
 
-  inline void moveToVector(std::vector<IBounds>& rects, std::vector<IBounds>& pieces) {
-    rects.insert(rects.end(), pieces.begin(), pieces.end());
-    pieces.clear();
+  struct Occluder {
+    int order = 0;
+    IBounds bounds;
+  };
+
+  static int drawOrder(const std::vector<Region*>& regions, int index) {
+    return regions[index]->isOnTop() ? regions.size() + index : index;
+  }
+
+  // Splitting partly covered rects stops paying off once the scissor rects get too fragmented.
+  static constexpr int kMaxUncoveredPieces = 8;
+
+  static std::vector<IBounds> uncoveredRects(const std::vector<IBounds>& rects,
+                                             const std::vector<Occluder>& occluders, int order) {
+    IRegion remaining;
+    for (const IBounds& rect : rects)
+      remaining.add(rect);
+
+    for (const Occluder& occluder : occluders) {
+      if (occluder.order <= order)
+        continue;
+
+      remaining.subtract(occluder.bounds);
+      if (remaining.isEmpty())
+        break;
+    }
+    return remaining.rects();
+  }
+
+  // Regions only draw inside their invalid rects, so they need ordering against each other only
+  // where those rects meet.
+  static bool invalidRectsOverlap(const std::vector<IBounds>& rects,
+                                  const std::vector<IBounds>& others) {
+    for (const IBounds& rect : rects) {
+      for (const IBounds& other : others) {
+        if (rect.overlaps(other))
+          return true;
+      }
+    }
+    return false;
+  }
+
+  static void addSubRegions(std::vector<RegionPosition>& positions, std::vector<RegionPosition>& overlapping,
+                            const RegionPosition& done_position, int backdrop_count);
+
+  // Opaque children drawn in the same pass hide their parent, so the parent's shapes are only
+  // drawn around them. Returns true when the children cover everything the parent would draw.
+  static bool coverWithOpaqueChildren(RegionPosition& position, int backdrop_count) {
+    // The clip's stencil marks have to reach everywhere its children draw.
+    if (position.clips)
+      return false;
+
+    std::vector<Occluder> occluders;
+    for (const Region* child : position.region->subRegions()) {
+      if (child->isOpaque() && child->isVisible() && !child->needsLayer() && !child->isEmpty() &&
+          !child->stencilClip() && child->backdropCount() == backdrop_count) {
+        IBounds bounds(position.x + child->x(), position.y + child->y(), child->width(),
+                       child->height());
+        occluders.push_back({ 1, bounds });
+      }
+    }
+    if (occluders.empty())
+      return false;
+
+    std::vector<IBounds> uncovered = uncoveredRects(position.invalid_rects, occluders, 0);
+    if (uncovered.size() > kMaxUncoveredPieces)
+      return false;
+
+    position.draw_rects = std::move(uncovered);
+    position.covered = true;
+    return position.draw_rects.empty();
+  }
+
+  static void addDrawnPosition(std::vector<RegionPosition>& positions,
+                               std::vector<RegionPosition>& overlapping, RegionPosition position,
+                               int backdrop_count) {
+    if (coverWithOpaqueChildren(position, backdrop_count))
+      addSubRegions(positions, overlapping, position, backdrop_count);
+    else
+      positions.push_back(std::move(position));
   }
 
   static void addSubRegions(std::vector<RegionPosition>& positions, std::vector<RegionPosition>& overlapping,
                             const RegionPosition& done_position, int backdrop_count) {
-    auto begin = done_position.region->subRegions().cbegin();
-    auto end = done_position.region->subRegions().cend();
+    const std::vector<Region*>& sub_regions = done_position.region->subRegions();
+    auto begin = sub_regions.cbegin();
+    auto end = sub_regions.cend();
     if (begin == end)
       return;
 
+    std::vector<Occluder> occluders;
+    for (int i = 0; i < sub_regions.size(); ++i) {
+      const Region* region = sub_regions[i];
+      if (region->isOpaque() && region->isVisible() && !region->needsLayer() &&
+          !region->stencilClip()) {
+        IBounds bounds(done_position.x + region->x(), done_position.y + region->y(),
+                       region->width(), region->height());
+        occluders.push_back({ drawOrder(sub_regions, i), bounds });
+      }
+    }
+
     bool on_top = false;
     for (auto it = begin; it != end || !on_top; ++it) {
       if (it == end) {
@@ -75,6 +197,7 @@ namespace visage {
       if (sub_region->backdropCount() > backdrop_count || sub_region->backdropCountChildren() < backdrop_count)
         continue;
 
+      int order = drawOrder(sub_regions, it - begin);
       bool should_draw = sub_region->shouldDraw(backdrop_count);
       if (sub_region->needsLayer())
         sub_region = sub_region->intermediateRegion();
@@ -82,11 +205,6 @@ namespace visage {
       IBounds bounds(done_position.x + sub_region->x(), done_position.y + sub_region->y(),
                      sub_region->width(), sub_region->height());
 
-      bool overlaps = std::any_of(positions.begin(), positions.end(), [&bounds](const RegionPosition& other) {
-        IBounds other_bounds(other.x, other.y, other.region->width(), other.region->height());
-        return bounds.overlaps(other_bounds);
-      });
-
       std::vector<IBounds> invalid_rects;
       for (const IBounds& invalid_rect : done_position.invalid_rects) {
         if (bounds.overlaps(invalid_rect))
@@ -96,16 +214,27 @@ namespace visage {
       if (invalid_rects.empty())
         continue;
 
-      if (overlaps) {
-        RegionPosition overlap(sub_region, std::move(invalid_rects), 0, bounds.x(), bounds.y());
-        overlapping.push_back(overlap);
-      }
-      else if (sub_region->isEmpty() || !should_draw) {
-        addSubRegions(positions, overlapping,
-                      { sub_region, std::move(invalid_rects), 0, bounds.x(), bounds.y() }, backdrop_count);
+      if (!occluders.empty()) {
+        std::vector<IBounds> uncovered = uncoveredRects(invalid_rects, occluders, order);
+        if (uncovered.empty())
+          continue;
+        if (uncovered.size() <= kMaxUncoveredPieces)
+          invalid_rects = std::move(uncovered);
       }
+
+      auto overlaps_position = [&invalid_rects](const RegionPosition& other) {
+        return invalidRectsOverlap(invalid_rects, other.invalid_rects);
+      };
+      bool overlaps = std::any_of(positions.begin(), positions.end(), overlaps_position);
+
+      RegionPosition position(sub_region, std::move(invalid_rects), 0, bounds.x(), bounds.y());
+      position.setParentClipDepth(done_position.clip_depth);
+      if (overlaps)
+        overlapping.push_back(std::move(position));
+      else if (sub_region->isEmpty() || !should_draw)
+        addSubRegions(positions, overlapping, position, backdrop_count);
       else
-        positions.emplace_back(sub_region, std::move(invalid_rects), 0, bounds.x(), bounds.y());
+        addDrawnPosition(positions, overlapping, std::move(position), backdrop_count);
     }
   }
 
@@ -115,15 +244,14 @@ namespace visage {
 
     for (auto it = overlapping.begin(); it != overlapping.end();) {
       bool overlaps = std::any_of(positions.begin(), positions.end(), [it](const RegionPosition& other) {
-        return it->x < other.x + other.region->width() && it->x + it->region->width() > other.x &&
-               it->y < other.y + other.region->height() && it->y + it->region->height() > other.y;
+        return invalidRectsOverlap(it->invalid_rects, other.invalid_rects);
       });
 
       if (!overlaps) {
         if (it->isDone())
           addSubRegions(positions, new_overlapping, *it, backdrop_count);
         else
-          positions.push_back(*it);
+          addDrawnPosition(positions, new_overlapping, *it, backdrop_count);
         it = overlapping.erase(it);
       }
       else
@@ -133,20 +261,62 @@ namespace visage {
     overlapping.insert(overlapping.begin(), new_overlapping.begin(), new_overlapping.end());
   }
 
-  static const SubmitBatch* nextBatch(const std::vector<RegionPosition>& positions,
-                                      const SubmitBatch* current) {
-    const SubmitBatch* next_batch = positions[0].currentBatch();
+  // Cycles through batch types in a stable order starting after the current one.
+  static bool batchesBefore(const SubmitBatch* a, const SubmitBatch* b,
+                            const SubmitBatch* current) {
+    bool a_after_current = a->compare(current) > 0;
+    bool b_after_current = b->compare(current) > 0;
+    if (a_after_current != b_after_current)
+      return a_after_current;
+    return a->compare(b) < 0;
+  }
+
+  struct NextBatch {
+    const SubmitBatch* batch = nullptr;
+    int stencil_key = 0;
+  };
+
+  // Positions never overlap each other where they draw, so any of their current batches can go
+  // next. Taking the type that the most regions are waiting on merges the most draws. Batches
+  // only merge under the same stencil clip state.
+  static NextBatch nextBatch(const std::vector<RegionPosition>& positions,
+                             const SubmitBatch* current) {
+    struct Candidate {
+      const SubmitBatch* batch = nullptr;
+      int stencil_key = 0;
+      int count = 0;
+    };
+
+    std::vector<Candidate> candidates;
     for (auto& position : positions) {
       const SubmitBatch* batch = position.currentBatch();
-      if (next_batch->compare(batch) > 0) {
-        if (batch->compare(current) > 0 || next_batch->compare(current) < 0)
-          next_batch = position.currentBatch();
-      }
-      else if (next_batch->compare(current) < 0 && batch->compare(current) > 0)
-        next_batch = position.currentBatch();
+      int stencil_key = position.stencilKey();
+      auto candidate = std::find_if(candidates.begin(), candidates.end(), [&](const Candidate& c) {
+        return c.stencil_key == stencil_key && c.batch->match(batch);
+      });
+      if (candidate == candidates.end())
+        candidates.push_back({ batch, stencil_key, 1 });
+      else
+        candidate->count++;
+    }
+
+    Candidate next = candidates[0];
+    for (const Candidate& candidate : candidates) {
+      if (candidate.count > next.count ||
+          (candidate.count == next.count && batchesBefore(candidate.batch, next.batch, current)))
+        next = candidate;
     }
+    return { next.batch, next.stencil_key };
+  }
 
-    return next_batch;
+  static bool anyStencilClip(const Region* region) {
+    if (region->stencilClip())
+      return true;
+
+    const std::vector<Region*>& sub_regions = region->subRegions();
+    return std::any_of(sub_regions.begin(), sub_regions.end(), [](const Region* sub_region) {
+      return !sub_region->needsLayer() && anyStencilClip(sub_region);
+    });
   }
 
   Layer::Layer(GradientAtlas* gradient_atlas) : gradient_atlas_(gradient_atlas) {
@@ -165,14 +335,21 @@ namespace visage {
     if (bgfx::isValid(frame_buffer_data_->handle))
       return;
 
+    frame_buffer_data_->stencil = false;
     if (hdr_)
       frame_buffer_data_->format = bgfx::TextureFormat::RGB10A2;
     else
       frame_buffer_data_->format = bgfx::TextureFormat::RGBA8;
 
+    bool stencil = stencil_ && bgfx::isTextureValid(0, false, 1, bgfx::TextureFormat::D24S8,
+                                                    BGFX_TEXTURE_RT_WRITE_ONLY);
+    long long stencil_bytes = 0;
     if (window_handle_) {
+      bgfx::TextureFormat::Enum depth_format = stencil ? bgfx::TextureFormat::D24S8 :
+                                                         bgfx::TextureFormat::Count;
       frame_buffer_data_->handle = bgfx::createFrameBuffer(window_handle_, width_, height_,
-                                                           frame_buffer_data_->format);
+                                                           frame_buffer_data_->format, depth_format);
+      frame_buffer_data_->stencil = stencil;
     }
     else {
       bool read_back = (bgfx::getCaps()->supported & BGFX_CAPS_TEXTURE_BLIT) &&
@@ -181,21 +358,82 @@ namespace visage {
         uint64_t flags = BGFX_TEXTURE_BLIT_DST | BGFX_TEXTURE_READ_BACK;
         frame_buffer_data_->read_back_handle = bgfx::createTexture2D(width_, height_, false, 1,
                                                                      bgfx::TextureFormat::RGBA8, flags);
+        TrackedResource& memory = frame_buffer_data_->read_back_memory;
+        memory.reset(ResourceCategory::ReadBackTextures,
+                     ResourceTracker::textureBytes(width_, height_, bgfx::TextureFormat::RGBA8));
+      }
+      if (stencil) {
+        bgfx::TextureHandle textures[] = {
+          bgfx::createTexture2D(width_, height_, false, 1, frame_buffer_data_->format,
+                                kFrameBufferFlags),
+          bgfx::createTexture2D(width_, height_, false, 1, bgfx::TextureFormat::D24S8,
+                                BGFX_TEXTURE_RT_WRITE_ONLY),
+        };
+        frame_buffer_data_->handle = bgfx::createFrameBuffer(2, textures, true);
+        frame_buffer_data_->stencil = true;
+        stencil_bytes = ResourceTracker::textureBytes(width_, height_, bgfx::TextureFormat::D24S8);
+      }
+      else if (intermediate_layer_ && !headless_render_) {
+        // Plain packed layers share render targets with post effects so a layer that empties
+        // out hands its memory to whichever layer or effect needs that size next.
+        ResourceCategory category = ResourceCategory::LayerFrameBuffers;
+        int format = frame_buffer_data_->format;
+        frame_buffer_data_->handle = FrameBufferPool::keepBuffer(width_, height_, format, category);
+        frame_buffer_data_->pooled = bgfx::isValid(frame_buffer_data_->handle);
+      }
+      else {
+        frame_buffer_data_->handle = bgfx::createFrameBuffer(width_, height_,
+                                                             frame_buffer_data_->format,
+                                                             kFrameBufferFlags);
       }
-      frame_buffer_data_->handle = bgfx::createFrameBuffer(width_, height_, frame_buffer_data_->format,
-                                                           kFrameBufferFlags);
+    }
+
+    if (!bgfx::isValid(frame_buffer_data_->handle))
+      frame_buffer_data_->stencil = false;
+    else if (!frame_buffer_data_->pooled) {
+      long long bytes = ResourceTracker::textureBytes(width_, height_, frame_buffer_data_->format);
+      frame_buffer_data_->memory.reset(ResourceCategory::LayerFrameBuffers, bytes + stencil_bytes);
     }
 
     bottom_left_origin_ = bgfx::getCaps()->originBottomLeft;
   }
 
   void Layer::destroyFrameBuffer() {
+    for (ReadBack& read_back : frame_buffer_data_->read_backs) {
+      if (bgfx::isValid(read_back.handle)) {
+        bgfx::destroy(read_back.handle);
+        read_back.handle = BGFX_INVALID_HANDLE;
+        read_back.memory.reset();
+      }
+    }
+
+    if (bgfx::isValid(frame_buffer_data_->read_back_handle)) {
+      bgfx::destroy(frame_buffer_data_->read_back_handle);
+      frame_buffer_data_->read_back_handle = BGFX_INVALID_HANDLE;
+      frame_buffer_data_->read_back_memory.reset();
+    }
+
     if (bgfx::isValid(frame_buffer_data_->handle)) {
-      bgfx::destroy(frame_buffer_data_->handle);
+      if (frame_buffer_data_->pooled)
+        FrameBufferPool::releaseBuffer(frame_buffer_data_->handle);
+      else
+        bgfx::destroy(frame_buffer_data_->handle);
       frame_buffer_data_->handle = BGFX_INVALID_HANDLE;
+      frame_buffer_data_->pooled = false;
+      frame_buffer_data_->memory.reset();
     }
   }
 
+  void Layer::releaseIfIdle() {
+    if (!regions_.empty() || !intermediate_layer_) {
+      idle_submits_ = 0;
+      return;
+    }
+
+    if (idle_submits_ < kReleaseIdleSubmits && ++idle_submits_ == kReleaseIdleSubmits)
+      destroyFrameBuffer();
+  }
+
   bgfx::FrameBufferHandle& Layer::frameBuffer() const {
     return frame_buffer_data_->handle;
   }
@@ -208,29 +446,61 @@ namespace visage {
     IBounds region_bounds = boundsForRegion(region);
     rect = rect + IPoint(region_bounds.x(), region_bounds.y());
     rect = rect.intersection(region_bounds);
+    if (rect.width() <= 0 || rect.height() <= 0)
+      return;
 
-    std::vector<IBounds>& invalid_rects = invalid_rects_[region];
+    IRegion& invalid_area = invalid_rects_[region];
+    if (invalid_area.contains(rect))
+      return;
 
-    for (auto it = invalid_rects.begin(); it != invalid_rects.end();) {
-      IBounds& invalid_rect = *it;
-      if (invalid_rect.contains(rect)) {
-        moveToVector(invalid_rects, invalid_rect_pieces_);
+    invalid_area.add(rect);
+    coalesceInvalidArea(invalid_area);
+  }
+
+  static int64_t rectArea(const IBounds& rect) {
+    return static_cast<int64_t>(std::max(0, rect.width())) * std::max(0, rect.height());
+  }
+
+  // Merging two rects into their bounding box trades overdraw for fewer scissored draws. The merged
+  // box goes back into the banded area, so the rects stay non-overlapping.
+  void Layer::coalesceInvalidArea(IRegion& invalid_area) {
+    const std::vector<IBounds>& invalid_rects = invalid_area.rects();
+    int max_rects = coalescing_.max_rects_per_region;
+    int max_merges = invalid_rects.size();
+    for (int merge = 0; merge < max_merges && invalid_rects.size() > 1; ++merge) {
+      bool over_limit = max_rects > 0 && invalid_rects.size() > max_rects;
+      if (!over_limit && coalescing_.merge_overdraw_area <= 0)
         return;
-      }
 
-      if (rect.contains(invalid_rect)) {
-        it = invalid_rects.erase(it);
-        continue;
+      int best_a = 0;
+      int best_b = 1;
+      int64_t best_overdraw = std::numeric_limits<int64_t>::max();
+      for (int a = 0; a < invalid_rects.size(); ++a) {
+        for (int b = a + 1; b < invalid_rects.size(); ++b) {
+          int64_t overdraw = rectArea(invalid_rects[a].unioned(invalid_rects[b])) -
+                             rectArea(invalid_rects[a]) - rectArea(invalid_rects[b]);
+          if (overdraw < best_overdraw) {
+            best_overdraw = overdraw;
+            best_a = a;
+            best_b = b;
+          }
+        }
       }
-      IBounds::breakIntoNonOverlapping(rect, invalid_rect, invalid_rect_pieces_);
-      ++it;
+
+      if (!over_limit && best_overdraw > coalescing_.merge_overdraw_area)
+        return;
+
+      invalid_area.add(invalid_rects[best_a].unioned(invalid_rects[best_b]));
     }
 
-    invalid_rects.push_back(rect);
-    moveToVector(invalid_rects, invalid_rect_pieces_);
+    if (max_rects > 0 && invalid_rects.size() > max_rects) {
+      IBounds bounds = invalid_area.bounds();
+      invalid_area.clear();
+      invalid_area.add(bounds);
+    }
   }
 
-  void Layer::checkBackdropInvalidation(const std::vector<IBounds>& top_level_invalid_rects) {
+  void Layer::checkBackdropInvalidation(const IRegion& top_level_invalid_area) {
     for (Region* region : regions_) {
       if (region->backdropEffect()) {
         IBounds bounds(0, 0, region->width(), region->height());
@@ -240,10 +510,8 @@ namespace visage {
           parent = parent->parent();
         }
 
-        if (std::any_of(top_level_invalid_rects.begin(), top_level_invalid_rects.end(),
-                        [&bounds](const auto& invalid_rect) { return bounds.overlaps(invalid_rect); })) {
+        if (top_level_invalid_area.overlaps(bounds))
           region->invalidate();
-        }
       }
     }
   }
@@ -256,8 +524,8 @@ namespace visage {
   void Layer::clearInvalidRectAreas(int submit_pass) {
     ShapeBatch<Fill> clear_batch(BlendMode::Opaque);
     std::vector<IBounds> invalid_rects;
-    for (auto& region_invalid_rects : invalid_rects_) {
-      for (const IBounds& rect : region_invalid_rects.second) {
+    for (const InvalidRectStore::Entry* entry : invalid_rects_) {
+      for (const IBounds& rect : entry->area) {
         invalid_rects.push_back(rect);
         float x = rect.x();
         float y = rect.y();
@@ -271,10 +539,104 @@ namespace visage {
     clear_batch.submit(*this, submit_pass, { positioned_clear });
   }
 
+  const PackedBrush* Layer::debugBrush(int index) {
+    static constexpr unsigned int kDebugColors[] = { 0x66ff3b30, 0x66ff9500, 0x66ffcc00,
+                                                     0x6634c759, 0x6600c7be, 0x66007aff,
+                                                     0x665856d6, 0x66ff2d55 };
+    static constexpr int kNumDebugColors = sizeof(kDebugColors) / sizeof(kDebugColors[0]);
+
+    if (debug_brushes_.empty()) {
+      for (unsigned int color : kDebugColors) {
+        Brush brush = Brush::solid(color);
+        debug_brushes_.push_back(std::make_unique<const PackedBrush>(gradient_atlas_, brush));
+      }
+    }
+    return debug_brushes_[index % kNumDebugColors].get();
+  }
+
+  void Layer::submitDebugDraw(int submit_pass, int backdrop_count) {
+    static constexpr unsigned int kOverdrawColor = 0x40ff6020;
+    static constexpr unsigned int kBoundsColor = 0xff00ffff;
+
+    std::vector<IBounds> invalid_rects;
+    for (const InvalidRectStore::Entry* entry : invalid_rects_)
+      invalid_rects.insert(invalid_rects.end(), entry->area.begin(), entry->area.end());
+
+    std::vector<Fill> fills;
+    auto add_rect = [&fills](const IBounds& rect, const PackedBrush* brush) {
+      float x = rect.x();
+      float y = rect.y();
+      float width = rect.width();
+      float height = rect.height();
+      fills.emplace_back(ClampBounds { x, y, x + width, y + height }, brush, x, y, width, height);
+    };
+    auto submit_fills = [&](BlendMode blend_mode, std::vector<IBounds>* rects, int x, int y) {
+      if (fills.empty())
+        return;
+
+      ShapeBatch<Fill> batch(blend_mode);
+      batch.addShapes(fills.data(), fills.size());
+      PositionedBatch positioned = { &batch, rects, x, y };
+      batch.submit(*this, submit_pass, { positioned });
+      fills.clear();
+    };
+
+    switch (debug_draw_) {
+    case DebugDraw::Overdraw: {
+      PackedBrush black(gradient_atlas_, Brush::solid(0xff000000));
+      PackedBrush heat(gradient_atlas_, Brush::solid(kOverdrawColor));
+      if (backdrop_count == 0) {
+        for (const IBounds& rect : invalid_rects)
+          add_rect(rect, &black);
+        submit_fills(BlendMode::Opaque, &invalid_rects, 0, 0);
+      }
+      for (DebugSource& source : debug_sources_) {
+        source.batch->addDebugFills(fills, &heat);
+        submit_fills(BlendMode::Add, &source.invalid_rects, source.x, source.y);
+      }
+      break;
+    }
+    case DebugDraw::Batches:
+      for (DebugSource& source : debug_sources_) {
+        source.batch->addDebugFills(fills, debugBrush(source.draw_index));
+        submit_fills(BlendMode::Alpha, &source.invalid_rects, source.x, source.y);
+      }
+      break;
+    case DebugDraw::InvalidRects:
+      for (const IBounds& rect : invalid_rects)
+        add_rect(rect, debugBrush(debug_frame_));
+      submit_fills(BlendMode::Alpha, &invalid_rects, 0, 0);
+      debug_frame_++;
+      break;
+    case DebugDraw::LayerBounds: {
+      PackedBrush outline(gradient_atlas_, Brush::solid(kBoundsColor));
+      for (const Region* region : regions_) {
+        IBounds bounds = boundsForRegion(region);
+        add_rect({ bounds.x(), bounds.y(), bounds.width(), 1 }, &outline);
+        add_rect({ bounds.x(), bounds.bottom() - 1, bounds.width(), 1 }, &outline);
+        add_rect({ bounds.x(), bounds.y(), 1, bounds.height() }, &outline);
+        add_rect({ bounds.right() - 1, bounds.y(), 1, bounds.height() }, &outline);
+      }
+      submit_fills(BlendMode::Alpha, &invalid_rects, 0, 0);
+      break;
+    }
+    default: break;
+    }
+    debug_sources_.clear();
+  }
+
   int Layer::submit(int submit_pass, int backdrop_count) {
+    submit_stats_ = {};
     if (!anyInvalidRects() && !(hasBackdropEffect() && backdrop_count > 0))
       return submit_pass;
 
+    VISAGE_TRACE_SCOPE("Layer::submit");
+    // The stencil buffer is added the first time a region clips with it and kept from then on.
+    if (!stencil_ && std::any_of(regions_.begin(), regions_.end(), anyStencilClip)) {
+      stencil_ = true;
+      destroyFrameBuffer();
+      invalidate();
+    }
     checkFrameBuffer();
 
     std::vector<RegionPosition> region_positions;
@@ -297,12 +659,14 @@ namespace visage {
       }
 
       IPoint point = coordinatesForRegion(region);
-      if (region->isEmpty() || !region->shouldDraw(backdrop_count)) {
-        addSubRegions(region_positions, overlapping_regions,
-                      { region, invalid_rects_[region], 0, point.x, point.y }, backdrop_count);
+      RegionPosition position(region, invalid_rects_.rects(region), 0, point.x, point.y);
+      position.setParentClipDepth(0);
+      if (region->isEmpty() || !region->shouldDraw(backdrop_count))
+        addSubRegions(region_positions, overlapping_regions, position, backdrop_count);
+      else {
+        addDrawnPosition(region_positions, overlapping_regions, std::move(position),
+                         backdrop_count);
       }
-      else
-        region_positions.emplace_back(region, invalid_rects_[region], 0, point.x, point.y);
     }
     if (region_positions.empty())
       return submit_pass;
@@ -320,19 +684,33 @@ namespace visage {
     if (intermediate_layer_ && backdrop_count == 0)
       clearInvalidRectAreas(submit_pass);
 
+    bool stencil = frame_buffer_data_->stencil;
     while (!region_positions.empty()) {
-      const SubmitBatch* next_batch = nextBatch(region_positions, current_batch);
+      NextBatch next = nextBatch(region_positions, current_batch);
+      int clip_depth = 0;
+      bool clips = false;
       for (auto& region_position : region_positions) {
         SubmitBatch* batch = region_position.currentBatch();
-        if (!batch->match(next_batch))
+        if (region_position.stencilKey() != next.stencil_key || !batch->match(next.batch))
           continue;
 
-        batches.push_back({ batch, &region_position.invalid_rects, region_position.x,
+        clip_depth = region_position.clip_depth;
+        clips = region_position.clips;
+        batches.push_back({ batch, &region_position.drawRects(), region_position.x,
                             region_position.y });
         region_position.position++;
       }
 
+      setStencilClipDepth(stencil ? clip_depth : 0, clips);
       batches.front().batch->submit(*this, submit_pass, batches);
+      submit_stats_.batch_submits++;
+      submit_stats_.region_batches += batches.size();
+      if (debug_draw_ == DebugDraw::Overdraw || debug_draw_ == DebugDraw::Batches) {
+        for (const PositionedBatch& batch : batches) {
+          debug_sources_.push_back({ batch.batch, *batch.invalid_rects, batch.x, batch.y,
+                                     submit_stats_.batch_submits });
+        }
+      }
       batches.clear();
 
       auto done_it = std::partition(region_positions.begin(), region_positions.end(),
@@ -348,17 +726,44 @@ namespace visage {
         checkOverlappingRegions(region_positions, overlapping_regions, backdrop_count);
 
       done_regions.clear();
-      current_batch = next_batch;
+      current_batch = next.batch;
     }
+    setStencilClipDepth(0);
+
+    if (debug_draw_ != DebugDraw::None)
+      submitDebugDraw(submit_pass, backdrop_count);
 
     if (screenshot_requested_ && bgfx::isValid(frame_buffer_data_->read_back_handle)) {
       screenshot_requested_ = false;
-      bgfx::blit(submit_pass, frame_buffer_data_->read_back_handle, 0, 0,
-                 bgfx::getTexture(frame_buffer_data_->handle), 0, 0, width_, height_);
+      encoder()->blit(submit_pass, frame_buffer_data_->read_back_handle, 0, 0,
+                      bgfx::getTexture(frame_buffer_data_->handle), 0, 0, width_, height_);
 
       screenshot_.setDimensions(width_, height_);
       bgfx::readTexture(frame_buffer_data_->read_back_handle, screenshot_.data());
-      bgfx::frame();
+      Renderer::instance().frame();
+      UniformCache::nextFrame();
+    }
+
+    for (ReadBack& read_back : frame_buffer_data_->read_backs) {
+      if (!read_back.requested || !bgfx::isValid(frame_buffer_data_->handle))
+        continue;
+
+      if (!bgfx::isValid(read_back.handle)) {
+        uint64_t flags = BGFX_TEXTURE_BLIT_DST | BGFX_TEXTURE_READ_BACK;
+        read_back.handle = bgfx::createTexture2D(width_, height_, false, 1,
+                                                 bgfx::TextureFormat::RGBA8, flags);
+        read_back.memory.reset(ResourceCategory::ReadBackTextures,
+                               ResourceTracker::textureBytes(width_, height_,
+                                                             bgfx::TextureFormat::RGBA8));
+      }
+      if (read_back.screenshot.width() != width_ || read_back.screenshot.height() != height_)
+        read_back.screenshot.setDimensions(width_, height_);
+
+      bgfx::TextureHandle source = bgfx::getTexture(frame_buffer_data_->handle);
+      encoder()->blit(submit_pass, read_back.handle, 0, 0, source, 0, 0, width_, height_);
+      read_back.ready_frame = bgfx::readTexture(read_back.handle, read_back.screenshot.data());
+      read_back.requested = false;
+      read_back.pending = true;
     }
 
     submit_pass = submit_pass + 1;
@@ -370,19 +775,40 @@ namespace visage {
     return submit_pass;
   }
 
+  int Layer::maxSubmitViews() const {
+    int views = 1;
+    for (const Region* region : regions_) {
+      if (region->postEffect())
+        views += region->postEffect()->maxPreprocessPasses();
+    }
+    return views;
+  }
+
   void Layer::addRegion(Region* region) {
     if (!hdr_ && region->postEffect() && region->postEffect()->hdr())
       setHdr(true);
 
+    VISAGE_ASSERT(region_indices_.count(region) == 0);
+    region_indices_[region] = regions_.size();
     regions_.push_back(region);
   }
 
+  // Keeps the current size while the packed size fits in it and isn't more than a bucket smaller.
+  static int bucketedDimension(int size, int current, int bucket) {
+    if (bucket <= 0)
+      return size;
+    if (size <= current && current - size <= bucket)
+      return current;
+    return (size + bucket - 1) / bucket * bucket;
+  }
+
   void Layer::addPackedRegion(Region* region) {
     addRegion(region);
     if (!atlas_map_.addRect(region, region->width(), region->height())) {
       atlas_map_.pack();
       invalidate();
-      setDimensions(atlas_map_.width(), atlas_map_.height());
+      setDimensions(bucketedDimension(atlas_map_.width(), width_, frame_buffer_bucket_),
+                    bucketedDimension(atlas_map_.height(), height_, frame_buffer_bucket_));
     }
   }
 
@@ -417,6 +843,53 @@ namespace visage {
     invalidate();
   }
 
+  bool Layer::canReadBackAsync() const {
+    uint64_t supported = bgfx::getCaps()->supported;
+    return headless_render_ && (supported & BGFX_CAPS_TEXTURE_BLIT) &&
+           (supported & BGFX_CAPS_TEXTURE_READ_BACK);
+  }
+
+  bool Layer::requestScreenshotAsync(ScreenshotCallback& callback) {
+    VISAGE_ASSERT(canReadBackAsync());
+    for (ReadBack& read_back : frame_buffer_data_->read_backs) {
+      if (read_back.requested || read_back.pending)
+        continue;
+
+      if (bgfx::isValid(read_back.handle) && (read_back.screenshot.width() != width_ ||
+                                              read_back.screenshot.height() != height_)) {
+        bgfx::destroy(read_back.handle);
+        read_back.handle = BGFX_INVALID_HANDLE;
+        read_back.memory.reset();
+      }
+      read_back.callback = std::move(callback);
+      read_back.requested = true;
+      invalidate();
+      return true;
+    }
+    return false;
+  }
+
+  void Layer::finishReadBacks(uint32_t frame) {
+    for (ReadBack& read_back : frame_buffer_data_->read_backs) {
+      if (!read_back.pending || frame < read_back.ready_frame)
+        continue;
+
+      read_back.pending = false;
+      ScreenshotCallback callback = std::move(read_back.callback);
+      read_back.callback = nullptr;
+      if (callback)
+        callback(read_back.screenshot);
+    }
+  }
+
+  bool Layer::readBacksPending() const {
+    for (const ReadBack& read_back : frame_buffer_data_->read_backs) {
+      if (read_back.requested || read_back.pending)
+        return true;
+    }
+    return false;
+  }
+
   const Screenshot& Layer::screenshot() const {
     if (headless_render_)
       return screenshot_;
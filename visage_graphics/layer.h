@@ -26,38 +26,177 @@
 #include "screenshot.h"
 #include "visage_utils/space.h"
 
+#include <deque>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
 namespace visage {
   class Region;
+  class SubmitBatch;
   struct FrameBufferData;
+  class WorkerPool;
+
+  // Debug views drawn over a layer's content after each submit. Overdraw adds up every quad
+  // rasterized per pixel, Batches tints each draw call's shapes with its own color, InvalidRects
+  // flashes the rects redrawn this frame and LayerBounds outlines every region in the layer.
+  enum class DebugDraw {
+    None,
+    Overdraw,
+    Batches,
+    InvalidRects,
+    LayerBounds,
+  };
+
+  struct InvalidRectCoalescing {
+    int max_rects_per_region = 16;
+    int merge_overdraw_area = 1024;
+  };
+
+  // Invalid area for each region drawn in a layer. A region keeps its slot, and the capacity of
+  // its rects, across frames so clearing and refilling them each frame doesn't allocate.
+  class InvalidRectStore {
+  public:
+    struct Entry {
+      const Region* region = nullptr;
+      IRegion area;
+      bool active = false;
+    };
+
+    IRegion& operator[](const Region* region) {
+      Entry& entry = entryForRegion(region);
+      if (!entry.active) {
+        entry.active = true;
+        active_.push_back(&entry);
+      }
+      return entry.area;
+    }
+
+    const IRegion& area(const Region* region) const {
+      static const IRegion kNoArea;
+      auto slot = slots_.find(region);
+      if (slot == slots_.end())
+        return kNoArea;
+      return entries_[slot->second].area;
+    }
+
+    const std::vector<IBounds>& rects(const Region* region) const { return area(region).rects(); }
+
+    void remove(const Region* region) {
+      auto slot = slots_.find(region);
+      if (slot == slots_.end())
+        return;
+
+      Entry& entry = entries_[slot->second];
+      if (entry.active)
+        active_.erase(std::find(active_.begin(), active_.end(), &entry));
+      entry.area.clear();
+      entry.active = false;
+      entry.region = nullptr;
+      free_slots_.push_back(slot->second);
+      slots_.erase(slot);
+    }
+
+    void clear() {
+      for (Entry* entry : active_) {
+        entry->area.clear();
+        entry->active = false;
+      }
+      active_.clear();
+    }
+
+    bool empty() const { return active_.empty(); }
+    std::vector<Entry*>::const_iterator begin() const { return active_.begin(); }
+    std::vector<Entry*>::const_iterator end() const { return active_.end(); }
+
+  private:
+    Entry& entryForRegion(const Region* region) {
+      auto slot = slots_.find(region);
+      if (slot != slots_.end())
+        return entries_[slot->second];
+
+      int index = entries_.size();
+      if (free_slots_.empty())
+        entries_.emplace_back();
+      else {
+        index = free_slots_.back();
+        free_slots_.pop_back();
+      }
+      slots_[region] = index;
+      entries_[index].region = region;
+      return entries_[index];
+    }
+
+    std::deque<Entry> entries_;
+    std::vector<int> free_slots_;
+    std::unordered_map<const Region*, int> slots_;
+    std::vector<Entry*> active_;
+  };
 
   class Layer {
   public:
+    struct SubmitStats {
+      int batch_submits = 0;
+      int region_batches = 0;
+    };
+
     static constexpr int kInvalidRectMemory = 2;
+    static constexpr int kReadBackPoolSize = 3;
+    static constexpr int kReleaseIdleSubmits = 60;
+
+    using ScreenshotCallback = std::function<void(const Screenshot&)>;
 
     explicit Layer(GradientAtlas* gradient_atlas);
     ~Layer();
 
     void checkFrameBuffer();
     void destroyFrameBuffer();
+    // Called once per canvas submit. An intermediate layer left without regions gives its frame
+    // buffer back after kReleaseIdleSubmits submits and allocates a new one when it's drawn again.
+    void releaseIfIdle();
 
     bgfx::FrameBufferHandle& frameBuffer() const;
     int frameBufferFormat() const;
 
     GradientAtlas* gradientAtlas() const { return gradient_atlas_; }
 
-    void checkBackdropInvalidation(const std::vector<IBounds>& top_level_invalid_rects);
+    void checkBackdropInvalidation(const IRegion& top_level_invalid_area);
     bool hasBackdropEffect() const;
     void clearInvalidRectAreas(int submit_pass);
     int submit(int submit_pass, int backdrop_count);
+    // Most views one submit() can use, including its regions' post effect passes.
+    int maxSubmitViews() const;
+    // Batches submitted by the last submit() and how many region batches they merged.
+    const SubmitStats& submitStats() const { return submit_stats_; }
 
     void setIntermediateLayer(bool intermediate_layer) { intermediate_layer_ = intermediate_layer; }
+    // Packed layers round their size up to a multiple of this so regions that grow or shrink a
+    // little, like during a window resize, keep reusing the same frame buffer. Zero packs exactly.
+    void setFrameBufferBucket(int bucket) { frame_buffer_bucket_ = bucket; }
+    int frameBufferBucket() const { return frame_buffer_bucket_; }
+    void setDebugDraw(DebugDraw debug_draw) {
+      debug_draw_ = debug_draw;
+      invalidate();
+    }
+    DebugDraw debugDraw() const { return debug_draw_; }
     void addRegion(Region* region);
+    // Regions in a layer don't overlap so their order doesn't matter, and removal swaps the last
+    // region into the removed one's place.
     void removeRegion(const Region* region) {
-      auto it = std::find(regions_.begin(), regions_.end(), region);
-      if (it != regions_.end())
-        regions_.erase(it);
-      else
+      invalid_rects_.remove(region);
+      auto found = region_indices_.find(region);
+      if (found == region_indices_.end()) {
         VISAGE_ASSERT(false);
+        return;
+      }
+
+      int index = found->second;
+      region_indices_.erase(found);
+      if (index != regions_.size() - 1) {
+        regions_[index] = regions_.back();
+        region_indices_[regions_[index]] = index;
+      }
+      regions_.pop_back();
     }
     void addPackedRegion(Region* region);
     void removePackedRegion(const Region* region);
@@ -66,7 +205,11 @@ namespace visage {
 
     template<typename V>
     void setTexturePositionsForRegion(const Region* region, V* vertices) const {
-      TextureRect rect = atlas_map_.texturePositionsForId(region, bottom_left_origin_);
+      TextureRect rect = atlas_map_.texturePositionsForId(region);
+      if (bottom_left_origin_) {
+        rect.top = height_ - rect.top;
+        rect.bottom = height_ - rect.bottom;
+      }
 
       vertices[0].texture_x = rect.left;
       vertices[0].texture_y = rect.top;
@@ -81,14 +224,16 @@ namespace visage {
     void invalidate() {
       invalid_rects_.clear();
       for (const auto& region : regions_)
-        invalid_rects_[region].push_back(boundsForRegion(region));
+        invalid_rects_[region].add(boundsForRegion(region));
     }
 
-    const std::map<const Region*, std::vector<IBounds>>& invalidRects() const {
-      return invalid_rects_;
-    }
+    const InvalidRectStore& invalidRects() const { return invalid_rects_; }
 
     void invalidateRectInRegion(IBounds rect, const Region* region);
+    void setInvalidRectCoalescing(const InvalidRectCoalescing& coalescing) {
+      coalescing_ = coalescing;
+    }
+    const InvalidRectCoalescing& invalidRectCoalescing() const { return coalescing_; }
     bool anyInvalidRects() const { return !invalid_rects_.empty(); }
     void clearInvalidRects() { invalid_rects_.clear(); }
 
@@ -113,9 +258,23 @@ namespace visage {
       destroyFrameBuffer();
     }
     bool hdr() const { return hdr_; }
+    // Set once a region in the layer clips with the stencil buffer. The frame buffer gets a
+    // stencil attachment from then on.
+    bool stencil() const { return stencil_; }
+
+    void setWorkerPool(WorkerPool* worker_pool) { worker_pool_ = worker_pool; }
+    WorkerPool* workerPool() const { return worker_pool_; }
 
     void requestScreenshot();
     const Screenshot& screenshot() const;
+
+    // Headless layers read back through a pool of textures without waiting on the GPU. The
+    // callback gets the pooled pixels, valid until it returns, from finishReadBacks() once the
+    // frame that read them completes. Returns false when every read back is still in flight.
+    bool canReadBackAsync() const;
+    bool requestScreenshotAsync(ScreenshotCallback& callback);
+    void finishReadBacks(uint32_t frame);
+    bool readBacksPending() const;
     void pairToWindow(void* window_handle, int width, int height) {
       window_handle_ = window_handle;
       setDimensions(width, height);
@@ -136,16 +295,32 @@ namespace visage {
 
     void clear() {
       regions_.clear();
+      region_indices_.clear();
       atlas_map_.clear();
     }
 
   private:
+    struct DebugSource {
+      SubmitBatch* batch = nullptr;
+      std::vector<IBounds> invalid_rects;
+      int x = 0;
+      int y = 0;
+      int draw_index = 0;
+    };
+
+    const PackedBrush* debugBrush(int index);
+    void submitDebugDraw(int submit_pass, int backdrop_count);
+    void coalesceInvalidArea(IRegion& invalid_area);
+
     bool bottom_left_origin_ = false;
     bool hdr_ = false;
+    bool stencil_ = false;
     int width_ = 0;
     int height_ = 0;
     double render_time_ = 0.0;
     bool intermediate_layer_ = false;
+    int frame_buffer_bucket_ = 0;
+    int idle_submits_ = 0;
 
     void* window_handle_ = nullptr;
     bool headless_render_ = false;
@@ -153,11 +328,18 @@ namespace visage {
     Screenshot screenshot_;
 
     GradientAtlas* gradient_atlas_ = nullptr;
+    WorkerPool* worker_pool_ = nullptr;
+    InvalidRectCoalescing coalescing_;
     std::unique_ptr<const PackedBrush> clear_brush_;
+    DebugDraw debug_draw_ = DebugDraw::None;
+    int debug_frame_ = 0;
+    std::vector<DebugSource> debug_sources_;
+    std::vector<std::unique_ptr<const PackedBrush>> debug_brushes_;
     std::unique_ptr<FrameBufferData> frame_buffer_data_;
     PackedAtlasMap<const Region*> atlas_map_;
-    std::map<const Region*, std::vector<IBounds>> invalid_rects_;
-    std::vector<IBounds> invalid_rect_pieces_;
+    InvalidRectStore invalid_rects_;
+    SubmitStats submit_stats_;
     std::vector<Region*> regions_;
+    std::unordered_map<const Region*, int> region_indices_;
   };
 }
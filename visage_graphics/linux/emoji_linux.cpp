@@ -34,9 +34,8 @@ namespace visage {
                          fonts::Twemoji_Mozilla_ttf.size, 0, &face_);
     }
 
-    void drawIntoBuffer(char32_t emoji, int font_size, int write_width, unsigned int* dest,
-                        int dest_width, int dest_x, int dest_y) {
-      FT_UInt glyph_index = FT_Get_Char_Index(face_, emoji);
+    void drawIntoBuffer(const std::vector<EmojiPlacement>& emojis, int font_size, int write_width,
+                        unsigned int* dest, int dest_width) {
       FT_Set_Pixel_Sizes(face_, 0, font_size);
       FT_Int32 flags = FT_LOAD_TARGET_NORMAL;
       if (FT_HAS_COLOR(face_))
@@ -44,6 +43,19 @@ namespace visage {
       else
         flags |= FT_LOAD_RENDER;
 
+      for (const EmojiPlacement& placement : emojis)
+        drawGlyph(placement, flags, write_width, dest, dest_width);
+    }
+
+    ~EmojiRasterizerImpl() {
+      FT_Done_Face(face_);
+      FT_Done_FreeType(library_);
+    }
+
+  private:
+    void drawGlyph(const EmojiPlacement& placement, FT_Int32 flags, int write_width,
+                   unsigned int* dest, int dest_width) {
+      FT_UInt glyph_index = FT_Get_Char_Index(face_, placement.emoji);
       if (FT_Load_Glyph(face_, glyph_index, flags))
         return;
 
@@ -57,18 +69,12 @@ namespace visage {
       int offset_y = std::max(0, write_width - height) / 2;
       for (int y = 0; y < height && y < write_width; ++y) {
         for (int x = 0; x < width && x < write_width; ++x) {
-          int i = (dest_y + y + offset_y) * dest_width + dest_x + x + offset_x;
+          int i = (placement.y + y + offset_y) * dest_width + placement.x + x + offset_x;
           dest[i] = source[y * width + x];
         }
       }
     }
 
-    ~EmojiRasterizerImpl() {
-      FT_Done_Face(face_);
-      FT_Done_FreeType(library_);
-    }
-
-  private:
     FT_Library library_ = nullptr;
     FT_Face face_ = nullptr;
   };
@@ -79,8 +85,8 @@ namespace visage {
 
   EmojiRasterizer::~EmojiRasterizer() = default;
 
-  void EmojiRasterizer::drawIntoBuffer(char32_t emoji, int font_size, int write_width,
-                                       unsigned int* dest, int dest_width, int x, int y) {
-    impl_->drawIntoBuffer(emoji, font_size, write_width, dest, dest_width, x, y);
+  void EmojiRasterizer::drawIntoBuffer(const std::vector<EmojiPlacement>& emojis, int font_size,
+                                       int write_width, unsigned int* dest, int dest_width) {
+    impl_->drawIntoBuffer(emojis, font_size, write_width, dest, dest_width);
   }
 }
@@ -25,6 +25,7 @@
 #include <CoreFoundation/CoreFoundation.h>
 #include <CoreGraphics/CoreGraphics.h>
 #include <CoreText/CoreText.h>
+#include <algorithm>
 
 namespace visage {
 
@@ -32,25 +33,17 @@ namespace visage {
   public:
     EmojiRasterizerImpl() { color_space_ = CGColorSpaceCreateDeviceRGB(); }
 
-    void drawIntoBuffer(char32_t emoji, int font_size, int write_width, unsigned int* dest,
-                        int dest_width, int x, int y) {
-      unsigned int* write_location = dest + (x + y * write_width);
-      CGContextRef context = CGBitmapContextCreate(write_location, write_width, write_width, 8,
-                                                   dest_width * 4, color_space_,
+    void drawIntoBuffer(const std::vector<EmojiPlacement>& emojis, int font_size, int write_width,
+                        unsigned int* dest, int dest_width) {
+      std::vector<unsigned int> staging(write_width * write_width);
+      CGContextRef context = CGBitmapContextCreate(staging.data(), write_width, write_width, 8,
+                                                   write_width * 4, color_space_,
                                                    kCGImageAlphaPremultipliedLast);
-
-      CGContextSetRGBFillColor(context, 1, 1, 1, 0);
-      CGContextFillRect(context, CGRectMake(0, 0, write_width, write_width));
       CGContextSetTextMatrix(context, CGAffineTransformIdentity);
       CGContextTranslateCTM(context, 0, write_width);
       CGContextScaleCTM(context, 1.0, 1.0);
 
-      String emoji_string = emoji;
-      CFStringRef string = CFStringCreateWithCString(NULL, emoji_string.toUtf8().c_str(),
-                                                     kCFStringEncodingUTF8);
-
       CTFontRef font = CTFontCreateWithName(CFSTR("Apple Color Emoji"), font_size, NULL);
-
       CFStringRef keys[] = { kCTFontAttributeName };
       CFTypeRef values[] = { font };
       CFDictionaryRef attributes = CFDictionaryCreate(NULL, (const void**)keys, (const void**)values,
@@ -58,28 +51,39 @@ namespace visage {
                                                       &kCFTypeDictionaryKeyCallBacks,
                                                       &kCFTypeDictionaryValueCallBacks);
 
-      CFAttributedStringRef attributed_string = CFAttributedStringCreate(NULL, string, attributes);
-      CTLineRef line = CTLineCreateWithAttributedString(attributed_string);
-      double ascent, descent, leading;
-      double text_width = CTLineGetTypographicBounds(line, &ascent, &descent, &leading);
-      CGContextSetTextPosition(context, (write_width - text_width) / 2.0, -font_size);
-      CTLineDraw(line, context);
+      for (const EmojiPlacement& placement : emojis) {
+        std::fill(staging.begin(), staging.end(), 0u);
+
+        String emoji_string = placement.emoji;
+        CFStringRef string = CFStringCreateWithCString(NULL, emoji_string.toUtf8().c_str(),
+                                                       kCFStringEncodingUTF8);
+        CFAttributedStringRef attributed_string = CFAttributedStringCreate(NULL, string,
+                                                                           attributes);
+        CTLineRef line = CTLineCreateWithAttributedString(attributed_string);
+        double ascent, descent, leading;
+        double text_width = CTLineGetTypographicBounds(line, &ascent, &descent, &leading);
+        CGContextSetTextPosition(context, (write_width - text_width) / 2.0, -font_size);
+        CTLineDraw(line, context);
+
+        CFRelease(line);
+        CFRelease(attributed_string);
+        CFRelease(string);
+
+        for (int row = 0; row < write_width; ++row) {
+          const unsigned int* source = staging.data() + row * write_width;
+          unsigned int* row_dest = dest + (placement.y + row) * dest_width + placement.x;
+          for (int col = 0; col < write_width; ++col) {
+            unsigned int value = source[col];
+            unsigned int blue = value & 0x00ff0000;
+            unsigned int red = value & 0x000000ff;
+            row_dest[col] = (value & 0xff00ff00) + (red << 16) + (blue >> 16);
+          }
+        }
+      }
 
-      CFRelease(line);
-      CFRelease(attributed_string);
       CFRelease(attributes);
       CFRelease(font);
-      CFRelease(string);
       CGContextRelease(context);
-      for (int i = 0; i < write_width * write_width; ++i) {
-        int row = i / write_width;
-        int col = i % write_width;
-        int index = (y + row) * dest_width + x + col;
-        int value = dest[index];
-        int blue = value & 0x00ff0000;
-        int red = value & 0x000000ff;
-        dest[index] = (value & 0xff00ff00) + (red << 16) + (blue >> 16);
-      }
     }
 
     ~EmojiRasterizerImpl() { CGColorSpaceRelease(color_space_); }
@@ -94,8 +98,8 @@ namespace visage {
 
   EmojiRasterizer::~EmojiRasterizer() = default;
 
-  void EmojiRasterizer::drawIntoBuffer(char32_t emoji, int font_size, int write_width,
-                                       unsigned int* dest, int dest_width, int x, int y) {
-    impl_->drawIntoBuffer(emoji, font_size, write_width, dest, dest_width, x, y);
+  void EmojiRasterizer::drawIntoBuffer(const std::vector<EmojiPlacement>& emojis, int font_size,
+                                       int write_width, unsigned int* dest, int dest_width) {
+    impl_->drawIntoBuffer(emojis, font_size, write_width, dest, dest_width);
   }
 }
@@ -23,13 +23,17 @@
 
 #include "gradient.h"
 #include "theme.h"
+#include "visage_utils/binary_data.h"
 
 #include <algorithm>
+#include <cmath>
 #include <iomanip>
 #include <sstream>
 
 namespace visage {
   void Palette::initWithDefaults() {
+    colors_compiled_ = false;
+    values_compiled_ = false;
     value_map_.clear();
     int num_value_ids = theme::ValueId::numValueIds();
     for (int i = 0; i < num_value_ids; ++i) {
@@ -94,6 +98,82 @@ namespace visage {
           mapped.second = color_movement[mapped.second];
       }
     }
+    colors_compiled_ = false;
+    PackedBrush::paletteColorsChanged();
+  }
+
+  void Palette::compileColors() {
+    int num_overrides = theme::OverrideId::numOverrideIds();
+    compiled_color_stride_ = theme::ColorId::numColorIds();
+    compiled_colors_.assign(num_overrides * compiled_color_stride_, kUnqueriedId);
+    for (const auto& override_map : color_map_) {
+      if (override_map.first.id >= num_overrides)
+        continue;
+
+      int offset = override_map.first.id * compiled_color_stride_;
+      for (const auto& mapped : override_map.second) {
+        if (mapped.first.id < compiled_color_stride_)
+          compiled_colors_[offset + mapped.first.id] = mapped.second;
+      }
+    }
+    colors_compiled_ = true;
+  }
+
+  void Palette::compileValues() {
+    int num_overrides = theme::OverrideId::numOverrideIds();
+    compiled_value_stride_ = theme::ValueId::numValueIds();
+    compiled_values_.assign(num_overrides * compiled_value_stride_, std::nanf(""));
+    for (const auto& override_map : value_map_) {
+      if (override_map.first.id >= num_overrides)
+        continue;
+
+      int offset = override_map.first.id * compiled_value_stride_;
+      for (const auto& mapped : override_map.second) {
+        if (mapped.first.id < compiled_value_stride_)
+          compiled_values_[offset + mapped.first.id] = mapped.second;
+      }
+    }
+    values_compiled_ = true;
+  }
+
+  int Palette::compiledColorIndex(theme::OverrideId override_id, theme::ColorId color_id) {
+    size_t index = static_cast<size_t>(override_id.id) * compiled_color_stride_ + color_id.id;
+    if (color_id.id >= compiled_color_stride_ || index >= compiled_colors_.size())
+      return color_map_[override_id].try_emplace(color_id, kNotSetId).first->second;
+
+    int& compiled = compiled_colors_[index];
+    if (compiled == kUnqueriedId) {
+      color_map_[override_id].try_emplace(color_id, kNotSetId);
+      compiled = kNotSetId;
+    }
+    return compiled;
+  }
+
+  const Brush* Palette::findColor(theme::OverrideId override_id, theme::ColorId color_id) const {
+    int index = kUnqueriedId;
+    size_t compiled = static_cast<size_t>(override_id.id) * compiled_color_stride_ + color_id.id;
+    bool in_range = color_id.id < compiled_color_stride_ && compiled < compiled_colors_.size();
+    if (colors_compiled_ && in_range)
+      index = compiled_colors_[compiled];
+    if (index == kUnqueriedId)
+      index = colorMap(override_id, color_id);
+
+    if (index < 0 || index >= colors_.size())
+      return nullptr;
+    return &colors_[index];
+  }
+
+  float Palette::compiledValue(theme::OverrideId override_id, theme::ValueId value_id) {
+    size_t index = static_cast<size_t>(override_id.id) * compiled_value_stride_ + value_id.id;
+    if (value_id.id >= compiled_value_stride_ || index >= compiled_values_.size())
+      return value_map_[override_id].try_emplace(value_id, kNotSetValue).first->second;
+
+    float& compiled = compiled_values_[index];
+    if (std::isnan(compiled)) {
+      value_map_[override_id].try_emplace(value_id, kNotSetValue);
+      compiled = kNotSetValue;
+    }
+    return compiled;
   }
 
   std::map<std::string, std::vector<theme::ColorId>> Palette::colorIdList(theme::OverrideId override_id) {
@@ -112,6 +192,8 @@ namespace visage {
 
   void Palette::removeColor(int index) {
     colors_.erase(colors_.begin() + index);
+    colors_compiled_ = false;
+    PackedBrush::paletteColorsChanged();
 
     for (auto& override_map : color_map_) {
       for (auto& color : override_map.second) {
@@ -160,6 +242,8 @@ namespace visage {
     std::map<std::string, theme::ValueId> value_name_map = theme::ValueId::nameIdMap();
 
     color_map_.clear();
+    colors_compiled_ = false;
+    values_compiled_ = false;
     std::string override_name;
     std::getline(stream, override_name);
     while (!override_name.empty()) {
@@ -233,4 +317,173 @@ namespace visage {
       colors_[i].decode(stream);
     }
   }
-}
\ No newline at end of file
+
+  namespace {
+    template<typename Id>
+    class BinaryNameTable {
+    public:
+      unsigned int index(Id id) {
+        auto found = indices_.find(id);
+        if (found != indices_.end())
+          return found->second;
+
+        unsigned int result = ids_.size();
+        indices_[id] = result;
+        ids_.push_back(id);
+        return result;
+      }
+
+      template<typename NameFunction>
+      void write(BinaryWriter& writer, NameFunction name) const {
+        writer.write(static_cast<unsigned int>(ids_.size()));
+        for (Id id : ids_)
+          writer.writeString(name(id));
+      }
+
+    private:
+      std::map<Id, unsigned int> indices_;
+      std::vector<Id> ids_;
+    };
+
+    template<typename Id>
+    bool readBinaryNames(BinaryReader& reader, const std::map<std::string, Id>& name_map,
+                         std::vector<Id>& ids) {
+      unsigned int count = 0;
+      if (!reader.read(count) || !reader.canRead(static_cast<size_t>(count) * sizeof(unsigned int)))
+        return reader.fail();
+
+      ids.reserve(count);
+      std::string name;
+      for (unsigned int i = 0; i < count && reader.readString(name); ++i) {
+        auto found = name_map.find(name);
+        ids.push_back(found == name_map.end() ? Id(Id::kInvalidId) : found->second);
+      }
+      return !reader.failed();
+    }
+  }
+
+  std::vector<unsigned char> Palette::encodeBinary() const {
+    BinaryNameTable<theme::OverrideId> override_names;
+    BinaryNameTable<theme::ColorId> color_names;
+    BinaryNameTable<theme::ValueId> value_names;
+
+    std::vector<unsigned char> entries;
+    BinaryWriter entry_writer(entries);
+    int num_color_entries = 0;
+    for (const auto& override_group : color_map_)
+      num_color_entries += override_group.second.size();
+    entry_writer.write(static_cast<unsigned int>(num_color_entries));
+    for (const auto& override_group : color_map_) {
+      unsigned int override_index = override_names.index(override_group.first);
+      for (const auto& color_assignment : override_group.second) {
+        entry_writer.write(override_index);
+        entry_writer.write(color_names.index(color_assignment.first));
+        entry_writer.write(color_assignment.second);
+      }
+    }
+
+    int num_value_entries = 0;
+    for (const auto& override_group : value_map_)
+      num_value_entries += override_group.second.size();
+    entry_writer.write(static_cast<unsigned int>(num_value_entries));
+    for (const auto& override_group : value_map_) {
+      unsigned int override_index = override_names.index(override_group.first);
+      for (const auto& value_assignment : override_group.second) {
+        entry_writer.write(override_index);
+        entry_writer.write(value_names.index(value_assignment.first));
+        entry_writer.write(value_assignment.second);
+      }
+    }
+
+    std::vector<unsigned char> data;
+    BinaryWriter writer(data);
+    writer.write(kBinaryMagic);
+    writer.write(kBinaryVersion);
+    override_names.write(writer, [](theme::OverrideId id) { return theme::OverrideId::name(id); });
+    color_names.write(writer, [](theme::ColorId id) { return theme::ColorId::name(id); });
+    value_names.write(writer, [](theme::ValueId id) { return theme::ValueId::name(id); });
+    data.insert(data.end(), entries.begin(), entries.end());
+
+    writer.write(static_cast<unsigned int>(colors_.size()));
+    for (const auto& color : colors_)
+      color.encodeBinary(writer);
+    return data;
+  }
+
+  bool Palette::decodeBinary(const unsigned char* data, size_t size) {
+    static constexpr size_t kEntryBytes = 3 * sizeof(unsigned int);
+
+    BinaryReader reader(data, size);
+    unsigned int magic = 0, version = 0;
+    reader.read(magic);
+    reader.read(version);
+    if (magic != kBinaryMagic || version != kBinaryVersion)
+      return false;
+
+    std::vector<theme::OverrideId> override_ids;
+    std::vector<theme::ColorId> color_ids;
+    std::vector<theme::ValueId> value_ids;
+    if (!readBinaryNames(reader, theme::OverrideId::nameIdMap(), override_ids) ||
+        !readBinaryNames(reader, theme::ColorId::nameIdMap(), color_ids) ||
+        !readBinaryNames(reader, theme::ValueId::nameIdMap(), value_ids))
+      return false;
+
+    Palette result;
+    unsigned int num_color_entries = 0;
+    if (!reader.read(num_color_entries) || !reader.canRead(num_color_entries * kEntryBytes))
+      return false;
+
+    for (unsigned int i = 0; i < num_color_entries; ++i) {
+      unsigned int override_index = 0, color_index = 0;
+      int brush_index = kNotSetId;
+      reader.read(override_index);
+      reader.read(color_index);
+      reader.read(brush_index);
+      if (override_index >= override_ids.size() || color_index >= color_ids.size())
+        return false;
+
+      theme::OverrideId override_id = override_ids[override_index];
+      theme::ColorId color_id = color_ids[color_index];
+      if (override_id.id != theme::OverrideId::kInvalidId && color_id.isValid())
+        result.color_map_[override_id][color_id] = brush_index;
+    }
+
+    unsigned int num_value_entries = 0;
+    if (!reader.read(num_value_entries) || !reader.canRead(num_value_entries * kEntryBytes))
+      return false;
+
+    for (unsigned int i = 0; i < num_value_entries; ++i) {
+      unsigned int override_index = 0, value_index = 0;
+      float value = 0.0f;
+      reader.read(override_index);
+      reader.read(value_index);
+      reader.read(value);
+      if (override_index >= override_ids.size() || value_index >= value_ids.size())
+        return false;
+
+      theme::OverrideId override_id = override_ids[override_index];
+      theme::ValueId value_id = value_ids[value_index];
+      bool valid_ids = override_id.id != theme::OverrideId::kInvalidId &&
+                       value_id.id != theme::ValueId::kInvalidId;
+      if (valid_ids)
+        result.value_map_[override_id][value_id] = value;
+    }
+
+    unsigned int num_colors = 0;
+    if (!reader.read(num_colors) || !reader.canRead(num_colors))
+      return false;
+
+    result.colors_.resize(num_colors);
+    for (auto& color : result.colors_) {
+      if (!color.decodeBinary(reader))
+        return false;
+    }
+
+    if (!reader.atEnd())
+      return false;
+
+    result.compile();
+    *this = std::move(result);
+    return true;
+  }
+}
@@ -22,7 +22,9 @@
 #pragma once
 
 #include "color.h"
+#include "gradient.h"
 #include "theme.h"
+#include "visage_file_embed/embedded_file.h"
 
 #include <map>
 #include <vector>
@@ -35,6 +37,8 @@ namespace visage {
     static constexpr float kNotSetValue = -99999.0f;
     static constexpr int kNotSetId = -1;
     static constexpr char kEncodingSeparator = '@';
+    static constexpr unsigned int kBinaryMagic = 0x4c415056;
+    static constexpr unsigned int kBinaryVersion = 1;
 
     Palette() = default;
 
@@ -56,16 +60,19 @@ namespace visage {
     void setEditColor(int index, const Brush& color) {
       VISAGE_ASSERT(index >= 0 && index < colors_.size());
       colors_[index] = color;
+      PackedBrush::paletteColorsChanged();
     }
 
     void setColorIndexFrom(int index, const Color& color) {
       VISAGE_ASSERT(index >= 0 && index < colors_.size());
       colors_[index].gradient().setColor(0, color);
+      PackedBrush::paletteColorsChanged();
     }
 
     void setColorIndexTo(int index, const Color& color) {
       VISAGE_ASSERT(index >= 0 && index < colors_.size());
       colors_[index].gradient().setColor(1, color);
+      PackedBrush::paletteColorsChanged();
     }
 
     void toggleColorIndexStyle(int index) {
@@ -84,31 +91,40 @@ namespace visage {
       }
     }
 
-    bool color(theme::OverrideId override_id, theme::ColorId color_id, Brush& color) {
-      color_map_[override_id].try_emplace(color_id, kNotSetId);
+    int resolvedColorIndex(theme::OverrideId override_id, theme::ColorId color_id) {
+      if (!colors_compiled_)
+        compileColors();
+      return compiledColorIndex(override_id, color_id);
+    }
 
-      if (color_map_[override_id][color_id] == kNotSetId)
+    // Read only lookup for replaying recorded drawing, which may run off the main thread.
+    // Returns nullptr if the color isn't set or maps to an invalid slot.
+    const Brush* findColor(theme::OverrideId override_id, theme::ColorId color_id) const;
+
+    bool color(theme::OverrideId override_id, theme::ColorId color_id, Brush& color) {
+      int index = resolvedColorIndex(override_id, color_id);
+      if (index == kNotSetId)
         return false;
 
-      if (color_map_[override_id][color_id] == kInvalidId)
+      if (index == kInvalidId)
         color = Brush::solid(kInvalidColor);
       else
-        color = colors_[color_map_[override_id][color_id]];
+        color = colors_[index];
       return true;
     }
 
     void setColorMap(theme::OverrideId override_id, theme::ColorId color_id, int index) {
       color_map_[override_id][color_id] = index;
+      colors_compiled_ = false;
+      PackedBrush::paletteColorsChanged();
     }
 
     void setColor(theme::OverrideId override_id, theme::ColorId color_id, const Color& color) {
-      int index = addColor(color);
-      color_map_[override_id][color_id] = index;
+      setColorMap(override_id, color_id, addColor(color));
     }
 
     void setColor(theme::OverrideId override_id, theme::ColorId color_id, const Brush& color) {
-      int index = addBrush(color);
-      color_map_[override_id][color_id] = index;
+      setColorMap(override_id, color_id, addBrush(color));
     }
 
     void setColor(theme::ColorId color_id, const Color& color) { setColor({}, color_id, color); }
@@ -116,6 +132,7 @@ namespace visage {
 
     void setValue(theme::OverrideId override_id, theme::ValueId value_id, float value) {
       value_map_[override_id][value_id] = value;
+      values_compiled_ = false;
     }
 
     void setValue(theme::ValueId value_id, float value) { setValue({}, value_id, value); }
@@ -123,17 +140,24 @@ namespace visage {
     void removeValue(theme::OverrideId override_id, theme::ValueId value_id) {
       if (value_map_[override_id].count(value_id))
         value_map_[override_id].erase(value_id);
+      values_compiled_ = false;
     }
 
     void removeValue(theme::ValueId value_id) { removeValue({}, value_id); }
 
-    int colorMap(theme::OverrideId override_id, theme::ColorId color_id) {
-      return color_map_[override_id][color_id];
+    int colorMap(theme::OverrideId override_id, theme::ColorId color_id) const {
+      auto override_map = color_map_.find(override_id);
+      if (override_map == color_map_.end())
+        return kNotSetId;
+      auto mapped = override_map->second.find(color_id);
+      return mapped == override_map->second.end() ? kNotSetId : mapped->second;
     }
 
     bool value(theme::OverrideId override_id, theme::ValueId value_id, float& result) {
-      value_map_[override_id].try_emplace(value_id, kNotSetValue);
-      result = value_map_[override_id][value_id];
+      if (!values_compiled_)
+        compileValues();
+
+      result = compiledValue(override_id, value_id);
       return result != kNotSetValue;
     }
 
@@ -151,16 +175,49 @@ namespace visage {
       color_map_.clear();
       value_map_.clear();
       colors_.clear();
+      colors_compiled_ = false;
+      values_compiled_ = false;
+      PackedBrush::paletteColorsChanged();
     }
 
+    void compile() {
+      compileColors();
+      compileValues();
+    }
+
+    bool isCompiled() const { return colors_compiled_ && values_compiled_; }
+
     void removeColor(int index);
 
     std::string encode() const;
     void decode(const std::string& data);
 
+    // Compact binary form for shipping palettes. Ids are stored by name so files stay valid
+    // across builds, and loading reads straight from the buffer, so a memory mapped or embedded
+    // file can be decoded without copying it into a stream. The palette comes back compiled.
+    // Returns false and leaves the palette untouched if the data is truncated or from a
+    // different version.
+    std::vector<unsigned char> encodeBinary() const;
+    bool decodeBinary(const unsigned char* data, size_t size);
+    bool decodeBinary(const EmbeddedFile& file) { return decodeBinary(file.data, file.size); }
+
   private:
+    static constexpr int kUnqueriedId = -3;
+
+    void compileColors();
+    void compileValues();
+    int compiledColorIndex(theme::OverrideId override_id, theme::ColorId color_id);
+    float compiledValue(theme::OverrideId override_id, theme::ValueId value_id);
+
     std::vector<Brush> colors_;
     std::map<theme::OverrideId, std::map<theme::ColorId, int>> color_map_;
     std::map<theme::OverrideId, std::map<theme::ValueId, float>> value_map_;
+
+    bool colors_compiled_ = false;
+    int compiled_color_stride_ = 0;
+    std::vector<int> compiled_colors_;
+    bool values_compiled_ = false;
+    int compiled_value_stride_ = 0;
+    std::vector<float> compiled_values_;
   };
 }
\ No newline at end of file
@@ -23,10 +23,14 @@
 
 #include "embedded/shaders.h"
 #include "graphics_caches.h"
+#include "resource_usage.h"
 #include "shape_batcher.h"
 #include "uniforms.h"
+#include "visage_utils/trace.h"
 
+#include <algorithm>
 #include <bgfx/bgfx.h>
+#include <cmath>
 #include <complex>
 #include <memory>
 
@@ -49,6 +53,39 @@ namespace visage {
     return std::acos(value);
   }
 
+  static Point bezierDeltaFromLine(const Point& point, const Point& line_from, const Point& line_to) {
+    if (line_from == line_to)
+      return point - line_from;
+
+    Point line_delta = line_to - line_from;
+    Point point_delta = point - line_from;
+    float t = std::clamp(point_delta.dot(line_delta) / line_delta.dot(line_delta), 0.0f, 1.0f);
+    return point - (line_from + t * line_delta);
+  }
+
+  static void flattenBezier(std::vector<Point>& points, const Matrix& resolution_matrix,
+                            const Point& from, const Point& control1, const Point& control2,
+                            const Point& to, float error_squared) {
+    Point delta1 = resolution_matrix * bezierDeltaFromLine(control1, from, to);
+    Point delta2 = resolution_matrix * bezierDeltaFromLine(control2, from, to);
+    if (delta1.squareMagnitude() <= error_squared && delta2.squareMagnitude() <= error_squared) {
+      points.push_back(to);
+      return;
+    }
+
+    Point mid1 = (from + control1) * 0.5f;
+    Point mid2 = (control1 + control2) * 0.5f;
+    Point mid3 = (control2 + to) * 0.5f;
+
+    Point midmid1 = (mid1 + mid2) * 0.5f;
+    Point midmid2 = (mid2 + mid3) * 0.5f;
+
+    Point break_point = (midmid1 + midmid2) * 0.5f;
+
+    flattenBezier(points, resolution_matrix, from, mid1, midmid1, break_point, error_squared);
+    flattenBezier(points, resolution_matrix, break_point, midmid2, mid3, to, error_squared);
+  }
+
   template<typename T>
   static void roundedRectangle(T& t, float x, float y, float width, float height, float rx_top_left,
                                float ry_top_left, float rx_top_right, float ry_top_right,
@@ -141,6 +178,14 @@ namespace visage {
     if (!sweep_flag)
       arc_angle = -arc_angle;
 
+    Curve curve;
+    curve.arc = true;
+    curve.arc_transform = Transform(ellipse_rotation * Matrix::scale(radius, radius / radius_ratio),
+                                    from + ellipse_rotation * Point(center.x, center.y / radius_ratio));
+    curve.start_angle = std::atan2(-center.y, -center.x);
+    curve.sweep = arc_angle;
+    int start = currentPath().points.size();
+
     Point adjusted_radius = resolution_matrix_ * Point(rx, ry);
     float max_radius = std::max(std::abs(adjusted_radius.x), std::abs(adjusted_radius.y));
     float max_delta_radians = 2.0f * clampedACos(1.0f - error_tolerance_ / max_radius);
@@ -157,6 +202,110 @@ namespace visage {
       p = ellipse_rotation * p + from;
       addPoint(p);
     }
+    addCurve(curve, start);
+  }
+
+  void Path::addBezier(const Point& from, const Point& control1, const Point& control2, const Point& to) {
+    Curve curve;
+    curve.points[0] = from;
+    curve.points[1] = control1;
+    curve.points[2] = control2;
+    curve.points[3] = to;
+    int start = currentPath().points.size();
+
+    std::vector<Point> points;
+    flattenBezier(points, resolution_matrix_, from, control1, control2, to,
+                  error_tolerance_ * error_tolerance_);
+    for (const Point& point : points)
+      addPoint(point);
+    addCurve(curve, start);
+  }
+
+  int Path::flatteningBucket(float scale) {
+    if (scale <= 0.0f)
+      return 0;
+    return std::ceil(std::log2(scale) * kFlatteningBucketsPerOctave - 0.001f);
+  }
+
+  void Path::flattenCurve(std::vector<Point>& points, const Curve& curve, float tolerance) const {
+    if (!curve.arc) {
+      flattenBezier(points, resolution_matrix_, curve.points[0], curve.points[1], curve.points[2],
+                    curve.points[3], tolerance * tolerance);
+      return;
+    }
+
+    Matrix matrix = resolution_matrix_ * curve.arc_transform.matrix;
+    float radius_x = Point(matrix.matrix[0][0], matrix.matrix[1][0]).length();
+    float radius_y = Point(matrix.matrix[0][1], matrix.matrix[1][1]).length();
+    float max_radius = std::max(radius_x, radius_y);
+    float max_delta_radians = 2.0f * clampedACos(1.0f - tolerance / max_radius);
+    int num_points = std::max(1, static_cast<int>(std::ceil(std::abs(curve.sweep) / max_delta_radians)));
+    for (int i = 1; i <= num_points; ++i) {
+      float angle = curve.start_angle + curve.sweep * i / num_points;
+      points.push_back(curve.arc_transform * Point(std::cos(angle), std::sin(angle)));
+    }
+  }
+
+  Path Path::flattened(float scale) const {
+    int bucket = flatteningBucket(scale);
+    Path result;
+    result.resolution_matrix_ = resolution_matrix_;
+    result.fill_rule_ = fill_rule_;
+    result.smooth_control_point_ = smooth_control_point_;
+    result.current_control_points_ = current_control_points_;
+    result.last_point_ = last_point_;
+    result.error_tolerance_ = error_tolerance_;
+    const Geometry& source = geometry();
+    if (source.curves.empty() || bucket == 0) {
+      result.geometry_ = geometry_;
+      return result;
+    }
+
+    if (flattened_cache_ == nullptr)
+      flattened_cache_ = std::make_shared<std::map<int, std::shared_ptr<Geometry>>>();
+
+    auto cached = flattened_cache_->find(bucket);
+    if (cached != flattened_cache_->end()) {
+      result.geometry_ = cached->second;
+      return result;
+    }
+
+    std::vector<const Curve*> sorted;
+    sorted.reserve(source.curves.size());
+    for (const Curve& curve : source.curves)
+      sorted.push_back(&curve);
+    std::sort(sorted.begin(), sorted.end(), [](const Curve* a, const Curve* b) {
+      return a->sub_path < b->sub_path || (a->sub_path == b->sub_path && a->start < b->start);
+    });
+
+    float tolerance = error_tolerance_ / std::exp2(bucket / static_cast<float>(kFlatteningBucketsPerOctave));
+    auto flattened = std::make_shared<Geometry>();
+    std::vector<SubPath>& flattened_paths = flattened->sub_paths;
+    flattened_paths.resize(source.sub_paths.size());
+    auto curve = sorted.begin();
+    for (int i = 0; i < source.sub_paths.size(); ++i) {
+      const std::vector<Point>& points = source.sub_paths[i].points;
+      std::vector<Point>& flattened_points = flattened_paths[i].points;
+      flattened_paths[i].closed = source.sub_paths[i].closed;
+
+      int next = 0;
+      for (; curve != sorted.end() && (*curve)->sub_path == i; ++curve) {
+        if ((*curve)->start < next || (*curve)->end > points.size())
+          continue;
+
+        flattened_points.insert(flattened_points.end(), points.begin() + next,
+                                points.begin() + (*curve)->start);
+        flattenCurve(flattened_points, **curve, tolerance);
+        next = (*curve)->end;
+      }
+      flattened_points.insert(flattened_points.end(), points.begin() + next, points.end());
+      flattened_points.erase(std::unique(flattened_points.begin(), flattened_points.end()),
+                             flattened_points.end());
+    }
+
+    (*flattened_cache_)[bucket] = flattened;
+    result.geometry_ = std::move(flattened);
+    return result;
   }
 
   static float parseNumber(const std::string& str, size_t& i, bool bit_flags = false) {
@@ -363,8 +512,13 @@ namespace visage {
 
   Path Path::combine(Path& other, FillRule fill_rule) const {
     Path combined = *this;
-    for (auto& path : other.paths_)
-      combined.paths_.push_back(path);
+    Geometry& geometry = combined.mutableGeometry();
+    const Geometry& source = other.geometry();
+    for (Curve curve : source.curves) {
+      curve.sub_path += geometry.sub_paths.size();
+      geometry.curves.push_back(curve);
+    }
+    geometry.sub_paths.insert(geometry.sub_paths.end(), source.sub_paths.begin(), source.sub_paths.end());
     combined.fill_rule_ = fill_rule;
     return combined;
   }
@@ -413,13 +567,14 @@ namespace visage {
     float square_miter_limit = miter_limit * miter_limit;
     float adjusted_radius = (resolution_matrix_ * Point(amount, 0.0f)).length();
     float max_delta_radians = 2.0f * clampedACos(1.0 - kDefaultErrorTolerance / adjusted_radius);
-    for (const auto& sub_path : paths_) {
+    for (const auto& sub_path : geometry().sub_paths) {
       if (sub_path.points.empty())
         continue;
 
       bool closed_points = sub_path.points.front() == sub_path.points.back();
       if (sub_path.points.size() == 1 || (sub_path.points.size() == 2 && closed_points)) {
-        result.paths_.push_back(singlePointOffset(Point(sub_path.points[0]), amount, end_cap));
+        SubPath point_offset = singlePointOffset(Point(sub_path.points[0]), amount, end_cap);
+        result.mutableGeometry().sub_paths.push_back(std::move(point_offset));
         continue;
       }
 
@@ -499,7 +654,7 @@ namespace visage {
         prev_offset = offset;
       }
 
-      result.paths_.push_back(SubPath { std::move(new_path), true });
+      result.mutableGeometry().sub_paths.push_back(SubPath { std::move(new_path), true });
     }
 
     return result;
@@ -536,7 +691,7 @@ namespace visage {
 
       dash_length -= dash_offset;
 
-      for (auto& path : paths_) {
+      for (auto& path : geometry().sub_paths) {
         if (path.points.empty())
           continue;
 
@@ -572,7 +727,8 @@ namespace visage {
       stroke_path = *this;
 
     std::vector<SubPath> inner_paths;
-    for (auto& path : stroke_path.paths_) {
+    std::vector<SubPath>& stroke_paths = stroke_path.mutableGeometry().sub_paths;
+    for (auto& path : stroke_paths) {
       if (path.points.size() > 1 && path.closed) {
         SubPath inner = path;
         std::reverse(inner.points.begin(), inner.points.end());
@@ -586,7 +742,7 @@ namespace visage {
       }
     }
 
-    stroke_path.paths_.insert(stroke_path.paths_.end(), inner_paths.begin(), inner_paths.end());
+    stroke_paths.insert(stroke_paths.end(), inner_paths.begin(), inner_paths.end());
     stroke_path = stroke_path.offset(stroke_width / 2.0f, join, Join::Bevel, end_cap, miter_limit);
     stroke_path.fill_rule_ = FillRule::NonZero;
     return stroke_path;
@@ -594,6 +750,7 @@ namespace visage {
 
   struct PathAtlasTexture {
     bgfx::FrameBufferHandle handle = { bgfx::kInvalidHandle };
+    TrackedResource memory;
 
     ~PathAtlasTexture() {
       if (bgfx::isValid(handle))
@@ -601,6 +758,31 @@ namespace visage {
     }
   };
 
+  static uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+    static constexpr uint64_t kFnvPrime = 1099511628211ULL;
+    const auto bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i)
+      hash = (hash ^ bytes[i]) * kFnvPrime;
+    return hash;
+  }
+
+  uint64_t Path::hash() const {
+    static constexpr uint64_t kFnvOffset = 14695981039346656037ULL;
+    uint64_t hash = kFnvOffset;
+    int fill_rule = static_cast<int>(fill_rule_);
+    hash = hashBytes(hash, &fill_rule, sizeof(fill_rule));
+    for (const SubPath& sub_path : geometry().sub_paths) {
+      hash = hashBytes(hash, sub_path.points.data(), sub_path.points.size() * sizeof(Point));
+      hash = hashBytes(hash, &sub_path.closed, sizeof(sub_path.closed));
+    }
+    return hash;
+  }
+
+  uint64_t PathAtlas::pathKey(const Path& path, int width, int height) {
+    int dimensions[] = { width, height };
+    return hashBytes(path.hash(), dimensions, sizeof(dimensions));
+  }
+
   PathAtlas::PackedPathReference::~PackedPathReference() {
     if (auto atlas_pointer = atlas.lock())
       (*atlas_pointer)->removePath(packed_path_rect);
@@ -608,16 +790,91 @@ namespace visage {
 
   PathAtlas::PathAtlas() {
     reference_ = std::make_shared<PathAtlas*>(this);
-    atlas_map_.setPadding(kBuffer);
   }
 
   PathAtlas::~PathAtlas() = default;
 
+  PathAtlas::PlacedPath PathAtlas::placePath(const Path& path, float x, float y, float scale) {
+    static constexpr float kPlacementBuffer = 1.0f;
+
+    auto range = retained_paths_.equal_range(path.geometryId());
+    auto matches = [&](const RetainedPath& retained) {
+      return retained.scale == scale && retained.source.fillRule() == path.fillRule();
+    };
+
+    const Bounds* cached_bounds = nullptr;
+    for (auto it = range.first; it != range.second && cached_bounds == nullptr; ++it) {
+      if (matches(it->second))
+        cached_bounds = &it->second.bounds;
+    }
+
+    Path adjusted_path;
+    Bounds bounding_box;
+    if (cached_bounds)
+      bounding_box = *cached_bounds;
+    else {
+      adjusted_path = path.flattened(scale);
+      if (scale != 1.0f)
+        adjusted_path.scale(scale);
+      bounding_box = adjusted_path.boundingBox();
+    }
+
+    PlacedPath placed;
+    placed.x = static_cast<int>(x + bounding_box.x() - kPlacementBuffer);
+    placed.y = static_cast<int>(y + bounding_box.y() - kPlacementBuffer);
+    placed.width = std::ceil(x + bounding_box.right() + kPlacementBuffer) - placed.x;
+    placed.height = std::ceil(y + bounding_box.bottom() + kPlacementBuffer) - placed.y;
+    float shift_x = placed.x - x;
+    float shift_y = placed.y - y;
+
+    for (auto it = range.first; it != range.second; ++it) {
+      RetainedPath& retained = it->second;
+      if (matches(retained) && retained.shift_x == shift_x && retained.shift_y == shift_y &&
+          retained.packed_path.w() == placed.width && retained.packed_path.h() == placed.height) {
+        retained.last_used = frame_;
+        retained.reused = true;
+        placed.packed_path = retained.packed_path;
+        return placed;
+      }
+    }
+
+    if (cached_bounds) {
+      adjusted_path = path.flattened(scale);
+      if (scale != 1.0f)
+        adjusted_path.scale(scale);
+    }
+
+    adjusted_path.translate(-shift_x, -shift_y);
+    placed.packed_path = addPath(adjusted_path, placed.width, placed.height);
+    if (path.geometryId()) {
+      RetainedPath& retained = retained_paths_.emplace(path.geometryId(), RetainedPath())->second;
+      retained.source = path;
+      retained.scale = scale;
+      retained.bounds = bounding_box;
+      retained.shift_x = shift_x;
+      retained.shift_y = shift_y;
+      retained.packed_path = placed.packed_path;
+      retained.last_used = frame_;
+    }
+    return placed;
+  }
+
+  void PathAtlas::nextFrame() {
+    frame_++;
+    for (auto it = retained_paths_.begin(); it != retained_paths_.end();) {
+      int unused_frames = frame_ - it->second.last_used;
+      if (unused_frames > kRetainedFrames || (!it->second.reused && unused_frames > 1))
+        it = retained_paths_.erase(it);
+      else
+        ++it;
+    }
+  }
+
   template<const char* name>
   void setPathUniform(float value0, float value1 = 0.0f, float value2 = 0.0f, float value3 = 0.0f) {
     float values[4] = { value0, value1, value2, value3 };
     static const bgfx::UniformHandle uniform = bgfx::createUniform(name, bgfx::UniformType::Vec4, 1);
-    bgfx::setUniform(uniform, values);
+    UniformCache::setUniform(uniform, values);
   }
 
   bool PathAtlas::clearUpdatedPathAreas(int submit_pass) {
@@ -636,8 +893,11 @@ namespace visage {
     bgfx::setViewMode(submit_pass, bgfx::ViewMode::Sequential);
     bgfx::setViewRect(submit_pass, 0, 0, width_, height_);
     bgfx::setViewFrameBuffer(submit_pass, frame_buffer_->handle);
-    bgfx::setState(BGFX_STATE_WRITE_R | BGFX_STATE_BLEND_FUNC(BGFX_STATE_BLEND_ONE, BGFX_STATE_BLEND_ZERO));
+    encoder()->setState(BGFX_STATE_WRITE_R | BGFX_STATE_BLEND_FUNC(BGFX_STATE_BLEND_ONE, BGFX_STATE_BLEND_ZERO));
     auto clear_vertices = initQuadVertices<UvVertex>(total_need_update);
+    if (clear_vertices == nullptr)
+      return false;
+
     int vertex_index = 0;
     for (auto& path : paths_) {
       if (path->needs_update) {
@@ -671,18 +931,20 @@ namespace visage {
     }
 
     setPathUniform<Uniforms::kColor>(0.0f);
-    bgfx::submit(submit_pass, ProgramCache::programHandle(shaders::vs_clear, shaders::fs_clear));
+    submitQuads(submit_pass, ProgramCache::programHandle(shaders::vs_clear, shaders::fs_clear));
 
     return true;
   }
 
   int PathAtlas::updatePaths(int submit_pass) {
+    VISAGE_TRACE_SCOPE("PathAtlas::updatePaths");
     constexpr int kTriangleIndices[] = { 0, 1, 2, 0, 2, 3, 0, 3, 4, 0, 4, 5 };
     constexpr int kConservativeVerticesPerTriangle = 3;
     constexpr int kRegularVerticesPerTriangle = 6;
     constexpr float kTriangleDrawOffset = 2.0f;
 
-    checkInit();
+    nextFrame();
+    checkInit(submit_pass);
 
     if (!clearUpdatedPathAreas(submit_pass))
       return submit_pass;
@@ -702,34 +964,39 @@ namespace visage {
     int indices_per_triangle = sizeof(kTriangleIndices) / sizeof(int);
     int vertices_per_point = 2;
     bool conservative_raster = bgfx::getCaps()->supported & BGFX_CAPS_CONSERVATIVE_RASTER;
-    if (conservative_raster) {
+    if (conservative_raster)
       state |= BGFX_STATE_CONSERVATIVE_RASTER;
+    if (conservative_raster || dilated_triangles_) {
       vertices_per_triangle = kConservativeVerticesPerTriangle;
       indices_per_triangle = 3;
       vertices_per_point = 1;
     }
 
-    bgfx::setState(state);
+    encoder()->setState(state);
     bgfx::TransientVertexBuffer vertex_buffer {};
     bgfx::TransientIndexBuffer index_buffer {};
     int num_vertices = num_triangles * vertices_per_triangle;
     int num_indices = num_triangles * indices_per_triangle;
-    if (!bgfx::allocTransientBuffers(&vertex_buffer, PathVertex::layout(), num_vertices,
-                                     &index_buffer, num_indices, true)) {
-      VISAGE_LOG("PathAtlas::updatePaths: Failed to allocate transient buffers");
-      return submit_pass + 1;
+    const bgfx::Memory* vertex_memory = nullptr;
+    const bgfx::Memory* index_memory = nullptr;
+    PathVertex* vertices = nullptr;
+    uint32_t* indices = nullptr;
+    TransientBufferUsage& usage = TransientBuffers::usage();
+    if (bgfx::allocTransientBuffers(&vertex_buffer, PathVertex::layout(), num_vertices,
+                                    &index_buffer, num_indices, true)) {
+      vertices = reinterpret_cast<PathVertex*>(vertex_buffer.data);
+      indices = reinterpret_cast<uint32_t*>(index_buffer.data);
+      usage.vertex_bytes += num_vertices * sizeof(PathVertex);
+      usage.index_bytes += num_indices * sizeof(uint32_t);
     }
-
-    auto vertices = reinterpret_cast<PathVertex*>(vertex_buffer.data);
-    auto indices = reinterpret_cast<uint32_t*>(index_buffer.data);
-    if (indices == nullptr || vertices == nullptr) {
-      VISAGE_LOG("PathAtlas::updatePaths: Failed to map transient buffers");
-      return submit_pass + 1;
+    else {
+      vertex_memory = bgfx::alloc(num_vertices * sizeof(PathVertex));
+      index_memory = bgfx::alloc(num_indices * sizeof(uint32_t));
+      vertices = reinterpret_cast<PathVertex*>(vertex_memory->data);
+      indices = reinterpret_cast<uint32_t*>(index_memory->data);
+      usage.fallback_draws++;
     }
 
-    bgfx::setVertexBuffer(0, &vertex_buffer);
-    bgfx::setIndexBuffer(&index_buffer);
-
     uint32_t vertex = 0;
     uint32_t triangle_index = 0;
     for (auto& path : paths_) {
@@ -792,6 +1059,19 @@ namespace visage {
     VISAGE_ASSERT(vertex == num_vertices);
     VISAGE_ASSERT(triangle_index == num_indices);
 
+    bgfx::VertexBufferHandle vertex_handle = BGFX_INVALID_HANDLE;
+    bgfx::IndexBufferHandle index_handle = BGFX_INVALID_HANDLE;
+    if (vertex_memory) {
+      vertex_handle = bgfx::createVertexBuffer(vertex_memory, PathVertex::layout());
+      index_handle = bgfx::createIndexBuffer(index_memory, BGFX_BUFFER_INDEX32);
+      encoder()->setVertexBuffer(0, vertex_handle);
+      encoder()->setIndexBuffer(index_handle);
+    }
+    else {
+      encoder()->setVertexBuffer(0, &vertex_buffer);
+      encoder()->setIndexBuffer(&index_buffer);
+    }
+
     bool origin_flip = bgfx::getCaps()->originBottomLeft;
     setPathUniform<Uniforms::kColor>(1.0f);
     setPathUniform<Uniforms::kOriginFlip>(origin_flip ? -1.0 : 1.0);
@@ -801,11 +1081,22 @@ namespace visage {
     else
       setPathUniform<Uniforms::kBounds>(2.0f / width_, -2.0f / height_, -1.0f, 1.0f);
 
-    if (conservative_raster)
-      bgfx::submit(submit_pass, ProgramCache::programHandle(shaders::vs_conservative_path_fill,
-                                                            shaders::fs_path_fill));
+    if (conservative_raster) {
+      submitDraw(submit_pass, ProgramCache::programHandle(shaders::vs_conservative_path_fill,
+                                                          shaders::fs_path_fill), num_vertices);
+    }
+    else if (dilated_triangles_) {
+      submitDraw(submit_pass, ProgramCache::programHandle(shaders::vs_dilated_path_fill,
+                                                          shaders::fs_dilated_path_fill), num_vertices);
+    }
     else
-      bgfx::submit(submit_pass, ProgramCache::programHandle(shaders::vs_path_fill, shaders::fs_path_fill));
+      submitDraw(submit_pass, ProgramCache::programHandle(shaders::vs_path_fill, shaders::fs_path_fill),
+                 num_vertices);
+
+    if (bgfx::isValid(vertex_handle)) {
+      bgfx::destroy(vertex_handle);
+      bgfx::destroy(index_handle);
+    }
     return submit_pass + 1;
   }
 
@@ -813,39 +1104,108 @@ namespace visage {
     frame_buffer_.reset();
   }
 
-  void PathAtlas::checkInit() {
-    constexpr uint64_t kFlags = BGFX_TEXTURE_RT | BGFX_SAMPLER_U_CLAMP | BGFX_SAMPLER_V_CLAMP;
-    if (needs_packing_) {
-      resize();
-      needs_packing_ = false;
+  void PathAtlas::allocate(PackedPathRect* packed_path_rect) {
+    if (packer_.width() == 0)
+      packer_.reset(kDefaultWidth, kDefaultWidth);
+
+    int width = packed_path_rect->w + kBuffer;
+    int height = packed_path_rect->h + kBuffer;
+    PackedRect rect {};
+    packed_path_rect->slot = packer_.allocate(width, height, rect);
+    while (packed_path_rect->slot == ShelfPacker::kInvalidSlot) {
+      if (width > packer_.width() || packer_.height() * 2 > kMaxHeight) {
+        repack(width);
+        return;
+      }
+
+      packer_.grow(packer_.height() * 2);
+      packed_path_rect->slot = packer_.allocate(width, height, rect);
     }
 
-    if (frame_buffer_ == nullptr)
-      frame_buffer_ = std::make_unique<PathAtlasTexture>();
+    packed_path_rect->x = rect.x;
+    packed_path_rect->y = rect.y;
+    packed_path_rect->needs_update = true;
+  }
+
+  void PathAtlas::repack(int min_width) {
+    int width = std::max(kDefaultWidth, packer_.width());
+    while (width < min_width)
+      width *= 2;
+
+    std::vector<PackedPathRect*> sorted;
+    sorted.reserve(paths_.size());
+    for (auto& path : paths_)
+      sorted.push_back(path.get());
+    std::sort(sorted.begin(), sorted.end(),
+              [](const PackedPathRect* a, const PackedPathRect* b) { return a->h > b->h; });
+
+    auto pack = [&](int packed_width, int packed_height) {
+      packer_.reset(packed_width, packed_height);
+      for (PackedPathRect* path : sorted) {
+        PackedRect rect {};
+        path->slot = packer_.allocate(path->w + kBuffer, path->h + kBuffer, rect);
+        if (path->slot == ShelfPacker::kInvalidSlot)
+          return false;
+
+        path->x = rect.x;
+        path->y = rect.y;
+        path->needs_update = true;
+      }
+      return true;
+    };
 
-    if (!bgfx::isValid(frame_buffer_->handle) && atlas_map_.width() && atlas_map_.height()) {
-      frame_buffer_->handle = bgfx::createFrameBuffer(atlas_map_.width(), atlas_map_.height(),
-                                                      bgfx::TextureFormat::R16F, kFlags);
-      width_ = atlas_map_.width();
-      height_ = atlas_map_.height();
+    int height = kDefaultWidth;
+    while (!pack(width, height)) {
+      if (height < kMaxHeight)
+        height *= 2;
+      else
+        width *= 2;
     }
+
+    needs_redraw_ = true;
   }
 
-  void PathAtlas::resize() {
-    static constexpr float kShrinkFactor = 0.5f;
-    atlas_map_.pack(width_, height_);
-    if (atlas_map_.width() > width_ || atlas_map_.height() > height_ ||
-        atlas_map_.width() < width_ * kShrinkFactor || atlas_map_.height() < height_ * kShrinkFactor)
+  void PathAtlas::checkInit(int submit_pass) {
+    constexpr uint64_t kFlags = BGFX_TEXTURE_RT | BGFX_TEXTURE_BLIT_DST | BGFX_SAMPLER_U_CLAMP |
+                                BGFX_SAMPLER_V_CLAMP;
+    if (paths_.empty() && packer_.height() > kDefaultWidth) {
+      packer_.reset(kDefaultWidth, kDefaultWidth);
       frame_buffer_.reset();
+    }
 
-    for (auto& path : paths_) {
-      const PackedRect& rect = atlas_map_.rectForId(path.get());
-      path->x = rect.x;
-      path->y = rect.y;
-      path->w = rect.w;
-      path->h = rect.h;
-      path->needs_update = true;
+    if (frame_buffer_ == nullptr)
+      frame_buffer_ = std::make_unique<PathAtlasTexture>();
+
+    if (packer_.width() == 0 || packer_.height() == 0)
+      return;
+
+    bool resized = width_ != packer_.width() || height_ != packer_.height();
+    if (bgfx::isValid(frame_buffer_->handle) && !resized) {
+      needs_redraw_ = false;
+      return;
+    }
+
+    bgfx::FrameBufferHandle handle = bgfx::createFrameBuffer(packer_.width(), packer_.height(),
+                                                             bgfx::TextureFormat::R16F, kFlags);
+    bool copy = bgfx::isValid(frame_buffer_->handle) && !needs_redraw_ &&
+                (bgfx::getCaps()->supported & BGFX_CAPS_TEXTURE_BLIT);
+    if (copy) {
+      encoder()->blit(submit_pass, bgfx::getTexture(handle), 0, 0,
+                      bgfx::getTexture(frame_buffer_->handle), 0, 0, width_, height_);
+    }
+    else {
+      for (auto& path : paths_)
+        path->needs_update = true;
     }
+
+    frame_buffer_ = std::make_unique<PathAtlasTexture>();
+    frame_buffer_->handle = handle;
+    frame_buffer_->memory.reset(ResourceCategory::PathAtlas,
+                                ResourceTracker::textureBytes(packer_.width(), packer_.height(),
+                                                              bgfx::TextureFormat::R16F));
+    width_ = packer_.width();
+    height_ = packer_.height();
+    needs_redraw_ = false;
   }
 
   const bgfx::FrameBufferHandle& PathAtlas::frameBufferHandle() {
@@ -26,11 +26,13 @@
 
 #include <cfloat>
 #include <complex>
+#include <initializer_list>
 #include <limits>
 #include <map>
 #include <memory>
 #include <optional>
 #include <string>
+#include <unordered_map>
 
 namespace visage {
   template<typename T>
@@ -59,9 +61,31 @@ namespace visage {
     return orientation(target1, target2, source);
   }
 
+  // Non-owning view of dash lengths, so strokes can take vectors, arrays or braced lists
+  // without copying them.
+  class DashPattern {
+  public:
+    DashPattern() = default;
+    DashPattern(const float* dashes, int size) : dashes_(dashes), size_(size) { }
+    DashPattern(const std::vector<float>& dashes) : dashes_(dashes.data()), size_(dashes.size()) { }
+    DashPattern(std::initializer_list<float> dashes) :
+        dashes_(dashes.begin()), size_(dashes.size()) { }
+
+    const float* begin() const { return dashes_; }
+    const float* end() const { return dashes_ + size_; }
+    int size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    std::vector<float> toVector() const { return { begin(), end() }; }
+
+  private:
+    const float* dashes_ = nullptr;
+    int size_ = 0;
+  };
+
   class Path {
   public:
     static constexpr float kDefaultErrorTolerance = 0.1f;
+    static constexpr int kFlatteningBucketsPerOctave = 4;
     static constexpr float kDefaultMiterLimit = 4.0f;
     static constexpr float kPi = 3.14159265358979323846f;
 
@@ -219,6 +243,13 @@ namespace visage {
       Butt
     };
 
+    enum class Operation {
+      Union,
+      Intersection,
+      Difference,
+      Xor
+    };
+
     Path() = default;
     Path(const Path& other) = default;
     Path& operator=(const Path& other) = default;
@@ -239,7 +270,8 @@ namespace visage {
     static CommandList parseSvgPath(const std::string& path);
 
     void moveTo(Point point, bool relative = false) {
-      if (!paths_.empty() && !paths_.back().points.empty())
+      const std::vector<SubPath>& paths = geometry().sub_paths;
+      if (!paths.empty() && !paths.back().points.empty())
         startNewPath();
 
       if (relative)
@@ -279,15 +311,18 @@ namespace visage {
     void close() {
       static constexpr float kCloseEpsilon = 0.000001f;
 
-      if (paths_.empty() || paths_.back().points.empty())
+      const std::vector<SubPath>& paths = geometry().sub_paths;
+      if (paths.empty() || paths.back().points.empty())
         return;
 
-      if ((paths_.back().points.front() - paths_.back().points.back()).squareMagnitude() < kCloseEpsilon) {
-        paths_.back().points.back() = paths_.back().points.front();
-        last_point_ = paths_.back().points.front();
+      std::vector<Point>& points = mutableGeometry().sub_paths.back().points;
+      Point front = points.front();
+      if ((front - points.back()).squareMagnitude() < kCloseEpsilon) {
+        points.back() = front;
+        last_point_ = front;
       }
-      else if (paths_.back().points.front() != paths_.back().points.back())
-        addPoint(paths_.back().points.front());
+      else if (front != points.back())
+        addPoint(front);
 
       currentPath().closed = true;
     }
@@ -305,7 +340,7 @@ namespace visage {
       Point control1 = from + (2.0f / 3.0f) * (control - from);
       Point control2 = end + (2.0f / 3.0f) * (control - end);
       smooth_control_point_ = end + (end - control);
-      recurseBezierTo(from, control1, control2, end);
+      addBezier(from, control1, control2, end);
       current_control_points_ = ControlPoints::Quadratic;
     }
 
@@ -338,7 +373,7 @@ namespace visage {
         end += from;
       }
 
-      recurseBezierTo(from, control1, control2, end);
+      addBezier(from, control1, control2, end);
       smooth_control_point_ = end + (end - control2);
       current_control_points_ = ControlPoints::Cubic;
     }
@@ -368,16 +403,22 @@ namespace visage {
 
     int numPoints() const {
       int count = 0;
-      for (const auto& path : paths_)
+      for (const auto& path : geometry().sub_paths)
         count += path.points.size();
       return count;
     }
 
-    std::vector<SubPath>& subPaths() { return paths_; }
-    const std::vector<SubPath>& subPaths() const { return paths_; }
+    std::vector<SubPath>& subPaths() { return mutableGeometry().sub_paths; }
+    const std::vector<SubPath>& subPaths() const { return geometry().sub_paths; }
+    int numCurves() const { return geometry().curves.size(); }
+    bool sharesGeometry(const Path& other) const {
+      return geometry_ != nullptr && geometry_ == other.geometry_;
+    }
+    const void* geometryId() const { return geometry_.get(); }
 
     void clear() {
-      paths_.clear();
+      geometry_.reset();
+      flattened_cache_.reset();
       last_point_ = {};
     }
 
@@ -396,6 +437,8 @@ namespace visage {
     void addCircle(float cx, float cy, float r);
 
     Path combine(Path& other, FillRule fill_rule = FillRule::EvenOdd) const;
+    Path booleanOperation(const Path& other, Operation operation) const;
+    Path simplified() const;
     SubPath singlePointOffset(Point point, float amount, EndCap end_cap);
     Path offset(float amount, Join join = Join::Square, EndCap end_cap = EndCap::Butt,
                 float miter_limit = kDefaultMiterLimit);
@@ -410,12 +453,15 @@ namespace visage {
     }
 
     void scale(float mult) {
-      for (auto& path : paths_) {
+      for (auto& path : mutableGeometry().sub_paths) {
         for (Point& point : path.points)
           point *= mult;
       }
+      transformCurves(Transform::scale(mult, mult));
     }
 
+    Path flattened(float scale) const;
+
     Path translated(const Point& offset) const {
       Path result = *this;
       result.translate(offset);
@@ -425,10 +471,11 @@ namespace visage {
     Path translated(float x, float y) const { return translated(Point(x, y)); }
 
     void translate(const Point& offset) {
-      for (auto& path : paths_) {
+      for (auto& path : mutableGeometry().sub_paths) {
         for (Point& point : path.points)
           point += offset;
       }
+      transformCurves(Transform::translation(offset));
     }
 
     void translate(float x, float y) { translate(Point(x, y)); }
@@ -436,7 +483,7 @@ namespace visage {
     void rotate(float angle) {
       Point row1 = { cosf(angle), sinf(angle) };
       Point row2 = { -sinf(angle), cosf(angle) };
-      for (auto& path : paths_) {
+      for (auto& path : mutableGeometry().sub_paths) {
         for (Point& point : path.points) {
           float x = point.x;
           float y = point.y;
@@ -444,6 +491,7 @@ namespace visage {
           point.y = row2.x * x + row2.y * y;
         }
       }
+      transformCurves(Transform(row1.x, row1.y, 0.0f, row2.x, row2.y, 0.0f));
     }
 
     Path rotated(float angle) const {
@@ -459,10 +507,11 @@ namespace visage {
     }
 
     void transform(const Transform& transform) {
-      for (auto& path : paths_) {
+      for (auto& path : mutableGeometry().sub_paths) {
         for (Point& point : path.points)
           point = transform * point;
       }
+      transformCurves(transform);
     }
 
     Path reversed() const {
@@ -472,17 +521,40 @@ namespace visage {
     }
 
     void reverse() {
-      for (auto& path : paths_)
+      Geometry& geometry = mutableGeometry();
+      for (Curve& curve : geometry.curves)
+        curve.reverse(geometry.sub_paths[curve.sub_path].points.size());
+      for (auto& path : geometry.sub_paths)
         std::reverse(path.points.begin(), path.points.end());
     }
 
     void setFillRule(FillRule fill_rule) { fill_rule_ = fill_rule; }
     FillRule fillRule() const { return fill_rule_; }
 
+    uint64_t hash() const;
+    bool sameFill(const Path& other) const {
+      if (fill_rule_ != other.fill_rule_)
+        return false;
+      if (geometry_ == other.geometry_)
+        return true;
+
+      const std::vector<SubPath>& paths = geometry().sub_paths;
+      const std::vector<SubPath>& other_paths = other.geometry().sub_paths;
+      if (paths.size() != other_paths.size())
+        return false;
+
+      for (int i = 0; i < paths.size(); ++i) {
+        if (paths[i].closed != other_paths[i].closed || paths[i].points != other_paths[i].points)
+          return false;
+      }
+      return true;
+    }
+
     void setErrorTolerance(float tolerance) {
       VISAGE_ASSERT(tolerance > 0.0f);
       if (tolerance > 0.0f)
         error_tolerance_ = tolerance;
+      flattened_cache_.reset();
     }
 
     Bounds boundingBox() const {
@@ -490,7 +562,7 @@ namespace visage {
       float min_y = std::numeric_limits<float>::max();
       float max_x = std::numeric_limits<float>::lowest();
       float max_y = std::numeric_limits<float>::lowest();
-      for (const auto& path : paths_) {
+      for (const auto& path : geometry().sub_paths) {
         for (const auto& point : path.points) {
           min_x = std::min(min_x, point.x);
           min_y = std::min(min_y, point.y);
@@ -506,7 +578,7 @@ namespace visage {
     float errorTolerance() const { return error_tolerance_; }
     float length() const {
       float total_length = 0.0f;
-      for (const auto& path : paths_) {
+      for (const auto& path : geometry().sub_paths) {
         for (size_t i = 1; i < path.points.size(); ++i)
           total_length += (path.points[i] - path.points[i - 1]).length();
         if (path.closed && path.points.size() > 2)
@@ -515,7 +587,10 @@ namespace visage {
       return total_length;
     }
 
-    void setResolutionMatrix(const Matrix& matrix) { resolution_matrix_ = matrix; }
+    void setResolutionMatrix(const Matrix& matrix) {
+      resolution_matrix_ = matrix;
+      flattened_cache_.reset();
+    }
     const Matrix& resolutionMatrix() const { return resolution_matrix_; }
 
   private:
@@ -533,55 +608,106 @@ namespace visage {
       return point - closest_point;
     }
 
-    void recurseBezierTo(const Point& from, const Point& control1, const Point& control2, const Point& to) {
-      float error_squared = error_tolerance_ * error_tolerance_;
-
-      Point delta1 = resolution_matrix_ * deltaFromLine(control1, from, to);
-      Point delta2 = resolution_matrix_ * deltaFromLine(control2, from, to);
-      if (delta1.squareMagnitude() <= error_squared && delta2.squareMagnitude() <= error_squared) {
-        addPoint(to);
-        return;
+    struct Curve {
+      void reverse(int num_points) {
+        int new_start = num_points - end + 1;
+        end = num_points - start + 1;
+        start = new_start;
+        if (arc) {
+          start_angle += sweep;
+          sweep = -sweep;
+        }
+        else {
+          std::swap(points[0], points[3]);
+          std::swap(points[1], points[2]);
+        }
       }
 
-      Point mid1 = (from + control1) * 0.5f;
-      Point mid2 = (control1 + control2) * 0.5f;
-      Point mid3 = (control2 + to) * 0.5f;
+      int sub_path = 0;
+      int start = 0;
+      int end = 0;
+      bool arc = false;
+      Point points[4];
+      Transform arc_transform;
+      float start_angle = 0.0f;
+      float sweep = 0.0f;
+    };
 
-      Point midmid1 = (mid1 + mid2) * 0.5f;
-      Point midmid2 = (mid2 + mid3) * 0.5f;
+    struct Geometry {
+      std::vector<SubPath> sub_paths;
+      std::vector<Curve> curves;
+    };
 
-      Point break_point = (midmid1 + midmid2) * 0.5f;
+    static const Geometry& emptyGeometry() {
+      static const Geometry kEmpty;
+      return kEmpty;
+    }
 
-      recurseBezierTo(from, mid1, midmid1, break_point);
-      recurseBezierTo(break_point, midmid2, mid3, to);
+    const Geometry& geometry() const { return geometry_ ? *geometry_ : emptyGeometry(); }
+
+    Geometry& mutableGeometry() {
+      if (geometry_ == nullptr)
+        geometry_ = std::make_shared<Geometry>();
+      else if (geometry_.use_count() > 1)
+        geometry_ = std::make_shared<Geometry>(*geometry_);
+      flattened_cache_.reset();
+      return *geometry_;
+    }
+
+    static int flatteningBucket(float scale);
+    void flattenCurve(std::vector<Point>& points, const Curve& curve, float tolerance) const;
+    void addBezier(const Point& from, const Point& control1, const Point& control2, const Point& to);
+
+    void addCurve(Curve curve, int start) {
+      Geometry& geometry = mutableGeometry();
+      curve.sub_path = geometry.sub_paths.size() - 1;
+      curve.start = start;
+      curve.end = geometry.sub_paths.back().points.size();
+      if (curve.end > curve.start && curve.start > 0)
+        geometry.curves.push_back(curve);
+    }
+
+    void transformCurves(const Transform& transform) {
+      if (geometry().curves.empty())
+        return;
+
+      for (Curve& curve : mutableGeometry().curves) {
+        for (Point& point : curve.points)
+          point = transform * point;
+        curve.arc_transform = transform * curve.arc_transform;
+      }
     }
 
     void startNewPath() {
-      if (paths_.empty() || !paths_.back().points.empty())
-        paths_.emplace_back();
+      std::vector<SubPath>& paths = mutableGeometry().sub_paths;
+      if (paths.empty() || !paths.back().points.empty())
+        paths.emplace_back();
 
       current_control_points_ = ControlPoints::Linear;
     }
 
     SubPath& currentPath() {
-      if (paths_.empty() || paths_.back().closed)
-        paths_.emplace_back();
-      return paths_.back();
+      std::vector<SubPath>& paths = mutableGeometry().sub_paths;
+      if (paths.empty() || paths.back().closed)
+        paths.emplace_back();
+      return paths.back();
     }
 
     void addPoint(const Point& point) {
-      if (!currentPath().points.empty() && point == currentPath().points.back())
+      std::vector<Point>& points = currentPath().points;
+      if (!points.empty() && point == points.back())
         return;
 
       last_point_ = point;
-      currentPath().points.push_back(point);
+      points.push_back(point);
       current_control_points_ = ControlPoints::Linear;
     }
 
     void addPoint(float x, float y) { addPoint({ x, y }); }
 
     Matrix resolution_matrix_;
-    std::vector<SubPath> paths_;
+    std::shared_ptr<Geometry> geometry_;
+    mutable std::shared_ptr<std::map<int, std::shared_ptr<Geometry>>> flattened_cache_;
     FillRule fill_rule_ = FillRule::EvenOdd;
     Point smooth_control_point_;
     ControlPoints current_control_points_ = ControlPoints::Linear;
@@ -594,6 +720,10 @@ namespace visage {
   class PathAtlas {
   public:
     static constexpr int kBuffer = 1;
+    static constexpr int kDefaultWidth = 256;
+    static constexpr int kMaxHeight = 8192;
+
+    struct PackedPathReference;
 
     struct PackedPathRect {
       explicit PackedPathRect(const Path& p) : path(p) { }
@@ -603,6 +733,10 @@ namespace visage {
       int y = 0;
       int w = 0;
       int h = 0;
+      int index = 0;
+      int slot = ShelfPacker::kInvalidSlot;
+      uint64_t hash = 0;
+      std::weak_ptr<PackedPathReference> reference;
       bool needs_update = true;
     };
 
@@ -657,24 +791,52 @@ namespace visage {
       std::shared_ptr<PackedPathReference> reference_;
     };
 
+    struct PlacedPath {
+      PackedPath packed_path;
+      float x = 0.0f;
+      float y = 0.0f;
+      float width = 0.0f;
+      float height = 0.0f;
+    };
+
+    static constexpr int kRetainedFrames = 8;
+
     PathAtlas();
     ~PathAtlas();
 
+    // Scales and positions path for drawing at x, y and packs it. Drawing the same Path object
+    // again at the same scale and sub-pixel offset reuses its atlas slot and rasterization.
+    // Paths that were never redrawn are released after a frame, others after kRetainedFrames.
+    PlacedPath placePath(const Path& path, float x, float y, float scale);
+    void nextFrame();
+    int numRetainedPaths() const { return retained_paths_.size(); }
+
     PackedPath addPath(const Path& path, int width, int height) {
+      width = std::max(0, width);
+      height = std::max(0, height);
+      uint64_t hash = pathKey(path, width, height);
+      auto existing = shared_paths_.find(hash);
+      if (existing != shared_paths_.end()) {
+        PackedPathRect* shared = existing->second;
+        if (shared->w == width && shared->h == height && shared->path.sameFill(path)) {
+          if (auto reference = shared->reference.lock())
+            return PackedPath(reference);
+        }
+      }
+
       std::unique_ptr<PackedPathRect> packed_path_rect = std::make_unique<PackedPathRect>(path);
-      if (!atlas_map_.addRect(packed_path_rect.get(), width, height))
-        needs_packing_ = true;
-
-      const PackedRect& rect = atlas_map_.rectForId(packed_path_rect.get());
-      packed_path_rect->x = rect.x;
-      packed_path_rect->y = rect.y;
-      packed_path_rect->w = rect.w;
-      packed_path_rect->h = rect.h;
+      packed_path_rect->w = width;
+      packed_path_rect->h = height;
+      packed_path_rect->index = paths_.size();
+      packed_path_rect->hash = hash;
       auto packed_rect = packed_path_rect.get();
       paths_.push_back(std::move(packed_path_rect));
+      allocate(packed_rect);
 
       auto reference = std::make_shared<PackedPathReference>(reference_, packed_rect);
-      references_[packed_rect] = reference;
+      packed_rect->reference = reference;
+      if (existing == shared_paths_.end())
+        shared_paths_[hash] = packed_rect;
       return PackedPath(reference);
     }
 
@@ -686,15 +848,26 @@ namespace visage {
     const bgfx::FrameBufferHandle& frameBufferHandle();
 
     void removePath(const PackedPathRect* packed_path_rect) {
-      atlas_map_.removeRect(packed_path_rect);
-      references_.erase(packed_path_rect);
-      paths_.erase(std::remove_if(paths_.begin(), paths_.end(),
-                                  [&](const std::unique_ptr<PackedPathRect>& ptr) {
-                                    return ptr.get() == packed_path_rect;
-                                  }),
-                   paths_.end());
+      int index = packed_path_rect->index;
+      VISAGE_ASSERT(index < paths_.size() && paths_[index].get() == packed_path_rect);
+      if (packed_path_rect->slot != ShelfPacker::kInvalidSlot)
+        packer_.release(packed_path_rect->slot);
+
+      auto shared = shared_paths_.find(packed_path_rect->hash);
+      if (shared != shared_paths_.end() && shared->second == packed_path_rect)
+        shared_paths_.erase(shared);
+
+      if (index != paths_.size() - 1) {
+        paths_[index] = std::move(paths_.back());
+        paths_[index]->index = index;
+      }
+      paths_.pop_back();
     }
 
+    int numPaths() const { return paths_.size(); }
+    void setDilatedTriangles(bool dilated) { dilated_triangles_ = dilated; }
+    bool dilatedTriangles() const { return dilated_triangles_; }
+
     static void setPathAtlasCoordinates(TextureVertex* vertices, const PackedPath& rect) {
       float left = rect.x();
       float top = rect.y();
@@ -718,18 +891,35 @@ namespace visage {
 
   private:
     bool clearUpdatedPathAreas(int submit_pass);
-    void checkInit();
-    void resize();
+    void checkInit(int submit_pass);
+    static uint64_t pathKey(const Path& path, int width, int height);
+    void allocate(PackedPathRect* packed_path_rect);
+    void repack(int min_width);
 
-    std::map<const PackedPathRect*, std::weak_ptr<PackedPathReference>> references_;
     std::vector<std::unique_ptr<PackedPathRect>> paths_;
-    PackedAtlasMap<const PackedPathRect*> atlas_map_;
+    std::map<uint64_t, PackedPathRect*> shared_paths_;
+    ShelfPacker packer_;
     std::unique_ptr<PathAtlasTexture> frame_buffer_;
     int width_ = 0;
     int height_ = 0;
-    bool needs_packing_ = false;
+    bool needs_redraw_ = false;
+    bool dilated_triangles_ = true;
     std::shared_ptr<PathAtlas*> reference_;
 
+    struct RetainedPath {
+      Path source;
+      float scale = 1.0f;
+      Bounds bounds;
+      float shift_x = 0.0f;
+      float shift_y = 0.0f;
+      PackedPath packed_path;
+      int last_used = 0;
+      bool reused = false;
+    };
+
+    std::unordered_multimap<const void*, RetainedPath> retained_paths_;
+    int frame_ = 0;
+
     VISAGE_LEAK_CHECKER(PathAtlas)
   };
 }
@@ -0,0 +1,400 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "path.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace visage {
+  class PathBooleanSweep {
+  public:
+    static constexpr double kSnapScale = 1024.0;
+
+    PathBooleanSweep(Path::Operation operation, Path::FillRule fill_rule_a, Path::FillRule fill_rule_b) :
+        operation_(operation) {
+      fill_rules_[0] = fill_rule_a;
+      fill_rules_[1] = fill_rule_b;
+    }
+
+    void addPath(const Path& path, int owner) {
+      std::vector<DPoint> loop;
+      for (const auto& sub_path : path.subPaths()) {
+        loop.clear();
+        for (const Point& point : sub_path.points) {
+          DPoint snapped = snap(point.x * kSnapScale, point.y * kSnapScale);
+          if (loop.empty() || loop.back() != snapped)
+            loop.push_back(snapped);
+        }
+        while (loop.size() > 1 && loop.back() == loop.front())
+          loop.pop_back();
+        if (loop.size() < 3)
+          continue;
+
+        for (int i = 0; i < loop.size(); ++i)
+          segments_.push_back({ loop[i], loop[(i + 1) % loop.size()], owner });
+      }
+    }
+
+    Path compute() {
+      splitSegments();
+      buildEdges();
+      computeWindings();
+      return traceLoops();
+    }
+
+  private:
+    struct Segment {
+      DPoint from;
+      DPoint to;
+      int owner = 0;
+    };
+
+    struct Edge {
+      DPoint low;
+      DPoint high;
+      int winding[2] = { 0, 0 };
+      int before[2] = { 0, 0 };
+      int after[2] = { 0, 0 };
+    };
+
+    struct OutputEdge {
+      DPoint from;
+      DPoint to;
+      bool used = false;
+    };
+
+    static DPoint snap(double x, double y) { return { std::round(x), std::round(y) }; }
+
+    static bool horizontal(const Edge& edge) { return edge.low.y == edge.high.y; }
+
+    static double xAt(const Edge& edge, double y) {
+      double t = (y - edge.low.y) / (edge.high.y - edge.low.y);
+      return edge.low.x + (edge.high.x - edge.low.x) * t;
+    }
+
+    static bool strictlyInside(const DPoint& from, const DPoint& to, const DPoint& point) {
+      if (point == from || point == to)
+        return false;
+      return point.x >= std::min(from.x, to.x) && point.x <= std::max(from.x, to.x) &&
+             point.y >= std::min(from.y, to.y) && point.y <= std::max(from.y, to.y);
+    }
+
+    static bool opposite(double a, double b) { return (a > 0.0 && b < 0.0) || (a < 0.0 && b > 0.0); }
+
+    bool filled(int owner, int winding) const {
+      switch (fill_rules_[owner]) {
+      case Path::FillRule::EvenOdd: return winding & 1;
+      case Path::FillRule::Positive: return winding > 0;
+      default: return winding != 0;
+      }
+    }
+
+    bool inside(const int* winding) const {
+      bool a = filled(0, winding[0]);
+      bool b = filled(1, winding[1]);
+      switch (operation_) {
+      case Path::Operation::Intersection: return a && b;
+      case Path::Operation::Difference: return a && !b;
+      case Path::Operation::Xor: return a != b;
+      default: return a || b;
+      }
+    }
+
+    void intersect(int index1, int index2) {
+      const DPoint& a = segments_[index1].from;
+      const DPoint& b = segments_[index1].to;
+      const DPoint& c = segments_[index2].from;
+      const DPoint& d = segments_[index2].to;
+
+      double orientation_c = orientation(a, b, c);
+      double orientation_d = orientation(a, b, d);
+      double orientation_a = orientation(c, d, a);
+      double orientation_b = orientation(c, d, b);
+      if (opposite(orientation_c, orientation_d) && opposite(orientation_a, orientation_b)) {
+        DPoint delta = b - a;
+        DPoint other_delta = d - c;
+        double t = (c - a).cross(other_delta) / delta.cross(other_delta);
+        DPoint point = snap(a.x + delta.x * t, a.y + delta.y * t);
+        splits_[index1].push_back(point);
+        splits_[index2].push_back(point);
+        return;
+      }
+
+      if (orientation_c == 0.0 && strictlyInside(a, b, c))
+        splits_[index1].push_back(c);
+      if (orientation_d == 0.0 && strictlyInside(a, b, d))
+        splits_[index1].push_back(d);
+      if (orientation_a == 0.0 && strictlyInside(c, d, a))
+        splits_[index2].push_back(a);
+      if (orientation_b == 0.0 && strictlyInside(c, d, b))
+        splits_[index2].push_back(b);
+    }
+
+    void splitSegments() {
+      splits_.assign(segments_.size(), {});
+      std::vector<int> order(segments_.size());
+      for (int i = 0; i < order.size(); ++i)
+        order[i] = i;
+      std::sort(order.begin(), order.end(), [this](int a, int b) {
+        return std::min(segments_[a].from.x, segments_[a].to.x) <
+               std::min(segments_[b].from.x, segments_[b].to.x);
+      });
+
+      std::vector<int> active;
+      for (int index : order) {
+        const Segment& segment = segments_[index];
+        double left = std::min(segment.from.x, segment.to.x);
+        double top = std::min(segment.from.y, segment.to.y);
+        double bottom = std::max(segment.from.y, segment.to.y);
+
+        for (int i = 0; i < active.size();) {
+          const Segment& other = segments_[active[i]];
+          if (std::max(other.from.x, other.to.x) < left) {
+            active[i] = active.back();
+            active.pop_back();
+            continue;
+          }
+          if (std::max(other.from.y, other.to.y) >= top && std::min(other.from.y, other.to.y) <= bottom)
+            intersect(index, active[i]);
+          ++i;
+        }
+        active.push_back(index);
+      }
+    }
+
+    void addEdge(const DPoint& from, const DPoint& to, int owner) {
+      if (from == to)
+        return;
+
+      bool forward = from.y < to.y || (from.y == to.y && from.x < to.x);
+      DPoint low = forward ? from : to;
+      DPoint high = forward ? to : from;
+      auto key = std::make_pair(std::make_pair(low.x, low.y), std::make_pair(high.x, high.y));
+      auto found = edge_lookup_.find(key);
+      int index = 0;
+      if (found == edge_lookup_.end()) {
+        index = edges_.size();
+        edge_lookup_[key] = index;
+        edges_.push_back({ low, high });
+      }
+      else
+        index = found->second;
+
+      edges_[index].winding[owner] += forward ? 1 : -1;
+    }
+
+    void buildEdges() {
+      for (int i = 0; i < segments_.size(); ++i) {
+        const Segment& segment = segments_[i];
+        std::vector<DPoint>& points = splits_[i];
+        DPoint delta = segment.to - segment.from;
+        std::sort(points.begin(), points.end(), [&](const DPoint& a, const DPoint& b) {
+          return (a - segment.from).dot(delta) < (b - segment.from).dot(delta);
+        });
+
+        DPoint from = segment.from;
+        for (const DPoint& point : points) {
+          addEdge(from, point, segment.owner);
+          from = point;
+        }
+        addEdge(from, segment.to, segment.owner);
+      }
+      segments_.clear();
+      splits_.clear();
+      edge_lookup_.clear();
+    }
+
+    void computeWindings() {
+      std::vector<double> ys;
+      std::vector<int> sloped;
+      std::vector<int> flat;
+      for (int i = 0; i < edges_.size(); ++i) {
+        ys.push_back(edges_[i].low.y);
+        ys.push_back(edges_[i].high.y);
+        if (horizontal(edges_[i]))
+          flat.push_back(i);
+        else if (edges_[i].winding[0] || edges_[i].winding[1])
+          sloped.push_back(i);
+      }
+      std::sort(ys.begin(), ys.end());
+      ys.erase(std::unique(ys.begin(), ys.end()), ys.end());
+
+      auto by_low = [this](int a, int b) { return edges_[a].low.y < edges_[b].low.y; };
+      std::sort(sloped.begin(), sloped.end(), by_low);
+      std::sort(flat.begin(), flat.end(), by_low);
+
+      std::vector<int> active;
+      std::vector<std::pair<double, int>> sorted;
+      int next_sloped = 0;
+      int next_flat = 0;
+      for (int k = 0; k + 1 < ys.size(); ++k) {
+        double top = ys[k];
+        double bottom = ys[k + 1];
+        active.erase(std::remove_if(active.begin(), active.end(),
+                                    [&](int e) { return edges_[e].high.y <= top; }),
+                     active.end());
+        while (next_sloped < sloped.size() && edges_[sloped[next_sloped]].low.y <= top)
+          active.push_back(sloped[next_sloped++]);
+
+        double middle = 0.5 * (top + bottom);
+        sorted.clear();
+        for (int e : active)
+          sorted.emplace_back(xAt(edges_[e], middle), e);
+        std::sort(sorted.begin(), sorted.end());
+
+        int winding[2] = { 0, 0 };
+        for (const auto& entry : sorted) {
+          Edge& edge = edges_[entry.second];
+          if (edge.low.y == top) {
+            edge.before[0] = winding[0];
+            edge.before[1] = winding[1];
+            edge.after[0] = winding[0] + edge.winding[0];
+            edge.after[1] = winding[1] + edge.winding[1];
+          }
+          winding[0] += edge.winding[0];
+          winding[1] += edge.winding[1];
+        }
+
+        while (next_flat < flat.size() && edges_[flat[next_flat]].low.y < top)
+          ++next_flat;
+        for (int f = next_flat; f < flat.size() && edges_[flat[f]].low.y <= bottom; ++f) {
+          Edge& edge = edges_[flat[f]];
+          double y = edge.low.y;
+          double x = 0.5 * (edge.low.x + edge.high.x);
+          int* side = y == top ? edge.after : edge.before;
+          side[0] = side[1] = 0;
+          for (const auto& entry : sorted) {
+            const Edge& crossing = edges_[entry.second];
+            if (xAt(crossing, y) < x) {
+              side[0] += crossing.winding[0];
+              side[1] += crossing.winding[1];
+            }
+          }
+        }
+      }
+    }
+
+    Path traceLoops() {
+      std::vector<OutputEdge> outputs;
+      std::map<std::pair<double, double>, std::vector<int>> outgoing;
+      for (const Edge& edge : edges_) {
+        bool inside_before = inside(edge.before);
+        bool inside_after = inside(edge.after);
+        if (inside_before == inside_after)
+          continue;
+
+        bool forward = horizontal(edge) ? inside_before : inside_after;
+        OutputEdge output = forward ? OutputEdge { edge.low, edge.high } : OutputEdge { edge.high, edge.low };
+        outgoing[{ output.from.x, output.from.y }].push_back(outputs.size());
+        outputs.push_back(output);
+      }
+      edges_.clear();
+
+      Path result;
+      result.setFillRule(Path::FillRule::NonZero);
+      std::vector<DPoint> loop;
+      for (int start = 0; start < outputs.size(); ++start) {
+        if (outputs[start].used)
+          continue;
+
+        loop.clear();
+        int current = start;
+        while (current >= 0) {
+          OutputEdge& edge = outputs[current];
+          edge.used = true;
+          loop.push_back(edge.from);
+          if (edge.to == outputs[start].from)
+            break;
+          current = nextEdge(outputs, outgoing[{ edge.to.x, edge.to.y }], edge);
+        }
+        addLoop(result, loop);
+      }
+      return result;
+    }
+
+    static int nextEdge(const std::vector<OutputEdge>& outputs, const std::vector<int>& candidates,
+                        const OutputEdge& incoming) {
+      static constexpr double kTwoPi = 2.0 * 3.14159265358979323846;
+      DPoint back = incoming.from - incoming.to;
+      double back_angle = std::atan2(back.y, back.x);
+      int best = -1;
+      double best_turn = 0.0;
+      for (int candidate : candidates) {
+        if (outputs[candidate].used)
+          continue;
+        DPoint delta = outputs[candidate].to - outputs[candidate].from;
+        double turn = std::atan2(delta.y, delta.x) - back_angle;
+        while (turn <= 0.0)
+          turn += kTwoPi;
+        if (best < 0 || turn < best_turn) {
+          best = candidate;
+          best_turn = turn;
+        }
+      }
+      return best;
+    }
+
+    static void addLoop(Path& result, std::vector<DPoint>& loop) {
+      bool removed = true;
+      while (removed && loop.size() >= 3) {
+        removed = false;
+        for (int i = 0; i < loop.size() && loop.size() >= 3;) {
+          const DPoint& previous = loop[(i + loop.size() - 1) % loop.size()];
+          const DPoint& next = loop[(i + 1) % loop.size()];
+          if (orientation(previous, loop[i], next) == 0.0) {
+            loop.erase(loop.begin() + i);
+            removed = true;
+          }
+          else
+            ++i;
+        }
+      }
+      if (loop.size() < 3)
+        return;
+
+      result.moveTo(loop[0].x / kSnapScale, loop[0].y / kSnapScale);
+      for (int i = 1; i < loop.size(); ++i)
+        result.lineTo(loop[i].x / kSnapScale, loop[i].y / kSnapScale);
+      result.close();
+    }
+
+    Path::Operation operation_ = Path::Operation::Union;
+    Path::FillRule fill_rules_[2] = { Path::FillRule::NonZero, Path::FillRule::NonZero };
+    std::vector<Segment> segments_;
+    std::vector<std::vector<DPoint>> splits_;
+    std::vector<Edge> edges_;
+    std::map<std::pair<std::pair<double, double>, std::pair<double, double>>, int> edge_lookup_;
+  };
+
+  Path Path::booleanOperation(const Path& other, Operation operation) const {
+    PathBooleanSweep sweep(operation, fill_rule_, other.fill_rule_);
+    sweep.addPath(*this, 0);
+    sweep.addPath(other, 1);
+    return sweep.compute();
+  }
+
+  Path Path::simplified() const {
+    PathBooleanSweep sweep(Operation::Union, fill_rule_, fill_rule_);
+    sweep.addPath(*this, 0);
+    return sweep.compute();
+  }
+}
@@ -0,0 +1,354 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "path_strips.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace visage {
+  static unsigned char stripCoverageAlpha(float value, bool even_odd) {
+    float coverage = std::abs(value);
+    if (even_odd)
+      coverage = 1.0f - std::abs(std::fmod(coverage, 2.0f) - 1.0f);
+    else
+      coverage = std::min(coverage, 1.0f);
+    return static_cast<unsigned char>(coverage * 255.0f + 0.5f);
+  }
+
+  void PathStrips::rasterize(const Path& path, int width, int height) {
+    width_ = std::max(0, width);
+    height_ = std::max(0, height);
+    even_odd_ = path.fillRule() == Path::FillRule::EvenOdd;
+    strips_.clear();
+    alphas_.clear();
+    alpha_width_ = 0;
+    alpha_height_ = 0;
+    if (width_ == 0 || height_ == 0)
+      return;
+
+    segments_.clear();
+    for (const auto& sub_path : path.subPaths()) {
+      int num_points = sub_path.points.size();
+      for (int i = 0; i < num_points && num_points > 1; ++i) {
+        Segment segment = { sub_path.points[i], sub_path.points[(i + 1) % num_points] };
+        if (segment.from.y != segment.to.y)
+          segments_.push_back(segment);
+      }
+    }
+
+    int num_strips = (height_ + kStripHeight - 1) / kStripHeight;
+    auto strip_range = [this, num_strips](const Segment& segment, int& start, int& end) {
+      float top = std::min(segment.from.y, segment.to.y);
+      float bottom = std::max(segment.from.y, segment.to.y);
+      if (bottom <= 0.0f || top >= height_)
+        return false;
+
+      start = std::max(0, static_cast<int>(std::floor(top))) / kStripHeight;
+      end = std::min(height_ - 1, static_cast<int>(std::ceil(bottom)) - 1) / kStripHeight;
+      end = std::min(std::max(start, end), num_strips - 1);
+      return true;
+    };
+
+    strip_offsets_.assign(num_strips + 1, 0);
+    for (const Segment& segment : segments_) {
+      int start = 0, end = 0;
+      if (strip_range(segment, start, end)) {
+        for (int s = start; s <= end; ++s)
+          strip_offsets_[s + 1]++;
+      }
+    }
+    for (int s = 0; s < num_strips; ++s)
+      strip_offsets_[s + 1] += strip_offsets_[s];
+
+    strip_segments_.resize(strip_offsets_[num_strips]);
+    std::vector<int> cursors(strip_offsets_.begin(), strip_offsets_.end() - 1);
+    for (int i = 0; i < segments_.size(); ++i) {
+      int start = 0, end = 0;
+      if (strip_range(segments_[i], start, end)) {
+        for (int s = start; s <= end; ++s)
+          strip_segments_[cursors[s]++] = i;
+      }
+    }
+
+    accumulation_.assign((width_ + 2) * kStripHeight, 0.0f);
+    tile_touched_.assign((width_ + kTileWidth - 1) / kTileWidth, false);
+    touched_tiles_.clear();
+    edge_runs_.clear();
+    edge_alphas_.clear();
+    open_solids_.clear();
+    next_open_solids_.clear();
+
+    for (int s = 0; s < num_strips; ++s)
+      rasterizeStrip(s * kStripHeight);
+
+    packAlphas();
+    releaseScratch();
+  }
+
+  float PathStrips::coverage(int x, int y) const {
+    for (const Strip& strip : strips_) {
+      if (x < strip.x || x >= strip.x + strip.width || y < strip.y || y >= strip.y + strip.height)
+        continue;
+
+      if (strip.solid)
+        return 1.0f;
+
+      int alpha_x = strip.alpha_x + x - strip.x;
+      int alpha_y = strip.alpha_y + y - strip.y;
+      return alphas_[(alpha_y * alpha_width_ + alpha_x) * 4 + 3] / 255.0f;
+    }
+    return 0.0f;
+  }
+
+  void PathStrips::accumulateSegment(const Segment& segment, int strip_y) {
+    Point from = segment.from;
+    Point to = segment.to;
+    float direction = 1.0f;
+    if (from.y > to.y) {
+      std::swap(from, to);
+      direction = -1.0f;
+    }
+
+    int stride = width_ + 2;
+    float dxdy = (to.x - from.x) / (to.y - from.y);
+    int row_start = std::max(strip_y, static_cast<int>(std::floor(from.y)));
+    int row_end = std::min(std::min(strip_y + kStripHeight, height_), static_cast<int>(std::ceil(to.y)));
+    float max_x = width_;
+
+    for (int y = row_start; y < row_end; ++y) {
+      float top = std::max(static_cast<float>(y), from.y);
+      float bottom = std::min(y + 1.0f, to.y);
+      float dy = bottom - top;
+      if (dy <= 0.0f)
+        continue;
+
+      float* row = accumulation_.data() + (y - strip_y) * stride;
+      float x = std::clamp(from.x + (top - from.y) * dxdy, 0.0f, max_x);
+      float x_next = std::clamp(from.x + (bottom - from.y) * dxdy, 0.0f, max_x);
+      float d = dy * direction;
+
+      float x0 = std::min(x, x_next);
+      float x1 = std::max(x, x_next);
+      float x0_floor = std::floor(x0);
+      int x0_index = x0_floor;
+      float x1_ceil = std::ceil(x1);
+      int x1_index = x1_ceil;
+
+      if (x1_index <= x0_index + 1) {
+        float mid = 0.5f * (x + x_next) - x0_floor;
+        row[x0_index] += d - d * mid;
+        row[x0_index + 1] += d * mid;
+        markColumns(x0_index, x0_index + 1);
+        continue;
+      }
+
+      float inverse = 1.0f / (x1 - x0);
+      float x0_fraction = x0 - x0_floor;
+      float start_area = 0.5f * inverse * (1.0f - x0_fraction) * (1.0f - x0_fraction);
+      float x1_fraction = x1 - x1_ceil + 1.0f;
+      float end_area = 0.5f * inverse * x1_fraction * x1_fraction;
+      row[x0_index] += d * start_area;
+
+      if (x1_index == x0_index + 2)
+        row[x0_index + 1] += d * (1.0f - start_area - end_area);
+      else {
+        float area = inverse * (1.5f - x0_fraction);
+        row[x0_index + 1] += d * (area - start_area);
+        for (int i = x0_index + 2; i < x1_index - 1; ++i)
+          row[i] += d * inverse;
+        float last_area = area + (x1_index - x0_index - 3) * inverse;
+        row[x1_index - 1] += d * (1.0f - last_area - end_area);
+      }
+      row[x1_index] += d * end_area;
+      markColumns(x0_index, x1_index);
+    }
+  }
+
+  void PathStrips::markColumns(int start, int end) {
+    int last = std::min(end, width_ - 1);
+    for (int tile = start / kTileWidth; tile <= last / kTileWidth; ++tile) {
+      if (!tile_touched_[tile]) {
+        tile_touched_[tile] = true;
+        touched_tiles_.push_back(tile);
+      }
+    }
+  }
+
+  void PathStrips::rasterizeStrip(int strip_y) {
+    int strip_index = strip_y / kStripHeight;
+    int strip_height = std::min(kStripHeight, height_ - strip_y);
+    for (int i = strip_offsets_[strip_index]; i < strip_offsets_[strip_index + 1]; ++i)
+      accumulateSegment(segments_[strip_segments_[i]], strip_y);
+
+    std::sort(touched_tiles_.begin(), touched_tiles_.end());
+
+    int stride = width_ + 2;
+    float running[kStripHeight] = {};
+    unsigned char column[kStripHeight] = {};
+    auto constant_column = [&] {
+      for (int r = 0; r < kStripHeight; ++r)
+        column[r] = r < strip_height ? stripCoverageAlpha(running[r], even_odd_) : 0;
+    };
+
+    int x = 0;
+    for (int tile : touched_tiles_) {
+      int tile_x = tile * kTileWidth;
+      if (tile_x > x) {
+        constant_column();
+        addColumns(x, tile_x - x, column, strip_y, strip_height);
+      }
+
+      int tile_end = std::min(tile_x + kTileWidth, width_);
+      for (int cx = tile_x; cx < tile_end; ++cx) {
+        for (int r = 0; r < kStripHeight; ++r) {
+          running[r] += accumulation_[r * stride + cx];
+          accumulation_[r * stride + cx] = 0.0f;
+        }
+        constant_column();
+        addColumns(cx, 1, column, strip_y, strip_height);
+      }
+      tile_touched_[tile] = false;
+      x = tile_end;
+    }
+
+    if (x < width_) {
+      constant_column();
+      addColumns(x, width_ - x, column, strip_y, strip_height);
+    }
+
+    for (int r = 0; r < kStripHeight; ++r) {
+      accumulation_[r * stride + width_] = 0.0f;
+      accumulation_[r * stride + width_ + 1] = 0.0f;
+    }
+
+    touched_tiles_.clear();
+    finishRun(strip_y, strip_height);
+    open_solids_.swap(next_open_solids_);
+    next_open_solids_.clear();
+    open_index_ = 0;
+  }
+
+  void PathStrips::addColumns(int x, int count, const unsigned char* column, int strip_y,
+                              int strip_height) {
+    bool empty = true;
+    bool solid = true;
+    for (int r = 0; r < strip_height; ++r) {
+      empty = empty && column[r] == 0;
+      solid = solid && column[r] == 255;
+    }
+
+    ColumnType type = empty ? ColumnType::Empty : (solid ? ColumnType::Solid : ColumnType::Edge);
+    if (type != run_type_ || x != run_end_) {
+      finishRun(strip_y, strip_height);
+      run_type_ = type;
+      run_start_ = x;
+      run_offset_ = edge_alphas_.size();
+    }
+
+    if (type == ColumnType::Edge) {
+      for (int i = 0; i < count; ++i)
+        edge_alphas_.insert(edge_alphas_.end(), column, column + kStripHeight);
+    }
+    run_end_ = x + count;
+  }
+
+  void PathStrips::finishRun(int strip_y, int strip_height) {
+    int run_start = run_start_;
+    int run_width = run_end_ - run_start_;
+    run_start_ = -1;
+    run_end_ = -1;
+    if (run_width <= 0)
+      return;
+
+    if (run_type_ == ColumnType::Edge)
+      edge_runs_.push_back({ run_start, strip_y, run_width, strip_height, run_offset_ });
+    else if (run_type_ == ColumnType::Solid) {
+      while (open_index_ < open_solids_.size() && strips_[open_solids_[open_index_]].x < run_start)
+        open_index_++;
+
+      if (open_index_ < open_solids_.size()) {
+        Strip& open = strips_[open_solids_[open_index_]];
+        if (open.x == run_start && open.width == run_width && open.y + open.height == strip_y) {
+          open.height += strip_height;
+          next_open_solids_.push_back(open_solids_[open_index_]);
+          return;
+        }
+      }
+
+      strips_.push_back({ run_start, strip_y, run_width, strip_height, 0, 0, true });
+      next_open_solids_.push_back(strips_.size() - 1);
+    }
+  }
+
+  void PathStrips::packAlphas() {
+    int total_columns = 0;
+    for (const EdgeRun& run : edge_runs_)
+      total_columns += run.width;
+
+    int usable_width = std::clamp(total_columns, 1, kMaxAlphaWidth);
+    int rows = (total_columns + usable_width - 1) / usable_width;
+    alpha_width_ = usable_width + kSolidColumns;
+    alpha_height_ = std::max(1, rows) * kStripHeight;
+    alphas_.assign(alpha_width_ * alpha_height_ * 4, 255);
+    for (int y = 0; y < alpha_height_; ++y) {
+      for (int x = kSolidColumns; x < alpha_width_; ++x)
+        alphas_[(y * alpha_width_ + x) * 4 + 3] = 0;
+    }
+
+    int cursor = 0;
+    int row = 0;
+    for (const EdgeRun& run : edge_runs_) {
+      for (int consumed = 0; consumed < run.width;) {
+        if (cursor == usable_width) {
+          cursor = 0;
+          row++;
+        }
+
+        int piece = std::min(run.width - consumed, usable_width - cursor);
+        int alpha_x = kSolidColumns + cursor;
+        int alpha_y = row * kStripHeight;
+        strips_.push_back({ run.x + consumed, run.y, piece, run.height, alpha_x, alpha_y, false });
+
+        for (int c = 0; c < piece; ++c) {
+          const unsigned char* column = edge_alphas_.data() + run.offset + (consumed + c) * kStripHeight;
+          for (int r = 0; r < kStripHeight; ++r)
+            alphas_[((alpha_y + r) * alpha_width_ + alpha_x + c) * 4 + 3] = column[r];
+        }
+        cursor += piece;
+        consumed += piece;
+      }
+    }
+  }
+
+  void PathStrips::releaseScratch() {
+    segments_ = {};
+    strip_segments_ = {};
+    strip_offsets_ = {};
+    accumulation_ = {};
+    touched_tiles_ = {};
+    tile_touched_ = {};
+    edge_runs_ = {};
+    edge_alphas_ = {};
+    open_solids_ = {};
+    next_open_solids_ = {};
+  }
+}
@@ -0,0 +1,109 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "path.h"
+
+#include <vector>
+
+namespace visage {
+  class PathStrips {
+  public:
+    static constexpr int kStripHeight = 4;
+    static constexpr int kTileWidth = 4;
+    static constexpr int kMaxAlphaWidth = 1024;
+    static constexpr int kSolidColumns = 1;
+
+    struct Strip {
+      int x = 0;
+      int y = 0;
+      int width = 0;
+      int height = 0;
+      int alpha_x = 0;
+      int alpha_y = 0;
+      bool solid = false;
+    };
+
+    void rasterize(const Path& path, int width, int height);
+    float coverage(int x, int y) const;
+
+    const std::vector<Strip>& strips() const { return strips_; }
+    const unsigned char* alphaData() const { return alphas_.data(); }
+    int alphaWidth() const { return alpha_width_; }
+    int alphaHeight() const { return alpha_height_; }
+    int width() const { return width_; }
+    int height() const { return height_; }
+
+  private:
+    enum class ColumnType {
+      Empty,
+      Edge,
+      Solid,
+    };
+
+    struct Segment {
+      Point from;
+      Point to;
+    };
+
+    struct EdgeRun {
+      int x = 0;
+      int y = 0;
+      int width = 0;
+      int height = 0;
+      int offset = 0;
+    };
+
+    void accumulateSegment(const Segment& segment, int strip_y);
+    void markColumns(int start, int end);
+    void rasterizeStrip(int strip_y);
+    void addColumns(int x, int count, const unsigned char* column, int strip_y, int strip_height);
+    void finishRun(int strip_y, int strip_height);
+    void packAlphas();
+    void releaseScratch();
+
+    std::vector<Segment> segments_;
+    std::vector<int> strip_segments_;
+    std::vector<int> strip_offsets_;
+    std::vector<float> accumulation_;
+    std::vector<int> touched_tiles_;
+    std::vector<bool> tile_touched_;
+
+    std::vector<EdgeRun> edge_runs_;
+    std::vector<unsigned char> edge_alphas_;
+    std::vector<int> open_solids_;
+    std::vector<int> next_open_solids_;
+    int open_index_ = 0;
+    int run_start_ = -1;
+    int run_end_ = -1;
+    ColumnType run_type_ = ColumnType::Empty;
+    int run_offset_ = 0;
+
+    std::vector<Strip> strips_;
+    std::vector<unsigned char> alphas_;
+    bool even_odd_ = false;
+    int width_ = 0;
+    int height_ = 0;
+    int alpha_width_ = 0;
+    int alpha_height_ = 0;
+  };
+}
@@ -0,0 +1,294 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "polyline_stroker.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define VISAGE_STROKER_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define VISAGE_STROKER_NEON 1
+#endif
+
+namespace visage {
+  static float strokerACos(float value) {
+    return std::acos(std::clamp(value, -1.0f, 1.0f));
+  }
+
+  const Path& PolylineStroker::stroke(const Path& path, float stroke_width, Path::Join join,
+                                      Path::EndCap end_cap, float miter_limit) {
+    static constexpr float kMinWidth = 0.002f;
+
+    num_sub_paths_ = 0;
+    half_width_ = stroke_width * 0.5f;
+    square_miter_limit_ = miter_limit * miter_limit;
+    float adjusted_radius = (path.resolutionMatrix() * Point(half_width_, 0.0f)).length();
+    max_delta_radians_ = 2.0f * strokerACos(1.0f - Path::kDefaultErrorTolerance / adjusted_radius);
+
+    if (std::abs(half_width_) >= kMinWidth * 0.5f) {
+      for (const auto& sub_path : path.subPaths()) {
+        int num_points = loadPoints(sub_path.points, sub_path.closed);
+        if (num_points == 0)
+          continue;
+
+        if (num_points == 1)
+          addSinglePoint(points_[0], end_cap);
+        else if (sub_path.closed && num_points > 2) {
+          loadLoop(num_points, false, false);
+          addLoop(join, end_cap);
+          loadLoop(num_points, false, true);
+          addLoop(join, end_cap);
+        }
+        else {
+          loadLoop(num_points, true, false);
+          addLoop(join, end_cap);
+        }
+      }
+    }
+
+    result_.subPaths().resize(num_sub_paths_);
+    result_.setFillRule(Path::FillRule::NonZero);
+    result_.setResolutionMatrix(path.resolutionMatrix());
+    return result_;
+  }
+
+  int PolylineStroker::loadPoints(const std::vector<Point>& points, bool closed) {
+    points_.clear();
+    for (const Point& point : points) {
+      if (points_.empty() || points_.back() != point)
+        points_.push_back(point);
+    }
+
+    if (closed && points_.size() > 1 && points_.front() == points_.back())
+      points_.pop_back();
+    return points_.size();
+  }
+
+  void PolylineStroker::loadLoop(int num_points, bool mirrored, bool reversed) {
+    loop_size_ = mirrored ? 2 * num_points - 2 : num_points;
+    int padded_size = loop_size_ + 4;
+    loop_x_.resize(padded_size);
+    loop_y_.resize(padded_size);
+    direction_x_.resize(padded_size);
+    direction_y_.resize(padded_size);
+
+    for (int i = 0; i < num_points; ++i) {
+      const Point& point = points_[reversed ? num_points - 1 - i : i];
+      loop_x_[i] = point.x;
+      loop_y_[i] = point.y;
+    }
+    for (int i = num_points; i < loop_size_; ++i) {
+      loop_x_[i] = loop_x_[2 * num_points - 2 - i];
+      loop_y_[i] = loop_y_[2 * num_points - 2 - i];
+    }
+    for (int i = loop_size_; i < padded_size; ++i) {
+      loop_x_[i] = loop_x_[i - loop_size_];
+      loop_y_[i] = loop_y_[i - loop_size_];
+    }
+
+    computeDirections();
+  }
+
+  void PolylineStroker::computeDirections() {
+    int i = 0;
+#if VISAGE_STROKER_SSE2
+    __m128 one = _mm_set1_ps(1.0f);
+    for (; i + 4 <= loop_size_; i += 4) {
+      __m128 delta_x = _mm_sub_ps(_mm_loadu_ps(loop_x_.data() + i + 1), _mm_loadu_ps(loop_x_.data() + i));
+      __m128 delta_y = _mm_sub_ps(_mm_loadu_ps(loop_y_.data() + i + 1), _mm_loadu_ps(loop_y_.data() + i));
+      __m128 length_squared = _mm_add_ps(_mm_mul_ps(delta_x, delta_x), _mm_mul_ps(delta_y, delta_y));
+      __m128 inverse = _mm_div_ps(one, _mm_sqrt_ps(length_squared));
+      _mm_storeu_ps(direction_x_.data() + i, _mm_mul_ps(delta_x, inverse));
+      _mm_storeu_ps(direction_y_.data() + i, _mm_mul_ps(delta_y, inverse));
+    }
+#elif VISAGE_STROKER_NEON
+    for (; i + 4 <= loop_size_; i += 4) {
+      float32x4_t delta_x = vsubq_f32(vld1q_f32(loop_x_.data() + i + 1), vld1q_f32(loop_x_.data() + i));
+      float32x4_t delta_y = vsubq_f32(vld1q_f32(loop_y_.data() + i + 1), vld1q_f32(loop_y_.data() + i));
+      float32x4_t length_squared = vaddq_f32(vmulq_f32(delta_x, delta_x), vmulq_f32(delta_y, delta_y));
+      float32x4_t inverse = vrsqrteq_f32(length_squared);
+      inverse = vmulq_f32(inverse, vrsqrtsq_f32(vmulq_f32(length_squared, inverse), inverse));
+      inverse = vmulq_f32(inverse, vrsqrtsq_f32(vmulq_f32(length_squared, inverse), inverse));
+      vst1q_f32(direction_x_.data() + i, vmulq_f32(delta_x, inverse));
+      vst1q_f32(direction_y_.data() + i, vmulq_f32(delta_y, inverse));
+    }
+#endif
+    for (; i < loop_size_; ++i) {
+      float delta_x = loop_x_[i + 1] - loop_x_[i];
+      float delta_y = loop_y_[i + 1] - loop_y_[i];
+      float inverse = 1.0f / std::sqrt(delta_x * delta_x + delta_y * delta_y);
+      direction_x_[i] = delta_x * inverse;
+      direction_y_[i] = delta_y * inverse;
+    }
+  }
+
+  void PolylineStroker::addLoop(Path::Join join, Path::EndCap end_cap) {
+    std::vector<Point>& output = nextSubPath();
+    float width = half_width_;
+
+    for (int i = 0; i < loop_size_; ++i) {
+      int prev_index = i == 0 ? loop_size_ - 1 : i - 1;
+      Point prev(loop_x_[prev_index], loop_y_[prev_index]);
+      Point point(loop_x_[i], loop_y_[i]);
+      Point next(loop_x_[i + 1], loop_y_[i + 1]);
+      Point prev_direction(direction_x_[prev_index], direction_y_[prev_index]);
+      Point prev_offset = Point(-prev_direction.y, prev_direction.x) * width;
+      Point offset = Point(-direction_y_[i], direction_x_[i]) * width;
+
+      Path::Join type = join;
+      if (prev == next) {
+        if (end_cap == Path::EndCap::Butt)
+          type = Path::Join::Bevel;
+        else if (end_cap == Path::EndCap::Square)
+          type = Path::Join::Square;
+        else
+          type = Path::Join::Round;
+      }
+      else if ((stableOrientation(prev, point, next) <= 0.0f) == (width < 0.0f))
+        type = Path::Join::Bevel;
+
+      if (type == Path::Join::Square) {
+        Point extension = prev_direction * width;
+        output.push_back(point + prev_offset + extension);
+        output.push_back(point + offset + extension);
+      }
+      else if (type == Path::Join::Round) {
+        output.push_back(point + prev_offset);
+        addRound(output, point, prev_offset, strokerACos(prev_offset.dot(offset) / (width * width)));
+      }
+      else if (type == Path::Join::Miter) {
+        float denominator = 1.0f + prev_offset.dot(offset) / (width * width);
+        Point miter = denominator > 0.0f ? (prev_offset + offset) / denominator : Point();
+        if (denominator > 0.0f && miter.squareMagnitude() / (width * width) < square_miter_limit_)
+          output.push_back(point + miter);
+        else {
+          output.push_back(point + prev_offset);
+          output.push_back(point + offset);
+        }
+      }
+      else {
+        output.push_back(point + prev_offset);
+        output.push_back(point + offset);
+      }
+    }
+  }
+
+  void PolylineStroker::addRound(std::vector<Point>& output, Point center, Point from, float angle) const {
+    int num_points = std::max(0.0f, std::ceil(angle / max_delta_radians_ - 0.1f));
+    float angle_delta = angle / (num_points + 1);
+    if (half_width_ > 0.0f)
+      angle_delta = -angle_delta;
+
+    float cos_delta = std::cos(angle_delta);
+    float sin_delta = std::sin(angle_delta);
+    Point position = from;
+    for (int i = 0; i <= num_points; ++i) {
+      position = Point(position.x * cos_delta - position.y * sin_delta,
+                       position.x * sin_delta + position.y * cos_delta);
+      output.push_back(center + position);
+    }
+  }
+
+  void PolylineStroker::addSinglePoint(Point point, Path::EndCap end_cap) {
+    float width = half_width_;
+    if (width < 0.0f || end_cap == Path::EndCap::Butt)
+      return;
+
+    std::vector<Point>& output = nextSubPath();
+    if (end_cap == Path::EndCap::Square) {
+      output.push_back(point + Point(width, width));
+      output.push_back(point + Point(width, -width));
+      output.push_back(point + Point(-width, -width));
+      output.push_back(point + Point(-width, width));
+      return;
+    }
+
+    int num_points = std::max<int>(1, std::ceil(2.0f * Path::kPi / max_delta_radians_ - 0.1f));
+    for (int i = 0; i < num_points; ++i) {
+      float angle = -2.0f * Path::kPi * i / num_points;
+      output.push_back(point + Point(std::cos(angle), std::sin(angle)) * width);
+    }
+  }
+
+  std::vector<Point>& PolylineStroker::nextSubPath() {
+    auto& sub_paths = result_.subPaths();
+    if (num_sub_paths_ == sub_paths.size())
+      sub_paths.emplace_back();
+
+    Path::SubPath& sub_path = sub_paths[num_sub_paths_++];
+    sub_path.points.clear();
+    sub_path.closed = true;
+    return sub_path.points;
+  }
+
+  const Path& StrokeCache::stroke(const Path& path, float scale, float stroke_width,
+                                  Path::Join join, Path::EndCap end_cap, DashPattern dash_array,
+                                  float dash_offset, float miter_limit) {
+    auto range = entries_.equal_range(path.geometryId());
+    for (auto it = range.first; it != range.second; ++it) {
+      Entry& entry = it->second;
+      if (entry.scale == scale && entry.stroke_width == stroke_width && entry.join == join &&
+          entry.end_cap == end_cap && entry.dash_offset == dash_offset &&
+          entry.miter_limit == miter_limit &&
+          std::equal(entry.dash_array.begin(), entry.dash_array.end(), dash_array.begin(),
+                     dash_array.end())) {
+        entry.last_used = frame_;
+        entry.reused = true;
+        return entry.outline;
+      }
+    }
+
+    Entry entry;
+    entry.source = path;
+    entry.scale = scale;
+    entry.stroke_width = stroke_width;
+    entry.join = join;
+    entry.end_cap = end_cap;
+    entry.dash_array = dash_array.toVector();
+    entry.dash_offset = dash_offset;
+    entry.miter_limit = miter_limit;
+    entry.last_used = frame_;
+
+    Path source = path.numCurves() ? path.flattened(scale) : path;
+    if (PolylineStroker::supports(join, dash_array))
+      entry.outline = stroker_.stroke(source, stroke_width, join, end_cap, miter_limit);
+    else
+      entry.outline = source.stroke(stroke_width, join, end_cap, entry.dash_array, dash_offset,
+                                    miter_limit);
+
+    return entries_.emplace(path.geometryId(), std::move(entry))->second.outline;
+  }
+
+  void StrokeCache::nextFrame() {
+    frame_++;
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      int unused_frames = frame_ - it->second.last_used;
+      if (unused_frames > kRetainedFrames || (!it->second.reused && unused_frames > 1))
+        it = entries_.erase(it);
+      else
+        ++it;
+    }
+  }
+}
@@ -0,0 +1,97 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "path.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace visage {
+  class PolylineStroker {
+  public:
+    static bool supports(Path::Join join, DashPattern dash_array) {
+      return dash_array.empty() && join != Path::Join::Square;
+    }
+
+    const Path& stroke(const Path& path, float stroke_width, Path::Join join = Path::Join::Round,
+                       Path::EndCap end_cap = Path::EndCap::Round,
+                       float miter_limit = Path::kDefaultMiterLimit);
+    const Path& result() const { return result_; }
+
+  private:
+    int loadPoints(const std::vector<Point>& points, bool closed);
+    void loadLoop(int num_points, bool mirrored, bool reversed);
+    void computeDirections();
+    void addLoop(Path::Join join, Path::EndCap end_cap);
+    void addSinglePoint(Point point, Path::EndCap end_cap);
+    void addRound(std::vector<Point>& output, Point center, Point from, float angle) const;
+    std::vector<Point>& nextSubPath();
+
+    std::vector<Point> points_;
+    std::vector<float> loop_x_;
+    std::vector<float> loop_y_;
+    std::vector<float> direction_x_;
+    std::vector<float> direction_y_;
+    int loop_size_ = 0;
+
+    Path result_;
+    int num_sub_paths_ = 0;
+    float half_width_ = 0.0f;
+    float max_delta_radians_ = 0.0f;
+    float square_miter_limit_ = 0.0f;
+  };
+
+  // Stroked outlines keyed by source path geometry and stroke style, so strokes of unchanged
+  // paths aren't regenerated every draw. Outlines never reused are dropped after a frame, others
+  // after kRetainedFrames frames without use.
+  class StrokeCache {
+  public:
+    static constexpr int kRetainedFrames = 8;
+
+    const Path& stroke(const Path& path, float scale, float stroke_width, Path::Join join,
+                       Path::EndCap end_cap, DashPattern dash_array, float dash_offset,
+                       float miter_limit);
+    void nextFrame();
+    void clear() { entries_.clear(); }
+    int size() const { return entries_.size(); }
+
+  private:
+    struct Entry {
+      Path source;
+      float scale = 1.0f;
+      float stroke_width = 0.0f;
+      Path::Join join = Path::Join::Round;
+      Path::EndCap end_cap = Path::EndCap::Round;
+      std::vector<float> dash_array;
+      float dash_offset = 0.0f;
+      float miter_limit = 0.0f;
+      Path outline;
+      int last_used = 0;
+      bool reused = false;
+    };
+
+    PolylineStroker stroker_;
+    std::unordered_multimap<const void*, Entry> entries_;
+    int frame_ = 0;
+  };
+}
@@ -25,6 +25,7 @@
 #include "embedded/shaders.h"
 #include "graphics_caches.h"
 #include "uniforms.h"
+#include "visage_utils/trace.h"
 
 #include <bgfx/bgfx.h>
 
@@ -33,13 +34,13 @@ namespace visage {
   void setPostEffectUniform(float value0, float value1 = 0.0f, float value2 = 0.0f, float value3 = 0.0f) {
     float values[4] = { value0, value1, value2, value3 };
     static const bgfx::UniformHandle uniform = bgfx::createUniform(name, bgfx::UniformType::Vec4, 1);
-    bgfx::setUniform(uniform, values);
+    UniformCache::setUniform(uniform, values);
   }
 
   template<const char* name>
   void setPostEffectTexture(int stage, bgfx::TextureHandle handle) {
     static const bgfx::UniformHandle uniform = bgfx::createUniform(name, bgfx::UniformType::Sampler, 1);
-    bgfx::setTexture(stage, uniform, handle);
+    encoder()->setTexture(stage, uniform, handle);
   }
 
   struct DownsampleHandles {
@@ -48,6 +49,9 @@ namespace visage {
     bgfx::VertexBufferHandle inv_screen_vertex_buffer = BGFX_INVALID_HANDLE;
     bgfx::FrameBufferHandle downsample_buffers1[DownsamplePostEffect::kMaxDownsamples + 1] {};
     bgfx::FrameBufferHandle downsample_buffers2[DownsamplePostEffect::kMaxDownsamples + 1] {};
+    bgfx::FrameBufferHandle output = BGFX_INVALID_HANDLE;
+    int output_level = -1;
+    bool output_current = false;
 
     ~DownsampleHandles() { destroy(); }
 
@@ -56,23 +60,24 @@ namespace visage {
         bgfx::destroy(screen_index_buffer);
       if (bgfx::isValid(screen_vertex_buffer))
         bgfx::destroy(screen_vertex_buffer);
-      destroyFrameBuffers();
+      if (bgfx::isValid(inv_screen_vertex_buffer))
+        bgfx::destroy(inv_screen_vertex_buffer);
+      releaseOutput();
     }
 
-    void destroyFrameBuffers() {
-      for (auto& buffer : downsample_buffers1) {
-        if (bgfx::isValid(buffer))
-          bgfx::destroy(buffer);
+    void releaseOutput() {
+      if (bgfx::isValid(output))
+        FrameBufferPool::releaseBuffer(output);
+      output = BGFX_INVALID_HANDLE;
+      output_level = -1;
+      output_current = false;
+    }
+
+    void resetScratchBuffers() {
+      for (auto& buffer : downsample_buffers1)
         buffer = BGFX_INVALID_HANDLE;
-      }
-      for (auto& buffer : downsample_buffers2) {
-        if (bgfx::isValid(buffer))
-          bgfx::destroy(buffer);
+      for (auto& buffer : downsample_buffers2)
         buffer = BGFX_INVALID_HANDLE;
-      }
-
-      bgfx::frame();
-      bgfx::frame();
     }
   };
 
@@ -92,24 +97,19 @@ namespace visage {
     float height_scale = 1.0f / source_layer->height();
     setPostEffectUniform<Uniforms::kAtlasScale>(width_scale, height_scale);
     setPostEffectTexture<Uniforms::kTexture>(0, bgfx::getTexture(source_layer->frameBuffer()));
-    setUniformDimensions(destination.width(), destination.height());
+    setUniformDimensions(destination.width(), destination.height(), submit_pass);
     float value = hdr() ? 1.0f / kHdrColorMultiplier : 1.0f;
     setPostEffectUniform<Uniforms::kColorMult>(value, value, value, 1.0f);
-    setOriginFlipUniform(destination.bottomLeftOrigin());
-    bgfx::submit(submit_pass, ProgramCache::programHandle(SampleRegion::vertexShader(),
-                                                          SampleRegion::fragmentShader()));
+    setOriginFlipUniform(destination.bottomLeftOrigin(), submit_pass);
+    submitQuads(submit_pass, ProgramCache::programHandle(SampleRegion::vertexShader(),
+                                                         SampleRegion::fragmentShader()));
   }
 
   DownsamplePostEffect::~DownsamplePostEffect() = default;
 
   DownsamplePostEffect::DownsamplePostEffect(bool hdr) : PostEffect(hdr) {
     handles_ = std::make_unique<DownsampleHandles>();
-
-    for (auto& buffer : handles_->downsample_buffers1)
-      buffer = BGFX_INVALID_HANDLE;
-
-    for (auto& buffer : handles_->downsample_buffers2)
-      buffer = BGFX_INVALID_HANDLE;
+    handles_->resetScratchBuffers();
 
     screen_vertices_[0].x = -1.0f;
     screen_vertices_[0].y = 1.0f;
@@ -130,10 +130,7 @@ namespace visage {
     }
   }
 
-  void DownsamplePostEffect::checkBuffers(const Region* region, bool full_resolution) {
-    static constexpr uint64_t kFrameBufferFlags = BGFX_TEXTURE_RT | BGFX_SAMPLER_U_CLAMP |
-                                                  BGFX_SAMPLER_V_CLAMP;
-
+  void DownsamplePostEffect::checkBuffers(const Region* region) {
     int full_width = region->width();
     int full_height = region->height();
     bgfx::TextureFormat::Enum format = static_cast<bgfx::TextureFormat::Enum>(region->layer()->frameBufferFormat());
@@ -152,21 +149,64 @@ namespace visage {
       full_width_ = full_width;
       full_height_ = full_height;
       format_ = format;
-      handles_->destroyFrameBuffers();
-    }
+      handles_->releaseOutput();
 
-    if (!bgfx::isValid(handles_->downsample_buffers1[1])) {
-      int start_index = full_resolution ? 0 : 1;
-      for (int i = start_index; i <= kMaxDownsamples; ++i) {
+      for (int i = 0; i <= kMaxDownsamples; ++i) {
         int scale = 1 << i;
         widths_[i] = std::max(1, (full_width + scale - 1) / scale);
         heights_[i] = std::max(1, (full_height + scale - 1) / scale);
-        handles_->downsample_buffers1[i] = bgfx::createFrameBuffer(widths_[i], heights_[i], format,
-                                                                   kFrameBufferFlags);
-        handles_->downsample_buffers2[i] = bgfx::createFrameBuffer(widths_[i], heights_[i], format,
-                                                                   kFrameBufferFlags);
       }
     }
+
+    handles_->resetScratchBuffers();
+  }
+
+  void DownsamplePostEffect::setOutputLevel(int level) {
+    if (handles_->output_level != level) {
+      handles_->releaseOutput();
+      handles_->output = FrameBufferPool::keepBuffer(widths_[level], heights_[level], format_);
+      handles_->output_level = level;
+    }
+    handles_->downsample_buffers1[level] = handles_->output;
+  }
+
+  bgfx::FrameBufferHandle DownsamplePostEffect::buffer1(int level) {
+    if (!bgfx::isValid(handles_->downsample_buffers1[level]))
+      handles_->downsample_buffers1[level] = FrameBufferPool::scratchBuffer(widths_[level],
+                                                                            heights_[level], format_);
+    return handles_->downsample_buffers1[level];
+  }
+
+  bgfx::FrameBufferHandle DownsamplePostEffect::buffer2(int level) {
+    if (!bgfx::isValid(handles_->downsample_buffers2[level]))
+      handles_->downsample_buffers2[level] = FrameBufferPool::scratchBuffer(widths_[level],
+                                                                            heights_[level], format_);
+    return handles_->downsample_buffers2[level];
+  }
+
+  bgfx::FrameBufferHandle DownsamplePostEffect::outputBuffer() const {
+    return handles_->output;
+  }
+
+  static bool sourceInvalidated(const Region* region) {
+    const Layer* layer = region->layer();
+    IBounds bounds = layer->boundsForRegion(region);
+    return std::any_of(layer->invalidRects().begin(), layer->invalidRects().end(),
+                       [&bounds](const InvalidRectStore::Entry* entry) {
+                         return entry->area.overlaps(bounds);
+                       });
+  }
+
+  bool DownsamplePostEffect::reuseCachedOutput(const Region* region, float setting1, float setting2) {
+    bool reuse = handles_->output_current && cached_region_ == region &&
+                 cached_settings_[0] == setting1 && cached_settings_[1] == setting2 &&
+                 !sourceInvalidated(region);
+
+    handles_->output_current = true;
+    cached_region_ = region;
+    cached_settings_[0] = setting1;
+    cached_settings_[1] = setting2;
+    return reuse;
   }
 
   void DownsamplePostEffect::setInitialVertices(Region* region) {
@@ -204,11 +244,11 @@ namespace visage {
       uv_data[3].v = 1.0f - top;
     }
 
-    bgfx::setVertexBuffer(0, &first_sample_buffer);
+    encoder()->setVertexBuffer(0, &first_sample_buffer);
   }
 
   void DownsamplePostEffect::setScreenVertexBuffer(bool inverted) {
-    bgfx::setVertexBuffer(0, inverted ? handles_->inv_screen_vertex_buffer : handles_->screen_vertex_buffer);
+    encoder()->setVertexBuffer(0, inverted ? handles_->inv_screen_vertex_buffer : handles_->screen_vertex_buffer);
   }
 
   BlurPostEffect::BlurPostEffect() : DownsamplePostEffect(false) { }
@@ -216,13 +256,21 @@ namespace visage {
   BlurPostEffect::~BlurPostEffect() = default;
 
   int BlurPostEffect::preprocess(Region* region, int submit_pass) {
-    static constexpr float kMaxSigma = 4.0f;
-    checkBuffers(region, true);
+    VISAGE_TRACE_SCOPE("BlurPostEffect::preprocess");
+    checkBuffers(region);
 
     sigma_ = blur_radius_;
     if (sigma_ < kMinSigma)
       return submit_pass;
 
+    if (mode_ == Mode::DualKawase)
+      return preprocessDualKawase(region, submit_pass);
+    return preprocessGaussian(region, submit_pass);
+  }
+
+  int BlurPostEffect::preprocessGaussian(Region* region, int submit_pass) {
+    static constexpr float kMaxSigma = 4.0f;
+
     float adjusted_sigma = sigma_;
     downsample_stages_ = 0;
     while (adjusted_sigma > kMaxSigma) {
@@ -231,6 +279,9 @@ namespace visage {
     }
     downsample_stages_ = std::min(kMaxDownsamples, downsample_stages_);
     float transition = adjusted_sigma / kMaxSigma;
+    setOutputLevel(downsample_stages_ ? 1 : 0);
+    if (reuseCachedOutput(region, sigma_, static_cast<float>(mode_)))
+      return submit_pass;
 
     int last_width = full_width_;
     int last_height = full_height_;
@@ -244,11 +295,11 @@ namespace visage {
       last_width = downsample_width;
       last_height = downsample_height;
 
-      bgfx::FrameBufferHandle destination = handles_->downsample_buffers1[i];
+      bgfx::FrameBufferHandle destination = buffer1(i);
       setBlendMode(BlendMode::Opaque);
       setPostEffectTexture<Uniforms::kTexture>(0, bgfx::getTexture(source));
       setPostEffectUniform<Uniforms::kPixelSize>(1.0f / last_width, 1.0f / last_height);
-      bgfx::setIndexBuffer(handles_->screen_index_buffer);
+      encoder()->setIndexBuffer(handles_->screen_index_buffer);
 
       bgfx::setViewFrameBuffer(submit_pass, destination);
       bgfx::setViewRect(submit_pass, 0, 0, downsample_width, downsample_height);
@@ -256,12 +307,15 @@ namespace visage {
       if (i == 0) {
         setInitialVertices(region);
         setPostEffectUniform<Uniforms::kResampleValues>(1.0f, 1.0f);
-        bgfx::submit(submit_pass, ProgramCache::programHandle(shaders::vs_sample, shaders::fs_sample));
+        submitDraw(submit_pass, ProgramCache::programHandle(shaders::vs_sample, shaders::fs_sample),
+                   kVerticesPerQuad);
       }
       else {
         setScreenVertexBuffer(region->layer()->bottomLeftOrigin());
         setPostEffectUniform<Uniforms::kResampleValues>(x_downsample_scale, y_downsample_scale);
-        bgfx::submit(submit_pass, ProgramCache::programHandle(shaders::vs_sample, shaders::fs_blur_sample));
+        submitDraw(submit_pass, ProgramCache::programHandle(shaders::vs_sample,
+                                                            shaders::fs_blur_sample),
+                   kVerticesPerQuad);
       }
 
       submit_pass++;
@@ -272,40 +326,108 @@ namespace visage {
     setPostEffectTexture<Uniforms::kTexture>(0, bgfx::getTexture(source));
     setScreenVertexBuffer(region->layer()->bottomLeftOrigin());
 
-    bgfx::setIndexBuffer(handles_->screen_index_buffer);
-    bgfx::setViewFrameBuffer(submit_pass, handles_->downsample_buffers2[downsample_stages_]);
+    encoder()->setIndexBuffer(handles_->screen_index_buffer);
+    bgfx::setViewFrameBuffer(submit_pass, buffer2(downsample_stages_));
     bgfx::setViewRect(submit_pass, 0, 0, last_width, last_height);
     setPostEffectUniform<Uniforms::kPixelSize>(transition / last_width, 0.0f);
-    bgfx::submit(submit_pass,
-                 ProgramCache::programHandle(shaders::vs_full_screen_texture, shaders::fs_blur));
+    submitDraw(submit_pass, ProgramCache::programHandle(shaders::vs_full_screen_texture,
+                                                        shaders::fs_blur),
+               kVerticesPerQuad);
     submit_pass++;
 
     setBlendMode(BlendMode::Opaque);
-    setPostEffectTexture<Uniforms::kTexture>(0, bgfx::getTexture(handles_->downsample_buffers2[downsample_stages_]));
+    setPostEffectTexture<Uniforms::kTexture>(0, bgfx::getTexture(buffer2(downsample_stages_)));
     setScreenVertexBuffer(region->layer()->bottomLeftOrigin());
 
-    bgfx::setIndexBuffer(handles_->screen_index_buffer);
-    bgfx::setViewFrameBuffer(submit_pass, handles_->downsample_buffers1[downsample_stages_]);
+    encoder()->setIndexBuffer(handles_->screen_index_buffer);
+    bgfx::setViewFrameBuffer(submit_pass, buffer1(downsample_stages_));
     bgfx::setViewRect(submit_pass, 0, 0, last_width, last_height);
     setPostEffectUniform<Uniforms::kPixelSize>(0.0f, transition / last_height);
-    bgfx::submit(submit_pass,
-                 ProgramCache::programHandle(shaders::vs_full_screen_texture, shaders::fs_blur));
+    submitDraw(submit_pass, ProgramCache::programHandle(shaders::vs_full_screen_texture,
+                                                        shaders::fs_blur),
+               kVerticesPerQuad);
     submit_pass++;
 
     for (int i = downsample_stages_; i > 1; --i) {
       int dest_width = widths_[i - 1];
       int dest_height = heights_[i - 1];
 
-      setPostEffectTexture<Uniforms::kTexture>(0, bgfx::getTexture(handles_->downsample_buffers1[i]));
+      setPostEffectTexture<Uniforms::kTexture>(0, bgfx::getTexture(buffer1(i)));
       setPostEffectUniform<Uniforms::kResampleValues>(dest_width * 0.5f / widths_[i],
                                                       dest_height * 0.5f / heights_[i]);
       setScreenVertexBuffer(region->layer()->bottomLeftOrigin());
-      bgfx::setIndexBuffer(handles_->screen_index_buffer);
-      bgfx::setViewFrameBuffer(submit_pass, handles_->downsample_buffers1[i - 1]);
+      encoder()->setIndexBuffer(handles_->screen_index_buffer);
+      bgfx::setViewFrameBuffer(submit_pass, buffer1(i - 1));
       bgfx::setViewRect(submit_pass, 0, 0, dest_width, dest_height);
 
       setBlendMode(BlendMode::Opaque);
-      bgfx::submit(submit_pass, ProgramCache::programHandle(shaders::vs_sample, shaders::fs_sample));
+      submitDraw(submit_pass, ProgramCache::programHandle(shaders::vs_sample, shaders::fs_sample),
+                 kVerticesPerQuad);
+      submit_pass++;
+    }
+
+    return submit_pass;
+  }
+
+  int BlurPostEffect::preprocessDualKawase(Region* region, int submit_pass) {
+    static constexpr float kRadiusPerStage = 2.0f;
+
+    downsample_stages_ = 1;
+    while (downsample_stages_ < kMaxDownsamples &&
+           sigma_ > kRadiusPerStage * (1 << downsample_stages_))
+      downsample_stages_++;
+    float offset = std::max(0.5f, sigma_ / (kRadiusPerStage * (1 << downsample_stages_)));
+
+    setOutputLevel(1);
+    if (reuseCachedOutput(region, sigma_, static_cast<float>(mode_)))
+      return submit_pass;
+
+    setBlendMode(BlendMode::Opaque);
+    setInitialVertices(region);
+    setPostEffectUniform<Uniforms::kResampleValues>(1.0f, 1.0f);
+    setPostEffectTexture<Uniforms::kTexture>(0, bgfx::getTexture(region->layer()->frameBuffer()));
+    encoder()->setIndexBuffer(handles_->screen_index_buffer);
+    bgfx::setViewFrameBuffer(submit_pass, buffer1(0));
+    bgfx::setViewRect(submit_pass, 0, 0, widths_[0], heights_[0]);
+    submitDraw(submit_pass, ProgramCache::programHandle(shaders::vs_sample, shaders::fs_sample),
+               kVerticesPerQuad);
+    submit_pass++;
+
+    for (int i = 0; i < downsample_stages_; ++i) {
+      int downsample_width = widths_[i + 1];
+      int downsample_height = heights_[i + 1];
+
+      setBlendMode(BlendMode::Opaque);
+      setPostEffectTexture<Uniforms::kTexture>(0, bgfx::getTexture(buffer1(i)));
+      setPostEffectUniform<Uniforms::kPixelSize>(offset / widths_[i], offset / heights_[i]);
+      setPostEffectUniform<Uniforms::kResampleValues>(downsample_width * 2.0f / widths_[i],
+                                                      downsample_height * 2.0f / heights_[i]);
+      setScreenVertexBuffer(region->layer()->bottomLeftOrigin());
+      encoder()->setIndexBuffer(handles_->screen_index_buffer);
+      bgfx::setViewFrameBuffer(submit_pass, buffer1(i + 1));
+      bgfx::setViewRect(submit_pass, 0, 0, downsample_width, downsample_height);
+      submitDraw(submit_pass, ProgramCache::programHandle(shaders::vs_sample,
+                                                          shaders::fs_kawase_down),
+                 kVerticesPerQuad);
+      submit_pass++;
+    }
+
+    for (int i = downsample_stages_; i > 1; --i) {
+      int dest_width = widths_[i - 1];
+      int dest_height = heights_[i - 1];
+
+      setBlendMode(BlendMode::Opaque);
+      setPostEffectTexture<Uniforms::kTexture>(0, bgfx::getTexture(buffer1(i)));
+      setPostEffectUniform<Uniforms::kPixelSize>(offset / widths_[i], offset / heights_[i]);
+      setPostEffectUniform<Uniforms::kResampleValues>(dest_width * 0.5f / widths_[i],
+                                                      dest_height * 0.5f / heights_[i]);
+      setScreenVertexBuffer(region->layer()->bottomLeftOrigin());
+      encoder()->setIndexBuffer(handles_->screen_index_buffer);
+      bgfx::setViewFrameBuffer(submit_pass, buffer1(i - 1));
+      bgfx::setViewRect(submit_pass, 0, 0, dest_width, dest_height);
+      submitDraw(submit_pass, ProgramCache::programHandle(shaders::vs_sample,
+                                                          shaders::fs_kawase_up),
+                 kVerticesPerQuad);
       submit_pass++;
     }
 
@@ -330,8 +452,7 @@ namespace visage {
     float height_scale = 1.0f / heights_[0];
     setPostEffectUniform<Uniforms::kAtlasScale>(width_scale, height_scale);
 
-    int source_index = downsample_stages_ ? 1 : 0;
-    setPostEffectTexture<Uniforms::kTexture>(0, bgfx::getTexture(handles_->downsample_buffers1[source_index]));
+    setPostEffectTexture<Uniforms::kTexture>(0, bgfx::getTexture(outputBuffer()));
 
     for (int i = 0; i < quads.num_shapes; ++i) {
       quads.vertices[i * kVerticesPerQuad].texture_x = 0.0f;
@@ -343,13 +464,13 @@ namespace visage {
       quads.vertices[i * kVerticesPerQuad + 3].texture_x = widths_[0];
       quads.vertices[i * kVerticesPerQuad + 3].texture_y = heights_[0];
     }
-    setUniformDimensions(destination.width(), destination.height());
+    setUniformDimensions(destination.width(), destination.height(), submit_pass);
 
     float value = destination.hdr() ? kHdrColorMultiplier : 1.0f;
     setPostEffectUniform<Uniforms::kColorMult>(value, value, value, 1.0f);
-    setOriginFlipUniform(false);
-    bgfx::submit(submit_pass, ProgramCache::programHandle(SampleRegion::vertexShader(),
-                                                          SampleRegion::fragmentShader()));
+    setOriginFlipUniform(false, submit_pass);
+    submitQuads(submit_pass, ProgramCache::programHandle(SampleRegion::vertexShader(),
+                                                         SampleRegion::fragmentShader()));
   }
 
   BloomPostEffect::BloomPostEffect() : DownsamplePostEffect(true) { }
@@ -357,92 +478,102 @@ namespace visage {
   BloomPostEffect::~BloomPostEffect() = default;
 
   int BloomPostEffect::preprocess(Region* region, int submit_pass) {
-    checkBuffers(region, false);
+    VISAGE_TRACE_SCOPE("BloomPostEffect::preprocess");
+    checkBuffers(region);
+    setOutputLevel(1);
 
     float hdr_range = hdr() ? kHdrColorRange : 1.0f;
     float stages = std::max(std::floor(bloom_size_) + 0.99f, 0.0f);
     stages = std::max(1.0f, std::min(stages, kMaxDownsamples + 0.99f));
     downsamples_ = stages;
+    if (reuseCachedOutput(region, bloom_size_, bloom_intensity_))
+      return submit_pass;
 
     setBlendMode(BlendMode::Opaque);
     setInitialVertices(region);
     setPostEffectUniform<Uniforms::kResampleValues>(1.0f, 1.0f);
     setPostEffectTexture<Uniforms::kTexture>(0, bgfx::getTexture(region->layer()->frameBuffer()));
 
-    bgfx::setIndexBuffer(handles_->screen_index_buffer);
-    bgfx::setViewFrameBuffer(submit_pass, handles_->downsample_buffers1[1]);
+    encoder()->setIndexBuffer(handles_->screen_index_buffer);
+    bgfx::setViewFrameBuffer(submit_pass, buffer1(1));
     bgfx::setViewRect(submit_pass, 0, 0, widths_[1], heights_[1]);
     float mult_val = hdr_range * bloom_intensity_;
     setPostEffectUniform<Uniforms::kMult>(mult_val, mult_val, mult_val, 1.0f);
     float hdr_mult = hdr() ? kHdrColorMultiplier : 1.0f;
     setPostEffectUniform<Uniforms::kThreshold>(hdr_mult);
 
-    bgfx::submit(submit_pass, ProgramCache::programHandle(shaders::vs_sample, shaders::fs_mult_threshold));
+    submitDraw(submit_pass, ProgramCache::programHandle(shaders::vs_sample,
+                                                        shaders::fs_mult_threshold),
+               kVerticesPerQuad);
     submit_pass++;
 
-    bgfx::FrameBufferHandle source = handles_->downsample_buffers1[1];
+    bgfx::FrameBufferHandle source = buffer1(1);
     for (int i = 1; i < downsamples_; ++i) {
       int downsample_width = widths_[i + 1];
       int downsample_height = heights_[i + 1];
       float x_downsample_scale = downsample_width * 2.0f / widths_[i];
       float y_downsample_scale = downsample_height * 2.0f / heights_[i];
 
-      bgfx::FrameBufferHandle destination = handles_->downsample_buffers1[i + 1];
+      bgfx::FrameBufferHandle destination = buffer1(i + 1);
       setBlendMode(BlendMode::Opaque);
       setPostEffectTexture<Uniforms::kTexture>(0, bgfx::getTexture(source));
-      bgfx::setIndexBuffer(handles_->screen_index_buffer);
+      encoder()->setIndexBuffer(handles_->screen_index_buffer);
       setScreenVertexBuffer(region->layer()->bottomLeftOrigin());
       setPostEffectUniform<Uniforms::kResampleValues>(x_downsample_scale, y_downsample_scale);
 
       bgfx::setViewFrameBuffer(submit_pass, destination);
       bgfx::setViewRect(submit_pass, 0, 0, downsample_width, downsample_height);
 
-      bgfx::submit(submit_pass, ProgramCache::programHandle(shaders::vs_sample, shaders::fs_sample));
+      submitDraw(submit_pass, ProgramCache::programHandle(shaders::vs_sample, shaders::fs_sample),
+                 kVerticesPerQuad);
       submit_pass++;
 
       setBlendMode(BlendMode::Opaque);
       setPostEffectTexture<Uniforms::kTexture>(0, bgfx::getTexture(destination));
       setScreenVertexBuffer(region->layer()->bottomLeftOrigin());
-      bgfx::setIndexBuffer(handles_->screen_index_buffer);
-      bgfx::setViewFrameBuffer(submit_pass, handles_->downsample_buffers2[i + 1]);
+      encoder()->setIndexBuffer(handles_->screen_index_buffer);
+      bgfx::setViewFrameBuffer(submit_pass, buffer2(i + 1));
       bgfx::setViewRect(submit_pass, 0, 0, downsample_width, downsample_height);
       setPostEffectUniform<Uniforms::kPixelSize>(1.0f / downsample_width);
 
-      bgfx::submit(submit_pass, ProgramCache::programHandle(shaders::vs_full_screen_texture,
-                                                            shaders::fs_small_blur));
+      submitDraw(submit_pass, ProgramCache::programHandle(shaders::vs_full_screen_texture,
+                                                          shaders::fs_small_blur),
+                 kVerticesPerQuad);
       submit_pass++;
 
       setBlendMode(BlendMode::Opaque);
-      setPostEffectTexture<Uniforms::kTexture>(0, bgfx::getTexture(handles_->downsample_buffers2[i + 1]));
+      setPostEffectTexture<Uniforms::kTexture>(0, bgfx::getTexture(buffer2(i + 1)));
       setScreenVertexBuffer(region->layer()->bottomLeftOrigin());
-      bgfx::setIndexBuffer(handles_->screen_index_buffer);
+      encoder()->setIndexBuffer(handles_->screen_index_buffer);
       bgfx::setViewFrameBuffer(submit_pass, destination);
       bgfx::setViewRect(submit_pass, 0, 0, downsample_width, downsample_height);
       setPostEffectUniform<Uniforms::kPixelSize>(0.0f, 1.0f / downsample_height);
-      bgfx::submit(submit_pass, ProgramCache::programHandle(shaders::vs_full_screen_texture,
-                                                            shaders::fs_small_blur));
+      submitDraw(submit_pass, ProgramCache::programHandle(shaders::vs_full_screen_texture,
+                                                          shaders::fs_small_blur),
+                 kVerticesPerQuad);
       submit_pass++;
 
       source = destination;
     }
 
     for (int i = downsamples_ - 1; i > 0; --i) {
-      bgfx::FrameBufferHandle destination = handles_->downsample_buffers1[i];
+      bgfx::FrameBufferHandle destination = buffer1(i);
       int dest_width = widths_[i];
       int dest_height = heights_[i];
 
       setBlendMode(BlendMode::Add);
 
-      setPostEffectTexture<Uniforms::kTexture>(0, bgfx::getTexture(handles_->downsample_buffers1[i + 1]));
+      setPostEffectTexture<Uniforms::kTexture>(0, bgfx::getTexture(buffer1(i + 1)));
       setPostEffectUniform<Uniforms::kResampleValues>(dest_width * 0.5f / widths_[i + 1],
                                                       dest_height * 0.5f / heights_[i + 1]);
       setPostEffectUniform<Uniforms::kMult>(2.0f, 2.0f, 2.0f, 1.0f);
       setScreenVertexBuffer(region->layer()->bottomLeftOrigin());
-      bgfx::setIndexBuffer(handles_->screen_index_buffer);
+      encoder()->setIndexBuffer(handles_->screen_index_buffer);
       bgfx::setViewFrameBuffer(submit_pass, destination);
       bgfx::setViewRect(submit_pass, 0, 0, dest_width, dest_height);
 
-      bgfx::submit(submit_pass, ProgramCache::programHandle(shaders::vs_sample, shaders::fs_mult));
+      submitDraw(submit_pass, ProgramCache::programHandle(shaders::vs_sample, shaders::fs_mult),
+                 kVerticesPerQuad);
       submit_pass++;
     }
 
@@ -479,10 +610,10 @@ namespace visage {
     float mult = bloom_intensity_ * Color::kGradientNormalization;
     setPostEffectUniform<Uniforms::kColorMult>(mult, mult, mult, 1.0f);
     setPostEffectTexture<Uniforms::kGradient>(0, destination.gradientAtlas()->colorTextureHandle());
-    setPostEffectTexture<Uniforms::kTexture>(1, bgfx::getTexture(handles_->downsample_buffers1[1]));
-    setUniformDimensions(destination.width(), destination.height());
-    bgfx::submit(submit_pass,
-                 ProgramCache::programHandle(shaders::vs_tinted_texture, shaders::fs_tinted_texture));
+    setPostEffectTexture<Uniforms::kTexture>(1, bgfx::getTexture(outputBuffer()));
+    setUniformDimensions(destination.width(), destination.height(), submit_pass);
+    submitQuads(submit_pass, ProgramCache::programHandle(shaders::vs_tinted_texture,
+                                                         shaders::fs_tinted_texture));
   }
 
   void ShaderPostEffect::submit(const BatchVector<SampleRegion>& batches, Layer& destination,
@@ -503,7 +634,7 @@ namespace visage {
     setPostEffectTexture<Uniforms::kTexture>(0, bgfx::getTexture(source_layer->frameBuffer()));
     float value = hdr() ? 1.0f / kHdrColorMultiplier : 1.0f;
     setPostEffectUniform<Uniforms::kColorMult>(value, value, value, 1.0f);
-    setOriginFlipUniform(destination.bottomLeftOrigin());
+    setOriginFlipUniform(destination.bottomLeftOrigin(), submit_pass);
 
     float min_x = (std::min(quads.vertices[0].texture_x, quads.vertices[3].texture_x) + 0.5f) * width_scale;
     float min_y = (std::min(quads.vertices[0].texture_y, quads.vertices[3].texture_y) + 0.5f) * height_scale;
@@ -516,12 +647,12 @@ namespace visage {
     float width = std::abs(quads.vertices[3].texture_x - quads.vertices[0].texture_x);
     float height = std::abs(quads.vertices[3].texture_y - quads.vertices[0].texture_y);
     setPostEffectUniform<Uniforms::kDimensions>(width, height);
-    setUniformDimensions(destination.width(), destination.height());
+    setUniformDimensions(destination.width(), destination.height(), submit_pass);
 
     for (const auto& uniform : uniforms_)
-      bgfx::setUniform(UniformCache::uniformHandle(uniform.first.c_str()), uniform.second.data);
+      UniformCache::setUniform(UniformCache::uniformHandle(uniform.first.c_str()), uniform.second.data);
 
     bgfx::ProgramHandle program = ProgramCache::programHandle(vertexShader(), fragmentShader());
-    bgfx::submit(submit_pass, program);
+    submitQuads(submit_pass, program);
   }
 }
\ No newline at end of file
@@ -32,6 +32,8 @@ namespace visage {
 
     virtual ~PostEffect() = default;
     virtual int preprocess(Region* region, int submit_pass) { return submit_pass; }
+    // Most views preprocess() can use, so a submit can be given enough views before it starts.
+    virtual int maxPreprocessPasses() const { return 0; }
     virtual void submit(const BatchVector<SampleRegion>& batches, Layer& destination, int submit_pass) { }
     void submitPassthrough(const BatchVector<SampleRegion>& batches, const Layer& destination,
                            int submit_pass) const;
@@ -50,11 +52,25 @@ namespace visage {
     explicit DownsamplePostEffect(bool hdr = false);
     ~DownsamplePostEffect() override;
 
+    // A downsample, a blur or bloom pass and an upsample per level, with room to spare.
+    int maxPreprocessPasses() const override { return 4 * kMaxDownsamples; }
+
   protected:
     void setInitialVertices(Region* region);
-    void checkBuffers(const Region* region, bool full_resolution);
+    void checkBuffers(const Region* region);
     void setScreenVertexBuffer(bool inverted);
 
+    // The output level is kept between frames for submit(), every other level is a scratch
+    // buffer from the shared FrameBufferPool that is only valid during this frame's preprocess.
+    void setOutputLevel(int level);
+    bgfx::FrameBufferHandle buffer1(int level);
+    bgfx::FrameBufferHandle buffer2(int level);
+    bgfx::FrameBufferHandle outputBuffer() const;
+
+    // Returns true when the output from the last preprocess is still valid because the settings
+    // match and nothing under the source region was invalidated since.
+    bool reuseCachedOutput(const Region* region, float setting1, float setting2 = 0.0f);
+
     int full_width_ = 0;
     int full_height_ = 0;
     int widths_[kMaxDownsamples + 1] {};
@@ -63,12 +79,21 @@ namespace visage {
     UvVertex screen_vertices_[4] {};
     UvVertex inv_screen_vertices_[4] {};
     int format_ = 0;
+    const Region* cached_region_ = nullptr;
+    float cached_settings_[2] {};
   };
 
   class BlurPostEffect : public DownsamplePostEffect {
   public:
     static constexpr float kMinSigma = 0.01f;
 
+    // Gaussian runs a separable 21 tap blur at the lowest downsample level. DualKawase uses 5 tap
+    // downsamples and 8 tap upsamples, which is much cheaper for large radii.
+    enum class Mode {
+      Gaussian,
+      DualKawase
+    };
+
     BlurPostEffect();
     ~BlurPostEffect() override;
 
@@ -77,8 +102,14 @@ namespace visage {
 
     float blurRadius() const { return blur_radius_; }
     void setBlurRadius(float size) { blur_radius_ = std::max(0.0f, size); }
+    Mode mode() const { return mode_; }
+    void setMode(Mode mode) { mode_ = mode; }
 
   private:
+    int preprocessGaussian(Region* region, int submit_pass);
+    int preprocessDualKawase(Region* region, int submit_pass);
+
+    Mode mode_ = Mode::Gaussian;
     float blur_radius_ = 0.0f;
     float sigma_ = 0.0f;
     int downsample_stages_ = 0;
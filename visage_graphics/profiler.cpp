@@ -0,0 +1,134 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "profiler.h"
+
+#include "resource_usage.h"
+
+#include <algorithm>
+#include <bgfx/bgfx.h>
+
+namespace visage {
+  void FrameProfiler::setEnabled(bool enabled) {
+    if (enabled_ == enabled)
+      return;
+
+    enabled_ = enabled;
+    clear();
+    if (!enabled_ && gpu_profiling_) {
+      bgfx::setDebug(BGFX_DEBUG_NONE);
+      gpu_profiling_ = false;
+    }
+  }
+
+  void FrameProfiler::beginFrame() {
+    if (!enabled_ || frame_started_)
+      return;
+
+    frame_started_ = true;
+    frame_start_ = Clock::now();
+  }
+
+  void FrameProfiler::endFrame(bool rendered, int num_views) {
+    if (!enabled_)
+      return;
+
+    if (!rendered) {
+      frame_started_ = false;
+      current_ = {};
+      return;
+    }
+
+    if (!gpu_profiling_) {
+      bgfx::setDebug(BGFX_DEBUG_PROFILER);
+      gpu_profiling_ = true;
+    }
+
+    current_.frame = frame_++;
+    current_.num_views = num_views;
+    current_.cpu_microseconds = frame_started_ ? microsecondsSince(frame_start_) : 0;
+    current_.resource_bytes = ResourceTracker::total().bytes;
+    readGpuStats(current_);
+    frame_started_ = false;
+
+    if (history_.size() < kHistorySize)
+      history_.push_back(std::move(current_));
+    else
+      history_[history_position_] = std::move(current_);
+
+    history_position_ = (history_position_ + 1) % kHistorySize;
+    num_frames_ = std::min(num_frames_ + 1, kHistorySize);
+    current_ = {};
+  }
+
+  const FrameProfile& FrameProfiler::lastFrame() const {
+    static const FrameProfile kEmptyProfile;
+    if (num_frames_ == 0)
+      return kEmptyProfile;
+    return history_[(history_position_ + kHistorySize - 1) % kHistorySize];
+  }
+
+  std::vector<FrameProfile> FrameProfiler::history() const {
+    std::vector<FrameProfile> result;
+    result.reserve(num_frames_);
+    int start = num_frames_ < kHistorySize ? 0 : history_position_;
+    for (int i = 0; i < num_frames_; ++i)
+      result.push_back(history_[(start + i) % kHistorySize]);
+    return result;
+  }
+
+  long long FrameProfiler::maxCpuMicroseconds() const {
+    long long result = 0;
+    for (int i = 0; i < num_frames_; ++i)
+      result = std::max(result, history_[i].cpu_microseconds);
+    return result;
+  }
+
+  void FrameProfiler::clear() {
+    frame_started_ = false;
+    frame_ = 0;
+    num_frames_ = 0;
+    history_position_ = 0;
+    current_ = {};
+    history_.clear();
+  }
+
+  void FrameProfiler::readGpuStats(FrameProfile& profile) const {
+    const bgfx::Stats* stats = bgfx::getStats();
+    if (stats == nullptr)
+      return;
+
+    double cpu_to_ms = stats->cpuTimerFreq ? 1000.0 / stats->cpuTimerFreq : 0.0;
+    double gpu_to_ms = stats->gpuTimerFreq ? 1000.0 / stats->gpuTimerFreq : 0.0;
+    profile.gpu_milliseconds = (stats->gpuTimeEnd - stats->gpuTimeBegin) * gpu_to_ms;
+
+    profile.views.clear();
+    for (int i = 0; i < stats->numViews; ++i) {
+      const bgfx::ViewStats& view_stats = stats->viewStats[i];
+      ViewProfile view;
+      view.view = view_stats.view;
+      view.name = view_stats.name;
+      view.cpu_milliseconds = (view_stats.cpuTimeEnd - view_stats.cpuTimeBegin) * cpu_to_ms;
+      view.gpu_milliseconds = (view_stats.gpuTimeEnd - view_stats.gpuTimeBegin) * gpu_to_ms;
+      profile.views.push_back(std::move(view));
+    }
+  }
+}
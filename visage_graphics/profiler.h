@@ -0,0 +1,147 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace visage {
+  struct ProfileSample {
+    std::string name;
+    int index = -1;
+    long long microseconds = 0;
+  };
+
+  struct ViewProfile {
+    int view = 0;
+    std::string name;
+    double cpu_milliseconds = 0.0;
+    double gpu_milliseconds = 0.0;
+  };
+
+  struct LayerCacheEvent {
+    std::string name;
+    bool cached = false;
+    int exposures = 0;
+    int changes = 0;
+    int shapes = 0;
+  };
+
+  struct FrameProfile {
+    int frame = 0;
+    long long cpu_microseconds = 0;
+    double gpu_milliseconds = 0.0;
+    int num_views = 0;
+    int batch_submits = 0;
+    int region_batches = 0;
+    long long resource_bytes = 0;
+    std::vector<ProfileSample> samples;
+    std::vector<ViewProfile> views;
+    std::vector<LayerCacheEvent> cache_events;
+
+    long long sectionMicroseconds(const std::string& name) const {
+      long long total = 0;
+      for (const auto& sample : samples) {
+        if (sample.name == name)
+          total += sample.microseconds;
+      }
+      return total;
+    }
+  };
+
+  class FrameProfiler {
+  public:
+    static constexpr int kHistorySize = 240;
+
+    class ScopedSample {
+    public:
+      ScopedSample(FrameProfiler* profiler, const char* name, int index = -1) :
+          profiler_(profiler && profiler->enabled() ? profiler : nullptr), name_(name), index_(index) {
+        if (profiler_)
+          start_ = Clock::now();
+      }
+
+      ~ScopedSample() {
+        if (profiler_)
+          profiler_->addSample(name_, microsecondsSince(start_), index_);
+      }
+
+      ScopedSample(const ScopedSample&) = delete;
+      ScopedSample& operator=(const ScopedSample&) = delete;
+
+    private:
+      FrameProfiler* profiler_ = nullptr;
+      const char* name_ = nullptr;
+      int index_ = -1;
+      std::chrono::steady_clock::time_point start_;
+    };
+
+    void setEnabled(bool enabled);
+    bool enabled() const { return enabled_; }
+
+    void addSample(const char* name, long long microseconds, int index = -1) {
+      if (enabled_)
+        current_.samples.push_back({ name, index, microseconds });
+    }
+
+    void addBatchSubmits(int batch_submits, int region_batches) {
+      if (enabled_) {
+        current_.batch_submits += batch_submits;
+        current_.region_batches += region_batches;
+      }
+    }
+
+    void addCacheEvent(LayerCacheEvent event) {
+      if (enabled_)
+        current_.cache_events.push_back(std::move(event));
+    }
+
+    void beginFrame();
+    void endFrame(bool rendered, int num_views = 0);
+
+    const FrameProfile& lastFrame() const;
+    std::vector<FrameProfile> history() const;
+    int numFrames() const { return num_frames_; }
+    long long maxCpuMicroseconds() const;
+    void clear();
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    static long long microsecondsSince(Clock::time_point start) {
+      return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+    }
+
+    void readGpuStats(FrameProfile& profile) const;
+
+    bool enabled_ = false;
+    bool gpu_profiling_ = false;
+    bool frame_started_ = false;
+    int frame_ = 0;
+    int num_frames_ = 0;
+    int history_position_ = 0;
+    Clock::time_point frame_start_;
+    FrameProfile current_;
+    std::vector<FrameProfile> history_;
+  };
+}
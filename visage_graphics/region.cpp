@@ -24,12 +24,34 @@
 #include "canvas.h"
 
 namespace visage {
+  Region::~Region() {
+    ObjectPool<PackedBrush>& brush_pool = ObjectPool<PackedBrush>::instance();
+    for (auto* brushes : { &brushes_, &old_brushes_, &free_brushes_ }) {
+      for (auto& brush : *brushes) {
+        *brush = PackedBrush();
+        brush_pool.give(std::move(brush));
+      }
+    }
+
+    ObjectPool<Text>& text_pool = ObjectPool<Text>::instance();
+    for (auto& text : text_store_) {
+      *text = Text();
+      text_pool.give(std::move(text));
+    }
+  }
+
   void Region::removeRegion(Region* region) {
     region->clear();
     region->parent_ = nullptr;
     region->setCanvas(nullptr);
     region->setNeedsLayer(false);
-    sub_regions_.erase(std::find(sub_regions_.begin(), sub_regions_.end(), region));
+
+    int index = region->sub_region_index_;
+    VISAGE_ASSERT(index >= 0 && index < sub_regions_.size() && sub_regions_[index] == region);
+    sub_regions_.erase(sub_regions_.begin() + index);
+    for (int i = index; i < sub_regions_.size(); ++i)
+      sub_regions_[i]->sub_region_index_ = i;
+    region->sub_region_index_ = -1;
   }
 
   void Region::setCanvas(Canvas* canvas) {
@@ -66,11 +88,27 @@ namespace visage {
   }
 
   void Region::invalidateRect(IBounds rect) {
-    if (canvas_ == nullptr)
+    if (canvas_)
+      invalidateRectFrom(this, rect, layer_index_);
+  }
+
+  void Region::invalidateInParent() {
+    if (canvas_ == nullptr || parent_ == nullptr || width_ <= 0 || height_ <= 0)
       return;
 
-    int layer_index = layer_index_;
-    Region* region = this;
+    int layer_index = needsLayer() ? layer_index_ - 1 : layer_index_;
+    invalidateRectFrom(parent_, { x_, y_, width_, height_ }, layer_index);
+  }
+
+  void Region::moveLayer(int x, int y) {
+    invalidateInParent();
+    x_ = x;
+    y_ = y;
+    intermediate_region_->setBounds(x_, y_, width_, height_);
+    invalidateInParent();
+  }
+
+  void Region::invalidateRectFrom(Region* region, IBounds rect, int layer_index) {
     while (region->parent_) {
       if (region->needsLayer()) {
         canvas_->invalidateRectInRegion(rect, region, layer_index);
@@ -93,9 +131,13 @@ namespace visage {
 
   void Region::clear() {
     shape_batcher_.clear();
-    text_store_.clear();
+    num_texts_ = 0;
+    for (auto& brush : old_brushes_) {
+      *brush = PackedBrush();
+      free_brushes_.push_back(std::move(brush));
+    }
     old_brushes_.clear();
-    old_brushes_ = std::move(brushes_);
+    std::swap(old_brushes_, brushes_);
 
     if (backdrop_effect_) {
       Point point;
@@ -115,17 +157,29 @@ namespace visage {
   void Region::setupIntermediateRegion() {
     if (intermediate_region_) {
       intermediate_region_->setBounds(x_, y_, width_, height_);
-      intermediate_region_->clearAll();
-      const PackedBrush* brush = intermediate_region_->addBrush(canvas_->gradientAtlas(),
-                                                                Brush::solid(0xffffffff));
-
-      SampleRegion sample_region({ 0.0f, 0.0f, width_ * 1.0f, height_ * 1.0f }, brush, 0, 0, width_,
-                                 height_, this, post_effect_);
-      intermediate_region_->shape_batcher_.addShape(sample_region);
+      setupComposite();
       canvas_->changePackedLayer(this, layer_index_, layer_index_);
     }
   }
 
+  void Region::setupComposite() {
+    intermediate_region_->clearAll();
+    const PackedBrush* brush = intermediate_region_->addBrush(canvas_->gradientAtlas(),
+                                                              Brush::solid(0xffffffff));
+
+    float width = width_ * composite_scale_;
+    float height = height_ * composite_scale_;
+    SampleRegion sample_region({ 0.0f, 0.0f, width_ * 1.0f, height_ * 1.0f }, brush,
+                               0.5f * (width_ - width), 0.5f * (height_ - height), width, height,
+                               this, post_effect_);
+    // Faded regions get their own batch, since packed regions share a layer and alpha is set
+    // per batch.
+    sample_region.alpha = composite_alpha_;
+    if (composite_alpha_ != 1.0f && post_effect_ == nullptr)
+      sample_region.batch_id = this;
+    intermediate_region_->shape_batcher_.addShape(sample_region);
+  }
+
   void Region::setNeedsLayer(bool needs_layer) {
     if (needsLayer() == needs_layer || canvas_ == nullptr)
       return;
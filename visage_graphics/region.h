@@ -24,6 +24,8 @@
 #include "shape_batcher.h"
 #include "visage_utils/space.h"
 
+#include <atomic>
+
 namespace visage {
   class Palette;
   class Shader;
@@ -33,17 +35,22 @@ namespace visage {
     friend class Canvas;
 
     Region() = default;
+    Region(const Region&) = delete;
+    Region& operator=(const Region&) = delete;
+    ~Region();
 
     SubmitBatch* submitBatchAtPosition(int position) const {
       return shape_batcher_.batchAtIndex(position);
     }
     int numSubmitBatches() const { return shape_batcher_.numBatches(); }
     bool isEmpty() const { return shape_batcher_.isEmpty(); }
+    int numShapes() const { return shape_batcher_.numShapes(); }
     const std::vector<Region*>& subRegions() const { return sub_regions_; }
     int numRegions() const { return sub_regions_.size(); }
 
     void addRegion(Region* region) {
       VISAGE_ASSERT(region->parent_ == nullptr);
+      region->sub_region_index_ = sub_regions_.size();
       sub_regions_.push_back(region);
       region->parent_ = this;
 
@@ -57,6 +64,11 @@ namespace visage {
     void setCanvas(Canvas* canvas);
 
     void setBounds(int x, int y, int width, int height) {
+      if (width == width_ && height == height_ && canMoveLayer()) {
+        moveLayer(x, y);
+        return;
+      }
+
       invalidate();
       x_ = x;
       y_ = y;
@@ -76,6 +88,24 @@ namespace visage {
       invalidate();
     }
     bool isOnTop() const { return on_top_; }
+    // Opaque regions promise to cover their whole bounds, so siblings and the parent beneath them
+    // skip drawing there.
+    void setOpaque(bool opaque) {
+      opaque_ = opaque;
+      invalidate();
+    }
+    bool isOpaque() const { return opaque_; }
+    // Stencil clipped regions mark the first shape they draw, a rounded rectangle or path, in
+    // their layer's stencil buffer, and the rest of what they and their children draw stays
+    // inside it. Unlike a layer this costs no frame buffer, but the clip edge isn't antialiased.
+    void setStencilClip(bool stencil_clip) {
+      if (stencil_clip_ == stencil_clip)
+        return;
+
+      stencil_clip_ = stencil_clip;
+      invalidate();
+    }
+    bool stencilClip() const { return stencil_clip_; }
     bool overlaps(const Region* other) const {
       return x_ < other->x_ + other->width_ && x_ + width_ > other->x_ &&
              y_ < other->y_ + other->height_ && y_ + height_ > other->y_;
@@ -99,6 +129,8 @@ namespace visage {
     }
 
     void invalidateRect(IBounds rect);
+    // Invalidates where this region is drawn in its parent without touching its own layer.
+    void invalidateInParent();
 
     void invalidate() {
       if (width_ > 0 && height_ > 0)
@@ -117,6 +149,23 @@ namespace visage {
     }
     PostEffect* postEffect() const { return post_effect_; }
 
+    // How a layered region's texture is drawn into its parent: faded by _alpha_ and scaled by
+    // _scale_ around its center, within its bounds. Changing these recomposites the existing
+    // texture without drawing the region again. Post effects ignore them.
+    void setComposite(float alpha, float scale) {
+      if (alpha == composite_alpha_ && scale == composite_scale_)
+        return;
+
+      composite_alpha_ = alpha;
+      composite_scale_ = scale;
+      if (intermediate_region_) {
+        setupComposite();
+        invalidateInParent();
+      }
+    }
+    float compositeAlpha() const { return composite_alpha_; }
+    float compositeScale() const { return composite_scale_; }
+
     void setBackdropEffect(PostEffect* backdrop_effect);
     PostEffect* backdropEffect() const { return backdrop_effect_; }
 
@@ -124,29 +173,98 @@ namespace visage {
     Region* intermediateRegion() const { return intermediate_region_.get(); }
 
     const PackedBrush* addBrush(GradientAtlas* atlas, const Brush& brush) {
-      brushes_.push_back(std::make_unique<PackedBrush>(atlas, brush));
-      return brushes_.back().get();
+      return addBrush(atlas, brush.gradient(), brush.position());
     }
 
+    // Brushes are recycled from earlier frames, and from destroyed regions through the
+    // ObjectPool, so steady state drawing and rebuilt frames don't allocate.
     const PackedBrush* addBrush(GradientAtlas* atlas, const Gradient& gradient,
                                 const GradientPosition& position) {
-      brushes_.push_back(std::make_unique<PackedBrush>(atlas, gradient, position));
+      PackedBrush* brush = nextBrush();
+      *brush = PackedBrush(atlas, gradient, position);
+      return brush;
+    }
+
+    const PackedBrush* addBrush(GradientAtlas* atlas, GradientSlot& slot,
+                                const GradientPosition& position) {
+      PackedBrush* brush = nextBrush();
+      *brush = PackedBrush(atlas, slot, position);
+      return brush;
+    }
+
+    const PackedBrush* addPaletteBrush(GradientAtlas* atlas, const Brush& brush,
+                                       const Palette* palette, theme::OverrideId override_id,
+                                       theme::ColorId color_id, float scale) {
+      addBrush(atlas, brush.gradient(), brush.position() * scale);
+      brushes_.back()->bindPaletteColor(palette, override_id, color_id);
       return brushes_.back().get();
     }
 
     Region* parent() const { return parent_; }
 
+#ifndef NDEBUG
+    // How often any region's brush or text arena had to grow. Redrawing an unchanged region
+    // should leave this alone.
+    static int arenaAllocations() { return arenaAllocationCount(); }
+#endif
+
+    void setPersistentVertexBuffers(bool persistent) {
+      shape_batcher_.setPersistentVertexBuffers(persistent);
+    }
+
   private:
+    // A layered region without backdrops underneath can move by re-compositing its layer.
+    bool canMoveLayer() const {
+      return needsLayer() && backdrop_effect_ == nullptr &&
+             backdrop_count_children_ == backdrop_count_;
+    }
+    void moveLayer(int x, int y);
+    void invalidateRectFrom(Region* region, IBounds rect, int layer_index);
+
     void setLayerIndex(int layer_index);
     void incrementLayer() { setLayerIndex(layer_index_ + 1); }
     void decrementLayer() { setLayerIndex(layer_index_ - 1); }
 
+    // Texts stay with the region between frames and are reset in place, so redrawing a label
+    // doesn't allocate.
     Text* addText(const String& string, const Font& font, Font::Justification justification) {
-      text_store_.push_back(std::make_unique<Text>(string, font, justification));
-      return text_store_.back().get();
+      if (num_texts_ == text_store_.size()) {
+        text_store_.push_back(ObjectPool<Text>::instance().take());
+        countArenaAllocation();
+      }
+      Text* text = text_store_[num_texts_++].get();
+      text->reset(string, font, justification);
+      return text;
     }
 
-    void clearSubRegions() { sub_regions_.clear(); }
+    PackedBrush* nextBrush() {
+      if (free_brushes_.empty()) {
+        brushes_.push_back(ObjectPool<PackedBrush>::instance().take());
+        countArenaAllocation();
+      }
+      else {
+        brushes_.push_back(std::move(free_brushes_.back()));
+        free_brushes_.pop_back();
+      }
+      return brushes_.back().get();
+    }
+
+#ifndef NDEBUG
+    static std::atomic<int>& arenaAllocationCount() {
+      static std::atomic<int> count = 0;
+      return count;
+    }
+    static void countArenaAllocation() { arenaAllocationCount()++; }
+#else
+    static void countArenaAllocation() { }
+#endif
+
+    void setupComposite();
+    void clearSubRegions() {
+      for (Region* sub_region : sub_regions_)
+        sub_region->sub_region_index_ = -1;
+      sub_regions_.clear();
+    }
 
     void clearAll() {
       clear();
@@ -160,18 +278,25 @@ namespace visage {
     int palette_override_ = 0;
     bool visible_ = true;
     bool on_top_ = false;
+    bool opaque_ = false;
+    bool stencil_clip_ = false;
+    float composite_alpha_ = 1.0f;
+    float composite_scale_ = 1.0f;
     int layer_index_ = 0;
     int backdrop_count_ = 0;
     int backdrop_count_children_ = 0;
 
     Canvas* canvas_ = nullptr;
     Region* parent_ = nullptr;
+    int sub_region_index_ = -1;
     PostEffect* post_effect_ = nullptr;
     PostEffect* backdrop_effect_ = nullptr;
     ShapeBatcher shape_batcher_;
     std::vector<std::unique_ptr<PackedBrush>> brushes_;
     std::vector<std::unique_ptr<PackedBrush>> old_brushes_;
+    std::vector<std::unique_ptr<PackedBrush>> free_brushes_;
     std::vector<std::unique_ptr<Text>> text_store_;
+    int num_texts_ = 0;
     std::vector<Region*> sub_regions_;
     std::unique_ptr<Region> intermediate_region_;
   };
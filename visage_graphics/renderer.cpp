@@ -21,13 +21,16 @@
 
 #include "renderer.h"
 
+#include "visage_utils/file_system.h"
 #include "visage_utils/string_utils.h"
 
+#include <algorithm>
 #include <bgfx/bgfx.h>
 #include <bgfx/platform.h>
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 
 namespace {
   bool visageDebugEnabled() {
@@ -52,6 +55,21 @@ namespace {
 
 namespace visage {
   class GraphicsCallbackHandler : public bgfx::CallbackI {
+  public:
+    // bgfx hands us program binaries keyed by a hash of the shaders. Binaries are only valid for
+    // the renderer that produced them so each renderer gets its own folder.
+    void setCacheDirectory(const File& directory, const char* renderer_name) {
+      if (!directory.empty())
+        cache_directory_ = directory / renderer_name;
+    }
+
+  private:
+    File cacheFile(uint64_t id) const {
+      char name[32];
+      std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(id));
+      return cache_directory_ / name;
+    }
+
     void fatal(const char* file_path, uint16_t line, bgfx::Fatal::Enum _code, const char* error) override {
       VISAGE_LOG(String(file_path) + String(" (") + line + String(") "));
       VISAGE_LOG(error);
@@ -68,9 +86,38 @@ namespace visage {
     void profilerBegin(const char*, uint32_t, const char*, uint16_t) override { }
     void profilerBeginLiteral(const char*, uint32_t, const char*, uint16_t) override { }
     void profilerEnd() override { }
-    uint32_t cacheReadSize(uint64_t) override { return 0; }
-    bool cacheRead(uint64_t, void*, uint32_t) override { return false; }
-    void cacheWrite(uint64_t, const void*, uint32_t) override { }
+
+    uint32_t cacheReadSize(uint64_t id) override {
+      if (cache_directory_.empty())
+        return 0;
+
+      std::error_code error;
+      uintmax_t size = std::filesystem::file_size(cacheFile(id), error);
+      return error ? 0 : static_cast<uint32_t>(size);
+    }
+
+    bool cacheRead(uint64_t id, void* data, uint32_t size) override {
+      if (cache_directory_.empty())
+        return false;
+
+      size_t file_size = 0;
+      std::unique_ptr<unsigned char[]> file_data = loadFileData(cacheFile(id), file_size);
+      if (file_data == nullptr || file_size != size)
+        return false;
+
+      std::memcpy(data, file_data.get(), size);
+      return true;
+    }
+
+    void cacheWrite(uint64_t id, const void* data, uint32_t size) override {
+      if (cache_directory_.empty())
+        return;
+
+      std::error_code error;
+      std::filesystem::create_directories(cache_directory_, error);
+      if (!error)
+        replaceFileWithData(cacheFile(id), static_cast<const unsigned char*>(data), size);
+    }
 
     void screenShot(const char* file_path, uint32_t width, uint32_t height, uint32_t pitch,
                     const void* data, uint32_t size, bool y_flip) override {
@@ -80,9 +127,31 @@ namespace visage {
     void captureBegin(uint32_t, uint32_t, uint32_t, bgfx::TextureFormat::Enum, bool) override { }
     void captureEnd() override { }
     void captureFrame(const void*, uint32_t) override { }
+
+    File cache_directory_;
   };
 
-  static constexpr uint32_t resetFlags() {
+  static File defaultShaderCacheDirectory() {
+#if VISAGE_WINDOWS
+    const char* local_app_data = std::getenv("LOCALAPPDATA");
+    if (local_app_data && *local_app_data)
+      return File(local_app_data) / "Visage" / "ShaderCache";
+#elif VISAGE_MAC
+    const char* home = std::getenv("HOME");
+    if (home && *home)
+      return File(home) / "Library" / "Caches" / "Visage" / "ShaderCache";
+#elif VISAGE_LINUX
+    const char* cache_home = std::getenv("XDG_CACHE_HOME");
+    if (cache_home && *cache_home)
+      return File(cache_home) / "visage" / "shader_cache";
+    const char* home = std::getenv("HOME");
+    if (home && *home)
+      return File(home) / ".cache" / "visage" / "shader_cache";
+#endif
+    return {};
+  }
+
+  static constexpr uint32_t platformResetFlags() {
 #if VISAGE_WINDOWS
     return BGFX_RESET_FLIP_AFTER_RENDER;
 #elif VISAGE_MAC
@@ -94,12 +163,44 @@ namespace visage {
 #endif
   }
 
+  uint32_t Renderer::resetFlags() const {
+    uint32_t flags = platformResetFlags();
+    if (low_latency_)
+      flags |= BGFX_RESET_FLIP_AFTER_RENDER | BGFX_RESET_FLUSH_AFTER_RENDER;
+    return flags;
+  }
+
+  static constexpr const char* kLastRendererFile = "last_renderer.txt";
+  static constexpr double kNanosecondsToMilliseconds = 1.0e-6;
+
+  static bgfx::RendererType::Enum platformRendererType(const bgfx::RendererType::Enum* supported,
+                                                      int num_supported) {
+#if VISAGE_WINDOWS
+#if USE_DIRECTX12
+    for (int i = 0; i < num_supported; ++i) {
+      if (supported[i] == bgfx::RendererType::Direct3D12)
+        return bgfx::RendererType::Direct3D12;
+    }
+#endif
+    return bgfx::RendererType::Direct3D11;
+#elif VISAGE_MAC
+    return bgfx::RendererType::Metal;
+#elif VISAGE_LINUX
+    return bgfx::RendererType::Vulkan;
+#elif VISAGE_EMSCRIPTEN
+    return bgfx::RendererType::OpenGLES;
+#else
+    return num_supported ? supported[0] : bgfx::RendererType::Noop;
+#endif
+  }
+
   Renderer& Renderer::instance() {
     static Renderer renderer;
     return renderer;
   }
 
-  Renderer::Renderer() : Thread("Renderer Thread") { }
+  Renderer::Renderer() :
+      Thread("Renderer Thread"), shader_cache_directory_(defaultShaderCacheDirectory()) { }
 
   Renderer::~Renderer() {
     stop();
@@ -129,11 +230,13 @@ namespace visage {
     if (initialized_)
       return;
 
+    uint64_t start = time::nanoseconds();
     if (visageDebugEnabled())
       visageDebugLog("renderer", "initialize window=%p display=%p", model_window, display);
 
     callback_handler_ = std::make_unique<GraphicsCallbackHandler>();
     initialized_ = true;
+    api_thread_ = std::this_thread::get_id();
     startRenderThread();
 
     bgfx::Init bgfx_init;
@@ -145,6 +248,9 @@ namespace visage {
     bgfx_init.platformData.ndt = display;
     bgfx_init.platformData.nwh = model_window;
     bgfx_init.platformData.type = bgfx::NativeWindowHandleType::Default;
+#if VISAGE_LINUX && VISAGE_WAYLAND
+    bgfx_init.platformData.type = bgfx::NativeWindowHandleType::Wayland;
+#endif
 
     bgfx::RendererType::Enum supported_renderers[bgfx::RendererType::Count];
     uint8_t num_supported = bgfx::getSupportedRenderers(bgfx::RendererType::Count, supported_renderers);
@@ -154,50 +260,93 @@ namespace visage {
       }
     }
 
-#if VISAGE_WINDOWS
-    bgfx_init.type = bgfx::RendererType::Direct3D11;
-#if USE_DIRECTX12
-    for (int i = 0; i < num_supported; ++i) {
-      if (supported_renderers[i] == bgfx::RendererType::Direct3D12)
-        bgfx_init.type = bgfx::RendererType::Direct3D12;
-    }
-#endif
-#elif VISAGE_MAC
-    bgfx_init.type = bgfx::RendererType::Metal;
+#if VISAGE_MAC
     bgfx_init.resolution.width = 1;
     bgfx_init.resolution.height = 1;
-#elif VISAGE_LINUX
-    bgfx_init.type = bgfx::RendererType::Vulkan;
-#elif VISAGE_EMSCRIPTEN
-    bgfx_init.type = bgfx::RendererType::OpenGLES;
 #endif
-
     bgfx_init.resolution.reset = resetFlags();
 
-    for (int i = 0; i < num_supported && !supported_; ++i)
-      supported_ = supported_renderers[i] == bgfx_init.type;
+    std::vector<bgfx::RendererType::Enum> candidates;
+    auto add_candidate = [&](const std::string& name) {
+      for (int i = 0; i < num_supported; ++i) {
+        bgfx::RendererType::Enum type = supported_renderers[i];
+        if (name == bgfx::getRendererName(type) &&
+            std::find(candidates.begin(), candidates.end(), type) == candidates.end())
+          candidates.push_back(type);
+      }
+    };
+
+    if (noop_renderer_)
+      candidates.push_back(bgfx::RendererType::Noop);
+    else {
+      if (!preferred_renderer_.empty())
+        add_candidate(preferred_renderer_);
+      if (!shader_cache_directory_.empty())
+        add_candidate(loadFileAsString(shader_cache_directory_ / kLastRendererFile));
+      add_candidate(bgfx::getRendererName(platformRendererType(supported_renderers, num_supported)));
+    }
+
+    uint64_t probed = time::nanoseconds();
+    startup_timings_.probe_ms = (probed - start) * kNanosecondsToMilliseconds;
+
+    for (bgfx::RendererType::Enum type : candidates) {
+      bgfx_init.type = type;
+      callback_handler_->setCacheDirectory(shader_cache_directory_, bgfx::getRendererName(type));
+      supported_ = bgfx::init(bgfx_init);
+      if (supported_)
+        break;
+
+      if (visageDebugEnabled())
+        visageDebugLog("renderer", "init failed=%s", bgfx::getRendererName(type));
+    }
+
+    if (!supported_ && !noop_renderer_) {
+      bgfx_init.type = bgfx::RendererType::Count;
+      supported_ = bgfx::init(bgfx_init);
+      if (supported_)
+        callback_handler_->setCacheDirectory(shader_cache_directory_,
+                                             bgfx::getRendererName(bgfx::getRendererType()));
+    }
+
+    uint64_t initialized = time::nanoseconds();
+    startup_timings_.init_ms = (initialized - probed) * kNanosecondsToMilliseconds;
+    startup_timings_.total_ms = (initialized - start) * kNanosecondsToMilliseconds;
 
     if (!supported_) {
       VISAGE_ASSERT(false);
-      std::string renderer_name = bgfx::getRendererName(bgfx_init.type);
-      error_message_ = renderer_name + " is required and not supported on this computer.";
+      error_message_ = "No graphics renderer could be initialized on this computer.";
+      return;
     }
 
-    bgfx::init(bgfx_init);
-    VISAGE_ASSERT(bgfx::getRendererType() == bgfx_init.type);
+    renderer_name_ = bgfx::getRendererName(bgfx::getRendererType());
+    if (!noop_renderer_ && !shader_cache_directory_.empty() &&
+        loadFileAsString(shader_cache_directory_ / kLastRendererFile) != renderer_name_) {
+      std::error_code error;
+      std::filesystem::create_directories(shader_cache_directory_, error);
+      if (!error)
+        replaceFileWithText(shader_cache_directory_ / kLastRendererFile, renderer_name_);
+    }
     swap_chain_supported_ = bgfx::getCaps()->supported & BGFX_CAPS_SWAP_CHAIN;
 
     if (visageDebugEnabled()) {
       visageDebugLog("renderer",
-                     "active=%s swap_chain=%d",
-                     bgfx::getRendererName(bgfx::getRendererType()),
-                     swap_chain_supported_ ? 1 : 0);
+                     "active=%s swap_chain=%d probe=%.2fms init=%.2fms",
+                     renderer_name_.c_str(),
+                     swap_chain_supported_ ? 1 : 0,
+                     startup_timings_.probe_ms,
+                     startup_timings_.init_ms);
     }
   }
 
+  uint32_t Renderer::frame() {
+    VISAGE_ASSERT(onApiThread());
+    frames_submitted_++;
+    return bgfx::frame();
+  }
+
   void Renderer::resetResolution(int width, int height) {
 #if VISAGE_MAC
-    bgfx::reset(width, height, resetFlags());
+    bgfx::reset(width, height, instance().resetFlags());
     if (visageDebugEnabled())
       visageDebugLog("renderer", "resetResolution %dx%d", width, height);
 #endif
@@ -22,6 +22,7 @@
 #pragma once
 
 #include "screenshot.h"
+#include "visage_utils/file_system.h"
 #include "visage_utils/thread_utils.h"
 #include "windowless_context.h"
 
@@ -39,7 +40,56 @@ namespace visage {
 
     void initializeWindowless() { initialize(windowlessContext(), nullptr); }
     void initialize(void* model_window, void* display);
+    // Ends recording of the current frame. Must be called from the thread that initialized the
+    // renderer. With VISAGE_BACKGROUND_GRAPHICS_THREAD the render thread takes ownership of the
+    // finished command buffer and renders it while the caller records the next frame, so
+    // nothing may touch the previous frame's bgfx data after this returns. That split inside
+    // bgfx is the only pipelining: regions are still encoded on the calling thread without
+    // encoders, and Canvas still submits the first rendered frame twice.
+    uint32_t frame();
+    bool onApiThread() const { return std::this_thread::get_id() == api_thread_; }
+    uint64_t framesSubmitted() const { return frames_submitted_; }
     void setScreenshotData(const uint8_t* data, int width, int height, int pitch, bool blue_red);
+
+    // Where compiled shader programs are cached between launches. Must be set before initialize,
+    // an empty path disables the cache.
+    void setShaderCacheDirectory(const File& directory) {
+      VISAGE_ASSERT(!initialized_);
+      shader_cache_directory_ = directory;
+    }
+    const File& shaderCacheDirectory() const { return shader_cache_directory_; }
+    // Flips and flushes right after rendering instead of queueing a frame ahead, for lower
+    // input-to-photon latency. Must be set before initialize.
+    void setLowLatency(bool low_latency) {
+      VISAGE_ASSERT(!initialized_);
+      low_latency_ = low_latency;
+    }
+    bool lowLatency() const { return low_latency_; }
+    // Renderer to try first, by its bgfx name such as "Vulkan" or "Direct3D 12". After that comes
+    // the last renderer that initialized, remembered in the shader cache directory, then the
+    // platform default. Must be set before initialize.
+    void setPreferredRenderer(const std::string& name) {
+      VISAGE_ASSERT(!initialized_);
+      preferred_renderer_ = name;
+    }
+    const std::string& preferredRenderer() const { return preferred_renderer_; }
+    // Initializes bgfx's Noop renderer instead of a real one. Canvases still submit and record
+    // frame statistics but nothing reaches a GPU and screenshots stay empty, which lets tests of
+    // frame and batching logic run fast and in parallel on machines without one. Must be set
+    // before initialize.
+    void setNoopRenderer(bool noop) {
+      VISAGE_ASSERT(!initialized_);
+      noop_renderer_ = noop;
+    }
+    bool noopRenderer() const { return noop_renderer_; }
+    const std::string& rendererName() const { return renderer_name_; }
+
+    struct StartupTimings {
+      double probe_ms = 0.0;
+      double init_ms = 0.0;
+      double total_ms = 0.0;
+    };
+    const StartupTimings& startupTimings() const { return startup_timings_; }
     const Screenshot& screenshot() const { return screenshot_; }
 
     const std::string& errorMessage() const { return error_message_; }
@@ -51,12 +101,21 @@ namespace visage {
     void startRenderThread();
     void render();
     void run() override;
+    uint32_t resetFlags() const;
 
     bool initialized_ = false;
+    bool low_latency_ = false;
+    bool noop_renderer_ = false;
     bool supported_ = false;
     bool swap_chain_supported_ = false;
+    std::thread::id api_thread_;
+    uint64_t frames_submitted_ = 0;
 
     Screenshot screenshot_;
+    File shader_cache_directory_;
+    std::string preferred_renderer_;
+    std::string renderer_name_;
+    StartupTimings startup_timings_;
     std::string error_message_;
     std::atomic<bool> render_thread_started_ = false;
     std::unique_ptr<GraphicsCallbackHandler> callback_handler_;
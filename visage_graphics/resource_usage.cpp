@@ -0,0 +1,106 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "resource_usage.h"
+
+#include <atomic>
+#include <bgfx/bgfx.h>
+
+namespace visage {
+  struct ResourceCounter {
+    std::atomic<long long> bytes { 0 };
+    std::atomic<long long> peak_bytes { 0 };
+    std::atomic<int> handles { 0 };
+    std::atomic<int> peak_handles { 0 };
+
+    ResourceUsage usage() const {
+      return { bytes.load(), peak_bytes.load(), handles.load(), peak_handles.load() };
+    }
+  };
+
+  // One counter per category followed by the total across all of them.
+  static ResourceCounter* counters() {
+    static ResourceCounter counters[ResourceTracker::kNumCategories + 1];
+    return counters;
+  }
+
+  static ResourceCounter& totalCounter() {
+    return counters()[ResourceTracker::kNumCategories];
+  }
+
+  template<typename T>
+  static void raisePeak(std::atomic<T>& peak, T value) {
+    T current = peak.load();
+    while (value > current && !peak.compare_exchange_weak(current, value)) { }
+  }
+
+  static void addToCounter(ResourceCounter& counter, long long bytes, int handles) {
+    raisePeak(counter.peak_bytes, counter.bytes.fetch_add(bytes) + bytes);
+    raisePeak(counter.peak_handles, counter.handles.fetch_add(handles) + handles);
+  }
+
+  void ResourceTracker::add(ResourceCategory category, long long bytes) {
+    addToCounter(counters()[static_cast<int>(category)], bytes, 1);
+    addToCounter(totalCounter(), bytes, 1);
+  }
+
+  void ResourceTracker::remove(ResourceCategory category, long long bytes) {
+    addToCounter(counters()[static_cast<int>(category)], -bytes, -1);
+    addToCounter(totalCounter(), -bytes, -1);
+  }
+
+  ResourceUsage ResourceTracker::usage(ResourceCategory category) {
+    return counters()[static_cast<int>(category)].usage();
+  }
+
+  ResourceUsage ResourceTracker::total() {
+    return totalCounter().usage();
+  }
+
+  void ResourceTracker::resetPeaks() {
+    for (int i = 0; i <= kNumCategories; ++i) {
+      ResourceCounter& counter = counters()[i];
+      counter.peak_bytes = counter.bytes.load();
+      counter.peak_handles = counter.handles.load();
+    }
+  }
+
+  const char* ResourceTracker::name(ResourceCategory category) {
+    switch (category) {
+    case ResourceCategory::LayerFrameBuffers: return "Layers";
+    case ResourceCategory::ReadBackTextures: return "Read backs";
+    case ResourceCategory::ImageAtlas: return "Images";
+    case ResourceCategory::GradientAtlas: return "Gradients";
+    case ResourceCategory::PathAtlas: return "Paths";
+    case ResourceCategory::FontAtlas: return "Fonts";
+    case ResourceCategory::EffectFrameBuffers: return "Effects";
+    case ResourceCategory::ShapeBuffers: return "Shape buffers";
+    default: return "";
+    }
+  }
+
+  long long ResourceTracker::textureBytes(int width, int height, int format, bool mipmapped) {
+    bgfx::TextureInfo info;
+    bgfx::calcTextureSize(info, width, height, 1, false, mipmapped, 1,
+                          static_cast<bgfx::TextureFormat::Enum>(format));
+    return info.storageSize;
+  }
+}
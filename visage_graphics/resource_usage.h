@@ -0,0 +1,91 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+namespace visage {
+  enum class ResourceCategory {
+    LayerFrameBuffers,
+    ReadBackTextures,
+    ImageAtlas,
+    GradientAtlas,
+    PathAtlas,
+    FontAtlas,
+    EffectFrameBuffers,
+    ShapeBuffers,
+    kNumCategories
+  };
+
+  struct ResourceUsage {
+    long long bytes = 0;
+    long long peak_bytes = 0;
+    int handles = 0;
+    int peak_handles = 0;
+  };
+
+  // Process wide counts of the GPU memory visage allocates, by category, so a host running many
+  // editors can watch and budget it. Peaks are kept until resetPeaks().
+  class ResourceTracker {
+  public:
+    static constexpr int kNumCategories = static_cast<int>(ResourceCategory::kNumCategories);
+
+    static void add(ResourceCategory category, long long bytes);
+    static void remove(ResourceCategory category, long long bytes);
+
+    static ResourceUsage usage(ResourceCategory category);
+    static ResourceUsage total();
+    static void resetPeaks();
+    static const char* name(ResourceCategory category);
+
+    static long long textureBytes(int width, int height, int format, bool mipmapped = false);
+  };
+
+  // Counts one allocation with the ResourceTracker for as long as it's held.
+  class TrackedResource {
+  public:
+    TrackedResource() = default;
+    TrackedResource(const TrackedResource&) = delete;
+    TrackedResource& operator=(const TrackedResource&) = delete;
+    ~TrackedResource() { reset(); }
+
+    void reset(ResourceCategory category, long long bytes) {
+      reset();
+      category_ = category;
+      bytes_ = bytes;
+      tracked_ = true;
+      ResourceTracker::add(category_, bytes_);
+    }
+
+    void reset() {
+      if (tracked_)
+        ResourceTracker::remove(category_, bytes_);
+      tracked_ = false;
+      bytes_ = 0;
+    }
+
+    long long bytes() const { return bytes_; }
+
+  private:
+    ResourceCategory category_ = ResourceCategory::LayerFrameBuffers;
+    long long bytes_ = 0;
+    bool tracked_ = false;
+  };
+}
@@ -25,17 +25,38 @@
 #include <bx/file.h>
 
 namespace visage {
-  void Screenshot::save(const char* path) const {
+  bool Screenshot::writePng(const char* path, const uint8_t* data, int width, int height) {
     bx::FileWriter writer;
     bx::Error error;
-    if (bx::open(&writer, path, false, &error)) {
-      bimg::imageWritePng(&writer, width_, height_, width_ * 4, data_.data(),
-                          bimg::TextureFormat::RGBA8, false, &error);
-      bx::close(&writer);
-    }
+    if (!bx::open(&writer, path, false, &error))
+      return false;
+
+    bimg::imageWritePng(&writer, width, height, width * 4, data, bimg::TextureFormat::RGBA8, false,
+                        &error);
+    bx::close(&writer);
+    return error.isOk();
+  }
+
+  void Screenshot::save(const char* path) const {
+    writePng(path, data_.data(), width_, height_);
   }
 
   void Screenshot::save(const std::string& path) const {
     save(path.c_str());
   }
+
+  TaskFuture<bool> Screenshot::saveAsync(std::string path) {
+    std::vector<uint8_t> pixels = std::move(data_);
+    int width = width_;
+    int height = height_;
+    data_.clear();
+    width_ = 0;
+    height_ = 0;
+
+    return ThreadPool::shared().submit(
+        [pixels = std::move(pixels), path = std::move(path), width, height] {
+          return writePng(path.c_str(), pixels.data(), width, height);
+        },
+        TaskPriority::Background);
+  }
 }
\ No newline at end of file
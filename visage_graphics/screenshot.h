@@ -22,6 +22,7 @@
 #pragma once
 
 #include "visage_utils/space.h"
+#include "visage_utils/thread_utils.h"
 
 #include <cstdint>
 #include <string>
@@ -60,6 +61,10 @@ namespace visage {
 
     void save(const char* path) const;
     void save(const std::string& path) const;
+    // Encodes and writes the PNG on the shared thread pool so capturing every frame doesn't
+    // stall drawing. The pixels move into the job without a copy, which leaves this screenshot
+    // empty. The future holds whether the file was written.
+    TaskFuture<bool> saveAsync(std::string path);
 
     void setDimensions(int width, int height) {
       width_ = width;
@@ -84,6 +89,8 @@ namespace visage {
     Color sample(Point point) const { return sample(point.x, point.y); }
 
   private:
+    static bool writePng(const char* path, const uint8_t* data, int width, int height);
+
     void flipBlueRed() {
       for (int i = 0; i < width_ * height_ * 4; i += 4) {
         uint8_t temp = data_[i];
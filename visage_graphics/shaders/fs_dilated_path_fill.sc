@@ -0,0 +1,17 @@
+$input v_shader_values, v_shader_values1, v_edge_distances, v_bound_distances
+
+#include <shader_include.sh>
+
+void main() {
+  float edge_distance = min(min(v_edge_distances.x, v_edge_distances.y), v_edge_distances.z);
+  float bound_distance = min(min(v_bound_distances.x, v_bound_distances.y),
+                             min(v_bound_distances.z, v_bound_distances.w));
+  float overlap = min(edge_distance, bound_distance) < 0.0 ? 0.0 : 1.0;
+
+  float mult = gl_FrontFacing ? -1.0 : 1.0;
+  vec3 delta = clamp(mult * v_shader_values.xyz + vec3(0.5, 0.5, 0.5), 0.0, 1.0);
+  float outer_amount = clamp((abs(v_shader_values.w - 0.5) - 0.5) / fwidth(v_shader_values.w), 0.0, 1.0);
+  float outer_alpha = delta.z * (1.0 - outer_amount) + outer_amount;
+  float point_alpha = v_shader_values1.y < gl_FragCoord.y + 1.0 ? 0.0 : 1.0;
+  gl_FragColor.r = mult * (delta.y - delta.x) * outer_alpha * point_alpha * overlap;
+}
@@ -16,5 +16,8 @@ void main() {
   y = v_shader_values.x * y;
   vec2 texture_position = (v_shader_values.zw + vec2(0.0, y)) * u_atlas_scale.xy;
   float value = texture2D(s_texture, texture_position).r;
+  if (v_gradient_pos.x != 0.0)
+    value = 6.0206 * log2(max(value, 0.000001));
+  value = (value - v_gradient_pos.y) * v_gradient_pos.z;
   gl_FragColor = sampleGradient(s_gradient, v_gradient_texture_pos.xy, v_gradient_texture_pos.zw, clamp(value, 0.0, 1.0));
 }
@@ -0,0 +1,20 @@
+$input v_coordinates, v_dimensions, v_shader_values, v_position, v_gradient_pos, v_gradient_pos2, v_gradient_texture_pos
+
+#include <shader_include.sh>
+
+SAMPLER2D(s_gradient, 0);
+
+vec3 hueColor(float hue) {
+  return clamp(abs(mod(vec3(hue, hue, hue) * 6.0 + vec3(0.0, 4.0, 2.0), vec3(6.0, 6.0, 6.0)) - 3.0) - 1.0, 0.0, 1.0);
+}
+
+void main() {
+  gl_FragColor = gradient(s_gradient, v_gradient_texture_pos, v_gradient_pos, v_gradient_pos2, v_position);
+  vec2 percent = clamp(v_coordinates * 0.5 + vec2(0.5, 0.5), 0.0, 1.0);
+  vec3 color = hueColor(percent.y);
+  if (v_shader_values.z >= 0.0)
+    color = (vec3(1.0, 1.0, 1.0) + percent.x * (hueColor(v_shader_values.z) - 1.0)) * (1.0 - percent.y);
+
+  gl_FragColor.rgb = gl_FragColor.rgb * color;
+  gl_FragColor.a = gl_FragColor.a * rectangle(v_coordinates, v_dimensions, v_shader_values.x, v_shader_values.y);
+}
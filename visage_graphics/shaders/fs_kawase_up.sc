@@ -0,0 +1,20 @@
+$input v_coordinates
+
+#include <shader_include.sh>
+
+SAMPLER2D(s_texture, 0);
+
+uniform vec4 u_pixel_size;
+
+void main() {
+  vec2 offset = u_pixel_size.xy;
+  vec4 c = texture2D(s_texture, v_coordinates + vec2(-2.0 * offset.x, 0.0)) +
+           texture2D(s_texture, v_coordinates + vec2(2.0 * offset.x, 0.0)) +
+           texture2D(s_texture, v_coordinates + vec2(0.0, -2.0 * offset.y)) +
+           texture2D(s_texture, v_coordinates + vec2(0.0, 2.0 * offset.y)) +
+           texture2D(s_texture, v_coordinates + vec2(-offset.x, -offset.y)) * 2.0 +
+           texture2D(s_texture, v_coordinates + vec2(offset.x, -offset.y)) * 2.0 +
+           texture2D(s_texture, v_coordinates + vec2(-offset.x, offset.y)) * 2.0 +
+           texture2D(s_texture, v_coordinates + vec2(offset.x, offset.y)) * 2.0;
+  gl_FragColor = c * (1.0 / 12.0);
+}
@@ -0,0 +1,28 @@
+$input v_coordinates, v_dimensions, v_shader_values, v_shader_values1, v_shape_type, v_position, v_gradient_pos, v_gradient_pos2, v_gradient_texture_pos
+
+#include <shader_include.sh>
+
+SAMPLER2D(s_gradient, 0);
+
+float primitiveAlpha(float type) {
+  float thickness = v_shader_values.x;
+  float fade = v_shader_values.y;
+  if (type < 0.5)
+    return rectangle(v_coordinates, v_dimensions, thickness, fade);
+  if (type < 1.5)
+    return roundedRectangle(v_coordinates, v_dimensions, 2.0 * v_shader_values.z, thickness, fade);
+  if (type < 2.5)
+    return circle(v_coordinates, v_dimensions.x, thickness, fade);
+  if (type < 3.5)
+    return squircle(v_coordinates, v_dimensions, v_shader_values.z, thickness, fade);
+  if (type < 4.5)
+    return roundedDiamond(v_coordinates, v_dimensions, 2.0 * v_shader_values.z, thickness, fade);
+  if (type < 5.5)
+    return flatArc(v_coordinates, v_shader_values1.xy, v_shader_values1.zw, v_dimensions.x, thickness, fade);
+  return arc(v_coordinates, v_shader_values1.xy, v_shader_values1.zw, v_dimensions.x, thickness, fade);
+}
+
+void main() {
+  gl_FragColor = gradient(s_gradient, v_gradient_texture_pos, v_gradient_pos, v_gradient_pos2, v_position);
+  gl_FragColor.a = gl_FragColor.a * primitiveAlpha(v_shape_type);
+}
@@ -0,0 +1,15 @@
+$input v_coordinates, v_position, v_dimensions, v_gradient_pos, v_gradient_pos2, v_gradient_texture_pos
+
+#include <shader_include.sh>
+
+SAMPLER2D(s_texture, 1);
+
+void main() {
+  float coverage = abs(texture2D(s_texture, v_coordinates).r);
+  float t = mod(coverage, 2.0);
+  float alpha = v_dimensions.x * (1.0 - abs(t - 1.0)) + (1.0 - v_dimensions.x) * clamp(coverage, 0.0, 1.0);
+  if (alpha < 0.5)
+    discard;
+
+  gl_FragColor = vec4(1.0, 1.0, 1.0, 1.0);
+}
@@ -0,0 +1,11 @@
+$input v_coordinates, v_dimensions, v_shader_values, v_position, v_gradient_pos, v_gradient_pos2, v_gradient_texture_pos
+
+#include <shader_include.sh>
+
+void main() {
+  float alpha = roundedRectangle(v_coordinates, v_dimensions, 2.0 * v_shader_values.z, v_shader_values.x, v_shader_values.y);
+  if (alpha < 0.5)
+    discard;
+
+  gl_FragColor = vec4(1.0, 1.0, 1.0, 1.0);
+}
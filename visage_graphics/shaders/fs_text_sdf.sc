@@ -0,0 +1,16 @@
+$input v_coordinates, v_position, v_gradient_pos, v_gradient_pos2, v_gradient_texture_pos
+
+#include <shader_include.sh>
+
+SAMPLER2D(s_gradient, 0);
+SAMPLER2D(s_texture, 1);
+SAMPLER2D(s_texture2, 2);
+
+void main() {
+  vec4 color = gradient(s_gradient, v_gradient_texture_pos, v_gradient_pos, v_gradient_pos2, v_position);
+  float distance = texture2D(s_texture, v_coordinates).r;
+  float smoothing = max(0.7 * fwidth(distance), 0.001);
+  float coverage = smoothstep(0.5 - smoothing, 0.5 + smoothing, distance);
+  vec4 emoji = texture2D(s_texture2, v_coordinates - vec2(2.0, 0.0));
+  gl_FragColor = color * mix(vec4(1.0, 1.0, 1.0, coverage), emoji, step(1.5, v_coordinates.x));
+}
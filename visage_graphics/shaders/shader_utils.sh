@@ -57,6 +57,8 @@ uniform vec4 u_radial_gradient;
 uniform vec4 u_color_mult;
 
 vec4 sampleGradient(sampler2D gradient_texture, vec2 texture_pos1, vec2 texture_pos2, float t) {
+  if (texture_pos1.x < 0.0)
+    return u_color_mult * (vec4(-1.0, -1.0, -1.0, -1.0) - vec4(texture_pos1, texture_pos2));
   return u_color_mult * texture2D(gradient_texture, mix(texture_pos1, texture_pos2, t));
 }
 
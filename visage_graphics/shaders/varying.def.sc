@@ -4,6 +4,9 @@ vec2 v_dimensions            : TEXCOORD1 = vec2(0.0, 0.0);
 vec4 v_shader_values         : TEXCOORD2 = vec4(0.0, 0.0, 0.0, 0.0);
 vec4 v_shader_values1        : TEXCOORD3 = vec4(0.0, 0.0, 0.0, 0.0);
 vec2 v_position              : TEXCOORD4 = vec2(0.0, 0.0);
+vec4 v_edge_distances        : TEXCOORD5 = vec4(0.0, 0.0, 0.0, 0.0);
+vec4 v_bound_distances       : TEXCOORD6 = vec4(0.0, 0.0, 0.0, 0.0);
+float v_shape_type           : TEXCOORD7 = 0.0;
 vec4 v_gradient_texture_pos  : COLOR0    = vec4(0.0, 0.0, 1.0, 1.0);
 vec4 v_gradient_pos          : COLOR1    = vec4(0.0, 0.0, 1.0, 1.0);
 vec4 v_gradient_pos2         : COLOR2    = vec4(0.0, 0.0, 0.0, 0.0);
@@ -16,3 +19,9 @@ vec4 a_texcoord0     : TEXCOORD0;
 vec4 a_texcoord1     : TEXCOORD1;
 vec4 a_texcoord2     : TEXCOORD2;
 vec4 a_texcoord3     : TEXCOORD3;
+
+vec4 i_data0         : TEXCOORD7;
+vec4 i_data1         : TEXCOORD6;
+vec4 i_data2         : TEXCOORD5;
+vec4 i_data3         : TEXCOORD4;
+vec4 i_data4         : TEXCOORD3;
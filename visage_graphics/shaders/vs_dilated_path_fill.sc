@@ -0,0 +1,86 @@
+$input a_position, a_texcoord0
+$output v_shader_values, v_shader_values1, v_edge_distances, v_bound_distances
+
+uniform vec4 u_bounds;
+uniform vec4 u_origin_flip;
+
+float lineFunctionDeltas(vec2 pa, vec2 ba) {
+  return (ba.x * pa.y - ba.y * pa.x) / dot(ba, ba);
+}
+
+float lineFunction(vec2 p, vec2 a, vec2 b) {
+  vec2 pa = p - a;
+  vec2 ba = b - a;
+  return lineFunctionDeltas(pa, ba);
+}
+
+float lineFunctionScaled(vec2 p, vec2 a, vec2 b) {
+  vec2 pa = p - a;
+  vec2 ba = b - a;
+  return lineFunctionDeltas(pa, ba) * length(ba);
+}
+
+vec2 outwardNormal(vec2 from, vec2 to, float winding) {
+  vec2 delta = to - from;
+  float delta_length = length(delta);
+  if (delta_length == 0.0)
+    return vec2(0.0, 0.0);
+  return winding * vec2(delta.y, -delta.x) / delta_length;
+}
+
+float pixelSupport(vec2 normal) {
+  return 0.5 * (abs(normal.x) + abs(normal.y));
+}
+
+float edgeDistance(vec2 position, vec2 edge_point, vec2 normal) {
+  return pixelSupport(normal) - dot(normal, position - edge_point);
+}
+
+void main() {
+  vec2 point0 = a_position.zw;
+  vec2 point1 = a_texcoord0.xy;
+  vec2 point2 = a_texcoord0.zw;
+  float area = (point1.x - point0.x) * (point2.y - point0.y) - (point1.y - point0.y) * (point2.x - point0.x);
+  float winding = area < 0.0 ? -1.0 : 1.0;
+  vec2 normal0 = outwardNormal(point0, point1, winding);
+  vec2 normal1 = outwardNormal(point1, point2, winding);
+  vec2 normal2 = outwardNormal(point2, point0, winding);
+
+  int index = int(a_position.x);
+  vec2 p = point0;
+  vec2 prev_normal = normal2;
+  vec2 next_normal = normal0;
+  if (index == 1) {
+    p = point1;
+    prev_normal = normal0;
+    next_normal = normal1;
+  }
+  else if (index == 2) {
+    p = point2;
+    prev_normal = normal1;
+    next_normal = normal2;
+  }
+
+  vec2 position = p;
+  float det = prev_normal.x * next_normal.y - prev_normal.y * next_normal.x;
+  if (abs(area) > 0.000001 && abs(det) > 0.000001) {
+    float prev_offset = pixelSupport(prev_normal) + 0.01;
+    float next_offset = pixelSupport(next_normal) + 0.01;
+    position += vec2(prev_offset * next_normal.y - next_offset * prev_normal.y,
+                     prev_normal.x * next_offset - next_normal.x * prev_offset) / det;
+  }
+
+  vec2 minimum = min(min(point0, point1), point2) - vec2(0.5, 0.5);
+  vec2 maximum = max(max(point0, point1), point2) + vec2(0.5, 0.5);
+  v_edge_distances = vec4(edgeDistance(position, point0, normal0), edgeDistance(position, point1, normal1),
+                          edgeDistance(position, point2, normal2), 0.0);
+  v_bound_distances = vec4(position - minimum, maximum - position);
+
+  v_shader_values.x = lineFunctionScaled(position, point0, point1);
+  v_shader_values.y = lineFunctionScaled(position, point0, point2);
+  v_shader_values.z = lineFunctionScaled(position, point2, point1) * u_origin_flip.x;
+  vec2 delta = point2 - point1;
+  v_shader_values.w = lineFunction(position, point1, point1 + vec2(delta.y, -delta.x));
+  v_shader_values1.xy = point0;
+  gl_Position = vec4(position * u_bounds.xy + u_bounds.zw, 0.5, 1.0);
+}
@@ -0,0 +1,43 @@
+$input a_position, a_color0, a_color1, a_color2, a_texcoord0, a_texcoord1, a_texcoord2, a_texcoord3
+$output v_coordinates, v_dimensions, v_shader_values, v_shader_values1, v_position, v_gradient_texture_pos, v_gradient_pos, v_gradient_pos2
+
+#include <shader_include.sh>
+
+uniform vec4 u_bounds;
+
+void main() {
+  vec2 half_dimensions = a_texcoord0.zw * 0.5;
+  vec2 center = a_position.xy - a_texcoord0.xy * half_dimensions;
+  vec2 point1 = center + a_texcoord2.zw * half_dimensions;
+  vec2 point2 = center + a_texcoord3.xy * half_dimensions;
+  vec2 delta = point2 - point1;
+  float segment_length = length(delta);
+  vec2 direction = segment_length > 0.0 ? delta / segment_length : vec2(1.0, 0.0);
+  float radius = 0.5 * a_texcoord2.x + 1.0;
+  vec2 along = direction * radius;
+  vec2 across = vec2(-direction.y, direction.x) * radius;
+
+  vec2 start = point1 - along;
+  vec2 end = point2 + along;
+  vec2 corners_min = min(min(start - across, start + across), min(end - across, end + across));
+  vec2 corners_max = max(max(start - across, start + across), max(end - across, end + across));
+  vec2 box_min = max(a_texcoord1.xy, center - half_dimensions - 0.5);
+  vec2 box_max = min(a_texcoord1.zw, center + half_dimensions + 0.5);
+
+  vec2 position = clamp(a_position.xy + a_texcoord0.xy * 0.5, a_texcoord1.xy, a_texcoord1.zw);
+  bool inside_min = corners_min.x >= box_min.x && corners_min.y >= box_min.y;
+  bool inside_max = corners_max.x <= box_max.x && corners_max.y <= box_max.y;
+  if (inside_min && inside_max)
+    position = (a_texcoord0.x < 0.0 ? start : end) + across * a_texcoord0.y;
+
+  v_position = position;
+  v_gradient_texture_pos = a_color0;
+  v_gradient_pos = a_color1;
+  v_gradient_pos2 = a_color2;
+  v_dimensions = a_texcoord0.zw + vec2(1.0, 1.0);
+  v_coordinates = 2.0 * (position - center) / v_dimensions;
+  vec2 adjusted_position = position * u_bounds.xy + u_bounds.zw;
+  gl_Position = vec4(adjusted_position, 0.5, 1.0);
+  v_shader_values = a_texcoord2;
+  v_shader_values1 = a_texcoord3;
+}
@@ -0,0 +1,25 @@
+$input a_position, i_data0, i_data1, i_data2, i_data3, i_data4
+$output v_coordinates, v_dimensions, v_shader_values, v_position, v_gradient_texture_pos, v_gradient_pos, v_gradient_pos2
+
+#include <shader_include.sh>
+
+uniform vec4 u_bounds;
+
+void main() {
+  vec2 corner = a_position.xy;
+  vec2 position = i_data0.xy + (corner * 0.5 + vec2(0.5, 0.5)) * i_data0.zw;
+  vec2 minimum = i_data1.xy;
+  vec2 maximum = i_data1.zw;
+  vec2 clamped = clamp(position + corner * 0.5, minimum, maximum);
+  vec2 delta = clamped - (position + corner * 0.5);
+
+  v_position = clamped;
+  v_gradient_texture_pos = i_data2;
+  v_gradient_pos = i_data3;
+  v_gradient_pos2 = vec4(1.0, 1.0, 1.0, 1.0);
+  v_dimensions = i_data0.zw + vec2(1.0, 1.0);
+  v_coordinates = corner + (2.0 * delta) / v_dimensions;
+  vec2 adjusted_position = clamped * u_bounds.xy + u_bounds.zw;
+  gl_Position = vec4(adjusted_position, 0.5, 1.0);
+  v_shader_values = i_data4;
+}
@@ -0,0 +1,28 @@
+$input a_position, i_data0, i_data1, i_data2, i_data3, i_data4
+$output v_coordinates, v_position, v_gradient_pos, v_gradient_pos2, v_gradient_texture_pos
+
+#include <shader_include.sh>
+
+uniform vec4 u_bounds;
+uniform vec4 u_atlas_scale;
+
+void main() {
+  vec2 corner = a_position.xy * 0.5 + vec2(0.5, 0.5);
+  vec2 position = i_data0.xy + corner * i_data0.zw;
+  vec2 clamped = clamp(position, i_data2.xy, i_data2.zw);
+  vec2 delta = clamped - position;
+
+  v_position = clamped;
+  v_gradient_texture_pos = i_data3;
+  v_gradient_pos = i_data4;
+  v_gradient_pos2 = vec4(1.0, 1.0, 1.0, 1.0);
+
+  float emoji = step(i_data1.x, -0.5);
+  vec2 atlas_position = vec2(mix(i_data1.x, -1.0 - i_data1.x, emoji), i_data1.y);
+  vec2 atlas_scale = mix(u_atlas_scale.xy, u_atlas_scale.zw, emoji);
+  vec2 texels_per_pixel = i_data1.zw / max(i_data0.zw, vec2(0.001, 0.001));
+  vec2 texture_position = atlas_position + corner * i_data1.zw + delta * texels_per_pixel;
+  v_coordinates = texture_position * atlas_scale + vec2(2.0 * emoji, 0.0);
+  vec2 adjusted_position = clamped * u_bounds.xy + u_bounds.zw;
+  gl_Position = vec4(adjusted_position, 0.5, 1.0);
+}
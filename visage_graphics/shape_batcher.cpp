@@ -28,11 +28,15 @@
 #include "layer.h"
 #include "path.h"
 #include "region.h"
+#include "resource_usage.h"
 #include "shader.h"
 #include "uniforms.h"
 #include "visage_utils/space.h"
 
+#include <algorithm>
 #include <bgfx/bgfx.h>
+#include <cmath>
+#include <cstring>
 
 namespace visage {
   static constexpr uint64_t blendModeValue(BlendMode blend_mode) {
@@ -64,64 +68,127 @@ namespace visage {
       return BGFX_STATE_WRITE_A |
              BGFX_STATE_BLEND_FUNC(BGFX_STATE_BLEND_SRC_ALPHA, BGFX_STATE_BLEND_ONE) |
              BGFX_STATE_BLEND_EQUATION(BGFX_STATE_BLEND_EQUATION_REVSUB);
+    case BlendMode::StencilClear:
+    case BlendMode::StencilClip: return 0;
     }
 
     VISAGE_ASSERT(false);
     return 0;
   }
 
+  static thread_local int stencil_clip_depth = 0;
+  static thread_local bool stencil_clips = false;
+
+  void setStencilClipDepth(int depth, bool clips) {
+    stencil_clip_depth = std::min(depth, kMaxStencilClipDepth);
+    stencil_clips = clips;
+  }
+
+  // Clip depth d keeps its inside marked by the low d stencil bits. Clip shapes mark one more bit
+  // inside the shape of their parent clip, and clears drop every bit from their own depth up.
+  static uint32_t stencilValue(BlendMode blend_mode, int depth) {
+    uint32_t inside = (1 << depth) - 1;
+    if (!isStencilBlendMode(blend_mode)) {
+      if (depth == 0)
+        return BGFX_STENCIL_NONE;
+
+      return BGFX_STENCIL_TEST_EQUAL | BGFX_STENCIL_FUNC_REF(inside) |
+             BGFX_STENCIL_FUNC_RMASK(inside) | BGFX_STENCIL_OP_FAIL_S_KEEP |
+             BGFX_STENCIL_OP_FAIL_Z_KEEP | BGFX_STENCIL_OP_PASS_Z_KEEP;
+    }
+
+    if (!stencil_clips)
+      return BGFX_STENCIL_TEST_NEVER | BGFX_STENCIL_OP_FAIL_S_KEEP;
+
+    uint32_t parent_inside = inside >> 1;
+    uint32_t test = depth > 1 ? BGFX_STENCIL_TEST_EQUAL : BGFX_STENCIL_TEST_ALWAYS;
+    uint32_t ref = blend_mode == BlendMode::StencilClip ? inside : parent_inside;
+    return test | BGFX_STENCIL_FUNC_REF(ref) | BGFX_STENCIL_FUNC_RMASK(parent_inside) |
+           BGFX_STENCIL_OP_FAIL_S_KEEP | BGFX_STENCIL_OP_FAIL_Z_KEEP |
+           BGFX_STENCIL_OP_PASS_Z_REPLACE;
+  }
+
   void setBlendMode(BlendMode blend_mode) {
-    bgfx::setState(blendModeValue(blend_mode));
+    encoder()->setState(blendModeValue(blend_mode));
+    if (stencil_clip_depth > 0)
+      encoder()->setStencil(stencilValue(blend_mode, stencil_clip_depth));
   }
 
   template<const char* name>
-  void setUniform(const void* value) {
+  void setUniform(int submit_pass, const float* value) {
     static const bgfx::UniformHandle uniform = bgfx::createUniform(name, bgfx::UniformType::Vec4, 1);
-    bgfx::setUniform(uniform, value);
+    UniformCache::setViewUniform(submit_pass, uniform, value);
   }
 
   template<const char* name>
-  void setUniform(float value0, float value1 = 0.0f, float value2 = 0.0f, float value3 = 0.0f) {
-    static const bgfx::UniformHandle uniform = bgfx::createUniform(name, bgfx::UniformType::Vec4, 1);
+  void setUniform(int submit_pass, float value0, float value1 = 0.0f, float value2 = 0.0f,
+                  float value3 = 0.0f) {
     float vec[4] = { value0, value1, value2, value3 };
-    bgfx::setUniform(uniform, vec);
+    setUniform<name>(submit_pass, vec);
   }
 
   template<const char* name>
   void setTexture(int stage, bgfx::TextureHandle handle) {
     static const bgfx::UniformHandle uniform = bgfx::createUniform(name, bgfx::UniformType::Sampler, 1);
-    bgfx::setTexture(stage, uniform, handle);
+    encoder()->setTexture(stage, uniform, handle);
   }
 
-  inline void setUniformBounds(int x, int y, int width, int height) {
+  inline void setUniformBounds(int x, int y, int width, int height, int submit_pass) {
     float scale_x = 2.0f / width;
     float scale_y = -2.0f / height;
     float view_bounds[4] = { scale_x, scale_y, x * scale_x - 1.0f, y * scale_y + 1.0f };
-    setUniform<Uniforms::kBounds>(view_bounds);
+    setUniform<Uniforms::kBounds>(submit_pass, view_bounds);
   }
 
-  inline void setTimeUniform(float time) {
+  inline void setTimeUniform(float time, int submit_pass) {
     float time_values[] = { time, time, time, time };
-    setUniform<Uniforms::kTime>(time_values);
+    setUniform<Uniforms::kTime>(submit_pass, time_values);
   }
 
-  void setUniformDimensions(int width, int height) {
+  void setUniformDimensions(int width, int height, int submit_pass) {
     float view_bounds[4] = { 2.0f / width, -2.0f / height, -1.0f, 1.0f };
-    setUniform<Uniforms::kBounds>(view_bounds);
+    setUniform<Uniforms::kBounds>(submit_pass, view_bounds);
   }
 
-  inline void setColorMult(bool hdr) {
+  inline void setColorMult(bool hdr, int submit_pass) {
     float value = (hdr ? kHdrColorMultiplier : 1.0f) * Color::kGradientNormalization;
-    setUniform<Uniforms::kColorMult>(value, value, value, 1.0f);
+    setUniform<Uniforms::kColorMult>(submit_pass, value, value, value, 1.0f);
+  }
+
+  void setOriginFlipUniform(bool origin_flip, int submit_pass) {
+    setUniform<Uniforms::kOriginFlip>(submit_pass, origin_flip ? -1.0 : 1.0, origin_flip ? 1.0 : 0.0);
+  }
+
+  struct StagedQuads {
+    std::vector<uint8_t> vertices;
+    const bgfx::VertexLayout* layout = nullptr;
+    int num_quads = 0;
+    // Vertices already bound for the next draw when nothing is staged.
+    int bound_vertices = 0;
+  };
+
+  static thread_local StagedQuads staged_quads;
+
+  static void writeQuadIndices(uint16_t* indices, int num_quads) {
+    for (int i = 0; i < num_quads; ++i) {
+      int vertex_index = i * kVerticesPerQuad;
+      int index = i * kIndicesPerQuad;
+      for (int v = 0; v < kIndicesPerQuad; ++v)
+        indices[index + v] = vertex_index + kQuadTriangles[v];
+    }
   }
 
-  void setOriginFlipUniform(bool origin_flip) {
-    setUniform<Uniforms::kOriginFlip>(origin_flip ? -1.0 : 1.0, origin_flip ? 1.0 : 0.0);
+  static bool transientQuadsAvailable(int num_quads, const bgfx::VertexLayout& layout) {
+    int num_vertices = num_quads * kVerticesPerQuad;
+    int num_indices = num_quads * kIndicesPerQuad;
+    return bgfx::getAvailTransientVertexBuffer(num_vertices, layout) == num_vertices &&
+           bgfx::getAvailTransientIndexBuffer(num_indices) == num_indices;
   }
 
   bool initTransientQuadBuffers(int num_quads, const bgfx::VertexLayout& layout,
                                 bgfx::TransientVertexBuffer* vertex_buffer,
                                 bgfx::TransientIndexBuffer* index_buffer) {
+    staged_quads.num_quads = 0;
     int num_vertices = num_quads * kVerticesPerQuad;
     int num_indices = num_quads * kIndicesPerQuad;
     if (!bgfx::allocTransientBuffers(vertex_buffer, layout, num_vertices, index_buffer, num_indices)) {
@@ -129,73 +196,368 @@ namespace visage {
       return false;
     }
 
-    uint16_t* indices = reinterpret_cast<uint16_t*>(index_buffer->data);
-    for (int i = 0; i < num_quads; ++i) {
-      int vertex_index = i * kVerticesPerQuad;
-      int index = i * kIndicesPerQuad;
-      for (int v = 0; v < kIndicesPerQuad; ++v)
-        indices[index + v] = vertex_index + kQuadTriangles[v];
+    TransientBufferUsage& usage = TransientBuffers::usage();
+    usage.vertex_bytes += num_vertices * layout.getStride();
+    usage.index_bytes += num_indices * sizeof(uint16_t);
+    writeQuadIndices(reinterpret_cast<uint16_t*>(index_buffer->data), num_quads);
+    return true;
+  }
+
+  uint8_t* initQuadVerticesWithLayout(int num_quads, const bgfx::VertexLayout& layout) {
+    bool fits = num_quads <= TransientBuffers::kMaxQuadsPerDraw;
+    if (fits && transientQuadsAvailable(num_quads, layout)) {
+      bgfx::TransientVertexBuffer vertex_buffer {};
+      bgfx::TransientIndexBuffer index_buffer {};
+      if (initTransientQuadBuffers(num_quads, layout, &vertex_buffer, &index_buffer)) {
+        encoder()->setVertexBuffer(0, &vertex_buffer);
+        encoder()->setIndexBuffer(&index_buffer);
+        staged_quads.bound_vertices = num_quads * kVerticesPerQuad;
+        return vertex_buffer.data;
+      }
+    }
+
+    size_t size = static_cast<size_t>(num_quads) * kVerticesPerQuad * layout.getStride();
+    staged_quads.vertices.resize(size);
+    staged_quads.layout = &layout;
+    staged_quads.num_quads = num_quads;
+    return staged_quads.vertices.data();
+  }
+
+  void submitQuads(int submit_pass, bgfx::ProgramHandle program) {
+    if (staged_quads.num_quads == 0) {
+      submitDraw(submit_pass, program, staged_quads.bound_vertices);
+      return;
+    }
+
+    const bgfx::VertexLayout& layout = *staged_quads.layout;
+    int num_quads = staged_quads.num_quads;
+    int quad_size = kVerticesPerQuad * layout.getStride();
+    staged_quads.num_quads = 0;
+
+    TransientBufferUsage& usage = TransientBuffers::usage();
+    uint8_t keep_state = BGFX_DISCARD_INDEX_BUFFER | BGFX_DISCARD_VERTEX_STREAMS;
+    for (int start = 0; start < num_quads;) {
+      int draw_quads = std::min(num_quads - start, TransientBuffers::kMaxQuadsPerDraw);
+      const uint8_t* source = staged_quads.vertices.data() + static_cast<size_t>(start) * quad_size;
+      bgfx::VertexBufferHandle vertex_handle = BGFX_INVALID_HANDLE;
+      bgfx::IndexBufferHandle index_handle = BGFX_INVALID_HANDLE;
+      bgfx::TransientVertexBuffer vertex_buffer {};
+      bgfx::TransientIndexBuffer index_buffer {};
+      int num_vertices = draw_quads * kVerticesPerQuad;
+      int vertices_left = bgfx::getAvailTransientVertexBuffer(num_vertices, layout);
+      int indices_left = bgfx::getAvailTransientIndexBuffer(draw_quads * kIndicesPerQuad);
+      int available = std::min(vertices_left / kVerticesPerQuad, indices_left / kIndicesPerQuad);
+
+      if (available > 0 &&
+          initTransientQuadBuffers(available, layout, &vertex_buffer, &index_buffer)) {
+        draw_quads = available;
+        std::memcpy(vertex_buffer.data, source, static_cast<size_t>(draw_quads) * quad_size);
+        encoder()->setVertexBuffer(0, &vertex_buffer);
+        encoder()->setIndexBuffer(&index_buffer);
+      }
+      else {
+        const bgfx::Memory* vertex_memory = bgfx::copy(source, draw_quads * quad_size);
+        const bgfx::Memory* index_memory = bgfx::alloc(draw_quads * kIndicesPerQuad *
+                                                       sizeof(uint16_t));
+        writeQuadIndices(reinterpret_cast<uint16_t*>(index_memory->data), draw_quads);
+        vertex_handle = bgfx::createVertexBuffer(vertex_memory, layout);
+        index_handle = bgfx::createIndexBuffer(index_memory);
+        encoder()->setVertexBuffer(0, vertex_handle);
+        encoder()->setIndexBuffer(index_handle);
+        usage.fallback_draws++;
+      }
+
+      start += draw_quads;
+      if (start < num_quads) {
+        usage.split_draws++;
+        submitDraw(submit_pass, program, draw_quads * kVerticesPerQuad, keep_state);
+      }
+      else
+        submitDraw(submit_pass, program, draw_quads * kVerticesPerQuad);
+
+      if (bgfx::isValid(vertex_handle))
+        bgfx::destroy(vertex_handle);
+      if (bgfx::isValid(index_handle))
+        bgfx::destroy(index_handle);
+    }
+  }
+
+  AreaGrid::CellRange AreaGrid::cellRange(float x, float y, float right, float bottom) {
+    return { static_cast<int>(std::floor(x / kCellSize)), static_cast<int>(std::floor(y / kCellSize)),
+             static_cast<int>(std::floor(right / kCellSize)),
+             static_cast<int>(std::floor(bottom / kCellSize)) };
+  }
+
+  void AreaGrid::index(int area_index) {
+    const Area& area = areas_[area_index];
+    CellRange range = cellRange(area.x, area.y, area.right, area.bottom);
+    if (range.numCells() > kMaxCellsPerArea) {
+      large_areas_.push_back(area_index);
+      return;
+    }
+
+    for (int cell_y = range.top; cell_y <= range.bottom; ++cell_y) {
+      for (int cell_x = range.left; cell_x <= range.right; ++cell_x)
+        cells_[cellKey(cell_x, cell_y)].push_back(area_index);
+    }
+  }
+
+  void AreaGrid::add(float x, float y, float right, float bottom) {
+    areas_.push_back({ x, y, right, bottom });
+    if (areas_.size() == kMinGridAreas) {
+      for (int i = 0; i < areas_.size(); ++i)
+        index(i);
+    }
+    else if (areas_.size() > kMinGridAreas)
+      index(areas_.size() - 1);
+  }
+
+  bool AreaGrid::overlaps(float x, float y, float right, float bottom) const {
+    auto overlaps_area = [&](int area_index) {
+      return areas_[area_index].overlaps(x, y, right, bottom);
+    };
+
+    CellRange range = cellRange(x, y, right, bottom);
+    if (areas_.size() < kMinGridAreas || range.numCells() > kMaxCellsPerArea) {
+      return std::any_of(areas_.begin(), areas_.end(),
+                         [&](const Area& area) { return area.overlaps(x, y, right, bottom); });
+    }
+
+    if (std::any_of(large_areas_.begin(), large_areas_.end(), overlaps_area))
+      return true;
+
+    for (int cell_y = range.top; cell_y <= range.bottom; ++cell_y) {
+      for (int cell_x = range.left; cell_x <= range.right; ++cell_x) {
+        auto cell = cells_.find(cellKey(cell_x, cell_y));
+        if (cell != cells_.end() && std::any_of(cell->second.begin(), cell->second.end(), overlaps_area))
+          return true;
+      }
+    }
+    return false;
+  }
+
+  struct PersistentQuadBufferHandles {
+    ~PersistentQuadBufferHandles() {
+      if (bgfx::isValid(vertex_buffer))
+        bgfx::destroy(vertex_buffer);
+      if (bgfx::isValid(index_buffer))
+        bgfx::destroy(index_buffer);
     }
 
+    bgfx::DynamicVertexBufferHandle vertex_buffer = BGFX_INVALID_HANDLE;
+    bgfx::DynamicIndexBufferHandle index_buffer = BGFX_INVALID_HANDLE;
+    TrackedResource memory;
+  };
+
+  PersistentQuadBuffer::PersistentQuadBuffer() = default;
+  PersistentQuadBuffer::~PersistentQuadBuffer() = default;
+
+  bool PersistentQuadBuffer::matches(const std::vector<PositionedBatch>& batches,
+                                     const Layer& layer) const {
+    if (handles_ == nullptr || sources_.size() != batches.size())
+      return false;
+
+    const GradientAtlas* gradient_atlas = layer.gradientAtlas();
+    if (gradient_atlas_ != gradient_atlas || gradient_atlas_version_ != gradient_atlas->packVersion())
+      return false;
+    if (palette_color_version_ != PackedBrush::paletteColorVersion())
+      return false;
+
+    for (int i = 0; i < batches.size(); ++i) {
+      const Source& source = sources_[i];
+      const PositionedBatch& batch = batches[i];
+      if (source.batch != batch.batch || source.version != batch.batch->version() ||
+          source.x != batch.x || source.y != batch.y || source.invalid_rects != *batch.invalid_rects)
+        return false;
+    }
     return true;
   }
 
-  uint8_t* initQuadVerticesWithLayout(int num_quads, const bgfx::VertexLayout& layout) {
+  bool PersistentQuadBuffer::update(const std::vector<PositionedBatch>& batches, const Layer& layer,
+                                    const void* vertices, int num_quads,
+                                    const bgfx::VertexLayout& layout, bool radial_gradient) {
+    if (handles_ == nullptr)
+      handles_ = std::make_unique<PersistentQuadBufferHandles>();
+
+    if (num_quads > capacity_) {
+      handles_ = std::make_unique<PersistentQuadBufferHandles>();
+      capacity_ = std::max(num_quads, std::min(kMaxQuads, 2 * capacity_));
+      handles_->vertex_buffer = bgfx::createDynamicVertexBuffer(capacity_ * kVerticesPerQuad, layout);
+      handles_->index_buffer = bgfx::createDynamicIndexBuffer(capacity_ * kIndicesPerQuad);
+      if (!bgfx::isValid(handles_->vertex_buffer) || !bgfx::isValid(handles_->index_buffer)) {
+        clear();
+        return false;
+      }
+
+      long long bytes = capacity_ * (kVerticesPerQuad * layout.getStride() +
+                                     kIndicesPerQuad * sizeof(uint16_t));
+      handles_->memory.reset(ResourceCategory::ShapeBuffers, bytes);
+
+      const bgfx::Memory* index_memory = bgfx::alloc(capacity_ * kIndicesPerQuad * sizeof(uint16_t));
+      uint16_t* indices = reinterpret_cast<uint16_t*>(index_memory->data);
+      for (int i = 0; i < capacity_; ++i) {
+        for (int v = 0; v < kIndicesPerQuad; ++v)
+          indices[i * kIndicesPerQuad + v] = i * kVerticesPerQuad + kQuadTriangles[v];
+      }
+      bgfx::update(handles_->index_buffer, 0, index_memory);
+    }
+
+    if (num_quads) {
+      int size = num_quads * kVerticesPerQuad * layout.getStride();
+      bgfx::update(handles_->vertex_buffer, 0, bgfx::copy(vertices, size));
+    }
+
+    sources_.clear();
+    sources_.reserve(batches.size());
+    for (const PositionedBatch& batch : batches)
+      sources_.push_back({ batch.batch, batch.batch->version(), batch.x, batch.y, *batch.invalid_rects });
+
+    gradient_atlas_ = layer.gradientAtlas();
+    gradient_atlas_version_ = gradient_atlas_->packVersion();
+    palette_color_version_ = PackedBrush::paletteColorVersion();
+    num_quads_ = num_quads;
+    radial_gradient_ = radial_gradient;
+    return true;
+  }
+
+  void PersistentQuadBuffer::setBuffers() const {
+    staged_quads.num_quads = 0;
+    staged_quads.bound_vertices = num_quads_ * kVerticesPerQuad;
+    encoder()->setVertexBuffer(0, handles_->vertex_buffer, 0, num_quads_ * kVerticesPerQuad);
+    encoder()->setIndexBuffer(handles_->index_buffer, 0, num_quads_ * kIndicesPerQuad);
+  }
+
+  void PersistentQuadBuffer::clear() {
+    handles_.reset();
+    sources_.clear();
+    gradient_atlas_ = nullptr;
+    num_quads_ = 0;
+    capacity_ = 0;
+  }
+
+  static uint8_t* initQuadInstances(int num_instances, int stride) {
+    static constexpr float kCorners[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+
+    if ((bgfx::getCaps()->supported & BGFX_CAPS_INSTANCING) == 0)
+      return nullptr;
+
+    if (bgfx::getAvailInstanceDataBuffer(num_instances, stride) < num_instances)
+      return nullptr;
+
     bgfx::TransientVertexBuffer vertex_buffer {};
     bgfx::TransientIndexBuffer index_buffer {};
-    if (!initTransientQuadBuffers(num_quads, layout, &vertex_buffer, &index_buffer))
+    if (!initTransientQuadBuffers(1, UvVertex::layout(), &vertex_buffer, &index_buffer))
       return nullptr;
 
-    bgfx::setVertexBuffer(0, &vertex_buffer);
-    bgfx::setIndexBuffer(&index_buffer);
-    return vertex_buffer.data;
+    UvVertex* corners = reinterpret_cast<UvVertex*>(vertex_buffer.data);
+    for (int i = 0; i < kVerticesPerQuad; ++i)
+      corners[i] = { kCorners[2 * i], kCorners[2 * i + 1], 0.0f, 0.0f };
+
+    bgfx::InstanceDataBuffer instance_buffer {};
+    bgfx::allocInstanceDataBuffer(&instance_buffer, num_instances, stride);
+
+    encoder()->setVertexBuffer(0, &vertex_buffer);
+    encoder()->setIndexBuffer(&index_buffer);
+    encoder()->setInstanceDataBuffer(&instance_buffer);
+    staged_quads.bound_vertices = num_instances * kVerticesPerQuad;
+    return instance_buffer.data;
+  }
+
+  ShapeInstance* initShapeInstances(int num_shapes) {
+    static_assert(sizeof(ShapeInstance) % 16 == 0, "Instance data must be made of vec4 values");
+    return reinterpret_cast<ShapeInstance*>(initQuadInstances(num_shapes, sizeof(ShapeInstance)));
+  }
+
+  void submitInstancedShapes(const Layer& layer, const EmbeddedFile& fragment_shader, int submit_pass) {
+    submitShapes(layer, shaders::vs_shape_instanced, fragment_shader, false, submit_pass);
   }
 
   void submitShapes(const Layer& layer, const EmbeddedFile& vertex_shader,
                     const EmbeddedFile& fragment_shader, bool radial_gradient, int submit_pass) {
-    setTimeUniform(layer.time());
-    setUniformDimensions(layer.width(), layer.height());
-    setColorMult(layer.hdr());
-    setOriginFlipUniform(layer.bottomLeftOrigin());
+    setTimeUniform(layer.time(), submit_pass);
+    setUniformDimensions(layer.width(), layer.height(), submit_pass);
+    setColorMult(layer.hdr(), submit_pass);
+    setOriginFlipUniform(layer.bottomLeftOrigin(), submit_pass);
     GradientAtlas* gradient_atlas = layer.gradientAtlas();
-    setUniform<Uniforms::kRadialGradient>(radial_gradient ? 1.0f : 0.0f);
+    setUniform<Uniforms::kRadialGradient>(submit_pass, radial_gradient ? 1.0f : 0.0f);
     setTexture<Uniforms::kGradient>(0, gradient_atlas->colorTextureHandle());
-    bgfx::submit(submit_pass, ProgramCache::programHandle(vertex_shader, fragment_shader));
+    submitQuads(submit_pass, ProgramCache::programHandle(vertex_shader, fragment_shader));
+  }
+
+  void submitRetainedShapes(const PersistentQuadBuffer& buffer, BlendMode blend_mode,
+                            const Layer& layer, const EmbeddedFile& vertex_shader,
+                            const EmbeddedFile& fragment_shader, int x, int y,
+                            const std::vector<IBounds>& rects, int submit_pass) {
+    setTimeUniform(layer.time(), submit_pass);
+    setUniformBounds(x, y, layer.width(), layer.height(), submit_pass);
+    setColorMult(layer.hdr(), submit_pass);
+    setOriginFlipUniform(layer.bottomLeftOrigin(), submit_pass);
+    setUniform<Uniforms::kRadialGradient>(submit_pass, buffer.radialGradient() ? 1.0f : 0.0f);
+    bgfx::ProgramHandle program = ProgramCache::programHandle(vertex_shader, fragment_shader);
+    for (const IBounds& rect : rects) {
+      buffer.setBuffers();
+      setBlendMode(blend_mode);
+      setTexture<Uniforms::kGradient>(0, layer.gradientAtlas()->colorTextureHandle());
+      encoder()->setScissor(rect.x(), rect.y(), rect.width(), rect.height());
+      submitDraw(submit_pass, program, buffer.numQuads() * kVerticesPerQuad);
+    }
   }
 
-  void setImageAtlasUniform(ImageAtlas* atlas) {
-    setTexture<Uniforms::kTexture>(1, atlas->textureHandle());
-    setUniform<Uniforms::kAtlasScale>(1.0f / atlas->width(), 1.0f / atlas->height());
+  void setImageAtlasUniform(ImageAtlas* atlas, const ImageAtlas::PackedImage& image, int submit_pass) {
+    ImageAtlas::Page* page = image.page();
+    setTexture<Uniforms::kTexture>(1, atlas->textureHandle(page));
+    setUniform<Uniforms::kAtlasScale>(submit_pass, 1.0f / atlas->width(page), 1.0f / atlas->height(page));
   }
 
-  void setPathAtlasUniform(PathAtlas* atlas) {
+  void setPathAtlasUniform(PathAtlas* atlas, int submit_pass) {
     setTexture<Uniforms::kTexture>(1, bgfx::getTexture(atlas->frameBufferHandle()));
-    setUniform<Uniforms::kAtlasScale>(1.0f / atlas->width(), 1.0f / atlas->height());
+    setUniform<Uniforms::kAtlasScale>(submit_pass, 1.0f / atlas->width(), 1.0f / atlas->height());
   }
 
-  void setImageAtlasUniform(const BatchVector<ImageWrapper>& batches) {
-    if (!batches.empty() && !batches[0].shapes->empty())
-      setImageAtlasUniform(batches[0].shapes->front().image_atlas);
+  void setImageAtlasUniform(const BatchVector<ImageWrapper>& batches, int submit_pass) {
+    if (!batches.empty() && !batches[0].shapes->empty()) {
+      const ImageWrapper& shape = batches[0].shapes->front();
+      setImageAtlasUniform(shape.image_atlas, shape.packed_image, submit_pass);
+    }
   }
 
-  void setGraphDataUniform(const BatchVector<GraphLineWrapper>& batches) {
-    if (!batches.empty() && !batches[0].shapes->empty())
-      setImageAtlasUniform(batches[0].shapes->front().data_atlas);
+  void setGraphDataUniform(const BatchVector<GraphLineWrapper>& batches, int submit_pass) {
+    if (!batches.empty() && !batches[0].shapes->empty()) {
+      const GraphLineWrapper& shape = batches[0].shapes->front();
+      setImageAtlasUniform(shape.data_atlas, shape.packed_data, submit_pass);
+    }
   }
 
-  void setGraphDataUniform(const BatchVector<GraphFillWrapper>& batches) {
-    if (!batches.empty() && !batches[0].shapes->empty())
-      setImageAtlasUniform(batches[0].shapes->front().data_atlas);
+  void setGraphDataUniform(const BatchVector<GraphFillWrapper>& batches, int submit_pass) {
+    if (!batches.empty() && !batches[0].shapes->empty()) {
+      const GraphFillWrapper& shape = batches[0].shapes->front();
+      setImageAtlasUniform(shape.data_atlas, shape.packed_data, submit_pass);
+    }
   }
 
-  void setHeatMapDataUniform(const BatchVector<HeatMapWrapper>& batches) {
-    if (!batches.empty() && !batches[0].shapes->empty())
-      setImageAtlasUniform(batches[0].shapes->front().data_atlas);
+  void setHeatMapDataUniform(const BatchVector<HeatMapWrapper>& batches, int submit_pass) {
+    if (!batches.empty() && !batches[0].shapes->empty()) {
+      const HeatMapWrapper& shape = batches[0].shapes->front();
+      setImageAtlasUniform(shape.data_atlas, shape.packed_data, submit_pass);
+    }
   }
 
-  void setPathDataUniform(const BatchVector<PathFillWrapper>& batches) {
+  void setPathDataUniform(const BatchVector<PathFillWrapper>& batches, int submit_pass) {
     if (!batches.empty() && !batches[0].shapes->empty())
-      setPathAtlasUniform(batches[0].shapes->front().path_atlas);
+      setPathAtlasUniform(batches[0].shapes->front().path_atlas, submit_pass);
+  }
+
+  void setPathStripUniform(const BatchVector<PathStripWrapper>& batches, int submit_pass) {
+    if (!batches.empty() && !batches[0].shapes->empty()) {
+      const PathStripWrapper& shape = batches[0].shapes->front();
+      setImageAtlasUniform(shape.image_atlas, shape.packed_alphas, submit_pass);
+    }
+  }
+
+  static bool textQuadOverlaps(const TextBlock& text, const ClampBounds& clamp,
+                               const FontAtlasQuad& quad) {
+    return quad.x + text.x < clamp.right && quad.x + quad.width + text.x > clamp.left &&
+           quad.y + text.y < clamp.bottom && quad.y + quad.height + text.y > clamp.top;
   }
 
   inline int numTextPieces(const TextBlock& text, int x, int y, const std::vector<IBounds>& invalid_rects) {
@@ -206,8 +568,7 @@ namespace visage {
         return sum;
 
       auto overlaps = [&clamp, &text](const FontAtlasQuad& quad) {
-        return quad.x + text.x < clamp.right && quad.x + quad.width + text.x > clamp.left &&
-               quad.y + text.y < clamp.bottom && quad.y + quad.height + text.y > clamp.top;
+        return textQuadOverlaps(text, clamp, quad);
       };
       int num_pieces = std::count_if(text.quads.begin(), text.quads.end(), overlaps);
       return sum + num_pieces;
@@ -215,25 +576,94 @@ namespace visage {
     return std::accumulate(invalid_rects.begin(), invalid_rects.end(), 0, count_pieces);
   }
 
-  void submitText(const BatchVector<TextBlock>& batches, const Layer& layer, int submit_pass) {
-    if (batches.empty() || batches[0].shapes->empty())
-      return;
+  // Each glyph becomes one instance and the vertex shader expands it, which is a fraction of the
+  // data of four full vertices. Rotated text and radial gradients still go through vertices.
+  static bool writeTextInstances(const BatchVector<TextBlock>& batches, int total_length) {
+    static_assert(sizeof(TextInstance) % 16 == 0, "Instance data must be made of vec4 values");
 
-    const Font& font = batches[0].shapes->front().font;
-    int total_length = 0;
-    for (const auto& batch : batches) {
-      auto count_pieces = [&batch](int sum, const TextBlock& text_block) {
-        return sum + numTextPieces(text_block, batch.x, batch.y, *batch.invalid_rects);
+    auto upright = [](const DrawBatch<TextBlock>& batch) {
+      auto is_upright = [](const TextBlock& text_block) {
+        return text_block.direction == Direction::Up;
       };
-      total_length += std::accumulate(batch.shapes->begin(), batch.shapes->end(), 0, count_pieces);
+      return std::all_of(batch.shapes->begin(), batch.shapes->end(), is_upright);
+    };
+    if (batches[0].shapes->front().radialGradient() ||
+        !std::all_of(batches.begin(), batches.end(), upright))
+      return false;
+
+    uint8_t* data = initQuadInstances(total_length, sizeof(TextInstance));
+    if (data == nullptr)
+      return false;
+
+    TextInstance* instances = reinterpret_cast<TextInstance*>(data);
+    int instance_index = 0;
+    static thread_local std::vector<TextureVertex> gradient_vertices;
+    for (const auto& batch : batches) {
+      for (const TextBlock& text_block : *batch.shapes) {
+        if (text_block.quads.empty())
+          continue;
+
+        int x = text_block.x + batch.x;
+        int y = text_block.y + batch.y;
+        for (const IBounds& invalid_rect : *batch.invalid_rects) {
+          ClampBounds clamp = text_block.clamp.clamp(invalid_rect.x() - batch.x,
+                                                     invalid_rect.y() - batch.y,
+                                                     invalid_rect.width(), invalid_rect.height());
+          if (text_block.totallyClamped(clamp))
+            continue;
+
+          ClampBounds positioned_clamp = clamp.withOffset(batch.x, batch.y);
+          int num_brushes = text_block.style_brushes.size() + 1;
+          gradient_vertices.resize(num_brushes);
+          for (int i = 0; i < num_brushes; ++i) {
+            const PackedBrush* brush = i ? text_block.style_brushes[i - 1] : text_block.brush;
+            PackedBrush::setVertexGradientPositions(brush, &gradient_vertices[i], 1, x, y, batch.x,
+                                                    batch.y, x + text_block.width,
+                                                    y + text_block.height);
+          }
+
+          for (const FontAtlasQuad& quad : text_block.quads) {
+            if (!textQuadOverlaps(text_block, clamp, quad))
+              continue;
+
+            const TextureVertex& gradient_vertex = gradient_vertices[quad.style];
+
+            const PackedGlyph* packed_glyph = quad.packed_glyph;
+            TextInstance& instance = instances[instance_index++];
+            instance.x = x + quad.x;
+            instance.y = y + quad.y;
+            instance.width = quad.width;
+            instance.height = quad.height;
+            instance.texture_x = packed_glyph->atlas_left;
+            instance.texture_y = packed_glyph->atlas_top;
+            instance.texture_width = packed_glyph->width;
+            instance.texture_height = packed_glyph->height;
+            if (packed_glyph->type_face == nullptr)
+              instance.texture_x = -1.0f - instance.texture_x;
+
+            instance.clamp_left = positioned_clamp.left;
+            instance.clamp_top = positioned_clamp.top;
+            instance.clamp_right = positioned_clamp.right;
+            instance.clamp_bottom = positioned_clamp.bottom;
+            instance.gradient_texture_position = gradient_vertex.gradient_texture_position;
+            instance.gradient_from_x = gradient_vertex.gradient.from_x;
+            instance.gradient_from_y = gradient_vertex.gradient.from_y;
+            instance.gradient_to_x = gradient_vertex.gradient.to_x;
+            instance.gradient_to_y = gradient_vertex.gradient.to_y;
+          }
+        }
+      }
     }
 
-    if (total_length == 0)
-      return;
+    VISAGE_ASSERT(instance_index == total_length);
+    return true;
+  }
 
+  static bool writeTextVertices(const BatchVector<TextBlock>& batches, int total_length,
+                                float texels_per_pixel) {
     TextureVertex* vertices = initQuadVertices<TextureVertex>(total_length);
     if (vertices == nullptr)
-      return;
+      return false;
 
     int vertex_index = 0;
     for (const auto& batch : batches) {
@@ -251,13 +681,6 @@ namespace visage {
           if (text_block.totallyClamped(clamp))
             continue;
 
-          auto overlaps = [&clamp, &text_block](const FontAtlasQuad& quad) {
-            return quad.x + text_block.x < clamp.right &&
-                   quad.x + quad.width + text_block.x > clamp.left &&
-                   quad.y + text_block.y < clamp.bottom &&
-                   quad.y + quad.height + text_block.y > clamp.top;
-          };
-
           ClampBounds positioned_clamp = clamp.withOffset(batch.x, batch.y);
           float direction_x = 1.0f;
           float direction_y = 0.0f;
@@ -291,23 +714,39 @@ namespace visage {
             coordinate_index3 = 2;
           }
 
-          PackedBrush::setVertexGradientPositions(text_block.brush, vertices + vertex_index,
-                                                  length * kVerticesPerQuad, x, y, batch.x, batch.y,
-                                                  x + text_block.width, y + text_block.height);
+          bool styled = !text_block.style_brushes.empty();
+          if (!styled) {
+            PackedBrush::setVertexGradientPositions(text_block.brush, vertices + vertex_index,
+                                                    length * kVerticesPerQuad, x, y, batch.x,
+                                                    batch.y, x + text_block.width,
+                                                    y + text_block.height);
+          }
 
           for (int i = 0; i < length; ++i) {
-            if (!overlaps(text_block.quads[i]))
+            if (!textQuadOverlaps(text_block, clamp, text_block.quads[i]))
               continue;
 
+            if (styled) {
+              PackedBrush::setVertexGradientPositions(text_block.quadBrush(text_block.quads[i]),
+                                                      vertices + vertex_index, kVerticesPerQuad, x,
+                                                      y, batch.x, batch.y, x + text_block.width,
+                                                      y + text_block.height);
+            }
+
             float left = x + text_block.quads[i].x;
             float right = left + text_block.quads[i].width;
             float top = y + text_block.quads[i].y;
             float bottom = top + text_block.quads[i].height;
 
-            float texture_x = text_block.quads[i].packed_glyph->atlas_left;
-            float texture_y = text_block.quads[i].packed_glyph->atlas_top;
-            float texture_width = text_block.quads[i].packed_glyph->width;
-            float texture_height = text_block.quads[i].packed_glyph->height;
+            const PackedGlyph* packed_glyph = text_block.quads[i].packed_glyph;
+            float texture_x = packed_glyph->atlas_left;
+            float texture_y = packed_glyph->atlas_top;
+            float texture_width = packed_glyph->width;
+            float texture_height = packed_glyph->height;
+            if (packed_glyph->type_face == nullptr) {
+              texture_x = -1.0f - texture_x;
+              texture_width = -texture_width;
+            }
 
             vertices[vertex_index].x = left;
             vertices[vertex_index].y = top;
@@ -329,6 +768,7 @@ namespace visage {
 
             for (int v = 0; v < kVerticesPerQuad; ++v) {
               int index = vertex_index + v;
+              vertices[index].dimension_x = texels_per_pixel;
               vertices[index].clamp_left = positioned_clamp.left;
               vertices[index].clamp_top = positioned_clamp.top;
               vertices[index].clamp_right = positioned_clamp.right;
@@ -344,52 +784,88 @@ namespace visage {
     }
 
     VISAGE_ASSERT(vertex_index == total_length * kVerticesPerQuad);
+    return true;
+  }
+
+  void submitText(const BatchVector<TextBlock>& batches, const Layer& layer, int submit_pass) {
+    if (batches.empty() || batches[0].shapes->empty())
+      return;
+
+    const Font& font = batches[0].shapes->front().font;
+    int total_length = 0;
+    for (const auto& batch : batches) {
+      auto count_pieces = [&batch](int sum, const TextBlock& text_block) {
+        return sum + numTextPieces(text_block, batch.x, batch.y, *batch.invalid_rects);
+      };
+      total_length += std::accumulate(batch.shapes->begin(), batch.shapes->end(), 0, count_pieces);
+    }
+
+    if (total_length == 0)
+      return;
+
+    const EmbeddedFile* vertex_shader = &shaders::vs_text_instanced;
+    if (!writeTextInstances(batches, total_length)) {
+      vertex_shader = &shaders::vs_text;
+      if (!writeTextVertices(batches, total_length, 1.0f / font.glyphScale()))
+        return;
+    }
 
-    setUniform<Uniforms::kAtlasScale>(1.0f / font.atlasWidth(), 1.0f / font.atlasHeight());
     setTexture<Uniforms::kGradient>(0, layer.gradientAtlas()->colorTextureHandle());
     setTexture<Uniforms::kTexture>(1, font.textureHandle());
-    setUniformDimensions(layer.width(), layer.height());
-    setColorMult(layer.hdr());
-    setUniform<Uniforms::kRadialGradient>(batches[0].shapes->front().radialGradient() ? 1.0f : 0.0f);
-    bgfx::submit(submit_pass,
-                 ProgramCache::programHandle(shaders::vs_tinted_texture, shaders::fs_tinted_texture));
+    setTexture<Uniforms::kTexture2>(2, font.emojiTextureHandle());
+    setUniform<Uniforms::kAtlasScale>(submit_pass, 1.0f / std::max(1, font.atlasWidth()),
+                                      1.0f / std::max(1, font.atlasHeight()),
+                                      1.0f / std::max(1, font.emojiAtlasWidth()),
+                                      1.0f / std::max(1, font.emojiAtlasHeight()));
+    setUniformDimensions(layer.width(), layer.height(), submit_pass);
+    setColorMult(layer.hdr(), submit_pass);
+    setUniform<Uniforms::kRadialGradient>(submit_pass, batches[0].shapes->front().radialGradient() ? 1.0f : 0.0f);
+    if (font.sdf())
+      submitQuads(submit_pass, ProgramCache::programHandle(*vertex_shader, shaders::fs_text_sdf));
+    else
+      submitQuads(submit_pass, ProgramCache::programHandle(*vertex_shader, shaders::fs_text));
+  }
+
+  WorkerPool* vertexWorkerPool(const Layer& layer) {
+    return layer.workerPool();
   }
 
   void submitShader(const BatchVector<ShaderWrapper>& batches, const Layer& layer, int submit_pass) {
-    auto quads = setupQuads(batches);
+    auto quads = setupQuads(batches, vertexWorkerPool(layer));
     if (quads.vertices == nullptr)
       return;
 
-    setUniform<Uniforms::kRadialGradient>(quads.radial_gradient ? 1.0f : 0.0f);
+    setUniform<Uniforms::kRadialGradient>(submit_pass, quads.radial_gradient ? 1.0f : 0.0f);
     setBlendMode(BlendMode::Alpha);
-    setTimeUniform(layer.time());
-    setUniformDimensions(layer.width(), layer.height());
+    setTimeUniform(layer.time(), submit_pass);
+    setUniformDimensions(layer.width(), layer.height(), submit_pass);
     setTexture<Uniforms::kGradient>(0, layer.gradientAtlas()->colorTextureHandle());
-    setColorMult(layer.hdr());
-    setOriginFlipUniform(layer.bottomLeftOrigin());
+    setColorMult(layer.hdr(), submit_pass);
+    setOriginFlipUniform(layer.bottomLeftOrigin(), submit_pass);
     Shader* shader = batches[0].shapes->front().shader;
-    bgfx::submit(submit_pass,
-                 ProgramCache::programHandle(shader->vertexShader(), shader->fragmentShader()));
+    submitQuads(submit_pass, ProgramCache::programHandle(shader->vertexShader(),
+                                                         shader->fragmentShader()));
   }
 
   void submitSampleRegions(const BatchVector<SampleRegion>& batches, const Layer& layer, int submit_pass) {
-    auto quads = setupQuads(batches);
+    auto quads = setupQuads(batches, vertexWorkerPool(layer));
     if (quads.vertices == nullptr)
       return;
 
-    setUniform<Uniforms::kRadialGradient>(quads.radial_gradient ? 1.0f : 0.0f);
+    setUniform<Uniforms::kRadialGradient>(submit_pass, quads.radial_gradient ? 1.0f : 0.0f);
 
     setBlendMode(BlendMode::Alpha);
-    setTimeUniform(layer.time());
+    setTimeUniform(layer.time(), submit_pass);
     Layer* source_layer = batches[0].shapes->front().region->layer();
-    setUniform<Uniforms::kAtlasScale>(1.0f / source_layer->width(), 1.0f / source_layer->height());
+    setUniform<Uniforms::kAtlasScale>(submit_pass, 1.0f / source_layer->width(), 1.0f / source_layer->height());
 
     setTexture<Uniforms::kTexture>(0, bgfx::getTexture(source_layer->frameBuffer()));
-    setUniformDimensions(layer.width(), layer.height());
+    setUniformDimensions(layer.width(), layer.height(), submit_pass);
     float value = layer.hdr() ? kHdrColorMultiplier : 1.0f;
-    setUniform<Uniforms::kColorMult>(value, value, value, 1.0f);
-    setOriginFlipUniform(layer.bottomLeftOrigin());
-    bgfx::submit(submit_pass, ProgramCache::programHandle(SampleRegion::vertexShader(),
-                                                          SampleRegion::fragmentShader()));
+    float alpha = batches[0].shapes->front().alpha;
+    setUniform<Uniforms::kColorMult>(submit_pass, value, value, value, alpha);
+    setOriginFlipUniform(layer.bottomLeftOrigin(), submit_pass);
+    submitQuads(submit_pass, ProgramCache::programHandle(SampleRegion::vertexShader(),
+                                                         SampleRegion::fragmentShader()));
   }
 }
\ No newline at end of file
@@ -25,6 +25,7 @@
 #include "post_effects.h"
 #include "shapes.h"
 #include "visage_utils/space.h"
+#include "visage_utils/thread_utils.h"
 
 #include <algorithm>
 #include <numeric>
@@ -41,10 +42,84 @@ namespace visage {
     return std::count_if(invalid_rects.begin(), invalid_rects.end(), check_overlap);
   }
 
+  inline int numShapePieces(const ShapeBounds& bounds, int x, int y,
+                            const std::vector<IBounds>& invalid_rects) {
+    int total = 0;
+    for (const IBounds& invalid_rect : invalid_rects)
+      total += bounds.numVisible(invalid_rect.x() - x, invalid_rect.y() - y, invalid_rect.width(),
+                                 invalid_rect.height());
+    return total;
+  }
+
+  template<typename T>
+  int computeVisibility(const BatchVector<T>& batches, std::vector<uint8_t>& visibility) {
+    size_t total_pieces = 0;
+    for (const auto& batch : batches)
+      total_pieces += batch.shapes->size() * batch.invalid_rects->size();
+    visibility.resize(total_pieces);
+
+    int count = 0;
+    uint8_t* mask = visibility.data();
+    for (const auto& batch : batches) {
+      int num_shapes = batch.shapes->size();
+      for (const IBounds& invalid_rect : *batch.invalid_rects) {
+        float x = invalid_rect.x() - batch.x;
+        float y = invalid_rect.y() - batch.y;
+        if (batch.bounds)
+          count += batch.bounds->visibleMask(x, y, invalid_rect.width(), invalid_rect.height(), mask);
+        else {
+          for (int i = 0; i < num_shapes; ++i) {
+            const T& shape = (*batch.shapes)[i];
+            mask[i] = !shape.totallyClamped(shape.clamp.clamp(x, y, invalid_rect.width(),
+                                                              invalid_rect.height()));
+            count += mask[i];
+          }
+        }
+        mask += num_shapes;
+      }
+    }
+    return count;
+  }
+
+  template<typename T, typename F>
+  void forEachVisiblePiece(const DrawBatch<T>& batch, const uint8_t* mask, int shape_begin,
+                           int shape_end, F& callback) {
+    int num_shapes = batch.shapes->size();
+    int num_rects = batch.invalid_rects->size();
+    for (int i = shape_begin; i < shape_end; ++i) {
+      const T& shape = (*batch.shapes)[i];
+      for (int r = 0; r < num_rects; ++r) {
+        if (!mask[r * num_shapes + i])
+          continue;
+
+        const IBounds& invalid_rect = (*batch.invalid_rects)[r];
+        ClampBounds clamp = shape.clamp.clamp(invalid_rect.x() - batch.x, invalid_rect.y() - batch.y,
+                                              invalid_rect.width(), invalid_rect.height());
+        callback(batch, shape, clamp.withOffset(batch.x, batch.y));
+      }
+    }
+  }
+
+  template<typename T, typename F>
+  void forEachVisiblePiece(const BatchVector<T>& batches, const std::vector<uint8_t>& visibility,
+                           F callback) {
+    const uint8_t* mask = visibility.data();
+    for (const auto& batch : batches) {
+      int num_shapes = batch.shapes->size();
+      forEachVisiblePiece(batch, mask, 0, num_shapes, callback);
+      mask += num_shapes * batch.invalid_rects->size();
+    }
+  }
+
   template<typename T>
   int numShapes(const BatchVector<T>& batches) {
     int total_size = 0;
     for (const auto& batch : batches) {
+      if (batch.bounds) {
+        total_size += numShapePieces(*batch.bounds, batch.x, batch.y, *batch.invalid_rects);
+        continue;
+      }
+
       auto count_pieces = [&batch](int sum, const T& shape) {
         return sum + numShapePieces(shape, batch.x, batch.y, *batch.invalid_rects);
       };
@@ -53,10 +128,50 @@ namespace visage {
     return total_size;
   }
 
-  void setUniformDimensions(int width, int height);
-  void setOriginFlipUniform(bool origin_flip);
+  void setUniformDimensions(int width, int height, int submit_pass);
+  void setOriginFlipUniform(bool origin_flip, int submit_pass);
   void setBlendMode(BlendMode draw_state);
 
+  // Stencil clips nest up to one per bit of the 8 bit stencil buffer. Draws at a depth above zero
+  // only land inside every clip above them, and stencil blend modes only mark a clip when
+  // clips is set.
+  static constexpr int kMaxStencilClipDepth = 8;
+  void setStencilClipDepth(int depth, bool clips = false);
+
+  struct TransientBufferUsage {
+    int vertex_bytes = 0;
+    int index_bytes = 0;
+    int split_draws = 0;
+    int fallback_draws = 0;
+  };
+
+  // Quads that don't fit one 16 bit indexed draw or the transient space left in the frame are
+  // staged on the CPU and drawn in pieces by submitQuads. Pieces that find no transient space
+  // left go through static buffers that are destroyed once the frame is rendered, so very large
+  // scenes get slower instead of losing geometry.
+  class TransientBuffers {
+  public:
+    static constexpr int kMaxQuadsPerDraw = (1 << 16) / kVerticesPerQuad;
+
+    static const TransientBufferUsage& frameUsage() { return usage(); }
+    static const TransientBufferUsage& lastFrameUsage() { return lastUsage(); }
+    static void nextFrame() {
+      lastUsage() = usage();
+      usage() = {};
+    }
+
+    static TransientBufferUsage& usage() {
+      static TransientBufferUsage usage;
+      return usage;
+    }
+
+  private:
+    static TransientBufferUsage& lastUsage() {
+      static TransientBufferUsage usage;
+      return usage;
+    }
+  };
+
   bool initTransientQuadBuffers(int num_quads, const bgfx::VertexLayout& layout,
                                 bgfx::TransientVertexBuffer* vertex_buffer,
                                 bgfx::TransientIndexBuffer* index_buffer);
@@ -65,19 +180,23 @@ namespace visage {
   T* initQuadVertices(int num_quads) {
     return reinterpret_cast<T*>(initQuadVerticesWithLayout(num_quads, T::layout()));
   }
+  // Submits the quads set up by initQuadVertices, in as many draws as they need.
+  void submitQuads(int submit_pass, bgfx::ProgramHandle program);
 
   void submitShapes(const Layer& layer, const EmbeddedFile& vertex_shader,
                     const EmbeddedFile& fragment_shader, bool radial_gradient, int submit_pass);
 
-  void setImageAtlasUniform(const BatchVector<ImageWrapper>& batches);
-  void setGraphDataUniform(const BatchVector<GraphLineWrapper>& batches);
-  void setGraphDataUniform(const BatchVector<GraphFillWrapper>& batches);
-  void setHeatMapDataUniform(const BatchVector<HeatMapWrapper>& batches);
-  void setPathDataUniform(const BatchVector<PathFillWrapper>& batches);
+  void setImageAtlasUniform(const BatchVector<ImageWrapper>& batches, int submit_pass);
+  void setGraphDataUniform(const BatchVector<GraphLineWrapper>& batches, int submit_pass);
+  void setGraphDataUniform(const BatchVector<GraphFillWrapper>& batches, int submit_pass);
+  void setHeatMapDataUniform(const BatchVector<HeatMapWrapper>& batches, int submit_pass);
+  void setPathDataUniform(const BatchVector<PathFillWrapper>& batches, int submit_pass);
+  void setPathStripUniform(const BatchVector<PathStripWrapper>& batches, int submit_pass);
 
   void submitText(const BatchVector<TextBlock>& batches, const Layer& layer, int submit_pass);
   void submitShader(const BatchVector<ShaderWrapper>& batches, const Layer& layer, int submit_pass);
   void submitSampleRegions(const BatchVector<SampleRegion>& batches, const Layer& layer, int submit_pass);
+  void submitShapeLists(const BatchVector<ShapeListWrapper>& batches, Layer& layer, int submit_pass);
 
   template<typename V>
   struct QuadVertices {
@@ -87,46 +206,231 @@ namespace visage {
   };
 
   template<typename T>
-  QuadVertices<typename T::Vertex> setupQuads(const BatchVector<T>& batches) {
+  int writeQuadVertices(const BatchVector<T>& batches, const std::vector<uint8_t>& visibility,
+                        typename T::Vertex* vertices, bool& radial_gradient) {
+    int vertex_index = 0;
+    auto write_quad = [&](const DrawBatch<T>& batch, const T& shape, ClampBounds clamp) {
+      setQuadPositions(vertices + vertex_index, shape, clamp, batch.x, batch.y);
+      shape.setVertexData(vertices + vertex_index);
+      radial_gradient = shape.radialGradient();
+      vertex_index += kVerticesPerQuad;
+    };
+    forEachVisiblePiece(batches, visibility, write_quad);
+    return vertex_index;
+  }
+
+  struct QuadRange {
+    int batch = 0;
+    size_t mask_offset = 0;
+    int shape_begin = 0;
+    int shape_end = 0;
+    int quad_offset = 0;
+  };
+
+  template<typename T>
+  std::vector<QuadRange> quadRanges(const BatchVector<T>& batches,
+                                    const std::vector<uint8_t>& visibility, int shapes_per_range) {
+    std::vector<QuadRange> ranges;
+    size_t mask_offset = 0;
+    int quad_offset = 0;
+    for (int b = 0; b < batches.size(); ++b) {
+      int num_shapes = batches[b].shapes->size();
+      int num_rects = batches[b].invalid_rects->size();
+      const uint8_t* mask = visibility.data() + mask_offset;
+      for (int begin = 0; begin < num_shapes; begin += shapes_per_range) {
+        int end = std::min(num_shapes, begin + shapes_per_range);
+        ranges.push_back({ b, mask_offset, begin, end, quad_offset });
+        for (int r = 0; r < num_rects; ++r) {
+          const uint8_t* rect_mask = mask + r * num_shapes;
+          quad_offset += std::accumulate(rect_mask + begin, rect_mask + end, 0);
+        }
+      }
+      mask_offset += num_shapes * num_rects;
+    }
+    return ranges;
+  }
+
+  template<typename T>
+  int writeQuadVertices(const BatchVector<T>& batches, const std::vector<uint8_t>& visibility,
+                        typename T::Vertex* vertices, bool& radial_gradient, WorkerPool* worker_pool,
+                        int num_quads) {
+    static constexpr int kMinParallelQuads = 2048;
+    static constexpr int kShapesPerRange = 256;
+
+    if (worker_pool == nullptr || worker_pool->numThreads() == 0 || num_quads < kMinParallelQuads)
+      return writeQuadVertices(batches, visibility, vertices, radial_gradient);
+
+    std::vector<QuadRange> ranges = quadRanges(batches, visibility, kShapesPerRange);
+    std::vector<uint8_t> radial(ranges.size(), 0);
+    std::vector<uint8_t> written(ranges.size(), 0);
+    worker_pool->parallelFor(static_cast<int>(ranges.size()), [&](int index) {
+      const QuadRange& range = ranges[index];
+      int vertex_index = range.quad_offset * kVerticesPerQuad;
+      auto write_quad = [&](const DrawBatch<T>& batch, const T& shape, ClampBounds clamp) {
+        setQuadPositions(vertices + vertex_index, shape, clamp, batch.x, batch.y);
+        shape.setVertexData(vertices + vertex_index);
+        radial[index] = shape.radialGradient();
+        written[index] = true;
+        vertex_index += kVerticesPerQuad;
+      };
+      const uint8_t* mask = visibility.data() + range.mask_offset;
+      forEachVisiblePiece(batches[range.batch], mask, range.shape_begin, range.shape_end, write_quad);
+    });
+
+    for (int i = ranges.size() - 1; i >= 0; --i) {
+      if (written[i]) {
+        radial_gradient = radial[i];
+        break;
+      }
+    }
+    return num_quads * kVerticesPerQuad;
+  }
+
+  WorkerPool* vertexWorkerPool(const Layer& layer);
+
+  template<typename T>
+  QuadVertices<typename T::Vertex> setupQuads(const BatchVector<T>& batches,
+                                              WorkerPool* worker_pool = nullptr) {
     QuadVertices<typename T::Vertex> results;
-    results.num_shapes = numShapes(batches);
+    std::vector<uint8_t> visibility;
+    results.num_shapes = computeVisibility(batches, visibility);
     if (results.num_shapes == 0)
       return results;
 
     results.vertices = initQuadVertices<typename T::Vertex>(results.num_shapes);
     if (results.vertices == nullptr)
       return results;
-    int vertex_index = 0;
 
-    for (const auto& batch : batches) {
-      for (const T& shape : *batch.shapes) {
-        for (const IBounds& invalid_rect : *batch.invalid_rects) {
-          ClampBounds clamp = shape.clamp.clamp(invalid_rect.x() - batch.x, invalid_rect.y() - batch.y,
-                                                invalid_rect.width(), invalid_rect.height());
-          if (shape.totallyClamped(clamp))
-            continue;
-
-          clamp = clamp.withOffset(batch.x, batch.y);
-          setQuadPositions(results.vertices + vertex_index, shape, clamp, batch.x, batch.y);
-          shape.setVertexData(results.vertices + vertex_index);
-          results.radial_gradient = shape.radialGradient();
-          vertex_index += kVerticesPerQuad;
-        }
-      }
+    int num_vertices = writeQuadVertices(batches, visibility, results.vertices,
+                                         results.radial_gradient, worker_pool, results.num_shapes);
+    VISAGE_ASSERT(num_vertices == results.num_shapes * kVerticesPerQuad);
+    return results;
+  }
+
+  template<typename T>
+  struct InstancedQuads {
+    static constexpr bool kSupported = false;
+  };
+
+  template<>
+  struct InstancedQuads<Rectangle> {
+    static constexpr bool kSupported = true;
+  };
+
+  template<>
+  struct InstancedQuads<RoundedRectangle> {
+    static constexpr bool kSupported = true;
+  };
+
+  template<>
+  struct InstancedQuads<Circle> {
+    static constexpr bool kSupported = true;
+  };
+
+  template<>
+  struct InstancedQuads<Squircle> {
+    static constexpr bool kSupported = true;
+  };
+
+  template<>
+  struct InstancedQuads<Diamond> {
+    static constexpr bool kSupported = true;
+  };
+
+  // Shapes that can mark a stencil clip discard the pixels outside them instead of blending.
+  template<typename T>
+  struct StencilShader {
+    static constexpr bool kSupported = false;
+  };
+
+  template<>
+  struct StencilShader<RoundedRectangle> {
+    static constexpr bool kSupported = true;
+  };
+
+  template<>
+  struct StencilShader<PathFillWrapper> {
+    static constexpr bool kSupported = true;
+  };
+
+  template<typename T>
+  const EmbeddedFile& shapeFragmentShader(BlendMode state) {
+    if constexpr (StencilShader<T>::kSupported) {
+      if (state == BlendMode::StencilClip)
+        return T::stencilFragmentShader();
     }
+    return T::fragmentShader();
+  }
 
-    VISAGE_ASSERT(vertex_index == results.num_shapes * kVerticesPerQuad);
-    return results;
+  ShapeInstance* initShapeInstances(int num_shapes);
+  void submitInstancedShapes(const Layer& layer, const EmbeddedFile& fragment_shader, int submit_pass);
+
+  template<typename T>
+  void setInstanceData(ShapeInstance* instance, const T& shape, const ClampBounds& clamp, int x, int y) {
+    ShapeVertex vertices[kVerticesPerQuad];
+    setQuadPositions(vertices, shape, clamp, x, y);
+    shape.setVertexData(vertices);
+
+    instance->x = vertices[0].x;
+    instance->y = vertices[0].y;
+    instance->width = vertices[0].dimension_x;
+    instance->height = vertices[0].dimension_y;
+    instance->clamp_left = clamp.left;
+    instance->clamp_top = clamp.top;
+    instance->clamp_right = clamp.right;
+    instance->clamp_bottom = clamp.bottom;
+    instance->gradient_texture_position = vertices[0].gradient_texture_position;
+    instance->gradient_from_x = vertices[0].gradient.from_x;
+    instance->gradient_from_y = vertices[0].gradient.from_y;
+    instance->gradient_to_x = vertices[0].gradient.to_x;
+    instance->gradient_to_y = vertices[0].gradient.to_y;
+    instance->thickness = vertices[0].thickness;
+    instance->fade = vertices[0].fade;
+    instance->value1 = vertices[0].value1;
+    instance->value2 = vertices[0].value2;
+  }
+
+  template<typename T>
+  bool submitInstancedShapes(const BatchVector<T>& batches, BlendMode state, Layer& layer, int submit_pass) {
+    if (batches.empty() || batches[0].shapes->empty() || batches[0].shapes->front().radialGradient())
+      return false;
+
+    std::vector<uint8_t> visibility;
+    int num_shapes = computeVisibility(batches, visibility);
+    if (num_shapes == 0)
+      return true;
+
+    ShapeInstance* instances = initShapeInstances(num_shapes);
+    if (instances == nullptr)
+      return false;
+
+    int instance_index = 0;
+    auto write_instance = [&](const DrawBatch<T>& batch, const T& shape, ClampBounds clamp) {
+      setInstanceData(instances + instance_index, shape, clamp, batch.x, batch.y);
+      instance_index++;
+    };
+    forEachVisiblePiece(batches, visibility, write_instance);
+
+    VISAGE_ASSERT(instance_index == num_shapes);
+    setBlendMode(state);
+    submitInstancedShapes(layer, shapeFragmentShader<T>(state), submit_pass);
+    return true;
   }
 
   template<typename T>
   static void submitBaseShapes(const BatchVector<T>& batches, BlendMode state, Layer& layer, int submit_pass) {
-    auto quads = setupQuads(batches);
+    if constexpr (InstancedQuads<T>::kSupported) {
+      if (submitInstancedShapes(batches, state, layer, submit_pass))
+        return;
+    }
+
+    auto quads = setupQuads(batches, vertexWorkerPool(layer));
     if (quads.vertices == nullptr)
       return;
 
     setBlendMode(state);
-    submitShapes(layer, T::vertexShader(), T::fragmentShader(), quads.radial_gradient, submit_pass);
+    submitShapes(layer, T::vertexShader(), shapeFragmentShader<T>(state), quads.radial_gradient,
+                 submit_pass);
   }
 
   template<typename T>
@@ -138,7 +442,7 @@ namespace visage {
   inline void submitShapes<PathFillWrapper>(const BatchVector<PathFillWrapper>& batches,
                                             BlendMode state, Layer& layer, int submit_pass) {
     setBlendMode(state);
-    setPathDataUniform(batches);
+    setPathDataUniform(batches, submit_pass);
     submitBaseShapes(batches, state, layer, submit_pass);
   }
 
@@ -146,7 +450,15 @@ namespace visage {
   inline void submitShapes<ImageWrapper>(const BatchVector<ImageWrapper>& batches, BlendMode state,
                                          Layer& layer, int submit_pass) {
     setBlendMode(state);
-    setImageAtlasUniform(batches);
+    setImageAtlasUniform(batches, submit_pass);
+    submitBaseShapes(batches, state, layer, submit_pass);
+  }
+
+  template<>
+  inline void submitShapes<PathStripWrapper>(const BatchVector<PathStripWrapper>& batches,
+                                             BlendMode state, Layer& layer, int submit_pass) {
+    setBlendMode(state);
+    setPathStripUniform(batches, submit_pass);
     submitBaseShapes(batches, state, layer, submit_pass);
   }
 
@@ -154,7 +466,7 @@ namespace visage {
   inline void submitShapes<GraphLineWrapper>(const BatchVector<GraphLineWrapper>& batches,
                                              BlendMode state, Layer& layer, int submit_pass) {
     setBlendMode(state);
-    setGraphDataUniform(batches);
+    setGraphDataUniform(batches, submit_pass);
     submitBaseShapes(batches, state, layer, submit_pass);
   }
 
@@ -162,7 +474,7 @@ namespace visage {
   inline void submitShapes<GraphFillWrapper>(const BatchVector<GraphFillWrapper>& batches,
                                              BlendMode state, Layer& layer, int submit_pass) {
     setBlendMode(state);
-    setGraphDataUniform(batches);
+    setGraphDataUniform(batches, submit_pass);
     submitBaseShapes(batches, state, layer, submit_pass);
   }
 
@@ -170,7 +482,7 @@ namespace visage {
   inline void submitShapes<HeatMapWrapper>(const BatchVector<HeatMapWrapper>& batches,
                                            BlendMode state, Layer& layer, int submit_pass) {
     setBlendMode(state);
-    setHeatMapDataUniform(batches);
+    setHeatMapDataUniform(batches, submit_pass);
     submitBaseShapes(batches, state, layer, submit_pass);
   }
 
@@ -201,6 +513,12 @@ namespace visage {
     }
   }
 
+  template<>
+  inline void submitShapes<ShapeListWrapper>(const BatchVector<ShapeListWrapper>& batches,
+                                             BlendMode state, Layer& layer, int submit_pass) {
+    submitShapeLists(batches, layer, submit_pass);
+  }
+
   class SubmitBatch;
 
   struct PositionedBatch {
@@ -210,21 +528,69 @@ namespace visage {
     int y = 0;
   };
 
+  class AreaGrid {
+  public:
+    static constexpr int kCellSize = 64;
+    static constexpr int kMinGridAreas = 32;
+    static constexpr int kMaxCellsPerArea = 16;
+
+    void add(float x, float y, float right, float bottom);
+    bool overlaps(float x, float y, float right, float bottom) const;
+
+    // Cells keep their storage, so redrawing the same shapes doesn't allocate.
+    void clear() {
+      areas_.clear();
+      for (auto& cell : cells_)
+        cell.second.clear();
+      large_areas_.clear();
+    }
+
+    int numAreas() const { return areas_.size(); }
+
+  private:
+    struct Area {
+      float x, y, right, bottom;
+
+      bool overlaps(float other_x, float other_y, float other_right, float other_bottom) const {
+        return other_x < right && other_right > x && other_y < bottom && other_bottom > y;
+      }
+    };
+
+    struct CellRange {
+      int left, top, right, bottom;
+
+      int numCells() const { return (right - left + 1) * (bottom - top + 1); }
+    };
+
+    static CellRange cellRange(float x, float y, float right, float bottom);
+    static uint64_t cellKey(int x, int y) {
+      return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+    }
+
+    void index(int area_index);
+
+    std::vector<Area> areas_;
+    std::map<uint64_t, std::vector<int>> cells_;
+    std::vector<int> large_areas_;
+  };
+
   class SubmitBatch {
   public:
     explicit SubmitBatch(BlendMode blend_mode) : blend_mode_(blend_mode) { }
     virtual ~SubmitBatch() = default;
     virtual void clear() = 0;
+    virtual void setPersistent(bool persistent) = 0;
     virtual void submit(Layer& layer, int submit_pass, const std::vector<PositionedBatch>& others) = 0;
+    // Draws the shapes clamped to area from a vertex buffer kept between frames, moved by x, y
+    // with the bounds uniform and scissored to each of rects. Returns false for shapes that
+    // can't be kept in a buffer, which have to be submitted instead.
+    virtual bool submitRetained(Layer& layer, int submit_pass, std::vector<IBounds>* area, int x,
+                                int y, const std::vector<IBounds>& rects) = 0;
+    // Adds a fill covering the quad of every shape, for debug views of what a batch rasterizes.
+    virtual void addDebugFills(std::vector<Fill>& fills, const PackedBrush* brush) const = 0;
 
     bool overlapsShape(const BaseShape& shape) const {
-      int x = shape.x;
-      int y = shape.y;
-      int right = shape.x + shape.width;
-      int bottom = shape.y + shape.height;
-      return std::any_of(areas_.begin(), areas_.end(), [x, y, right, bottom](auto& area) {
-        return x < area.right && right > area.x && y < area.bottom && bottom > area.y;
-      });
+      return area_grid_.overlaps(shape.x, shape.y, shape.x + shape.width, shape.y + shape.height);
     }
 
     const void* id() const { return id_; }
@@ -256,25 +622,188 @@ namespace visage {
       return 0;
     }
 
-    void clearAreas() { areas_.clear(); }
+    uint64_t version() const { return version_; }
+
+    void clearAreas() {
+      area_grid_.clear();
+      version_++;
+    }
     void addShapeArea(const BaseShape& shape) {
       VISAGE_ASSERT(id_ == nullptr || id_ == shape.batch_id);
+      version_++;
       id_ = shape.batch_id;
       radial_gradient_ = shape.radialGradient();
-      areas_.push_back({ shape.x, shape.y, shape.x + shape.width, shape.y + shape.height });
+      area_grid_.add(shape.x, shape.y, shape.x + shape.width, shape.y + shape.height);
     }
 
   private:
-    struct Area {
-      float x, y, right, bottom;
-    };
-
     const void* id_ = nullptr;
-    std::vector<Area> areas_;
+    AreaGrid area_grid_;
     BlendMode blend_mode_;
     bool radial_gradient_ = false;
+    uint64_t version_ = 0;
+  };
+
+  // Batches left by destroyed ShapeBatchers, handed to new ones by batch id so regions that are
+  // rebuilt constantly reuse shape and area storage. Ids nobody gave or took for
+  // kReleaseIdleSubmits frames are dropped so one-off shapes don't hold their storage forever.
+  class SubmitBatchPool {
+  public:
+    static constexpr int kMaxBatchesPerId = 64;
+    static constexpr int kReleaseIdleSubmits = 60;
+
+    static SubmitBatchPool& instance() {
+      static SubmitBatchPool instance;
+      return instance;
+    }
+
+    std::unique_ptr<SubmitBatch> take(const void* id) {
+      auto found = batches_.find(id);
+      if (found == batches_.end() || found->second.batches.empty())
+        return nullptr;
+
+      found->second.last_used = submit_;
+      std::unique_ptr<SubmitBatch> batch = std::move(found->second.batches.back());
+      found->second.batches.pop_back();
+      return batch;
+    }
+
+    void give(std::unique_ptr<SubmitBatch> batch) {
+      PooledBatches& pooled = batches_[batch->id()];
+      pooled.last_used = submit_;
+      if (pooled.batches.size() >= kMaxBatchesPerId)
+        return;
+
+      batch->clear();
+      batch->setPersistent(false);
+      pooled.batches.push_back(std::move(batch));
+    }
+
+    void nextFrame() {
+      submit_++;
+      for (auto it = batches_.begin(); it != batches_.end();) {
+        if (submit_ - it->second.last_used >= kReleaseIdleSubmits)
+          it = batches_.erase(it);
+        else
+          ++it;
+      }
+    }
+
+    int size() const {
+      int result = 0;
+      for (const auto& pooled : batches_)
+        result += pooled.second.batches.size();
+      return result;
+    }
+    void clear() { batches_.clear(); }
+
+  private:
+    struct PooledBatches {
+      std::vector<std::unique_ptr<SubmitBatch>> batches;
+      uint64_t last_used = 0;
+    };
+
+    std::map<const void*, PooledBatches> batches_;
+    uint64_t submit_ = 0;
+  };
+
+  template<typename T>
+  struct PersistentQuads {
+    static constexpr bool kSupported = true;
+  };
+
+  template<>
+  struct PersistentQuads<PathFillWrapper> {
+    static constexpr bool kSupported = false;
+  };
+
+  template<>
+  struct PersistentQuads<PathStripWrapper> {
+    static constexpr bool kSupported = false;
+  };
+
+  template<>
+  struct PersistentQuads<ImageWrapper> {
+    static constexpr bool kSupported = false;
+  };
+
+  template<>
+  struct PersistentQuads<GraphLineWrapper> {
+    static constexpr bool kSupported = false;
+  };
+
+  template<>
+  struct PersistentQuads<GraphFillWrapper> {
+    static constexpr bool kSupported = false;
+  };
+
+  template<>
+  struct PersistentQuads<HeatMapWrapper> {
+    static constexpr bool kSupported = false;
+  };
+
+  template<>
+  struct PersistentQuads<ShaderWrapper> {
+    static constexpr bool kSupported = false;
+  };
+
+  template<>
+  struct PersistentQuads<TextBlock> {
+    static constexpr bool kSupported = false;
+  };
+
+  template<>
+  struct PersistentQuads<SampleRegion> {
+    static constexpr bool kSupported = false;
+  };
+
+  template<>
+  struct PersistentQuads<ShapeListWrapper> {
+    static constexpr bool kSupported = false;
+  };
+
+  struct PersistentQuadBufferHandles;
+
+  class PersistentQuadBuffer {
+  public:
+    static constexpr int kMaxQuads = (1 << 16) / kVerticesPerQuad;
+
+    PersistentQuadBuffer();
+    ~PersistentQuadBuffer();
+
+    bool matches(const std::vector<PositionedBatch>& batches, const Layer& layer) const;
+    bool update(const std::vector<PositionedBatch>& batches, const Layer& layer, const void* vertices,
+                int num_quads, const bgfx::VertexLayout& layout, bool radial_gradient);
+    void setBuffers() const;
+    void clear();
+
+    int numQuads() const { return num_quads_; }
+    bool radialGradient() const { return radial_gradient_; }
+
+  private:
+    struct Source {
+      const SubmitBatch* batch = nullptr;
+      uint64_t version = 0;
+      int x = 0;
+      int y = 0;
+      std::vector<IBounds> invalid_rects;
+    };
+
+    std::unique_ptr<PersistentQuadBufferHandles> handles_;
+    std::vector<Source> sources_;
+    const GradientAtlas* gradient_atlas_ = nullptr;
+    int gradient_atlas_version_ = 0;
+    uint64_t palette_color_version_ = 0;
+    int num_quads_ = 0;
+    int capacity_ = 0;
+    bool radial_gradient_ = false;
   };
 
+  void submitRetainedShapes(const PersistentQuadBuffer& buffer, BlendMode blend_mode,
+                            const Layer& layer, const EmbeddedFile& vertex_shader,
+                            const EmbeddedFile& fragment_shader, int x, int y,
+                            const std::vector<IBounds>& rects, int submit_pass);
+
   template<typename T>
   class ShapeBatch : public SubmitBatch {
   public:
@@ -284,6 +813,7 @@ namespace visage {
     void clear() override {
       clearAreas();
       shapes_.clear();
+      bounds_.clear();
     }
 
     void submit(Layer& layer, int submit_pass, const std::vector<PositionedBatch>& batches) override {
@@ -291,29 +821,127 @@ namespace visage {
       batch_list.reserve(batches.size());
       for (const PositionedBatch& batch : batches) {
         VISAGE_ASSERT(batch.batch->id() == id());
-        const std::vector<T>* shapes = &reinterpret_cast<ShapeBatch<T>*>(batch.batch)->shapes_;
-        batch_list.emplace_back(shapes, batch.invalid_rects, batch.x, batch.y);
+        auto shape_batch = reinterpret_cast<ShapeBatch<T>*>(batch.batch);
+        batch_list.emplace_back(&shape_batch->shapes_, batch.invalid_rects, batch.x, batch.y,
+                                &shape_batch->bounds_);
+      }
+      if constexpr (PersistentQuads<T>::kSupported) {
+        if (persistent_ && submitPersistent(batch_list, batches, layer, submit_pass))
+          return;
       }
       submitShapes(batch_list, blendMode(), layer, submit_pass);
     }
 
+    bool submitRetained(Layer& layer, int submit_pass, std::vector<IBounds>* area, int x, int y,
+                        const std::vector<IBounds>& rects) override {
+      if constexpr (PersistentQuads<T>::kSupported) {
+        std::vector<PositionedBatch> batches = { { this, area, 0, 0 } };
+        BatchVector<T> batch_list;
+        batch_list.emplace_back(&shapes_, area, 0, 0, &bounds_);
+        if (!updateQuadBuffer(batch_list, batches, layer))
+          return false;
+
+        if (quad_buffer_->numQuads()) {
+          submitRetainedShapes(*quad_buffer_, blendMode(), layer, T::vertexShader(),
+                               shapeFragmentShader<T>(blendMode()), x, y, rects, submit_pass);
+        }
+        return true;
+      }
+      return false;
+    }
+
+    void addDebugFills(std::vector<Fill>& fills, const PackedBrush* brush) const override {
+      for (const T& shape : shapes_)
+        fills.emplace_back(shape.clamp, brush, shape.x, shape.y, shape.width, shape.height);
+    }
+
     void addShape(T shape) {
       addShapeArea(shape);
+      bounds_.add(shape);
       shapes_.push_back(std::move(shape));
     }
 
+    void addShapes(const T* shapes, int num_shapes) {
+      shapes_.reserve(shapes_.size() + num_shapes);
+      for (int i = 0; i < num_shapes; ++i)
+        addShape(shapes[i]);
+    }
+
+    void setPersistent(bool persistent) override {
+      persistent_ = persistent;
+      if (!persistent_)
+        quad_buffer_.reset();
+    }
+
   private:
+    bool updateQuadBuffer(const BatchVector<T>& batch_list,
+                          const std::vector<PositionedBatch>& batches, Layer& layer) {
+      if (quad_buffer_ == nullptr)
+        quad_buffer_ = std::make_unique<PersistentQuadBuffer>();
+
+      if (!quad_buffer_->matches(batches, layer)) {
+        std::vector<uint8_t> visibility;
+        int num_shapes = computeVisibility(batch_list, visibility);
+        if (num_shapes > PersistentQuadBuffer::kMaxQuads) {
+          quad_buffer_->clear();
+          return false;
+        }
+
+        bool radial_gradient = false;
+        std::vector<typename T::Vertex> vertices(num_shapes * kVerticesPerQuad);
+        writeQuadVertices(batch_list, visibility, vertices.data(), radial_gradient,
+                          vertexWorkerPool(layer), num_shapes);
+        if (!quad_buffer_->update(batches, layer, vertices.data(), num_shapes, T::Vertex::layout(),
+                                  radial_gradient))
+          return false;
+      }
+      return true;
+    }
+
+    bool submitPersistent(const BatchVector<T>& batch_list, const std::vector<PositionedBatch>& batches,
+                          Layer& layer, int submit_pass) {
+      if (!updateQuadBuffer(batch_list, batches, layer))
+        return false;
+
+      if (quad_buffer_->numQuads() == 0)
+        return true;
+
+      quad_buffer_->setBuffers();
+      setBlendMode(blendMode());
+      submitShapes(layer, T::vertexShader(), shapeFragmentShader<T>(blendMode()),
+                   quad_buffer_->radialGradient(), submit_pass);
+      return true;
+    }
+
     std::vector<T> shapes_;
+    ShapeBounds bounds_;
+    std::unique_ptr<PersistentQuadBuffer> quad_buffer_;
+    bool persistent_ = false;
   };
 
   class ShapeBatcher {
   public:
+    ShapeBatcher() = default;
+    ShapeBatcher(const ShapeBatcher&) = delete;
+    ShapeBatcher& operator=(const ShapeBatcher&) = delete;
+
+    ~ShapeBatcher() {
+      SubmitBatchPool& pool = SubmitBatchPool::instance();
+      for (auto& batch : batches_)
+        pool.give(std::move(batch));
+      for (auto& unused : unused_batches_) {
+        for (auto& batch : unused.second)
+          pool.give(std::move(batch));
+      }
+    }
+
     void clear() {
       for (auto& batch : batches_) {
         batch->clear();
         unused_batches_[batch->id()].push_back(std::move(batch));
       }
       batches_.clear();
+      num_shapes_ = 0;
     }
 
     void submit(Layer& layer, int submit_pass) {
@@ -328,7 +956,7 @@ namespace visage {
         SubmitBatch* batch = batches_[i].get();
         if (batch->match(shape.batch_id, blend, shape.radialGradient()))
           match = i;
-        if (batch->overlapsShape(shape))
+        if (batch->overlapsShape(shape) || isStencilBlendMode(batch->blendMode()))
           break;
         if (batch->id() > shape.batch_id)
           insert = i;
@@ -359,10 +987,24 @@ namespace visage {
         batch->setBlendMode(blend);
         batches_.insert(batches_.begin() + insert_index, std::move(batch));
       }
+      else if (auto batch = SubmitBatchPool::instance().take(id)) {
+        batch->setBlendMode(blend);
+        batches_.insert(batches_.begin() + insert_index, std::move(batch));
+      }
       else
         batches_.insert(batches_.begin() + insert_index, std::make_unique<ShapeBatch<T>>(blend));
 
-      return reinterpret_cast<ShapeBatch<T>*>(batches_[insert_index].get());
+      auto batch = reinterpret_cast<ShapeBatch<T>*>(batches_[insert_index].get());
+      batch->setPersistent(persistent_vertex_buffers_);
+      return batch;
+    }
+
+    // Always starts a new batch after the existing ones. Stencil writes rely on this to land
+    // before everything the region draws after them.
+    template<typename T>
+    void appendShape(T shape, BlendMode blend) {
+      createNewBatch<T>(shape.batch_id, blend, batches_.size())->addShape(std::move(shape));
+      num_shapes_++;
     }
 
     template<typename T>
@@ -374,17 +1016,51 @@ namespace visage {
                                      createNewBatch<T>(shape.batch_id, blend, batch_index);
 
       batch->addShape(std::move(shape));
+      num_shapes_++;
+    }
+
+    // Places all shapes in one batch found for their combined area instead of searching per shape.
+    template<typename T>
+    void addShapes(const T* shapes, int num_shapes, BlendMode blend = BlendMode::Alpha) {
+      if (num_shapes <= 0)
+        return;
+
+      BaseShape area = shapes[0];
+      float right = area.x + area.width;
+      float bottom = area.y + area.height;
+      for (int i = 1; i < num_shapes; ++i) {
+        area.x = std::min(area.x, shapes[i].x);
+        area.y = std::min(area.y, shapes[i].y);
+        right = std::max(right, shapes[i].x + shapes[i].width);
+        bottom = std::max(bottom, shapes[i].y + shapes[i].height);
+      }
+      area.width = right - area.x;
+      area.height = bottom - area.y;
+
+      int batch_index = batchIndex(area, blend);
+      bool match = batch_index < batches_.size() &&
+                   batches_[batch_index]->match(area.batch_id, blend, area.radialGradient());
+      ShapeBatch<T>* batch = match ? reinterpret_cast<ShapeBatch<T>*>(batches_[batch_index].get()) :
+                                     createNewBatch<T>(area.batch_id, blend, batch_index);
+
+      batch->addShapes(shapes, num_shapes);
+      num_shapes_ += num_shapes;
     }
 
     void setManualBatching(bool manual) { manual_batching_ = manual; }
+    void setPersistentVertexBuffers(bool persistent) { persistent_vertex_buffers_ = persistent; }
+    bool persistentVertexBuffers() const { return persistent_vertex_buffers_; }
 
     int numBatches() const { return batches_.size(); }
     bool isEmpty() const { return batches_.empty(); }
+    int numShapes() const { return num_shapes_; }
     SubmitBatch* batchAtIndex(int index) const { return batches_[index].get(); }
 
   private:
     std::vector<std::unique_ptr<SubmitBatch>> batches_;
     std::map<const void*, std::vector<std::unique_ptr<SubmitBatch>>> unused_batches_;
     bool manual_batching_ = false;
+    bool persistent_vertex_buffers_ = false;
+    int num_shapes_ = 0;
   };
 }
\ No newline at end of file
@@ -0,0 +1,84 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "shape_list.h"
+
+#include "canvas.h"
+
+#include <cmath>
+
+namespace visage {
+  void ShapeList::record(Canvas& canvas) {
+    float dpi_scale = canvas.dpiScale();
+    if (!isStale(dpi_scale))
+      return;
+
+    stale_ = false;
+    dpi_scale_ = dpi_scale;
+    int width = std::ceil(width_ * dpi_scale);
+    int height = std::ceil(height_ * dpi_scale);
+    region_.setBounds(0, 0, width, height);
+    area_ = { IBounds(0, 0, width, height) };
+
+    canvas.beginRegion(&region_);
+    if (recorder_)
+      recorder_(canvas);
+    canvas.endRegion();
+    num_records_++;
+  }
+
+  void ShapeList::submit(Layer& layer, int submit_pass, int x, int y, std::vector<IBounds>& rects) {
+    for (int i = 0; i < region_.numSubmitBatches(); ++i) {
+      SubmitBatch* batch = region_.submitBatchAtPosition(i);
+      if (!batch->submitRetained(layer, submit_pass, &area_, x, y, rects)) {
+        PositionedBatch positioned = { batch, &rects, x, y };
+        batch->submit(layer, submit_pass, { positioned });
+      }
+    }
+  }
+
+  void submitShapeLists(const BatchVector<ShapeListWrapper>& batches, Layer& layer, int submit_pass) {
+    std::vector<IBounds> rects;
+    for (const DrawBatch<ShapeListWrapper>& batch : batches) {
+      for (const ShapeListWrapper& shape : *batch.shapes) {
+        int x = batch.x + std::round(shape.x);
+        int y = batch.y + std::round(shape.y);
+        int clamp_left = batch.x + std::floor(shape.clamp.left);
+        int clamp_top = batch.y + std::floor(shape.clamp.top);
+        IBounds clamp(clamp_left, clamp_top,
+                      batch.x + std::ceil(shape.clamp.right) - clamp_left,
+                      batch.y + std::ceil(shape.clamp.bottom) - clamp_top);
+        IBounds bounds = clamp.intersection({ x, y, shape.list->nativeWidth(),
+                                              shape.list->nativeHeight() });
+
+        rects.clear();
+        for (const IBounds& invalid_rect : *batch.invalid_rects) {
+          IBounds rect = invalid_rect.intersection(bounds);
+          if (rect.width() > 0 && rect.height() > 0)
+            rects.push_back(rect);
+        }
+
+        if (!rects.empty())
+          shape.list->submit(layer, submit_pass, x, y, rects);
+      }
+    }
+  }
+}
@@ -0,0 +1,84 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "region.h"
+
+#include <functional>
+#include <vector>
+
+namespace visage {
+  class Canvas;
+
+  // Shapes recorded once and kept in GPU vertex buffers between frames. Canvas::shapeList moves
+  // the buffers into place with the bounds uniform, so dense static decorations like grids,
+  // tick marks and scales cost no vertex work when their frame redraws. The recorder runs again
+  // only after invalidate(), a resize or a DPI change. Record primitive shapes only, since
+  // paths, text and images point into atlases that don't keep them between frames.
+  class ShapeList {
+  public:
+    using Recorder = std::function<void(Canvas&)>;
+
+    ShapeList() = default;
+    explicit ShapeList(Recorder recorder) : recorder_(std::move(recorder)) { }
+    ShapeList(const ShapeList&) = delete;
+    ShapeList& operator=(const ShapeList&) = delete;
+
+    void setRecorder(Recorder recorder) {
+      recorder_ = std::move(recorder);
+      invalidate();
+    }
+
+    // Size in logical pixels. Shapes outside it are clipped.
+    void setSize(float width, float height) {
+      if (width == width_ && height == height_)
+        return;
+
+      width_ = width;
+      height_ = height;
+      invalidate();
+    }
+    float width() const { return width_; }
+    float height() const { return height_; }
+    int nativeWidth() const { return region_.width(); }
+    int nativeHeight() const { return region_.height(); }
+
+    void invalidate() { stale_ = true; }
+    bool isStale(float dpi_scale) const { return stale_ || dpi_scale != dpi_scale_; }
+    int numRecords() const { return num_records_; }
+
+    // Runs the recorder into the list if it's stale at the canvas's DPI scale.
+    void record(Canvas& canvas);
+    // Draws every recorded batch at x, y in layer pixels, cut to rects.
+    void submit(Layer& layer, int submit_pass, int x, int y, std::vector<IBounds>& rects);
+
+  private:
+    Recorder recorder_;
+    Region region_;
+    std::vector<IBounds> area_;
+    float width_ = 0.0f;
+    float height_ = 0.0f;
+    float dpi_scale_ = 0.0f;
+    bool stale_ = true;
+    int num_records_ = 0;
+  };
+}
@@ -25,6 +25,14 @@
 #include "layer.h"
 #include "region.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define VISAGE_SHAPE_BOUNDS_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define VISAGE_SHAPE_BOUNDS_NEON 1
+#endif
+
 #define VISAGE_SET_PROGRAM(shape, vertex, fragment) \
   const EmbeddedFile& shape::vertexShader() {       \
     return vertex;                                  \
@@ -43,16 +51,88 @@ namespace visage {
   VISAGE_SET_PROGRAM(RoundedArc, shaders::vs_arc, shaders::fs_rounded_arc)
   VISAGE_SET_PROGRAM(FlatSegment, shaders::vs_complex_shape, shaders::fs_flat_segment)
   VISAGE_SET_PROGRAM(RoundedSegment, shaders::vs_complex_shape, shaders::fs_rounded_segment)
+  VISAGE_SET_PROGRAM(PolylineSegment, shaders::vs_polyline_segment, shaders::fs_rounded_segment)
   VISAGE_SET_PROGRAM(Triangle, shaders::vs_complex_shape, shaders::fs_triangle)
   VISAGE_SET_PROGRAM(QuadraticBezier, shaders::vs_complex_shape, shaders::fs_quadratic_bezier)
   VISAGE_SET_PROGRAM(Diamond, shaders::vs_shape, shaders::fs_diamond)
+  VISAGE_SET_PROGRAM(HsvRectangle, shaders::vs_shape, shaders::fs_hsv_rectangle)
+  VISAGE_SET_PROGRAM(SdfPrimitive, shaders::vs_sdf_primitive, shaders::fs_sdf_primitive)
   VISAGE_SET_PROGRAM(ImageWrapper, shaders::vs_tinted_texture, shaders::fs_tinted_texture)
   VISAGE_SET_PROGRAM(PathFillWrapper, shaders::vs_sample_path, shaders::fs_sample_path)
+  VISAGE_SET_PROGRAM(PathStripWrapper, shaders::vs_tinted_texture, shaders::fs_tinted_texture)
   VISAGE_SET_PROGRAM(GraphLineWrapper, shaders::vs_shape, shaders::fs_graph_line)
   VISAGE_SET_PROGRAM(GraphFillWrapper, shaders::vs_shape, shaders::fs_graph_fill)
   VISAGE_SET_PROGRAM(HeatMapWrapper, shaders::vs_shape, shaders::fs_heat_map)
   VISAGE_SET_PROGRAM(SampleRegion, shaders::vs_post_effect, shaders::fs_post_effect)
 
+  const EmbeddedFile& RoundedRectangle::stencilFragmentShader() {
+    return shaders::fs_stencil_rounded_rectangle;
+  }
+
+  const EmbeddedFile& PathFillWrapper::stencilFragmentShader() {
+    return shaders::fs_stencil_path;
+  }
+
+  int ShapeBounds::visibleMask(float x, float y, float width, float height, uint8_t* mask) const {
+    int num = size();
+    int count = 0;
+    int i = 0;
+
+#if VISAGE_SHAPE_BOUNDS_SSE2
+    __m128 rect_left = _mm_set1_ps(x);
+    __m128 rect_top = _mm_set1_ps(y);
+    __m128 rect_right = _mm_set1_ps(x + width);
+    __m128 rect_bottom = _mm_set1_ps(y + height);
+    for (; i + 4 <= num; i += 4) {
+      __m128 left = _mm_max_ps(_mm_loadu_ps(clamp_left_.data() + i), rect_left);
+      __m128 top = _mm_max_ps(_mm_loadu_ps(clamp_top_.data() + i), rect_top);
+      __m128 right = _mm_min_ps(_mm_loadu_ps(clamp_right_.data() + i), rect_right);
+      __m128 bottom = _mm_min_ps(_mm_loadu_ps(clamp_bottom_.data() + i), rect_bottom);
+
+      __m128 visible = _mm_and_ps(_mm_cmplt_ps(left, right), _mm_cmplt_ps(top, bottom));
+      visible = _mm_and_ps(visible, _mm_cmplt_ps(left, _mm_loadu_ps(right_.data() + i)));
+      visible = _mm_and_ps(visible, _mm_cmpgt_ps(right, _mm_loadu_ps(left_.data() + i)));
+      visible = _mm_and_ps(visible, _mm_cmplt_ps(top, _mm_loadu_ps(bottom_.data() + i)));
+      visible = _mm_and_ps(visible, _mm_cmpgt_ps(bottom, _mm_loadu_ps(top_.data() + i)));
+
+      int bits = _mm_movemask_ps(visible);
+      for (int b = 0; b < 4; ++b)
+        mask[i + b] = (bits >> b) & 1;
+      count += ((bits >> 0) & 1) + ((bits >> 1) & 1) + ((bits >> 2) & 1) + ((bits >> 3) & 1);
+    }
+#elif VISAGE_SHAPE_BOUNDS_NEON
+    float32x4_t rect_left = vdupq_n_f32(x);
+    float32x4_t rect_top = vdupq_n_f32(y);
+    float32x4_t rect_right = vdupq_n_f32(x + width);
+    float32x4_t rect_bottom = vdupq_n_f32(y + height);
+    for (; i + 4 <= num; i += 4) {
+      float32x4_t left = vmaxq_f32(vld1q_f32(clamp_left_.data() + i), rect_left);
+      float32x4_t top = vmaxq_f32(vld1q_f32(clamp_top_.data() + i), rect_top);
+      float32x4_t right = vminq_f32(vld1q_f32(clamp_right_.data() + i), rect_right);
+      float32x4_t bottom = vminq_f32(vld1q_f32(clamp_bottom_.data() + i), rect_bottom);
+
+      uint32x4_t visible = vandq_u32(vcltq_f32(left, right), vcltq_f32(top, bottom));
+      visible = vandq_u32(visible, vcltq_f32(left, vld1q_f32(right_.data() + i)));
+      visible = vandq_u32(visible, vcgtq_f32(right, vld1q_f32(left_.data() + i)));
+      visible = vandq_u32(visible, vcltq_f32(top, vld1q_f32(bottom_.data() + i)));
+      visible = vandq_u32(visible, vcgtq_f32(bottom, vld1q_f32(top_.data() + i)));
+
+      uint32_t lanes[4];
+      vst1q_u32(lanes, vshrq_n_u32(visible, 31));
+      for (int b = 0; b < 4; ++b) {
+        mask[i + b] = lanes[b];
+        count += lanes[b];
+      }
+    }
+#endif
+
+    for (; i < num; ++i) {
+      mask[i] = visible(i, x, y, width, height);
+      count += mask[i];
+    }
+    return count;
+  }
+
   SampleRegion::SampleRegion(const ClampBounds& clamp, const PackedBrush* brush, float x, float y,
                              float width, float height, const Region* region, PostEffect* post_effect) :
       Shape(region->layer(), clamp, brush, x, y, width, height), region(region),
@@ -24,6 +24,7 @@
 #include "gradient.h"
 #include "image.h"
 #include "path.h"
+#include "path_strips.h"
 #include "text.h"
 
 #include <algorithm>
@@ -41,6 +42,7 @@ namespace visage {
   class Region;
   class Layer;
   class Shader;
+  class ShapeList;
 
   static constexpr float kFullThickness = FLT_MAX;
 
@@ -71,21 +73,30 @@ namespace visage {
     }
   };
 
+  class ShapeBounds;
+
   template<typename T>
   struct DrawBatch {
-    DrawBatch(const std::vector<T>* shapes, std::vector<IBounds>* invalid_rects, int x, int y) :
-        shapes(shapes), invalid_rects(invalid_rects), x(x), y(y) { }
+    DrawBatch(const std::vector<T>* shapes, std::vector<IBounds>* invalid_rects, int x, int y,
+              const ShapeBounds* bounds = nullptr) :
+        shapes(shapes), invalid_rects(invalid_rects), x(x), y(y), bounds(bounds) { }
 
     const std::vector<T>* shapes;
     std::vector<IBounds>* invalid_rects;
     int x = 0;
     int y = 0;
+    const ShapeBounds* bounds = nullptr;
   };
 
   template<typename T>
   using BatchVector = std::vector<DrawBatch<T>>;
 
   struct BaseShape {
+    static void* taggedPointer(void* pointer, int tag) {
+      uintptr_t int_value = reinterpret_cast<uintptr_t>(pointer);
+      return reinterpret_cast<void*>(int_value | uintptr_t(tag) & 3);
+    }
+
     BaseShape(const void* batch_id, const ClampBounds& clamp, const PackedBrush* brush, float x,
               float y, float width, float height) :
         batch_id(batch_id), clamp(clamp), brush(brush), x(x), y(y), width(width), height(height) { }
@@ -113,6 +124,79 @@ namespace visage {
     }
   };
 
+  class ShapeBounds {
+  public:
+    void add(const BaseShape& shape) {
+      left_.push_back(shape.x);
+      top_.push_back(shape.y);
+      right_.push_back(shape.x + shape.width);
+      bottom_.push_back(shape.y + shape.height);
+      clamp_left_.push_back(shape.clamp.left);
+      clamp_top_.push_back(shape.clamp.top);
+      clamp_right_.push_back(shape.clamp.right);
+      clamp_bottom_.push_back(shape.clamp.bottom);
+    }
+
+    void clear() {
+      left_.clear();
+      top_.clear();
+      right_.clear();
+      bottom_.clear();
+      clamp_left_.clear();
+      clamp_top_.clear();
+      clamp_right_.clear();
+      clamp_bottom_.clear();
+    }
+
+    int size() const { return left_.size(); }
+
+    bool visible(int index, float x, float y, float width, float height) const {
+      float left = std::max(clamp_left_[index], x);
+      float top = std::max(clamp_top_[index], y);
+      float right = std::min(clamp_right_[index], x + width);
+      float bottom = std::min(clamp_bottom_[index], y + height);
+      return left < right && top < bottom && left < right_[index] && right > left_[index] &&
+             top < bottom_[index] && bottom > top_[index];
+    }
+
+    int visibleMask(float x, float y, float width, float height, uint8_t* mask) const;
+
+    int numVisible(float x, float y, float width, float height) const {
+      const float* shape_left = left_.data();
+      const float* shape_top = top_.data();
+      const float* shape_right = right_.data();
+      const float* shape_bottom = bottom_.data();
+      const float* clamp_left = clamp_left_.data();
+      const float* clamp_top = clamp_top_.data();
+      const float* clamp_right = clamp_right_.data();
+      const float* clamp_bottom = clamp_bottom_.data();
+      float x_end = x + width;
+      float y_end = y + height;
+
+      int count = 0;
+      int num = size();
+      for (int i = 0; i < num; ++i) {
+        float left = std::max(clamp_left[i], x);
+        float top = std::max(clamp_top[i], y);
+        float right = std::min(clamp_right[i], x_end);
+        float bottom = std::min(clamp_bottom[i], y_end);
+        count += (left < right) & (top < bottom) & (left < shape_right[i]) & (right > shape_left[i]) &
+                 (top < shape_bottom[i]) & (bottom > shape_top[i]);
+      }
+      return count;
+    }
+
+  private:
+    std::vector<float> left_;
+    std::vector<float> top_;
+    std::vector<float> right_;
+    std::vector<float> bottom_;
+    std::vector<float> clamp_left_;
+    std::vector<float> clamp_top_;
+    std::vector<float> clamp_right_;
+    std::vector<float> clamp_bottom_;
+  };
+
   template<typename T>
   void setCornerCoordinates(T* vertices) {
     vertices[0].coordinate_x = -1.0f;
@@ -164,11 +248,6 @@ namespace visage {
 
   template<typename VertexType = ShapeVertex>
   struct Primitive : Shape<VertexType> {
-    static void* taggedPointer(void* pointer, int tag) {
-      uintptr_t int_value = reinterpret_cast<uintptr_t>(pointer);
-      return reinterpret_cast<void*>(int_value | uintptr_t(tag) & 3);
-    }
-
     Primitive(const void* batch_id, const ClampBounds& clamp, const PackedBrush* brush, float x,
               float y, float width, float height) :
         Shape<VertexType>(batch_id, clamp, brush, x, y, width, height) { }
@@ -213,6 +292,7 @@ namespace visage {
     VISAGE_CREATE_BATCH_ID
     static const EmbeddedFile& vertexShader();
     static const EmbeddedFile& fragmentShader();
+    static const EmbeddedFile& stencilFragmentShader();
 
     RoundedRectangle(const ClampBounds& clamp, const PackedBrush* brush, float x, float y,
                      float width, float height, float rounding, float pixel_width = 1.0f) :
@@ -364,6 +444,46 @@ namespace visage {
     float b_y = 0.0f;
   };
 
+  struct PolylineSegment : Primitive<ComplexShapeVertex> {
+    VISAGE_CREATE_BATCH_ID
+    static const EmbeddedFile& vertexShader();
+    static const EmbeddedFile& fragmentShader();
+
+    PolylineSegment(const ClampBounds& clamp, const PackedBrush* brush, float x, float y,
+                    float width, float height, float a_x, float a_y, float b_x, float b_y,
+                    float thickness, float line_left, float line_top, float line_right,
+                    float line_bottom) :
+        Primitive(batchId(), clamp, brush, x, y, width, height), a_x(a_x), a_y(a_y), b_x(b_x),
+        b_y(b_y), line_left(line_left), line_top(line_top), line_right(line_right),
+        line_bottom(line_bottom) {
+      this->thickness = thickness;
+    }
+
+    void setVertexData(Vertex* vertices) const {
+      setPrimitiveData(vertices);
+      float offset_x = vertices[0].x - x;
+      float offset_y = vertices[0].y - y;
+      PackedBrush::setVertexGradientPositions(brush, vertices, kVerticesPerQuad, offset_x, offset_y,
+                                              line_left + offset_x, line_top + offset_y,
+                                              line_right + offset_x, line_bottom + offset_y);
+      for (int v = 0; v < kVerticesPerQuad; ++v) {
+        vertices[v].value1 = a_x;
+        vertices[v].value2 = a_y;
+        vertices[v].value3 = b_x;
+        vertices[v].value4 = b_y;
+      }
+    }
+
+    float a_x = 0.0f;
+    float a_y = 0.0f;
+    float b_x = 0.0f;
+    float b_y = 0.0f;
+    float line_left = 0.0f;
+    float line_top = 0.0f;
+    float line_right = 0.0f;
+    float line_bottom = 0.0f;
+  };
+
   struct Triangle : Primitive<ComplexShapeVertex> {
     VISAGE_CREATE_BATCH_ID
     static const EmbeddedFile& vertexShader();
@@ -450,6 +570,117 @@ namespace visage {
     float rounding = 0.0f;
   };
 
+  // Colors are computed in the shader and multiplied by the brush. A negative hue sweeps all hues
+  // from top to bottom, otherwise saturation increases to the right and value upward for that hue.
+  struct HsvRectangle : Primitive<> {
+    VISAGE_CREATE_BATCH_ID
+    static const EmbeddedFile& vertexShader();
+    static const EmbeddedFile& fragmentShader();
+
+    HsvRectangle(const ClampBounds& clamp, const PackedBrush* brush, float x, float y, float width,
+                 float height, float hue) :
+        Primitive(batchId(), clamp, brush, x, y, width, height), hue(hue) { }
+
+    void setVertexData(Vertex* vertices) const {
+      setPrimitiveData(vertices);
+      for (int v = 0; v < kVerticesPerQuad; ++v)
+        vertices[v].value1 = hue;
+    }
+
+    float hue = -1.0f;
+  };
+
+  // Shares one batch and program between the common SDF primitives, selecting the distance
+  // function per vertex. Mixed primitives that overlap then draw in one call instead of being
+  // split into a batch per shape type to keep their order.
+  struct SdfPrimitive : Primitive<> {
+    VISAGE_CREATE_BATCH_ID
+    static const EmbeddedFile& vertexShader();
+    static const EmbeddedFile& fragmentShader();
+
+    enum class Type {
+      Rectangle,
+      RoundedRectangle,
+      Circle,
+      Squircle,
+      Diamond,
+      FlatArc,
+      RoundedArc,
+    };
+
+    explicit SdfPrimitive(const Rectangle& shape) : SdfPrimitive(shape, Type::Rectangle) { }
+    explicit SdfPrimitive(const RoundedRectangle& shape) :
+        SdfPrimitive(shape, Type::RoundedRectangle, shape.rounding) { }
+    explicit SdfPrimitive(const Circle& shape) : SdfPrimitive(shape, Type::Circle) { }
+    explicit SdfPrimitive(const Squircle& shape) : SdfPrimitive(shape, Type::Squircle, shape.power) { }
+    explicit SdfPrimitive(const Diamond& shape) : SdfPrimitive(shape, Type::Diamond, shape.rounding) { }
+    explicit SdfPrimitive(const FlatArc& shape) :
+        SdfPrimitive(shape, Type::FlatArc, shape.center_radians, shape.radians) { }
+    explicit SdfPrimitive(const RoundedArc& shape) :
+        SdfPrimitive(shape, Type::RoundedArc, shape.center_radians, shape.radians) { }
+
+    void setVertexData(Vertex* vertices) const {
+      setPrimitiveData(vertices);
+      for (int v = 0; v < kVerticesPerQuad; ++v) {
+        vertices[v].garbage1 = static_cast<float>(type);
+        vertices[v].value1 = value1;
+        vertices[v].value2 = value2;
+      }
+    }
+
+    Type type = Type::Rectangle;
+    float value1 = 0.0f;
+    float value2 = 0.0f;
+
+  private:
+    SdfPrimitive(const Primitive<>& shape, Type type, float value1 = 0.0f, float value2 = 0.0f) :
+        Primitive(batchId(), shape.clamp, shape.brush, shape.x, shape.y, shape.width, shape.height),
+        type(type), value1(value1), value2(value2) {
+      thickness = shape.thickness;
+      pixel_width = shape.pixel_width;
+    }
+  };
+
+  template<typename T>
+  struct SdfPrimitiveSupport {
+    static constexpr bool kSupported = false;
+  };
+
+  template<>
+  struct SdfPrimitiveSupport<Rectangle> {
+    static constexpr bool kSupported = true;
+  };
+
+  template<>
+  struct SdfPrimitiveSupport<RoundedRectangle> {
+    static constexpr bool kSupported = true;
+  };
+
+  template<>
+  struct SdfPrimitiveSupport<Circle> {
+    static constexpr bool kSupported = true;
+  };
+
+  template<>
+  struct SdfPrimitiveSupport<Squircle> {
+    static constexpr bool kSupported = true;
+  };
+
+  template<>
+  struct SdfPrimitiveSupport<Diamond> {
+    static constexpr bool kSupported = true;
+  };
+
+  template<>
+  struct SdfPrimitiveSupport<FlatArc> {
+    static constexpr bool kSupported = true;
+  };
+
+  template<>
+  struct SdfPrimitiveSupport<RoundedArc> {
+    static constexpr bool kSupported = true;
+  };
+
   struct ImageWrapper : Shape<TextureVertex> {
     static const EmbeddedFile& vertexShader();
     static const EmbeddedFile& fragmentShader();
@@ -458,18 +689,51 @@ namespace visage {
                  float height, const Image& image, ImageAtlas* image_atlas) :
         Shape(image_atlas, clamp, brush, x, y, width, height),
         packed_image(image_atlas->addImage(image)), image_atlas(image_atlas) {
+      batch_id = packed_image.page();
       if (width == 0.0f) {
         this->width = packed_image.w();
         this->height = packed_image.h();
       }
     }
 
+    // Draws the source rect of an image already in the atlas. Source coordinates are in image
+    // pixels and are reversed to mirror the slice. The brush spans gradient_bounds instead of
+    // the slice, so slices of one area share a gradient. The image data is kept alive by data.
+    ImageWrapper(const ClampBounds& clamp, const PackedBrush* brush, float x, float y, float width,
+                 float height, const ImageAtlas::PackedImage& packed_image, ImageAtlas* image_atlas,
+                 float source_left, float source_top, float source_right, float source_bottom,
+                 const Bounds& gradient_bounds, std::shared_ptr<const void> data) :
+        Shape(packed_image.page(), clamp, brush, x, y, width, height), packed_image(packed_image),
+        image_atlas(image_atlas), data(std::move(data)), sliced(true), source_left(source_left),
+        source_top(source_top), source_right(source_right), source_bottom(source_bottom),
+        gradient_bounds(gradient_bounds) { }
+
     void setVertexData(Vertex* vertices) const {
-      image_atlas->setImageCoordinates(vertices, packed_image);
+      if (!sliced) {
+        image_atlas->setImageCoordinates(vertices, packed_image);
+        return;
+      }
+
+      float offset_x = vertices[0].x - x;
+      float offset_y = vertices[0].y - y;
+      float left = gradient_bounds.x() + offset_x;
+      float top = gradient_bounds.y() + offset_y;
+      PackedBrush::setVertexGradientPositions(brush, vertices, kVerticesPerQuad, offset_x, offset_y,
+                                              left, top, left + gradient_bounds.width(),
+                                              top + gradient_bounds.height());
+      image_atlas->setImageCoordinates(vertices, packed_image, source_left, source_top,
+                                       source_right, source_bottom);
     }
 
     ImageAtlas::PackedImage packed_image;
     ImageAtlas* image_atlas = nullptr;
+    std::shared_ptr<const void> data;
+    bool sliced = false;
+    float source_left = 0.0f;
+    float source_top = 0.0f;
+    float source_right = 0.0f;
+    float source_bottom = 0.0f;
+    Bounds gradient_bounds;
   };
 
   struct GraphLineWrapper : Primitive<> {
@@ -479,21 +743,24 @@ namespace visage {
     GraphLineWrapper(const ClampBounds& clamp, const PackedBrush* brush, float x, float y, float width,
                      float height, float thick, const GraphData& graph_data, ImageAtlas* data_atlas) :
         Primitive(data_atlas, clamp, brush, x, y, width, height), data_atlas(data_atlas),
-        data(graph_data), packed_data(data_atlas->addData(data.data(), data.numPoints())) {
+        data(graph_data.sharedData()), ring_offset(graph_data.ringOffset()),
+        packed_data(data_atlas->addGraphData(graph_data)) {
+      batch_id = packed_data.page();
       thickness = thick;
-      pixel_width = packed_data.w() - 1;
+      pixel_width = graph_data.numPoints() - 1;
     }
 
     void setVertexData(Vertex* vertices) const {
       setPrimitiveData(vertices);
       for (int v = 0; v < kVerticesPerQuad; ++v) {
-        vertices[v].value1 = packed_data.x() + 0.5f;
+        vertices[v].value1 = packed_data.x() + ring_offset + 0.5f;
         vertices[v].value2 = packed_data.y() + 0.5f;
       }
     }
 
     ImageAtlas* data_atlas = nullptr;
-    GraphData data;
+    std::shared_ptr<const void> data;
+    int ring_offset = 0;
     ImageAtlas::PackedImage packed_data;
   };
 
@@ -504,22 +771,24 @@ namespace visage {
     GraphFillWrapper(const ClampBounds& clamp, const PackedBrush* brush, float x, float y, float width,
                      float height, float center, const GraphData& graph_data, ImageAtlas* data_atlas) :
         Primitive(taggedPointer(data_atlas, 1), clamp, brush, x, y, width, height),
-        data_atlas(data_atlas), data(graph_data),
-        packed_data(data_atlas->addData(data.data(), data.numPoints())) {
+        data_atlas(data_atlas), data(graph_data.sharedData()), ring_offset(graph_data.ringOffset()),
+        packed_data(data_atlas->addGraphData(graph_data)) {
+      batch_id = taggedPointer(packed_data.page(), 1);
       thickness = center;
-      pixel_width = packed_data.w() - 1;
+      pixel_width = graph_data.numPoints() - 1;
     }
 
     void setVertexData(Vertex* vertices) const {
       setPrimitiveData(vertices);
       for (int v = 0; v < kVerticesPerQuad; ++v) {
-        vertices[v].value1 = packed_data.x() + 0.5f;
+        vertices[v].value1 = packed_data.x() + ring_offset + 0.5f;
         vertices[v].value2 = packed_data.y() + 0.5f;
       }
     }
 
     ImageAtlas* data_atlas = nullptr;
-    GraphData data;
+    std::shared_ptr<const void> data;
+    int ring_offset = 0;
     ImageAtlas::PackedImage packed_data;
   };
 
@@ -530,30 +799,48 @@ namespace visage {
     HeatMapWrapper(const ClampBounds& clamp, const PackedBrush* brush, float x, float y, float width,
                    float height, const HeatMapData& heat_map_data, ImageAtlas* data_atlas) :
         Primitive(taggedPointer(data_atlas, 2), clamp, brush, x, y, width, height),
-        data_atlas(data_atlas), data(heat_map_data),
-        packed_data(data_atlas->addData(data.data(), data.width(), data.height())) {
+        data_atlas(data_atlas), data(heat_map_data.sharedData()),
+        ring_offset(heat_map_data.ringOffset()), data_width(heat_map_data.width()),
+        value_min(heat_map_data.valueMin()), decibels(heat_map_data.decibels()),
+        packed_data(data_atlas->addHeatMapData(heat_map_data)) {
+      batch_id = taggedPointer(packed_data.page(), 2);
       thickness = heat_map_data.height();
       pixel_width = heat_map_data.octaves();
+      float range = heat_map_data.valueMax() - value_min;
+      value_scale = range ? 1.0f / range : 0.0f;
     }
 
     void setVertexData(Vertex* vertices) const {
       setPrimitiveData(vertices);
 
-      vertices[0].value1 = packed_data.x();
+      float left = packed_data.x() + ring_offset;
+      float right = left + data_width;
+      vertices[0].value1 = left;
       vertices[0].value2 = packed_data.y();
 
-      vertices[1].value1 = packed_data.x() + packed_data.w();
+      vertices[1].value1 = right;
       vertices[1].value2 = packed_data.y();
 
-      vertices[2].value1 = packed_data.x();
+      vertices[2].value1 = left;
       vertices[2].value2 = packed_data.y();
 
-      vertices[3].value1 = packed_data.x() + packed_data.w();
+      vertices[3].value1 = right;
       vertices[3].value2 = packed_data.y();
+
+      for (int v = 0; v < kVerticesPerQuad; ++v) {
+        vertices[v].gradient.from_x = decibels ? 1.0f : 0.0f;
+        vertices[v].gradient.from_y = value_min;
+        vertices[v].gradient.to_x = value_scale;
+      }
     }
 
     ImageAtlas* data_atlas = nullptr;
-    HeatMapData data;
+    std::shared_ptr<const void> data;
+    int ring_offset = 0;
+    int data_width = 0;
+    float value_min = 0.0f;
+    float value_scale = 1.0f;
+    bool decibels = false;
     ImageAtlas::PackedImage packed_data;
   };
 
@@ -563,25 +850,17 @@ namespace visage {
     static constexpr float kBuffer = 1.0f;
     static const EmbeddedFile& vertexShader();
     static const EmbeddedFile& fragmentShader();
+    static const EmbeddedFile& stencilFragmentShader();
 
     PathFillWrapper(const ClampBounds& clamp, const PackedBrush* brush, float x, float y,
                     float width, float height, const Path& path, PathAtlas* atlas, float scale) :
         Shape(batchId(), clamp, brush, x, y, width, height), path_atlas(atlas), scale(scale) {
-      Path adjusted_path = scale == 1.0f ? path : path.scaled(scale);
-      Bounds bounding_box = adjusted_path.boundingBox();
-      float new_x = static_cast<int>(x + bounding_box.x() - kBuffer);
-      float new_y = static_cast<int>(y + bounding_box.y() - kBuffer);
-      float new_width = std::ceil(x + bounding_box.right() + kBuffer) - new_x;
-      float new_height = std::ceil(y + bounding_box.bottom() + kBuffer) - new_y;
-
-      float shift_x = new_x - x;
-      float shift_y = new_y - y;
-      this->x = new_x;
-      this->y = new_y;
-      this->width = new_width;
-      this->height = new_height;
-      adjusted_path = adjusted_path.translated(-shift_x, -shift_y);
-      packed_path = atlas->addPath(std::move(adjusted_path), new_width, new_height);
+      PathAtlas::PlacedPath placed = atlas->placePath(path, x, y, scale);
+      this->x = placed.x;
+      this->y = placed.y;
+      this->width = placed.width;
+      this->height = placed.height;
+      packed_path = std::move(placed.packed_path);
     }
 
     void setVertexData(Vertex* vertices) const {
@@ -596,6 +875,60 @@ namespace visage {
     PathAtlas::PackedPath packed_path;
   };
 
+  struct PathStripWrapper : Shape<TextureVertex> {
+    static const EmbeddedFile& vertexShader();
+    static const EmbeddedFile& fragmentShader();
+
+    PathStripWrapper(const ClampBounds& clamp, const PackedBrush* brush, float x, float y,
+                     const PathStrips::Strip& strip, std::shared_ptr<const PathStrips> strips,
+                     const ImageAtlas::PackedImage& packed_alphas, ImageAtlas* image_atlas) :
+        Shape(taggedPointer(packed_alphas.page(), 3), clamp, brush, x + strip.x, y + strip.y,
+              strip.width, strip.height),
+        strip(strip), strips(std::move(strips)), packed_alphas(packed_alphas),
+        image_atlas(image_atlas), path_x(x), path_y(y) { }
+
+    void setVertexData(Vertex* vertices) const {
+      float offset_x = vertices[0].x - x;
+      float offset_y = vertices[0].y - y;
+      float left = path_x + offset_x;
+      float top = path_y + offset_y;
+      PackedBrush::setVertexGradientPositions(brush, vertices, kVerticesPerQuad, offset_x, offset_y,
+                                              left, top, left + strips->width(), top + strips->height());
+
+      float texture_left = packed_alphas.x() + strip.alpha_x;
+      float texture_top = packed_alphas.y() + strip.alpha_y;
+      float texture_right = texture_left + strip.width;
+      float texture_bottom = texture_top + strip.height;
+      float direction = 1.0f;
+      if (strip.solid) {
+        texture_left = texture_right = texture_left + 0.5f;
+        texture_top = texture_bottom = texture_top + 0.5f;
+        direction = 0.0f;
+      }
+
+      vertices[0].texture_x = texture_left;
+      vertices[0].texture_y = texture_top;
+      vertices[1].texture_x = texture_right;
+      vertices[1].texture_y = texture_top;
+      vertices[2].texture_x = texture_left;
+      vertices[2].texture_y = texture_bottom;
+      vertices[3].texture_x = texture_right;
+      vertices[3].texture_y = texture_bottom;
+
+      for (int i = 0; i < kVerticesPerQuad; ++i) {
+        vertices[i].direction_x = direction;
+        vertices[i].direction_y = 0.0f;
+      }
+    }
+
+    PathStrips::Strip strip;
+    std::shared_ptr<const PathStrips> strips;
+    ImageAtlas::PackedImage packed_alphas;
+    ImageAtlas* image_atlas = nullptr;
+    float path_x = 0.0f;
+    float path_y = 0.0f;
+  };
+
   template<typename T>
   class VectorPool {
   public:
@@ -646,26 +979,56 @@ namespace visage {
     std::vector<std::vector<T>> pool_;
   };
 
+  // Keeps objects released by destroyed owners so new owners reuse them instead of allocating.
+  // Callers reset returned objects, the pool only holds the storage.
+  template<typename T>
+  class ObjectPool {
+  public:
+    static constexpr int kMaxPooled = 4096;
+
+    static ObjectPool& instance() {
+      static ObjectPool instance;
+      return instance;
+    }
+
+    std::unique_ptr<T> take() {
+      if (pool_.empty())
+        return std::make_unique<T>();
+
+      std::unique_ptr<T> object = std::move(pool_.back());
+      pool_.pop_back();
+      return object;
+    }
+
+    void give(std::unique_ptr<T> object) {
+      if (object && pool_.size() < kMaxPooled)
+        pool_.push_back(std::move(object));
+    }
+
+    int size() const { return pool_.size(); }
+    void clear() { pool_.clear(); }
+
+  private:
+    // Constructing a T first makes statics it depends on, like leak counters, outlive the pool.
+    ObjectPool() { T object; }
+
+    std::vector<std::unique_ptr<T>> pool_;
+  };
+
   struct TextBlock : Shape<TextureVertex> {
     TextBlock(const ClampBounds& clamp, const PackedBrush* brush, float x, float y, float width,
               float height, Text* text, const Font& font, Direction direction) :
-        Shape(font.packedFont(), clamp, brush, x, y, width, height),
+        Shape(font.atlasId(), clamp, brush, x, y, width, height),
         quads(VectorPool<FontAtlasQuad>::instance().vector(text->text().length())), text(text),
         font(font), direction(direction) {
       this->clamp = clamp.clamp(x, y, width, height);
 
-      const char32_t* c_str = text->text().c_str();
-      int length = text->text().length();
       float w = width;
       float h = height;
       if (direction == Direction::Left || direction == Direction::Right)
         std::swap(w, h);
-      if (text->multiLine())
-        font.setMultiLineVertexPositions(quads.data(), c_str, length, 0, 0, w, h, text->justification());
-      else {
-        font.setVertexPositions(quads.data(), c_str, length, 0, 0, w, h, text->justification(),
-                                text->characterOverride());
-      }
+      const std::vector<FontAtlasQuad>& layout = text->layout(font, w, h);
+      std::copy(layout.begin(), layout.end(), quads.begin());
 
       if (direction == Direction::Down) {
         for (auto& quad : quads) {
@@ -711,7 +1074,13 @@ namespace visage {
 
     ~TextBlock() { VectorPool<FontAtlasQuad>::instance().returnVector(std::move(quads)); }
 
+    const PackedBrush* quadBrush(const FontAtlasQuad& quad) const {
+      return quad.style ? style_brushes[quad.style - 1] : brush;
+    }
+
     std::vector<FontAtlasQuad> quads;
+    // One brush per Text style, quads with a style draw with these instead of brush.
+    std::vector<const PackedBrush*> style_brushes;
     Text* text = nullptr;
     Font font;
     Direction direction = Direction::Up;
@@ -738,5 +1107,15 @@ namespace visage {
 
     const Region* region = nullptr;
     PostEffect* post_effect = nullptr;
+    float alpha = 1.0f;
+  };
+
+  // Places a ShapeList in a region. Every draw of the same list shares one batch.
+  struct ShapeListWrapper : BaseShape {
+    ShapeListWrapper(const ClampBounds& clamp, float x, float y, float width, float height,
+                     ShapeList* list) :
+        BaseShape(list, clamp, nullptr, x, y, width, height), list(list) { }
+
+    ShapeList* list = nullptr;
   };
 }
\ No newline at end of file
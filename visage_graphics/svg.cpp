@@ -22,7 +22,12 @@
 #include "svg.h"
 
 #include "canvas.h"
+#include "path_strips.h"
+#include "visage_utils/thread_utils.h"
 
+#include <atomic>
+#include <cstring>
+#include <type_traits>
 #include <unordered_map>
 
 namespace visage {
@@ -200,6 +205,179 @@ namespace visage {
     canvas.fill(stroke_path, x, y, width, height);
   }
 
+  void SvgDrawList::addItem(const Path& path, const Brush& brush, const GradientDef& gradient,
+                            float opacity, bool stroke) {
+    bool context = gradient.type == GradientDef::Type::CurrentColor ||
+                   gradient.type == GradientDef::Type::ContextFill ||
+                   gradient.type == GradientDef::Type::ContextStroke;
+    if (!context && brush.isNone())
+      return;
+
+    Item item;
+    item.path_index = paths.size();
+    item.context_type = gradient.type;
+    item.context_opacity = opacity;
+    item.stroke = stroke;
+    paths.push_back(path);
+    if (!brush.isNone()) {
+      item.brush_index = brushes.size();
+      brushes.push_back(brush);
+    }
+    items.push_back(item);
+  }
+
+  void SvgDrawList::build(const SvgDrawable& drawable) {
+    const DrawableState& state = drawable.state;
+    if (state.visible && drawable.opacity > 0.0f && !drawable.is_defines) {
+      if (drawable.opacity < 1.0f)
+        items.push_back({});
+
+      if (state.fill_opacity > 0.0f)
+        addItem(drawable.path, drawable.fill_brush, state.fill_gradient, state.fill_opacity, false);
+      if (state.stroke_opacity > 0.0f && state.stroke_width > 0.0f) {
+        addItem(drawable.stroke_path, drawable.stroke_brush, state.stroke_gradient,
+                state.stroke_opacity, true);
+      }
+    }
+
+    for (const auto& child : drawable.children)
+      build(*child);
+  }
+
+  void SvgDrawList::draw(Canvas& canvas, const Brush* current_color, float x, float y,
+                         float width, float height) const {
+    const Brush* context_fill = nullptr;
+    const Brush* context_stroke = nullptr;
+    for (const Item& item : items) {
+      if (item.path_index < 0) {
+        canvas.setBlendMode(BlendMode::Composite);
+        continue;
+      }
+
+      const Brush* context_brush = nullptr;
+      if (item.context_type == GradientDef::Type::CurrentColor)
+        context_brush = current_color;
+      else if (item.context_type == GradientDef::Type::ContextFill)
+        context_brush = context_fill;
+      else if (item.context_type == GradientDef::Type::ContextStroke)
+        context_brush = context_stroke;
+
+      if (context_brush) {
+        if (item.context_opacity == 1.0f)
+          canvas.setColor(*context_brush);
+        else
+          canvas.setColor(context_brush->withMultipliedAlpha(item.context_opacity));
+      }
+      else if (item.brush_index >= 0) {
+        const Brush& brush = brushes[item.brush_index];
+        Brush translated = brush;
+        translated.transform(Transform::translation(x, y));
+        canvas.setColor(translated);
+        if (item.stroke)
+          context_stroke = &brush;
+        else
+          context_fill = &brush;
+      }
+      else
+        continue;
+
+      canvas.fill(paths[item.path_index], x, y, width, height);
+    }
+  }
+
+  static bool solidBrushColor(const Brush& brush, Color& color) {
+    const Gradient& gradient = brush.gradient();
+    if (gradient.colors().empty())
+      return false;
+    if (gradient.numColors() > 1 && brush.position().shape != GradientPosition::InterpolationShape::Solid)
+      return false;
+
+    color = gradient.colors().front();
+    return true;
+  }
+
+  bool SvgDrawList::rasterize(std::vector<unsigned char>& pixels, int width, int height, float scale,
+                              const Brush* current_color) const {
+    std::vector<float> accumulation(width * height * 4, 0.0f);
+    const Brush* context_fill = nullptr;
+    const Brush* context_stroke = nullptr;
+    PathStrips strips;
+    for (const Item& item : items) {
+      if (item.path_index < 0)
+        continue;
+
+      const Brush* context_brush = nullptr;
+      if (item.context_type == GradientDef::Type::CurrentColor)
+        context_brush = current_color;
+      else if (item.context_type == GradientDef::Type::ContextFill)
+        context_brush = context_fill;
+      else if (item.context_type == GradientDef::Type::ContextStroke)
+        context_brush = context_stroke;
+
+      Color color;
+      if (context_brush) {
+        if (!solidBrushColor(*context_brush, color))
+          return false;
+        color = color.withAlpha(color.alpha() * item.context_opacity);
+      }
+      else if (item.brush_index >= 0) {
+        const Brush& brush = brushes[item.brush_index];
+        if (!solidBrushColor(brush, color))
+          return false;
+        if (item.stroke)
+          context_stroke = &brush;
+        else
+          context_fill = &brush;
+      }
+      else
+        continue;
+
+      const Path& path = paths[item.path_index];
+      if (path.numPoints() == 0)
+        continue;
+
+      Path scaled_path = path.flattened(scale);
+      if (scale != 1.0f)
+        scaled_path.scale(scale);
+      strips.rasterize(scaled_path, width, height);
+
+      float red = std::clamp(color.red(), 0.0f, 1.0f);
+      float green = std::clamp(color.green(), 0.0f, 1.0f);
+      float blue = std::clamp(color.blue(), 0.0f, 1.0f);
+      float alpha = std::clamp(color.alpha(), 0.0f, 1.0f);
+      const unsigned char* alphas = strips.alphaData();
+      for (const PathStrips::Strip& strip : strips.strips()) {
+        for (int y = 0; y < strip.height; ++y) {
+          for (int x = 0; x < strip.width; ++x) {
+            float coverage = 1.0f;
+            if (!strip.solid) {
+              int alpha_index = (strip.alpha_y + y) * strips.alphaWidth() + strip.alpha_x + x;
+              coverage = alphas[alpha_index * 4 + 3] * (1.0f / 255.0f);
+            }
+
+            float source_alpha = alpha * coverage;
+            float* dest = accumulation.data() + ((strip.y + y) * width + strip.x + x) * 4;
+            dest[0] = red * source_alpha + dest[0] * (1.0f - source_alpha);
+            dest[1] = green * source_alpha + dest[1] * (1.0f - source_alpha);
+            dest[2] = blue * source_alpha + dest[2] * (1.0f - source_alpha);
+            dest[3] = source_alpha + dest[3] * (1.0f - source_alpha);
+          }
+        }
+      }
+    }
+
+    pixels.resize(width * height * 4);
+    for (int i = 0; i < width * height; ++i) {
+      const float* source = accumulation.data() + i * 4;
+      float alpha = source[3];
+      float unpremultiply = alpha > 0.0f ? 1.0f / alpha : 0.0f;
+      for (int c = 0; c < 3; ++c)
+        pixels[i * 4 + c] = std::min(255.0f, source[c] * unpremultiply * 255.0f + 0.5f);
+      pixels[i * 4 + 3] = alpha * 255.0f + 0.5f;
+    }
+    return true;
+  }
+
   inline void tryReadFloat(float& result, const std::string& string) {
     try {
       result = std::stof(string);
@@ -1573,4 +1751,456 @@ namespace visage {
 
     drawable_->setSize(view_);
   }
+
+  static constexpr unsigned char kCompiledSvgMagic[] = { 'V', 'S', 'V', 'G' };
+  static constexpr unsigned char kCompiledSvgVersion = 1;
+  static constexpr int kCompiledSvgHeaderSize = sizeof(kCompiledSvgMagic) + 1;
+  static constexpr int kMaxCompiledSvgDepth = 512;
+
+  class CompiledSvgWriter {
+  public:
+    template<typename T>
+    void write(const T& value) {
+      static_assert(std::is_trivially_copyable_v<T>);
+      auto bytes = reinterpret_cast<const unsigned char*>(&value);
+      data_.insert(data_.end(), bytes, bytes + sizeof(T));
+    }
+
+    void write(const std::string& value) {
+      write(static_cast<int>(value.size()));
+      data_.insert(data_.end(), value.begin(), value.end());
+    }
+
+    void write(const GradientDef& gradient) {
+      write(gradient.gradient.encode());
+      write(gradient.transform);
+      write(gradient.type);
+      write(gradient.user_space);
+      write(gradient.point1);
+      write(gradient.point2);
+      write(gradient.focal_radius);
+      write(gradient.radius);
+    }
+
+    void write(const DrawableState& state) {
+      write(state.current_color);
+      write(state.fill_gradient);
+      write(state.fill_opacity);
+      write(state.non_zero_fill);
+      write(state.stroke_gradient);
+      write(state.stroke_opacity);
+      write(state.stroke_width);
+      write(state.stroke_join);
+      write(state.stroke_end_cap);
+      write(static_cast<int>(state.stroke_dasharray.size()));
+      for (const auto& dash : state.stroke_dasharray) {
+        write(dash.first);
+        write(dash.second);
+      }
+      write(state.stroke_dashoffset);
+      write(state.stroke_dashoffset_ratio);
+      write(state.non_scaling_stroke);
+      write(state.stroke_miter_limit);
+      write(state.visible);
+    }
+
+    void write(const SvgViewSettings& view) {
+      write(view.width);
+      write(view.height);
+      write(view.view_box);
+      write(view.align);
+      write(view.scale);
+    }
+
+    void write(const SvgDrawable& drawable) {
+      write(drawable.id);
+      write(drawable.is_defines);
+      write(static_cast<int>(drawable.command_list.size()));
+      for (const auto& command : drawable.command_list)
+        write(command);
+      write(drawable.command_list.start);
+      write(drawable.command_list.current);
+
+      write(drawable.local_transform);
+      write(drawable.transform_origin_x_ratio);
+      write(drawable.transform_origin_y_ratio);
+      write(drawable.transform_origin_x);
+      write(drawable.transform_origin_y);
+      write(drawable.opacity);
+      write(drawable.state);
+      write(drawable.is_clip_path);
+      write(drawable.is_clip_bounding_box);
+      write(drawable.clip_path_shape);
+
+      write(static_cast<int>(drawable.children.size()));
+      for (const auto& child : drawable.children)
+        write(*child);
+    }
+
+    std::vector<unsigned char> take() { return std::move(data_); }
+
+  private:
+    std::vector<unsigned char> data_;
+  };
+
+  class CompiledSvgReader {
+  public:
+    CompiledSvgReader(const unsigned char* data, int data_size) : data_(data), size_(data_size) { }
+
+    template<typename T>
+    void read(T& value) {
+      static_assert(std::is_trivially_copyable_v<T>);
+      if (!canRead(sizeof(T)))
+        return;
+
+      std::memcpy(&value, data_ + position_, sizeof(T));
+      position_ += sizeof(T);
+    }
+
+    void read(std::string& value) {
+      int size = readCount(1);
+      if (failed_)
+        return;
+
+      value.assign(reinterpret_cast<const char*>(data_ + position_), size);
+      position_ += size;
+    }
+
+    void read(GradientDef& gradient) {
+      std::string encoded;
+      read(encoded);
+      gradient.gradient.decode(encoded);
+      read(gradient.transform);
+      read(gradient.type);
+      read(gradient.user_space);
+      read(gradient.point1);
+      read(gradient.point2);
+      read(gradient.focal_radius);
+      read(gradient.radius);
+    }
+
+    void read(DrawableState& state) {
+      read(state.current_color);
+      read(state.fill_gradient);
+      read(state.fill_opacity);
+      read(state.non_zero_fill);
+      read(state.stroke_gradient);
+      read(state.stroke_opacity);
+      read(state.stroke_width);
+      read(state.stroke_join);
+      read(state.stroke_end_cap);
+      int num_dashes = readCount(sizeof(float) + sizeof(bool));
+      state.stroke_dasharray.resize(num_dashes);
+      for (auto& dash : state.stroke_dasharray) {
+        read(dash.first);
+        read(dash.second);
+      }
+      read(state.stroke_dashoffset);
+      read(state.stroke_dashoffset_ratio);
+      read(state.non_scaling_stroke);
+      read(state.stroke_miter_limit);
+      read(state.visible);
+    }
+
+    void read(SvgViewSettings& view) {
+      read(view.width);
+      read(view.height);
+      read(view.view_box);
+      read(view.align);
+      read(view.scale);
+    }
+
+    void read(SvgDrawable& drawable, int depth = 0) {
+      if (depth > kMaxCompiledSvgDepth) {
+        failed_ = true;
+        return;
+      }
+
+      read(drawable.id);
+      read(drawable.is_defines);
+      int num_commands = readCount(sizeof(Path::Command));
+      drawable.command_list.resize(num_commands);
+      for (auto& command : drawable.command_list)
+        read(command);
+      read(drawable.command_list.start);
+      read(drawable.command_list.current);
+
+      read(drawable.local_transform);
+      read(drawable.transform_origin_x_ratio);
+      read(drawable.transform_origin_y_ratio);
+      read(drawable.transform_origin_x);
+      read(drawable.transform_origin_y);
+      read(drawable.opacity);
+      read(drawable.state);
+      read(drawable.is_clip_path);
+      read(drawable.is_clip_bounding_box);
+      read(drawable.clip_path_shape);
+
+      int num_children = readCount(1);
+      for (int i = 0; i < num_children && !failed_; ++i) {
+        auto child = std::make_unique<SvgDrawable>();
+        read(*child, depth + 1);
+        drawable.children.push_back(std::move(child));
+      }
+    }
+
+    void skip(int bytes) {
+      if (canRead(bytes))
+        position_ += bytes;
+    }
+
+    bool failed() const { return failed_; }
+
+  private:
+    bool canRead(size_t bytes) {
+      failed_ = failed_ || position_ + bytes > size_;
+      return !failed_;
+    }
+
+    int readCount(size_t element_size) {
+      int count = 0;
+      read(count);
+      if (count < 0 || !canRead(count * element_size)) {
+        failed_ = true;
+        return 0;
+      }
+      return count;
+    }
+
+    const unsigned char* data_ = nullptr;
+    size_t size_ = 0;
+    size_t position_ = 0;
+    bool failed_ = false;
+  };
+
+  bool SvgParser::isCompiled(const unsigned char* data, int data_size) {
+    return data_size >= kCompiledSvgHeaderSize &&
+           std::memcmp(data, kCompiledSvgMagic, sizeof(kCompiledSvgMagic)) == 0 &&
+           data[sizeof(kCompiledSvgMagic)] == kCompiledSvgVersion;
+  }
+
+  std::vector<unsigned char> SvgParser::compile(const unsigned char* data, int data_size) {
+    if (isCompiled(data, data_size))
+      return { data, data + data_size };
+
+    SvgParser parser(data, data_size);
+    CompiledSvgWriter writer;
+    for (unsigned char magic : kCompiledSvgMagic)
+      writer.write(magic);
+    writer.write(kCompiledSvgVersion);
+    writer.write(parser.view_);
+    writer.write(*parser.drawable_);
+    return writer.take();
+  }
+
+  std::unique_ptr<SvgDrawable> SvgParser::loadCompiled(const unsigned char* data, int data_size,
+                                                       SvgViewSettings& view) {
+    CompiledSvgReader reader(data, data_size);
+    reader.skip(kCompiledSvgHeaderSize);
+    reader.read(view);
+
+    auto drawable = std::make_unique<SvgDrawable>();
+    reader.read(*drawable);
+    if (reader.failed()) {
+      view = {};
+      return nullptr;
+    }
+
+    drawable->setSize(view);
+    return drawable;
+  }
+
+  struct Svg::AsyncLoad {
+    void run() {
+      drawable = SvgParser::loadDrawable(data.data(), data.size(), view);
+      if (drawable && width > 0 && height > 0)
+        drawable->setSize(view, width, height, scale);
+
+      data = {};
+      ready = true;
+      if (on_ready)
+        on_ready();
+    }
+
+    std::vector<unsigned char> data;
+    int width = 0;
+    int height = 0;
+    float scale = 1.0f;
+    std::function<void()> on_ready;
+
+    std::atomic<bool> ready = false;
+    std::shared_ptr<SvgDrawable> drawable;
+    SvgViewSettings view;
+  };
+
+  Svg Svg::loadAsync(const unsigned char* data, int data_size, int width, int height, float scale,
+                     std::function<void()> on_ready) {
+    auto load = std::make_shared<AsyncLoad>();
+    load->data.assign(data, data + data_size);
+    load->width = width;
+    load->height = height;
+    load->scale = scale;
+    load->on_ready = std::move(on_ready);
+
+    Svg svg;
+    svg.async_load_ = load;
+    if (width > 0 && height > 0) {
+      svg.draw_width_ = width;
+      svg.draw_height_ = height;
+      svg.draw_scale_ = scale;
+    }
+
+    std::weak_ptr<AsyncLoad> weak_load = load;
+    auto run = [weak_load] {
+      if (auto load = weak_load.lock())
+        load->run();
+    };
+    ThreadPool::shared().post(std::move(run), TaskPriority::Background);
+    return svg;
+  }
+
+  bool Svg::loading() const {
+    return async_load_ && !async_load_->ready;
+  }
+
+  void Svg::finishAsyncLoad() const {
+    if (!async_load_->ready)
+      return;
+
+    std::shared_ptr<AsyncLoad> load = std::move(async_load_);
+    view_ = load->view;
+    if (load->drawable == nullptr)
+      return;
+
+    drawable_ = load->drawable;
+
+    if (draw_width_ != load->width || draw_height_ != load->height || draw_scale_ != load->scale)
+      resetDrawable();
+    else {
+      needs_resize_ = false;
+      applyBrushes();
+    }
+  }
+
+  static uint64_t hashData(const unsigned char* data, int data_size) {
+    static constexpr uint64_t kFnvOffset = 14695981039346656037ULL;
+    static constexpr uint64_t kFnvPrime = 1099511628211ULL;
+    uint64_t hash = kFnvOffset;
+    for (int i = 0; i < data_size; ++i)
+      hash = (hash ^ data[i]) * kFnvPrime;
+    return hash;
+  }
+
+  std::shared_ptr<const Svg> SvgCache::svg(const unsigned char* data, int data_size, int width,
+                                           int height, float scale, const Brush& brush) {
+    Key key { hashData(data, data_size), data_size, width, height, scale };
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto range = lookup_.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second->brush == brush) {
+        stats_.hits++;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return it->second->svg;
+      }
+    }
+
+    stats_.misses++;
+    auto svg = std::make_shared<Svg>(data, data_size);
+    svg->setDimensions(width, height, scale);
+    svg->setFillBrush(brush);
+    svg->setStrokeBrush(brush);
+    svg->drawList();
+
+    entries_.push_front({ key, brush, svg });
+    lookup_.emplace(key, entries_.begin());
+    evict();
+    return svg;
+  }
+
+  void SvgCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    lookup_.clear();
+  }
+
+  void SvgCache::setMaxEntries(int max_entries) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    max_entries_ = max_entries;
+    evict();
+  }
+
+  int SvgCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+  }
+
+  SvgCache::Stats SvgCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+  }
+
+  void SvgCache::resetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_ = {};
+  }
+
+  void SvgCache::evict() {
+    while (static_cast<int>(entries_.size()) > std::max(1, max_entries_)) {
+      auto range = lookup_.equal_range(entries_.back().key);
+      for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == std::prev(entries_.end())) {
+          lookup_.erase(it);
+          break;
+        }
+      }
+      entries_.pop_back();
+      stats_.evictions++;
+    }
+  }
+
+  const SvgDrawList* Svg::drawList() const {
+    if (async_load_)
+      finishAsyncLoad();
+    if (!drawable_)
+      return nullptr;
+
+    for (const SizedDrawList& sized : draw_lists_) {
+      if (sized.width == draw_width_ && sized.height == draw_height_ && sized.scale == draw_scale_)
+        return &sized.list;
+    }
+
+    if (draw_lists_.size() >= kMaxCachedDrawLists)
+      draw_lists_.erase(draw_lists_.begin());
+
+    draw_lists_.push_back({ draw_width_, draw_height_, draw_scale_ });
+    draw_lists_.back().list.build(*drawable());
+    return &draw_lists_.back().list;
+  }
+
+  std::shared_ptr<const SvgRaster> Svg::sharedRaster(int width, int height, float scale,
+                                                     const Brush* current_color) const {
+    Color color;
+    bool has_current_color = current_color != nullptr;
+    bool solid_current_color = has_current_color && solidBrushColor(*current_color, color);
+    if (raster_ && raster_->width == width && raster_->height == height && raster_->scale == scale &&
+        raster_->has_current_color == has_current_color &&
+        (!has_current_color || raster_->current_color == color)) {
+      return raster_->valid ? raster_ : nullptr;
+    }
+
+    const SvgDrawList* draw_list = drawList();
+    if (draw_list == nullptr || width <= 0 || height <= 0)
+      return nullptr;
+
+    auto raster = std::make_shared<SvgRaster>();
+    raster->width = width;
+    raster->height = height;
+    raster->scale = scale;
+    raster->has_current_color = has_current_color;
+    raster->current_color = color;
+    raster->valid = (!has_current_color || solid_current_color) &&
+                    draw_list->rasterize(raster->pixels, width, height, scale, current_color);
+    raster_ = std::move(raster);
+    return raster_->valid ? raster_ : nullptr;
+  }
 }
\ No newline at end of file
@@ -26,13 +26,18 @@
 #include "visage_graphics/path.h"
 #include "visage_utils/clone_ptr.h"
 
+#include <functional>
+#include <list>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <tuple>
 #include <vector>
 
 namespace visage {
   class Canvas;
+  class ImageAtlas;
   struct Marker;
 
   struct TagData {
@@ -332,6 +337,44 @@ namespace visage {
     std::string clip_path_shape;
   };
 
+  // A sized SvgDrawable flattened into the fill and stroke calls it makes, so drawing doesn't
+  // walk the drawable tree.
+  struct SvgDrawList {
+    struct Item {
+      int path_index = -1;
+      int brush_index = -1;
+      GradientDef::Type context_type = GradientDef::Type::None;
+      float context_opacity = 1.0f;
+      bool stroke = false;
+    };
+
+    void build(const SvgDrawable& drawable);
+    void draw(Canvas& canvas, const Brush* current_color, float x, float y, float width,
+              float height) const;
+    // Fills RGBA pixels on the CPU. Returns false if any brush is not a solid color.
+    bool rasterize(std::vector<unsigned char>& pixels, int width, int height, float scale,
+                   const Brush* current_color) const;
+
+    std::vector<Path> paths;
+    std::vector<Brush> brushes;
+    std::vector<Item> items;
+
+  private:
+    void addItem(const Path& path, const Brush& brush, const GradientDef& gradient, float opacity,
+                 bool stroke);
+  };
+
+  struct SvgRaster {
+    int width = 0;
+    int height = 0;
+    float scale = 1.0f;
+    bool has_current_color = false;
+    Color current_color;
+    bool valid = false;
+    std::vector<unsigned char> pixels;
+    mutable ImageAtlas* uploaded_atlas = nullptr;
+  };
+
   struct Marker {
     SvgDrawable drawable;
     bool reverse_start_marker = false;
@@ -343,12 +386,22 @@ namespace visage {
   public:
     static std::unique_ptr<SvgDrawable> loadDrawable(const unsigned char* data, int data_size,
                                                      SvgViewSettings& view) {
+      if (isCompiled(data, data_size))
+        return loadCompiled(data, data_size, view);
+
       SvgParser parser(data, data_size);
       view = parser.view_;
       return std::move(parser.drawable_);
     }
 
+    // Parses svg text into a binary drawable tree that loadDrawable reads without any XML parsing.
+    static std::vector<unsigned char> compile(const unsigned char* data, int data_size);
+    static bool isCompiled(const unsigned char* data, int data_size);
+
   private:
+    static std::unique_ptr<SvgDrawable> loadCompiled(const unsigned char* data, int data_size,
+                                                     SvgViewSettings& view);
+
     SvgParser() = default;
 
     SvgParser(const unsigned char* data, int data_size) { parseData(data, data_size); }
@@ -390,73 +443,153 @@ namespace visage {
     Svg& operator=(const Svg& other) = default;
 
     Svg(const unsigned char* data, int data_size) {
-      drawable_ = clone_ptr(SvgParser::loadDrawable(data, data_size, view_));
+      drawable_ = SvgParser::loadDrawable(data, data_size, view_);
     }
 
     explicit Svg(const EmbeddedFile& file) : Svg(file.data, file.size) { }
 
+    // Parses and sizes the svg on a background thread. on_ready is called from that thread
+    // once the drawable is available, until then drawable() returns nullptr.
+    static Svg loadAsync(const unsigned char* data, int data_size, int width = 0, int height = 0,
+                         float scale = 1.0f, std::function<void()> on_ready = nullptr);
+    static Svg loadAsync(const EmbeddedFile& file, int width = 0, int height = 0, float scale = 1.0f,
+                         std::function<void()> on_ready = nullptr) {
+      return loadAsync(file.data, file.size, width, height, scale, std::move(on_ready));
+    }
+
+    bool loading() const;
+
     void setDimensions(int width, int height, float scale) {
       setDrawableDimensions(width, height, scale);
     }
 
-    SvgDrawable* drawable() const { return drawable_.get(); }
+    // Copies of an svg share one drawable tree until one of them changes its brushes or size,
+    // so the returned tree can be replaced by such a change.
+    const SvgDrawable* drawable() const {
+      if (async_load_)
+        finishAsyncLoad();
+      if (needs_resize_)
+        resetDrawable();
+      return drawable_.get();
+    }
+    bool sharesDrawable(const Svg& other) const {
+      return drawable_ != nullptr && drawable_ == other.drawable_;
+    }
+
+    // Draw lists are cached for the last few dimensions, so toggling between sizes doesn't
+    // resize and flatten the drawable again.
+    const SvgDrawList* drawList() const;
+
+    // Rasterized svgs are drawn as one cached image at their exact pixel size instead of filling
+    // every path. Svgs with gradient brushes are still drawn as paths.
+    void setRasterized(bool rasterized) { rasterized_ = rasterized; }
+    bool rasterized() const { return rasterized_; }
+    const SvgRaster* raster(int width, int height, float scale, const Brush* current_color) const {
+      return sharedRaster(width, height, scale, current_color).get();
+    }
+    // The raster stays alive while the returned pointer is held, even after the Svg replaces it.
+    std::shared_ptr<const SvgRaster> sharedRaster(int width, int height, float scale,
+                                                  const Brush* current_color) const;
 
     float width() const { return draw_width_; }
     float height() const { return draw_height_; }
 
     void setFillBrush(const Brush& brush) {
       fill_brush_ = brush;
+      draw_lists_.clear();
+      raster_ = nullptr;
       if (drawable_)
-        drawable_->setAllFillBrush(brush);
+        uniqueDrawable()->setAllFillBrush(brush);
     }
 
     void resetFillBrush() {
       fill_brush_ = Brush::none();
+      draw_lists_.clear();
+      raster_ = nullptr;
       resetDrawable();
     }
 
     void setStrokeBrush(const Brush& brush) {
       stroke_brush_ = brush;
+      draw_lists_.clear();
+      raster_ = nullptr;
       if (drawable_)
-        drawable_->setAllStrokeBrush(brush);
+        uniqueDrawable()->setAllStrokeBrush(brush);
     }
 
     void resetStrokeBrush() {
       stroke_brush_ = Brush::none();
+      draw_lists_.clear();
+      raster_ = nullptr;
       resetDrawable();
     }
 
     void setCurrentColor(const Brush& brush) {
       current_color_ = brush;
+      draw_lists_.clear();
+      raster_ = nullptr;
       if (drawable_)
-        drawable_->setAllCurrentColor(brush);
+        uniqueDrawable()->setAllCurrentColor(brush);
     }
 
   private:
+    static constexpr int kMaxCachedDrawLists = 4;
+
+    struct AsyncLoad;
+
+    struct SizedDrawList {
+      float width = 0.0f;
+      float height = 0.0f;
+      float scale = 1.0f;
+      SvgDrawList list;
+    };
+
+    void finishAsyncLoad() const;
+
     void setDrawableDimensions(int width, int height, float scale) {
+      if (async_load_)
+        finishAsyncLoad();
+
       if (width != draw_width_ || height != draw_height_) {
         draw_width_ = width;
         draw_height_ = height;
         draw_scale_ = scale;
-        resetDrawable();
+        needs_resize_ = true;
+        raster_ = nullptr;
       }
     }
 
-    void resetDrawable() {
+    void resetDrawable() const {
+      needs_resize_ = false;
       if (!drawable_)
         return;
 
-      drawable_->setSize(view_, draw_width_, draw_height_, draw_scale_);
+      uniqueDrawable()->setSize(view_, draw_width_, draw_height_, draw_scale_);
+      applyBrushes();
+    }
+
+    SvgDrawable* uniqueDrawable() const {
+      if (drawable_.use_count() > 1)
+        drawable_ = std::make_shared<SvgDrawable>(*drawable_);
+      return drawable_.get();
+    }
+
+    void applyBrushes() const {
       if (!fill_brush_.isNone())
-        drawable_->setAllFillBrush(fill_brush_);
+        uniqueDrawable()->setAllFillBrush(fill_brush_);
       if (!stroke_brush_.isNone())
-        drawable_->setAllStrokeBrush(stroke_brush_);
+        uniqueDrawable()->setAllStrokeBrush(stroke_brush_);
       if (!current_color_.isNone())
-        drawable_->setAllCurrentColor(current_color_);
+        uniqueDrawable()->setAllCurrentColor(current_color_);
     }
 
-    SvgViewSettings view_;
-    clone_ptr<SvgDrawable> drawable_;
+    mutable SvgViewSettings view_;
+    mutable std::shared_ptr<SvgDrawable> drawable_;
+    mutable std::shared_ptr<AsyncLoad> async_load_;
+    mutable std::vector<SizedDrawList> draw_lists_;
+    mutable bool needs_resize_ = false;
+    mutable std::shared_ptr<SvgRaster> raster_;
+    bool rasterized_ = false;
     float draw_width_ = 0.0f;
     float draw_height_ = 0.0f;
     float draw_scale_ = 1.0f;
@@ -465,4 +598,63 @@ namespace visage {
     Brush stroke_brush_;
     Brush current_color_;
   };
+
+  // Process-wide cache of parsed and sized svgs for Canvas::svg(data, size, ...). Entries are
+  // keyed by a hash of the data's contents, so a buffer that's rebuilt or reused at the same
+  // address with different contents parses again.
+  class SvgCache {
+  public:
+    static constexpr int kDefaultMaxEntries = 256;
+
+    struct Stats {
+      int hits = 0;
+      int misses = 0;
+      int evictions = 0;
+    };
+
+    static SvgCache& instance() {
+      static SvgCache cache;
+      return cache;
+    }
+
+    explicit SvgCache(int max_entries = kDefaultMaxEntries) : max_entries_(max_entries) { }
+
+    std::shared_ptr<const Svg> svg(const unsigned char* data, int data_size, int width, int height,
+                                   float scale, const Brush& brush);
+    void clear();
+
+    void setMaxEntries(int max_entries);
+    int maxEntries() const { return max_entries_; }
+    int size() const;
+    Stats stats() const;
+    void resetStats();
+
+  private:
+    struct Key {
+      uint64_t data_hash = 0;
+      int data_size = 0;
+      int width = 0;
+      int height = 0;
+      float scale = 1.0f;
+
+      bool operator<(const Key& other) const {
+        return std::tie(data_hash, data_size, width, height, scale) <
+               std::tie(other.data_hash, other.data_size, other.width, other.height, other.scale);
+      }
+    };
+
+    struct Entry {
+      Key key;
+      Brush brush;
+      std::shared_ptr<const Svg> svg;
+    };
+
+    void evict();
+
+    mutable std::mutex mutex_;
+    std::list<Entry> entries_;
+    std::multimap<Key, std::list<Entry>::iterator> lookup_;
+    Stats stats_;
+    int max_entries_ = 0;
+  };
 }
\ No newline at end of file
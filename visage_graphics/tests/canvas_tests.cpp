@@ -22,9 +22,14 @@
 #include "visage_graphics/canvas.h"
 #include "visage_graphics/color.h"
 #include "visage_graphics/gradient.h"
+#include "visage_utils/file_system.h"
+#include "visage_utils/thread_utils.h"
 
 #include <catch2/catch_approx.hpp>
 #include <catch2/catch_test_macros.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
 
 using namespace visage;
 using namespace Catch;
@@ -138,6 +143,13 @@ TEST_CASE("Canvas advanced shapes", "[graphics]") {
     REQUIRE_NOTHROW(canvas.diamond(75, 75, 50, 5));
     REQUIRE_NOTHROW(canvas.diamond(125, 125, 40, 1));
   }
+
+  SECTION("HSV rectangles") {
+    canvas.setColor(0xffffffff);
+    REQUIRE_NOTHROW(canvas.hueRectangle(10, 10, 20, 180));
+    REQUIRE_NOTHROW(canvas.saturationValueRectangle(40, 10, 150, 150, 120.0f));
+    REQUIRE_NOTHROW(canvas.saturationValueRectangle(40, 170, 20, 20, Color::kHueRange));
+  }
 }
 
 TEST_CASE("Canvas borders and strokes", "[graphics]") {
@@ -449,6 +461,57 @@ TEST_CASE("Canvas advanced shape validation", "[graphics]") {
     REQUIRE(off_line.hexGreen() == 0x00);
     REQUIRE(off_line.hexBlue() == 0x00);
   }
+
+  SECTION("Polyline validation") {
+    Canvas canvas;
+    canvas.setWindowless(kTestWidth, kTestHeight);
+
+    canvas.setColor(0xff000000);
+    canvas.fill(0, 0, canvas.width(), canvas.height());
+
+    std::vector<Point> points = { { 20, 150 }, { 100, 50 }, { 180, 150 } };
+    canvas.setColor(0xff00ff00);
+    canvas.polyline(points, 6);
+
+    canvas.submit();
+    const Screenshot& screenshot = canvas.takeScreenshot();
+
+    Color first_segment = screenshot.sample(60, 100);
+    REQUIRE(first_segment.hexGreen() == 0xff);
+
+    Color join = screenshot.sample(100, 52);
+    REQUIRE(join.hexGreen() == 0xff);
+
+    Color second_segment = screenshot.sample(140, 100);
+    REQUIRE(second_segment.hexGreen() == 0xff);
+
+    Color between = screenshot.sample(100, 120);
+    REQUIRE(between.hexGreen() == 0x00);
+
+    Color outside = screenshot.sample(40, 40);
+    REQUIRE(outside.hexGreen() == 0x00);
+  }
+
+  SECTION("Translucent polyline joins aren't drawn twice") {
+    Canvas canvas;
+    canvas.setWindowless(kTestWidth, kTestHeight);
+
+    canvas.setColor(0xff000000);
+    canvas.fill(0, 0, canvas.width(), canvas.height());
+
+    std::vector<Point> points = { { 20, 150 }, { 100, 50 }, { 180, 150 } };
+    canvas.setColor(0x8000ff00);
+    canvas.polyline(points, 6);
+
+    canvas.submit();
+    const Screenshot& screenshot = canvas.takeScreenshot();
+
+    int segment_green = screenshot.sample(60, 100).hexGreen();
+    int join_green = screenshot.sample(100, 52).hexGreen();
+    REQUIRE(segment_green > 0x70);
+    REQUIRE(segment_green < 0x90);
+    REQUIRE(std::abs(join_green - segment_green) <= 2);
+  }
 }
 
 TEST_CASE("Canvas state and position validation", "[graphics]") {
@@ -511,6 +574,33 @@ TEST_CASE("Canvas state and position validation", "[graphics]") {
     Color wrong_pos = screenshot.sample(90, 90);
     REQUIRE(wrong_pos.hexRed() == 0x00);  // Should be background (black)
   }
+
+  SECTION("Rotation transform validation") {
+    Canvas canvas;
+    canvas.setWindowless(kTestWidth, kTestHeight);
+
+    canvas.setColor(0xff000000);
+    canvas.fill(0, 0, canvas.width(), canvas.height());
+
+    canvas.setPosition(100, 100);
+    canvas.saveState();
+    canvas.rotate(90.0f);
+    REQUIRE(canvas.hasTransform());
+
+    canvas.setColor(0xffff0000);
+    canvas.rectangle(0, 0, 50, 20);
+    canvas.restoreState();
+    REQUIRE_FALSE(canvas.hasTransform());
+
+    canvas.submit();
+    const Screenshot& screenshot = canvas.takeScreenshot();
+
+    Color rotated = screenshot.sample(90, 125);
+    REQUIRE(rotated.hexRed() == 0xff);
+
+    Color unrotated = screenshot.sample(125, 110);
+    REQUIRE(unrotated.hexRed() == 0x00);
+  }
 }
 
 TEST_CASE("Canvas edge cases", "[graphics]") {
@@ -540,4 +630,422 @@ TEST_CASE("Canvas edge cases", "[graphics]") {
     REQUIRE_NOTHROW(canvas.rectangle(0, 0, 1000, 1000));
     REQUIRE_NOTHROW(canvas.circle(100, 100, 500));
   }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Canvas profiler records submitted frames", "[graphics]") {
+  CanvasTestFixture fixture;
+  Canvas& canvas = fixture.canvas();
+  canvas.profiler().setEnabled(true);
+
+  canvas.setColor(0xffff0000);
+  canvas.rectangle(10, 10, 50, 50);
+  canvas.takeScreenshot();
+
+  const FrameProfiler& profiler = canvas.profiler();
+  REQUIRE(profiler.numFrames() == 1);
+  const FrameProfile& frame = profiler.lastFrame();
+  REQUIRE(frame.cpu_microseconds >= frame.sectionMicroseconds("Canvas::submit"));
+  REQUIRE(std::any_of(frame.samples.begin(), frame.samples.end(),
+                      [](const ProfileSample& sample) { return sample.name == "Layer::submit"; }));
+  REQUIRE(frame.num_views == canvas.viewsUsed());
+  REQUIRE(frame.batch_submits > 0);
+  REQUIRE(frame.region_batches >= frame.batch_submits);
+  REQUIRE(canvas.viewsUsed() > 0);
+  REQUIRE(canvas.viewsUsed() <= Canvas::maxViews());
+
+  canvas.profiler().setEnabled(false);
+  REQUIRE(profiler.numFrames() == 0);
+}
+
+TEST_CASE("Canvas present damage follows invalid rects", "[graphics]") {
+  CanvasTestFixture fixture;
+  Canvas& canvas = fixture.canvas();
+
+  Region region;
+  region.setBounds(40, 30, 20, 10);
+  canvas.addRegion(&region);
+  canvas.takeScreenshot();
+
+  REQUIRE(canvas.presentDamage().size() == 1);
+  IBounds full = canvas.presentDamage()[0];
+  REQUIRE(full.width() == 200);
+  REQUIRE(full.height() == 200);
+
+  canvas.submit();
+  REQUIRE(canvas.presentDamage().empty());
+
+  region.invalidate();
+  canvas.submit();
+  REQUIRE(canvas.presentDamage().size() == 1);
+  IBounds damage = canvas.presentDamage()[0];
+  REQUIRE(damage.x() == 40);
+  REQUIRE(damage.y() == 30);
+  REQUIRE(damage.width() == 20);
+  REQUIRE(damage.height() == 10);
+}
+
+TEST_CASE("Stencil clipped regions draw inside their clip without a layer", "[graphics]") {
+  CanvasTestFixture fixture;
+  Canvas& canvas = fixture.canvas();
+  canvas.setColor(0xff000000);
+  canvas.fill(0, 0, canvas.width(), canvas.height());
+
+  Region clip;
+  clip.setBounds(50, 50, 100, 100);
+  clip.setStencilClip(true);
+  canvas.addRegion(&clip);
+  Region child;
+  child.setBounds(0, 0, 100, 100);
+  clip.addRegion(&child);
+
+  canvas.beginRegion(&clip);
+  canvas.stencilClipRoundedRectangle(0, 0, 100, 100, 50);
+  canvas.endRegion();
+
+  canvas.beginRegion(&child);
+  canvas.setColor(0xffff0000);
+  canvas.fill(0, 0, 100, 100);
+  canvas.endRegion();
+
+  const Screenshot& screenshot = canvas.takeScreenshot();
+  REQUIRE_FALSE(clip.needsLayer());
+  REQUIRE_FALSE(child.needsLayer());
+  REQUIRE(canvas.layer(1)->stencil());
+  REQUIRE(screenshot.sample(100, 100).hexRed() == 0xff);
+  REQUIRE(screenshot.sample(100, 55).hexRed() == 0xff);
+  REQUIRE(screenshot.sample(55, 55).hexRed() == 0x00);
+  REQUIRE(screenshot.sample(145, 145).hexRed() == 0x00);
+}
+
+TEST_CASE("Shape lists only record again when stale", "[graphics]") {
+  CanvasTestFixture fixture;
+  Canvas& canvas = fixture.canvas();
+  canvas.setColor(0xff000000);
+  canvas.fill(0, 0, canvas.width(), canvas.height());
+
+  ShapeList list([](Canvas& list_canvas) {
+    list_canvas.setColor(0xffff0000);
+    list_canvas.fill(0, 0, 20, 20);
+  });
+  list.setSize(20, 20);
+  canvas.shapeList(list, 10, 10);
+  canvas.shapeList(list, 100, 100);
+
+  const Screenshot& screenshot = canvas.takeScreenshot();
+  REQUIRE(list.numRecords() == 1);
+  REQUIRE(screenshot.sample(20, 20).hexRed() == 0xff);
+  REQUIRE(screenshot.sample(110, 110).hexRed() == 0xff);
+  REQUIRE(screenshot.sample(60, 60).hexRed() == 0x00);
+
+  canvas.shapeList(list, 10, 10);
+  REQUIRE(list.numRecords() == 1);
+  list.invalidate();
+  canvas.shapeList(list, 10, 10);
+  REQUIRE(list.numRecords() == 2);
+}
+
+TEST_CASE("Canvas shared resources", "[graphics]") {
+  Canvas first(CanvasResources::shared());
+  Canvas second(CanvasResources::shared());
+  Canvas separate;
+
+  REQUIRE(first.resources() == second.resources());
+  REQUIRE(first.gradientAtlas() == second.gradientAtlas());
+  REQUIRE(first.imageAtlas() == second.imageAtlas());
+  REQUIRE(first.pathAtlas() == second.pathAtlas());
+  REQUIRE(separate.resources() != first.resources());
+  REQUIRE(separate.gradientAtlas() != first.gradientAtlas());
+
+  std::weak_ptr<CanvasResources> shared = first.resources();
+  {
+    Canvas third(CanvasResources::shared());
+    REQUIRE(third.resources() == first.resources());
+  }
+  REQUIRE(shared.use_count() == 2);
+}
+
+TEST_CASE("Canvas svg async loading", "[graphics]") {
+  static constexpr char kSvg[] = "<svg xmlns=\"http://www.w3.org/2000/svg\" viewBox=\"0 0 10 10\">"
+                                 "<rect width=\"10\" height=\"10\" fill=\"#ff0000\"/></svg>";
+
+  CanvasTestFixture fixture;
+  Canvas& canvas = fixture.canvas();
+  REQUIRE_NOTHROW(canvas.svg(Svg(), 0, 0));
+
+  std::atomic<bool> ready = false;
+  Svg svg = Svg::loadAsync(reinterpret_cast<const unsigned char*>(kSvg), sizeof(kSvg) - 1, 100, 100,
+                           1.0f, [&ready] { ready = true; });
+  for (int i = 0; i < 1000 && !ready; ++i)
+    Thread::sleep(1);
+
+  REQUIRE(ready);
+  REQUIRE_FALSE(svg.loading());
+  REQUIRE(svg.drawable() != nullptr);
+  REQUIRE(svg.width() == 100);
+
+  canvas.setColor(0xff000000);
+  canvas.fill(0, 0, canvas.width(), canvas.height());
+  canvas.svg(svg, 0, 0);
+  const auto& screenshot = canvas.takeScreenshot();
+  REQUIRE(screenshot.sample(50, 50).hexRed() == 0xff);
+  REQUIRE(screenshot.sample(150, 150).hexRed() == 0);
+}
+
+TEST_CASE("Canvas compiled svg", "[graphics]") {
+  static constexpr char kSvg[] = "<svg xmlns=\"http://www.w3.org/2000/svg\" viewBox=\"0 0 10 10\">"
+                                 "<rect width=\"5\" height=\"10\" fill=\"#ff0000\"/></svg>";
+  auto data = reinterpret_cast<const unsigned char*>(kSvg);
+  int data_size = sizeof(kSvg) - 1;
+
+  std::vector<unsigned char> compiled = SvgParser::compile(data, data_size);
+  REQUIRE_FALSE(SvgParser::isCompiled(data, data_size));
+  REQUIRE(SvgParser::isCompiled(compiled.data(), compiled.size()));
+
+  Svg parsed(data, data_size);
+  Svg loaded(compiled.data(), compiled.size());
+  REQUIRE(loaded.drawable() != nullptr);
+  Bounds parsed_bounds = parsed.drawable()->boundingBox();
+  Bounds loaded_bounds = loaded.drawable()->boundingBox();
+  REQUIRE(loaded_bounds.x() == Approx(parsed_bounds.x()));
+  REQUIRE(loaded_bounds.width() == Approx(parsed_bounds.width()));
+  REQUIRE(loaded_bounds.height() == Approx(parsed_bounds.height()));
+
+  Svg truncated(compiled.data(), compiled.size() / 2);
+  REQUIRE(truncated.drawable() == nullptr);
+
+  CanvasTestFixture fixture;
+  Canvas& canvas = fixture.canvas();
+  loaded.setDimensions(100, 100, 1.0f);
+  canvas.setColor(0xff000000);
+  canvas.fill(0, 0, canvas.width(), canvas.height());
+  canvas.svg(loaded, 0, 0);
+  const auto& screenshot = canvas.takeScreenshot();
+  REQUIRE(screenshot.sample(25, 50).hexRed() == 0xff);
+  REQUIRE(screenshot.sample(75, 50).hexRed() == 0);
+}
+
+TEST_CASE("Svg draw lists are cached per size", "[graphics]") {
+  static constexpr char kSvg[] = "<svg xmlns=\"http://www.w3.org/2000/svg\" viewBox=\"0 0 10 10\">"
+                                 "<rect width=\"10\" height=\"10\" fill=\"#ff0000\"/>"
+                                 "<rect width=\"5\" height=\"5\" fill=\"none\" stroke=\"#00ff00\"/></svg>";
+
+  Svg svg(reinterpret_cast<const unsigned char*>(kSvg), sizeof(kSvg) - 1);
+  svg.setDimensions(100, 100, 1.0f);
+  const SvgDrawList* large = svg.drawList();
+  REQUIRE(large != nullptr);
+  REQUIRE(large->items.size() == 2);
+  REQUIRE(large->paths[0].boundingBox().width() == Approx(100.0f));
+
+  svg.setDimensions(20, 20, 1.0f);
+  REQUIRE(svg.drawList()->paths[0].boundingBox().width() == Approx(20.0f));
+
+  svg.setDimensions(100, 100, 1.0f);
+  const SvgDrawList* cached = svg.drawList();
+  REQUIRE(cached->paths[0].boundingBox().width() == Approx(100.0f));
+  REQUIRE(svg.drawable()->boundingFillBox().width() == Approx(100.0f));
+
+  svg.setFillBrush(Brush::solid(0xff0000ff));
+  REQUIRE(svg.drawList()->brushes[0].gradient().colors().front().hexBlue() == 0xff);
+}
+
+TEST_CASE("Svg copies share drawables until modified", "[graphics]") {
+  static constexpr char kSvg[] = "<svg xmlns=\"http://www.w3.org/2000/svg\" viewBox=\"0 0 10 10\">"
+                                 "<rect width=\"10\" height=\"10\" fill=\"#ff0000\"/></svg>";
+
+  Svg svg(reinterpret_cast<const unsigned char*>(kSvg), sizeof(kSvg) - 1);
+  svg.setDimensions(10, 10, 1.0f);
+  REQUIRE(svg.drawable() != nullptr);
+  Svg copy = svg;
+  REQUIRE(copy.sharesDrawable(svg));
+  REQUIRE(copy.drawable() == svg.drawable());
+
+  copy.setFillBrush(Brush::solid(0xff0000ff));
+  REQUIRE_FALSE(copy.sharesDrawable(svg));
+  REQUIRE(copy.drawList()->brushes[0].gradient().colors().front().hexBlue() == 0xff);
+  REQUIRE(svg.drawList()->brushes[0].gradient().colors().front().hexRed() == 0xff);
+
+  Svg sized = svg;
+  sized.setDimensions(20, 20, 1.0f);
+  REQUIRE(sized.drawable()->boundingFillBox().width() == Approx(20.0f));
+  REQUIRE_FALSE(sized.sharesDrawable(svg));
+}
+
+TEST_CASE("Svg cache reuses parsed svgs", "[graphics]") {
+  static constexpr char kSvg[] = "<svg xmlns=\"http://www.w3.org/2000/svg\" viewBox=\"0 0 10 10\">"
+                                 "<rect width=\"10\" height=\"10\" fill=\"#ff0000\"/></svg>";
+  auto data = reinterpret_cast<const unsigned char*>(kSvg);
+  int size = sizeof(kSvg) - 1;
+
+  SvgCache cache(2);
+  std::shared_ptr<const Svg> first = cache.svg(data, size, 20, 20, 1.0f, Brush::none());
+  REQUIRE(first->drawList()->paths[0].boundingBox().width() == Approx(20.0f));
+  REQUIRE(cache.svg(data, size, 20, 20, 1.0f, Brush::none()) == first);
+  REQUIRE(cache.stats().hits == 1);
+  REQUIRE(cache.stats().misses == 1);
+
+  REQUIRE(cache.svg(data, size, 20, 20, 1.0f, Brush::solid(0xff0000ff)) != first);
+  REQUIRE(cache.svg(data, size, 40, 40, 1.0f, Brush::none()) != first);
+  REQUIRE(cache.size() == 2);
+  REQUIRE(cache.stats().evictions == 1);
+  REQUIRE(cache.svg(data, size, 20, 20, 1.0f, Brush::none()) != first);
+
+  std::string buffer = kSvg;
+  auto reused = reinterpret_cast<const unsigned char*>(buffer.data());
+  std::shared_ptr<const Svg> red = cache.svg(reused, size, 20, 20, 1.0f, Brush::none());
+  buffer.replace(buffer.find("ff0000"), 6, "0000ff");
+  std::shared_ptr<const Svg> blue = cache.svg(reused, size, 20, 20, 1.0f, Brush::none());
+  REQUIRE(blue != red);
+  REQUIRE(blue->drawList()->brushes[0].gradient().colors().front().hexBlue() == 0xff);
+}
+
+TEST_CASE("Svg raster cache", "[graphics]") {
+  static constexpr char kSvg[] = "<svg xmlns=\"http://www.w3.org/2000/svg\" viewBox=\"0 0 10 10\">"
+                                 "<rect width=\"5\" height=\"10\" fill=\"currentColor\"/></svg>";
+
+  Svg svg(reinterpret_cast<const unsigned char*>(kSvg), sizeof(kSvg) - 1);
+  svg.setDimensions(20, 20, 1.0f);
+  svg.setRasterized(true);
+
+  Brush red = Brush::solid(0xffff0000);
+  const SvgRaster* raster = svg.raster(20, 20, 1.0f, &red);
+  REQUIRE(raster != nullptr);
+  REQUIRE(raster->pixels.size() == 20 * 20 * 4);
+  REQUIRE(raster->pixels[(10 * 20 + 2) * 4] == 0xff);
+  REQUIRE(raster->pixels[(10 * 20 + 2) * 4 + 3] == 0xff);
+  REQUIRE(raster->pixels[(10 * 20 + 15) * 4 + 3] == 0);
+  REQUIRE(svg.raster(20, 20, 1.0f, &red) == raster);
+
+  std::shared_ptr<const SvgRaster> held = svg.sharedRaster(20, 20, 1.0f, &red);
+  REQUIRE(held.get() == raster);
+
+  Brush blue = Brush::solid(0xff0000ff);
+  const SvgRaster* blue_raster = svg.raster(20, 20, 1.0f, &blue);
+  REQUIRE(blue_raster->pixels[(10 * 20 + 2) * 4 + 2] == 0xff);
+  REQUIRE(held->pixels.size() == 20 * 20 * 4);
+  REQUIRE(held->pixels[(10 * 20 + 2) * 4] == 0xff);
+
+  Brush gradient = Brush::horizontal(0xffff0000, 0xff0000ff);
+  REQUIRE(svg.raster(20, 20, 1.0f, &gradient) == nullptr);
+
+  CanvasTestFixture fixture;
+  Canvas& canvas = fixture.canvas();
+  svg.setDimensions(100, 100, 1.0f);
+  canvas.setColor(0xff000000);
+  canvas.fill(0, 0, canvas.width(), canvas.height());
+  canvas.setColor(0xffff0000);
+  canvas.svg(svg, 0, 0);
+  const auto& screenshot = canvas.takeScreenshot();
+  REQUIRE(screenshot.sample(25, 50).hexRed() == 0xff);
+  REQUIRE(screenshot.sample(75, 50).hexRed() == 0);
+}
+
+TEST_CASE("Shared canvas resources outlive their last canvas while retained", "[graphics]") {
+  CanvasResources::setRetainPeriod(60000);
+  std::shared_ptr<CanvasResources> resources = CanvasResources::shared();
+  const CanvasResources* first = resources.get();
+  resources = nullptr;
+
+  resources = CanvasResources::shared();
+  REQUIRE(resources.get() == first);
+  REQUIRE(CanvasResources::shared() == resources);
+
+  resources = nullptr;
+  CanvasResources::releaseRetained();
+  CanvasResources::setRetainPeriod(0);
+}
+
+TEST_CASE("Screenshots save on the thread pool without copying", "[graphics]") {
+  std::vector<uint8_t> pixels(4 * 4 * 4, 0xff);
+  Screenshot screenshot(pixels.data(), 4, 4);
+  File file = createTemporaryFile("png");
+
+  TaskFuture<bool> saved = screenshot.saveAsync(file.string());
+  REQUIRE(screenshot.width() == 0);
+  REQUIRE(screenshot.height() == 0);
+  REQUIRE(saved.get());
+
+  size_t size = 0;
+  REQUIRE(loadFileData(file, size));
+  REQUIRE(size > 0);
+  std::filesystem::remove(file);
+}
+
+TEST_CASE("Async screenshots call back with the rendered frame", "[graphics]") {
+  CanvasTestFixture fixture;
+  Canvas& canvas = fixture.canvas();
+  canvas.setColor(0xffff0000);
+  canvas.fill(0, 0, canvas.width(), canvas.height());
+
+  int calls = 0;
+  auto callback = [&calls](const Screenshot& screenshot) {
+    calls++;
+    REQUIRE(screenshot.width() == 200);
+    REQUIRE(screenshot.height() == 200);
+    REQUIRE(screenshot.sample(100, 100).hexRed() == 0xff);
+  };
+
+  for (int i = 0; i < 3; ++i)
+    canvas.takeScreenshotAsync(callback);
+  canvas.finishScreenshots();
+  REQUIRE(calls == 3);
+  REQUIRE_FALSE(canvas.screenshotsPending());
+}
+
+TEST_CASE("Batches past the 16 bit index limit draw in chunks", "[graphics]") {
+  static constexpr int kNumTriangles = 2 * TransientBuffers::kMaxQuadsPerDraw + 1;
+  CanvasTestFixture fixture;
+  Canvas& canvas = fixture.canvas();
+  Region region;
+  region.setBounds(0, 0, 100, 100);
+  canvas.addRegion(&region);
+
+  auto submitTriangles = [&](int count) {
+    canvas.beginRegion(&region);
+    canvas.setColor(0xffff0000);
+    for (int i = 0; i < count; ++i) {
+      float x = i % 90;
+      float y = (i / 90) % 90;
+      canvas.triangle(x, y, x + 4.0f, y, x, y + 4.0f);
+    }
+    canvas.endRegion();
+    region.invalidate();
+    canvas.submit();
+  };
+
+  submitTriangles(1);
+  Canvas::FrameStats single = canvas.frameStats();
+  REQUIRE(TransientBuffers::lastFrameUsage().split_draws == 0);
+
+  submitTriangles(kNumTriangles);
+  int split_draws = TransientBuffers::lastFrameUsage().split_draws;
+  REQUIRE(split_draws >= 2);
+  REQUIRE(canvas.frameStats().draw_calls == single.draw_calls + split_draws);
+  REQUIRE(canvas.frameStats().vertices == single.vertices + (kNumTriangles - 1) * kVerticesPerQuad);
+}
+
+TEST_CASE("Windowless canvases past the view limit split into frames", "[graphics]") {
+  std::shared_ptr<CanvasResources> resources = std::make_shared<CanvasResources>();
+  std::vector<std::unique_ptr<Canvas>> canvases;
+  std::vector<Canvas*> farm;
+  auto addCanvas = [&] {
+    canvases.push_back(std::make_unique<Canvas>(resources));
+    canvases.back()->setWindowless(20, 20);
+    canvases.back()->setColor(0xffff0000);
+    canvases.back()->rectangle(2, 2, 10, 10);
+    farm.push_back(canvases.back().get());
+  };
+
+  addCanvas();
+  int views_per_canvas = canvases[0]->maxSubmitViews();
+  REQUIRE(views_per_canvas > 0);
+  int num_canvases = Canvas::maxViews() / views_per_canvas + 1;
+  for (int i = 1; i < num_canvases; ++i)
+    addCanvas();
+
+  REQUIRE(canvases.back()->peakViewsUsed() == 0);
+  REQUIRE(Canvas::submitWindowless(farm) >= 2);
+  for (Canvas* canvas : farm) {
+    REQUIRE(canvas->viewsUsed() > 0);
+    REQUIRE(canvas->viewsUsed() <= views_per_canvas);
+  }
+}
@@ -83,6 +83,9 @@ TEST_CASE("Color fromHexString correctly initializes", "[graphics]") {
   REQUIRE(Color(0xff123456) == Color::fromHexString("123456"));
   REQUIRE(Color(0xff123456) == Color::fromHexString("#123456"));
   REQUIRE(Color(0) == Color::fromHexString(""));
+  REQUIRE(Color(0xffaabbcc) == Color::fromHexString("#abc"));
+  REQUIRE(Color(0xaabbccdd) == Color::fromHexString("AbCd"));
+  REQUIRE(Color() == Color::fromHexString("#12zz34"));
 }
 
 TEST_CASE("Color toARGBHexString converts correctly", "[graphics]") {
@@ -22,6 +22,7 @@
 #include "lato_regular.h"
 #include "visage_graphics/canvas.h"
 #include "visage_graphics/font.h"
+#include "visage_graphics/text.h"
 
 #include <catch2/catch_approx.hpp>
 #include <catch2/catch_test_macros.hpp>
@@ -37,4 +38,287 @@ TEST_CASE("Font embedded test", "[graphics]") {
   canvas.submit();
   canvas.takeScreenshot();
   canvas.submit();
-}
\ No newline at end of file
+}
+
+TEST_CASE("Upright text draws one instance per glyph", "[graphics]") {
+  Font font(16, fonts::Lato_Regular_ttf_data, sizeof(fonts::Lato_Regular_ttf_data), 1.0f);
+  Canvas canvas;
+  canvas.setWindowless(200, 50);
+  Region region;
+  region.setBounds(0, 0, 200, 50);
+  canvas.addRegion(&region);
+
+  auto submitText = [&](const String& string) {
+    canvas.beginRegion(&region);
+    canvas.setColor(0xffffffff);
+    canvas.text(string, font, Font::kLeft, 0, 0, 200, 50);
+    canvas.endRegion();
+    region.invalidate();
+    canvas.submit();
+  };
+
+  submitText("L");
+  Canvas::FrameStats single = canvas.frameStats();
+
+  Text text(U"Label value", font, Font::kLeft);
+  int num_glyphs = text.layout(font, 200, 50).size();
+  submitText("Label value");
+  REQUIRE(canvas.frameStats().draw_calls == single.draw_calls);
+  REQUIRE(canvas.frameStats().vertices == single.vertices + (num_glyphs - 1) * kVerticesPerQuad);
+}
+
+TEST_CASE("Packed glyph table lookup", "[graphics]") {
+  PackedGlyphTable table;
+  REQUIRE(table.find('a') == nullptr);
+  REQUIRE(table.find(0x1f600) == nullptr);
+
+  PackedGlyph* latin = table['a'];
+  latin->x_advance = 7.0f;
+  PackedGlyph* emoji = table[0x1f600];
+  emoji->x_advance = 12.0f;
+
+  for (char32_t character = 0x20000; character < 0x20400; ++character)
+    table[character]->x_advance = character;
+  for (char32_t character = 0x100; character < 0x3000; character += 7)
+    table[character]->x_advance = character;
+
+  REQUIRE(table['a'] == latin);
+  REQUIRE(table[0x1f600] == emoji);
+  REQUIRE(table.find('a')->x_advance == 7.0f);
+  REQUIRE(table.find(0x1f600)->x_advance == 12.0f);
+  REQUIRE(table.find(0x20123)->x_advance == 0x20123);
+  REQUIRE(table.find(0x100 + 7 * 10)->x_advance == 0x100 + 7 * 10);
+  REQUIRE(table.find(0x101) == nullptr);
+  REQUIRE(table.find(0x20400) == nullptr);
+  REQUIRE(table.size() == 2 + 0x400 + (0x3000 - 0x100 + 6) / 7);
+}
+
+TEST_CASE("Text layout is cached until modified", "[graphics]") {
+  Font font(16, fonts::Lato_Regular_ttf_data, sizeof(fonts::Lato_Regular_ttf_data), 1.0f);
+  Text text(U"Label", font, Font::kLeft);
+
+  const std::vector<FontAtlasQuad>& layout = text.layout(font, 100, 20);
+  REQUIRE(layout.size() == 5);
+  float end = layout.back().x;
+  const FontAtlasQuad* data = layout.data();
+  REQUIRE(text.layout(font, 100, 20).data() == data);
+
+  text.setJustification(Font::kRight);
+  REQUIRE(text.layout(font, 100, 20).back().x > end);
+
+  text.setText(U"Label value");
+  REQUIRE(text.layout(font, 100, 20).size() == 11);
+  float narrow_end = text.layout(font, 100, 20).back().x;
+  REQUIRE(text.layout(font, 200, 20).back().x > narrow_end);
+}
+
+TEST_CASE("Text styles follow edits without redoing the layout", "[graphics]") {
+  Font font(16, fonts::Lato_Regular_ttf_data, sizeof(fonts::Lato_Regular_ttf_data), 1.0f);
+  Text text(U"int value = 10;", font, Font::kLeft);
+  Brush red = Brush::solid(0xffff0000);
+  Brush blue = Brush::solid(0xff0000ff);
+  text.setStyles({ { 0, 3, red }, { 12, 2, blue } });
+
+  const FontAtlasQuad* data = text.layout(font, 200, 20).data();
+  REQUIRE(text.layout(font, 200, 20)[1].style == 1);
+  REQUIRE(text.layout(font, 200, 20)[5].style == 0);
+  REQUIRE(text.layout(font, 200, 20)[13].style == 2);
+
+  text.restyle(4, 9, { { 4, 5, blue } });
+  REQUIRE(text.styles().size() == 3);
+  REQUIRE(text.layout(font, 200, 20).data() == data);
+  REQUIRE(text.layout(font, 200, 20)[5].style == 2);
+
+  text.replaceText(4, 5, U"count");
+  REQUIRE(text.styles().size() == 2);
+  REQUIRE(text.styles()[1].start == 12);
+
+  text.replaceText(12, 0, U"1");
+  REQUIRE(text.styles()[1].start == 13);
+  text.replaceText(14, 0, U"0");
+  REQUIRE(text.styles()[1].length == 3);
+
+  std::vector<TextStyle> piece = text.stylesInRange(2, 14);
+  REQUIRE(piece.size() == 2);
+  REQUIRE(piece[0].start == 0);
+  REQUIRE(piece[0].length == 1);
+  REQUIRE(piece[1].start == 11);
+  REQUIRE(piece[1].length == 1);
+}
+
+TEST_CASE("Distance field fonts share one atlas across sizes", "[graphics]") {
+  FontCache::setSdfThreshold(48);
+  Font small(12, fonts::Lato_Regular_ttf_data, sizeof(fonts::Lato_Regular_ttf_data), 1.0f);
+  Font large(100, fonts::Lato_Regular_ttf_data, sizeof(fonts::Lato_Regular_ttf_data), 1.0f);
+  Font larger(200, fonts::Lato_Regular_ttf_data, sizeof(fonts::Lato_Regular_ttf_data), 1.0f);
+  FontCache::setSdfThreshold(0);
+
+  REQUIRE_FALSE(small.sdf());
+  REQUIRE(large.sdf());
+  REQUIRE(large.packedFont() == larger.packedFont());
+  REQUIRE(large.packedFont() != small.packedFont());
+
+  std::u32string text = U"Scalable";
+  float large_width = large.stringWidth(text);
+  REQUIRE(larger.stringWidth(text) == Approx(2.0f * large_width).epsilon(0.01f));
+  REQUIRE(large_width == Approx(100.0f / 12.0f * small.stringWidth(text)).epsilon(0.1f));
+  REQUIRE(larger.lineHeight() == Approx(2.0f * large.lineHeight()).margin(1.0f));
+  REQUIRE(large.capitalHeight() > 0.0f);
+  REQUIRE(large.capitalHeight() < large.lineHeight());
+
+  Text label(text, large);
+  REQUIRE(label.layout(large, 1000, 200).front().width > FontCache::kSdfSpread);
+  float large_end = label.layout(large, 1000, 200).back().x;
+  REQUIRE(label.layout(larger, 1000, 200).back().x != large_end);
+}
+
+TEST_CASE("Resized fonts reuse the interned type face", "[graphics]") {
+  Font font(12, fonts::Lato_Regular_ttf_data, sizeof(fonts::Lato_Regular_ttf_data), 1.0f);
+  Font larger(24, fonts::Lato_Regular_ttf_data, sizeof(fonts::Lato_Regular_ttf_data), 1.0f);
+  Font resized = font.withSize(24);
+  REQUIRE(resized.packedFont() == larger.packedFont());
+  REQUIRE(resized.withSize(12).packedFont() == font.packedFont());
+  REQUIRE(font.withDpiScale(2.0f).packedFont() == larger.packedFont());
+  REQUIRE(font.withDpiScale(2.0f).size() == 12.0f);
+
+  Font copy = font;
+  REQUIRE(copy.packedFont() == font.packedFont());
+  REQUIRE(copy.stringWidth(U"Interned") == font.stringWidth(U"Interned"));
+}
+
+TEST_CASE("Bitmap fonts of every size share one glyph atlas", "[graphics]") {
+  Font small(12, fonts::Lato_Regular_ttf_data, sizeof(fonts::Lato_Regular_ttf_data), 1.0f);
+  Font large(22, fonts::Lato_Regular_ttf_data, sizeof(fonts::Lato_Regular_ttf_data), 1.0f);
+  FontCache::setSdfThreshold(48);
+  Font sdf(100, fonts::Lato_Regular_ttf_data, sizeof(fonts::Lato_Regular_ttf_data), 1.0f);
+  FontCache::setSdfThreshold(0);
+
+  REQUIRE(small.packedFont() != large.packedFont());
+  REQUIRE(small.atlasId() == large.atlasId());
+  REQUIRE(sdf.atlasId() != small.atlasId());
+
+  std::u32string text = U"Shared";
+  std::vector<FontAtlasQuad> small_quads(text.size());
+  std::vector<FontAtlasQuad> large_quads(text.size());
+  small.setVertexPositions(small_quads.data(), text.c_str(), text.size(), 0, 0, 200, 40);
+  large.setVertexPositions(large_quads.data(), text.c_str(), text.size(), 0, 0, 200, 40);
+  REQUIRE(small.atlasWidth() == large.atlasWidth());
+  REQUIRE(small_quads[0].packed_glyph != large_quads[0].packed_glyph);
+  REQUIRE((small_quads[0].packed_glyph->atlas_left != large_quads[0].packed_glyph->atlas_left ||
+           small_quads[0].packed_glyph->atlas_top != large_quads[0].packed_glyph->atlas_top));
+
+  Canvas canvas;
+  canvas.setWindowless(200, 50);
+  canvas.setColor(0xffffffff);
+  canvas.text("Small", small, Font::kLeft, 0, 0, 200, 20);
+  canvas.text("Large", large, Font::kLeft, 0, 20, 200, 30);
+  canvas.submit();
+}
+
+TEST_CASE("Packed glyphs are restored from the disk cache", "[graphics]") {
+  File cache_directory = createTemporaryFile("glyphs");
+  FontCache::setDiskCacheDirectory(cache_directory);
+
+  std::u32string text = U"Cached glyphs";
+  std::vector<FontAtlasQuad> original(text.size());
+  {
+    Font font(18, fonts::Lato_Regular_ttf_data, sizeof(fonts::Lato_Regular_ttf_data), 1.0f);
+    font.setVertexPositions(original.data(), text.c_str(), text.size(), 0, 0, 200, 40);
+    for (FontAtlasQuad& quad : original)
+      quad.packed_glyph = nullptr;
+  }
+  FontCache::clearStaleFonts();
+  FontCache::flushDiskCache();
+  REQUIRE(searchForFiles(cache_directory, ".*\\.glyphs").size() == 1);
+
+  Font font(18, fonts::Lato_Regular_ttf_data, sizeof(fonts::Lato_Regular_ttf_data), 1.0f);
+  std::vector<FontAtlasQuad> restored(text.size());
+  font.setVertexPositions(restored.data(), text.c_str(), text.size(), 0, 0, 200, 40);
+  FontCache::setDiskCacheDirectory({});
+
+  for (int i = 0; i < text.size(); ++i) {
+    REQUIRE(restored[i].x == original[i].x);
+    REQUIRE(restored[i].y == original[i].y);
+    REQUIRE(restored[i].width == original[i].width);
+    REQUIRE(restored[i].height == original[i].height);
+  }
+  REQUIRE(restored[1].packed_glyph->atlas_left >= 0);
+
+  std::error_code error;
+  std::filesystem::remove_all(cache_directory, error);
+}
+
+TEST_CASE("Kerning tightens glyph pairs", "[graphics]") {
+  Font font(24, fonts::Lato_Regular_ttf_data, sizeof(fonts::Lato_Regular_ttf_data), 1.0f);
+  Font kerned = font.withKerning();
+  REQUIRE_FALSE(font.kerning());
+  REQUIRE(kerned.kerning());
+  REQUIRE(kerned.withSize(30).kerning());
+
+  std::u32string text = U"AVAToWa";
+  float width = font.stringWidth(text);
+  float kerned_width = kerned.stringWidth(text);
+  REQUIRE(kerned_width < width);
+  REQUIRE(kerned.stringWidth(text) == kerned_width);
+  REQUIRE(kerned.stringWidth(U"II") == font.stringWidth(U"II"));
+
+  std::vector<FontAtlasQuad> quads(text.size());
+  kerned.setVertexPositions(quads.data(), text.c_str(), text.size(), 0, 0, 500, 40, Font::kLeft);
+  REQUIRE(quads.back().x + quads.back().packed_glyph->x_advance ==
+          Approx(kerned_width + quads.back().packed_glyph->x_offset).margin(0.01f));
+
+  Text label(text, font);
+  float end = label.layout(font, 500, 40).back().x;
+  REQUIRE(label.layout(kerned, 500, 40).back().x < end);
+}
+
+TEST_CASE("Measuring text does not pack glyphs", "[graphics]") {
+  FontCache::clearStaleFonts();
+  Font font(27, fonts::Lato_Regular_ttf_data, sizeof(fonts::Lato_Regular_ttf_data), 1.0f);
+  std::u32string text = U"Measured only";
+  float width = font.stringWidth(text);
+  REQUIRE(width > 0.0f);
+  REQUIRE(font.widthOverflowIndex(text.c_str(), text.size(), width * 0.5f) < text.size());
+  REQUIRE(font.atlasWidth() == 0);
+  REQUIRE(font.atlasHeight() == 0);
+
+  std::vector<FontAtlasQuad> quads(text.size());
+  font.setVertexPositions(quads.data(), text.c_str(), text.size(), 0, 0, 500, 40, Font::kLeft);
+  REQUIRE(font.atlasWidth() > 0);
+  REQUIRE(font.stringWidth(text) == width);
+}
+
+#ifndef NDEBUG
+TEST_CASE("Redrawing a label reuses region arenas", "[graphics]") {
+  Font font(16, fonts::Lato_Regular_ttf_data, sizeof(fonts::Lato_Regular_ttf_data), 1.0f);
+  Canvas canvas;
+  auto draw = [&] {
+    canvas.clearDrawnShapes();
+    canvas.setColor(0xffffffff);
+    canvas.text("Label value", font, Font::kLeft, 0, 0, 100, 20);
+  };
+
+  for (int i = 0; i < 3; ++i)
+    draw();
+  int allocations = Region::arenaAllocations();
+  for (int i = 0; i < 10; ++i)
+    draw();
+  REQUIRE(Region::arenaAllocations() == allocations);
+}
+#endif
+
+TEST_CASE("Unused fonts stay packed while retained", "[graphics]") {
+  FontCache::setRetainPeriod(60000);
+  const PackedFont* packed_font = nullptr;
+  {
+    Font font(23, fonts::Lato_Regular_ttf_data, sizeof(fonts::Lato_Regular_ttf_data));
+    packed_font = font.packedFont();
+  }
+  FontCache::clearStaleFonts();
+
+  Font font(23, fonts::Lato_Regular_ttf_data, sizeof(fonts::Lato_Regular_ttf_data));
+  REQUIRE(font.packedFont() == packed_font);
+
+  FontCache::releaseRetainedFonts();
+  FontCache::setRetainPeriod(0);
+}
@@ -21,6 +21,7 @@
 
 #include "visage_graphics/color.h"
 #include "visage_graphics/gradient.h"
+#include "visage_graphics/palette.h"
 
 #include <catch2/catch_approx.hpp>
 #include <catch2/catch_test_macros.hpp>
@@ -29,6 +30,10 @@
 using namespace visage;
 using namespace Catch;
 
+namespace {
+  VISAGE_THEME_COLOR(GradientTestPaletteColor, 0xff000000);
+}
+
 TEST_CASE("Gradient initialization", "[graphics]") {
   SECTION("Default constructor creates empty gradient") {
     Gradient gradient;
@@ -147,6 +152,23 @@ TEST_CASE("Gradient sampling", "[graphics]") {
     color = gradient.sample(1.0f);
     REQUIRE(color == blue);
   }
+
+  SECTION("Batch sampling matches single samples") {
+    Gradient gradient(0xffff0000, 0xff00ff00, 0xff0000ff);
+    gradient.addColorStop(Color(0xffffffff), 0.3f);
+    gradient.setReflect(true);
+
+    static constexpr int kResolution = 37;
+    Color samples[kResolution];
+    gradient.sample(samples, kResolution);
+    for (int i = 0; i < kResolution; ++i) {
+      Color expected = gradient.sample(i / (kResolution - 1.0f));
+      REQUIRE(samples[i].red() == Approx(expected.red()));
+      REQUIRE(samples[i].green() == Approx(expected.green()));
+      REQUIRE(samples[i].blue() == Approx(expected.blue()));
+      REQUIRE(samples[i].alpha() == Approx(expected.alpha()));
+    }
+  }
 }
 
 TEST_CASE("Gradient comparison", "[graphics]") {
@@ -491,4 +513,101 @@ TEST_CASE("Brush operations", "[graphics]") {
     REQUIRE(position.coefficienty2 == Approx(end_position.coefficienty2).margin(0.01f));
     REQUIRE(position.coefficientxy == Approx(end_position.coefficientxy).margin(0.01f));
   }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Gradient hash follows equality", "[graphics]") {
+  Color red(1.0f, 1.0f, 0.0f, 0.0f);
+  Color blue(1.0f, 0.0f, 0.0f, 1.0f);
+
+  Gradient gradient1(red, blue);
+  Gradient gradient2(red, blue);
+  REQUIRE(gradient1 == gradient2);
+  REQUIRE(gradient1.hash() == gradient2.hash());
+
+  Gradient copy = gradient1;
+  copy.setColor(1, red);
+  REQUIRE(copy != gradient1);
+  REQUIRE(copy.hash() != gradient1.hash());
+
+  gradient2.setReflect(true);
+  REQUIRE(gradient2 != gradient1);
+  gradient2.setReflect(false);
+  REQUIRE(gradient2.hash() == gradient1.hash());
+
+  REQUIRE(gradient1.withMultipliedAlpha(0.5f).hash() != gradient1.hash());
+  REQUIRE(Gradient(Color(0.0f, 0.0f, 0.0f, 0.0f)).hash() == Gradient(Color(-0.0f, 0.0f, 0.0f, 0.0f)).hash());
+}
+
+TEST_CASE("Solid brushes skip the gradient atlas", "[graphics]") {
+  GradientAtlas atlas;
+  int height = atlas.height();
+
+  Color red(0.5f, 1.0f, 0.0f, 0.0f);
+  PackedBrush solid(&atlas, Brush::solid(red));
+  REQUIRE(solid.solid());
+  REQUIRE(atlas.height() == height);
+
+  GradientTexturePosition position {};
+  PackedBrush::computeVertexGradientTexturePositions(position, &solid);
+  float mult = red.hdr() / Color::kGradientNormalization;
+  REQUIRE(position.from_x == Approx(-1.0f - mult));
+  REQUIRE(position.from_y == Approx(-1.0f));
+  REQUIRE(position.to_y == Approx(-1.5f));
+  REQUIRE(solid.originalBrush().gradient() == Brush::solid(red).gradient());
+
+  PackedBrush horizontal(&atlas, Brush::horizontal(red, red));
+  REQUIRE_FALSE(horizontal.solid());
+  REQUIRE(atlas.height() > height);
+}
+
+TEST_CASE("Palette bound brushes read their color when replayed", "[graphics]") {
+  GradientAtlas atlas;
+  Palette palette;
+  int unused = palette.addColor(0xff000000);
+  palette.setColor(GradientTestPaletteColor, Color(0xff112233));
+  Brush bound_color;
+  REQUIRE(palette.color({}, GradientTestPaletteColor, bound_color));
+
+  PackedBrush brush(&atlas, bound_color);
+  brush.bindPaletteColor(&palette, {}, GradientTestPaletteColor);
+  REQUIRE(brush.solidColor().toARGB() == 0xff112233);
+
+  int index = palette.colorMap({}, GradientTestPaletteColor);
+  palette.setEditColor(index, Brush::solid(0xff445566));
+  REQUIRE(brush.solidColor().toARGB() == 0xff445566);
+  REQUIRE(brush.originalBrush().gradient() == palette.colorIndex(index).gradient());
+
+  palette.removeColor(unused);
+  REQUIRE(brush.solidColor().toARGB() == 0xff445566);
+
+  palette.setColor(GradientTestPaletteColor, Color(0xff778899));
+  REQUIRE(brush.solidColor().toARGB() == 0xff778899);
+
+  palette.setColor(GradientTestPaletteColor, Brush::vertical(0xff445566, 0xff778899));
+  REQUIRE(brush.solidColor().toARGB() == 0xff112233);
+}
+
+TEST_CASE("Gradient slots update in place", "[graphics]") {
+  GradientAtlas atlas;
+  GradientSlot slot(16);
+  slot.setGradient(Gradient(0xff000000, 0xffffffff));
+  PackedBrush brush(&atlas, slot, GradientPosition(GradientPosition::InterpolationShape::Horizontal));
+  REQUIRE_FALSE(brush.solid());
+  REQUIRE(brush.gradient()->gradient().resolution() == 16);
+
+  int x = brush.gradient()->x();
+  int y = brush.gradient()->y();
+  int pack_version = atlas.packVersion();
+  for (int i = 0; i <= 10; ++i) {
+    Gradient from(0xff000000, 0xffffffff);
+    Gradient to(0xffff0000, 0xff0000ff, 0xff00ff00);
+    slot.setGradient(Gradient::interpolate(from, to, i / 10.0f));
+  }
+
+  REQUIRE(atlas.packVersion() == pack_version);
+  REQUIRE(brush.gradient()->x() == x);
+  REQUIRE(brush.gradient()->y() == y);
+  REQUIRE(brush.gradient()->gradient().resolution() == 16);
+  REQUIRE(brush.gradient()->gradient().sample(0.0f).toARGB() == 0xffff0000);
+  REQUIRE(brush.gradient()->gradient().sample(1.0f).toARGB() == 0xff00ff00);
+}
@@ -19,12 +19,471 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include "visage_graphics/canvas.h"
+#include "visage_graphics/fetched_files.h"
 #include "visage_graphics/image.h"
+#include "visage_graphics/resource_usage.h"
+#include "visage_graphics/tiled_image.h"
+#include "visage_utils/file_system.h"
+#include "visage_utils/thread_utils.h"
 
+#include <bgfx/bgfx.h>
 #include <catch2/catch_approx.hpp>
 #include <catch2/catch_test_macros.hpp>
+#include <filesystem>
 #include <memory>
 #include <random>
 
 using namespace visage;
 using namespace Catch;
+
+TEST_CASE("Decoded image cache evicts least recently used pixels", "[graphics]") {
+  static constexpr int kImageBytes = 8 * 8 * 4;
+  unsigned char data[3] = {};
+  Image first(data, 1);
+  Image second(data + 1, 1);
+  Image third(data + 2, 1);
+
+  DecodedImageCache cache(2 * kImageBytes);
+  cache.add(first, 8, 8, std::vector<unsigned char>(kImageBytes, 1));
+  cache.add(second, 8, 8, std::vector<unsigned char>(kImageBytes, 2));
+  REQUIRE(cache.bytes() == 2 * kImageBytes);
+  REQUIRE(cache.find(first, 8, 8)[0] == 1);
+
+  cache.add(third, 8, 8, std::vector<unsigned char>(kImageBytes, 3));
+  REQUIRE(cache.size() == 2);
+  REQUIRE(cache.find(second, 8, 8) == nullptr);
+  REQUIRE(cache.find(first, 8, 8)[0] == 1);
+  REQUIRE(cache.find(third, 8, 8)[0] == 3);
+
+  REQUIRE(cache.find(first, 4, 4) == nullptr);
+  REQUIRE(cache.size() == 1);
+
+  cache.add(first, 16, 16, std::vector<unsigned char>(4 * kImageBytes, 1));
+  REQUIRE(cache.find(first, 16, 16) == nullptr);
+  REQUIRE(cache.bytes() == kImageBytes);
+
+  cache.setMaxBytes(0);
+  REQUIRE(cache.size() == 0);
+  REQUIRE(cache.bytes() == 0);
+}
+
+TEST_CASE("Shadow cache masks fade to a solid edge and are reused", "[graphics]") {
+  ShadowCache cache;
+  ShadowCache::Mask* mask = cache.mask(6.0f, 10.0f);
+  REQUIRE(mask != nullptr);
+  REQUIRE(mask->extent == 10);
+  int size = mask->extent + 1;
+  REQUIRE(mask->pixels->size() == size * size * 4);
+
+  auto alpha = [&](int x, int y) { return (*mask->pixels)[(y * size + x) * 4 + 3]; };
+  REQUIRE(alpha(0, 0) < alpha(0, size - 1));
+  REQUIRE(alpha(size - 1, size - 1) == 255);
+  for (int i = 0; i < size; ++i) {
+    REQUIRE(alpha(size - 1, i) == alpha(size - 2, i));
+    REQUIRE(alpha(i, size - 1) == alpha(i, size - 2));
+  }
+
+  REQUIRE(cache.mask(6.01f, 10.0f) == mask);
+  REQUIRE(cache.mask(6.0f, 12.0f) != mask);
+  REQUIRE(cache.size() == 2);
+  REQUIRE(cache.mask(1.0f, ShadowCache::kMaxExtent + 1.0f) == nullptr);
+
+  for (int i = 0; i <= ShadowCache::kRetainedFrames; ++i)
+    cache.nextFrame();
+  REQUIRE(cache.size() == 0);
+}
+
+TEST_CASE("Async image decoding uploads pixels once ready", "[graphics]") {
+  static constexpr unsigned char kPng[] = {
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x48, 0x44,
+    0x52, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x02, 0x08, 0x06, 0x00, 0x00, 0x00, 0x72,
+    0xb6, 0x0d, 0x24, 0x00, 0x00, 0x00, 0x11, 0x49, 0x44, 0x41, 0x54, 0x78, 0x9c, 0x63, 0xf8,
+    0xcf, 0xc0, 0xf0, 0x1f, 0x84, 0x19, 0x60, 0x0c, 0x00, 0x47, 0xca, 0x07, 0xf9, 0x67, 0x59,
+    0x6e, 0xb7, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82
+  };
+
+  ImageAtlas atlas(ImageAtlas::DataType::RGBA8);
+  atlas.setAsyncDecoding(true);
+  ImageAtlas::PackedImage packed = atlas.addImage(Image(kPng, sizeof(kPng)));
+  REQUIRE(packed.w() == 2);
+  REQUIRE(packed.h() == 2);
+  REQUIRE(packed.loading());
+  REQUIRE(atlas.decoding());
+
+  for (int i = 0; i < 400 && atlas.decoding(); ++i) {
+    Thread::sleep(5);
+    atlas.uploadDecodedImages(1.0);
+  }
+
+  REQUIRE_FALSE(atlas.decoding());
+  REQUIRE_FALSE(packed.loading());
+  REQUIRE(packed.decodedTime() == 1.0);
+  REQUIRE(atlas.lastDecodedTime() == 1.0);
+  REQUIRE(atlas.decodedCache().size() == 1);
+}
+
+TEST_CASE("Image atlas starts a new page instead of growing past the max size", "[graphics]") {
+  static constexpr int kImageSize = 100;
+  static constexpr int kNumImages = 12;
+  std::vector<unsigned char> data(kNumImages);
+
+  ImageAtlas atlas(ImageAtlas::DataType::RGBA8);
+  atlas.setMaxPageSize(256);
+
+  std::vector<ImageAtlas::PackedImage> packed;
+  for (int i = 0; i < kNumImages; ++i)
+    packed.push_back(atlas.addData(data.data() + i, kImageSize, kImageSize));
+
+  REQUIRE(atlas.numPages() > 1);
+  ImageAtlas::Page* first_page = packed[0].page();
+  REQUIRE(atlas.width(first_page) <= 256);
+  REQUIRE(atlas.height(first_page) <= 256);
+
+  std::vector<std::pair<int, int>> first_positions;
+  for (const auto& image : packed) {
+    if (image.page() == first_page)
+      first_positions.emplace_back(image.x(), image.y());
+  }
+
+  for (int i = 0; i < kNumImages; ++i)
+    packed.push_back(atlas.addData(data.data() + i, kImageSize + 1, kImageSize));
+
+  std::vector<std::pair<int, int>> positions;
+  for (int i = 0; i < kNumImages; ++i) {
+    if (packed[i].page() == first_page)
+      positions.emplace_back(packed[i].x(), packed[i].y());
+  }
+  REQUIRE(positions == first_positions);
+
+  for (const auto& image : packed) {
+    REQUIRE(image.x() + image.w() <= atlas.width(image.page()));
+    REQUIRE(image.y() + image.h() <= atlas.height(image.page()));
+  }
+
+  int num_pages = atlas.numPages();
+  packed.erase(packed.begin() + kNumImages, packed.end());
+  atlas.clearStaleImages();
+  REQUIRE(atlas.numPages() < num_pages);
+
+  packed.clear();
+  atlas.clearStaleImages();
+  REQUIRE(atlas.numPages() == 0);
+}
+
+TEST_CASE("Packed atlas maps track removed area and move with their layout", "[graphics]") {
+  PackedAtlasMap<int> atlas_map;
+  atlas_map.setPadding(0);
+  for (int i = 0; i < 4; ++i)
+    atlas_map.addRect(i, 16, 8);
+  REQUIRE(atlas_map.pack(64, 64));
+  REQUIRE(atlas_map.removedArea() == 0);
+
+  atlas_map.removeRect(1);
+  atlas_map.removeRect(2);
+  REQUIRE(atlas_map.removedArea() == 2 * 16 * 8);
+
+  PackedRect last = atlas_map.rectForId(3);
+  PackedAtlasMap<int> moved = std::move(atlas_map);
+  REQUIRE(moved.rectForId(3).x == last.x);
+  REQUIRE(moved.rectForId(3).y == last.y);
+  REQUIRE(moved.pack(64, 64));
+  REQUIRE(moved.removedArea() == 0);
+  REQUIRE(moved.numRects() == 2);
+  REQUIRE(moved.width() == 64);
+}
+
+TEST_CASE("Streaming graph data keeps a contiguous window over its ring", "[graphics]") {
+  GraphData data(4);
+  const GraphData& points = data;
+  data[0] = 1.0f;
+  data.setStreaming(true);
+  REQUIRE(points[0] == 1.0f);
+  REQUIRE(data.dataWidth() == 7);
+
+  const float values[] = { 2.0f, 3.0f, 4.0f, 5.0f, 6.0f };
+  data.push(values, 5);
+  REQUIRE(data.ringOffset() == 1);
+  for (int i = 0; i < 4; ++i) {
+    REQUIRE(points[i] == values[i + 1]);
+    REQUIRE(reinterpret_cast<const float*>(data.data())[data.ringOffset() + i] == values[i + 1]);
+  }
+
+  data.markUploaded();
+  REQUIRE(data.dirtyColumns().empty());
+  data.push(7.0f);
+  data.push(8.0f);
+  REQUIRE(data.dirtyColumns() == std::vector<std::pair<int, int>> { { 1, 3 }, { 5, 7 } });
+
+  data.markUploaded();
+  data.push(values, 3);
+  REQUIRE(data.dirtyColumns() == std::vector<std::pair<int, int>> { { 3, 4 }, { 0, 2 }, { 4, 6 } });
+
+  ImageAtlas atlas(ImageAtlas::DataType::Float32);
+  ImageAtlas::PackedImage packed = atlas.addGraphData(data);
+  REQUIRE(packed.w() == data.dataWidth());
+  REQUIRE(data.dirtyColumns().empty());
+
+  data.push(9.0f);
+  ImageAtlas::PackedImage repacked = atlas.addGraphData(data);
+  REQUIRE(repacked.packedImageRect() == packed.packedImageRect());
+  REQUIRE(data.dirtyColumns().empty());
+
+  data.setStreaming(false);
+  REQUIRE(points[3] == 9.0f);
+}
+
+TEST_CASE("Graph data tracks changed points and versions", "[graphics]") {
+  GraphData data(8);
+  REQUIRE(data.dirtyColumns() == std::vector<std::pair<int, int>> { { 0, 8 } });
+
+  ImageAtlas atlas(ImageAtlas::DataType::Float32);
+  ImageAtlas::PackedImage packed = atlas.addGraphData(data);
+  REQUIRE(data.dirtyColumns().empty());
+
+  int version = data.version();
+  data.set(3, 0.0f);
+  REQUIRE(data.version() == version);
+  REQUIRE(data.dirtyColumns().empty());
+
+  data.set(5, 1.0f);
+  data[2] = 2.0f;
+  REQUIRE(data.version() != version);
+  REQUIRE(data.dirtyColumns() == std::vector<std::pair<int, int>> { { 2, 6 } });
+
+  ImageAtlas::PackedImage updated = atlas.addGraphData(data);
+  REQUIRE(updated.packedImageRect() == packed.packedImageRect());
+  REQUIRE(data.dirtyColumns().empty());
+
+  GraphData copy = data;
+  REQUIRE(copy[5] == 1.0f);
+  REQUIRE(copy.data() != data.data());
+  REQUIRE(copy.dirtyColumns() == std::vector<std::pair<int, int>> { { 0, 8 } });
+
+  HeatMapData heat_map(4, 2);
+  heat_map.markUploaded();
+  version = heat_map.version();
+  heat_map.set(1, 1, 0.0f);
+  REQUIRE(heat_map.version() == version);
+  heat_map.set(1, 1, 3.0f);
+  heat_map.set(2, 0, 3.0f);
+  REQUIRE(heat_map.version() != version);
+  REQUIRE(heat_map.dirtyColumns() == std::vector<std::pair<int, int>> { { 1, 3 } });
+}
+
+TEST_CASE("Decimated graph data keeps the peaks of each bucket", "[graphics]") {
+  GraphData data(1000);
+  for (int i = 0; i < data.numPoints(); ++i)
+    data[i] = 0.5f;
+  data[517] = 5.0f;
+  data[800] = -3.0f;
+
+  REQUIRE(&data.decimated(1000) == &data);
+  REQUIRE(&data.decimated(0) == &data);
+
+  const GraphData& decimated = data.decimated(100);
+  REQUIRE(decimated.numPoints() == 64);
+  REQUIRE(decimated[2 * (517 / 32) + 1] == 5.0f);
+  REQUIRE(decimated[2 * (800 / 32)] == -3.0f);
+  REQUIRE(decimated[0] == 0.5f);
+  REQUIRE(decimated[63] == 0.5f);
+
+  data[517] = 0.5f;
+  data[999] = 7.0f;
+  const GraphData& updated = data.decimated(100);
+  REQUIRE(updated[2 * (517 / 32) + 1] == 0.5f);
+  REQUIRE(updated[63] == 7.0f);
+  REQUIRE(updated[2 * (800 / 32)] == -3.0f);
+
+  GraphData copy = data;
+  copy[800] = 0.5f;
+  REQUIRE(copy.decimated(100)[2 * (800 / 32)] == 0.5f);
+  REQUIRE(data.decimated(100)[2 * (800 / 32)] == -3.0f);
+
+  data.setStreaming(true);
+  REQUIRE(&data.decimated(100) == &data);
+}
+
+TEST_CASE("Data ring marks set columns and their mirrors dirty", "[graphics]") {
+  DataRing ring(4, 2);
+  ring.markUploaded();
+  ring.set(1, 1, 1.0f);
+  REQUIRE(ring.at(1, 1) == 1.0f);
+  REQUIRE(ring.dirtyColumns() == std::vector<std::pair<int, int>> { { 1, 2 }, { 5, 6 } });
+
+  ring.set(3, 0, 2.0f);
+  REQUIRE(ring.dirtyColumns() == std::vector<std::pair<int, int>> { { 1, 4 }, { 5, 7 } });
+  REQUIRE(reinterpret_cast<const float*>(ring.data())[1 * ring.width() + 5] == 1.0f);
+
+  ring.markUploaded();
+  const float column[] = { 3.0f, 4.0f };
+  ring.push(column, 1);
+  ring.set(3, 1, 5.0f);
+  REQUIRE(ring.dirtyColumns() == std::vector<std::pair<int, int>> { { 0, 1 }, { 4, 5 } });
+}
+
+TEST_CASE("Streaming heat map data scrolls columns through its ring", "[graphics]") {
+  HeatMapData data(3, 2);
+  const HeatMapData& values = data;
+  data.set(2, 1, 1.0f);
+  data.setStreaming(true);
+  REQUIRE(values.at(2, 1) == 1.0f);
+  REQUIRE(data.dataWidth() == 5);
+
+  const float column[] = { 2.0f, 3.0f };
+  data.markUploaded();
+  data.pushColumn(column);
+  REQUIRE(data.ringOffset() == 1);
+  REQUIRE(values.at(1, 1) == 1.0f);
+  REQUIRE(values.at(2, 0) == 2.0f);
+  REQUIRE(values.at(2, 1) == 3.0f);
+  REQUIRE(data.dirtyColumns() == std::vector<std::pair<int, int>> { { 0, 1 }, { 3, 4 } });
+
+  const float* raw = reinterpret_cast<const float*>(data.data());
+  for (int y = 0; y < 2; ++y) {
+    for (int x = 0; x < 3; ++x)
+      REQUIRE(raw[y * data.dataWidth() + data.ringOffset() + x] == values.at(x, y));
+  }
+
+  ImageAtlas atlas(ImageAtlas::DataType::Float32);
+  ImageAtlas::PackedImage packed = atlas.addHeatMapData(data);
+  REQUIRE(packed.w() == data.dataWidth());
+  REQUIRE(packed.h() == 2);
+  REQUIRE(data.dirtyColumns().empty());
+
+  data.pushColumn(column);
+  REQUIRE(atlas.addHeatMapData(data).packedImageRect() == packed.packedImageRect());
+
+  data.setStreaming(false);
+  REQUIRE(values.at(0, 1) == 1.0f);
+  REQUIRE(values.at(1, 0) == 2.0f);
+}
+
+TEST_CASE("Reduced precision data atlases pack one channel per value", "[graphics]") {
+  REQUIRE(ImageAtlas(ImageAtlas::DataType::Float32).bytesPerChannel() == 4);
+  REQUIRE(ImageAtlas(ImageAtlas::DataType::Float16).bytesPerChannel() == 2);
+  REQUIRE(ImageAtlas(ImageAtlas::DataType::UNorm8).bytesPerChannel() == 1);
+  REQUIRE(ImageAtlas(ImageAtlas::DataType::UNorm8).numChannels() == 1);
+
+  GraphData data(8);
+  data.setPrecision(DataPrecision::Float16);
+  data.setNumPoints(16);
+  GraphData copy = data;
+  REQUIRE(copy.precision() == DataPrecision::Float16);
+
+  ImageAtlas atlas(ImageAtlas::DataType::Float16);
+  ImageAtlas::PackedImage packed = atlas.addGraphData(copy);
+  REQUIRE(packed.w() == 16);
+
+  HeatMapData heat_map(4, 4);
+  heat_map.setPrecision(DataPrecision::Float16);
+  heat_map.setValueRange(-90.0f, 0.0f, true);
+  HeatMapData heat_map_copy = heat_map;
+  REQUIRE(heat_map_copy.decibels());
+  REQUIRE(heat_map_copy.valueMin() == -90.0f);
+  REQUIRE(heat_map_copy.valueMax() == 0.0f);
+}
+
+TEST_CASE("Mipmapped images share one full size entry across draw sizes", "[graphics]") {
+  // 8x4 RGBA png, red on the left half and blue on the right.
+  static constexpr unsigned char kPng[] = {
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x48, 0x44,
+    0x52, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x04, 0x08, 0x06, 0x00, 0x00, 0x00, 0xb3,
+    0xcd, 0x7e, 0xf0, 0x00, 0x00, 0x00, 0x15, 0x49, 0x44, 0x41, 0x54, 0x78, 0xda, 0x63, 0xf8,
+    0xcf, 0xc0, 0xf0, 0x1f, 0x19, 0xa3, 0x71, 0xff, 0x33, 0xd0, 0x5e, 0x01, 0x00, 0x51, 0x14,
+    0x3f, 0xc1, 0xd5, 0x67, 0x67, 0x07, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae,
+    0x42, 0x60, 0x82
+  };
+
+  Canvas canvas;
+  canvas.setWindowless(10, 10);
+  ImageAtlas atlas(ImageAtlas::DataType::RGBA8);
+  Image small(kPng, sizeof(kPng), 16, 16);
+  small.mipmapped = true;
+  Image large(kPng, sizeof(kPng), 64, 64);
+  large.mipmapped = true;
+
+  ImageAtlas::PackedImage packed_small = atlas.addImage(small);
+  ImageAtlas::PackedImage packed_large = atlas.addImage(large);
+  REQUIRE(packed_small.packedImageRect() == packed_large.packedImageRect());
+  REQUIRE(packed_small.w() == 8);
+  REQUIRE(packed_small.h() == 4);
+  REQUIRE(atlas.numPages() == 1);
+
+  // The texture holds the decoded size and every level down to 1x1: 8x4, 4x2, 2x1 and 1x1.
+  static constexpr long long kMipChainBytes = (8 * 4 + 4 * 2 + 2 * 1 + 1 * 1) * 4;
+  long long start_bytes = ResourceTracker::usage(ResourceCategory::ImageAtlas).bytes;
+  REQUIRE(bgfx::isValid(atlas.textureHandle(packed_small.page())));
+  REQUIRE(ResourceTracker::usage(ResourceCategory::ImageAtlas).bytes == start_bytes + kMipChainBytes);
+
+  ImageAtlas::PackedImage resampled = atlas.addImage(Image(kPng, sizeof(kPng), 16, 16));
+  REQUIRE(resampled.w() == 16);
+  REQUIRE(resampled.page() != packed_small.page());
+  REQUIRE(atlas.numPages() == 2);
+}
+
+TEST_CASE("Tiled images decode visible tiles and fall back to coarser levels", "[graphics]") {
+  int decodes = 0;
+  TiledImage image(1000, 600, [&decodes](int level, int column, int row, int width, int height) {
+    decodes++;
+    return std::vector<unsigned char>(width * height * 4, level);
+  });
+  REQUIRE(image.numLevels() == 3);
+  REQUIRE(image.numColumns(0) == 4);
+  REQUIRE(image.numRows(0) == 3);
+  REQUIRE(image.levelForScale(1.0f) == 0);
+  REQUIRE(image.levelForScale(0.5f) == 1);
+  REQUIRE(image.levelForScale(0.3f) == 1);
+  REQUIRE(image.levelForScale(0.01f) == 2);
+
+  ImageAtlas atlas(ImageAtlas::DataType::RGBA8);
+  std::vector<TiledImage::TileDraw> tiles;
+  image.setMaxDecodesPerDraw(1);
+  image.collectTiles(&atlas, 2, Bounds(0.0f, 0.0f, 1000.0f, 600.0f), tiles);
+  REQUIRE(tiles.size() == 1);
+  REQUIRE(tiles[0].source.width() == 250.0f);
+  REQUIRE_FALSE(image.loading());
+
+  image.collectTiles(&atlas, 0, Bounds(100.0f, 100.0f, 300.0f, 300.0f), tiles);
+  REQUIRE(decodes == 2);
+  REQUIRE(tiles.size() == 4);
+  REQUIRE(image.loading());
+  REQUIRE(tiles[1].bounds.x() == 256.0f);
+  REQUIRE(tiles[1].source.x() == 64.0f);
+  REQUIRE(tiles[1].source.width() == 64.0f);
+
+  image.setMaxDecodesPerDraw(TiledImage::kDefaultMaxDecodesPerDraw);
+  image.collectTiles(&atlas, 0, Bounds(100.0f, 100.0f, 300.0f, 300.0f), tiles);
+  REQUIRE(decodes == 5);
+  REQUIRE_FALSE(image.loading());
+
+  image.setBudget(256 * 256 * 4);
+  image.collectTiles(&atlas, 0, Bounds(0.0f, 0.0f, 10.0f, 10.0f), tiles);
+  REQUIRE(image.numResidentTiles() == 1);
+  REQUIRE(image.residentBytes() == 256 * 256 * 4);
+}
+
+TEST_CASE("Fetched files resolve their data once and keep it", "[graphics]") {
+  const unsigned char bytes[] = { 1, 2, 3, 4, 5 };
+  File file = createTemporaryFile("bin");
+  REQUIRE(replaceFileWithData(file, bytes, sizeof(bytes)));
+
+  std::string url = file.string();
+  EmbeddedFile fetched = { "fetched", nullptr, sizeof(bytes), url.c_str() };
+  EmbeddedFile resolved = FetchedFiles::resolve(fetched);
+  REQUIRE(resolved.data);
+  REQUIRE(resolved.size == sizeof(bytes));
+  REQUIRE(resolved.data[4] == 5);
+  REQUIRE_FALSE(FetchedFiles::fetching());
+
+  std::filesystem::remove(file);
+  REQUIRE(FetchedFiles::resolve(fetched).data == resolved.data);
+
+  std::string missing_url = url + ".missing";
+  EmbeddedFile missing = { "missing", nullptr, 0, missing_url.c_str() };
+  REQUIRE(FetchedFiles::resolve(missing).data == nullptr);
+  REQUIRE(FetchedFiles::instance().failed(missing));
+
+  EmbeddedFile embedded = { "embedded", bytes, sizeof(bytes) };
+  REQUIRE(FetchedFiles::resolve(embedded).data == bytes);
+}
@@ -0,0 +1,188 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "visage_graphics/canvas.h"
+#include "visage_graphics/layer.h"
+#include "visage_graphics/region.h"
+
+#include <bgfx/bgfx.h>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace visage;
+
+namespace {
+  void invalidateIndicators(Layer& layer, const Region& region) {
+    for (int y = 0; y < 8; ++y) {
+      for (int x = 0; x < 8; ++x)
+        layer.invalidateRectInRegion({ x * 24, y * 24, 10, 10 }, &region);
+    }
+  }
+
+  bool covered(const std::vector<IBounds>& rects, int x, int y) {
+    return std::any_of(rects.begin(), rects.end(),
+                       [x, y](const IBounds& rect) { return rect.contains(x, y); });
+  }
+}
+
+TEST_CASE("Invalid rects without coalescing stay separate", "[graphics]") {
+  GradientAtlas gradient_atlas;
+  Layer layer(&gradient_atlas);
+  layer.setInvalidRectCoalescing({ 0, 0 });
+  Region region;
+  region.setBounds(0, 0, 200, 200);
+
+  invalidateIndicators(layer, region);
+  REQUIRE(layer.invalidRects().rects(&region).size() == 64);
+}
+
+TEST_CASE("Invalid rects coalesce under the region cap", "[graphics]") {
+  GradientAtlas gradient_atlas;
+  Layer layer(&gradient_atlas);
+  layer.setInvalidRectCoalescing({ 8, 1024 });
+  Region region;
+  region.setBounds(0, 0, 200, 200);
+
+  invalidateIndicators(layer, region);
+  const std::vector<IBounds>& rects = layer.invalidRects().rects(&region);
+  REQUIRE(rects.size() <= 8);
+
+  for (int i = 0; i < rects.size(); ++i) {
+    for (int j = i + 1; j < rects.size(); ++j)
+      REQUIRE_FALSE(rects[i].overlaps(rects[j]));
+  }
+
+  for (int y = 0; y < 8; ++y) {
+    for (int x = 0; x < 8; ++x) {
+      REQUIRE(covered(rects, x * 24, y * 24));
+      REQUIRE(covered(rects, x * 24 + 9, y * 24 + 9));
+    }
+  }
+}
+
+TEST_CASE("Adjacent invalid rects merge when overdraw is free", "[graphics]") {
+  GradientAtlas gradient_atlas;
+  Layer layer(&gradient_atlas);
+  layer.setInvalidRectCoalescing({ 0, 1 });
+  Region region;
+  region.setBounds(0, 0, 200, 200);
+
+  layer.invalidateRectInRegion({ 0, 0, 10, 10 }, &region);
+  layer.invalidateRectInRegion({ 10, 0, 10, 10 }, &region);
+  layer.invalidateRectInRegion({ 100, 100, 10, 10 }, &region);
+  const std::vector<IBounds>& rects = layer.invalidRects().rects(&region);
+  REQUIRE(rects.size() == 2);
+  REQUIRE(covered(rects, 19, 9));
+}
+
+TEST_CASE("Invalid rects outside the region are dropped", "[graphics]") {
+  GradientAtlas gradient_atlas;
+  Layer layer(&gradient_atlas);
+  Region region;
+  region.setBounds(0, 0, 200, 200);
+
+  layer.invalidateRectInRegion({ 300, 300, 10, 10 }, &region);
+  layer.invalidateRectInRegion({ 10, 10, 0, 10 }, &region);
+  REQUIRE_FALSE(layer.anyInvalidRects());
+
+  layer.invalidateRectInRegion({ 190, 190, 20, 20 }, &region);
+  REQUIRE(layer.anyInvalidRects());
+}
+
+TEST_CASE("Invalid rect storage is kept across frames", "[graphics]") {
+  GradientAtlas gradient_atlas;
+  Layer layer(&gradient_atlas);
+  layer.setInvalidRectCoalescing({ 0, 0 });
+  Region region;
+  Region other;
+  region.setBounds(0, 0, 200, 200);
+  other.setBounds(0, 0, 200, 200);
+  layer.addRegion(&region);
+
+  invalidateIndicators(layer, region);
+  layer.invalidateRectInRegion({ 0, 0, 10, 10 }, &other);
+  const IBounds* storage = layer.invalidRects().rects(&region).data();
+
+  layer.clearInvalidRects();
+  REQUIRE_FALSE(layer.anyInvalidRects());
+  REQUIRE(layer.invalidRects().rects(&region).empty());
+
+  invalidateIndicators(layer, region);
+  REQUIRE(layer.invalidRects().rects(&region).size() == 64);
+  REQUIRE(layer.invalidRects().rects(&region).data() == storage);
+  REQUIRE(layer.invalidRects().rects(&other).empty());
+  REQUIRE(std::distance(layer.invalidRects().begin(), layer.invalidRects().end()) == 1);
+
+  layer.removeRegion(&region);
+  REQUIRE_FALSE(layer.anyInvalidRects());
+  REQUIRE(layer.invalidRects().rects(&region).empty());
+}
+
+TEST_CASE("Packed layers keep bucketed sizes while regions resize", "[graphics]") {
+  GradientAtlas gradient_atlas;
+  Layer layer(&gradient_atlas);
+  layer.setIntermediateLayer(true);
+  layer.setFrameBufferBucket(256);
+  Region region;
+  region.setBounds(0, 0, 300, 200);
+  layer.addPackedRegion(&region);
+
+  int width = layer.width();
+  int height = layer.height();
+  REQUIRE(width >= 300);
+  REQUIRE(height >= 200);
+  REQUIRE(width % 256 == 0);
+  REQUIRE(height % 256 == 0);
+
+  for (int size = 0; size < 40; size += 4) {
+    layer.removePackedRegion(&region);
+    region.setBounds(0, 0, 300 + size, 200 - size);
+    layer.addPackedRegion(&region);
+    REQUIRE(layer.width() == width);
+    REQUIRE(layer.height() == height);
+  }
+}
+
+TEST_CASE("Emptied intermediate layers release their frame buffer", "[graphics]") {
+  Canvas canvas;
+  canvas.setWindowless(100, 100);
+  Region region;
+  region.setBounds(10, 10, 50, 50);
+  canvas.addRegion(&region);
+  region.setNeedsLayer(true);
+
+  canvas.beginRegion(&region);
+  canvas.setColor(0xffff0000);
+  canvas.fill(0, 0, 50, 50);
+  canvas.endRegion();
+  canvas.submit();
+
+  Layer* layer = region.layer();
+  REQUIRE(layer != canvas.layer(1));
+  REQUIRE(bgfx::isValid(layer->frameBuffer()));
+
+  region.setNeedsLayer(false);
+  for (int i = 0; i < Layer::kReleaseIdleSubmits - 1; ++i)
+    canvas.submit();
+  REQUIRE(bgfx::isValid(layer->frameBuffer()));
+
+  canvas.submit();
+  REQUIRE_FALSE(bgfx::isValid(layer->frameBuffer()));
+}
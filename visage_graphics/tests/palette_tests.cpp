@@ -0,0 +1,106 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "visage_graphics/palette.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace visage;
+
+namespace {
+  VISAGE_THEME_COLOR(PaletteTestColor, 0xff112233);
+  VISAGE_THEME_VALUE(PaletteTestValue, 4.0f);
+  VISAGE_THEME_PALETTE_OVERRIDE(PaletteTestOverride);
+}
+
+TEST_CASE("Palette compiled lookups follow edits", "[graphics]") {
+  Palette palette;
+  palette.setColor(PaletteTestColor, Color(0xff445566));
+  palette.setValue(PaletteTestValue, 8.0f);
+  palette.compile();
+  REQUIRE(palette.isCompiled());
+
+  Brush brush;
+  REQUIRE(palette.color({}, PaletteTestColor, brush));
+  REQUIRE(brush.gradient().sample(0.0f).toARGB() == 0xff445566);
+  REQUIRE_FALSE(palette.color(PaletteTestOverride, PaletteTestColor, brush));
+  REQUIRE(palette.colorMap(PaletteTestOverride, PaletteTestColor) == Palette::kNotSetId);
+
+  float value = 0.0f;
+  REQUIRE(palette.value({}, PaletteTestValue, value));
+  REQUIRE(value == 8.0f);
+  REQUIRE_FALSE(palette.value(PaletteTestOverride, PaletteTestValue, value));
+
+  palette.setColor(PaletteTestOverride, PaletteTestColor, Color(0xff778899));
+  palette.setValue(PaletteTestOverride, PaletteTestValue, 2.0f);
+  REQUIRE_FALSE(palette.isCompiled());
+
+  REQUIRE(palette.color(PaletteTestOverride, PaletteTestColor, brush));
+  REQUIRE(brush.gradient().sample(0.0f).toARGB() == 0xff778899);
+  REQUIRE(palette.value(PaletteTestOverride, PaletteTestValue, value));
+  REQUIRE(value == 2.0f);
+  REQUIRE(palette.isCompiled());
+
+  palette.removeValue(PaletteTestOverride, PaletteTestValue);
+  REQUIRE_FALSE(palette.value(PaletteTestOverride, PaletteTestValue, value));
+}
+
+TEST_CASE("Palette lookups register queried ids for editing", "[graphics]") {
+  Palette palette;
+  Brush brush;
+  REQUIRE_FALSE(palette.color(PaletteTestOverride, PaletteTestColor, brush));
+
+  auto color_ids = palette.colorIdList(PaletteTestOverride);
+  REQUIRE(color_ids.size() == 1);
+  REQUIRE(color_ids.begin()->second.size() == 1);
+  REQUIRE(color_ids.begin()->second[0] == PaletteTestColor);
+}
+
+TEST_CASE("Palette binary encoding round trips and loads compiled", "[graphics]") {
+  Palette palette;
+  palette.setColor(PaletteTestColor, Color(0xff445566));
+  Brush linear = Brush::linear(Color(0xff102030), Color(0x80405060), { 1.0f, 2.0f }, { 3.0f, 4.0f });
+  palette.setColor(PaletteTestOverride, PaletteTestColor, linear);
+  palette.setValue(PaletteTestValue, 8.0f);
+  palette.setValue(PaletteTestOverride, PaletteTestValue, 2.0f);
+
+  std::vector<unsigned char> data = palette.encodeBinary();
+  Palette loaded;
+  REQUIRE(loaded.decodeBinary(data.data(), data.size()));
+  REQUIRE(loaded.isCompiled());
+  REQUIRE(loaded.encode() == palette.encode());
+
+  Brush brush;
+  REQUIRE(loaded.color(PaletteTestOverride, PaletteTestColor, brush));
+  REQUIRE(brush.position() == linear.position());
+  REQUIRE(brush.gradient() == linear.gradient());
+  float value = 0.0f;
+  REQUIRE(loaded.value({}, PaletteTestValue, value));
+  REQUIRE(value == 8.0f);
+
+  Palette untouched;
+  untouched.setValue(PaletteTestValue, 1.0f);
+  REQUIRE_FALSE(untouched.decodeBinary(data.data(), data.size() - 1));
+  data[0] ^= 0xff;
+  REQUIRE_FALSE(untouched.decodeBinary(data.data(), data.size()));
+  REQUIRE(untouched.value({}, PaletteTestValue, value));
+  REQUIRE(value == 1.0f);
+}
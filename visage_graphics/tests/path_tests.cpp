@@ -21,10 +21,13 @@
 
 #include "visage_graphics/canvas.h"
 #include "visage_graphics/path.h"
+#include "visage_graphics/path_strips.h"
+#include "visage_graphics/polyline_stroker.h"
 
 #include <catch2/catch_approx.hpp>
 #include <catch2/catch_test_macros.hpp>
 #include <complex>
+#include <functional>
 #include <random>
 #include <set>
 
@@ -256,3 +259,455 @@ TEST_CASE("Degeneracies", "[graphics]") {
     REQUIRE(screenshot.sample(35, 35).hexRed() == 0xff);
   }
 }
+
+TEST_CASE("Shelf packer reuses released slots", "[graphics]") {
+  ShelfPacker packer;
+  packer.reset(256, 256);
+  PackedRect rect {};
+  std::vector<int> slots;
+  for (int i = 0; i < 64; ++i) {
+    int slot = packer.allocate(30, 30, rect);
+    REQUIRE(slot != ShelfPacker::kInvalidSlot);
+    slots.push_back(slot);
+  }
+  REQUIRE(packer.allocate(30, 30, rect) == ShelfPacker::kInvalidSlot);
+
+  packer.release(slots[10]);
+  REQUIRE(packer.numAllocated() == 63);
+  REQUIRE(packer.allocate(28, 25, rect) != ShelfPacker::kInvalidSlot);
+  REQUIRE(rect.x == 60);
+  REQUIRE(rect.y == 32);
+
+  packer.grow(512);
+  REQUIRE(packer.allocate(30, 30, rect) != ShelfPacker::kInvalidSlot);
+  REQUIRE(rect.y == 256);
+}
+
+TEST_CASE("Path atlas churn keeps packed paths disjoint", "[graphics]") {
+  PathAtlas atlas;
+  Path path;
+  path.moveTo(0, 0);
+  path.lineTo(10, 0);
+  path.lineTo(5, 10);
+  path.close();
+
+  std::mt19937 generator(1);
+  std::uniform_int_distribution<int> size(5, 60);
+  std::vector<PathAtlas::PackedPath> live;
+  for (int frame = 0; frame < 50; ++frame) {
+    for (int i = 0; i < 15 && !live.empty(); ++i)
+      live.erase(live.begin() + generator() % live.size());
+    for (int i = 0; i < 20; ++i)
+      live.push_back(atlas.addPath(path, size(generator), size(generator)));
+
+    std::set<const PathAtlas::PackedPathRect*> rects;
+    for (const auto& packed_path : live)
+      rects.insert(packed_path.packedImageRect());
+    REQUIRE(atlas.numPaths() == rects.size());
+  }
+
+  for (int i = 0; i < live.size(); ++i) {
+    for (int j = i + 1; j < live.size(); ++j) {
+      if (live[i].packedImageRect() == live[j].packedImageRect())
+        continue;
+
+      IBounds a(live[i].x(), live[i].y(), live[i].w(), live[i].h());
+      IBounds b(live[j].x(), live[j].y(), live[j].w(), live[j].h());
+      REQUIRE_FALSE(a.overlaps(b));
+    }
+  }
+
+  live.clear();
+  REQUIRE(atlas.numPaths() == 0);
+}
+
+TEST_CASE("Path copies share geometry until modified", "[graphics]") {
+  Path path;
+  path.moveTo(0, 0);
+  path.lineTo(10, 0);
+  path.lineTo(5, 10);
+  path.close();
+
+  Path copy = path;
+  REQUIRE(copy.sharesGeometry(path));
+  REQUIRE(path.flattened(1.0f).sharesGeometry(path));
+
+  copy.translate(1, 0);
+  REQUIRE_FALSE(copy.sharesGeometry(path));
+  const Path& original = path;
+  REQUIRE(original.subPaths()[0].points[0] == Point(0, 0));
+  REQUIRE(copy.subPaths()[0].points[0] == Point(1, 0));
+
+  Path curved;
+  curved.moveTo(0, 0);
+  curved.quadraticTo(10, 10, 20, 0);
+  REQUIRE(curved.flattened(2.0f).sharesGeometry(curved.flattened(2.0f)));
+}
+
+TEST_CASE("Path atlas shares identical paths", "[graphics]") {
+  PathAtlas atlas;
+  Path path;
+  path.moveTo(0, 0);
+  path.lineTo(10, 0);
+  path.lineTo(5, 10);
+  path.close();
+
+  Path other = path;
+  other.lineTo(2, 2);
+
+  {
+    PathAtlas::PackedPath first = atlas.addPath(path, 12, 12);
+    PathAtlas::PackedPath second = atlas.addPath(path, 12, 12);
+    REQUIRE(atlas.numPaths() == 1);
+    REQUIRE(first.packedImageRect() == second.packedImageRect());
+
+    PathAtlas::PackedPath resized = atlas.addPath(path, 20, 12);
+    PathAtlas::PackedPath different = atlas.addPath(other, 12, 12);
+    REQUIRE(atlas.numPaths() == 3);
+    REQUIRE(resized.packedImageRect() != first.packedImageRect());
+    REQUIRE(different.packedImageRect() != first.packedImageRect());
+  }
+  REQUIRE(atlas.numPaths() == 0);
+
+  PathAtlas::PackedPath again = atlas.addPath(path, 12, 12);
+  REQUIRE(atlas.numPaths() == 1);
+}
+
+TEST_CASE("Path strips match rectangle coverage", "[graphics]") {
+  Path path;
+  path.addRectangle(10.5f, 8.25f, 40.0f, 20.0f);
+
+  PathStrips strips;
+  strips.rasterize(path, 64, 40);
+  REQUIRE(strips.coverage(30, 18) == 1.0f);
+  REQUIRE(strips.coverage(5, 18) == 0.0f);
+  REQUIRE(strips.coverage(30, 35) == 0.0f);
+  REQUIRE(strips.coverage(10, 18) == Catch::Approx(0.5f).margin(0.01f));
+  REQUIRE(strips.coverage(30, 8) == Catch::Approx(0.75f).margin(0.01f));
+  REQUIRE(strips.coverage(50, 28) == Catch::Approx(0.125f).margin(0.01f));
+
+  float total = 0.0f;
+  for (int y = 0; y < strips.height(); ++y) {
+    for (int x = 0; x < strips.width(); ++x)
+      total += strips.coverage(x, y);
+  }
+  REQUIRE(total == Catch::Approx(800.0f).margin(2.0f));
+
+  int solid_area = 0;
+  for (const auto& strip : strips.strips()) {
+    if (strip.solid)
+      solid_area += strip.width * strip.height;
+  }
+  REQUIRE(solid_area > 600);
+  REQUIRE(strips.strips().size() < 20);
+}
+
+TEST_CASE("Path strips fill rules", "[graphics]") {
+  Path path;
+  path.addRectangle(2.0f, 2.0f, 40.0f, 40.0f);
+  path.addRectangle(12.0f, 12.0f, 20.0f, 20.0f);
+  path.setFillRule(Path::FillRule::NonZero);
+
+  PathStrips strips;
+  strips.rasterize(path, 48, 48);
+  REQUIRE(strips.coverage(22, 22) == 1.0f);
+  REQUIRE(strips.coverage(6, 22) == 1.0f);
+
+  path.setFillRule(Path::FillRule::EvenOdd);
+  strips.rasterize(path, 48, 48);
+  REQUIRE(strips.coverage(22, 22) == 0.0f);
+  REQUIRE(strips.coverage(6, 22) == 1.0f);
+  REQUIRE(strips.coverage(45, 22) == 0.0f);
+}
+
+TEST_CASE("Path strips circle area", "[graphics]") {
+  static constexpr float kRadius = 150.0f;
+  Path path;
+  path.addCircle(160.0f, 160.0f, kRadius);
+
+  PathStrips strips;
+  strips.rasterize(path, 320, 320);
+  REQUIRE(strips.alphaWidth() <= PathStrips::kMaxAlphaWidth + PathStrips::kSolidColumns);
+
+  float total = 0.0f;
+  for (int y = 0; y < strips.height(); ++y) {
+    for (int x = 0; x < strips.width(); ++x) {
+      float coverage = strips.coverage(x, y);
+      REQUIRE(coverage >= 0.0f);
+      REQUIRE(coverage <= 1.0f);
+      total += coverage;
+    }
+  }
+  REQUIRE(total == Catch::Approx(3.14159265f * kRadius * kRadius).epsilon(0.01f));
+}
+
+TEST_CASE("Path flattening follows display scale", "[graphics]") {
+  static constexpr float kRadius = 50.0f;
+  Path path;
+  path.addCircle(0.0f, 0.0f, kRadius);
+  path.moveTo(0.0f, 100.0f);
+  path.bezierTo(40.0f, 60.0f, 80.0f, 140.0f, 120.0f, 100.0f);
+  path.translate(10.0f, 20.0f);
+  REQUIRE(path.numCurves() == 3);
+
+  Path same = path.flattened(1.0f);
+  REQUIRE(same.sameFill(path));
+
+  Path small = path.flattened(0.125f);
+  Path large = path.flattened(8.0f);
+  REQUIRE(small.numPoints() < path.numPoints());
+  REQUIRE(large.numPoints() > path.numPoints());
+  REQUIRE(large.subPaths().size() == path.subPaths().size());
+
+  float tolerance = Path::kDefaultErrorTolerance / 8.0f;
+  for (const Point& point : large.subPaths()[0].points) {
+    float distance = (point - Point(10.0f, 20.0f)).length();
+    REQUIRE(distance == Catch::Approx(kRadius).margin(tolerance));
+  }
+
+  Point end = large.subPaths()[1].points.back();
+  REQUIRE(end.x == Catch::Approx(130.0f));
+  REQUIRE(end.y == Catch::Approx(120.0f));
+
+  Path reversed = path.reversed().flattened(8.0f);
+  REQUIRE(reversed.numPoints() == large.numPoints());
+  Point start = reversed.subPaths()[1].points.front();
+  REQUIRE(start.x == Catch::Approx(130.0f));
+  REQUIRE(start.y == Catch::Approx(120.0f));
+}
+
+TEST_CASE("Polyline stroker matches path stroke coverage", "[graphics]") {
+  static constexpr int kSize = 160;
+  Path envelope;
+  envelope.moveTo(10.0f, 120.0f);
+  for (int i = 1; i <= 64; ++i)
+    envelope.lineTo(10.0f + i * 2.2f, 80.0f + 60.0f * std::sin(i * 0.37f) * std::cos(i * 0.11f));
+
+  Path closed;
+  closed.moveTo(30.0f, 30.0f);
+  closed.lineTo(130.0f, 40.0f);
+  closed.lineTo(80.0f, 140.0f);
+  closed.close();
+
+  PolylineStroker stroker;
+  for (const Path& source : { envelope, closed }) {
+    for (auto join : { Path::Join::Round, Path::Join::Miter, Path::Join::Bevel }) {
+      for (auto end_cap : { Path::EndCap::Round, Path::EndCap::Butt, Path::EndCap::Square }) {
+        Path reference = Path(source).stroke(6.0f, join, end_cap);
+        const Path& fast = stroker.stroke(source, 6.0f, join, end_cap);
+        REQUIRE(fast.fillRule() == Path::FillRule::NonZero);
+
+        PathStrips reference_strips;
+        reference_strips.rasterize(reference, kSize, kSize);
+        PathStrips fast_strips;
+        fast_strips.rasterize(fast, kSize, kSize);
+
+        float difference = 0.0f;
+        for (int y = 0; y < kSize; ++y) {
+          for (int x = 0; x < kSize; ++x)
+            difference += std::abs(reference_strips.coverage(x, y) - fast_strips.coverage(x, y));
+        }
+        REQUIRE(difference < 2.0f);
+      }
+    }
+  }
+}
+
+static bool pathSelfIntersects(const Path& path) {
+  std::vector<std::pair<DPoint, DPoint>> edges;
+  for (const auto& sub_path : path.subPaths()) {
+    for (int i = 0; i < sub_path.points.size(); ++i) {
+      DPoint from(sub_path.points[i]);
+      DPoint to(sub_path.points[(i + 1) % sub_path.points.size()]);
+      edges.emplace_back(from, to);
+    }
+  }
+
+  auto opposite = [](double a, double b) { return (a > 0.0 && b < 0.0) || (a < 0.0 && b > 0.0); };
+  for (int i = 0; i < edges.size(); ++i) {
+    for (int j = i + 1; j < edges.size(); ++j) {
+      auto [a, b] = edges[i];
+      auto [c, d] = edges[j];
+      if (opposite(orientation(a, b, c), orientation(a, b, d)) &&
+          opposite(orientation(c, d, a), orientation(c, d, b)))
+        return true;
+    }
+  }
+  return false;
+}
+
+static float pathCoverageDifference(const Path& path, const std::function<float(int, int)>& expected,
+                                    int size) {
+  PathStrips strips;
+  strips.rasterize(path, size, size);
+  float difference = 0.0f;
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x)
+      difference += std::abs(strips.coverage(x, y) - expected(x, y));
+  }
+  return difference;
+}
+
+TEST_CASE("Path boolean operations on rectangles", "[graphics]") {
+  static constexpr int kSize = 112;
+  Path a;
+  a.addRectangle(10.0f, 10.0f, 60.0f, 60.0f);
+  Path b;
+  b.addRectangle(40.0f, 40.0f, 60.0f, 60.0f);
+
+  auto in_a = [](int x, int y) { return x >= 10 && x < 70 && y >= 10 && y < 70; };
+  auto in_b = [](int x, int y) { return x >= 40 && x < 100 && y >= 40 && y < 100; };
+
+  Path unioned = a.booleanOperation(b, Path::Operation::Union);
+  REQUIRE(unioned.subPaths().size() == 1);
+  REQUIRE(unioned.subPaths()[0].points.size() == 9);
+  REQUIRE(pathCoverageDifference(unioned, [&](int x, int y) { return in_a(x, y) || in_b(x, y); },
+                                 kSize) == 0.0f);
+
+  Path intersection = a.booleanOperation(b, Path::Operation::Intersection);
+  REQUIRE(intersection.subPaths().size() == 1);
+  REQUIRE(intersection.subPaths()[0].points.size() == 5);
+  REQUIRE(pathCoverageDifference(intersection, [&](int x, int y) { return in_a(x, y) && in_b(x, y); },
+                                 kSize) == 0.0f);
+
+  Path difference = a.booleanOperation(b, Path::Operation::Difference);
+  REQUIRE(pathCoverageDifference(difference, [&](int x, int y) { return in_a(x, y) && !in_b(x, y); },
+                                 kSize) == 0.0f);
+
+  Path exclusive = a.booleanOperation(b, Path::Operation::Xor);
+  REQUIRE(pathCoverageDifference(exclusive, [&](int x, int y) { return in_a(x, y) != in_b(x, y); },
+                                 kSize) == 0.0f);
+
+  Path contained;
+  contained.addRectangle(30.0f, 30.0f, 10.0f, 10.0f);
+  Path hole = a.booleanOperation(contained, Path::Operation::Difference);
+  REQUIRE(hole.subPaths().size() == 2);
+  REQUIRE(pathCoverageDifference(hole, [&](int x, int y) {
+    return in_a(x, y) && !(x >= 30 && x < 40 && y >= 30 && y < 40);
+  }, kSize) == 0.0f);
+}
+
+TEST_CASE("Path boolean operations on curves", "[graphics]") {
+  static constexpr int kSize = 160;
+  Path a;
+  a.addCircle(60.0f, 80.0f, 45.0f);
+  Path b;
+  b.addCircle(100.0f, 80.0f, 45.0f);
+  b.setFillRule(Path::FillRule::NonZero);
+
+  PathStrips strips_a;
+  strips_a.rasterize(a, kSize, kSize);
+  PathStrips strips_b;
+  strips_b.rasterize(b, kSize, kSize);
+
+  auto check = [&](Path::Operation operation, const std::function<float(float, float)>& combine) {
+    Path result = a.booleanOperation(b, operation);
+    REQUIRE_FALSE(pathSelfIntersects(result));
+    float difference = pathCoverageDifference(result, [&](int x, int y) {
+      return combine(strips_a.coverage(x, y), strips_b.coverage(x, y));
+    }, kSize);
+    REQUIRE(difference < 4.0f);
+  };
+
+  check(Path::Operation::Union, [](float a, float b) { return std::max(a, b); });
+  check(Path::Operation::Intersection, [](float a, float b) { return std::min(a, b); });
+  check(Path::Operation::Difference, [](float a, float b) { return std::max(0.0f, a - b); });
+}
+
+TEST_CASE("Path simplified removes self intersections", "[graphics]") {
+  static constexpr int kSize = 128;
+  Path star;
+  for (int i = 0; i < 5; ++i) {
+    float angle = i * 4.0f * Path::kPi / 5.0f;
+    Point point(64.0f + 50.0f * std::sin(angle), 64.0f - 50.0f * std::cos(angle));
+    if (i == 0)
+      star.moveTo(point);
+    else
+      star.lineTo(point);
+  }
+  star.close();
+  REQUIRE(pathSelfIntersects(star));
+
+  for (auto fill_rule : { Path::FillRule::NonZero, Path::FillRule::EvenOdd }) {
+    star.setFillRule(fill_rule);
+    PathStrips strips;
+    strips.rasterize(star, kSize, kSize);
+
+    Path simple = star.simplified();
+    REQUIRE_FALSE(pathSelfIntersects(simple));
+    REQUIRE(simple.subPaths().size() == (fill_rule == Path::FillRule::NonZero ? 1 : 5));
+    REQUIRE(pathCoverageDifference(simple, [&](int x, int y) { return strips.coverage(x, y); },
+                                   kSize) < 1.0f);
+  }
+}
+
+TEST_CASE("Path atlas retains redrawn paths", "[graphics]") {
+  PathAtlas atlas;
+  Path path;
+  path.moveTo(0, 0);
+  path.lineTo(10, 0);
+  path.lineTo(5, 10);
+  path.close();
+
+  PathAtlas::PlacedPath first = atlas.placePath(path, 4.0f, 4.0f, 2.0f);
+  const PathAtlas::PackedPathRect* rect = first.packed_path.packedImageRect();
+  float first_x = first.x;
+  first = {};
+  atlas.nextFrame();
+  REQUIRE(atlas.numPaths() == 1);
+
+  PathAtlas::PlacedPath second = atlas.placePath(path, 14.0f, 4.0f, 2.0f);
+  REQUIRE(second.packed_path.packedImageRect() == rect);
+  REQUIRE(second.x == first_x + 10.0f);
+  REQUIRE(atlas.numRetainedPaths() == 1);
+
+  PathAtlas::PlacedPath shifted = atlas.placePath(path, 14.5f, 4.0f, 2.0f);
+  REQUIRE(shifted.packed_path.packedImageRect() != rect);
+  REQUIRE(atlas.numRetainedPaths() == 2);
+
+  path.lineTo(2, 2);
+  PathAtlas::PlacedPath modified = atlas.placePath(path, 14.0f, 4.0f, 2.0f);
+  REQUIRE(modified.packed_path.packedImageRect() != rect);
+
+  second = {};
+  shifted = {};
+  modified = {};
+  for (int i = 0; i <= PathAtlas::kRetainedFrames; ++i)
+    atlas.nextFrame();
+  REQUIRE(atlas.numRetainedPaths() == 0);
+  REQUIRE(atlas.numPaths() == 0);
+}
+
+TEST_CASE("Stroke cache reuses outlines of unchanged paths", "[graphics]") {
+  Path path;
+  path.moveTo(0, 0);
+  path.lineTo(20, 0);
+  path.lineTo(20, 20);
+
+  StrokeCache cache;
+  std::vector<float> dashes = { 4.0f, 2.0f };
+  Path solid = cache.stroke(path, 1.0f, 2.0f, Path::Join::Round, Path::EndCap::Round, {}, 0.0f,
+                            Path::kDefaultMiterLimit);
+  Path dashed = cache.stroke(path, 1.0f, 2.0f, Path::Join::Round, Path::EndCap::Round, dashes,
+                             0.0f, Path::kDefaultMiterLimit);
+  REQUIRE(cache.size() == 2);
+  REQUIRE_FALSE(solid.sharesGeometry(dashed));
+
+  const Path& again = cache.stroke(path, 1.0f, 2.0f, Path::Join::Round, Path::EndCap::Round,
+                                   { 4.0f, 2.0f }, 0.0f, Path::kDefaultMiterLimit);
+  REQUIRE(again.sharesGeometry(dashed));
+  REQUIRE(cache.size() == 2);
+
+  path.lineTo(0, 20);
+  const Path& modified = cache.stroke(path, 1.0f, 2.0f, Path::Join::Round, Path::EndCap::Round,
+                                      {}, 0.0f, Path::kDefaultMiterLimit);
+  REQUIRE_FALSE(modified.sharesGeometry(solid));
+  REQUIRE(cache.size() == 3);
+
+  cache.nextFrame();
+  cache.nextFrame();
+  REQUIRE(cache.size() == 1);
+  for (int i = 0; i < StrokeCache::kRetainedFrames; ++i)
+    cache.nextFrame();
+  REQUIRE(cache.size() == 0);
+}
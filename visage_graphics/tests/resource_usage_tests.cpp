@@ -0,0 +1,72 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "visage_graphics/resource_usage.h"
+
+#include <bgfx/bgfx.h>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace visage;
+
+TEST_CASE("Tracked resources count bytes, handles and peaks", "[graphics]") {
+  ResourceTracker::resetPeaks();
+  ResourceUsage start = ResourceTracker::usage(ResourceCategory::PathAtlas);
+  ResourceUsage start_total = ResourceTracker::total();
+
+  {
+    TrackedResource first;
+    TrackedResource second;
+    first.reset(ResourceCategory::PathAtlas, 1000);
+    second.reset(ResourceCategory::PathAtlas, 500);
+
+    ResourceUsage usage = ResourceTracker::usage(ResourceCategory::PathAtlas);
+    REQUIRE(usage.bytes == start.bytes + 1500);
+    REQUIRE(usage.handles == start.handles + 2);
+    REQUIRE(ResourceTracker::total().bytes == start_total.bytes + 1500);
+
+    first.reset(ResourceCategory::PathAtlas, 200);
+    usage = ResourceTracker::usage(ResourceCategory::PathAtlas);
+    REQUIRE(usage.bytes == start.bytes + 700);
+    REQUIRE(usage.handles == start.handles + 2);
+    REQUIRE(usage.peak_bytes == start.bytes + 1500);
+
+    second.reset();
+    REQUIRE(ResourceTracker::usage(ResourceCategory::PathAtlas).handles == start.handles + 1);
+  }
+
+  ResourceUsage usage = ResourceTracker::usage(ResourceCategory::PathAtlas);
+  REQUIRE(usage.bytes == start.bytes);
+  REQUIRE(usage.handles == start.handles);
+  REQUIRE(usage.peak_bytes == start.bytes + 1500);
+  REQUIRE(usage.peak_handles == start.handles + 2);
+
+  ResourceTracker::resetPeaks();
+  REQUIRE(ResourceTracker::usage(ResourceCategory::PathAtlas).peak_bytes == start.bytes);
+}
+
+TEST_CASE("Texture bytes follow format and mipmaps", "[graphics]") {
+  REQUIRE(ResourceTracker::textureBytes(16, 16, bgfx::TextureFormat::RGBA8) == 16 * 16 * 4);
+  REQUIRE(ResourceTracker::textureBytes(16, 16, bgfx::TextureFormat::R16F) == 16 * 16 * 2);
+
+  long long mipmapped = ResourceTracker::textureBytes(16, 16, bgfx::TextureFormat::RGBA8, true);
+  REQUIRE(mipmapped > 16 * 16 * 4);
+  REQUIRE(mipmapped < 16 * 16 * 4 * 2);
+}
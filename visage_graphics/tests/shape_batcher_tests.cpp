@@ -0,0 +1,244 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "visage_graphics/shape_batcher.h"
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+
+using namespace visage;
+
+namespace {
+  ClampBounds fullClamp() {
+    return { 0.0f, 0.0f, 10000.0f, 10000.0f };
+  }
+
+  void addGrid(ShapeBatcher& batcher, int columns, int rows, float size) {
+    for (int y = 0; y < rows; ++y) {
+      for (int x = 0; x < columns; ++x) {
+        batcher.addShape(Rectangle(fullClamp(), nullptr, x * size, y * size, size - 1.0f, size - 1.0f));
+        batcher.addShape(Circle(fullClamp(), nullptr, x * size, y * size, size * 0.5f));
+      }
+    }
+  }
+}
+
+TEST_CASE("Area grid overlap matches linear search", "[graphics]") {
+  AreaGrid grid;
+  std::vector<Bounds> areas;
+  for (int i = 0; i < 200; ++i) {
+    float x = (i * 37) % 900;
+    float y = (i * 53) % 700;
+    float width = 5.0f + (i * 11) % 40;
+    float height = 5.0f + (i * 7) % 40;
+    if (i % 50 == 0) {
+      width = 600.0f;
+      height = 300.0f;
+    }
+    grid.add(x, y, x + width, y + height);
+    areas.emplace_back(x, y, width, height);
+  }
+
+  REQUIRE(grid.numAreas() == areas.size());
+
+  for (int i = 0; i < 500; ++i) {
+    float x = (i * 29) % 1000 - 20.0f;
+    float y = (i * 41) % 800 - 20.0f;
+    float width = 1.0f + (i * 13) % 30;
+    float height = 1.0f + (i * 17) % 30;
+    Bounds query(x, y, width, height);
+    bool expected = std::any_of(areas.begin(), areas.end(),
+                                [&query](const Bounds& area) { return area.overlaps(query); });
+    REQUIRE(grid.overlaps(x, y, x + width, y + height) == expected);
+  }
+
+  grid.clear();
+  REQUIRE(grid.numAreas() == 0);
+  REQUIRE_FALSE(grid.overlaps(0.0f, 0.0f, 1000.0f, 1000.0f));
+}
+
+TEST_CASE("Shape batcher merges non overlapping shapes", "[graphics]") {
+  ShapeBatcher batcher;
+  addGrid(batcher, 40, 40, 10.0f);
+  REQUIRE(batcher.numBatches() == 2);
+
+  ShapeBatcher manual;
+  manual.setManualBatching(true);
+  addGrid(manual, 4, 4, 10.0f);
+  REQUIRE(manual.numBatches() == 1);
+}
+
+TEST_CASE("Shape batcher adds shape arrays to one batch", "[graphics]") {
+  std::vector<Rectangle> bars;
+  for (int i = 0; i < 512; ++i)
+    bars.emplace_back(fullClamp(), nullptr, i * 2.0f, 100.0f - i % 50, 1.0f, 50.0f + i % 50);
+
+  ShapeBatcher batcher;
+  batcher.addShape(Circle(fullClamp(), nullptr, 0.0f, 0.0f, 20.0f));
+  batcher.addShapes(bars.data(), bars.size());
+  REQUIRE(batcher.numShapes() == 513);
+  REQUIRE(batcher.numBatches() == 2);
+
+  batcher.addShapes(bars.data(), 0);
+  REQUIRE(batcher.numShapes() == 513);
+
+  batcher.addShape(Circle(fullClamp(), nullptr, 10.0f, 90.0f, 20.0f));
+  batcher.addShapes(bars.data(), 10);
+  REQUIRE(batcher.numBatches() >= 3);
+  REQUIRE(batcher.batchAtIndex(batcher.numBatches() - 1)->id() == Rectangle::batchId());
+}
+
+TEST_CASE("Submit batch pool drops ids left idle", "[graphics]") {
+  SubmitBatchPool& pool = SubmitBatchPool::instance();
+  pool.clear();
+  {
+    ShapeBatcher batcher;
+    addGrid(batcher, 2, 2, 10.0f);
+  }
+  int pooled = pool.size();
+  REQUIRE(pooled > 0);
+
+  for (int i = 0; i < SubmitBatchPool::kReleaseIdleSubmits - 1; ++i)
+    pool.nextFrame();
+  REQUIRE(pool.size() == pooled);
+
+  {
+    ShapeBatcher batcher;
+    addGrid(batcher, 2, 2, 10.0f);
+  }
+  REQUIRE(pool.size() == pooled);
+
+  for (int i = 0; i < SubmitBatchPool::kReleaseIdleSubmits - 1; ++i)
+    pool.nextFrame();
+  REQUIRE(pool.size() == pooled);
+  pool.nextFrame();
+  REQUIRE(pool.size() == 0);
+}
+
+TEST_CASE("Shape batcher recording benchmark", "[.][benchmark]") {
+  for (int size : { 16, 32, 64, 128 }) {
+    BENCHMARK("Record " + std::to_string(2 * size * size) + " shapes") {
+      ShapeBatcher batcher;
+      addGrid(batcher, size, size, 8.0f);
+      return batcher.numBatches();
+    };
+  }
+}
+
+TEST_CASE("Shape bounds visibility matches clamp checks", "[graphics]") {
+  ShapeBounds bounds;
+  std::vector<Rectangle> shapes;
+  for (int i = 0; i < 300; ++i) {
+    float x = (i * 31) % 400 - 50.0f;
+    float y = (i * 17) % 300 - 50.0f;
+    ClampBounds clamp = { (i * 7) % 200 - 20.0f, (i * 13) % 150 - 20.0f, 100.0f + (i * 11) % 300,
+                          100.0f + (i * 5) % 250 };
+    shapes.emplace_back(clamp, nullptr, x, y, 1.0f + (i * 3) % 60, 1.0f + (i * 19) % 45);
+    bounds.add(shapes.back());
+  }
+
+  std::vector<IBounds> invalid_rects = { { 0, 0, 50, 50 }, { 60, 20, 100, 30 }, { 250, 150, 90, 120 } };
+  for (int offset = -40; offset <= 40; offset += 20) {
+    int expected = 0;
+    for (int i = 0; i < shapes.size(); ++i) {
+      int pieces = numShapePieces(shapes[i], offset, offset, invalid_rects);
+      expected += pieces;
+      int visible = 0;
+      for (const IBounds& rect : invalid_rects)
+        visible += bounds.visible(i, rect.x() - offset, rect.y() - offset, rect.width(), rect.height());
+      REQUIRE(visible == pieces);
+    }
+    REQUIRE(numShapePieces(bounds, offset, offset, invalid_rects) == expected);
+  }
+
+  std::vector<uint8_t> mask(bounds.size());
+  for (const IBounds& rect : invalid_rects) {
+    int count = bounds.visibleMask(rect.x(), rect.y(), rect.width(), rect.height(), mask.data());
+    REQUIRE(count == bounds.numVisible(rect.x(), rect.y(), rect.width(), rect.height()));
+    for (int i = 0; i < bounds.size(); ++i)
+      REQUIRE(mask[i] == bounds.visible(i, rect.x(), rect.y(), rect.width(), rect.height()));
+  }
+}
+
+TEST_CASE("Quad ranges partition visible pieces in order", "[graphics]") {
+  std::vector<Rectangle> shapes;
+  ShapeBounds bounds;
+  for (int i = 0; i < 1000; ++i) {
+    shapes.emplace_back(fullClamp(), nullptr, (i * 37) % 500, (i * 23) % 400, 20.0f, 20.0f);
+    bounds.add(shapes.back());
+  }
+
+  std::vector<IBounds> invalid_rects = { { 0, 0, 200, 200 }, { 150, 100, 300, 250 } };
+  BatchVector<Rectangle> batches;
+  batches.emplace_back(&shapes, &invalid_rects, 0, 0, &bounds);
+  batches.emplace_back(&shapes, &invalid_rects, 40, 30, &bounds);
+
+  std::vector<uint8_t> visibility;
+  int num_quads = computeVisibility(batches, visibility);
+  std::vector<QuadRange> ranges = quadRanges(batches, visibility, 64);
+  REQUIRE(ranges.size() == 2 * 16);
+
+  int quad_offset = 0;
+  for (const QuadRange& range : ranges) {
+    REQUIRE(range.quad_offset == quad_offset);
+    const DrawBatch<Rectangle>& batch = batches[range.batch];
+    int pieces = 0;
+    auto count = [&pieces](const DrawBatch<Rectangle>&, const Rectangle&, ClampBounds) { pieces++; };
+    forEachVisiblePiece(batch, visibility.data() + range.mask_offset, range.shape_begin,
+                        range.shape_end, count);
+    quad_offset += pieces;
+  }
+  REQUIRE(quad_offset == num_quads);
+}
+
+TEST_CASE("SDF primitives batch mixed overlapping shapes together", "[graphics]") {
+  ShapeBatcher typed;
+  ShapeBatcher shared;
+  for (int i = 0; i < 10; ++i) {
+    float x = i * 5.0f;
+    Rectangle rectangle(fullClamp(), nullptr, x, 0.0f, 20.0f, 20.0f);
+    Circle circle(fullClamp(), nullptr, x, 0.0f, 20.0f);
+    RoundedArc arc(fullClamp(), nullptr, x, 0.0f, 20.0f, 20.0f, 2.0f, 0.0f, 1.0f);
+    typed.addShape(rectangle);
+    typed.addShape(circle);
+    typed.addShape(arc);
+    shared.addShape(SdfPrimitive(rectangle));
+    shared.addShape(SdfPrimitive(circle));
+    shared.addShape(SdfPrimitive(arc));
+  }
+
+  REQUIRE(typed.numBatches() == 30);
+  REQUIRE(shared.numBatches() == 1);
+  REQUIRE(shared.numShapes() == 30);
+
+  RoundedRectangle rounded(fullClamp(), nullptr, 0.0f, 0.0f, 20.0f, 10.0f, 4.0f);
+  ShapeVertex typed_vertices[kVerticesPerQuad];
+  ShapeVertex shared_vertices[kVerticesPerQuad];
+  rounded.setVertexData(typed_vertices);
+  SdfPrimitive(rounded).setVertexData(shared_vertices);
+  for (int v = 0; v < kVerticesPerQuad; ++v) {
+    REQUIRE(shared_vertices[v].garbage1 == static_cast<float>(SdfPrimitive::Type::RoundedRectangle));
+    REQUIRE(shared_vertices[v].thickness == typed_vertices[v].thickness);
+    REQUIRE(shared_vertices[v].fade == typed_vertices[v].fade);
+    REQUIRE(shared_vertices[v].value1 == typed_vertices[v].value1);
+  }
+}
@@ -0,0 +1,73 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "visage_graphics/canvas.h"
+#include "visage_graphics/renderer.h"
+#include "visage_graphics/upload_memory.h"
+
+#include <bgfx/bgfx.h>
+#include <catch2/catch_test_macros.hpp>
+#include <vector>
+
+using namespace visage;
+
+namespace {
+  constexpr uint32_t kUploadSize = 3 * 1024 * 1024;
+  constexpr size_t kBlockSize = 4 * 1024 * 1024;
+
+  // Hands the blocks to bgfx and renders so its release callbacks return them to the pool.
+  void consume(const std::vector<const bgfx::Memory*>& memories) {
+    for (const bgfx::Memory* memory : memories)
+      bgfx::destroy(bgfx::createIndexBuffer(memory));
+    Renderer::instance().frame();
+    Renderer::instance().frame();
+  }
+}
+
+TEST_CASE("Upload memory blocks are recycled up to the pool cap", "[graphics]") {
+  Canvas canvas;
+  canvas.setWindowless(10, 10);
+  UploadMemoryPool& pool = UploadMemoryPool::instance();
+
+  consume({ pool.allocate(kUploadSize) });
+  size_t pooled = pool.pooledBytes();
+  int blocks = pool.numAllocatedBlocks();
+  REQUIRE(pooled >= kBlockSize);
+
+  const bgfx::Memory* reused = pool.allocate(kUploadSize);
+  REQUIRE(pool.numAllocatedBlocks() == blocks);
+  REQUIRE(pool.pooledBytes() == pooled - kBlockSize);
+  consume({ reused });
+  REQUIRE(pool.pooledBytes() == pooled);
+  REQUIRE(pool.numAllocatedBlocks() == blocks);
+
+  int num_uploads = UploadMemoryPool::kMaxPooledBytes / kBlockSize + 2;
+  std::vector<const bgfx::Memory*> memories;
+  for (int i = 0; i < num_uploads; ++i)
+    memories.push_back(pool.allocate(kUploadSize));
+  int peak_blocks = pool.numAllocatedBlocks();
+  REQUIRE(peak_blocks > blocks);
+
+  consume(memories);
+  REQUIRE(pool.pooledBytes() <= UploadMemoryPool::kMaxPooledBytes);
+  REQUIRE(pool.pooledBytes() > UploadMemoryPool::kMaxPooledBytes - kBlockSize);
+  REQUIRE(pool.numAllocatedBlocks() <= peak_blocks - 2);
+}
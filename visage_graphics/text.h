@@ -22,11 +22,25 @@
 #pragma once
 
 #include "font.h"
+#include "gradient.h"
 #include "visage_utils/string_utils.h"
 
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
 namespace visage {
   class Canvas;
 
+  // A run of characters drawn with its own brush instead of the canvas brush.
+  struct TextStyle {
+    int start = 0;
+    int length = 0;
+    Brush brush;
+
+    int end() const { return start + length; }
+  };
+
   class Text {
   public:
     Text() = default;
@@ -35,26 +49,178 @@ namespace visage {
         text_(text), font_(font), justification_(justification), multi_line_(multi_line) { }
     virtual ~Text() = default;
 
-    void setText(const String& text) { text_ = text; }
+    void setText(const String& text) {
+      text_ = text;
+      styles_.clear();
+      layout_dirty_ = true;
+    }
+    void replaceText(int position, int count, const String& text) {
+      text_.replace(position, count, text);
+      shiftStyles(position, count, text.length());
+      layout_dirty_ = true;
+    }
     const String& text() const { return text_; }
 
-    void setFont(const Font& font) { font_ = font; }
+    // Sets up a recycled Text in place so its string and layout storage are reused.
+    void reset(const String& text, const Font& font, Font::Justification justification) {
+      if (!(text_ == text))
+        setText(text);
+      if (justification_ != justification)
+        setJustification(justification);
+      if (multi_line_)
+        setMultiLine(false);
+      if (character_override_)
+        setCharacterOverride(0);
+      if (!styles_.empty())
+        setStyles({});
+      font_ = font;
+    }
+
+    // Styles are sorted by start and don't overlap. Characters outside every style draw with the
+    // canvas brush, and the whole text still draws as one batch. Restyling keeps the layout.
+    // Radial style brushes only draw correctly when the canvas brush is radial too.
+    void setStyles(std::vector<TextStyle> styles) {
+      styles_ = std::move(styles);
+      styles_dirty_ = true;
+    }
+    const std::vector<TextStyle>& styles() const { return styles_; }
+
+    // Replaces the styles inside [start, end) with styles, which must lie inside that range.
+    void restyle(int start, int end, const std::vector<TextStyle>& styles) {
+      auto first = firstStyleEndingAfter(start);
+      auto last = std::lower_bound(first, styles_.cend(), end,
+                                   [](const TextStyle& style, int position) {
+                                     return style.start < position;
+                                   });
+
+      std::vector<TextStyle> replaced;
+      if (first != last && first->start < start)
+        replaced.push_back({ first->start, start - first->start, first->brush });
+      replaced.insert(replaced.end(), styles.begin(), styles.end());
+      if (first != last && std::prev(last)->end() > end) {
+        const TextStyle& tail = *std::prev(last);
+        replaced.push_back({ end, tail.end() - end, tail.brush });
+      }
+
+      styles_.insert(styles_.erase(first, last), replaced.begin(), replaced.end());
+      styles_dirty_ = true;
+    }
+
+    // Styles clipped to [start, end) and moved to start at 0, for drawing a piece of the text.
+    std::vector<TextStyle> stylesInRange(int start, int end) const {
+      std::vector<TextStyle> result;
+      auto style = firstStyleEndingAfter(start);
+      for (; style != styles_.end() && style->start < end; ++style) {
+        int clipped_start = std::max(style->start, start);
+        int clipped_end = std::min(style->end(), end);
+        result.push_back({ clipped_start - start, clipped_end - clipped_start, style->brush });
+      }
+      return result;
+    }
+
+    void setFont(const Font& font) {
+      font_ = font;
+      layout_dirty_ = true;
+    }
     const Font& font() const { return font_; }
 
-    void setJustification(Font::Justification justification) { justification_ = justification; }
+    void setJustification(Font::Justification justification) {
+      justification_ = justification;
+      layout_dirty_ = true;
+    }
     Font::Justification justification() const { return justification_; }
 
-    void setMultiLine(bool multi_line) { multi_line_ = multi_line; }
+    void setMultiLine(bool multi_line) {
+      multi_line_ = multi_line;
+      layout_dirty_ = true;
+    }
     bool multiLine() const { return multi_line_; }
 
-    void setCharacterOverride(int character) { character_override_ = character; }
+    void setCharacterOverride(int character) {
+      character_override_ = character;
+      layout_dirty_ = true;
+    }
     int characterOverride() const { return character_override_; }
 
+    const std::vector<FontAtlasQuad>& layout(const Font& font, float width, float height) {
+      if (layout_dirty_ || font.packedFont() != layout_font_.packedFont() ||
+          font.nativeSize() != layout_font_.nativeSize() ||
+          font.kerning() != layout_font_.kerning() || width != layout_width_ ||
+          height != layout_height_) {
+        layout_dirty_ = false;
+        layout_font_ = font;
+        layout_width_ = width;
+        layout_height_ = height;
+
+        int length = text_.length();
+        layout_quads_.resize(length);
+        if (multi_line_) {
+          font.setMultiLineVertexPositions(layout_quads_.data(), text_.c_str(), length, 0, 0, width,
+                                           height, justification_);
+        }
+        else {
+          font.setVertexPositions(layout_quads_.data(), text_.c_str(), length, 0, 0, width, height,
+                                  justification_, character_override_);
+        }
+        styles_dirty_ = true;
+      }
+
+      if (styles_dirty_) {
+        styles_dirty_ = false;
+        int length = layout_quads_.size();
+        for (FontAtlasQuad& quad : layout_quads_)
+          quad.style = 0;
+        for (int i = 0; i < styles_.size(); ++i) {
+          int end = std::min(styles_[i].end(), length);
+          for (int c = std::max(0, styles_[i].start); c < end; ++c)
+            layout_quads_[c].style = i + 1;
+        }
+      }
+      return layout_quads_;
+    }
+
   private:
+    std::vector<TextStyle>::const_iterator firstStyleEndingAfter(int position) const {
+      return std::lower_bound(styles_.begin(), styles_.end(), position,
+                              [](const TextStyle& style, int p) { return style.end() <= p; });
+    }
+
+    void shiftStyles(int position, int removed, int inserted) {
+      if (styles_.empty())
+        return;
+
+      int removed_end = position + removed;
+      int delta = inserted - removed;
+      std::vector<TextStyle> shifted;
+      shifted.reserve(styles_.size());
+      for (const TextStyle& style : styles_) {
+        int start = style.start;
+        int end = style.end();
+        if (end > position)
+          end = std::max(position, end - removed) + (end > removed_end ? inserted : 0);
+        if (start >= removed_end)
+          start += delta;
+        else if (start > position)
+          start = position + (end > position ? inserted : 0);
+        if (start < end)
+          shifted.push_back({ start, end - start, style.brush });
+      }
+      styles_ = std::move(shifted);
+      styles_dirty_ = true;
+    }
+
     String text_;
     Font font_;
     Font::Justification justification_ = Font::kCenter;
     bool multi_line_ = false;
     int character_override_ = 0;
+    std::vector<TextStyle> styles_;
+
+    bool layout_dirty_ = true;
+    bool styles_dirty_ = false;
+    Font layout_font_;
+    float layout_width_ = 0.0f;
+    float layout_height_ = 0.0f;
+    std::vector<FontAtlasQuad> layout_quads_;
   };
 }
\ No newline at end of file
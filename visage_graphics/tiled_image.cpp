@@ -0,0 +1,169 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "tiled_image.h"
+
+#include "visage_utils/trace.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace visage {
+  TiledImage::TiledImage(int width, int height, TileDecoder decoder, int tile_size) :
+      width_(std::max(0, width)), height_(std::max(0, height)), tile_size_(std::max(1, tile_size)),
+      decoder_(std::move(decoder)) {
+    while (numColumns(num_levels_ - 1) > 1 || numRows(num_levels_ - 1) > 1)
+      num_levels_++;
+  }
+
+  int TiledImage::levelForScale(float scale) const {
+    if (scale <= 0.0f)
+      return num_levels_ - 1;
+
+    int level = std::floor(std::log2(1.0f / scale));
+    return std::clamp(level, 0, num_levels_ - 1);
+  }
+
+  void TiledImage::clear() {
+    tiles_.clear();
+    resident_bytes_ = 0;
+  }
+
+  Bounds TiledImage::tileBounds(int level, int column, int row) const {
+    float scale = 1 << level;
+    float extent = tile_size_ * scale;
+    float left = column * extent;
+    float top = row * extent;
+    return { left, top, std::min(width_ - left, extent), std::min(height_ - top, extent) };
+  }
+
+  TiledImage::Tile* TiledImage::findTile(int level, int column, int row) {
+    auto found = tiles_.find({ level, column, row });
+    if (found == tiles_.end() || found->second.pixels == nullptr)
+      return nullptr;
+
+    found->second.last_used = draw_count_;
+    return &found->second;
+  }
+
+  TiledImage::Tile* TiledImage::decodeTile(ImageAtlas* atlas, int level, int column, int row) {
+    VISAGE_TRACE_SCOPE("TiledImage::decodeTile");
+    int tile_width = std::min(tile_size_, levelWidth(level) - column * tile_size_);
+    int tile_height = std::min(tile_size_, levelHeight(level) - row * tile_size_);
+    std::vector<unsigned char> pixels;
+    if (decoder_)
+      pixels = decoder_(level, column, row, tile_width, tile_height);
+
+    // Failed tiles are remembered so they aren't decoded again every draw.
+    Tile& tile = tiles_[{ level, column, row }];
+    tile.last_used = draw_count_;
+    if (pixels.size() < static_cast<size_t>(tile_width) * tile_height * 4)
+      return nullptr;
+
+    auto shared_pixels = std::make_shared<const std::vector<unsigned char>>(std::move(pixels));
+    tile.packed_image = std::make_unique<ImageAtlas::PackedImage>(
+        atlas->addData(shared_pixels->data(), tile_width, tile_height));
+    tile.pixels = std::move(shared_pixels);
+    tile.width = tile_width;
+    tile.height = tile_height;
+    tile.bytes = static_cast<size_t>(tile_width) * tile_height * 4;
+    resident_bytes_ += tile.bytes;
+    return &tile;
+  }
+
+  void TiledImage::evictTiles() {
+    if (resident_bytes_ <= budget_bytes_)
+      return;
+
+    std::vector<std::pair<unsigned long long, TileKey>> candidates;
+    for (const auto& [key, tile] : tiles_) {
+      if (tile.pixels && tile.last_used < draw_count_)
+        candidates.emplace_back(tile.last_used, key);
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    // Dropping the packed image lets the atlas clear the tile once no drawn shape holds it.
+    for (const auto& candidate : candidates) {
+      if (resident_bytes_ <= budget_bytes_)
+        break;
+
+      auto found = tiles_.find(candidate.second);
+      resident_bytes_ -= found->second.bytes;
+      tiles_.erase(found);
+    }
+  }
+
+  void TiledImage::collectTiles(ImageAtlas* atlas, int level, const Bounds& visible,
+                                std::vector<TileDraw>& tiles) {
+    tiles.clear();
+    if (atlas != atlas_) {
+      clear();
+      atlas_ = atlas;
+    }
+
+    draw_count_++;
+    loading_ = false;
+    level = std::clamp(level, 0, num_levels_ - 1);
+    float extent = tile_size_ * static_cast<float>(1 << level);
+    int first_column = std::max(0, static_cast<int>(std::floor(visible.x() / extent)));
+    int first_row = std::max(0, static_cast<int>(std::floor(visible.y() / extent)));
+    int last_column = std::min(numColumns(level),
+                               static_cast<int>(std::ceil(visible.right() / extent)));
+    int last_row = std::min(numRows(level), static_cast<int>(std::ceil(visible.bottom() / extent)));
+
+    int decodes = 0;
+    for (int row = first_row; row < last_row; ++row) {
+      for (int column = first_column; column < last_column; ++column) {
+        Bounds bounds = tileBounds(level, column, row);
+        Tile* tile = findTile(level, column, row);
+        if (tile == nullptr && decodes < max_decodes_per_draw_ &&
+            tiles_.count({ level, column, row }) == 0) {
+          decodes++;
+          tile = decodeTile(atlas, level, column, row);
+        }
+
+        if (tile) {
+          Bounds source(0.0f, 0.0f, tile->width, tile->height);
+          tiles.push_back({ *tile->packed_image, tile->pixels, source, bounds });
+          continue;
+        }
+
+        loading_ = true;
+        for (int parent = level + 1; parent < num_levels_; ++parent) {
+          int shift = parent - level;
+          Tile* fallback = findTile(parent, column >> shift, row >> shift);
+          if (fallback == nullptr)
+            continue;
+
+          Bounds parent_bounds = tileBounds(parent, column >> shift, row >> shift);
+          float parent_scale = 1 << parent;
+          Bounds source((bounds.x() - parent_bounds.x()) / parent_scale,
+                        (bounds.y() - parent_bounds.y()) / parent_scale,
+                        bounds.width() / parent_scale, bounds.height() / parent_scale);
+          tiles.push_back({ *fallback->packed_image, fallback->pixels, source, bounds });
+          break;
+        }
+      }
+    }
+
+    evictTiles();
+  }
+}
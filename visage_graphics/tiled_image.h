@@ -0,0 +1,122 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "image.h"
+#include "visage_utils/space.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+namespace visage {
+  // An image too large for one atlas page, drawn from tiles decoded on demand. Each level halves
+  // the previous one down to a single tile, and a draw uses the coarsest level that still has a
+  // pixel per drawn pixel, so only the visible tiles at that resolution are decoded and uploaded.
+  // Recently drawn tiles stay resident in the image atlas up to a byte budget.
+  class TiledImage {
+  public:
+    static constexpr int kDefaultTileSize = 256;
+    static constexpr size_t kDefaultBudgetBytes = 64 * 1024 * 1024;
+    static constexpr int kDefaultMaxDecodesPerDraw = 4;
+
+    // Returns width * height RGBA pixels of the tile at column, row of level. A level n tile
+    // covers tileSize() << n source pixels, so decoders read a tiled pyramid or region-decode
+    // the source at 1 / 2^n scale. An empty result marks the tile as failed.
+    using TileDecoder = std::function<std::vector<unsigned char>(int level, int column, int row,
+                                                                 int width, int height)>;
+
+    struct TileDraw {
+      ImageAtlas::PackedImage packed_image;
+      std::shared_ptr<const std::vector<unsigned char>> pixels;
+      // Part of the tile to draw, in tile pixels.
+      Bounds source;
+      // Part of the full image it covers, in source image pixels.
+      Bounds bounds;
+    };
+
+    TiledImage(int width, int height, TileDecoder decoder, int tile_size = kDefaultTileSize);
+    TiledImage(const TiledImage&) = delete;
+    TiledImage& operator=(const TiledImage&) = delete;
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    int tileSize() const { return tile_size_; }
+    int numLevels() const { return num_levels_; }
+    int levelWidth(int level) const { return std::max(1, (width_ + (1 << level) - 1) >> level); }
+    int levelHeight(int level) const { return std::max(1, (height_ + (1 << level) - 1) >> level); }
+    int numColumns(int level) const { return (levelWidth(level) + tile_size_ - 1) / tile_size_; }
+    int numRows(int level) const { return (levelHeight(level) + tile_size_ - 1) / tile_size_; }
+    // Scale is drawn pixels per source pixel.
+    int levelForScale(float scale) const;
+
+    void setBudget(size_t bytes) { budget_bytes_ = bytes; }
+    size_t budget() const { return budget_bytes_; }
+    size_t residentBytes() const { return resident_bytes_; }
+    int numResidentTiles() const { return tiles_.size(); }
+
+    // Tiles over this count wait for a later draw and are covered by a coarser cached tile,
+    // keeping each frame's decode time bounded while panning or zooming.
+    void setMaxDecodesPerDraw(int max_decodes) { max_decodes_per_draw_ = max_decodes; }
+    int maxDecodesPerDraw() const { return max_decodes_per_draw_; }
+    // True when the last draw was missing tiles. Keep redrawing until it's false.
+    bool loading() const { return loading_; }
+
+    // Fills tiles with what covers visible, in source image pixels, at level. Decodes missing
+    // tiles into atlas and evicts the least recently drawn ones over the budget.
+    void collectTiles(ImageAtlas* atlas, int level, const Bounds& visible,
+                      std::vector<TileDraw>& tiles);
+    void clear();
+
+  private:
+    struct Tile {
+      std::shared_ptr<const std::vector<unsigned char>> pixels;
+      std::unique_ptr<ImageAtlas::PackedImage> packed_image;
+      int width = 0;
+      int height = 0;
+      size_t bytes = 0;
+      unsigned long long last_used = 0;
+    };
+
+    using TileKey = std::tuple<int, int, int>;
+
+    Bounds tileBounds(int level, int column, int row) const;
+    Tile* findTile(int level, int column, int row);
+    Tile* decodeTile(ImageAtlas* atlas, int level, int column, int row);
+    void evictTiles();
+
+    int width_ = 0;
+    int height_ = 0;
+    int tile_size_ = kDefaultTileSize;
+    int num_levels_ = 1;
+    TileDecoder decoder_;
+    ImageAtlas* atlas_ = nullptr;
+    std::map<TileKey, Tile> tiles_;
+    size_t budget_bytes_ = kDefaultBudgetBytes;
+    size_t resident_bytes_ = 0;
+    int max_decodes_per_draw_ = kDefaultMaxDecodesPerDraw;
+    unsigned long long draw_count_ = 0;
+    bool loading_ = false;
+  };
+}
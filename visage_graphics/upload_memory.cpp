@@ -0,0 +1,98 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "upload_memory.h"
+
+#include "visage_utils/defines.h"
+
+#include <bgfx/bgfx.h>
+#include <cstring>
+
+namespace visage {
+  UploadMemoryPool& UploadMemoryPool::instance() {
+    // Never destroyed so bgfx can still release blocks while it shuts down during static
+    // destruction.
+    static UploadMemoryPool* pool = new UploadMemoryPool();
+    return *pool;
+  }
+
+  const bgfx::Memory* UploadMemoryPool::allocate(uint32_t size) {
+    int bucket = kMinBlockBits;
+    while (bucket < kMaxBlockBits && (size_t(1) << bucket) < size)
+      bucket++;
+    VISAGE_ASSERT((size_t(1) << bucket) >= size);
+
+    std::unique_ptr<Block> block;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto& free_blocks = free_blocks_[bucket];
+      if (free_blocks.empty())
+        num_allocated_blocks_++;
+      else {
+        block = std::move(free_blocks.back());
+        free_blocks.pop_back();
+        pooled_bytes_ -= size_t(1) << bucket;
+      }
+    }
+
+    if (block == nullptr) {
+      block = std::make_unique<Block>();
+      block->data = std::make_unique<uint8_t[]>(size_t(1) << bucket);
+      block->bucket = bucket;
+    }
+
+    Block* released = block.release();
+    return bgfx::makeRef(released->data.get(), size, &UploadMemoryPool::release, released);
+  }
+
+  const bgfx::Memory* UploadMemoryPool::copy(const void* data, uint32_t size) {
+    const bgfx::Memory* memory = allocate(size);
+    std::memcpy(memory->data, data, size);
+    return memory;
+  }
+
+  size_t UploadMemoryPool::pooledBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pooled_bytes_;
+  }
+
+  int UploadMemoryPool::numAllocatedBlocks() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return num_allocated_blocks_;
+  }
+
+  void UploadMemoryPool::release(void*, void* user_data) {
+    instance().recycle(static_cast<Block*>(user_data));
+  }
+
+  void UploadMemoryPool::recycle(Block* block) {
+    std::unique_ptr<Block> owned(block);
+    size_t block_size = size_t(1) << block->bucket;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pooled_bytes_ + block_size > kMaxPooledBytes) {
+      num_allocated_blocks_--;
+      return;
+    }
+
+    pooled_bytes_ += block_size;
+    free_blocks_[block->bucket].push_back(std::move(owned));
+  }
+}
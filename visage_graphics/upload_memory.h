@@ -0,0 +1,69 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace bgfx {
+  struct Memory;
+}
+
+namespace visage {
+  // Recycled staging memory for texture uploads. Blocks go to bgfx through makeRef and come back
+  // through its release callback once the render thread has consumed them, so uploads skip the
+  // allocation and the extra copy behind bgfx::alloc and bgfx::copy.
+  class UploadMemoryPool {
+  public:
+    static constexpr int kMinBlockBits = 12;
+    static constexpr int kMaxBlockBits = 31;
+    static constexpr size_t kMaxPooledBytes = 32 * 1024 * 1024;
+
+    static UploadMemoryPool& instance();
+
+    // Uninitialized memory for an upload of _size_ bytes, to be filled before it's passed to bgfx.
+    const bgfx::Memory* allocate(uint32_t size);
+    // Pooled memory holding a copy of _data_, in place of bgfx::copy.
+    const bgfx::Memory* copy(const void* data, uint32_t size);
+
+    size_t pooledBytes() const;
+    int numAllocatedBlocks() const;
+
+  private:
+    struct Block {
+      std::unique_ptr<uint8_t[]> data;
+      int bucket = 0;
+    };
+
+    UploadMemoryPool() = default;
+
+    static void release(void* data, void* user_data);
+    void recycle(Block* block);
+
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Block>> free_blocks_[kMaxBlockBits + 1];
+    size_t pooled_bytes_ = 0;
+    int num_allocated_blocks_ = 0;
+  };
+}
@@ -56,8 +56,8 @@ namespace visage {
       initialized_ = true;
     }
 
-    void drawIntoBuffer(char32_t emoji, int font_size, int write_width, unsigned int* dest,
-                        int dest_width, int x, int y) {
+    void drawIntoBuffer(const std::vector<EmojiPlacement>& emojis, int font_size, int write_width,
+                        unsigned int* dest, int dest_width) {
       if (!initialized_)
         return;
 
@@ -78,43 +78,58 @@ namespace visage {
       if (FAILED(hr))
         return;
 
+      ComPtr<IDWriteTextFormat> text_format;
       hr = dwrite_factory_->CreateTextFormat(L"Segoe UI Emoji", nullptr, DWRITE_FONT_WEIGHT_NORMAL,
                                              DWRITE_FONT_STYLE_NORMAL, DWRITE_FONT_STRETCH_NORMAL,
-                                             font_size, L"en-us", &text_format_);
+                                             font_size, L"en-us", &text_format);
       if (FAILED(hr))
         return;
 
-      ComPtr<IDWriteTextLayout> text_layout;
-      std::wstring emoji_string = String(emoji).toWide();
-      hr = dwrite_factory_->CreateTextLayout(emoji_string.c_str(), emoji_string.length(),
-                                             text_format_.Get(), target_size.width,
-                                             target_size.height, &text_layout);
-      if (FAILED(hr))
-        return;
-
-      if (FAILED(text_layout->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_CENTER)))
+      if (FAILED(text_format->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_CENTER)))
         return;
-      if (FAILED(text_layout->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_CENTER)))
+      if (FAILED(text_format->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_CENTER)))
         return;
 
-      render_target->BeginDraw();
-      render_target->Clear(D2D1::ColorF(D2D1::ColorF::White, 0.0f));
-
       ComPtr<ID2D1SolidColorBrush> brush = nullptr;
       hr = render_target->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::White), &brush);
       if (FAILED(hr) || brush == nullptr)
         return;
 
-      render_target->DrawTextLayout(D2D1::Point2F(0, 0), text_layout.Get(), brush.Get(),
-                                    (D2D1_DRAW_TEXT_OPTIONS)(D2D1_DRAW_TEXT_OPTIONS_ENABLE_COLOR_FONT |
-                                                             D2D1_DRAW_TEXT_OPTIONS_CLIP));
-      hr = render_target->EndDraw();
-      if (FAILED(hr))
-        return;
+      auto draw_options = (D2D1_DRAW_TEXT_OPTIONS)(D2D1_DRAW_TEXT_OPTIONS_ENABLE_COLOR_FONT |
+                                                   D2D1_DRAW_TEXT_OPTIONS_CLIP);
+      for (const EmojiPlacement& placement : emojis) {
+        ComPtr<IDWriteTextLayout> text_layout;
+        std::wstring emoji_string = String(placement.emoji).toWide();
+        hr = dwrite_factory_->CreateTextLayout(emoji_string.c_str(), emoji_string.length(),
+                                               text_format.Get(), target_size.width,
+                                               target_size.height, &text_layout);
+        if (FAILED(hr))
+          continue;
+
+        render_target->BeginDraw();
+        render_target->Clear(D2D1::ColorF(D2D1::ColorF::White, 0.0f));
+        render_target->DrawTextLayout(D2D1::Point2F(0, 0), text_layout.Get(), brush.Get(),
+                                      draw_options);
+        if (FAILED(render_target->EndDraw()))
+          return;
+
+        copyBitmap(wic_bitmap.Get(), placement, write_width, dest, dest_width);
+      }
+    }
+
+    ~EmojiRasterizerImpl() {
+      d2d_factory_ = nullptr;
+      dwrite_factory_ = nullptr;
+      wic_factory_ = nullptr;
+      CoUninitialize();
+    }
 
-      WICRect rcLock = { 0, 0, static_cast<int>(target_size.width), static_cast<int>(target_size.height) };
+  private:
+    static void copyBitmap(IWICBitmap* wic_bitmap, const EmojiPlacement& placement, int write_width,
+                           unsigned int* dest, int dest_width) {
+      WICRect rcLock = { 0, 0, write_width, write_width };
       ComPtr<IWICBitmapLock> lock;
-      hr = wic_bitmap->Lock(&rcLock, WICBitmapLockRead, &lock);
+      HRESULT hr = wic_bitmap->Lock(&rcLock, WICBitmapLockRead, &lock);
       if (FAILED(hr))
         return;
 
@@ -127,24 +142,14 @@ namespace visage {
       for (UINT i = 0; i < buffer_size / 4; ++i) {
         int row = i / write_width;
         int col = i % write_width;
-        dest[(y + row) * dest_width + x + col] = buffer[i];
+        dest[(placement.y + row) * dest_width + placement.x + col] = buffer[i];
       }
     }
 
-    ~EmojiRasterizerImpl() {
-      d2d_factory_ = nullptr;
-      dwrite_factory_ = nullptr;
-      text_format_ = nullptr;
-      wic_factory_ = nullptr;
-      CoUninitialize();
-    }
-
-  private:
     bool initialized_ = false;
     ComPtr<ID2D1Factory> d2d_factory_;
     D2D1_FACTORY_OPTIONS options_ = {};
     ComPtr<IDWriteFactory> dwrite_factory_;
-    ComPtr<IDWriteTextFormat> text_format_;
     ComPtr<IWICImagingFactory> wic_factory_;
   };
 
@@ -154,8 +159,8 @@ namespace visage {
 
   EmojiRasterizer::~EmojiRasterizer() = default;
 
-  void EmojiRasterizer::drawIntoBuffer(char32_t emoji, int font_size, int write_width,
-                                       unsigned int* dest, int dest_width, int x, int y) {
-    impl_->drawIntoBuffer(emoji, font_size, write_width, dest, dest_width, x, y);
+  void EmojiRasterizer::drawIntoBuffer(const std::vector<EmojiPlacement>& emojis, int font_size,
+                                       int write_width, unsigned int* dest, int dest_width) {
+    impl_->drawIntoBuffer(emojis, font_size, write_width, dest, dest_width);
   }
 }
@@ -0,0 +1,58 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "animation_scheduler.h"
+
+namespace visage {
+  void AnimationScheduler::add(ScheduledAnimation* animation) {
+    VISAGE_ASSERT(animation->scheduler_index_ < 0);
+    animation->scheduler_index_ = animations_.size();
+    animations_.push_back(animation);
+    if (animation->frame())
+      animation->frame()->redraw();
+  }
+
+  void AnimationScheduler::remove(ScheduledAnimation* animation) {
+    int index = animation->scheduler_index_;
+    VISAGE_ASSERT(index >= 0 && index < animations_.size() && animations_[index] == animation);
+    animation->scheduler_index_ = -1;
+
+    ScheduledAnimation* last = animations_.back();
+    animations_.pop_back();
+    if (last != animation) {
+      animations_[index] = last;
+      last->scheduler_index_ = index;
+    }
+  }
+
+  void AnimationScheduler::advance(long long ms) {
+    for (int i = 0; i < animations_.size();) {
+      ScheduledAnimation* animation = animations_[i];
+      bool running = animation->step(ms);
+      if (animation->frame())
+        animation->frame()->redraw();
+      if (running)
+        ++i;
+      else
+        remove(animation);
+    }
+  }
+}
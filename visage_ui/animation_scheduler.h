@@ -0,0 +1,126 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "frame.h"
+#include "visage_graphics/animation.h"
+
+#include <vector>
+
+namespace visage {
+  class ScheduledAnimation;
+
+  // Advances every running ScheduledAnimation once per draw callback against a single clock
+  // and redraws only their frames. Nothing is scheduled while no animation is moving.
+  class AnimationScheduler {
+  public:
+    static AnimationScheduler& instance() {
+      static AnimationScheduler instance;
+      return instance;
+    }
+
+    AnimationScheduler(const AnimationScheduler&) = delete;
+    AnimationScheduler& operator=(const AnimationScheduler&) = delete;
+
+    void add(ScheduledAnimation* animation);
+    void remove(ScheduledAnimation* animation);
+    // Steps and redraws every running animation, dropping the ones that settled. _ms_ is the
+    // draw callback's timestamp, so animations land where the presented frame is, and its epoch
+    // is up to the platform. Animations without a frame redraw whatever they need from step().
+    void advance(long long ms);
+    bool idle() const { return animations_.empty(); }
+    int numAnimating() const { return animations_.size(); }
+
+  private:
+    AnimationScheduler() = default;
+
+    std::vector<ScheduledAnimation*> animations_;
+  };
+
+  class ScheduledAnimation {
+  public:
+    explicit ScheduledAnimation(Frame* frame) : frame_(frame) { }
+    virtual ~ScheduledAnimation() { unschedule(); }
+
+    ScheduledAnimation(const ScheduledAnimation&) = delete;
+    ScheduledAnimation& operator=(const ScheduledAnimation&) = delete;
+
+    // Returns true while the animation still needs more frames. _ms_ is on the draw clock.
+    virtual bool step(long long ms) = 0;
+
+    void schedule() {
+      if (!scheduled())
+        AnimationScheduler::instance().add(this);
+    }
+    void unschedule() {
+      if (scheduled())
+        AnimationScheduler::instance().remove(this);
+    }
+    bool scheduled() const { return scheduler_index_ >= 0; }
+    Frame* frame() const { return frame_; }
+
+  private:
+    friend class AnimationScheduler;
+
+    Frame* frame_ = nullptr;
+    int scheduler_index_ = -1;
+  };
+
+  // Animation owned by a frame that is driven by the AnimationScheduler, so draw() only reads
+  // value() instead of updating and requesting redraws itself.
+  template<typename T>
+  class FrameAnimation : public ScheduledAnimation, public Animation<T> {
+  public:
+    using Easing = typename Animation<T>::EasingFunction;
+
+    explicit FrameAnimation(Frame* frame, int milliseconds = Animation<T>::kRegularTime,
+                            Easing forward_easing = Animation<T>::kEaseIn,
+                            Easing backward_easing = Animation<T>::kEaseOut) :
+        ScheduledAnimation(frame), Animation<T>(milliseconds, forward_easing, backward_easing) { }
+
+    void target(bool targeting, bool jump = false) {
+      Animation<T>::target(targeting, jump);
+      if (Animation<T>::isAnimating()) {
+        if (!scheduled())
+          clock_started_ = false;
+        schedule();
+      }
+      else
+        unschedule();
+      frame()->redraw();
+    }
+
+    // The draw clock has no relation to time::milliseconds(), so the first frame after being
+    // scheduled only starts the clock and progress is measured between draw timestamps.
+    bool step(long long ms) override {
+      long long elapsed_ms = clock_started_ ? ms - last_ms_ : 0;
+      clock_started_ = true;
+      last_ms_ = ms;
+      Animation<T>::advance(elapsed_ms);
+      return Animation<T>::isAnimating();
+    }
+
+  private:
+    bool clock_started_ = false;
+    long long last_ms_ = 0;
+  };
+}
@@ -22,8 +22,11 @@
 #include "events.h"
 
 #include "frame.h"
+#include "visage_utils/thread_utils.h"
 #include "visage_utils/time_utils.h"
 
+#include <algorithm>
+
 namespace visage {
 
   EventTimer::~EventTimer() {
@@ -35,11 +38,9 @@ namespace visage {
     VISAGE_ASSERT(ms > 0);
 
     if (ms > 0) {
-      if (!isRunning())
-        EventManager::instance().addTimer(this);
-
       last_run_time_ = time::milliseconds();
       ms_ = ms;
+      EventManager::instance().addTimer(this);
     }
   }
 
@@ -62,30 +63,107 @@ namespace visage {
     return false;
   }
 
+  EventManager::EventManager() {
+    ThreadPool::setMainThreadDispatcher([](std::function<void()> task) {
+      EventManager::instance().post(std::move(task));
+    });
+  }
+
+  EventManager::~EventManager() {
+    ThreadPool::setMainThreadDispatcher(nullptr);
+  }
+
+  void EventManager::schedule(EventTimer* timer, uint64_t sequence, long long fire_time) {
+    schedule_.push_back({ fire_time, timer, sequence });
+    std::push_heap(schedule_.begin(), schedule_.end(), std::greater<>());
+  }
+
+  void EventManager::popStaleTimers() {
+    while (!schedule_.empty() && !isCurrent(schedule_.front())) {
+      std::pop_heap(schedule_.begin(), schedule_.end(), std::greater<>());
+      schedule_.pop_back();
+    }
+  }
+
+  void EventManager::compactSchedule() {
+    static constexpr size_t kMinCompactSize = 64;
+    if (schedule_.size() < kMinCompactSize || schedule_.size() < 2 * timers_.size())
+      return;
+
+    auto stale = [this](const ScheduledTimer& scheduled) { return !isCurrent(scheduled); };
+    schedule_.erase(std::remove_if(schedule_.begin(), schedule_.end(), stale), schedule_.end());
+    std::make_heap(schedule_.begin(), schedule_.end(), std::greater<>());
+  }
+
   void EventManager::addTimer(EventTimer* timer) {
-    timers_.push_back(timer);
+    uint64_t sequence = ++sequence_;
+    timers_[timer] = sequence;
+    schedule(timer, sequence, timer->nextFireTime());
+    compactSchedule();
   }
 
   void EventManager::removeTimer(const EventTimer* timer) {
-    auto it = std::find(timers_.begin(), timers_.end(), timer);
-    if (it != timers_.end())
-      timers_.erase(it);
+    timers_.erase(timer);
+    popStaleTimers();
   }
 
-  void EventManager::addCallback(std::function<void()> callback) {
-    callbacks_.push_back(std::move(callback));
+  void EventManager::drainCallbacks() {
+    InplaceTask task;
+    while (posted_callbacks_.tryPop(task))
+      callbacks_.push_back(std::move(task));
+
+    if (has_overflow_callbacks_) {
+      std::lock_guard<std::mutex> lock(overflow_mutex_);
+      for (InplaceTask& overflow : overflow_callbacks_)
+        callbacks_.push_back(std::move(overflow));
+      overflow_callbacks_.clear();
+      has_overflow_callbacks_ = false;
+    }
   }
 
   void EventManager::checkEventTimers() {
     long long current_time = time::milliseconds();
-    std::vector<EventTimer*> timers = timers_;
-    std::vector<std::function<void()>> callbacks = std::move(callbacks_);
+    std::vector<ScheduledTimer> due;
+    popStaleTimers();
+    while (!schedule_.empty() && schedule_.front().fire_time <= current_time) {
+      std::pop_heap(schedule_.begin(), schedule_.end(), std::greater<>());
+      if (isCurrent(schedule_.back()))
+        due.push_back(schedule_.back());
+      schedule_.pop_back();
+      popStaleTimers();
+    }
 
-    for (auto timer : timers)
-      timer->checkTimer(current_time);
+    std::vector<InplaceTask> callbacks;
+    drainCallbacks();
+    callbacks.swap(callbacks_);
+
+    for (const ScheduledTimer& scheduled : due) {
+      if (!isCurrent(scheduled))
+        continue;
+
+      EventTimer* timer = scheduled.timer;
+      if (timer->isRunning())
+        timer->checkTimer(current_time);
+      if (isCurrent(scheduled) && timer->isRunning())
+        schedule(timer, scheduled.sequence, std::max(current_time + 1, timer->nextFireTime()));
+    }
 
     for (auto& callback : callbacks)
       callback();
+
+    callbacks.clear();
+    if (callbacks_.empty())
+      callbacks_.swap(callbacks);
+  }
+
+  long long EventManager::nextDeadline() {
+    if (!posted_callbacks_.empty() || has_overflow_callbacks_)
+      return time::milliseconds();
+
+    popStaleTimers();
+    if (schedule_.empty())
+      return -1;
+    return schedule_.front().fire_time;
   }
 
   MouseEvent MouseEvent::relativeTo(const Frame* new_frame) const {
@@ -94,4 +172,21 @@ namespace visage {
     copy.event_frame = new_frame;
     return copy;
   }
+
+  Point MouseEvent::predictedWindowPosition(long long ahead_us) const {
+    if (history == nullptr || history->size() < 2 || ahead_us <= 0)
+      return window_position;
+
+    const PointerSample& latest = history->back();
+    auto first = history->begin();
+    while (first + 1 != history->end() && latest.time_us - first->time_us > kPredictionWindowUs)
+      ++first;
+
+    long long elapsed_us = latest.time_us - first->time_us;
+    if (elapsed_us <= 0)
+      return window_position;
+
+    float scale = static_cast<float>(std::min(ahead_us, kMaxPredictionUs)) / elapsed_us;
+    return window_position + (latest.window_position - first->window_position) * scale;
+  }
 }
@@ -23,10 +23,14 @@
 
 #include "visage_utils/defines.h"
 #include "visage_utils/events.h"
+#include "visage_utils/lock_free_queue.h"
 #include "visage_utils/space.h"
 
 #include <functional>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace visage {
   class Frame;
@@ -47,6 +51,7 @@ namespace visage {
       VISAGE_ASSERT(ms_ >= -1);
       return ms_ > 0;
     }
+    long long nextFireTime() const { return last_run_time_ + ms_; }
 
   private:
     void notifyTimerCallback() { on_timer_callback_.callback(); }
@@ -58,6 +63,8 @@ namespace visage {
 
   class EventManager {
   public:
+    static constexpr int kPostedCallbackCapacity = 1024;
+
     static EventManager& instance() {
       static EventManager instance;
       return instance;
@@ -68,22 +75,73 @@ namespace visage {
 
     void addTimer(EventTimer* timer);
     void removeTimer(const EventTimer* timer);
-    void addCallback(std::function<void()> callback);
+    void addCallback(std::function<void()> callback) { post(std::move(callback)); }
+
+    // Safe to call from any thread. Small callables are queued without allocating.
+    template<typename F>
+    void post(F&& function) {
+      InplaceTask task(std::forward<F>(function));
+      if (posted_callbacks_.tryPush(std::move(task)))
+        return;
+
+      std::lock_guard<std::mutex> lock(overflow_mutex_);
+      overflow_callbacks_.push_back(std::move(task));
+      has_overflow_callbacks_ = true;
+    }
+
     void checkEventTimers();
+    // Earliest time in ms a timer or callback needs servicing, or -1 when there is nothing to do.
+    long long nextDeadline();
+    int numTimers() const { return timers_.size(); }
 
   private:
-    EventManager() = default;
-    ~EventManager() = default;
+    struct ScheduledTimer {
+      long long fire_time = 0;
+      EventTimer* timer = nullptr;
+      uint64_t sequence = 0;
+
+      bool operator>(const ScheduledTimer& other) const { return fire_time > other.fire_time; }
+    };
+
+    EventManager();
+    ~EventManager();
+
+    bool isCurrent(const ScheduledTimer& scheduled) const {
+      auto it = timers_.find(scheduled.timer);
+      return it != timers_.end() && it->second == scheduled.sequence;
+    }
+    void schedule(EventTimer* timer, uint64_t sequence, long long fire_time);
+    void popStaleTimers();
+    void compactSchedule();
+
+    void drainCallbacks();
 
-    std::vector<EventTimer*> timers_ {};
-    std::vector<std::function<void()>> callbacks_ {};
+    std::unordered_map<const EventTimer*, uint64_t> timers_ {};
+    std::vector<ScheduledTimer> schedule_ {};
+    uint64_t sequence_ = 0;
+
+    MpscQueue<InplaceTask> posted_callbacks_ { kPostedCallbackCapacity };
+    std::mutex overflow_mutex_;
+    std::vector<InplaceTask> overflow_callbacks_ {};
+    std::atomic<bool> has_overflow_callbacks_ = false;
+    std::vector<InplaceTask> callbacks_ {};
   };
 
-  static void runOnEventThread(std::function<void()> function) {
-    EventManager::instance().addCallback(std::move(function));
+  template<typename F>
+  static void runOnEventThread(F&& function) {
+    EventManager::instance().post(std::forward<F>(function));
   }
 
+  // A logical window position stamped with time::microseconds() of when the pointer was there.
+  struct PointerSample {
+    Point window_position;
+    long long time_us = 0;
+  };
+
   struct MouseEvent {
+    static constexpr long long kPredictionWindowUs = 40000;
+    static constexpr long long kMaxPredictionUs = 50000;
+
     Point relativePosition() const { return relative_position; }
     Point windowPosition() const { return window_position; }
     bool isAltDown() const { return modifiers & kModifierAlt; }
@@ -112,6 +170,14 @@ namespace visage {
 
     MouseEvent relativeTo(const Frame* new_frame) const;
 
+    // Extrapolates the pointer ahead_us into the future from its velocity over the recent
+    // history, so drawing can lead the pointer by the display latency. Clamped to
+    // kMaxPredictionUs, and the current position when there isn't enough history.
+    Point predictedWindowPosition(long long ahead_us) const;
+    Point predictedPosition(long long ahead_us) const {
+      return predictedWindowPosition(ahead_us) - window_position + position;
+    }
+
     bool shouldTriggerPopup() const {
       return isRightButton() || (isLeftButton() && isMacCtrlDown());
     }
@@ -132,6 +198,12 @@ namespace visage {
     bool wheel_reversed = false;
     bool wheel_momentum = false;
     int repeat_click_count = 0;
+    // Window positions of every move merged into this one when the window coalesces mouse events.
+    const std::vector<Point>* coalesced_window_positions = nullptr;
+    long long time_us = 0;
+    // Recent pointer samples of the current hover or drag, oldest first and ending at this event.
+    // Includes positions merged by the window or the OS, so strokes can use every point.
+    const std::vector<PointerSample>* history = nullptr;
   };
 
   class KeyEvent {
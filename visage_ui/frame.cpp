@@ -22,11 +22,156 @@
 #include "frame.h"
 
 #include "visage_graphics/theme.h"
+#include "visage_utils/trace.h"
+
+#include <algorithm>
+#include <cmath>
 
 namespace visage {
+  int FrameHitTestGrid::column(float x) const {
+    return std::clamp(static_cast<int>((x - area_.x()) / cell_width_), 0, columns_ - 1);
+  }
+
+  int FrameHitTestGrid::row(float y) const {
+    return std::clamp(static_cast<int>((y - area_.y()) / cell_height_), 0, rows_ - 1);
+  }
+
+  void FrameHitTestGrid::build(const std::vector<Frame*>& children) {
+    area_ = {};
+    int num_children = 0;
+    for (const Frame* child : children) {
+      if (child->isVisible() && child->width() > 0.0f && child->height() > 0.0f) {
+        area_ = area_.unioned(child->bounds());
+        num_children++;
+      }
+    }
+
+    cells_.clear();
+    columns_ = 0;
+    rows_ = 0;
+    if (num_children == 0)
+      return;
+
+    float aspect = area_.width() / std::max(1.0f, area_.height());
+    columns_ = std::round(std::sqrt(num_children * aspect));
+    columns_ = std::clamp(columns_, 1, kMaxDimension);
+    rows_ = std::clamp((num_children + columns_ - 1) / columns_, 1, kMaxDimension);
+    cell_width_ = std::max(1.0f, area_.width() / columns_);
+    cell_height_ = std::max(1.0f, area_.height() / rows_);
+    cells_.resize(columns_ * rows_);
+
+    for (int i = 0; i < children.size(); ++i) {
+      const Frame* child = children[i];
+      if (!child->isVisible() || child->width() <= 0.0f || child->height() <= 0.0f)
+        continue;
+
+      int column_end = column(child->right());
+      int row_end = row(child->bottom());
+      for (int r = row(child->y()); r <= row_end; ++r) {
+        for (int c = column(child->x()); c <= column_end; ++c)
+          cells_[r * columns_ + c].push_back(i);
+      }
+    }
+  }
+
+  const std::vector<int>* FrameHitTestGrid::candidates(Point point) const {
+    if (cells_.empty() || !area_.contains(point))
+      return nullptr;
+    return &cells_[row(point.y) * columns_ + column(point.x)];
+  }
+
+  void FrameFocusOrder::build(Frame* root, uint64_t generation) {
+    generation_ = generation;
+    frames_.clear();
+    subtree_ends_.clear();
+    receivers_.clear();
+    positions_.clear();
+    add(root, true);
+
+    first_receiver_at_.resize(frames_.size() + 1);
+    int next_receiver = receivers_.size();
+    first_receiver_at_[frames_.size()] = next_receiver;
+    for (int i = frames_.size() - 1; i >= 0; --i) {
+      if (next_receiver > 0 && receivers_[next_receiver - 1] == i)
+        next_receiver--;
+      first_receiver_at_[i] = next_receiver;
+    }
+  }
+
+  void FrameFocusOrder::add(Frame* frame, bool traversable) {
+    int position = frames_.size();
+    frames_.push_back(frame);
+    subtree_ends_.push_back(position + 1);
+    positions_[frame] = position;
+
+    traversable = traversable && frame->isVisible();
+    if (traversable && frame->receivesTextInput()) {
+      receivers_.push_back(position);
+      traversable = false;
+    }
+
+    auto by_tab_order = [](const Frame* a, const Frame* b) {
+      return a->tabOrder() < b->tabOrder();
+    };
+    const std::vector<Frame*>& children = frame->children();
+    if (std::is_sorted(children.begin(), children.end(), by_tab_order)) {
+      for (Frame* child : children)
+        add(child, traversable);
+    }
+    else {
+      std::vector<Frame*> sorted = children;
+      std::stable_sort(sorted.begin(), sorted.end(), by_tab_order);
+      for (Frame* child : sorted)
+        add(child, traversable);
+    }
+    subtree_ends_[position] = frames_.size();
+  }
+
+  std::pair<int, int> FrameFocusOrder::excludedRange(const Frame* frame,
+                                                     const Frame* starting_child) const {
+    auto child = starting_child ? positions_.find(starting_child) : positions_.end();
+    if (child != positions_.end())
+      return { child->second, subtree_ends_[child->second] };
+
+    int position = positions_.at(frame);
+    return { position, position + 1 };
+  }
+
+  Frame* FrameFocusOrder::next(const Frame* frame, const Frame* starting_child) const {
+    if (receivers_.empty())
+      return nullptr;
+
+    auto [begin, end] = excludedRange(frame, starting_child);
+    int index = first_receiver_at_[end];
+    if (index == receivers_.size())
+      index = 0;
+
+    int position = receivers_[index];
+    if (position >= begin && position < end)
+      return nullptr;
+    return frames_[position];
+  }
+
+  Frame* FrameFocusOrder::previous(const Frame* frame, const Frame* starting_child) const {
+    if (receivers_.empty())
+      return nullptr;
+
+    auto [begin, end] = excludedRange(frame, starting_child);
+    int index = first_receiver_at_[begin] - 1;
+    if (index < 0)
+      index = receivers_.size() - 1;
+
+    int position = receivers_[index];
+    if (position >= begin && position < end)
+      return nullptr;
+    return frames_[position];
+  }
+
   void Frame::setVisible(bool visible) {
     if (visible_ != visible) {
       visible_ = visible;
+      hitTestChanged();
+      focusOrderChanged();
       on_visibility_change_.callback();
     }
 
@@ -37,6 +182,8 @@ namespace visage {
       redrawing_ = false;
 
     setDrawing(visible && (parent_ == nullptr || parent_->isDrawing()));
+    if (visible && lazy_init_ && !initialized_ && parent_ && parent_->initialized_)
+      init();
   }
 
   void Frame::setDrawing(bool drawing) {
@@ -58,6 +205,7 @@ namespace visage {
   void Frame::setOnTop(bool on_top) {
     on_top_ = on_top;
     region_.setOnTop(on_top);
+    hitTestChanged();
     redraw();
   }
 
@@ -66,8 +214,12 @@ namespace visage {
     if (child == nullptr)
       return;
 
+    child->child_index_ = children_.size();
     children_.push_back(child);
     child->parent_ = this;
+    child->focus_order_ = nullptr;
+    childrenHitTestChanged();
+    focusOrderChanged();
     child->setEventHandler(event_handler_);
     if (palette_)
       child->setPalette(palette_);
@@ -78,12 +230,16 @@ namespace visage {
     region_.addRegion(child->region());
 
     child->setDpiScale(dpi_scale_);
-    if (initialized_)
+    if (initialized_ && !child->initDeferred())
       child->init();
 
     on_child_added_.callback(child);
-    computeLayout();
-    computeLayout(child);
+    if (deferredLayout())
+      invalidateLayout();
+    else {
+      computeLayout();
+      computeLayout(child);
+    }
     child->redrawAll();
   }
 
@@ -106,7 +262,10 @@ namespace visage {
     if (owned_children_.count(child))
       owned_children_.erase(child);
 
-    computeLayout();
+    if (deferredLayout())
+      invalidateLayout();
+    else
+      computeLayout();
   }
 
   void Frame::removeAllChildren() {
@@ -121,28 +280,35 @@ namespace visage {
   }
 
   int Frame::indexOfChild(const Frame* child) const {
-    for (int i = 0; i < children_.size(); ++i) {
-      if (children_[i] == child)
-        return i;
-    }
-    return -1;
+    return child && child->parent_ == this ? child->child_index_ : -1;
   }
 
   Frame* Frame::frameAtPoint(Point point) {
-    if (pass_mouse_events_to_children_) {
-      for (auto it = children_.rbegin(); it != children_.rend(); ++it) {
-        auto& child = *it;
-        if (child->isOnTop() && child->isVisible() && child->containsPoint(point)) {
-          Frame* result = child->frameAtPoint(point - child->topLeft());
-          if (result)
-            return result;
+    auto child_at_point = [point](Frame* child, bool on_top) -> Frame* {
+      if (child->isOnTop() == on_top && child->isVisible() && child->containsPoint(point))
+        return child->frameAtPoint(point - child->topLeft());
+      return nullptr;
+    };
+
+    if (pass_mouse_events_to_children_ && hit_test_grid_) {
+      if (hit_test_grid_dirty_) {
+        hit_test_grid_->build(children_);
+        hit_test_grid_dirty_ = false;
+      }
+
+      if (const std::vector<int>* candidates = hit_test_grid_->candidates(point)) {
+        for (bool on_top : { true, false }) {
+          for (auto it = candidates->rbegin(); it != candidates->rend(); ++it) {
+            if (Frame* result = child_at_point(children_[*it], on_top))
+              return result;
+          }
         }
       }
-      for (auto it = children_.rbegin(); it != children_.rend(); ++it) {
-        auto& child = *it;
-        if (!child->isOnTop() && child->isVisible() && child->containsPoint(point)) {
-          Frame* result = child->frameAtPoint(point - child->topLeft());
-          if (result)
+    }
+    else if (pass_mouse_events_to_children_) {
+      for (bool on_top : { true, false }) {
+        for (auto it = children_.rbegin(); it != children_.rend(); ++it) {
+          if (Frame* result = child_at_point(*it, on_top))
             return result;
         }
       }
@@ -165,20 +331,27 @@ namespace visage {
     if (bounds_ == bounds && native_bounds_ == new_native_bounds)
       return;
 
+    bool resized = native_bounds_.width() != new_native_bounds.width() ||
+                   native_bounds_.height() != new_native_bounds.height();
     bounds_ = bounds;
     native_bounds_ = new_native_bounds;
     region_.setBounds(native_bounds_.x(), native_bounds_.y(), native_bounds_.width(),
                       native_bounds_.height());
-    computeLayout();
-    if (layout_ == nullptr || !layout_->flex()) {
-      for (Frame* child : children_)
-        computeLayout(child);
-    }
+    hitTestChanged();
+    invalidateLayout();
 
     on_resize_.callback();
     if (parent_)
       parent_->on_child_bounds_changed_.callback(this);
-    redraw();
+
+    if (resized || region_.backdropEffect())
+      redraw();
+    else if (region_.needsLayer() && !redrawing_) {
+      requestDisplayListReplay();
+      layer_moved_ = redrawing_;
+    }
+    else
+      requestDisplayListReplay();
   }
 
   void Frame::setNativeBounds(IBounds native_bounds) {
@@ -198,6 +371,27 @@ namespace visage {
     return layout_->boundingBox();
   }
 
+  void Frame::invalidateLayout() {
+    if (deferredLayout()) {
+      if (!layout_dirty_) {
+        layout_dirty_ = true;
+        event_handler_->request_layout(this);
+      }
+      return;
+    }
+
+    layoutChildren();
+  }
+
+  void Frame::layoutChildren() {
+    layout_dirty_ = false;
+    computeLayout();
+    if (layout_ == nullptr || !layout_->flex()) {
+      for (Frame* child : children_)
+        computeLayout(child);
+    }
+  }
+
   void Frame::computeLayout() {
     if (nativeWidth() && nativeHeight() && layout_.get() && layout_->flex()) {
       std::vector<const Layout*> children_layouts;
@@ -266,6 +460,48 @@ namespace visage {
     return global_position;
   }
 
+  void Frame::releaseSnapshot() {
+    if (!snapshot_)
+      return;
+
+    snapshot_ = false;
+    snapshot_taken_ = false;
+    region_.setComposite(1.0f, 1.0f);
+    // Held frames, this one included, may still be marked as redrawing, so the editor is asked
+    // directly for a pass that draws them.
+    display_list_stale_ = true;
+    if (isVisible() && isDrawing())
+      redrawing_ = requestRedraw();
+  }
+
+  bool Frame::isFrozenBySnapshot() const {
+    if (snapshot_taken_)
+      return true;
+
+    for (const Frame* frame = parent_; frame; frame = frame->parent_) {
+      if (frame->snapshot_)
+        return true;
+    }
+    return false;
+  }
+
+  bool Frame::isOnScreen() const {
+    if (nativeWidth() <= 0 || nativeHeight() <= 0)
+      return true;
+
+    IBounds visible = native_bounds_;
+    for (const Frame* frame = parent_; frame; frame = frame->parent_) {
+      visible = visible.intersection(frame->nativeLocalBounds());
+      if (visible.width() <= 0 || visible.height() <= 0)
+        return false;
+      if (frame->cached_ || frame->auto_cached_)
+        return true;
+
+      visible = visible + IPoint(frame->nativeX(), frame->nativeY());
+    }
+    return true;
+  }
+
   Bounds Frame::relativeBounds(const Frame* other) const {
     Point position = positionInWindow();
     Point other_position = other->positionInWindow();
@@ -290,38 +526,39 @@ namespace visage {
     return false;
   }
 
-  bool Frame::focusNextTextReceiver(const Frame* starting_child) const {
-    int index = indexOfChild(starting_child);
-    for (int i = index + 1; i < children_.size(); ++i) {
-      if (children_[i]->tryFocusTextReceiver())
-        return true;
-    }
+  const FrameFocusOrder& Frame::focusOrder() const {
+    if (focus_order_ == nullptr)
+      focus_order_ = std::make_unique<FrameFocusOrder>();
+    if (focus_order_->generation() != focus_order_generation_ || !focus_order_->contains(this))
+      focus_order_->build(const_cast<Frame*>(this), focus_order_generation_);
+    return *focus_order_;
+  }
 
-    if (parent_ && parent_->focusNextTextReceiver(this))
-      return true;
+  bool Frame::moveTextFocus(const Frame* starting_child, bool forward) const {
+    const Frame* root = this;
+    while (root->parent_)
+      root = root->parent_;
 
-    for (int i = 0; i < index; ++i) {
-      if (children_[i]->tryFocusTextReceiver())
-        return true;
+    auto find = forward ? &FrameFocusOrder::next : &FrameFocusOrder::previous;
+    Frame* receiver = (root->focusOrder().*find)(this, starting_child);
+    if (receiver && !receiver->receivesTextInput()) {
+      focusOrderChanged();
+      receiver = (root->focusOrder().*find)(this, starting_child);
     }
-    return false;
-  }
 
-  bool Frame::focusPreviousTextReceiver(const Frame* starting_child) const {
-    int index = indexOfChild(starting_child);
-    for (int i = index - 1; i >= 0; --i) {
-      if (children_[i]->tryFocusTextReceiver())
-        return true;
-    }
+    if (receiver == nullptr)
+      return false;
 
-    if (parent_ && parent_->focusPreviousTextReceiver(this))
-      return true;
+    receiver->requestKeyboardFocus();
+    return true;
+  }
 
-    for (int i = children_.size() - 1; i > index; --i) {
-      if (children_[i]->tryFocusTextReceiver())
-        return true;
-    }
-    return false;
+  bool Frame::focusNextTextReceiver(const Frame* starting_child) const {
+    return moveTextFocus(starting_child, true);
+  }
+
+  bool Frame::focusPreviousTextReceiver(const Frame* starting_child) const {
+    return moveTextFocus(starting_child, false);
   }
 
   void Frame::setDpiScale(float dpi_scale) {
@@ -345,8 +582,19 @@ namespace visage {
       return;
 
     initialized_ = true;
-    for (Frame* child : children_)
-      child->init();
+    for (Frame* child : children_) {
+      if (!child->initDeferred())
+        child->init();
+    }
+  }
+
+  void Frame::initialize() {
+    if (initialized_ || parent_ == nullptr)
+      return;
+
+    parent_->initialize();
+    if (!initialized_ && parent_->initialized_)
+      init();
   }
 
   void Frame::drawToRegion(Canvas& canvas) {
@@ -354,21 +602,36 @@ namespace visage {
       return;
 
     redrawing_ = false;
-    region_.invalidate();
+    if (!layer_moved_)
+      region_.invalidate();
+    layer_moved_ = false;
     region_.setNeedsLayer(requiresLayer());
+    region_.setStencilClip(hasStencilClip());
+    snapshot_taken_ = snapshot_;
     if (width() <= 0 || height() <= 0) {
       region_.clear();
+      display_list_stale_ = true;
       return;
     }
 
+    if (!display_list_stale_)
+      return;
+
+    VISAGE_TRACE_SCOPE("Frame::drawToRegion", name_);
+    display_list_stale_ = false;
+    draw_count_++;
     canvas.beginRegion(&region_);
+    if (clip_path_.numPoints() > 0)
+      canvas.stencilClipPath(clip_path_);
+    else if (clip_rounding_ > 0.0f)
+      canvas.stencilClipRoundedRectangle(0, 0, width(), height(), clip_rounding_);
 
     if (!palette_override_.isDefault())
       canvas.setPaletteOverride(palette_override_);
     if (palette_)
       canvas.setPalette(palette_);
 
-    on_draw_.callback(canvas);
+    dispatch(on_draw_, &Frame::draw, canvas);
     if (alpha_transparency_ != 1.0f) {
       canvas.setBlendMode(BlendMode::Mult);
       canvas.setColor(Color(0xffffffff).withAlpha(alpha_transparency_));
@@ -387,7 +650,16 @@ namespace visage {
     child->parent_ = nullptr;
     child->event_handler_ = nullptr;
     region_.removeRegion(child->region());
-    children_.erase(std::find(children_.begin(), children_.end(), child));
+
+    // Children stay in draw order, so only the ones after the removed child shift down.
+    int index = child->child_index_;
+    VISAGE_ASSERT(index >= 0 && index < children_.size() && children_[index] == child);
+    children_.erase(children_.begin() + index);
+    for (int i = index; i < children_.size(); ++i)
+      children_[i]->child_index_ = i;
+    child->child_index_ = -1;
+    childrenHitTestChanged();
+    focusOrderChanged();
   }
 
   void Frame::setPostEffect(PostEffect* post_effect) {
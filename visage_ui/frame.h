@@ -30,6 +30,7 @@
 #include "visage_utils/space.h"
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace visage {
@@ -39,6 +40,8 @@ namespace visage {
     std::function<void(Frame*)> request_redraw = nullptr;
     std::function<void(Frame*)> request_keyboard_focus = nullptr;
     std::function<void(Frame*)> remove_from_hierarchy = nullptr;
+    // When set, child layouts are resolved later in one top-down pass instead of inside setBounds.
+    std::function<void(Frame*)> request_layout = nullptr;
     std::function<void(bool)> set_mouse_relative_mode = nullptr;
     std::function<void(MouseCursor)> set_cursor_style = nullptr;
     std::function<void(bool)> set_cursor_visible = nullptr;
@@ -46,6 +49,48 @@ namespace visage {
     std::function<void(std::string)> set_clipboard_text = nullptr;
   };
 
+  // Uniform grid over a frame's visible children so hit tests only check children near the point.
+  class FrameHitTestGrid {
+  public:
+    static constexpr int kMaxDimension = 64;
+
+    void build(const std::vector<Frame*>& children);
+    const std::vector<int>* candidates(Point point) const;
+
+  private:
+    int column(float x) const;
+    int row(float y) const;
+
+    Bounds area_;
+    int columns_ = 0;
+    int rows_ = 0;
+    float cell_width_ = 1.0f;
+    float cell_height_ = 1.0f;
+    std::vector<std::vector<int>> cells_;
+  };
+
+  // Flattened tab traversal of a frame tree so moving keyboard focus doesn't walk the hierarchy.
+  class FrameFocusOrder {
+  public:
+    void build(Frame* root, uint64_t generation);
+    uint64_t generation() const { return generation_; }
+    bool contains(const Frame* frame) const { return positions_.count(frame); }
+    Frame* next(const Frame* frame, const Frame* starting_child) const;
+    Frame* previous(const Frame* frame, const Frame* starting_child) const;
+    int numTextReceivers() const { return receivers_.size(); }
+
+  private:
+    void add(Frame* frame, bool traversable);
+    std::pair<int, int> excludedRange(const Frame* frame, const Frame* starting_child) const;
+
+    uint64_t generation_ = 0;
+    std::vector<Frame*> frames_;
+    std::vector<int> subtree_ends_;
+    std::vector<int> receivers_;
+    std::vector<int> first_receiver_at_;
+    std::unordered_map<const Frame*, int> positions_;
+  };
+
   class Frame {
   public:
     Frame() = default;
@@ -131,9 +176,16 @@ namespace visage {
     theme::OverrideId paletteOverride() const { return palette_override_; }
 
     bool initialized() const { return initialized_; }
+    // A lazily initialized frame that's hidden when its parent initializes skips init() until
+    // it's first shown, so hidden pages don't pay for setup they may never need.
+    void setLazyInit(bool lazy) { lazy_init_ = lazy; }
+    bool lazyInit() const { return lazy_init_; }
+    // Initializes this frame early, along with any lazily initialized ancestors, once the top
+    // level frame has been initialized.
+    void initialize();
     void redraw() {
-      if (isVisible() && isDrawing() && !redrawing_)
-        redrawing_ = requestRedraw();
+      display_list_stale_ = true;
+      requestDisplayListReplay();
     }
 
     void redrawAll() {
@@ -142,6 +194,14 @@ namespace visage {
         child->redrawAll();
     }
 
+    // Re-renders the recorded drawing without calling draw(). Enough after editing palette
+    // colors in place, since theme colors set through the canvas read their palette slot live.
+    void replayAll() {
+      requestDisplayListReplay();
+      for (Frame* child : children_)
+        child->replayAll();
+    }
+
     Region* region() { return &region_; }
 
     void setPostEffect(PostEffect* post_effect);
@@ -185,11 +245,61 @@ namespace visage {
       redraw();
     }
 
+    // Set by LayerCachePolicy, which moves expensive frames that rarely change into a layer.
+    void setAutoCached(bool auto_cached) {
+      if (auto_cached_ == auto_cached)
+        return;
+
+      auto_cached_ = auto_cached;
+      redraw();
+    }
+    bool isAutoCached() const { return auto_cached_; }
+    // Number of times draw() ran since the last resetDrawCount().
+    int drawCount() const { return draw_count_; }
+    void resetDrawCount() { draw_count_ = 0; }
+
+    // Freezes the frame and its children into a layer that's rendered once, so transitions can
+    // slide it with setBounds and fade or scale it with setSnapshotAlpha and setSnapshotScale
+    // without calling draw(). Redraws requested in the meantime wait for releaseSnapshot().
+    void snapshot() {
+      if (snapshot_)
+        return;
+
+      snapshot_ = true;
+      snapshot_taken_ = false;
+      redraw();
+    }
+    void releaseSnapshot();
+    bool isSnapshot() const { return snapshot_; }
+    void setSnapshotAlpha(float alpha) { region_.setComposite(alpha, region_.compositeScale()); }
+    void setSnapshotScale(float scale) { region_.setComposite(region_.compositeAlpha(), scale); }
+    // True while a snapshot of this frame or an ancestor holds its drawing.
+    bool isFrozenBySnapshot() const;
+
     void setMasked(bool masked) {
       masked_ = masked;
       redraw();
     }
 
+    // Clips the frame and its children to a rounded rectangle or a path through the stencil
+    // buffer of the layer they draw into. Unlike setMasked this needs no layer of its own, but
+    // the clip edge isn't antialiased.
+    void setClipRounding(float rounding) {
+      clip_rounding_ = rounding;
+      redraw();
+    }
+    float clipRounding() const { return clip_rounding_; }
+    void setClipPath(Path path) {
+      clip_path_ = std::move(path);
+      redraw();
+    }
+    void clearClip() {
+      clip_rounding_ = 0.0f;
+      clip_path_ = Path();
+      redraw();
+    }
+    bool hasStencilClip() const { return clip_rounding_ > 0.0f || clip_path_.numPoints() > 0; }
+
     const std::string& name() const { return name_; }
     void setName(std::string name) { name_ = std::move(name); }
 
@@ -199,6 +309,9 @@ namespace visage {
     bool isDrawing() const { return drawing_; }
     void setOnTop(bool on_top);
     bool isOnTop() const { return on_top_; }
+    // Promise that draw() covers every pixel of the bounds so frames beneath don't draw there.
+    void setOpaque(bool opaque) { region_.setOpaque(opaque); }
+    bool isOpaque() const { return region_.isOpaque(); }
 
     void addChild(Frame* child, bool make_visible = true);
     void addChild(Frame& child, bool make_visible = true) { addChild(&child, make_visible); }
@@ -217,7 +330,13 @@ namespace visage {
     const std::vector<Frame*>& children() const { return children_; }
 
     void setEventHandler(FrameEventHandler* handler) {
+      bool relayout = layout_dirty_ && handler != event_handler_;
       event_handler_ = handler;
+      if (relayout) {
+        layout_dirty_ = false;
+        if (handler)
+          invalidateLayout();
+      }
       for (Frame* child : children_)
         child->setEventHandler(handler);
     }
@@ -239,6 +358,14 @@ namespace visage {
 
     bool containsPoint(Point point) const { return bounds_.contains(point); }
     Frame* frameAtPoint(Point point);
+    // Indexes children spatially for frameAtPoint. Worth it for containers with many children.
+    void setHitTestIndex(bool enabled) {
+      hit_test_grid_ = enabled ? std::make_unique<FrameHitTestGrid>() : nullptr;
+      hit_test_grid_dirty_ = true;
+    }
+    bool hitTestIndex() const { return hit_test_grid_ != nullptr; }
+    // Bumped on any change that can alter what frameAtPoint returns, so callers can memoize it.
+    static uint64_t hitTestGeneration() { return hit_test_generation_; }
     Frame* topParentFrame();
 
     void setBounds(Bounds bounds);
@@ -252,6 +379,12 @@ namespace visage {
     IBounds computeLayoutBoundingBox(IBounds bounds) const;
     void computeLayout();
     void computeLayout(Frame* child);
+    void invalidateLayout();
+    bool layoutDirty() const { return layout_dirty_; }
+    void resolveLayout() {
+      if (layout_dirty_)
+        layoutChildren();
+    }
     const Bounds& bounds() const { return bounds_; }
     void setTopLeft(float x, float y) { setBounds(x, y, width(), height()); }
     Point topLeft() const { return { bounds_.x(), bounds_.y() }; }
@@ -283,6 +416,9 @@ namespace visage {
     Bounds localBounds() const { return { 0.0f, 0.0f, width(), height() }; }
     IBounds nativeLocalBounds() const { return { 0, 0, nativeWidth(), nativeHeight() }; }
     Point positionInWindow() const;
+    // False when the frame lies entirely outside the bounds of its ancestors, like a row scrolled
+    // out of view. Cached ancestors draw their whole layer, so clipping stops at them.
+    bool isOnScreen() const;
     Bounds relativeBounds(const Frame* other) const;
 
     bool acceptsKeystrokes() const { return accepts_keystrokes_; }
@@ -294,9 +430,21 @@ namespace visage {
     void setIgnoresMouseEvents(bool ignore, bool pass_to_children) {
       ignores_mouse_events_ = ignore;
       pass_mouse_events_to_children_ = pass_to_children;
+      hitTestChanged();
     }
 
     bool hasKeyboardFocus() const { return keyboard_focus_; }
+    // Siblings are tabbed through in ascending tab order, ties keep their child order.
+    void setTabOrder(int tab_order) {
+      if (tab_order_ == tab_order)
+        return;
+
+      tab_order_ = tab_order;
+      focusOrderChanged();
+    }
+    int tabOrder() const { return tab_order_; }
+    // Call when receivesTextInput() changes its answer so cached tab traversal is rebuilt.
+    static void focusOrderChanged() { focus_order_generation_++; }
     bool tryFocusTextReceiver();
     bool focusNextTextReceiver(const Frame* starting_child = nullptr) const;
     bool focusPreviousTextReceiver(const Frame* starting_child = nullptr) const;
@@ -307,6 +455,19 @@ namespace visage {
 
     float dpiScale() const { return dpi_scale_; }
 
+    // Bookkeeping for the event handler's redraw queue so queueing and removal don't search it.
+    int redrawQueueIndex() const { return redraw_queue_index_; }
+    void setRedrawQueueIndex(int index) { redraw_queue_index_ = index; }
+    uint64_t redrawGeneration() const { return redraw_generation_; }
+    void setRedrawGeneration(uint64_t generation) { redraw_generation_ = generation; }
+    long long lastRedrawTime() const { return last_redraw_time_; }
+    void setLastRedrawTime(long long microseconds) { last_redraw_time_ = microseconds; }
+
+    // Caps how often the editor draws this frame, in redraws per second. Redraw requests inside
+    // the interval are coalesced and drawn at the next allowed time. 0 removes the cap.
+    void setMaxRedrawRate(float hz) { max_redraw_rate_ = std::max(0.0f, hz); }
+    float maxRedrawRate() const { return max_redraw_rate_; }
+
     bool requestRedraw() {
       if (event_handler_ && event_handler_->request_redraw) {
         event_handler_->request_redraw(this);
@@ -360,14 +521,18 @@ namespace visage {
     void processMouseUp(const MouseEvent& e) { propagateMouseEvent(e, &Frame::onMouseUp); }
     void processMouseMove(const MouseEvent& e) { propagateMouseEvent(e, &Frame::onMouseMove); }
     void processMouseDrag(const MouseEvent& e) { propagateMouseEvent(e, &Frame::onMouseDrag); }
-    bool processMouseWheel(const MouseEvent& e) { return on_mouse_wheel_.callback(e); }
+    bool processMouseWheel(const MouseEvent& e) {
+      return dispatch(on_mouse_wheel_, &Frame::mouseWheel, e);
+    }
     void processFocusChanged(bool is_focused, bool was_clicked) {
       keyboard_focus_ = is_focused && accepts_keystrokes_;
       focusChanged(is_focused, was_clicked);
     }
 
-    bool processKeyPress(const KeyEvent& e) { return on_key_press_.callback(e); }
-    bool processKeyRelease(const KeyEvent& e) { return on_key_release_.callback(e); }
+    bool processKeyPress(const KeyEvent& e) { return dispatch(on_key_press_, &Frame::keyPress, e); }
+    bool processKeyRelease(const KeyEvent& e) {
+      return dispatch(on_key_release_, &Frame::keyRelease, e);
+    }
     void processTextInput(const std::string& text) { textInput(text); }
 
     float paletteValue(theme::ValueId value_id) const;
@@ -380,6 +545,27 @@ namespace visage {
     bool canRedo() const;
 
   private:
+    bool deferredLayout() const { return event_handler_ && event_handler_->request_layout; }
+    void layoutChildren();
+    const FrameFocusOrder& focusOrder() const;
+    bool moveTextFocus(const Frame* starting_child, bool forward) const;
+
+    void hitTestChanged() const {
+      hit_test_generation_++;
+      if (parent_)
+        parent_->hit_test_grid_dirty_ = true;
+    }
+    void childrenHitTestChanged() {
+      hit_test_generation_++;
+      hit_test_grid_dirty_ = true;
+    }
+
+    void requestDisplayListReplay() {
+      layer_moved_ = false;
+      if (isVisible() && isDrawing() && !redrawing_)
+        redrawing_ = requestRedraw();
+    }
+
     void propagateMouseEvent(const MouseEvent& e, void (Frame::*handler)(const MouseEvent&)) {
       (this->*handler)(e);
       auto frame = parent_;
@@ -390,12 +576,20 @@ namespace visage {
       }
     }
 
-    void onMouseEnter(const MouseEvent& e) { on_mouse_enter_.callback(e); }
-    void onMouseExit(const MouseEvent& e) { on_mouse_exit_.callback(e); }
-    void onMouseDown(const MouseEvent& e) { on_mouse_down_.callback(e); }
-    void onMouseUp(const MouseEvent& e) { on_mouse_up_.callback(e); }
-    void onMouseMove(const MouseEvent& e) { on_mouse_move_.callback(e); }
-    void onMouseDrag(const MouseEvent& e) { on_mouse_drag_.callback(e); }
+    template<typename R, typename... Params, typename... Args>
+    R dispatch(const CallbackList<R(Params...)>& list, R (Frame::*method)(Params...),
+               Args&&... args) {
+      if (list.usesOriginal())
+        return (this->*method)(std::forward<Args>(args)...);
+      return list.callback(std::forward<Args>(args)...);
+    }
+
+    void onMouseEnter(const MouseEvent& e) { dispatch(on_mouse_enter_, &Frame::mouseEnter, e); }
+    void onMouseExit(const MouseEvent& e) { dispatch(on_mouse_exit_, &Frame::mouseExit, e); }
+    void onMouseDown(const MouseEvent& e) { dispatch(on_mouse_down_, &Frame::mouseDown, e); }
+    void onMouseUp(const MouseEvent& e) { dispatch(on_mouse_up_, &Frame::mouseUp, e); }
+    void onMouseMove(const MouseEvent& e) { dispatch(on_mouse_move_, &Frame::mouseMove, e); }
+    void onMouseDrag(const MouseEvent& e) { dispatch(on_mouse_drag_, &Frame::mouseDrag, e); }
 
     void notifyHierarchyChanged() {
       for (Frame* child : children_)
@@ -406,9 +600,11 @@ namespace visage {
     void initChildren();
     void destroyChildren();
     void eraseChild(Frame* child);
+    bool initDeferred() const { return lazy_init_ && !visible_; }
 
     bool requiresLayer() const {
-      return post_effect_ || backdrop_effect_ || cached_ || masked_ || alpha_transparency_ != 1.0f;
+      return post_effect_ || backdrop_effect_ || cached_ || auto_cached_ || masked_ || snapshot_ ||
+             alpha_transparency_ != 1.0f;
     }
 
     std::string name_;
@@ -448,22 +644,45 @@ namespace visage {
     std::vector<Frame*> children_;
     std::map<Frame*, std::unique_ptr<Frame>> owned_children_;
     Frame* parent_ = nullptr;
+    int child_index_ = -1;
     FrameEventHandler* event_handler_ = nullptr;
 
     float dpi_scale_ = 1.0f;
     Palette* palette_ = nullptr;
     theme::OverrideId palette_override_;
     bool initialized_ = false;
+    bool lazy_init_ = false;
 
     PostEffect* post_effect_ = nullptr;
     std::unique_ptr<BlurPostEffect> blur_effect_;
     PostEffect* backdrop_effect_ = nullptr;
     bool cached_ = false;
+    bool snapshot_ = false;
+    bool snapshot_taken_ = false;
+    bool auto_cached_ = false;
+    int draw_count_ = 0;
     bool masked_ = false;
+    float clip_rounding_ = 0.0f;
+    Path clip_path_;
     float alpha_transparency_ = 1.0f;
     Region region_;
     std::unique_ptr<Layout> layout_;
     bool drawing_ = true;
     bool redrawing_ = false;
+    // Only moved while in its own layer, so the layer contents are still valid.
+    bool layer_moved_ = false;
+    bool display_list_stale_ = true;
+    bool layout_dirty_ = false;
+    int redraw_queue_index_ = -1;
+    uint64_t redraw_generation_ = 0;
+    long long last_redraw_time_ = 0;
+    float max_redraw_rate_ = 0.0f;
+    std::unique_ptr<FrameHitTestGrid> hit_test_grid_;
+    bool hit_test_grid_dirty_ = true;
+    int tab_order_ = 0;
+    mutable std::unique_ptr<FrameFocusOrder> focus_order_;
+
+    inline static uint64_t hit_test_generation_ = 0;
+    inline static uint64_t focus_order_generation_ = 0;
   };
 }
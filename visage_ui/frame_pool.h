@@ -0,0 +1,122 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace visage {
+  // Fixed size block allocator. Blocks are carved from chunks that live as long as the pool and
+  // freed blocks are reused first, so objects that are created and destroyed constantly stop
+  // going through the general heap. Not thread safe, frames live on the event thread.
+  class BlockPool {
+  public:
+    static constexpr int kBlocksPerChunk = 32;
+    static constexpr size_t kAlignment = alignof(std::max_align_t);
+
+    explicit BlockPool(size_t block_size) :
+        block_size_((std::max(block_size, sizeof(FreeBlock)) + kAlignment - 1) / kAlignment *
+                    kAlignment) { }
+
+    BlockPool(const BlockPool&) = delete;
+    BlockPool& operator=(const BlockPool&) = delete;
+
+    void* allocate() {
+      if (free_blocks_ == nullptr)
+        addChunk();
+
+      FreeBlock* block = free_blocks_;
+      free_blocks_ = block->next;
+      num_allocated_++;
+      return block;
+    }
+
+    void deallocate(void* memory) {
+      FreeBlock* block = static_cast<FreeBlock*>(memory);
+      block->next = free_blocks_;
+      free_blocks_ = block;
+      num_allocated_--;
+    }
+
+    size_t blockSize() const { return block_size_; }
+    int numAllocated() const { return num_allocated_; }
+    int numChunks() const { return chunks_.size(); }
+    int capacity() const { return chunks_.size() * kBlocksPerChunk; }
+
+  private:
+    struct FreeBlock {
+      FreeBlock* next;
+    };
+
+    void addChunk() {
+      chunks_.push_back(std::make_unique<unsigned char[]>(block_size_ * kBlocksPerChunk));
+      unsigned char* chunk = chunks_.back().get();
+      for (int i = kBlocksPerChunk - 1; i >= 0; --i) {
+        FreeBlock* block = reinterpret_cast<FreeBlock*>(chunk + i * block_size_);
+        block->next = free_blocks_;
+        free_blocks_ = block;
+      }
+    }
+
+    size_t block_size_ = 0;
+    FreeBlock* free_blocks_ = nullptr;
+    int num_allocated_ = 0;
+    std::vector<std::unique_ptr<unsigned char[]>> chunks_;
+  };
+
+  // Opt-in pooled allocation for a Frame subclass:
+  //   class MatrixRow : public Frame, public PooledFrame<MatrixRow> { ... };
+  // Frames deleted through a Frame pointer return to the pool because Frame's destructor is
+  // virtual. Subclasses of T with a different size fall back to the general heap.
+  template<typename T>
+  class PooledFrame {
+  public:
+    static void* operator new(size_t size) {
+      if (size != sizeof(T))
+        return ::operator new(size);
+      return pool().allocate();
+    }
+
+    static void operator delete(void* memory, size_t size) {
+      if (memory == nullptr)
+        return;
+
+      if (size != sizeof(T))
+        ::operator delete(memory);
+      else
+        pool().deallocate(memory);
+    }
+
+    // Never destroyed so frames released during static destruction still have a pool.
+    static BlockPool& pool() {
+      static BlockPool* pool = new BlockPool(sizeof(T));
+      return *pool;
+    }
+
+  protected:
+    PooledFrame() = default;
+    ~PooledFrame() = default;
+  };
+}
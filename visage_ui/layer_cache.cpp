@@ -0,0 +1,101 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "layer_cache.h"
+
+#include "frame.h"
+#include "visage_graphics/profiler.h"
+
+namespace visage {
+  static bool isCacheCandidate(const Frame* frame) {
+    return frame->isVisible() && frame->isDrawing();
+  }
+
+  void LayerCachePolicy::frameDrawn(Frame* root, FrameProfiler* profiler) {
+    if (++draws_ < evaluation_interval_)
+      return;
+
+    draws_ = 0;
+    evaluate(root, profiler);
+  }
+
+  const std::vector<LayerCachePolicy::Decision>& LayerCachePolicy::evaluate(Frame* root,
+                                                                          FrameProfiler* profiler) {
+    decisions_.clear();
+    stats_.clear();
+    gather(root);
+    cursor_ = 0;
+    decide(root, 0, profiler);
+    return decisions_;
+  }
+
+  void LayerCachePolicy::clear(Frame* root) {
+    root->setAutoCached(false);
+    for (Frame* child : root->children())
+      clear(child);
+  }
+
+  LayerCachePolicy::SubtreeStats LayerCachePolicy::gather(Frame* frame) {
+    int index = stats_.size();
+    stats_.emplace_back();
+
+    SubtreeStats stats = { frame->drawCount(), frame->region()->numShapes() };
+    for (Frame* child : frame->children()) {
+      if (isCacheCandidate(child)) {
+        SubtreeStats child_stats = gather(child);
+        stats.changes += child_stats.changes;
+        stats.shapes += child_stats.shapes;
+      }
+    }
+
+    stats_[index] = stats;
+    return stats;
+  }
+
+  void LayerCachePolicy::decide(Frame* frame, int exposures, FrameProfiler* profiler) {
+    SubtreeStats stats = stats_[cursor_++];
+
+    bool cached = frame->isAutoCached();
+    if (cached) {
+      bool changes_often = stats.changes > 0 && stats.changes * kDemoteRatio >= exposures;
+      cached = !changes_often && stats.shapes >= kMinShapes / 2;
+    }
+    else if (!frame->region()->needsLayer()) {
+      cached = stats.shapes >= kMinShapes && exposures >= kMinExposures &&
+               exposures >= kPromoteRatio * (stats.changes + 1);
+    }
+
+    if (cached != frame->isAutoCached()) {
+      frame->setAutoCached(cached);
+      decisions_.push_back({ frame, cached, exposures, stats.changes, stats.shapes });
+      if (profiler)
+        profiler->addCacheEvent({ frame->name(), cached, exposures, stats.changes, stats.shapes });
+    }
+
+    bool layered = cached || frame->region()->needsLayer();
+    int child_exposures = layered ? frame->drawCount() : exposures + frame->drawCount();
+    for (Frame* child : frame->children()) {
+      if (isCacheCandidate(child))
+        decide(child, child_exposures, profiler);
+    }
+    frame->resetDrawCount();
+  }
+}
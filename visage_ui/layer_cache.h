@@ -0,0 +1,75 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <vector>
+
+namespace visage {
+  class Frame;
+  class FrameProfiler;
+
+  // Moves frames whose subtree is expensive to draw but changes far less often than the frames
+  // above it into cached layers, and demotes them again once the subtree changes about as often
+  // as it gets re-rendered. Decisions are reported to the profiler as LayerCacheEvents.
+  class LayerCachePolicy {
+  public:
+    static constexpr int kDefaultEvaluationInterval = 120;
+    static constexpr int kMinShapes = 64;
+    static constexpr int kMinExposures = 8;
+    static constexpr int kPromoteRatio = 4;
+    static constexpr int kDemoteRatio = 2;
+
+    struct Decision {
+      Frame* frame = nullptr;
+      bool cached = false;
+      int exposures = 0;
+      int changes = 0;
+      int shapes = 0;
+    };
+
+    // Call once per drawn window frame, evaluates the tree every evaluationInterval() calls.
+    void frameDrawn(Frame* root, FrameProfiler* profiler = nullptr);
+    // Promotes and demotes frames under root using the draw counts since the last evaluation.
+    const std::vector<Decision>& evaluate(Frame* root, FrameProfiler* profiler = nullptr);
+    const std::vector<Decision>& decisions() const { return decisions_; }
+
+    void setEvaluationInterval(int draws) { evaluation_interval_ = draws > 0 ? draws : 1; }
+    int evaluationInterval() const { return evaluation_interval_; }
+
+    static void clear(Frame* root);
+
+  private:
+    struct SubtreeStats {
+      int changes = 0;
+      int shapes = 0;
+    };
+
+    SubtreeStats gather(Frame* frame);
+    void decide(Frame* frame, int exposures, FrameProfiler* profiler);
+
+    std::vector<SubtreeStats> stats_;
+    std::vector<Decision> decisions_;
+    int cursor_ = 0;
+    int draws_ = 0;
+    int evaluation_interval_ = kDefaultEvaluationInterval;
+  };
+}
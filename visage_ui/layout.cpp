@@ -21,7 +21,40 @@
 
 #include "layout.h"
 
+#include <atomic>
+
 namespace visage {
+  uint64_t Layout::nextVersion() {
+    static std::atomic<uint64_t> version = 0;
+    return ++version;
+  }
+
+  bool Layout::cachedFor(const std::vector<const Layout*>& children, const IBounds& bounds,
+                         float dpi_scale) const {
+    if (cached_version_ != version_ || cached_bounds_ != bounds || cached_dpi_scale_ != dpi_scale ||
+        cached_children_.size() != children.size()) {
+      return false;
+    }
+
+    for (int i = 0; i < children.size(); ++i) {
+      if (cached_children_[i].first != children[i] || cached_children_[i].second != children[i]->version())
+        return false;
+    }
+    return true;
+  }
+
+  void Layout::cacheResults(const std::vector<const Layout*>& children, const IBounds& bounds,
+                            float dpi_scale, const std::vector<IBounds>& results) {
+    cached_version_ = version_;
+    cached_bounds_ = bounds;
+    cached_dpi_scale_ = dpi_scale;
+    cached_children_.clear();
+    for (const Layout* child : children)
+      cached_children_.emplace_back(child, child->version());
+    cached_positions_ = results;
+    cached_bounding_box_ = bounding_box_;
+  }
+
   std::vector<IBounds> Layout::flexChildGroup(const std::vector<const Layout*>& children, IBounds bounds,
                                               float dpi_scale, IBounds& bounding_box) const {
     int width = bounds.width();
@@ -47,8 +47,14 @@ namespace visage {
       SpaceEvenly
     };
 
+    // Results are cached until the bounds, dpi, this layout or any child layout changes.
     std::vector<IBounds> flexPositions(const std::vector<const Layout*>& children,
                                        const IBounds& bounds, float dpi_scale) {
+      if (cachedFor(children, bounds, dpi_scale)) {
+        bounding_box_ = cached_bounding_box_;
+        return cached_positions_;
+      }
+
       int pad_left = padding_before_[0].computeInt(dpi_scale, bounds.width(), bounds.height());
       int pad_right = padding_after_[0].computeInt(dpi_scale, bounds.width(), bounds.height());
       int pad_top = padding_before_[1].computeInt(dpi_scale, bounds.width(), bounds.height());
@@ -69,10 +75,15 @@ namespace visage {
       bounding_box_.setY(bounding_box_.y() - pad_top);
       bounding_box_.setWidth(bounding_box_.width() + pad_left + pad_right);
       bounding_box_.setHeight(bounding_box_.height() + pad_top + pad_bottom);
+      cacheResults(children, bounds, dpi_scale, results);
       return results;
     }
 
-    void setFlex(bool flex) { flex_ = flex; }
+    uint64_t version() const { return version_; }
+    // Custom Dimension functions that read outside state should call this when that state changes.
+    void invalidate() { version_ = nextVersion(); }
+
+    void setFlex(bool flex) { flex_ = flex; invalidate(); }
     bool flex() const { return flex_; }
 
     void setMargin(const Dimension& margin) {
@@ -80,12 +91,13 @@ namespace visage {
       margin_before_[1] = margin;
       margin_after_[0] = margin;
       margin_after_[1] = margin;
+      invalidate();
     }
 
-    void setMarginLeft(const Dimension& margin) { margin_before_[0] = margin; }
-    void setMarginRight(const Dimension& margin) { margin_after_[0] = margin; }
-    void setMarginTop(const Dimension& margin) { margin_before_[1] = margin; }
-    void setMarginBottom(const Dimension& margin) { margin_after_[1] = margin; }
+    void setMarginLeft(const Dimension& margin) { margin_before_[0] = margin; invalidate(); }
+    void setMarginRight(const Dimension& margin) { margin_after_[0] = margin; invalidate(); }
+    void setMarginTop(const Dimension& margin) { margin_before_[1] = margin; invalidate(); }
+    void setMarginBottom(const Dimension& margin) { margin_after_[1] = margin; invalidate(); }
     const Dimension& marginLeft() { return margin_before_[0]; }
     const Dimension& marginRight() { return margin_after_[0]; }
     const Dimension& marginTop() { return margin_before_[1]; }
@@ -96,12 +108,13 @@ namespace visage {
       padding_before_[1] = padding;
       padding_after_[0] = padding;
       padding_after_[1] = padding;
+      invalidate();
     }
 
-    void setPaddingLeft(const Dimension& padding) { padding_before_[0] = padding; }
-    void setPaddingRight(const Dimension& padding) { padding_after_[0] = padding; }
-    void setPaddingTop(const Dimension& padding) { padding_before_[1] = padding; }
-    void setPaddingBottom(const Dimension& padding) { padding_after_[1] = padding; }
+    void setPaddingLeft(const Dimension& padding) { padding_before_[0] = padding; invalidate(); }
+    void setPaddingRight(const Dimension& padding) { padding_after_[0] = padding; invalidate(); }
+    void setPaddingTop(const Dimension& padding) { padding_before_[1] = padding; invalidate(); }
+    void setPaddingBottom(const Dimension& padding) { padding_after_[1] = padding; invalidate(); }
     const Dimension& paddingLeft() { return padding_before_[0]; }
     const Dimension& paddingRight() { return padding_after_[0]; }
     const Dimension& paddingTop() { return padding_before_[1]; }
@@ -110,26 +123,43 @@ namespace visage {
     void setDimensions(const Dimension& width, const Dimension& height) {
       dimensions_[0] = width;
       dimensions_[1] = height;
+      invalidate();
     }
 
-    void setWidth(const Dimension& width) { dimensions_[0] = width; }
-    void setHeight(const Dimension& height) { dimensions_[1] = height; }
+    void setWidth(const Dimension& width) { dimensions_[0] = width; invalidate(); }
+    void setHeight(const Dimension& height) { dimensions_[1] = height; invalidate(); }
     const Dimension& width() { return dimensions_[0]; }
     const Dimension& height() { return dimensions_[1]; }
 
-    void setFlexGrow(float grow) { flex_grow_ = grow; }
-    void setFlexShrink(float shrink) { flex_shrink_ = shrink; }
-    void setFlexRows(bool rows) { flex_rows_ = rows; }
-    void setFlexReverseDirection(bool reverse) { flex_reverse_direction_ = reverse; }
-    void setFlexWrap(bool wrap) { flex_wrap_ = wrap ? 1 : 0; }
-    void setFlexItemAlignment(ItemAlignment alignment) { item_alignment_ = alignment; }
-    void setFlexSelfAlignment(ItemAlignment alignment) { self_alignment_ = alignment; }
-    void setFlexWrapAlignment(WrapAlignment alignment) { wrap_alignment_ = alignment; }
-    void setFlexWrapReverse(bool wrap) { flex_wrap_ = wrap ? -1 : 0; }
-    void setFlexGap(Dimension gap) { flex_gap_ = std::move(gap); }
+    void setFlexGrow(float grow) { flex_grow_ = grow; invalidate(); }
+    void setFlexShrink(float shrink) { flex_shrink_ = shrink; invalidate(); }
+    void setFlexRows(bool rows) { flex_rows_ = rows; invalidate(); }
+    void setFlexReverseDirection(bool reverse) { flex_reverse_direction_ = reverse; invalidate(); }
+    void setFlexWrap(bool wrap) { flex_wrap_ = wrap ? 1 : 0; invalidate(); }
+    void setFlexItemAlignment(ItemAlignment alignment) {
+      item_alignment_ = alignment;
+      invalidate();
+    }
+    void setFlexSelfAlignment(ItemAlignment alignment) {
+      self_alignment_ = alignment;
+      invalidate();
+    }
+    void setFlexWrapAlignment(WrapAlignment alignment) {
+      wrap_alignment_ = alignment;
+      invalidate();
+    }
+    void setFlexWrapReverse(bool wrap) { flex_wrap_ = wrap ? -1 : 0; invalidate(); }
+    void setFlexGap(Dimension gap) { flex_gap_ = std::move(gap); invalidate(); }
     IBounds boundingBox() const { return bounding_box_; }
 
   private:
+    static uint64_t nextVersion();
+
+    bool cachedFor(const std::vector<const Layout*>& children, const IBounds& bounds,
+                   float dpi_scale) const;
+    void cacheResults(const std::vector<const Layout*>& children, const IBounds& bounds,
+                      float dpi_scale, const std::vector<IBounds>& results);
+
     std::vector<IBounds> flexChildGroup(const std::vector<const Layout*>& children, IBounds bounds,
                                         float dpi_scale, IBounds& bounding_box) const;
 
@@ -155,5 +185,13 @@ namespace visage {
     bool flex_reverse_direction_ = false;
     int flex_wrap_ = 0;
     Dimension flex_gap_;
+
+    uint64_t version_ = nextVersion();
+    uint64_t cached_version_ = 0;
+    IBounds cached_bounds_;
+    float cached_dpi_scale_ = 0.0f;
+    std::vector<std::pair<const Layout*, uint64_t>> cached_children_;
+    std::vector<IBounds> cached_positions_;
+    IBounds cached_bounding_box_;
   };
 }
\ No newline at end of file
@@ -0,0 +1,57 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "animation_scheduler.h"
+#include "frame.h"
+#include "visage_utils/value_mirror.h"
+
+namespace visage {
+  // Pulls a ValueMirror or MeterChannel once per draw callback and redraws the frame only when
+  // the audio thread published something new. It stays on the AnimationScheduler without a frame
+  // of its own so the scheduler keeps the draw callbacks coming but doesn't redraw every tick.
+  template<typename Mirror>
+  class MirrorWatcher : public ScheduledAnimation {
+  public:
+    MirrorWatcher(Frame* frame, Mirror* mirror) :
+        ScheduledAnimation(nullptr), frame_(frame), mirror_(mirror) {
+      VISAGE_ASSERT(frame && mirror);
+      schedule();
+    }
+
+    auto& onChange() { return on_change_; }
+    const auto& value() const { return mirror_->value(); }
+
+    bool step(long long ms) override {
+      if (mirror_->pull()) {
+        on_change_.callback();
+        frame_->redraw();
+      }
+      return true;
+    }
+
+  private:
+    Frame* frame_ = nullptr;
+    Mirror* mirror_ = nullptr;
+    CallbackList<void()> on_change_;
+  };
+}
@@ -38,22 +38,32 @@ namespace visage {
   VISAGE_THEME_VALUE(PopupFontSize, 14.0f);
   VISAGE_THEME_VALUE(PopupSelectionPadding, 4.0f);
 
-  void PopupMenu::show(Frame* source, Point position) {
-    std::unique_ptr<PopupMenuFrame> frame = std::make_unique<PopupMenuFrame>(*this);
+  void PopupMenu::show(Frame* source, Point position) const& {
+    PopupMenu(*this).show(source, position);
+  }
+
+  void PopupMenu::show(Frame* source, Point position) && {
+    std::unique_ptr<PopupMenuFrame> frame = std::make_unique<PopupMenuFrame>(std::move(*this));
     PopupMenuFrame* frame_ptr = frame.get();
     frame_ptr->show(std::move(frame), source, position);
   }
 
+  std::unique_ptr<PopupMenuFrame> PopupMenu::prepare(Frame* source) const {
+    std::unique_ptr<PopupMenuFrame> frame = std::make_unique<PopupMenuFrame>(*this);
+    frame->prepare(source);
+    return frame;
+  }
+
   float PopupList::renderHeight() const {
     float popup_height = paletteValue(PopupOptionHeight);
     float selection_padding = paletteValue(PopupSelectionPadding);
-    return options_.size() * popup_height + 2.0f * selection_padding;
+    return numOptions() * popup_height + 2.0f * selection_padding;
   }
 
   float PopupList::renderWidth() const {
     float width = paletteValue(PopupMinWidth);
     float x_padding = paletteValue(PopupSelectionPadding) + paletteValue(PopupTextPadding);
-    for (const PopupMenu& option : options_) {
+    for (const PopupMenu& option : *options_) {
       float string_width = font_.stringWidth(option.name().c_str(), option.name().size()) + 2 * x_padding;
       width = std::max(width, string_width);
     }
@@ -66,15 +76,15 @@ namespace visage {
   }
 
   void PopupList::selectHoveredIndex() {
-    if (hover_index_ >= 0 && hover_index_ < options_.size()) {
-      if (options_[hover_index_].hasOptions()) {
+    if (hover_index_ >= 0 && hover_index_ < numOptions()) {
+      if (option(hover_index_).hasOptions()) {
         for (Listener* listener : listeners_)
-          listener->subMenuSelected(options_[hover_index_], yForIndex(hover_index_), this);
+          listener->subMenuSelected(option(hover_index_), yForIndex(hover_index_), this);
         menu_open_index_ = hover_index_;
       }
       else {
         for (Listener* listener : listeners_)
-          listener->optionSelected(options_[hover_index_], this);
+          listener->optionSelected(option(hover_index_), this);
       }
     }
   }
@@ -83,8 +93,8 @@ namespace visage {
     int y = paletteValue(PopupSelectionPadding);
 
     int option_height = paletteValue(PopupOptionHeight);
-    for (int i = 0; i < options_.size(); ++i) {
-      if (!options_[i].isBreak() && options_[i].enabled() && position.y >= y &&
+    for (int i = 0; i < numOptions(); ++i) {
+      if (!option(i).isBreak() && option(i).enabled() && position.y >= y &&
           position.y < y + option_height) {
         hover_index_ = i;
         return;
@@ -120,9 +130,9 @@ namespace visage {
     Brush text = canvas.color(PopupMenuText).withMultipliedAlpha(opacity_);
     Brush disabled_text = canvas.color(PopupMenuDisabledText).withMultipliedAlpha(opacity_);
     Brush selected_text = canvas.color(PopupMenuSelectionText).withMultipliedAlpha(opacity_);
-    for (int i = 0; i < options_.size(); ++i) {
+    for (int i = 0; i < numOptions(); ++i) {
       if (y + option_height > 0 && y < height()) {
-        if (options_[i].isBreak())
+        if (option(i).isBreak())
           canvas.rectangle(x_padding, y + option_height / 2, width() - 2 * x_padding, 1);
         else {
           if (i == hover_index_) {
@@ -132,16 +142,16 @@ namespace visage {
                                     option_height, 4.0f);
             canvas.setColor(selected_text);
           }
-          else if (options_[i].enabled())
+          else if (option(i).enabled())
             canvas.setColor(text);
           else
             canvas.setColor(disabled_text);
 
           int popup_font_size = paletteValue(PopupFontSize);
           Font font = font_.withSize(popup_font_size);
-          canvas.text(options_[i].name(), font, Font::kLeft, x_padding, y, width(), option_height);
+          canvas.text(option(i).name(), font, Font::kLeft, x_padding, y, width(), option_height);
 
-          if (options_[i].hasOptions()) {
+          if (option(i).hasOptions()) {
             int triangle_width = popup_font_size * kTriangleWidthRatio;
             int triangle_x = width() - x_padding - triangle_width;
             int triangle_y = y + option_height / 2 - triangle_width;
@@ -165,7 +175,7 @@ namespace visage {
 
     setHoverFromPosition(e.relativeTo(this).position + Point(0, yPosition()));
 
-    if (hover_index_ < options_.size() && hover_index_ >= 0 && options_[hover_index_].hasOptions())
+    if (hover_index_ < numOptions() && hover_index_ >= 0 && option(hover_index_).hasOptions())
       selectHoveredIndex();
 
     redraw();
@@ -236,6 +246,9 @@ namespace visage {
   PopupMenuFrame::~PopupMenuFrame() = default;
 
   void PopupMenuFrame::draw(Canvas& canvas) {
+    if (!isShowing())
+      return;
+
     float opacity = opacity_animation_.update();
     for (auto& list : lists_)
       list.setOpacity(opacity);
@@ -249,19 +262,52 @@ namespace visage {
   void PopupMenuFrame::show(std::unique_ptr<PopupMenuFrame> self, Frame* source, Point point) {
     parent_ = source->topParentFrame();
     parent_->addChild(std::move(self));
+    open(source, point);
+  }
+
+  void PopupMenuFrame::prepare(Frame* source) {
+    prepared_ = true;
+    parent_ = source->topParentFrame();
+    parent_->addChild(this);
 
+    setOnTop(true);
+    setBounds(parent_->bounds());
+    font_ = font_.withSize(paletteValue(PopupFontSize));
+    setListFonts(font_);
+
+    lists_[0].setMenu(menu_);
+    int h = std::min(height(), lists_[0].renderHeight());
+    lists_[0].setBounds(0, 0, lists_[0].renderWidth(), h);
+    lists_[0].setVisible(true);
+    rest();
+  }
+
+  void PopupMenuFrame::show(Frame* source, Point point) {
+    VISAGE_ASSERT(prepared_ && parent_ == source->topParentFrame());
+    showing_ = true;
+    done_ = false;
+    lists_[0].setIgnoresMouseEvents(false, false);
+    lists_[0].setSnapshotAlpha(1.0f);
+    open(source, point);
+  }
+
+  void PopupMenuFrame::open(Frame* source, Point point) {
     setOnTop(true);
     setBounds(parent_->bounds());
 
     for (int i = 1; i < kMaxSubMenus; ++i)
       lists_[i].setVisible(false);
 
-    font_ = font_.withSize(paletteValue(PopupFontSize));
-    setListFonts(font_);
+    int h = lists_[0].height();
+    int w = lists_[0].width();
+    if (!prepared_) {
+      font_ = font_.withSize(paletteValue(PopupFontSize));
+      setListFonts(font_);
 
-    lists_[0].setOptions(menu_.options());
-    int h = std::min(height(), lists_[0].renderHeight());
-    int w = lists_[0].renderWidth();
+      lists_[0].setMenu(menu_);
+      h = std::min(height(), lists_[0].renderHeight());
+      w = lists_[0].renderWidth();
+    }
 
     Bounds window_bounds = parent_->relativeBounds(source);
     int x = point.x == PopupMenu::kNotSet ? window_bounds.x() : window_bounds.x() + point.x;
@@ -282,7 +328,8 @@ namespace visage {
 
     lists_[0].setBounds(x, y, w, h);
     lists_[0].setVisible(true);
-    lists_[0].redraw();
+    if (!prepared_)
+      lists_[0].redraw();
     opacity_animation_.target(true, true);
 
     stopTimer();
@@ -299,13 +346,36 @@ namespace visage {
     startTimer(1);
   }
 
+  // A closed prepared menu keeps its first list visible but transparent and ignoring the mouse, so
+  // it's drawn into its snapshot while idle and the next show doesn't have to.
+  void PopupMenuFrame::rest() {
+    stopTimer();
+    done_ = false;
+    showing_ = false;
+    hover_list_ = nullptr;
+    hover_index_ = -1;
+    for (int i = 1; i < kMaxSubMenus; ++i)
+      lists_[i].setVisible(false);
+
+    for (auto& list : lists_) {
+      list.resetOpenMenu();
+      list.setNoHover();
+      list.setOpacity(1.0f);
+    }
+
+    lists_[0].setIgnoresMouseEvents(true, false);
+    lists_[0].releaseSnapshot();
+    lists_[0].snapshot();
+    lists_[0].setSnapshotAlpha(0.0f);
+  }
+
   void PopupMenuFrame::hierarchyChanged() {
     if (parent() == nullptr)
       startTimer(1);
   }
 
   void PopupMenuFrame::focusChanged(bool is_focused, bool was_clicked) {
-    if (!is_focused && isVisible()) {
+    if (!is_focused && isVisible() && isShowing()) {
       startTimer(1);
       opacity_animation_.target(false);
     }
@@ -315,12 +385,19 @@ namespace visage {
 
   void PopupMenuFrame::timerCallback() {
     if (parent_ && done_) {
-      parent_->removeChild(this);
+      if (prepared_)
+        rest();
+      else
+        parent_->removeChild(this);
       return;
     }
 
     redraw();
     stopTimer();
+    if (!isShowing())
+      return;
+
+    lists_[0].releaseSnapshot();
 
     for (auto& list : lists_)
       list.enableMouseUp(true);
@@ -364,7 +441,7 @@ namespace visage {
 
     lists_[source_index].setOpenMenu(lists_[source_index].hoverIndex());
     if (source_index < kMaxSubMenus - 1) {
-      lists_[source_index + 1].setOptions(option.options());
+      lists_[source_index + 1].setMenu(option);
       int h = lists_[source_index + 1].renderHeight();
       int w = lists_[source_index + 1].renderWidth();
       int y = list->y() + selection_y;
@@ -30,6 +30,7 @@
 
 namespace visage {
   class PopupMenu;
+  class PopupMenuFrame;
 #if defined(__APPLE__) && defined(__MACH__)
   void setNativeMenuBar(const PopupMenu& menu);
 #else
@@ -39,12 +40,18 @@ namespace visage {
   class PopupMenu {
   public:
     static constexpr int kNotSet = INT_MIN;
+    using OptionsProvider = std::function<std::vector<PopupMenu>()>;
 
     PopupMenu() = default;
     PopupMenu(const String& name, int id = -1, std::vector<PopupMenu> options = {}, bool is_break = false) :
         name_(name), id_(id), is_break_(is_break), options_(std::move(options)) { }
 
-    void show(Frame* source, Point position = { kNotSet, kNotSet });
+    void show(Frame* source, Point position = { kNotSet, kNotSet }) const&;
+    void show(Frame* source, Point position = { kNotSet, kNotSet }) &&;
+    // Builds the menu's frame under source's top level frame and renders it while it's hidden, so
+    // showing the result only positions and reveals a layer that's already drawn. The frame can
+    // be shown any number of times and has to outlive every show.
+    std::unique_ptr<PopupMenuFrame> prepare(Frame* source) const;
     void setAsNativeMenuBar() { setNativeMenuBar(*this); }
 
     PopupMenu& addOption(int option_id, const String& option_name) {
@@ -82,15 +89,32 @@ namespace visage {
     const auto& onCancel() const { return on_cancel_; }
 
     void addSubMenu(PopupMenu sub_menu) { options_.push_back(std::move(sub_menu)); }
+    PopupMenu& addSubMenu(const String& name, OptionsProvider provider) {
+      options_.emplace_back(name);
+      options_.back().setOptionsProvider(std::move(provider));
+      return options_.back();
+    }
     void addBreak() { options_.push_back({ "", -1, {}, true }); }
 
-    const std::vector<PopupMenu>& options() const { return options_; }
-    int size() const { return options_.size(); }
+    void setOptionsProvider(OptionsProvider provider) {
+      options_provider_ = std::move(provider);
+      options_loaded_ = false;
+    }
+    bool optionsLoaded() const { return options_provider_ == nullptr || options_loaded_; }
+
+    const std::vector<PopupMenu>& options() const {
+      if (!optionsLoaded()) {
+        options_ = options_provider_();
+        options_loaded_ = true;
+      }
+      return options_;
+    }
+    int size() const { return options().size(); }
 
     int id() const { return id_; }
     const String& name() const { return name_; }
     bool isBreak() const { return is_break_; }
-    bool hasOptions() const { return !options_.empty(); }
+    bool hasOptions() const { return !options_.empty() || options_provider_ != nullptr; }
 
   private:
     CallbackList<void(int)> on_selection_;
@@ -103,7 +127,9 @@ namespace visage {
 
     int shortcut_modifiers_ = 0;
     std::string shortcut_character_;
-    std::vector<PopupMenu> options_;
+    OptionsProvider options_provider_;
+    mutable bool options_loaded_ = false;
+    mutable std::vector<PopupMenu> options_;
   };
 
   class PopupList : public ScrollableFrame {
@@ -120,7 +146,11 @@ namespace visage {
 
     PopupList() = default;
 
-    void setOptions(std::vector<PopupMenu> options) { options_ = std::move(options); }
+    void setOptions(std::vector<PopupMenu> options) {
+      owned_options_ = std::move(options);
+      options_ = &owned_options_;
+    }
+    void setMenu(const PopupMenu& menu) { options_ = &menu.options(); }
     void setFont(const Font& font) { font_ = font.withDpiScale(dpiScale()); }
 
     float renderHeight() const;
@@ -129,8 +159,8 @@ namespace visage {
     int yForIndex(int index) const;
     int hoverY() { return yForIndex(hover_index_); }
     int hoverIndex() const { return hover_index_; }
-    int numOptions() const { return options_.size(); }
-    const PopupMenu& option(int index) const { return options_[index]; }
+    int numOptions() const { return options_->size(); }
+    const PopupMenu& option(int index) const { return (*options_)[index]; }
     void selectHoveredIndex();
     void setHoverFromPosition(Point position);
     void setNoHover() { hover_index_ = -1; }
@@ -165,7 +195,8 @@ namespace visage {
 
   private:
     std::vector<Listener*> listeners_;
-    std::vector<PopupMenu> options_;
+    std::vector<PopupMenu> owned_options_;
+    const std::vector<PopupMenu>* options_ = &owned_options_;
     float opacity_ = 0.0f;
     int hover_index_ = -1;
     int menu_open_index_ = -1;
@@ -187,6 +218,14 @@ namespace visage {
     void draw(Canvas& canvas) override;
 
     void show(std::unique_ptr<PopupMenuFrame> self, Frame* source, Point point = {});
+    // Attaches the frame to source's top level frame without showing it. The first list is laid
+    // out and drawn into a snapshot layer right away and again after every close.
+    void prepare(Frame* source);
+    // Shows a prepared menu. Until the first selection timer fires the list is the snapshot, so
+    // nothing is laid out or drawn on the frame it opens.
+    void show(Frame* source, Point point = { PopupMenu::kNotSet, PopupMenu::kNotSet });
+    bool isPrepared() const { return prepared_; }
+    bool isShowing() const { return !prepared_ || showing_; }
     void setFont(const Font& font) {
       font_ = font;
       setListFonts(font);
@@ -211,9 +250,14 @@ namespace visage {
     float opacity() const { return opacity_animation_.value(); }
 
   private:
+    void open(Frame* source, Point point);
+    void rest();
+
     PopupMenu menu_;
     Frame* parent_ = nullptr;
     bool done_ = false;
+    bool prepared_ = false;
+    bool showing_ = false;
     Animation<float> opacity_animation_;
     PopupList lists_[kMaxSubMenus];
     int hover_index_ = -1;
@@ -23,6 +23,8 @@
 
 #include "visage_graphics/theme.h"
 
+#include <algorithm>
+
 namespace visage {
   VISAGE_THEME_COLOR(ScrollBarDefault, 0x22ffffff);
   VISAGE_THEME_COLOR(ScrollBarDown, 0x55ffffff);
@@ -125,6 +127,48 @@ namespace visage {
     setScrollableHeight(bottom_most.second + bottomPadding());
   }
 
+  void ScrollableFrame::setCompositeScrolling(bool composite, float overscan) {
+    composite_overscan_ = std::max(0.0f, overscan);
+    if (composite_scrolling_ == composite) {
+      if (composite)
+        updateScrollLayer();
+      return;
+    }
+
+    composite_scrolling_ = composite;
+    bool container_visible = container_.isVisible();
+    if (composite) {
+      removeChild(&container_);
+      scroll_layer_.addChild(&container_, container_visible);
+      addChild(&scroll_layer_);
+      layer_top_ = -1.0f;
+      updateScrollLayer();
+    }
+    else {
+      scroll_layer_.removeChild(&container_);
+      removeChild(&scroll_layer_);
+      addChild(&container_, container_visible);
+      container_.setTopLeft(container_.x(), -y_position_);
+    }
+  }
+
+  void ScrollableFrame::updateScrollLayer() {
+    float view_height = height();
+    float total_height = container_.height();
+    float overscan = view_height * composite_overscan_;
+    float layer_height = std::min(total_height, view_height + 2.0f * overscan);
+    float layer_bottom = layer_top_ + scroll_layer_.height();
+    if (layer_top_ < 0.0f || scroll_layer_.height() != layer_height || y_position_ < layer_top_ ||
+        y_position_ + view_height > layer_bottom) {
+      float max_top = std::max(0.0f, total_height - layer_height);
+      float top = std::clamp(y_position_ - overscan, 0.0f, max_top);
+      layer_top_ = std::round(dpiScale() * top) / dpiScale();
+      container_.setTopLeft(0, -layer_top_);
+    }
+
+    scroll_layer_.setBounds(0, layer_top_ - y_position_, width(), layer_height);
+  }
+
   void ScrollableFrame::resized() {
     int scroll_bar_width = paletteValue(ScrollBarWidth);
     int x = scroll_bar_left_ ? 0 : width() - scroll_bar_width;
@@ -57,18 +57,23 @@ namespace visage {
     }
 
     void setPosition(int position) {
+      if (position_ == position)
+        return;
+
       position_ = position;
       redraw();
     }
 
     void setViewPosition(int range, int view_height, int position) {
+      bool changed = range_ != range || view_height_ != view_height || position_ != position;
       range_ = range;
       view_height_ = view_height;
       position_ = position;
 
       active_ = view_height_ < range_;
       setIgnoresMouseEvents(!active_, true);
-      redraw();
+      if (changed)
+        redraw();
     }
 
     int viewRange() const { return range_; }
@@ -98,6 +103,7 @@ namespace visage {
   public:
     static constexpr float kDefaultSmoothTime = 0.1f;
     static constexpr float kDefaultWheelSensitivity = 100.0f;
+    static constexpr float kDefaultCompositeOverscan = 1.0f;
 
     explicit ScrollableFrame(const std::string& name = "") : Frame(name) {
       addChild(&container_);
@@ -118,9 +124,13 @@ namespace visage {
         smooth_position_ = y_position_;
       });
       scroll_bar_.setOnTop(true);
+
+      scroll_layer_.setIgnoresMouseEvents(true, true);
+      scroll_layer_.setCached(true);
     }
 
     void resized() override;
+    virtual void scrolled() { }
 
     void addScrolledChild(Frame* frame, bool make_visible = true) {
       container_.setVisible(true);
@@ -151,7 +161,8 @@ namespace visage {
     void setScrollableHeight(float total_height, float view_height = 0) {
       if (view_height == 0)
         view_height = height();
-      container_.setBounds(0, -y_position_, width(), total_height);
+      float container_y = composite_scrolling_ ? -layer_top_ : -y_position_;
+      container_.setBounds(0, container_y, width(), total_height);
       setYPosition(std::max(0.0f, std::min(y_position_, total_height - view_height)));
       scroll_bar_.setViewPosition(total_height, view_height, y_position_);
     }
@@ -193,6 +204,12 @@ namespace visage {
     auto& onScroll() { return on_scroll_; }
     ScrollBar& scrollBar() { return scroll_bar_; }
 
+    // Renders the scrolled children into a cached layer that extends past the viewport by
+    // overscan viewport heights on each side. Scrolling then only moves that layer, and the layer
+    // is re-rendered when the view scrolls past its edge instead of on every scroll tick.
+    void setCompositeScrolling(bool composite, float overscan = kDefaultCompositeOverscan);
+    bool compositeScrolling() const { return composite_scrolling_; }
+
     void setSensitivity(float sensitivity) { sensitivity_ = sensitivity; }
     void setSmoothTime(float seconds) { smooth_time_ = seconds; }
 
@@ -202,14 +219,25 @@ namespace visage {
     void updateScrollableHeight(const Frame* changed);
     void updateScrollableHeight();
     float maxScroll() const { return scroll_bar_.viewRange() - scroll_bar_.viewHeight(); }
+    void updateScrollLayer();
 
     void scrollPositionChanged(float position) {
-      y_position_ = std::round(dpiScale() * position) / dpiScale();
-      container_.setTopLeft(container_.x(), -y_position_);
+      float y_position = std::round(dpiScale() * position) / dpiScale();
+      bool moved = y_position != y_position_;
+      y_position_ = y_position;
       scroll_bar_.setPosition(position);
-      redraw();
-      container_.redraw();
-      on_scroll_.callback(this);
+      if (composite_scrolling_)
+        updateScrollLayer();
+      else if (moved) {
+        container_.setTopLeft(container_.x(), -y_position_);
+        redraw();
+        container_.redraw();
+      }
+
+      if (moved) {
+        scrolled();
+        on_scroll_.callback(this);
+      }
     }
 
     bool smoothScroll(float offset) {
@@ -251,6 +279,10 @@ namespace visage {
     float smooth_position_ = 0.0f;
     float y_position_ = 0;
     bool scroll_bar_left_ = false;
+    bool composite_scrolling_ = false;
+    float composite_overscan_ = kDefaultCompositeOverscan;
+    float layer_top_ = 0.0f;
+    Frame scroll_layer_;
     Frame container_;
     const Frame* bottom_most_child_ = nullptr;
     ScrollBar scroll_bar_;
@@ -25,8 +25,10 @@ namespace visage {
   void SvgFrame::setDimensions() {
     int m = margin_.compute(dpiScale(), nativeWidth(), nativeHeight(), 0.0f);
     svg_.setDimensions(width() - 2 * m / dpiScale(), height() - 2 * m / dpiScale(), dpiScale());
+    if (sub_frame_ && sub_frame_->drawable() != svg_.drawable())
+      sub_frame_ = nullptr;
 
-    if (sub_frame_ == nullptr && svg_.width() && svg_.height()) {
+    if (sub_frame_ == nullptr && svg_.width() && svg_.height() && svg_.drawable()) {
       sub_frame_ = std::make_unique<SubFrame>(svg_.drawable(), &context_);
       addChild(sub_frame_.get());
     }
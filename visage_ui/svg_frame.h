@@ -23,6 +23,9 @@
 
 #include "frame.h"
 #include "visage_file_embed/embedded_file.h"
+#include "visage_utils/thread_utils.h"
+
+#include <memory>
 
 namespace visage {
   class SvgFrame : public Frame {
@@ -33,23 +36,48 @@ namespace visage {
     SvgFrame(const uint8_t* data, size_t size) { load(data, size); }
 
     void load(const Svg& svg) {
+      load_token_ = nullptr;
       svg_ = svg;
       loadSubFrames();
       redraw();
     }
 
     void load(const EmbeddedFile& file) {
+      load_token_ = nullptr;
       svg_ = Svg(file);
       loadSubFrames();
       redraw();
     }
 
     void load(const uint8_t* data, size_t size) {
+      load_token_ = nullptr;
       svg_ = Svg(data, size);
       loadSubFrames();
       redraw();
     }
 
+    void loadAsync(const EmbeddedFile& file) { loadAsync(file.data, file.size); }
+
+    // The sub frames are built on the main thread once the background load finishes. A later
+    // load, or destroying the frame, drops the token so a stale completion is ignored.
+    void loadAsync(const uint8_t* data, size_t size) {
+      load_token_ = std::make_shared<bool>(true);
+      std::weak_ptr<bool> token = load_token_;
+      auto on_ready = [this, token] {
+        ThreadPool::runOnMainThread([this, token] {
+          if (token.lock())
+            finishAsyncLoad();
+        });
+      };
+
+      int m = margin_.compute(dpiScale(), nativeWidth(), nativeHeight(), 0.0f);
+      svg_ = Svg::loadAsync(data, size, width() - 2 * m / dpiScale(), height() - 2 * m / dpiScale(),
+                            dpiScale(), std::move(on_ready));
+      loadSubFrames();
+    }
+
+    bool loading() const { return svg_.loading(); }
+
     void setMargin(const Dimension& margin) {
       margin_ = margin;
       setDimensions();
@@ -57,33 +85,38 @@ namespace visage {
 
     void setFillBrush(const Brush& brush) {
       svg_.setFillBrush(brush);
+      setDimensions();
       redrawAll();
     }
 
     void resetFillBrush() {
       svg_.resetFillBrush();
+      setDimensions();
       redrawAll();
     }
 
     void setStrokeBrush(const Brush& brush) {
       svg_.setStrokeBrush(brush);
+      setDimensions();
       redrawAll();
     }
 
     void resetStrokeBrush() {
       svg_.resetStrokeBrush();
+      setDimensions();
       redrawAll();
     }
 
     void setCurrentColor(const Brush& brush) {
       svg_.setCurrentColor(brush);
+      setDimensions();
       redrawAll();
     }
 
   private:
     class SubFrame : public Frame {
     public:
-      SubFrame(SvgDrawable* drawable, SvgDrawable::ColorContext* context) :
+      SubFrame(const SvgDrawable* drawable, SvgDrawable::ColorContext* context) :
           drawable_(drawable), context_(context) {
         setAlphaTransparency(drawable_->opacity);
         addSubFrames(drawable);
@@ -122,7 +155,7 @@ namespace visage {
         children_.push_back(std::move(child));
       }
 
-      void addSubFrames(SvgDrawable* drawable) {
+      void addSubFrames(const SvgDrawable* drawable) {
         bool make_subframes = false;
         for (auto& child : drawable->children) {
           if ((child->opacity != 0.0f && child->opacity != 1.0f) || !child->clipping_paths.empty())
@@ -137,6 +170,8 @@ namespace visage {
         }
       }
 
+      const SvgDrawable* drawable() const { return drawable_; }
+
       void draw(Canvas& canvas) override {
         float offset_x = -drawable_->post_bounding_box.x();
         float offset_y = -drawable_->post_bounding_box.y();
@@ -157,14 +192,19 @@ namespace visage {
 
     private:
       std::unique_ptr<Frame> clipping_frame_;
-      SvgDrawable* drawable_ = nullptr;
+      const SvgDrawable* drawable_ = nullptr;
       std::vector<std::unique_ptr<SubFrame>> children_;
-      std::vector<SvgDrawable*> child_drawables_;
+      std::vector<const SvgDrawable*> child_drawables_;
       SvgDrawable::ColorContext* context_ = nullptr;
     };
 
     void setDimensions();
     void loadSubFrames();
+    void finishAsyncLoad() {
+      load_token_ = nullptr;
+      loadSubFrames();
+      redraw();
+    }
 
     void resized() override {
       context_ = {};
@@ -175,5 +215,6 @@ namespace visage {
     SvgDrawable::ColorContext context_;
     std::unique_ptr<SubFrame> sub_frame_;
     Dimension margin_;
+    std::shared_ptr<bool> load_token_;
   };
 }
\ No newline at end of file
@@ -0,0 +1,81 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "visage_ui/animation_scheduler.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace visage;
+
+TEST_CASE("AnimationScheduler advances until animations settle", "[ui]") {
+  AnimationScheduler& scheduler = AnimationScheduler::instance();
+  REQUIRE(scheduler.idle());
+
+  Frame frame;
+  FrameAnimation<float> fast(&frame, 10, Animation<float>::kLinear, Animation<float>::kLinear);
+  FrameAnimation<float> slow(&frame, 100, Animation<float>::kLinear, Animation<float>::kLinear);
+  fast.setTargetValue(1.0f);
+  slow.setTargetValue(1.0f);
+
+  fast.target(true);
+  slow.target(true);
+  REQUIRE(scheduler.numAnimating() == 2);
+
+  long long start = 5000;
+  scheduler.advance(start);
+  REQUIRE(fast.value() == 0.0f);
+  REQUIRE(slow.value() == 0.0f);
+  REQUIRE(scheduler.numAnimating() == 2);
+
+  scheduler.advance(start + 50);
+  REQUIRE(fast.value() == 1.0f);
+  REQUIRE(slow.value() > 0.0f);
+  REQUIRE(slow.value() < 1.0f);
+  REQUIRE(scheduler.numAnimating() == 1);
+
+  {
+    FrameAnimation<float> temporary(&frame);
+    temporary.target(true);
+    REQUIRE(scheduler.numAnimating() == 2);
+  }
+  REQUIRE(scheduler.numAnimating() == 1);
+
+  scheduler.advance(start + 200);
+  REQUIRE(slow.value() == 1.0f);
+  REQUIRE(scheduler.idle());
+
+  slow.target(false, true);
+  REQUIRE(slow.value() == 0.0f);
+  REQUIRE(scheduler.idle());
+
+  slow.target(true);
+  scheduler.advance(start + 1000);
+  REQUIRE(slow.value() == 0.0f);
+  scheduler.advance(start + 1050);
+  REQUIRE(slow.value() == 0.5f);
+
+  slow.target(false);
+  scheduler.advance(start + 1075);
+  REQUIRE(slow.value() == 0.25f);
+  scheduler.advance(start + 1100);
+  REQUIRE(slow.value() == 0.0f);
+  REQUIRE(scheduler.idle());
+}
@@ -19,10 +19,15 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include "visage_graphics/canvas.h"
 #include "visage_ui/events.h"
 #include "visage_ui/frame.h"
+#include "visage_ui/mirror_watcher.h"
 
 #include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <thread>
+#include <vector>
 
 using namespace visage;
 
@@ -80,6 +85,92 @@ TEST_CASE("EventManager functionality", "[ui]") {
   }
 }
 
+TEST_CASE("EventManager fires timers in deadline order", "[ui]") {
+  EventManager& manager = EventManager::instance();
+  int num_timers = manager.numTimers();
+  TestEventTimer fast, slow;
+
+  slow.startTimer(100000);
+  fast.startTimer(1);
+  REQUIRE(manager.numTimers() == num_timers + 2);
+  REQUIRE(manager.nextDeadline() == fast.nextFireTime());
+
+  for (int i = 0; i < 100; ++i)
+    fast.startTimer(1);
+  REQUIRE(manager.numTimers() == num_timers + 2);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  manager.checkEventTimers();
+  REQUIRE(fast.callback_count == 1);
+  REQUIRE(slow.callback_count == 0);
+  REQUIRE(manager.nextDeadline() == fast.nextFireTime());
+
+  fast.stopTimer();
+  REQUIRE(manager.nextDeadline() == slow.nextFireTime());
+  slow.stopTimer();
+  REQUIRE(manager.numTimers() == num_timers);
+}
+
+TEST_CASE("runOnEventThread from other threads", "[ui]") {
+  EventManager& manager = EventManager::instance();
+  manager.checkEventTimers();
+
+  static constexpr int kPostsPerThread = EventManager::kPostedCallbackCapacity;
+  int count = 0;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 2; ++t) {
+    threads.emplace_back([&count] {
+      for (int i = 0; i < kPostsPerThread; ++i)
+        runOnEventThread([&count] { count++; });
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  REQUIRE(count == 0);
+  manager.checkEventTimers();
+  REQUIRE(count == 2 * kPostsPerThread);
+}
+
+TEST_CASE("MirrorWatcher redraws only on new values", "[ui]") {
+  struct RedrawCounter : FrameEventHandler {
+    RedrawCounter() {
+      request_redraw = [this](Frame*) { count++; };
+    }
+    int count = 0;
+  };
+
+  Canvas canvas;
+  RedrawCounter handler;
+  Frame frame;
+  frame.setBounds(0, 0, 10, 10);
+  frame.setEventHandler(&handler);
+  frame.drawToRegion(canvas);
+  ValueMirror<float> mirror;
+  MirrorWatcher<ValueMirror<float>> watcher(&frame, &mirror);
+  int changes = 0;
+  watcher.onChange() += [&changes] { changes++; };
+
+  REQUIRE(watcher.scheduled());
+  handler.count = 0;
+  AnimationScheduler::instance().advance(0);
+  REQUIRE(changes == 0);
+  REQUIRE(handler.count == 0);
+
+  mirror.set(0.5f);
+  AnimationScheduler::instance().advance(16);
+  REQUIRE(changes == 1);
+  REQUIRE(watcher.value() == 0.5f);
+  REQUIRE(handler.count == 1);
+
+  frame.drawToRegion(canvas);
+  handler.count = 0;
+  AnimationScheduler::instance().advance(32);
+  REQUIRE(changes == 1);
+  REQUIRE(handler.count == 0);
+  frame.setEventHandler(nullptr);
+}
+
 TEST_CASE("MouseEvent basic properties", "[ui]") {
   MouseEvent event;
 
@@ -223,6 +314,25 @@ TEST_CASE("MouseEvent popup trigger detection", "[ui]") {
   }
 }
 
+TEST_CASE("MouseEvent predicts ahead from its history", "[ui]") {
+  std::vector<PointerSample> history = { { Point(0.0f, 0.0f), 0 },
+                                         { Point(10.0f, 0.0f), 10000 },
+                                         { Point(20.0f, 5.0f), 20000 } };
+  MouseEvent event;
+  event.window_position = Point(20.0f, 5.0f);
+  event.position = Point(2.0f, 1.0f);
+  REQUIRE(event.predictedWindowPosition(10000) == event.window_position);
+
+  event.history = &history;
+  REQUIRE(event.predictedWindowPosition(0) == event.window_position);
+  REQUIRE(event.predictedWindowPosition(10000) == Point(30.0f, 7.5f));
+  REQUIRE(event.predictedPosition(10000) == Point(12.0f, 3.5f));
+  REQUIRE(event.predictedWindowPosition(1000000) == Point(70.0f, 17.5f));
+
+  history.push_back({ Point(20.0f, 5.0f), 100000 });
+  REQUIRE(event.predictedWindowPosition(10000) == event.window_position);
+}
+
 TEST_CASE("KeyEvent construction and properties", "[ui]") {
   KeyEvent event(KeyCode::A, kModifierShift, true, false);
 
@@ -0,0 +1,82 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "visage_ui/frame.h"
+#include "visage_ui/frame_pool.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace visage;
+
+namespace {
+  class PooledRow : public Frame, public PooledFrame<PooledRow> {
+  public:
+    int value = 0;
+  };
+
+  class LargerPooledRow : public PooledRow {
+  public:
+    char padding[256] = {};
+  };
+}
+
+TEST_CASE("BlockPool reuses freed blocks", "[ui]") {
+  BlockPool pool(24);
+  REQUIRE(pool.blockSize() % BlockPool::kAlignment == 0);
+
+  void* first = pool.allocate();
+  void* second = pool.allocate();
+  REQUIRE(first != second);
+  REQUIRE(pool.numAllocated() == 2);
+  REQUIRE(pool.numChunks() == 1);
+
+  pool.deallocate(first);
+  REQUIRE(pool.allocate() == first);
+
+  std::vector<void*> blocks;
+  for (int i = 0; i < BlockPool::kBlocksPerChunk; ++i)
+    blocks.push_back(pool.allocate());
+  REQUIRE(pool.numChunks() == 2);
+  REQUIRE(pool.numAllocated() == BlockPool::kBlocksPerChunk + 2);
+}
+
+TEST_CASE("PooledFrame children are recycled through the pool", "[ui]") {
+  Frame parent;
+  BlockPool& pool = PooledFrame<PooledRow>::pool();
+  int allocated = pool.numAllocated();
+
+  auto row = std::make_unique<PooledRow>();
+  PooledRow* row_ptr = row.get();
+  parent.addChild(std::move(row));
+  REQUIRE(pool.numAllocated() == allocated + 1);
+
+  parent.removeChild(row_ptr);
+  REQUIRE(pool.numAllocated() == allocated);
+
+  auto recycled = std::make_unique<PooledRow>();
+  REQUIRE(recycled.get() == row_ptr);
+  REQUIRE(recycled->value == 0);
+
+  std::unique_ptr<Frame> larger = std::make_unique<LargerPooledRow>();
+  REQUIRE(pool.numAllocated() == allocated + 1);
+  larger = nullptr;
+  REQUIRE(pool.numAllocated() == allocated + 1);
+}
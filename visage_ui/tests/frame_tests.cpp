@@ -20,6 +20,7 @@
  */
 
 #include "visage_graphics/canvas.h"
+#include "visage_graphics/renderer.h"
 #include "visage_ui/frame.h"
 #include "visage_utils/events.h"
 
@@ -199,6 +200,24 @@ TEST_CASE("Frame hierarchy management", "[ui]") {
     REQUIRE(parent.indexOfChild(child1_ptr) == -1);
   }
 
+  SECTION("Removing a middle child keeps the order of the rest") {
+    Frame first, middle, last;
+    parent.addChild(first);
+    parent.addChild(middle);
+    parent.addChild(last);
+
+    parent.removeChild(&middle);
+    REQUIRE(parent.children().size() == 2);
+    REQUIRE(parent.indexOfChild(&first) == 0);
+    REQUIRE(parent.indexOfChild(&last) == 1);
+    REQUIRE(parent.region()->subRegions()[1] == last.region());
+
+    parent.addChild(middle);
+    parent.removeChild(&last);
+    REQUIRE(parent.children()[1] == &middle);
+    parent.removeAllChildren();
+  }
+
   SECTION("Removing all children") {
     parent.addChild(std::move(child1));
     parent.addChild(std::move(child2));
@@ -242,6 +261,39 @@ TEST_CASE("Frame visibility and drawing", "[ui]") {
   }
 }
 
+TEST_CASE("Lazily initialized frames wait until they're shown", "[ui]") {
+  Frame parent;
+  Frame shown;
+  Frame page;
+  Frame page_child;
+  page.setLazyInit(true);
+  page.addChild(page_child);
+  parent.addChild(shown);
+  parent.addChild(page, false);
+
+  parent.init();
+  REQUIRE(shown.initialized());
+  REQUIRE_FALSE(page.initialized());
+  REQUIRE_FALSE(page_child.initialized());
+
+  page.setVisible(true);
+  REQUIRE(page.initialized());
+  REQUIRE(page_child.initialized());
+
+  Frame warmed;
+  Frame warmed_child;
+  warmed.setLazyInit(true);
+  warmed.addChild(warmed_child);
+  parent.addChild(warmed, false);
+  REQUIRE_FALSE(warmed.initialized());
+
+  warmed_child.initialize();
+  REQUIRE(warmed.initialized());
+  REQUIRE(warmed_child.initialized());
+  REQUIRE_FALSE(warmed.isVisible());
+  parent.removeAllChildren();
+}
+
 TEST_CASE("Frame event handling", "[ui]") {
   TestFrame frame;
 
@@ -282,6 +334,31 @@ TEST_CASE("Frame event handling", "[ui]") {
   }
 }
 
+TEST_CASE("Frame event listeners extend virtual handlers", "[ui]") {
+  TestFrame frame;
+  MouseEvent mouse_event {};
+  REQUIRE(frame.onMouseDown().usesOriginal());
+
+  int listener_count = 0;
+  frame.onMouseDown() += [&listener_count](const MouseEvent&) { listener_count++; };
+  REQUIRE_FALSE(frame.onMouseDown().usesOriginal());
+
+  frame.processMouseDown(mouse_event);
+  REQUIRE(frame.mouse_down_count == 1);
+  REQUIRE(listener_count == 1);
+
+  frame.onMouseDown() = [&listener_count](const MouseEvent&) { listener_count++; };
+  frame.processMouseDown(mouse_event);
+  REQUIRE(frame.mouse_down_count == 1);
+  REQUIRE(listener_count == 2);
+
+  frame.onMouseDown().reset();
+  REQUIRE(frame.onMouseDown().usesOriginal());
+  frame.processMouseDown(mouse_event);
+  REQUIRE(frame.mouse_down_count == 2);
+  REQUIRE(listener_count == 2);
+}
+
 TEST_CASE("Frame focus and keyboard handling", "[ui]") {
   Frame frame;
 
@@ -365,6 +442,13 @@ TEST_CASE("Frame transparency and effects", "[ui]") {
     frame.setMasked(true);
     frame.setMasked(false);
   }
+
+  SECTION("Setting stencil clip") {
+    frame.setClipRounding(8.0f);
+    REQUIRE(frame.hasStencilClip());
+    frame.clearClip();
+    REQUIRE_FALSE(frame.hasStencilClip());
+  }
 }
 
 TEST_CASE("Frame on-top handling", "[ui]") {
@@ -467,6 +551,67 @@ TEST_CASE("Frame event handler integration", "[ui]") {
   frame.setEventHandler(nullptr);
 }
 
+TEST_CASE("Frame moves replay the recorded drawing", "[ui]") {
+  Canvas canvas;
+  TestFrame frame;
+  MockEventHandler handler;
+  frame.setEventHandler(&handler);
+  frame.setBounds(0, 0, 100, 100);
+  frame.drawToRegion(canvas);
+  REQUIRE(frame.draw_count == 1);
+
+  int redraw_requests = handler.redraw_count;
+  frame.setTopLeft(20, 30);
+  REQUIRE(handler.redraw_count == redraw_requests + 1);
+  frame.drawToRegion(canvas);
+  REQUIRE(frame.draw_count == 1);
+  REQUIRE(frame.region()->x() == 20);
+  REQUIRE(frame.region()->y() == 30);
+
+  frame.setBounds(20, 30, 120, 100);
+  frame.drawToRegion(canvas);
+  REQUIRE(frame.draw_count == 2);
+
+  frame.redraw();
+  frame.drawToRegion(canvas);
+  REQUIRE(frame.draw_count == 3);
+  frame.setEventHandler(nullptr);
+}
+
+TEST_CASE("Frame submits are counted on the Noop renderer", "[ui]") {
+  REQUIRE(Renderer::instance().noopRenderer());
+
+  Canvas canvas;
+  canvas.setWindowless(100, 100);
+  FrameEventHandler handler;
+  handler.request_redraw = [](Frame*) { };
+  Frame frame;
+  frame.setEventHandler(&handler);
+  frame.onDraw() += [](Canvas& canvas) {
+    canvas.setColor(0xffff0000);
+    canvas.rectangle(0, 0, 50, 50);
+    canvas.rectangle(50, 50, 50, 50);
+  };
+  canvas.addRegion(frame.region());
+  frame.setBounds(0, 0, 100, 100);
+  frame.drawToRegion(canvas);
+
+  canvas.submit();
+  REQUIRE(canvas.frameStats().batch_submits > 0);
+  REQUIRE(canvas.frameStats().draw_calls > 0);
+  REQUIRE(canvas.frameStats().vertices > 0);
+
+  canvas.submit();
+  REQUIRE(canvas.frameStats().batch_submits == 0);
+  REQUIRE(canvas.frameStats().draw_calls == 0);
+
+  frame.redraw();
+  frame.drawToRegion(canvas);
+  canvas.submit();
+  REQUIRE(canvas.frameStats().draw_calls > 0);
+  frame.setEventHandler(nullptr);
+}
+
 TEST_CASE("Frame layout management", "[ui]") {
   Frame frame;
 
@@ -487,4 +632,134 @@ TEST_CASE("Frame layout management", "[ui]") {
     frame.setFlexLayout(false);
     REQUIRE_FALSE(frame.layout().flex());
   }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Frame hit test index matches linear search", "[ui]") {
+  Frame indexed;
+  Frame linear;
+  indexed.setBounds(0, 0, 400, 200);
+  linear.setBounds(0, 0, 400, 200);
+  indexed.setHitTestIndex(true);
+  REQUIRE(indexed.hitTestIndex());
+
+  std::vector<std::unique_ptr<Frame>> frames;
+  auto add_cell = [&](float x, float y, float width, float height) {
+    for (Frame* parent : { &indexed, &linear }) {
+      frames.push_back(std::make_unique<Frame>());
+      frames.back()->setBounds(x, y, width, height);
+      parent->addChild(frames.back().get());
+    }
+  };
+
+  for (int r = 0; r < 16; ++r) {
+    for (int c = 0; c < 32; ++c)
+      add_cell(c * 12.5f, r * 12.5f, 12.5f, 12.5f);
+  }
+  add_cell(30, 30, 100, 60);
+  add_cell(200, 10, 40, 150);
+  indexed.children()[2]->setOnTop(true);
+  linear.children()[2]->setOnTop(true);
+  indexed.children()[40]->setVisible(false);
+  linear.children()[40]->setVisible(false);
+
+  auto check_all_points = [&] {
+    for (float y = -5.0f; y < 210.0f; y += 3.7f) {
+      for (float x = -5.0f; x < 410.0f; x += 3.7f) {
+        Frame* expected = linear.frameAtPoint({ x, y });
+        Frame* result = indexed.frameAtPoint({ x, y });
+        int expected_index = linear.indexOfChild(expected);
+        REQUIRE(indexed.indexOfChild(result) == expected_index);
+        if (expected_index < 0)
+          REQUIRE((result == &indexed) == (expected == &linear));
+      }
+    }
+  };
+  check_all_points();
+
+  uint64_t generation = Frame::hitTestGeneration();
+  indexed.children()[100]->setBounds(300, 150, 80, 40);
+  linear.children()[100]->setBounds(300, 150, 80, 40);
+  REQUIRE(Frame::hitTestGeneration() != generation);
+  check_all_points();
+
+  indexed.removeChild(indexed.children()[5]);
+  linear.removeChild(linear.children()[5]);
+  check_all_points();
+}
+
+class TextReceiverFrame : public Frame {
+public:
+  bool receivesTextInput() override { return receives; }
+
+  bool receives = true;
+};
+
+TEST_CASE("Frame tab traversal follows the cached focus order", "[ui]") {
+  Frame root;
+  Frame* focused = nullptr;
+  FrameEventHandler handler;
+  handler.request_keyboard_focus = [&focused](Frame* frame) { focused = frame; };
+  root.setEventHandler(&handler);
+
+  Frame group;
+  TextReceiverFrame first, second, third, fourth;
+  root.addChild(&first);
+  root.addChild(&group);
+  group.addChild(&second);
+  group.addChild(&third);
+  root.addChild(&fourth);
+
+  auto next = [&](const Frame& frame) {
+    focused = nullptr;
+    frame.focusNextTextReceiver();
+    return focused;
+  };
+  auto previous = [&](const Frame& frame) {
+    focused = nullptr;
+    frame.focusPreviousTextReceiver();
+    return focused;
+  };
+
+  REQUIRE(next(first) == &second);
+  REQUIRE(next(second) == &third);
+  REQUIRE(next(third) == &fourth);
+  REQUIRE(next(fourth) == &first);
+  REQUIRE(previous(first) == &fourth);
+  REQUIRE(previous(fourth) == &third);
+  REQUIRE(previous(second) == &first);
+
+  SECTION("Hidden frames are skipped") {
+    group.setVisible(false);
+    REQUIRE(next(first) == &fourth);
+    group.setVisible(true);
+    REQUIRE(next(first) == &second);
+  }
+
+  SECTION("Explicit tab order reorders siblings") {
+    fourth.setTabOrder(-1);
+    REQUIRE(next(fourth) == &first);
+    REQUIRE(next(third) == &fourth);
+    REQUIRE(next(first) == &second);
+    REQUIRE(previous(fourth) == &third);
+  }
+
+  SECTION("Receivers that stop accepting text are dropped") {
+    second.receives = false;
+    REQUIRE(next(first) == &third);
+  }
+
+  SECTION("Removed frames leave the order") {
+    group.removeChild(&third);
+    REQUIRE(next(second) == &fourth);
+  }
+
+  SECTION("A lone receiver has nowhere to go") {
+    root.removeChild(&first);
+    root.removeChild(&group);
+    root.removeChild(&fourth);
+    root.addChild(&first);
+    REQUIRE(next(first) == nullptr);
+  }
+
+  root.setEventHandler(nullptr);
+}
@@ -0,0 +1,116 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "visage_graphics/canvas.h"
+#include "visage_ui/frame.h"
+#include "visage_ui/layer_cache.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace visage;
+
+namespace {
+  class DetailedFrame : public Frame {
+  public:
+    void draw(Canvas& canvas) override {
+      canvas.setColor(0xffffffff);
+      for (int i = 0; i < LayerCachePolicy::kMinShapes; ++i)
+        canvas.rectangle(i % 10, i / 10, 1, 1);
+    }
+  };
+
+  void drawFrames(Canvas& canvas, Frame& parent, Frame& child) {
+    parent.drawToRegion(canvas);
+    child.drawToRegion(canvas);
+  }
+}
+
+TEST_CASE("LayerCachePolicy promotes detailed frames under busy parents", "[ui]") {
+  Canvas canvas;
+  FrameEventHandler handler;
+  handler.request_redraw = [](Frame*) { };
+
+  Frame root;
+  Frame parent;
+  DetailedFrame child;
+  root.setEventHandler(&handler);
+  root.addChild(&parent);
+  parent.addChild(&child);
+  root.setBounds(0, 0, 100, 100);
+  parent.setBounds(0, 0, 100, 100);
+  child.setBounds(0, 0, 50, 50);
+  drawFrames(canvas, parent, child);
+  REQUIRE(child.region()->numShapes() == LayerCachePolicy::kMinShapes);
+
+  LayerCachePolicy policy;
+  for (int i = 0; i < LayerCachePolicy::kMinExposures * 2; ++i) {
+    parent.redraw();
+    parent.drawToRegion(canvas);
+  }
+
+  const auto& decisions = policy.evaluate(&root);
+  REQUIRE(decisions.size() == 1);
+  REQUIRE(decisions[0].frame == &child);
+  REQUIRE(decisions[0].cached);
+  REQUIRE(child.isAutoCached());
+  REQUIRE_FALSE(parent.isAutoCached());
+  REQUIRE(parent.drawCount() == 0);
+
+  for (int i = 0; i < LayerCachePolicy::kMinExposures * 2; ++i) {
+    parent.redraw();
+    child.redraw();
+    drawFrames(canvas, parent, child);
+  }
+
+  policy.evaluate(&root);
+  REQUIRE(policy.decisions().size() == 1);
+  REQUIRE_FALSE(child.isAutoCached());
+}
+
+TEST_CASE("LayerCachePolicy keeps cheap frames uncached", "[ui]") {
+  Canvas canvas;
+  FrameEventHandler handler;
+  handler.request_redraw = [](Frame*) { };
+
+  Frame root;
+  Frame parent;
+  Frame child;
+  root.setEventHandler(&handler);
+  root.addChild(&parent);
+  parent.addChild(&child);
+  parent.setBounds(0, 0, 100, 100);
+  child.setBounds(0, 0, 50, 50);
+
+  LayerCachePolicy policy;
+  policy.setEvaluationInterval(4);
+  for (int i = 0; i < 8; ++i) {
+    parent.redraw();
+    parent.drawToRegion(canvas);
+    policy.frameDrawn(&root);
+  }
+
+  REQUIRE_FALSE(child.isAutoCached());
+  REQUIRE(policy.decisions().empty());
+
+  child.setAutoCached(true);
+  LayerCachePolicy::clear(&root);
+  REQUIRE_FALSE(child.isAutoCached());
+}
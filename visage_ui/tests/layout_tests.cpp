@@ -19,9 +19,11 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include "visage_ui/frame.h"
 #include "visage_ui/layout.h"
 #include "visage_utils/dimension.h"
 
+#include <catch2/benchmark/catch_benchmark.hpp>
 #include <catch2/catch_approx.hpp>
 #include <catch2/catch_test_macros.hpp>
 
@@ -579,4 +581,67 @@ TEST_CASE("Layout flex alignment", "[ui]") {
   REQUIRE(results[7] == IBounds(320, 170, 160, 80));
   REQUIRE(results[8] == IBounds(610, 10, 180, 90));
   REQUIRE(results[9] == IBounds(590, 110, 200, 100));
-}
\ No newline at end of file
+}
+
+TEST_CASE("Layout caches flex positions", "[ui]") {
+  Layout layout;
+  layout.setFlex(true);
+  Layout child1;
+  Layout child2;
+  child1.setFlexGrow(1.0f);
+  child2.setFlexGrow(1.0f);
+
+  auto results = layout.flexPositions({ &child1, &child2 }, { 0, 0, 100, 200 }, 1.0f);
+  REQUIRE(results[0] == IBounds(0, 0, 100, 100));
+  uint64_t version = layout.version();
+  REQUIRE(layout.flexPositions({ &child1, &child2 }, { 0, 0, 100, 200 }, 1.0f) == results);
+
+  child2.setFlexGrow(3.0f);
+  REQUIRE(layout.version() == version);
+  results = layout.flexPositions({ &child1, &child2 }, { 0, 0, 100, 200 }, 1.0f);
+  REQUIRE(results[0] == IBounds(0, 0, 100, 50));
+  REQUIRE(results[1] == IBounds(0, 50, 100, 150));
+
+  results = layout.flexPositions({ &child2, &child1 }, { 0, 0, 100, 200 }, 1.0f);
+  REQUIRE(results[0] == IBounds(0, 0, 100, 150));
+
+  layout.setPadding(10_px);
+  results = layout.flexPositions({ &child2, &child1 }, { 0, 0, 100, 200 }, 2.0f);
+  REQUIRE(results[0] == IBounds(20, 20, 60, 120));
+}
+
+static void buildLayoutHierarchy(Frame& root, std::vector<std::unique_ptr<Frame>>& frames,
+                                 int branching, int depth) {
+  root.setFlexLayout(true);
+  if (depth == 0)
+    return;
+
+  for (int i = 0; i < branching; ++i) {
+    frames.push_back(std::make_unique<Frame>());
+    Frame* child = frames.back().get();
+    child->layout().setFlexGrow(1.0f);
+    child->layout().setMargin(1_px);
+    root.addChild(child);
+    buildLayoutHierarchy(*child, frames, branching, depth - 1);
+  }
+}
+
+TEST_CASE("Layout benchmark", "[.][benchmark]") {
+  Frame root;
+  std::vector<std::unique_ptr<Frame>> frames;
+  buildLayoutHierarchy(root, frames, 100, 2);
+  REQUIRE(frames.size() == 10100);
+
+  root.setBounds(0, 0, 2000, 2000);
+  BENCHMARK("Relayout 10k frames unchanged") {
+    root.computeLayout();
+    return root.children().front()->width();
+  };
+
+  int size = 2000;
+  BENCHMARK("Resize 10k frames") {
+    size = size == 2000 ? 2001 : 2000;
+    root.setBounds(0, 0, size, size);
+    return root.children().front()->width();
+  };
+}
@@ -103,6 +103,38 @@ TEST_CASE("PopupMenu option management", "[ui]") {
   }
 }
 
+TEST_CASE("PopupMenu lazy sub-menus", "[ui]") {
+  PopupMenu menu("Main Menu");
+  int provider_calls = 0;
+  menu.addSubMenu("Lazy", [&provider_calls] {
+    provider_calls++;
+    std::vector<PopupMenu> options;
+    for (int i = 0; i < 3; ++i)
+      options.emplace_back("Item " + std::to_string(i), i);
+    return options;
+  });
+
+  const PopupMenu& lazy = menu.options()[0];
+  REQUIRE(lazy.hasOptions());
+  REQUIRE_FALSE(lazy.optionsLoaded());
+  REQUIRE(provider_calls == 0);
+
+  Frame source_frame;
+  menu.show(&source_frame);
+  REQUIRE(provider_calls == 0);
+
+  PopupList popup_list;
+  popup_list.setMenu(lazy);
+  REQUIRE(provider_calls == 1);
+  REQUIRE(lazy.optionsLoaded());
+  REQUIRE(popup_list.numOptions() == 3);
+  REQUIRE(popup_list.option(2).name() == "Item 2");
+  REQUIRE(&popup_list.option(0) == &lazy.options()[0]);
+
+  REQUIRE(lazy.size() == 3);
+  REQUIRE(provider_calls == 1);
+}
+
 TEST_CASE("PopupMenu state management", "[ui]") {
   PopupMenu menu("Test Menu", 1);
 
@@ -191,6 +223,33 @@ TEST_CASE("PopupMenu show functionality", "[ui]") {
   }
 }
 
+TEST_CASE("Prepared PopupMenu stays attached between shows", "[ui]") {
+  Frame root;
+  root.setBounds(0, 0, 400, 300);
+  Frame source;
+  root.addChild(&source);
+  source.setBounds(20, 20, 50, 20);
+
+  PopupMenu menu("Test Menu");
+  for (int i = 0; i < 5; ++i)
+    menu.addOption(i, "Option " + std::to_string(i));
+
+  std::unique_ptr<PopupMenuFrame> prepared = menu.prepare(&source);
+  REQUIRE(prepared->isPrepared());
+  REQUIRE_FALSE(prepared->isShowing());
+  REQUIRE(prepared->parent() == &root);
+  REQUIRE(prepared->isOnTop());
+  REQUIRE(prepared->bounds() == root.bounds());
+  REQUIRE(root.children().size() == 2);
+
+  prepared->show(&source, { 10, 10 });
+  REQUIRE(prepared->isShowing());
+  REQUIRE(root.children().size() == 2);
+
+  prepared.reset();
+  REQUIRE(root.children().size() == 1);
+}
+
 TEST_CASE("PopupMenu native menu bar", "[ui]") {
   PopupMenu menu("File");
   menu.addOption(1, "New");
@@ -180,6 +180,34 @@ TEST_CASE("ScrollableFrame scrollable children", "[ui]") {
   }
 }
 
+TEST_CASE("ScrollableFrame composite scrolling moves the cached layer", "[ui]") {
+  ScrollableFrame scrollable_frame;
+  scrollable_frame.setBounds(0, 0, 100, 100);
+  Frame child_frame("child");
+  child_frame.setBounds(0, 0, 100, 1000);
+  scrollable_frame.addScrolledChild(&child_frame);
+  REQUIRE(scrollable_frame.scrollableHeight() == 1000);
+
+  scrollable_frame.setCompositeScrolling(true);
+  REQUIRE(scrollable_frame.compositeScrolling());
+  Frame* scroll_layer = child_frame.parent()->parent();
+  REQUIRE(scroll_layer->parent() == &scrollable_frame);
+  REQUIRE(scroll_layer->height() == 300);
+
+  scrollable_frame.setYPosition(50);
+  REQUIRE(scrollable_frame.relativeBounds(&child_frame).y() == -50);
+  REQUIRE(child_frame.parent()->y() == 0);
+
+  scrollable_frame.setYPosition(500);
+  REQUIRE(scrollable_frame.relativeBounds(&child_frame).y() == -500);
+  REQUIRE(child_frame.parent()->y() == -400);
+  REQUIRE(scroll_layer->y() == -100);
+
+  scrollable_frame.setCompositeScrolling(false);
+  REQUIRE(child_frame.parent()->parent() == &scrollable_frame);
+  REQUIRE(scrollable_frame.relativeBounds(&child_frame).y() == -500);
+}
+
 TEST_CASE("ScrollableFrame scroll bar configuration", "[ui]") {
   ScrollableFrame scrollable_frame;
 
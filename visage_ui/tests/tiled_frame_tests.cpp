@@ -0,0 +1,78 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "visage_ui/tiled_frame.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace visage;
+
+TEST_CASE("TiledFrame only creates tiles in view", "[ui]") {
+  TiledFrame frame;
+  frame.setContentSize(50000.0f, 200.0f);
+  frame.setBounds(0, 0, 1000, 200);
+
+  REQUIRE(frame.numColumns() == 196);
+  REQUIRE(frame.numRows() == 1);
+  REQUIRE(frame.numTiles() == 4);
+  REQUIRE(frame.numVisibleTiles() == 4);
+  REQUIRE(frame.tileAt(4, 0) == nullptr);
+
+  Frame* first = frame.tileAt(0, 0);
+  REQUIRE(first);
+  REQUIRE(first->width() == 256.0f);
+  REQUIRE(first->height() == 200.0f);
+
+  frame.setViewPosition(10000.0f, 0.0f);
+  REQUIRE(frame.numVisibleTiles() == 4);
+  REQUIRE(frame.numTiles() == 8);
+  REQUIRE(frame.tileAt(0, 0) == first);
+  REQUIRE(first->x() == -10000.0f);
+  REQUIRE(frame.tileAt(40, 0)->x() == 40 * 256.0f - 10000.0f);
+
+  Frame* last = frame.tileAt(195, 0);
+  REQUIRE(last == nullptr);
+  frame.setViewPosition(49500.0f, 0.0f);
+  REQUIRE(frame.tileAt(195, 0)->width() == 50000.0f - 195 * 256.0f);
+}
+
+TEST_CASE("TiledFrame releases least recently seen tiles over its budget", "[ui]") {
+  TiledFrame frame;
+  frame.setContentSize(50000.0f, 200.0f);
+  frame.setBounds(0, 0, 500, 200);
+  REQUIRE(frame.numTiles() == 2);
+
+  frame.setMemoryBudget(5 * frame.tileBytes());
+  frame.setViewPosition(1000.0f, 0.0f);
+  frame.setViewPosition(2000.0f, 0.0f);
+  frame.setViewPosition(3000.0f, 0.0f);
+  REQUIRE(frame.numTiles() == 5);
+  REQUIRE(frame.tileMemory() <= frame.memoryBudget());
+  REQUIRE(frame.tileAt(0, 0) == nullptr);
+  REQUIRE(frame.tileAt(11, 0));
+
+  frame.invalidateContent({ 2000.0f, 0.0f, 10.0f, 10.0f });
+  REQUIRE(frame.tileAt(7, 0) == nullptr);
+  REQUIRE(frame.tileAt(11, 0));
+
+  frame.setMemoryBudget(0);
+  REQUIRE(frame.numTiles() == frame.numVisibleTiles());
+}
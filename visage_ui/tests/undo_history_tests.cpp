@@ -361,4 +361,65 @@ TEST_CASE("UndoHistory setup function integration", "[ui]") {
     history.redo();
     REQUIRE(setup_called);
   }
-}
\ No newline at end of file
+}
+
+TEST_CASE("UndoHistory merges value changes within a gesture", "[ui]") {
+  UndoHistory history;
+  TestListener listener;
+  history.addListener(&listener);
+  float value = 0.0f;
+  auto apply = [](void* context, const float& new_value) {
+    *static_cast<float*>(context) = new_value;
+  };
+
+  for (int i = 1; i <= 100; ++i) {
+    value = i;
+    history.pushValueChange<float>(1, &value, apply, i - 1.0f, value);
+  }
+  REQUIRE(history.numUndoActions() == 1);
+  REQUIRE(listener.action_added_count == 100);
+
+  history.finishMerging();
+  value = 200.0f;
+  history.pushValueChange<float>(1, &value, apply, 100.0f, 200.0f);
+  REQUIRE(history.numUndoActions() == 2);
+
+  history.pushValueChange<float>(2, &value, apply, 200.0f, 300.0f);
+  REQUIRE(history.numUndoActions() == 3);
+
+  history.undo();
+  history.undo();
+  REQUIRE(value == 100.0f);
+  history.undo();
+  REQUIRE(value == 0.0f);
+  history.redo();
+  REQUIRE(value == 100.0f);
+  REQUIRE(history.numRedoActions() == 2);
+}
+
+TEST_CASE("UndoHistory evicts oldest actions over budget", "[ui]") {
+  UndoHistory history;
+  int value = 0;
+  history.setMaxEntries(3);
+  for (int i = 0; i < 5; ++i)
+    history.push(std::make_unique<TestAction>(value, i, i + 1));
+
+  REQUIRE(history.numUndoActions() == 3);
+  history.undo();
+  history.undo();
+  history.undo();
+  REQUIRE(value == 2);
+  REQUIRE_FALSE(history.canUndo());
+
+  history.clearUndoHistory();
+  REQUIRE(history.memorySize() == 0);
+
+  size_t action_size = TestAction(value, 0, 0).memorySize();
+  history.setMaxEntries(UndoHistory::kMaxUndoHistory);
+  history.setMaxMemorySize(2 * action_size);
+  for (int i = 0; i < 4; ++i)
+    history.push(std::make_unique<TestAction>(value, i, i + 1));
+
+  REQUIRE(history.numUndoActions() == 2);
+  REQUIRE(history.memorySize() == 2 * action_size);
+}
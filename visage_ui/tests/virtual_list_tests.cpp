@@ -0,0 +1,105 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "visage_ui/virtual_list.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace visage;
+
+namespace {
+  class TestRow : public Frame {
+  public:
+    int index = -1;
+    int bind_count = 0;
+  };
+}
+
+TEST_CASE("VirtualListFrame only binds visible rows", "[ui]") {
+  VirtualListFrame list;
+  int created = 0;
+  list.setRowFactory([&created] {
+    created++;
+    return std::make_unique<TestRow>();
+  });
+  list.setRowBinder([](Frame* row, int index) {
+    auto test_row = static_cast<TestRow*>(row);
+    test_row->index = index;
+    test_row->bind_count++;
+  });
+  list.setRowHeight(20.0f);
+  list.setOverscan(2);
+  list.setNumItems(100000);
+  list.setBounds(0, 0, 100, 200);
+
+  REQUIRE(list.contentHeight() == 2000000.0f);
+  REQUIRE(list.firstBoundItem() == 0);
+  REQUIRE(list.numBoundItems() == 12);
+  REQUIRE(created == 12);
+
+  auto first_row = static_cast<TestRow*>(list.itemFrame(0));
+  REQUIRE(first_row);
+  REQUIRE(first_row->index == 0);
+  REQUIRE(list.itemFrame(20) == nullptr);
+
+  list.setYPosition(1000.0f);
+  REQUIRE(list.firstBoundItem() == 48);
+  REQUIRE(list.numBoundItems() == 14);
+  REQUIRE(list.poolSize() == 14);
+
+  auto row = static_cast<TestRow*>(list.itemFrame(55));
+  REQUIRE(row);
+  REQUIRE(row->index == 55);
+  REQUIRE(row->y() == 1100.0f);
+  REQUIRE(list.itemIndex(row) == 55);
+
+  int binds = row->bind_count;
+  list.setYPosition(1010.0f);
+  REQUIRE(list.itemFrame(55) == row);
+  REQUIRE(row->bind_count == binds);
+
+  list.refreshItem(55);
+  REQUIRE(row->bind_count == binds + 1);
+}
+
+TEST_CASE("VirtualListFrame lays out items in columns", "[ui]") {
+  VirtualListFrame list;
+  list.setRowFactory([] { return std::make_unique<Frame>(); });
+  list.setNumColumns(4);
+  list.setRowHeight(50.0f);
+  list.setOverscan(0);
+  list.setNumItems(10);
+  list.setBounds(0, 0, 200, 100);
+
+  REQUIRE(list.numRows() == 3);
+  REQUIRE(list.numBoundItems() == 8);
+
+  Frame* item = list.itemFrame(6);
+  REQUIRE(item);
+  REQUIRE(item->x() == 100.0f);
+  REQUIRE(item->y() == 50.0f);
+  REQUIRE(item->width() == 50.0f);
+
+  list.setNumItems(3);
+  REQUIRE(list.numBoundItems() == 3);
+  REQUIRE(list.itemFrame(6) == nullptr);
+  REQUIRE(list.poolSize() == 8);
+}
@@ -0,0 +1,179 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "tiled_frame.h"
+
+namespace visage {
+  void TiledFrame::setContentSize(float width, float height) {
+    if (width == content_width_ && height == content_height_)
+      return;
+
+    content_width_ = std::max(0.0f, width);
+    content_height_ = std::max(0.0f, height);
+    int columns = numColumns();
+    int rows = numRows();
+    for (auto it = tiles_.begin(); it != tiles_.end();) {
+      if (it->second->column >= columns || it->second->row >= rows)
+        it = releaseTile(it);
+      else
+        ++it;
+    }
+    updateTiles();
+  }
+
+  void TiledFrame::setViewPosition(float x, float y) {
+    if (x == view_x_ && y == view_y_)
+      return;
+
+    view_x_ = x;
+    view_y_ = y;
+    updateTiles();
+  }
+
+  void TiledFrame::setTileSize(float tile_size) {
+    tile_size = std::max(1.0f, tile_size);
+    if (tile_size == tile_size_)
+      return;
+
+    tile_size_ = tile_size;
+    for (auto it = tiles_.begin(); it != tiles_.end();)
+      it = releaseTile(it);
+    updateTiles();
+  }
+
+  void TiledFrame::invalidateContent(const Bounds& area) {
+    for (auto it = tiles_.begin(); it != tiles_.end();) {
+      Tile& tile = *it->second;
+      if (!tileBounds(tile.column, tile.row).overlaps(area))
+        ++it;
+      else if (inView(tile)) {
+        tile.redraw();
+        ++it;
+      }
+      else
+        it = releaseTile(it);
+    }
+  }
+
+  size_t TiledFrame::tileBytes() const {
+    size_t native_size = std::ceil(tile_size_ * dpiScale());
+    return native_size * native_size * 4;
+  }
+
+  Frame* TiledFrame::tileAt(int column, int row) const {
+    auto it = tiles_.find(tileKey(column, row));
+    return it == tiles_.end() ? nullptr : it->second.get();
+  }
+
+  Bounds TiledFrame::tileBounds(int column, int row) const {
+    float x = column * tile_size_;
+    float y = row * tile_size_;
+    return { x, y, std::min(tile_size_, content_width_ - x),
+             std::min(tile_size_, content_height_ - y) };
+  }
+
+  void TiledFrame::drawTile(Canvas& canvas, const Tile& tile) {
+    if (drawer_ == nullptr)
+      return;
+
+    Bounds area = tileBounds(tile.column, tile.row);
+    canvas.saveState();
+    canvas.setPosition(-area.x(), -area.y());
+    drawer_(canvas, area);
+    canvas.restoreState();
+  }
+
+  void TiledFrame::placeTile(Tile& tile) {
+    Bounds area = tileBounds(tile.column, tile.row);
+    tile.setBounds(area.x() - view_x_, area.y() - view_y_, area.width(), area.height());
+  }
+
+  TiledFrame::Tile* TiledFrame::createTile(int column, int row) {
+    std::unique_ptr<Tile> tile;
+    if (free_tiles_.empty())
+      tile = std::make_unique<Tile>(this);
+    else {
+      tile = std::move(free_tiles_.back());
+      free_tiles_.pop_back();
+    }
+
+    tile->column = column;
+    tile->row = row;
+    addChild(tile.get());
+    tile->redraw();
+    Tile* result = tile.get();
+    tiles_[tileKey(column, row)] = std::move(tile);
+    return result;
+  }
+
+  TiledFrame::TileMap::iterator TiledFrame::releaseTile(TileMap::iterator it) {
+    // Leaving the hierarchy releases the tile's space in its layer.
+    removeChild(it->second.get());
+    free_tiles_.push_back(std::move(it->second));
+    return tiles_.erase(it);
+  }
+
+  void TiledFrame::updateTiles() {
+    view_generation_++;
+    num_visible_tiles_ = 0;
+    if (width() > 0.0f && height() > 0.0f) {
+      int first_column = std::max(0, static_cast<int>(std::floor(view_x_ / tile_size_)));
+      int end_column = std::min(numColumns(),
+                                static_cast<int>(std::ceil((view_x_ + width()) / tile_size_)));
+      int first_row = std::max(0, static_cast<int>(std::floor(view_y_ / tile_size_)));
+      int end_row = std::min(numRows(), static_cast<int>(std::ceil((view_y_ + height()) / tile_size_)));
+
+      for (int row = first_row; row < end_row; ++row) {
+        for (int column = first_column; column < end_column; ++column) {
+          auto it = tiles_.find(tileKey(column, row));
+          Tile* tile = it == tiles_.end() ? createTile(column, row) : it->second.get();
+          tile->last_seen = view_generation_;
+          num_visible_tiles_++;
+        }
+      }
+    }
+
+    for (auto& tile : tiles_)
+      placeTile(*tile.second);
+    evictTiles();
+  }
+
+  void TiledFrame::evictTiles() {
+    size_t bytes = tileBytes();
+    size_t max_tiles = std::max<size_t>(num_visible_tiles_, bytes ? memory_budget_ / bytes : 0);
+    if (tiles_.size() <= max_tiles)
+      return;
+
+    eviction_order_.clear();
+    for (auto& tile : tiles_) {
+      if (!inView(*tile.second))
+        eviction_order_.push_back(tile.second.get());
+    }
+    std::sort(eviction_order_.begin(), eviction_order_.end(),
+              [](const Tile* a, const Tile* b) { return a->last_seen < b->last_seen; });
+
+    for (Tile* tile : eviction_order_) {
+      if (tiles_.size() <= max_tiles)
+        break;
+      releaseTile(tiles_.find(tileKey(tile->column, tile->row)));
+    }
+  }
+}
@@ -0,0 +1,131 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "frame.h"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace visage {
+  // Caches content far larger than a layer could hold, like a zoomable timeline, in fixed size
+  // tiles. Only tiles in view are created and drawn, each in its own cached layer, and they are
+  // only drawn again when their part of the content is invalidated. Scrolling moves tiles
+  // without redrawing them. Tiles scrolled out of view keep their pixels until the tiles use
+  // more than the memory budget, then the ones seen least recently are released.
+  class TiledFrame : public Frame {
+  public:
+    static constexpr float kDefaultTileSize = 256.0f;
+    static constexpr size_t kDefaultMemoryBudget = 64 * 1024 * 1024;
+
+    // Draws the content inside area, given in content coordinates. The canvas is positioned so
+    // content coordinates can be used directly.
+    using TileDrawer = std::function<void(Canvas& canvas, const Bounds& area)>;
+
+    explicit TiledFrame(const std::string& name = "") : Frame(name) { }
+
+    void resized() override { updateTiles(); }
+    void dpiChanged() override { updateTiles(); }
+
+    void setTileDrawer(TileDrawer drawer) {
+      drawer_ = std::move(drawer);
+      invalidateContent();
+    }
+
+    void setContentSize(float width, float height);
+    float contentWidth() const { return content_width_; }
+    float contentHeight() const { return content_height_; }
+    // Content position shown at the top left of the frame.
+    void setViewPosition(float x, float y);
+    float viewX() const { return view_x_; }
+    float viewY() const { return view_y_; }
+
+    void setTileSize(float tile_size);
+    float tileSize() const { return tile_size_; }
+    void setMemoryBudget(size_t bytes) {
+      memory_budget_ = bytes;
+      evictTiles();
+    }
+    size_t memoryBudget() const { return memory_budget_; }
+
+    // Redraws visible tiles overlapping area and releases the others.
+    void invalidateContent(const Bounds& area);
+    void invalidateContent() { invalidateContent({ 0.0f, 0.0f, content_width_, content_height_ }); }
+
+    int numColumns() const { return std::ceil(content_width_ / tile_size_); }
+    int numRows() const { return std::ceil(content_height_ / tile_size_); }
+    int numTiles() const { return tiles_.size(); }
+    int numVisibleTiles() const { return num_visible_tiles_; }
+    size_t tileBytes() const;
+    size_t tileMemory() const { return tiles_.size() * tileBytes(); }
+    Frame* tileAt(int column, int row) const;
+    Bounds tileBounds(int column, int row) const;
+
+  private:
+    class Tile : public Frame {
+    public:
+      explicit Tile(TiledFrame* owner) : owner_(owner) {
+        setCached(true);
+        setIgnoresMouseEvents(true, false);
+      }
+
+      void draw(Canvas& canvas) override { owner_->drawTile(canvas, *this); }
+
+      int column = 0;
+      int row = 0;
+      uint64_t last_seen = 0;
+
+    private:
+      TiledFrame* owner_ = nullptr;
+    };
+
+    using TileMap = std::unordered_map<uint64_t, std::unique_ptr<Tile>>;
+
+    static uint64_t tileKey(int column, int row) {
+      return (static_cast<uint64_t>(row) << 32) | static_cast<uint32_t>(column);
+    }
+
+    bool inView(const Tile& tile) const { return tile.last_seen == view_generation_; }
+    void drawTile(Canvas& canvas, const Tile& tile);
+    void placeTile(Tile& tile);
+    Tile* createTile(int column, int row);
+    TileMap::iterator releaseTile(TileMap::iterator it);
+    void updateTiles();
+    void evictTiles();
+
+    TileDrawer drawer_;
+    float content_width_ = 0.0f;
+    float content_height_ = 0.0f;
+    float view_x_ = 0.0f;
+    float view_y_ = 0.0f;
+    float tile_size_ = kDefaultTileSize;
+    size_t memory_budget_ = kDefaultMemoryBudget;
+    uint64_t view_generation_ = 0;
+    int num_visible_tiles_ = 0;
+    TileMap tiles_;
+    std::vector<std::unique_ptr<Tile>> free_tiles_;
+    std::vector<Tile*> eviction_order_;
+
+    VISAGE_LEAK_CHECKER(TiledFrame)
+  };
+}
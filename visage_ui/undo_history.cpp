@@ -21,14 +21,60 @@
 
 #include "undo_history.h"
 
+#include <algorithm>
+
 namespace visage {
   void UndoHistory::push(std::unique_ptr<UndoableAction> action) {
-    undone_actions_.clear();
-    if (actions_.size() >= kMaxUndoHistory)
-      actions_.pop_front();
+    clearRedoActions();
+
+    uint64_t merge_key = action->mergeKey();
+    if (merge_key && canMergeInto(merge_key)) {
+      UndoableAction* last = actions_.back().get();
+      size_t last_size = last->memorySize();
+      if (last->mergeWith(*action)) {
+        memory_size_ += last->memorySize() - last_size;
+        notifyActionAdded();
+        return;
+      }
+    }
 
+    memory_size_ += action->memorySize();
     actions_.push_back(std::move(action));
+    merge_open_ = merge_key != 0;
+    enforceBudget();
+    notifyActionAdded();
+  }
+
+  void UndoHistory::setMaxEntries(int max_entries) {
+    max_entries_ = std::max(1, max_entries);
+    enforceBudget();
+  }
+
+  void UndoHistory::setMaxMemorySize(size_t max_bytes) {
+    max_memory_size_ = max_bytes;
+    enforceBudget();
+  }
+
+  void UndoHistory::clearRedoActions() {
+    for (const auto& action : undone_actions_)
+      memory_size_ -= action->memorySize();
+    undone_actions_.clear();
+  }
+
+  void UndoHistory::enforceBudget() {
+    auto over_budget = [this] {
+      if (actions_.size() > max_entries_)
+        return true;
+      return max_memory_size_ && memory_size_ > max_memory_size_;
+    };
+
+    while (actions_.size() > 1 && over_budget()) {
+      memory_size_ -= actions_.front()->memorySize();
+      actions_.pop_front();
+    }
+  }
 
+  void UndoHistory::notifyActionAdded() {
     for (Listener* listener : listeners_)
       listener->undoActionAdded();
   }
@@ -37,6 +83,7 @@ namespace visage {
     if (!canUndo())
       return;
 
+    merge_open_ = false;
     std::unique_ptr<UndoableAction> action = std::move(actions_.back());
     actions_.pop_back();
     action->setup();
@@ -51,6 +98,7 @@ namespace visage {
     if (!canRedo())
       return;
 
+    merge_open_ = false;
     std::unique_ptr<UndoableAction> action = std::move(undone_actions_.back());
     undone_actions_.pop_back();
     action->setup();
@@ -21,9 +21,12 @@
 
 #pragma once
 
+#include <cstdint>
 #include <deque>
 #include <functional>
 #include <memory>
+#include <type_traits>
+#include <vector>
 
 namespace visage {
   class UndoableAction {
@@ -33,6 +36,12 @@ namespace visage {
 
     virtual ~UndoableAction() = default;
 
+    // Consecutive actions sharing a non-zero merge key are offered to mergeWith(), which folds
+    // the newer action into this one when it returns true.
+    virtual uint64_t mergeKey() const { return 0; }
+    virtual bool mergeWith(const UndoableAction& newer) { return false; }
+    virtual size_t memorySize() const { return sizeof(*this); }
+
     void setup() const {
       if (setup_)
         setup_();
@@ -51,12 +60,53 @@ namespace visage {
 
     void undo() override { undo_action_(); }
     void redo() override { redo_action_(); }
+    size_t memorySize() const override { return sizeof(*this); }
 
   private:
     std::function<void()> undo_action_;
     std::function<void()> redo_action_;
   };
 
+  template<typename T>
+  class ValueChangeAction : public UndoableAction {
+  public:
+    static_assert(std::is_trivially_copyable_v<T>, "ValueChangeAction stores plain values");
+    using Apply = void (*)(void* context, const T& value);
+
+    ValueChangeAction(uint64_t merge_key, void* context, Apply apply, const T& before,
+                      const T& after) :
+        merge_key_(merge_key), context_(context), apply_(apply), before_(before), after_(after) { }
+
+    void undo() override { apply_(context_, before_); }
+    void redo() override { apply_(context_, after_); }
+    uint64_t mergeKey() const override { return merge_key_; }
+    size_t memorySize() const override { return sizeof(*this); }
+
+    bool mergeWith(const UndoableAction& newer) override {
+      auto other = dynamic_cast<const ValueChangeAction*>(&newer);
+      if (other == nullptr || !matches(other->merge_key_, other->context_, other->apply_))
+        return false;
+
+      after_ = other->after_;
+      return true;
+    }
+
+    bool matches(uint64_t merge_key, void* context, Apply apply) const {
+      return merge_key == merge_key_ && context == context_ && apply == apply_;
+    }
+
+    void setAfter(const T& after) { after_ = after; }
+    const T& before() const { return before_; }
+    const T& after() const { return after_; }
+
+  private:
+    uint64_t merge_key_ = 0;
+    void* context_ = nullptr;
+    Apply apply_ = nullptr;
+    T before_;
+    T after_;
+  };
+
   class UndoHistory {
   public:
     static constexpr int kMaxUndoHistory = 1000;
@@ -72,6 +122,28 @@ namespace visage {
     UndoHistory() = default;
 
     void push(std::unique_ptr<UndoableAction> action);
+
+    // Records a change of a plain value. While the newest action is a matching value change that
+    // can still be merged, it is updated in place and nothing is allocated.
+    template<typename T>
+    void pushValueChange(uint64_t merge_key, void* context,
+                         typename ValueChangeAction<T>::Apply apply, const T& before,
+                         const T& after) {
+      if (merge_key && canMergeInto(merge_key)) {
+        auto last = dynamic_cast<ValueChangeAction<T>*>(actions_.back().get());
+        if (last && last->matches(merge_key, context, apply)) {
+          last->setAfter(after);
+          notifyActionAdded();
+          return;
+        }
+      }
+      push(std::make_unique<ValueChangeAction<T>>(merge_key, context, apply, before, after));
+    }
+
+    // Ends the current merge run, e.g. at the end of a drag gesture, so the next action with the
+    // same merge key starts a new undo step.
+    void finishMerging() { merge_open_ = false; }
+
     void undo();
     void redo();
     bool canUndo() const { return !actions_.empty(); }
@@ -79,8 +151,18 @@ namespace visage {
     void clearUndoHistory() {
       actions_.clear();
       undone_actions_.clear();
+      memory_size_ = 0;
+      merge_open_ = false;
     }
 
+    void setMaxEntries(int max_entries);
+    int maxEntries() const { return max_entries_; }
+    void setMaxMemorySize(size_t max_bytes);
+    size_t maxMemorySize() const { return max_memory_size_; }
+    size_t memorySize() const { return memory_size_; }
+    int numUndoActions() const { return actions_.size(); }
+    int numRedoActions() const { return undone_actions_.size(); }
+
     UndoableAction* peekUndo() const {
       if (actions_.empty())
         return nullptr;
@@ -91,8 +173,19 @@ namespace visage {
     void addListener(Listener* listener) { listeners_.push_back(listener); }
 
   private:
+    bool canMergeInto(uint64_t merge_key) const {
+      return merge_open_ && !actions_.empty() && actions_.back()->mergeKey() == merge_key;
+    }
+    void clearRedoActions();
+    void enforceBudget();
+    void notifyActionAdded();
+
     std::deque<std::unique_ptr<UndoableAction>> actions_;
     std::deque<std::unique_ptr<UndoableAction>> undone_actions_;
     std::vector<Listener*> listeners_;
+    int max_entries_ = kMaxUndoHistory;
+    size_t max_memory_size_ = 0;
+    size_t memory_size_ = 0;
+    bool merge_open_ = false;
   };
 }
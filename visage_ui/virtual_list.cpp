@@ -0,0 +1,186 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "virtual_list.h"
+
+namespace visage {
+  VirtualListFrame::VirtualListFrame(const std::string& name) : ScrollableFrame(name) {
+    content_.setIgnoresMouseEvents(true, true);
+    addScrolledChild(&content_);
+  }
+
+  void VirtualListFrame::resized() {
+    updateContentBounds();
+    ScrollableFrame::resized();
+    updateRows();
+  }
+
+  void VirtualListFrame::setRowFactory(RowFactory factory) {
+    for (auto& row : pool_)
+      content_.removeChild(row.frame.get());
+
+    pool_.clear();
+    window_.clear();
+    row_factory_ = std::move(factory);
+    updateRows();
+  }
+
+  void VirtualListFrame::setNumItems(int num_items) {
+    num_items_ = std::max(0, num_items);
+    unbindAll();
+    updateContentBounds();
+    updateRows();
+  }
+
+  void VirtualListFrame::setRowHeight(float row_height) {
+    row_height_ = std::max(1.0f, row_height);
+    updateContentBounds();
+    updateRows();
+  }
+
+  void VirtualListFrame::setNumColumns(int num_columns) {
+    num_columns_ = std::max(1, num_columns);
+    updateContentBounds();
+    updateRows();
+  }
+
+  void VirtualListFrame::setOverscan(int rows) {
+    overscan_ = std::max(0, rows);
+    updateRows();
+  }
+
+  void VirtualListFrame::refresh() {
+    for (int slot : window_)
+      bindRow(pool_[slot], pool_[slot].index);
+  }
+
+  void VirtualListFrame::refreshItem(int index) {
+    int window_index = index - first_item_;
+    if (window_index >= 0 && window_index < window_.size())
+      bindRow(pool_[window_[window_index]], index);
+  }
+
+  void VirtualListFrame::scrollToItem(int index) {
+    if (index < 0 || index >= num_items_)
+      return;
+
+    float top = (index / num_columns_) * row_height_;
+    if (top < yPosition())
+      setYPosition(top);
+    else if (top + row_height_ > yPosition() + height())
+      setYPosition(top + row_height_ - height());
+  }
+
+  Frame* VirtualListFrame::itemFrame(int index) const {
+    int window_index = index - first_item_;
+    if (window_index < 0 || window_index >= window_.size())
+      return nullptr;
+    return pool_[window_[window_index]].frame.get();
+  }
+
+  int VirtualListFrame::itemIndex(const Frame* frame) const {
+    for (const auto& row : pool_) {
+      if (row.frame.get() == frame)
+        return row.index;
+    }
+    return -1;
+  }
+
+  Bounds VirtualListFrame::itemBounds(int index) const {
+    float item_width = content_.width() / num_columns_;
+    int row = index / num_columns_;
+    int column = index % num_columns_;
+    return { column * item_width, row * row_height_, item_width, row_height_ };
+  }
+
+  int VirtualListFrame::createRow() {
+    std::unique_ptr<Frame> frame = row_factory_();
+    content_.addChild(frame.get(), false);
+    pool_.push_back({ std::move(frame), -1 });
+    return pool_.size() - 1;
+  }
+
+  void VirtualListFrame::bindRow(PooledRow& row, int index) {
+    row.index = index;
+    row.frame->setBounds(itemBounds(index));
+    row.frame->setVisible(true);
+    if (row_binder_)
+      row_binder_(row.frame.get(), index);
+    row.frame->redraw();
+  }
+
+  void VirtualListFrame::unbindAll() {
+    for (auto& row : pool_)
+      row.index = -1;
+    window_.clear();
+  }
+
+  void VirtualListFrame::updateContentBounds() {
+    content_.setBounds(0, 0, width(), contentHeight());
+  }
+
+  void VirtualListFrame::updateRows() {
+    int first_row = 0;
+    int end_row = 0;
+    if (row_factory_ && height() > 0) {
+      first_row = std::max(0, static_cast<int>(yPosition() / row_height_) - overscan_);
+      int last_visible = static_cast<int>(std::ceil((yPosition() + height()) / row_height_));
+      end_row = std::max(first_row, std::min(numRows(), last_visible + overscan_));
+    }
+
+    int first_item = first_row * num_columns_;
+    int end_item = std::min(num_items_, end_row * num_columns_);
+    int num_window = std::max(0, end_item - first_item);
+
+    free_rows_.clear();
+    window_.assign(num_window, -1);
+    for (int slot = 0; slot < pool_.size(); ++slot) {
+      int index = pool_[slot].index;
+      if (index >= first_item && index < end_item)
+        window_[index - first_item] = slot;
+      else
+        free_rows_.push_back(slot);
+    }
+
+    first_item_ = first_item;
+    for (int i = 0; i < num_window; ++i) {
+      int slot = window_[i];
+      if (slot >= 0) {
+        pool_[slot].frame->setBounds(itemBounds(first_item + i));
+        continue;
+      }
+
+      if (free_rows_.empty())
+        slot = createRow();
+      else {
+        slot = free_rows_.back();
+        free_rows_.pop_back();
+      }
+      window_[i] = slot;
+      bindRow(pool_[slot], first_item + i);
+    }
+
+    for (int slot : free_rows_) {
+      pool_[slot].index = -1;
+      pool_[slot].frame->setVisible(false);
+    }
+  }
+}
@@ -0,0 +1,96 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "scroll_bar.h"
+
+namespace visage {
+  class VirtualListFrame : public ScrollableFrame {
+  public:
+    static constexpr int kDefaultOverscan = 2;
+    static constexpr float kDefaultRowHeight = 24.0f;
+
+    using RowFactory = std::function<std::unique_ptr<Frame>()>;
+    using RowBinder = std::function<void(Frame* row, int index)>;
+
+    explicit VirtualListFrame(const std::string& name = "");
+
+    void resized() override;
+    void scrolled() override { updateRows(); }
+
+    void setRowFactory(RowFactory factory);
+    void setRowBinder(RowBinder binder) {
+      row_binder_ = std::move(binder);
+      refresh();
+    }
+
+    void setNumItems(int num_items);
+    int numItems() const { return num_items_; }
+    void setRowHeight(float row_height);
+    float rowHeight() const { return row_height_; }
+    void setNumColumns(int num_columns);
+    int numColumns() const { return num_columns_; }
+    void setOverscan(int rows);
+    int overscan() const { return overscan_; }
+
+    int numRows() const { return (num_items_ + num_columns_ - 1) / num_columns_; }
+    float contentHeight() const { return numRows() * row_height_; }
+
+    void refresh();
+    void refreshItem(int index);
+    void scrollToItem(int index);
+
+    int firstBoundItem() const { return first_item_; }
+    int numBoundItems() const { return window_.size(); }
+    int poolSize() const { return pool_.size(); }
+    Frame* itemFrame(int index) const;
+    int itemIndex(const Frame* frame) const;
+
+  private:
+    struct PooledRow {
+      std::unique_ptr<Frame> frame;
+      int index = -1;
+    };
+
+    Bounds itemBounds(int index) const;
+    int createRow();
+    void bindRow(PooledRow& row, int index);
+    void unbindAll();
+    void updateContentBounds();
+    void updateRows();
+
+    RowFactory row_factory_;
+    RowBinder row_binder_;
+    int num_items_ = 0;
+    int num_columns_ = 1;
+    int overscan_ = kDefaultOverscan;
+    float row_height_ = kDefaultRowHeight;
+
+    Frame content_;
+    std::vector<PooledRow> pool_;
+    std::vector<int> window_;
+    std::vector<int> free_rows_;
+    int first_item_ = 0;
+
+    VISAGE_LEAK_CHECKER(VirtualListFrame)
+  };
+}
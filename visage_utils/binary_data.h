@@ -0,0 +1,95 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace visage {
+  // Appends trivially copyable values to a byte buffer in host byte order. Used for compact
+  // binary formats that are read back with BinaryReader.
+  class BinaryWriter {
+  public:
+    explicit BinaryWriter(std::vector<unsigned char>& data) : data_(data) { }
+
+    template<typename T>
+    void write(const T& value) {
+      static_assert(std::is_trivially_copyable_v<T>, "Binary values must be trivially copyable");
+      const auto* bytes = reinterpret_cast<const unsigned char*>(&value);
+      data_.insert(data_.end(), bytes, bytes + sizeof(T));
+    }
+
+    void writeString(const std::string& value) {
+      write(static_cast<unsigned int>(value.size()));
+      data_.insert(data_.end(), value.begin(), value.end());
+    }
+
+    size_t size() const { return data_.size(); }
+
+  private:
+    std::vector<unsigned char>& data_;
+  };
+
+  // Reads values written by BinaryWriter straight out of a borrowed buffer, such as a memory
+  // mapped or embedded file. Reads past the end fail and leave the reader failed.
+  class BinaryReader {
+  public:
+    BinaryReader(const unsigned char* data, size_t size) : position_(data), end_(data + size) { }
+
+    template<typename T>
+    bool read(T& value) {
+      static_assert(std::is_trivially_copyable_v<T>, "Binary values must be trivially copyable");
+      if (!canRead(sizeof(T)))
+        return fail();
+      std::memcpy(&value, position_, sizeof(T));
+      position_ += sizeof(T);
+      return true;
+    }
+
+    bool readString(std::string& value) {
+      unsigned int length = 0;
+      if (!read(length) || !canRead(length))
+        return fail();
+      value.assign(reinterpret_cast<const char*>(position_), length);
+      position_ += length;
+      return true;
+    }
+
+    bool canRead(size_t bytes) const {
+      return position_ && bytes <= static_cast<size_t>(end_ - position_);
+    }
+    bool failed() const { return position_ == nullptr; }
+    bool atEnd() const { return !failed() && position_ == end_; }
+
+    bool fail() {
+      position_ = nullptr;
+      end_ = nullptr;
+      return false;
+    }
+
+  private:
+    const unsigned char* position_ = nullptr;
+    const unsigned char* end_ = nullptr;
+  };
+}
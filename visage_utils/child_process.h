@@ -21,12 +21,156 @@
 
 #pragma once
 
+#include "thread_utils.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
 
 namespace visage {
   static constexpr int kDefaultChildProcessTimeoutMs = 10000;
   static constexpr size_t kMaxOutputSize = 1024 * 1024;
 
+  // The process is terminated and false returned if cancel becomes true before it exits.
   bool spawnChildProcess(const std::string& command, const std::string& arguments,
-                         std::string& output, int timeout_ms = kDefaultChildProcessTimeoutMs);
+                         std::string& output, int timeout_ms = kDefaultChildProcessTimeoutMs,
+                         const std::atomic<bool>* cancel = nullptr);
+
+  // Runs a process without blocking the caller. A monitor thread waits on the process's stdout
+  // and stderr pipes and streams each chunk to the callbacks as it arrives, then reports how the
+  // process ended. Give a dispatcher to run callbacks elsewhere, like runOnEventThread for the
+  // UI thread. Without one they run on the monitor thread.
+  class ChildProcess {
+  public:
+    static constexpr int kNoTimeout = -1;
+
+    enum class Result {
+      NotStarted,
+      Running,
+      Exited,
+      TimedOut,
+      Killed,
+    };
+
+    using OutputCallback = std::function<void(const std::string& output)>;
+    using ExitCallback = std::function<void(Result result, int exit_code)>;
+    using Dispatcher = std::function<void(std::function<void()> callback)>;
+
+    struct Options {
+      OutputCallback on_output;
+      OutputCallback on_error;
+      ExitCallback on_exit;
+      int timeout_ms = kNoTimeout;
+      Dispatcher dispatcher;
+    };
+
+    ChildProcess();
+    ~ChildProcess();
+
+    ChildProcess(const ChildProcess&) = delete;
+    ChildProcess& operator=(const ChildProcess&) = delete;
+
+    // Returns false if a process is already running or this one couldn't be started.
+    bool start(const std::string& command, const std::string& arguments, Options options);
+    // Terminates the process. Doesn't block, so it's safe to call from a callback.
+    void kill();
+
+    // Returns false if the process is still running or on_exit hasn't been dispatched after the
+    // timeout. Don't call from a callback running on the monitor thread.
+    bool waitForExit(int ms_timeout = -1) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      auto exited = [this] { return exit_reported_; };
+      if (ms_timeout < 0) {
+        exit_condition_.wait(lock, exited);
+        return true;
+      }
+      return exit_condition_.wait_for(lock, std::chrono::milliseconds(ms_timeout), exited);
+    }
+
+    bool running() const {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return result_ == Result::Running;
+    }
+
+    Result result() const {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return result_;
+    }
+
+    // The process's exit code, or -1 if it didn't exit on its own.
+    int exitCode() const {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return exit_code_;
+    }
+
+  private:
+    struct Handles;
+
+    void monitor();
+    void joinMonitor();
+
+    void dispatch(std::function<void()> callback) const {
+      if (options_.dispatcher)
+        options_.dispatcher(std::move(callback));
+      else
+        callback();
+    }
+
+    void deliverOutput(const OutputCallback& callback, const char* data, size_t size) const {
+      if (callback && size)
+        dispatch([callback, output = std::string(data, size)] { callback(output); });
+    }
+
+    // The state is updated before on_exit runs so the callback sees the process as ended and
+    // can start the next one. waitForExit() returns once on_exit has been dispatched.
+    void finish(Result result, int exit_code) {
+      int run = 0;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        result_ = result;
+        exit_code_ = exit_code;
+        run = run_;
+      }
+
+      if (options_.on_exit)
+        dispatch([callback = options_.on_exit, result, exit_code] { callback(result, exit_code); });
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (run_ == run)
+        exit_reported_ = true;
+      exit_condition_.notify_all();
+    }
+
+    // on_exit can start the next process from the monitor thread, which can't join itself, so
+    // that thread is kept and joined by the next call from another thread.
+    void stopMonitorThread() {
+      if (finished_monitor_thread_ && !finished_monitor_thread_->isCurrentThread()) {
+        finished_monitor_thread_->stop();
+        finished_monitor_thread_ = nullptr;
+      }
+
+      if (monitor_thread_ && monitor_thread_->isCurrentThread())
+        finished_monitor_thread_ = std::move(monitor_thread_);
+      else if (monitor_thread_) {
+        monitor_thread_->stop();
+        monitor_thread_ = nullptr;
+      }
+    }
+
+    Options options_;
+    std::unique_ptr<Handles> handles_;
+    std::unique_ptr<Thread> monitor_thread_;
+    std::unique_ptr<Thread> finished_monitor_thread_;
+    mutable std::mutex mutex_;
+    std::condition_variable exit_condition_;
+    Result result_ = Result::NotStarted;
+    int exit_code_ = -1;
+    int run_ = 0;
+    bool exit_reported_ = true;
+    std::atomic<bool> kill_requested_ = false;
+  };
 }
@@ -21,140 +21,89 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <functional>
+#include <memory>
 
 namespace visage {
 
+  // Plain units are evaluated with a switch and take no allocation. Combined dimensions share an
+  // immutable expression node, so copying any Dimension is at most a reference count bump.
   struct Dimension {
+    using ComputeFunction = std::function<float(float, float, float, float)>;
+
+    enum class Type : uint8_t {
+      None,
+      NativePixels,
+      LogicalPixels,
+      WidthPercent,
+      HeightPercent,
+      ViewMinPercent,
+      ViewMaxPercent,
+      Sum,
+      Min,
+      Max,
+      Custom,
+    };
+
+    struct Expression;
+
+    Type type = Type::None;
     float amount = 0.0f;
-    std::function<float(float, float, float, float)> compute_function = nullptr;
+    std::shared_ptr<const Expression> expression;
 
-    float compute(float dpi_scale, float parent_width, float parent_height, float default_value = 0.0f) const {
-      if (compute_function)
-        return compute_function(amount, dpi_scale, parent_width, parent_height);
-      return default_value;
-    }
+    float compute(float dpi_scale, float parent_width, float parent_height,
+                  float default_value = 0.0f) const;
 
     int computeInt(float dpi_scale, float parent_width, float parent_height, int default_value = 0) const {
-      if (compute_function)
-        return std::round(compute_function(amount, dpi_scale, parent_width, parent_height));
-      return default_value;
+      if (type == Type::None)
+        return default_value;
+      return std::round(compute(dpi_scale, parent_width, parent_height));
     }
 
     Dimension() = default;
-    Dimension(float amount) { *this = logicalPixels(amount); }
-    Dimension(float amount, std::function<float(float, float, float, float)> compute) :
-        amount(amount), compute_function(std::move(compute)) { }
+    Dimension(float amount) : type(Type::LogicalPixels), amount(amount) { }
+    Dimension(float amount, ComputeFunction compute);
+    Dimension(Type type, float amount) : type(type), amount(amount) { }
 
-    static Dimension nativePixels(float pixels) {
-      return Dimension(pixels, [](float amount, float, float, float) { return amount; });
-    }
+    static Dimension nativePixels(float pixels) { return { Type::NativePixels, pixels }; }
 
-    static Dimension logicalPixels(float pixels) {
-      return Dimension(pixels, [](float amount, float scale, float, float) { return scale * amount; });
-    }
+    static Dimension logicalPixels(float pixels) { return { Type::LogicalPixels, pixels }; }
 
     static Dimension widthPercent(float percent) {
-      float ratio = percent * 0.01f;
-      return Dimension(ratio, [](float amount, float, float parent_width, float) {
-        return amount * parent_width;
-      });
+      return { Type::WidthPercent, percent * 0.01f };
     }
 
     static Dimension heightPercent(float percent) {
-      float ratio = percent * 0.01f;
-      return Dimension(ratio, [](float amount, float, float, float parent_height) {
-        return amount * parent_height;
-      });
+      return { Type::HeightPercent, percent * 0.01f };
     }
 
     static Dimension viewMinPercent(float percent) {
-      float ratio = percent * 0.01f;
-      return Dimension(ratio, [](float amount, float, float parent_width, float parent_height) {
-        return amount * std::min(parent_width, parent_height);
-      });
+      return { Type::ViewMinPercent, percent * 0.01f };
     }
 
     static Dimension viewMaxPercent(float percent) {
-      float ratio = percent * 0.01f;
-      return Dimension(ratio, [](float amount, float, float parent_width, float parent_height) {
-        return amount * std::max(parent_width, parent_height);
-      });
+      return { Type::ViewMaxPercent, percent * 0.01f };
     }
 
     static Dimension min(const Dimension& a, const Dimension& b) {
-      if (a.compute_function == nullptr)
-        return b;
-      if (b.compute_function == nullptr)
-        return a;
-
-      auto amount1 = a.amount;
-      auto amount2 = b.amount;
-      auto compute1 = a.compute_function;
-      auto compute2 = b.compute_function;
-      return Dimension(0.0f, [amount1, amount2, compute1,
-                              compute2](float, float dpi_scale, float parent_width, float parent_height) {
-        return std::min(compute1(amount1, dpi_scale, parent_width, parent_height),
-                        compute2(amount2, dpi_scale, parent_width, parent_height));
-      });
+      return combine(Type::Min, a, b);
     }
 
     static Dimension max(const Dimension& a, const Dimension& b) {
-      if (a.compute_function == nullptr)
-        return b;
-      if (b.compute_function == nullptr)
-        return a;
-
-      auto amount1 = a.amount;
-      auto amount2 = b.amount;
-      auto compute1 = a.compute_function;
-      auto compute2 = b.compute_function;
-      return Dimension(0.0f, [amount1, amount2, compute1,
-                              compute2](float, float dpi_scale, float parent_width, float parent_height) {
-        return std::max(compute1(amount1, dpi_scale, parent_width, parent_height),
-                        compute2(amount2, dpi_scale, parent_width, parent_height));
-      });
-    }
-
-    Dimension operator+(const Dimension& other) const {
-      if (compute_function == nullptr)
-        return other;
-      if (other.compute_function == nullptr)
-        return *this;
-
-      auto amount1 = amount;
-      auto amount2 = other.amount;
-      auto compute1 = compute_function;
-      auto compute2 = other.compute_function;
-      return Dimension(0.0f, [amount1, amount2, compute1,
-                              compute2](float, float dpi_scale, float parent_width, float parent_height) {
-        return compute1(amount1, dpi_scale, parent_width, parent_height) +
-               compute2(amount2, dpi_scale, parent_width, parent_height);
-      });
+      return combine(Type::Max, a, b);
     }
 
+    Dimension operator+(const Dimension& other) const { return combine(Type::Sum, *this, other); }
+
     Dimension& operator+=(const Dimension& other) {
       *this = *this + other;
       return *this;
     }
 
-    Dimension operator-(const Dimension& other) const {
-      if (compute_function == nullptr)
-        return -other;
-      if (other.compute_function == nullptr)
-        return *this;
-
-      auto amount1 = amount;
-      auto amount2 = other.amount;
-      auto compute1 = compute_function;
-      auto compute2 = other.compute_function;
-      return Dimension(0.0f, [amount1, amount2, compute1,
-                              compute2](float, float dpi_scale, float parent_width, float parent_height) {
-        return compute1(amount1, dpi_scale, parent_width, parent_height) -
-               compute2(amount2, dpi_scale, parent_width, parent_height);
-      });
-    }
+    Dimension operator-(const Dimension& other) const { return *this + -other; }
 
     Dimension& operator-=(const Dimension& other) {
       *this = *this - other;
@@ -162,15 +111,9 @@ namespace visage {
     }
 
     Dimension operator*(float scalar) const {
-      if (compute_function == nullptr)
-        return *this;
-
-      auto amount1 = amount;
-      auto compute1 = compute_function;
-      return Dimension(amount1, [compute1, scalar](float amount, float dpi_scale,
-                                                   float parent_width, float parent_height) {
-        return scalar * compute1(amount, dpi_scale, parent_width, parent_height);
-      });
+      Dimension result = *this;
+      result.amount *= scalar;
+      return result;
     }
 
     friend Dimension operator*(float scalar, const Dimension& dimension) {
@@ -184,8 +127,63 @@ namespace visage {
     Dimension min(const Dimension& other) const { return min(*this, other); }
 
     Dimension max(const Dimension& other) const { return max(*this, other); }
+
+  private:
+    static Dimension combine(Type type, const Dimension& a, const Dimension& b);
+  };
+
+  struct Dimension::Expression {
+    Dimension first;
+    Dimension second;
+    ComputeFunction function;
+    float function_amount = 0.0f;
   };
 
+  inline Dimension::Dimension(float amount, ComputeFunction compute) {
+    if (compute == nullptr)
+      return;
+
+    type = Type::Custom;
+    this->amount = 1.0f;
+    expression = std::make_shared<Expression>(Expression { {}, {}, std::move(compute), amount });
+  }
+
+  inline Dimension Dimension::combine(Type type, const Dimension& a, const Dimension& b) {
+    if (a.type == Type::None)
+      return b;
+    if (b.type == Type::None)
+      return a;
+
+    Dimension result(type, 1.0f);
+    result.expression = std::make_shared<Expression>(Expression { a, b, nullptr, 0.0f });
+    return result;
+  }
+
+  inline float Dimension::compute(float dpi_scale, float parent_width, float parent_height,
+                                  float default_value) const {
+    switch (type) {
+    case Type::None: return default_value;
+    case Type::NativePixels: return amount;
+    case Type::LogicalPixels: return amount * dpi_scale;
+    case Type::WidthPercent: return amount * parent_width;
+    case Type::HeightPercent: return amount * parent_height;
+    case Type::ViewMinPercent: return amount * std::min(parent_width, parent_height);
+    case Type::ViewMaxPercent: return amount * std::max(parent_width, parent_height);
+    case Type::Custom:
+      return amount * expression->function(expression->function_amount, dpi_scale, parent_width,
+                                           parent_height);
+    default: break;
+    }
+
+    float first = expression->first.compute(dpi_scale, parent_width, parent_height);
+    float second = expression->second.compute(dpi_scale, parent_width, parent_height);
+    if (type == Type::Min)
+      return amount * std::min(first, second);
+    if (type == Type::Max)
+      return amount * std::max(first, second);
+    return amount * (first + second);
+  }
+
   namespace dimension {
     inline Dimension operator""_npx(long double pixels) {
       return Dimension::nativePixels(pixels);
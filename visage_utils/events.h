@@ -21,11 +21,10 @@
 
 #pragma once
 
-#include "clone_ptr.h"
-
 #include <algorithm>
 #include <functional>
 #include <memory>
+#include <vector>
 
 namespace visage {
   static constexpr int kUnprintableKeycodeMask = 1 << 30;
@@ -340,21 +339,23 @@ namespace visage {
     CallbackList() = default;
 
     explicit CallbackList(std::function<T> callback) :
-        original_(std::make_unique<std::function<T>>(callback)) {
-      add(callback);
-    }
+        original_(std::move(callback)), uses_original_(static_cast<bool>(original_)) { }
 
     CallbackList(const CallbackList& other) = default;
     CallbackList& operator=(const CallbackList& other) = default;
 
-    void add(std::function<T> callback) { callbacks_.push_back(std::move(callback)); }
+    void add(std::function<T> callback) {
+      detachOriginal();
+      callbacks_.push_back(std::move(callback));
+    }
 
     CallbackList& operator+=(std::function<T> callback) {
-      add(callback);
+      add(std::move(callback));
       return *this;
     }
 
     void set(std::function<T> callback) {
+      uses_original_ = false;
       callbacks_.clear();
       callbacks_.push_back(std::move(callback));
     }
@@ -369,6 +370,7 @@ namespace visage {
         return other.target_type() == callback.target_type();
       };
 
+      detachOriginal();
       auto it = std::remove_if(callbacks_.begin(), callbacks_.end(), compare);
       callbacks_.erase(it, callbacks_.end());
     }
@@ -380,14 +382,21 @@ namespace visage {
 
     void reset() {
       callbacks_.clear();
-      if (original_)
-        callbacks_.push_back(*original_);
+      uses_original_ = static_cast<bool>(original_);
+    }
+
+    void clear() {
+      uses_original_ = false;
+      callbacks_.clear();
     }
 
-    void clear() { callbacks_.clear(); }
+    bool usesOriginal() const { return uses_original_; }
 
     template<typename... Args>
     auto callback(Args&&... args) const {
+      if (uses_original_)
+        return original_(std::forward<Args>(args)...);
+
       if (callbacks_.empty())
         return defaultResult<decltype(std::declval<std::function<T>>()(args...))>();
 
@@ -398,7 +407,15 @@ namespace visage {
     }
 
   private:
-    clone_ptr<std::function<T>> original_;
+    void detachOriginal() {
+      if (uses_original_) {
+        uses_original_ = false;
+        callbacks_.push_back(original_);
+      }
+    }
+
+    std::function<T> original_;
     std::vector<std::function<T>> callbacks_;
+    bool uses_original_ = false;
   };
 }
@@ -21,6 +21,7 @@
 
 #include "file_system.h"
 
+#include <cctype>
 #include <chrono>
 #include <fstream>
 #include <regex>
@@ -31,10 +32,17 @@
 #include <windows.h>
 #elif VISAGE_MAC
 #include <dlfcn.h>
+#include <fcntl.h>
 #include <mach-o/dyld.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #else
 #include <cstdlib>
 #include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 static visage::File xdgFolder(const char* env_var, const char* default_folder) {
@@ -110,6 +118,59 @@ namespace visage {
     return data;
   }
 
+  MappedFile::MappedFile(const File& file) {
+#if VISAGE_WINDOWS
+    HANDLE file_handle = CreateFileW(file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                     OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_handle != INVALID_HANDLE_VALUE) {
+      LARGE_INTEGER file_size;
+      if (GetFileSizeEx(file_handle, &file_size) && file_size.QuadPart > 0) {
+        HANDLE mapping = CreateFileMappingW(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) {
+          void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+          CloseHandle(mapping);
+          if (view) {
+            data_ = static_cast<const unsigned char*>(view);
+            size_ = file_size.QuadPart;
+            mapped_ = true;
+          }
+        }
+      }
+      CloseHandle(file_handle);
+    }
+#else
+    int descriptor = open(file.c_str(), O_RDONLY);
+    if (descriptor >= 0) {
+      struct stat info;
+      if (fstat(descriptor, &info) == 0 && info.st_size > 0) {
+        void* view = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (view != MAP_FAILED) {
+          data_ = static_cast<const unsigned char*>(view);
+          size_ = info.st_size;
+          mapped_ = true;
+        }
+      }
+      close(descriptor);
+    }
+#endif
+
+    if (!mapped_) {
+      loaded_data_ = loadFileData(file, size_);
+      data_ = loaded_data_.get();
+    }
+  }
+
+  MappedFile::~MappedFile() {
+    if (!mapped_)
+      return;
+
+#if VISAGE_WINDOWS
+    UnmapViewOfFile(data_);
+#else
+    munmap(const_cast<unsigned char*>(data_), size_);
+#endif
+  }
+
   std::string loadFileAsString(const File& file) {
     std::ifstream stream(file, std::ios::binary);
     if (!stream)
@@ -243,4 +304,214 @@ namespace visage {
 
     return matches;
   }
+
+  static bool charactersMatch(char a, char b, bool case_sensitive) {
+    if (case_sensitive)
+      return a == b;
+    return std::tolower(static_cast<unsigned char>(a)) ==
+           std::tolower(static_cast<unsigned char>(b));
+  }
+
+  FileNameMatcher::FileNameMatcher(std::string glob, std::vector<std::string> extensions,
+                                   bool case_sensitive) :
+      glob_(std::move(glob)), extensions_(std::move(extensions)), case_sensitive_(case_sensitive) {
+    for (std::string& extension : extensions_) {
+      if (!extension.empty() && extension[0] != '.')
+        extension = "." + extension;
+    }
+  }
+
+  bool FileNameMatcher::matches(const std::string& file_name) const {
+    return (glob_.empty() || matchesGlob(file_name)) &&
+           (extensions_.empty() || matchesExtension(file_name));
+  }
+
+  bool FileNameMatcher::matchesGlob(const std::string& file_name) const {
+    size_t glob_index = 0;
+    size_t name_index = 0;
+    size_t star = std::string::npos;
+    size_t star_name_index = 0;
+
+    while (name_index < file_name.size()) {
+      bool in_glob = glob_index < glob_.size();
+      char character = in_glob ? glob_[glob_index] : 0;
+      if (in_glob && character == '*') {
+        star = glob_index++;
+        star_name_index = name_index;
+      }
+      else if (in_glob && (character == '?' ||
+                           charactersMatch(character, file_name[name_index], case_sensitive_))) {
+        glob_index++;
+        name_index++;
+      }
+      else if (star != std::string::npos) {
+        glob_index = star + 1;
+        name_index = ++star_name_index;
+      }
+      else
+        return false;
+    }
+
+    while (glob_index < glob_.size() && glob_[glob_index] == '*')
+      glob_index++;
+    return glob_index == glob_.size();
+  }
+
+  bool FileNameMatcher::matchesExtension(const std::string& file_name) const {
+    for (const std::string& extension : extensions_) {
+      if (extension.size() > file_name.size())
+        continue;
+
+      size_t start = file_name.size() - extension.size();
+      bool match = true;
+      for (size_t i = 0; match && i < extension.size(); ++i)
+        match = charactersMatch(extension[i], file_name[start + i], case_sensitive_);
+      if (match)
+        return true;
+    }
+    return false;
+  }
+
+  void FileSearch::start(const File& directory, const Options& options, BatchCallback on_batch,
+                         FinishedCallback on_finished) {
+    cancel();
+    waitForEnd();
+
+    matcher_ = FileNameMatcher(options.glob, options.extensions, options.case_sensitive);
+    options_ = options;
+    options_.batch_size = std::max(1, options_.batch_size);
+    on_batch_ = std::move(on_batch);
+    on_finished_ = std::move(on_finished);
+    cancelled_ = false;
+
+    ThreadPool& pool = ThreadPool::shared();
+    bool search_inline = pool.numThreads() == 0;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      directories_.clear();
+      if (isDirectory(directory))
+        directories_.push_back(directory);
+      max_workers_ = options.num_threads > 0 ? options.num_threads : pool.numThreads();
+      if (search_inline)
+        max_workers_ = 1;
+      active_workers_ = 1;
+      finished_ = false;
+    }
+
+    if (search_inline)
+      workerLoop();
+    else
+      pool.post([this] { workerLoop(); }, TaskPriority::Background);
+  }
+
+  void FileSearch::cancel() {
+    cancelled_ = true;
+    std::lock_guard<std::mutex> lock(mutex_);
+    directories_.clear();
+  }
+
+  bool FileSearch::waitForEnd(int ms_timeout) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      auto done = [this] { return finished_; };
+      if (ms_timeout < 0)
+        done_condition_.wait(lock, done);
+      else if (!done_condition_.wait_for(lock, std::chrono::milliseconds(ms_timeout), done))
+        return false;
+    }
+    return true;
+  }
+
+  bool FileSearch::finished() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return finished_;
+  }
+
+  void FileSearch::workerLoop() {
+    std::vector<File> batch;
+    long long last_flush = time::milliseconds();
+    while (true) {
+      File directory;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (directories_.empty())
+          break;
+
+        directory = std::move(directories_.front());
+        directories_.pop_front();
+      }
+
+      if (!cancelled_)
+        searchDirectory(directory, batch);
+
+      if (!batch.empty() && time::milliseconds() - last_flush >= kFlushIntervalMs) {
+        flush(batch);
+        last_flush = time::milliseconds();
+      }
+    }
+
+    flush(batch);
+    workerFinished();
+  }
+
+  void FileSearch::searchDirectory(const File& directory, std::vector<File>& batch) {
+    std::error_code error;
+    auto options = std::filesystem::directory_options::skip_permission_denied;
+    std::filesystem::directory_iterator it(directory, options, error);
+    for (; !error && it != std::filesystem::directory_iterator(); it.increment(error)) {
+      if (cancelled_)
+        return;
+
+      const std::filesystem::directory_entry& entry = *it;
+      std::error_code status_error;
+      bool is_directory = entry.is_directory(status_error) && !entry.is_symlink(status_error);
+      if (is_directory) {
+        // Workers only leave once the queue is empty, so the one queuing this directory picks it
+        // up if no new worker does.
+        std::lock_guard<std::mutex> lock(mutex_);
+        directories_.push_back(entry.path());
+        if (active_workers_ < max_workers_) {
+          active_workers_++;
+          ThreadPool::shared().post([this] { workerLoop(); }, TaskPriority::Background);
+        }
+      }
+
+      bool include = is_directory ? options_.include_directories :
+                                    options_.include_files && entry.is_regular_file(status_error);
+      if (include && matcher_.matches(entry.path().filename().string())) {
+        batch.push_back(entry.path());
+        if (batch.size() >= static_cast<size_t>(options_.batch_size))
+          flush(batch);
+      }
+    }
+  }
+
+  void FileSearch::flush(std::vector<File>& batch) {
+    if (batch.empty())
+      return;
+
+    std::vector<File> results;
+    results.swap(batch);
+    std::lock_guard<std::mutex> lock(callback_mutex_);
+    if (!cancelled_ && on_batch_)
+      on_batch_(std::move(results));
+  }
+
+  void FileSearch::workerFinished() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--active_workers_ > 0)
+        return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(callback_mutex_);
+      if (on_finished_)
+        on_finished_(cancelled_.load());
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    finished_ = true;
+    done_condition_.notify_all();
+  }
 }
@@ -21,7 +21,12 @@
 
 #pragma once
 
+#include "thread_utils.h"
+
 #include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
 #include <vector>
 
 namespace visage {
@@ -36,6 +41,28 @@ namespace visage {
   std::unique_ptr<unsigned char[]> loadFileData(const File& file, size_t& size);
   std::string loadFileAsString(const File& file);
 
+  // Read only view of a whole file, memory mapped so large files are paged in on demand instead
+  // of copied. Falls back to reading the file when it can't be mapped. data() is null when the
+  // file couldn't be read.
+  class MappedFile {
+  public:
+    explicit MappedFile(const File& file);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool mapped() const { return mapped_; }
+
+  private:
+    const unsigned char* data_ = nullptr;
+    size_t size_ = 0;
+    bool mapped_ = false;
+    std::unique_ptr<unsigned char[]> loaded_data_;
+  };
+
   File hostExecutable();
   File appDataDirectory();
   File userDocumentsDirectory();
@@ -47,4 +74,85 @@ namespace visage {
   std::string hostName();
   std::vector<File> searchForFiles(const File& directory, const std::string& regex);
   std::vector<File> searchForDirectories(const File& directory, const std::string& regex);
+
+  // Matches file names against a glob with * and ? wildcards and a list of extensions like
+  // ".wav". An empty glob or extension list matches everything. The pattern is prepared once
+  // and can be used from any thread.
+  class FileNameMatcher {
+  public:
+    FileNameMatcher() = default;
+    explicit FileNameMatcher(std::string glob, std::vector<std::string> extensions = {},
+                             bool case_sensitive = false);
+
+    bool matches(const std::string& file_name) const;
+
+  private:
+    bool matchesGlob(const std::string& file_name) const;
+    bool matchesExtension(const std::string& file_name) const;
+
+    std::string glob_;
+    std::vector<std::string> extensions_;
+    bool case_sensitive_ = false;
+  };
+
+  // Walks a directory tree on worker threads and streams matching paths back in batches while
+  // the search runs, so large folders can be listed before the walk finishes. Callbacks run on
+  // the worker threads, one at a time. Symbolic links to directories aren't followed.
+  class FileSearch {
+  public:
+    static constexpr long long kFlushIntervalMs = 50;
+
+    struct Options {
+      std::string glob;
+      std::vector<std::string> extensions;
+      bool case_sensitive = false;
+      bool include_files = true;
+      bool include_directories = false;
+      int batch_size = 256;
+      int num_threads = 0;
+    };
+
+    using BatchCallback = std::function<void(std::vector<File> batch)>;
+    using FinishedCallback = std::function<void(bool cancelled)>;
+
+    FileSearch() = default;
+    ~FileSearch() {
+      cancel();
+      waitForEnd();
+    }
+
+    FileSearch(const FileSearch&) = delete;
+    FileSearch& operator=(const FileSearch&) = delete;
+
+    // Cancels any running search first. The search runs as background tasks on the shared
+    // ThreadPool, using at most num_threads of its workers or all of them when num_threads is
+    // zero. Without thread support it runs on the calling thread before returning.
+    void start(const File& directory, const Options& options, BatchCallback on_batch,
+               FinishedCallback on_finished = nullptr);
+    // Stops queuing directories and drops results not yet delivered. Doesn't block, so it's safe
+    // to call from a callback.
+    void cancel();
+    // Returns false if the search is still running after the timeout. Don't call from a callback.
+    bool waitForEnd(int ms_timeout = -1);
+    bool finished() const;
+
+  private:
+    void workerLoop();
+    void searchDirectory(const File& directory, std::vector<File>& batch);
+    void flush(std::vector<File>& batch);
+    void workerFinished();
+
+    FileNameMatcher matcher_;
+    Options options_;
+    BatchCallback on_batch_;
+    FinishedCallback on_finished_;
+    mutable std::mutex mutex_;
+    std::mutex callback_mutex_;
+    std::condition_variable done_condition_;
+    std::deque<File> directories_;
+    int max_workers_ = 1;
+    int active_workers_ = 0;
+    bool finished_ = true;
+    std::atomic<bool> cancelled_ = false;
+  };
 }
\ No newline at end of file
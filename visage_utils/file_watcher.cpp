@@ -0,0 +1,420 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "file_watcher.h"
+
+#include "time_utils.h"
+
+#include <algorithm>
+#include <set>
+
+#if VISAGE_WINDOWS
+#include <windows.h>
+#elif VISAGE_MAC
+#include <CoreServices/CoreServices.h>
+#include <condition_variable>
+#elif VISAGE_LINUX
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace visage {
+  static constexpr int kMaxWaitMs = 50;
+
+  static File normalizedFile(const File& file) {
+    std::error_code error;
+    File result = std::filesystem::weakly_canonical(std::filesystem::absolute(file, error), error);
+    return error ? file.lexically_normal() : result;
+  }
+
+#if VISAGE_WINDOWS
+  class FileWatcher::Backend {
+  public:
+    ~Backend() { closeFolders(); }
+
+    void setFolders(const std::vector<File>& folders) {
+      closeFolders();
+      for (const File& path : folders) {
+        if (folders_.size() >= MAXIMUM_WAIT_OBJECTS)
+          break;
+
+        auto folder = std::make_unique<Folder>();
+        folder->path = path;
+        folder->handle = CreateFileW(path.c_str(), FILE_LIST_DIRECTORY,
+                                     FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                     nullptr, OPEN_EXISTING,
+                                     FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+        if (folder->handle == INVALID_HANDLE_VALUE)
+          continue;
+
+        folder->overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+        if (readChanges(folder.get()))
+          folders_.push_back(std::move(folder));
+        else
+          closeFolder(folder.get());
+      }
+    }
+
+    void waitForChanges(int timeout_ms, std::vector<File>& changed) {
+      if (folders_.empty()) {
+        Thread::sleep(timeout_ms);
+        return;
+      }
+
+      std::vector<HANDLE> events;
+      for (const auto& folder : folders_)
+        events.push_back(folder->overlapped.hEvent);
+      DWORD num_events = static_cast<DWORD>(events.size());
+      DWORD result = WaitForMultipleObjects(num_events, events.data(), FALSE, timeout_ms);
+      if (result < WAIT_OBJECT_0 || result >= WAIT_OBJECT_0 + num_events)
+        return;
+
+      for (const auto& folder : folders_) {
+        DWORD bytes = 0;
+        if (!GetOverlappedResult(folder->handle, &folder->overlapped, &bytes, FALSE))
+          continue;
+
+        const unsigned char* position = folder->buffer;
+        while (bytes) {
+          auto info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(position);
+          std::wstring name(info->FileName, info->FileNameLength / sizeof(WCHAR));
+          changed.push_back(folder->path / name);
+          if (info->NextEntryOffset == 0)
+            break;
+          position += info->NextEntryOffset;
+        }
+
+        ResetEvent(folder->overlapped.hEvent);
+        readChanges(folder.get());
+      }
+    }
+
+  private:
+    static constexpr DWORD kNotifyFilter = FILE_NOTIFY_CHANGE_LAST_WRITE |
+                                           FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE;
+
+    struct Folder {
+      File path;
+      HANDLE handle = INVALID_HANDLE_VALUE;
+      OVERLAPPED overlapped {};
+      alignas(DWORD) unsigned char buffer[16 * 1024] {};
+    };
+
+    static bool readChanges(Folder* folder) {
+      return ReadDirectoryChangesW(folder->handle, folder->buffer, sizeof(folder->buffer), FALSE,
+                                   kNotifyFilter, nullptr, &folder->overlapped, nullptr);
+    }
+
+    static void closeFolder(Folder* folder) {
+      DWORD bytes = 0;
+      if (CancelIoEx(folder->handle, &folder->overlapped))
+        GetOverlappedResult(folder->handle, &folder->overlapped, &bytes, TRUE);
+      CloseHandle(folder->handle);
+      if (folder->overlapped.hEvent)
+        CloseHandle(folder->overlapped.hEvent);
+    }
+
+    void closeFolders() {
+      for (const auto& folder : folders_)
+        closeFolder(folder.get());
+      folders_.clear();
+    }
+
+    std::vector<std::unique_ptr<Folder>> folders_;
+  };
+#elif VISAGE_MAC
+  class FileWatcher::Backend {
+  public:
+    Backend() : queue_(dispatch_queue_create("Visage File Watcher", DISPATCH_QUEUE_SERIAL)) { }
+
+    ~Backend() {
+      stopStream();
+      dispatch_release(queue_);
+    }
+
+    void setFolders(const std::vector<File>& folders) {
+      stopStream();
+      if (folders.empty())
+        return;
+
+      CFMutableArrayRef paths = CFArrayCreateMutable(nullptr, folders.size(),
+                                                     &kCFTypeArrayCallBacks);
+      for (const File& folder : folders) {
+        CFStringRef path = CFStringCreateWithCString(nullptr, folder.c_str(),
+                                                     kCFStringEncodingUTF8);
+        if (path) {
+          CFArrayAppendValue(paths, path);
+          CFRelease(path);
+        }
+      }
+
+      FSEventStreamContext context = { 0, this, nullptr, nullptr, nullptr };
+      FSEventStreamCreateFlags flags = kFSEventStreamCreateFlagFileEvents |
+                                       kFSEventStreamCreateFlagNoDefer;
+      stream_ = FSEventStreamCreate(nullptr, &Backend::streamCallback, &context, paths,
+                                    kFSEventStreamEventIdSinceNow, kLatencySeconds, flags);
+      CFRelease(paths);
+      if (stream_ == nullptr)
+        return;
+
+      FSEventStreamSetDispatchQueue(stream_, queue_);
+      FSEventStreamStart(stream_);
+    }
+
+    void waitForChanges(int timeout_ms, std::vector<File>& changed) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                          [this] { return !changes_.empty(); });
+      changed.insert(changed.end(), changes_.begin(), changes_.end());
+      changes_.clear();
+    }
+
+  private:
+    static constexpr CFTimeInterval kLatencySeconds = 0.02;
+
+    static void streamCallback(ConstFSEventStreamRef, void* info, size_t num_events,
+                               void* event_paths, const FSEventStreamEventFlags*,
+                               const FSEventStreamEventId*) {
+      auto backend = static_cast<Backend*>(info);
+      auto paths = static_cast<char**>(event_paths);
+      {
+        std::lock_guard<std::mutex> lock(backend->mutex_);
+        for (size_t i = 0; i < num_events; ++i)
+          backend->changes_.emplace_back(paths[i]);
+      }
+      backend->condition_.notify_one();
+    }
+
+    void stopStream() {
+      if (stream_ == nullptr)
+        return;
+
+      FSEventStreamStop(stream_);
+      FSEventStreamInvalidate(stream_);
+      FSEventStreamRelease(stream_);
+      stream_ = nullptr;
+      dispatch_sync_f(queue_, nullptr, [](void*) { });
+    }
+
+    dispatch_queue_t queue_ = nullptr;
+    FSEventStreamRef stream_ = nullptr;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::vector<File> changes_;
+  };
+#elif VISAGE_LINUX
+  class FileWatcher::Backend {
+  public:
+    Backend() : descriptor_(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) { }
+
+    ~Backend() {
+      if (descriptor_ >= 0)
+        close(descriptor_);
+    }
+
+    void setFolders(const std::vector<File>& folders) {
+      if (descriptor_ < 0)
+        return;
+
+      for (auto it = folders_.begin(); it != folders_.end();) {
+        if (std::find(folders.begin(), folders.end(), it->second) == folders.end()) {
+          inotify_rm_watch(descriptor_, it->first);
+          it = folders_.erase(it);
+        }
+        else
+          ++it;
+      }
+
+      for (const File& folder : folders) {
+        int watch_descriptor = inotify_add_watch(descriptor_, folder.c_str(), kEvents);
+        if (watch_descriptor >= 0)
+          folders_[watch_descriptor] = folder;
+      }
+    }
+
+    void waitForChanges(int timeout_ms, std::vector<File>& changed) {
+      if (descriptor_ < 0) {
+        Thread::sleep(timeout_ms);
+        return;
+      }
+
+      pollfd poll_descriptor = { descriptor_, POLLIN, 0 };
+      if (poll(&poll_descriptor, 1, timeout_ms) <= 0)
+        return;
+
+      alignas(inotify_event) char buffer[16 * 1024];
+      ssize_t length = 0;
+      while ((length = read(descriptor_, buffer, sizeof(buffer))) > 0) {
+        for (char* position = buffer; position < buffer + length;) {
+          auto event = reinterpret_cast<const inotify_event*>(position);
+          auto folder = folders_.find(event->wd);
+          if (folder != folders_.end() && event->len)
+            changed.push_back(folder->second / event->name);
+          position += sizeof(inotify_event) + event->len;
+        }
+      }
+    }
+
+  private:
+    static constexpr uint32_t kEvents = IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE |
+                                        IN_MOVED_TO | IN_MOVED_FROM;
+
+    int descriptor_ = -1;
+    std::map<int, File> folders_;
+  };
+#else
+  class FileWatcher::Backend {
+  public:
+    void setFolders(const std::vector<File>&) { }
+    void waitForChanges(int timeout_ms, std::vector<File>&) { Thread::sleep(timeout_ms); }
+  };
+#endif
+
+  FileWatcher::FileWatcher(int debounce_ms) :
+      debounce_ms_(debounce_ms), state_(std::make_shared<State>()) {
+#if !VISAGE_EMSCRIPTEN || defined(__EMSCRIPTEN_PTHREADS__)
+    thread_ = std::make_unique<Thread>("File Watcher");
+    thread_->setThreadTask([this] { run(); });
+    thread_->start();
+#endif
+  }
+
+  FileWatcher::~FileWatcher() {
+    if (thread_)
+      thread_->stop();
+  }
+
+  int FileWatcher::watch(const File& file, Callback callback) {
+    if (thread_ == nullptr)
+      return -1;
+
+    Watch watch;
+    watch.file = normalizedFile(file);
+    watch.folder = isDirectory(watch.file);
+    watch.callback = std::move(callback);
+
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    int id = next_id_++;
+    state_->watches[id] = std::move(watch);
+    state_->folders_changed = true;
+    return id;
+  }
+
+  void FileWatcher::unwatch(int id) {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    state_->watches.erase(id);
+    state_->folders_changed = true;
+  }
+
+  void FileWatcher::unwatchAll() {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    state_->watches.clear();
+    state_->folders_changed = true;
+  }
+
+  void FileWatcher::run() {
+    Backend backend;
+    std::map<File, long long> pending;
+    std::vector<File> changed;
+
+    while (thread_->shouldRun()) {
+      std::set<File> folders;
+      bool folders_changed = false;
+      {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        folders_changed = state_->folders_changed;
+        state_->folders_changed = false;
+        if (folders_changed) {
+          for (const auto& watch : state_->watches) {
+            const Watch& info = watch.second;
+            folders.insert(info.folder ? info.file : info.file.parent_path());
+          }
+        }
+      }
+      if (folders_changed)
+        backend.setFolders({ folders.begin(), folders.end() });
+
+      long long now = time::milliseconds();
+      long long timeout = kMaxWaitMs;
+      for (const auto& file : pending)
+        timeout = std::min(timeout, std::max(0LL, file.second - now));
+
+      changed.clear();
+      backend.waitForChanges(timeout, changed);
+
+      now = time::milliseconds();
+      for (const File& file : changed)
+        pending[file.lexically_normal()] = now + debounce_ms_;
+
+      std::vector<File> ready;
+      for (auto it = pending.begin(); it != pending.end();) {
+        if (it->second <= now) {
+          ready.push_back(it->first);
+          it = pending.erase(it);
+        }
+        else
+          ++it;
+      }
+
+      if (!ready.empty())
+        notifyChanged(ready);
+    }
+  }
+
+  void FileWatcher::notifyChanged(const std::vector<File>& files) {
+    std::vector<std::pair<int, File>> deliveries;
+    {
+      std::lock_guard<std::mutex> lock(state_->mutex);
+      for (const auto& watch : state_->watches) {
+        for (const File& file : files) {
+          bool match = watch.second.folder ? file.parent_path() == watch.second.file :
+                                             file == watch.second.file;
+          if (match)
+            deliveries.emplace_back(watch.first, file);
+        }
+      }
+    }
+
+    if (deliveries.empty())
+      return;
+
+    std::weak_ptr<State> weak_state = state_;
+    ThreadPool::runOnMainThread([weak_state, deliveries = std::move(deliveries)] {
+      for (const auto& delivery : deliveries) {
+        auto state = weak_state.lock();
+        if (state == nullptr)
+          return;
+
+        Callback callback;
+        {
+          std::lock_guard<std::mutex> lock(state->mutex);
+          auto watch = state->watches.find(delivery.first);
+          if (watch != state->watches.end())
+            callback = watch->second.callback;
+        }
+        state = nullptr;
+        if (callback)
+          callback(delivery.second);
+      }
+    });
+  }
+}
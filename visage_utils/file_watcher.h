@@ -0,0 +1,80 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "file_system.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace visage {
+  // Watches files and folders for changes on a background thread using the platform's change
+  // notifications: inotify on Linux, FSEvents on macOS and ReadDirectoryChangesW on Windows.
+  // Files are watched through their parent folder so editors that save by replacing the file
+  // are still seen. A burst of changes to the same file is debounced into a single callback,
+  // which runs on the main thread through ThreadPool::runOnMainThread.
+  class FileWatcher {
+  public:
+    using Callback = std::function<void(const File& file)>;
+    static constexpr int kDefaultDebounceMs = 100;
+
+    explicit FileWatcher(int debounce_ms = kDefaultDebounceMs);
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Watching a folder reports every file changed directly inside it. Returns an id for
+    // unwatch(), or -1 when watching isn't supported on this platform.
+    int watch(const File& file, Callback callback);
+    void unwatch(int id);
+    void unwatchAll();
+
+    int debounceMs() const { return debounce_ms_; }
+
+  private:
+    struct Watch {
+      File file;
+      bool folder = false;
+      Callback callback;
+    };
+
+    struct State {
+      std::mutex mutex;
+      std::map<int, Watch> watches;
+      bool folders_changed = false;
+    };
+
+    class Backend;
+
+    void run();
+    void notifyChanged(const std::vector<File>& files);
+
+    int debounce_ms_ = kDefaultDebounceMs;
+    int next_id_ = 0;
+    std::shared_ptr<State> state_;
+    std::unique_ptr<Thread> thread_;
+  };
+}
@@ -0,0 +1,259 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace visage {
+  // Type erased void() callable that is stored inline when it fits, so moving small lambdas
+  // between threads doesn't touch the allocator.
+  class InplaceTask {
+  public:
+    static constexpr size_t kStorageSize = 48;
+
+    template<typename F>
+    static constexpr bool storesInline() {
+      return sizeof(F) <= kStorageSize && alignof(F) <= alignof(std::max_align_t) &&
+             std::is_nothrow_move_constructible_v<F>;
+    }
+
+    InplaceTask() = default;
+
+    template<typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, InplaceTask>>>
+    InplaceTask(F&& function) {
+      using Function = std::decay_t<F>;
+      if constexpr (storesInline<Function>()) {
+        new (storage_) Function(std::forward<F>(function));
+        operations_ = &InlineOperations<Function>::kOperations;
+      }
+      else {
+        *reinterpret_cast<Function**>(storage_) = new Function(std::forward<F>(function));
+        operations_ = &HeapOperations<Function>::kOperations;
+      }
+    }
+
+    InplaceTask(InplaceTask&& other) noexcept { moveFrom(other); }
+
+    InplaceTask& operator=(InplaceTask&& other) noexcept {
+      if (this != &other) {
+        reset();
+        moveFrom(other);
+      }
+      return *this;
+    }
+
+    InplaceTask(const InplaceTask&) = delete;
+    InplaceTask& operator=(const InplaceTask&) = delete;
+
+    ~InplaceTask() { reset(); }
+
+    explicit operator bool() const { return operations_ != nullptr; }
+    void operator()() { operations_->invoke(storage_); }
+
+    void reset() {
+      if (operations_) {
+        operations_->destroy(storage_);
+        operations_ = nullptr;
+      }
+    }
+
+  private:
+    struct Operations {
+      void (*invoke)(void* storage);
+      void (*move)(void* destination, void* source);
+      void (*destroy)(void* storage);
+    };
+
+    template<typename F>
+    struct InlineOperations {
+      static F* function(void* storage) { return std::launder(reinterpret_cast<F*>(storage)); }
+      static void invoke(void* storage) { (*function(storage))(); }
+      static void move(void* destination, void* source) {
+        new (destination) F(std::move(*function(source)));
+        function(source)->~F();
+      }
+      static void destroy(void* storage) { function(storage)->~F(); }
+      static constexpr Operations kOperations = { invoke, move, destroy };
+    };
+
+    template<typename F>
+    struct HeapOperations {
+      static F*& function(void* storage) { return *reinterpret_cast<F**>(storage); }
+      static void invoke(void* storage) { (*function(storage))(); }
+      static void move(void* destination, void* source) {
+        function(destination) = function(source);
+        function(source) = nullptr;
+      }
+      static void destroy(void* storage) { delete function(storage); }
+      static constexpr Operations kOperations = { invoke, move, destroy };
+    };
+
+    void moveFrom(InplaceTask& other) {
+      operations_ = other.operations_;
+      if (operations_) {
+        operations_->move(storage_, other.storage_);
+        other.operations_ = nullptr;
+      }
+    }
+
+    alignas(std::max_align_t) unsigned char storage_[kStorageSize] {};
+    const Operations* operations_ = nullptr;
+  };
+
+  // Bounded multi-producer single-consumer queue with preallocated slots. Pushing never blocks
+  // or allocates and fails when the queue is full. Only one thread may pop.
+  template<typename T>
+  class MpscQueue {
+  public:
+    static constexpr size_t kCacheLineSize = 64;
+
+    explicit MpscQueue(size_t capacity) {
+      size_t size = 1;
+      while (size < capacity)
+        size *= 2;
+
+      mask_ = size - 1;
+      slots_ = std::make_unique<Slot[]>(size);
+      for (size_t i = 0; i < size; ++i)
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    size_t capacity() const { return mask_ + 1; }
+
+    bool tryPush(T&& value) {
+      size_t position = tail_.load(std::memory_order_relaxed);
+      while (true) {
+        Slot& slot = slots_[position & mask_];
+        size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        auto difference = static_cast<std::ptrdiff_t>(sequence - position);
+        if (difference == 0) {
+          if (tail_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+            slot.value = std::move(value);
+            slot.sequence.store(position + 1, std::memory_order_release);
+            return true;
+          }
+        }
+        else if (difference < 0)
+          return false;
+        else
+          position = tail_.load(std::memory_order_relaxed);
+      }
+    }
+
+    bool tryPop(T& value) {
+      Slot& slot = slots_[head_ & mask_];
+      if (slot.sequence.load(std::memory_order_acquire) != head_ + 1)
+        return false;
+
+      value = std::move(slot.value);
+      slot.value = T();
+      slot.sequence.store(head_ + mask_ + 1, std::memory_order_release);
+      head_++;
+      return true;
+    }
+
+    bool empty() const {
+      return slots_[head_ & mask_].sequence.load(std::memory_order_acquire) != head_ + 1;
+    }
+
+  private:
+    struct Slot {
+      std::atomic<size_t> sequence = 0;
+      T value;
+    };
+
+    std::unique_ptr<Slot[]> slots_;
+    size_t mask_ = 0;
+    alignas(kCacheLineSize) std::atomic<size_t> tail_ = 0;
+    alignas(kCacheLineSize) size_t head_ = 0;
+  };
+
+  // Bounded single producer, single consumer ring of trivially copyable values for streaming
+  // blocks of data between two threads, like audio samples to the UI. Neither side blocks or
+  // allocates; values that don't fit when writing are dropped.
+  template<typename T>
+  class SpscRingBuffer {
+  public:
+    static_assert(std::is_trivially_copyable_v<T>, "SpscRingBuffer values must be copyable");
+    static constexpr size_t kCacheLineSize = 64;
+
+    explicit SpscRingBuffer(size_t capacity) {
+      size_t size = 1;
+      while (size < capacity)
+        size *= 2;
+
+      mask_ = size - 1;
+      buffer_ = std::make_unique<T[]>(size);
+    }
+
+    SpscRingBuffer(const SpscRingBuffer&) = delete;
+    SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+    size_t capacity() const { return mask_ + 1; }
+
+    size_t write(const T* values, size_t count) {
+      size_t tail = tail_.load(std::memory_order_relaxed);
+      size_t head = head_.load(std::memory_order_acquire);
+      count = std::min(count, capacity() - (tail - head));
+
+      size_t start = tail & mask_;
+      size_t first = std::min(count, capacity() - start);
+      std::copy_n(values, first, buffer_.get() + start);
+      std::copy_n(values + first, count - first, buffer_.get());
+      tail_.store(tail + count, std::memory_order_release);
+      return count;
+    }
+
+    size_t read(T* values, size_t max_count) {
+      size_t head = head_.load(std::memory_order_relaxed);
+      size_t tail = tail_.load(std::memory_order_acquire);
+      size_t count = std::min(max_count, tail - head);
+
+      size_t start = head & mask_;
+      size_t first = std::min(count, capacity() - start);
+      std::copy_n(buffer_.get() + start, first, values);
+      std::copy_n(buffer_.get(), count - first, values + first);
+      head_.store(head + count, std::memory_order_release);
+      return count;
+    }
+
+    size_t available() const {
+      return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+  private:
+    std::unique_ptr<T[]> buffer_;
+    size_t mask_ = 0;
+    alignas(kCacheLineSize) std::atomic<size_t> tail_ = 0;
+    alignas(kCacheLineSize) std::atomic<size_t> head_ = 0;
+  };
+}
@@ -24,6 +24,7 @@
 #include <chrono>
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <signal.h>
 #include <spawn.h>
 #include <sstream>
@@ -100,7 +101,7 @@ namespace visage {
   }
 
   bool spawnChildProcess(const std::string& command, const std::string& arguments,
-                         std::string& output, int timeout_ms) {
+                         std::string& output, int timeout_ms, const std::atomic<bool>* cancel) {
     static constexpr char* kEnvironment[] = { nullptr };
 
     std::vector<std::string> arg_storage;
@@ -158,7 +159,9 @@ namespace visage {
         return false;
 
       auto elapsed = std::chrono::steady_clock::now() - start_time;
-      if (std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() > timeout_ms) {
+      bool cancelled = cancel && cancel->load();
+      if (cancelled ||
+          std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() > timeout_ms) {
         terminateAndCleanup(pid, out_pipe[0], err_pipe[0], &status);
         gracefulTerminate(pid, &status);
         return false;
@@ -172,4 +175,186 @@ namespace visage {
 
     return WIFEXITED(status) && WEXITSTATUS(status) == 0;
   }
+
+  struct ChildProcess::Handles {
+    pid_t pid = -1;
+    int out_pipe = -1;
+    int err_pipe = -1;
+    int wake_pipe[2] = { -1, -1 };
+  };
+
+  static void closeDescriptor(int& descriptor) {
+    if (descriptor >= 0)
+      close(descriptor);
+    descriptor = -1;
+  }
+
+  static void setNonBlocking(int descriptor) {
+    fcntl(descriptor, F_SETFL, O_NONBLOCK);
+    fcntl(descriptor, F_SETFD, FD_CLOEXEC);
+  }
+
+  static void terminateProcess(pid_t pid, int* status) {
+    static constexpr int kGraceChecks = 10;
+
+    kill(pid, SIGTERM);
+    for (int i = 0; i < kGraceChecks; ++i) {
+      if (waitpid(pid, status, WNOHANG) != 0)
+        return;
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    kill(pid, SIGKILL);
+    waitpid(pid, status, 0);
+  }
+
+  ChildProcess::ChildProcess() : handles_(std::make_unique<Handles>()) { }
+
+  ChildProcess::~ChildProcess() {
+    kill();
+    joinMonitor();
+  }
+
+  bool ChildProcess::start(const std::string& command, const std::string& arguments,
+                           Options options) {
+    static constexpr char* kEnvironment[] = { nullptr };
+
+    if (running())
+      return false;
+
+    joinMonitor();
+    options_ = std::move(options);
+    kill_requested_ = false;
+
+    std::vector<std::string> arg_storage;
+    std::vector<char*> args = parseArguments(command, arguments, arg_storage);
+
+    int out_pipe[2];
+    int err_pipe[2];
+    posix_spawn_file_actions_t file_actions;
+    if (!setupPipes(out_pipe, err_pipe, &file_actions))
+      return false;
+
+    pid_t pid;
+    int result = posix_spawn(&pid, command.c_str(), &file_actions, nullptr, args.data(),
+                             kEnvironment);
+    posix_spawn_file_actions_destroy(&file_actions);
+    closePipes(out_pipe[1], err_pipe[1]);
+
+    if (result != 0 || pipe(handles_->wake_pipe) == -1) {
+      closePipes(out_pipe[0], err_pipe[0]);
+      int status = 0;
+      if (result == 0)
+        terminateProcess(pid, &status);
+      return false;
+    }
+
+    handles_->pid = pid;
+    handles_->out_pipe = out_pipe[0];
+    handles_->err_pipe = err_pipe[0];
+    setNonBlocking(handles_->out_pipe);
+    setNonBlocking(handles_->err_pipe);
+    setNonBlocking(handles_->wake_pipe[0]);
+    setNonBlocking(handles_->wake_pipe[1]);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      result_ = Result::Running;
+      exit_code_ = -1;
+      exit_reported_ = false;
+      run_++;
+    }
+
+    monitor_thread_ = std::make_unique<Thread>("Child Process " + command);
+    monitor_thread_->setThreadTask([this] { monitor(); });
+    monitor_thread_->start();
+    return true;
+  }
+
+  void ChildProcess::kill() {
+    kill_requested_ = true;
+    if (handles_->wake_pipe[1] >= 0) {
+      char wake = 1;
+      (void)write(handles_->wake_pipe[1], &wake, 1);
+    }
+  }
+
+  void ChildProcess::joinMonitor() {
+    stopMonitorThread();
+    closeDescriptor(handles_->wake_pipe[0]);
+    closeDescriptor(handles_->wake_pipe[1]);
+  }
+
+  void ChildProcess::monitor() {
+    static constexpr int kReapIntervalMs = 10;
+
+    auto start_time = std::chrono::steady_clock::now();
+    Handles& handles = *handles_;
+    char buffer[4096];
+    int status = 0;
+    bool exited = false;
+    Result result = Result::Exited;
+
+    while (true) {
+      if (kill_requested_) {
+        result = Result::Killed;
+        break;
+      }
+
+      bool pipes_open = handles.out_pipe >= 0 || handles.err_pipe >= 0;
+      int poll_timeout = pipes_open ? -1 : kReapIntervalMs;
+      if (options_.timeout_ms >= 0) {
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start_time);
+        long long remaining = options_.timeout_ms - elapsed.count();
+        if (remaining <= 0) {
+          result = Result::TimedOut;
+          break;
+        }
+        if (poll_timeout < 0 || remaining < poll_timeout)
+          poll_timeout = static_cast<int>(remaining);
+      }
+
+      pollfd descriptors[3] = { { handles.wake_pipe[0], POLLIN, 0 },
+                                { handles.out_pipe, POLLIN, 0 },
+                                { handles.err_pipe, POLLIN, 0 } };
+      if (poll(descriptors, 3, poll_timeout) < 0 && errno != EINTR)
+        break;
+
+      if (descriptors[0].revents) {
+        while (read(handles.wake_pipe[0], buffer, sizeof(buffer)) > 0)
+          ;
+      }
+
+      auto read_pipe = [&](int& pipe_fd, short events, const OutputCallback& callback) {
+        if (pipe_fd < 0 || events == 0)
+          return;
+
+        ssize_t count = read(pipe_fd, buffer, sizeof(buffer));
+        if (count > 0)
+          deliverOutput(callback, buffer, count);
+        else if (count == 0 || (errno != EAGAIN && errno != EINTR))
+          closeDescriptor(pipe_fd);
+      };
+      read_pipe(handles.out_pipe, descriptors[1].revents, options_.on_output);
+      read_pipe(handles.err_pipe, descriptors[2].revents, options_.on_error);
+
+      if (handles.out_pipe < 0 && handles.err_pipe < 0) {
+        pid_t wait_result = waitpid(handles.pid, &status, WNOHANG);
+        if (wait_result == handles.pid || (wait_result == -1 && errno == ECHILD)) {
+          if (wait_result != handles.pid)
+            status = 0;
+          exited = true;
+          break;
+        }
+      }
+    }
+
+    if (!exited)
+      terminateProcess(handles.pid, &status);
+
+    closeDescriptor(handles.out_pipe);
+    closeDescriptor(handles.err_pipe);
+    handles.pid = -1;
+    finish(result, exited && WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+  }
 }
@@ -26,6 +26,7 @@
 #include <algorithm>
 #include <cmath>
 #include <cstdint>
+#include <limits>
 #include <vector>
 
 namespace visage {
@@ -468,6 +469,241 @@ namespace visage {
     int height_ = 0;
   };
 
+  // A set of pixels stored as non-overlapping rects in y-x banded order. Rects sharing a band have
+  // the same top and height and are sorted left to right with gaps between them, and bands are
+  // sorted top to bottom with identical neighbors merged, so every area has one representation.
+  class IRegion {
+  public:
+    IRegion() = default;
+    explicit IRegion(const IBounds& rect) { add(rect); }
+
+    bool isEmpty() const { return rects_.empty(); }
+    int numRects() const { return rects_.size(); }
+    const std::vector<IBounds>& rects() const { return rects_; }
+    std::vector<IBounds>::const_iterator begin() const { return rects_.begin(); }
+    std::vector<IBounds>::const_iterator end() const { return rects_.end(); }
+
+    IBounds bounds() const {
+      if (rects_.empty())
+        return {};
+
+      int left = rects_.front().x();
+      int right = rects_.front().right();
+      for (const IBounds& rect : rects_) {
+        left = std::min(left, rect.x());
+        right = std::max(right, rect.right());
+      }
+      int top = rects_.front().y();
+      return { left, top, right - left, rects_.back().bottom() - top };
+    }
+
+    void clear() { rects_.clear(); }
+
+    void add(const IBounds& rect) {
+      if (rect.width() <= 0 || rect.height() <= 0 || contains(rect))
+        return;
+
+      if (rects_.empty() || rect.contains(bounds())) {
+        rects_.clear();
+        rects_.push_back(rect);
+        return;
+      }
+      combine(&rect, &rect + 1, [](bool a, bool b) { return a || b; });
+    }
+
+    void add(const IRegion& other) {
+      if (&other == this)
+        return;
+      combine(other.rects_.data(), other.rects_.data() + other.rects_.size(),
+              [](bool a, bool b) { return a || b; });
+    }
+
+    void subtract(const IBounds& rect) {
+      if (rect.width() <= 0 || rect.height() <= 0 || !overlaps(rect))
+        return;
+      combine(&rect, &rect + 1, [](bool a, bool b) { return a && !b; });
+    }
+
+    void subtract(const IRegion& other) {
+      if (&other == this) {
+        clear();
+        return;
+      }
+      combine(other.rects_.data(), other.rects_.data() + other.rects_.size(),
+              [](bool a, bool b) { return a && !b; });
+    }
+
+    void intersect(const IBounds& rect) {
+      if (rect.width() <= 0 || rect.height() <= 0) {
+        clear();
+        return;
+      }
+      if (rect.contains(bounds()))
+        return;
+      combine(&rect, &rect + 1, [](bool a, bool b) { return a && b; });
+    }
+
+    void intersect(const IRegion& other) {
+      if (&other == this)
+        return;
+      combine(other.rects_.data(), other.rects_.data() + other.rects_.size(),
+              [](bool a, bool b) { return a && b; });
+    }
+
+    bool contains(int x, int y) const {
+      return std::any_of(rects_.begin(), rects_.end(),
+                         [x, y](const IBounds& rect) { return rect.contains(x, y); });
+    }
+
+    bool contains(const IBounds& rect) const {
+      if (rect.width() <= 0 || rect.height() <= 0)
+        return true;
+
+      int covered_to = rect.y();
+      for (const IBounds& band_rect : rects_) {
+        if (band_rect.bottom() <= covered_to)
+          continue;
+        if (band_rect.y() > covered_to)
+          return false;
+        if (!band_rect.contains(rect.x(), covered_to))
+          continue;
+        if (band_rect.right() < rect.right())
+          return false;
+
+        covered_to = band_rect.bottom();
+        if (covered_to >= rect.bottom())
+          return true;
+      }
+      return false;
+    }
+
+    bool overlaps(const IBounds& rect) const {
+      return std::any_of(rects_.begin(), rects_.end(),
+                         [&rect](const IBounds& other) { return other.overlaps(rect); });
+    }
+
+    bool overlaps(const IRegion& other) const {
+      return std::any_of(other.rects_.begin(), other.rects_.end(),
+                         [this](const IBounds& rect) { return overlaps(rect); });
+    }
+
+    IRegion operator+(const IPoint& point) const {
+      IRegion result;
+      result.rects_.reserve(rects_.size());
+      for (const IBounds& rect : rects_)
+        result.rects_.push_back(rect + point);
+      return result;
+    }
+
+    bool operator==(const IRegion& other) const { return rects_ == other.rects_; }
+    bool operator!=(const IRegion& other) const { return !(*this == other); }
+
+  private:
+    static const IBounds* bandEnd(const IBounds* band, const IBounds* end) {
+      const IBounds* band_end = band;
+      while (band_end != end && band_end->y() == band->y())
+        ++band_end;
+      return band_end;
+    }
+
+    // Sweeps both sets of bands top to bottom and their spans left to right, keeping the pixels
+    // where _inside_ holds for membership in each. The result is copied back into rects_ so its
+    // storage is reused from frame to frame.
+    template<typename Inside>
+    void combine(const IBounds* b, const IBounds* b_end, Inside inside) {
+      scratch_.clear();
+      const IBounds* a = rects_.data();
+      const IBounds* a_end = a + rects_.size();
+      int previous_band = 0;
+      int y = std::numeric_limits<int>::min();
+
+      while (true) {
+        while (a != a_end && a->bottom() <= y)
+          a = bandEnd(a, a_end);
+        while (b != b_end && b->bottom() <= y)
+          b = bandEnd(b, b_end);
+        if (a == a_end && b == b_end)
+          break;
+
+        int top = std::numeric_limits<int>::max();
+        if (a != a_end)
+          top = std::max(y, a->y());
+        if (b != b_end)
+          top = std::min(top, std::max(y, b->y()));
+
+        bool in_a = a != a_end && a->y() <= top;
+        bool in_b = b != b_end && b->y() <= top;
+        int bottom = std::numeric_limits<int>::max();
+        if (a != a_end)
+          bottom = std::min(bottom, in_a ? a->bottom() : a->y());
+        if (b != b_end)
+          bottom = std::min(bottom, in_b ? b->bottom() : b->y());
+        y = bottom;
+
+        int band_start = scratch_.size();
+        const IBounds* a_spans_end = in_a ? bandEnd(a, a_end) : a;
+        const IBounds* b_spans_end = in_b ? bandEnd(b, b_end) : b;
+        addSpans(a, a_spans_end, b, b_spans_end, top, bottom, inside);
+        int band_size = scratch_.size() - band_start;
+        if (band_size == 0)
+          continue;
+
+        auto same_span = [](const IBounds& above, const IBounds& below) {
+          return above.x() == below.x() && above.width() == below.width();
+        };
+        if (band_start > 0 && scratch_[previous_band].bottom() == top &&
+            band_start - previous_band == band_size &&
+            std::equal(scratch_.begin() + previous_band, scratch_.begin() + band_start,
+                       scratch_.begin() + band_start, same_span)) {
+          for (int i = previous_band; i < band_start; ++i)
+            scratch_[i].setHeight(bottom - scratch_[i].y());
+          scratch_.resize(band_start);
+        }
+        else
+          previous_band = band_start;
+      }
+
+      rects_.assign(scratch_.begin(), scratch_.end());
+    }
+
+    template<typename Inside>
+    void addSpans(const IBounds* a, const IBounds* a_end, const IBounds* b, const IBounds* b_end,
+                  int top, int bottom, Inside inside) {
+      bool in_a = false;
+      bool in_b = false;
+      bool was_inside = false;
+      int span_start = 0;
+      while (a != a_end || b != b_end) {
+        int x = std::numeric_limits<int>::max();
+        if (a != a_end)
+          x = in_a ? a->right() : a->x();
+        if (b != b_end)
+          x = std::min(x, in_b ? b->right() : b->x());
+
+        if (a != a_end && x == (in_a ? a->right() : a->x())) {
+          in_a = !in_a;
+          if (!in_a)
+            ++a;
+        }
+        if (b != b_end && x == (in_b ? b->right() : b->x())) {
+          in_b = !in_b;
+          if (!in_b)
+            ++b;
+        }
+
+        bool is_inside = inside(in_a, in_b);
+        if (is_inside && !was_inside)
+          span_start = x;
+        else if (!is_inside && was_inside)
+          scratch_.emplace_back(span_start, top, x - span_start, bottom - top);
+        was_inside = is_inside;
+      }
+    }
+
+    std::vector<IBounds> rects_;
+    std::vector<IBounds> scratch_;
+  };
+
   class Bounds {
   public:
     Bounds() = default;
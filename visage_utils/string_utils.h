@@ -21,18 +21,45 @@
 
 #pragma once
 
+#include <cstdint>
+#include <cstring>
 #include <memory>
 #include <string>
+#include <string_view>
 
 namespace visage {
   class String {
   public:
+    // Length of the plain ASCII run at the start of a utf8 string, checked eight bytes at a time.
+    static size_t asciiPrefixLength(std::string_view utf8_str) {
+      static constexpr uint64_t kHighBits = 0x8080808080808080ULL;
+
+      size_t length = 0;
+      for (; length + sizeof(uint64_t) <= utf8_str.size(); length += sizeof(uint64_t)) {
+        uint64_t chunk = 0;
+        std::memcpy(&chunk, utf8_str.data() + length, sizeof(chunk));
+        if (chunk & kHighBits)
+          break;
+      }
+      while (length < utf8_str.size() && static_cast<unsigned char>(utf8_str[length]) < 0x80)
+        ++length;
+      return length;
+    }
+
     template<typename Utf32String>
-    static Utf32String convertUtf8ToUtf32(const std::string& utf8_str) {
+    static Utf32String convertUtf8ToUtf32(std::string_view utf8_str) {
+      // ASCII widens in one straight loop the compiler can vectorize, so mostly ASCII text
+      // skips the per byte decoding below.
+      size_t ascii_length = asciiPrefixLength(utf8_str);
       Utf32String result;
-      result.reserve(utf8_str.size());
+      result.resize(ascii_length);
+      for (size_t i = 0; i < ascii_length; ++i)
+        result[i] = static_cast<unsigned char>(utf8_str[i]);
+      if (ascii_length == utf8_str.size())
+        return result;
 
-      for (size_t i = 0; i < utf8_str.size(); ++i) {
+      result.reserve(utf8_str.size());
+      for (size_t i = ascii_length; i < utf8_str.size(); ++i) {
         unsigned char ch = utf8_str[i];
 
         if (ch < 0x80)  // ASCII character
@@ -71,10 +98,28 @@ namespace visage {
 
     template<typename Utf32String>
     static std::string convertUtf32ToUtf8(const Utf32String& utf32_str) {
+      size_t ascii_length = 0;
+      while (ascii_length < utf32_str.size() && utf32_str[ascii_length] < 0x80)
+        ++ascii_length;
+
       std::string result;
-      result.reserve(utf32_str.size() * 4);
+      result.resize(ascii_length);
+      for (size_t i = 0; i < ascii_length; ++i)
+        result[i] = static_cast<char>(utf32_str[i]);
+      if (ascii_length == utf32_str.size())
+        return result;
+
+      size_t length = ascii_length;
+      for (size_t i = ascii_length; i < utf32_str.size(); ++i) {
+        auto character = utf32_str[i];
+        if (character >= 0x110000)
+          break;
+        length += character < 0x80 ? 1 : character < 0x800 ? 2 : character < 0x10000 ? 3 : 4;
+      }
 
-      for (auto character : utf32_str) {
+      result.reserve(length);
+      for (size_t i = ascii_length; i < utf32_str.size(); ++i) {
+        auto character = utf32_str[i];
         if (character < 0x80)  // ASCII character
           result.push_back(static_cast<char>(character));
         else if (character < 0x800) {  // 2 byte character
@@ -151,7 +196,7 @@ namespace visage {
       return result;
     }
 
-    static std::u32string convertToUtf32(const std::string& utf8_str) {
+    static std::u32string convertToUtf32(std::string_view utf8_str) {
       return convertUtf8ToUtf32<std::u32string>(utf8_str);
     }
 
@@ -170,7 +215,7 @@ namespace visage {
       return convertUtf32ToUtf16<std::wstring>(utf32_str);
     }
 
-    static std::wstring convertToWide(const std::string& utf8_str) {
+    static std::wstring convertToWide(std::string_view utf8_str) {
       if constexpr (sizeof(wchar_t) == 4)
         return convertUtf8ToUtf32<std::wstring>(utf8_str);
 
@@ -388,6 +433,11 @@ namespace visage {
       return string_.substr(position, count);
     }
 
+    String& replace(size_t position, size_t count, const String& text) {
+      string_.replace(position, count, text.string_);
+      return *this;
+    }
+
     String trim() const {
       size_t start = string_.find_first_not_of(U" \t\n\r");
       size_t end = string_.find_last_not_of(U" \t\n\r");
@@ -28,7 +28,9 @@
 #include <catch2/catch_test_macros.hpp>
 #include <chrono>
 #include <csignal>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 using namespace visage;
 
@@ -70,6 +72,30 @@ TEST_CASE("Child process timeout", "[utils]") {
   REQUIRE(elapsed >= std::chrono::milliseconds(90));
 }
 
+TEST_CASE("Child process cancel", "[utils]") {
+#if VISAGE_WINDOWS
+  std::string command = "cmd.exe";
+  std::string argument = "/C timeout /t 5 /nobreak";
+#else
+  std::string command = "/bin/sleep";
+  std::string argument = "5";
+#endif
+
+  std::atomic<bool> cancel = false;
+  std::thread canceller([&cancel] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    cancel = true;
+  });
+
+  std::string output;
+  auto start = std::chrono::steady_clock::now();
+  REQUIRE_FALSE(spawnChildProcess(command, argument, output, 5000, &cancel));
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  canceller.join();
+
+  REQUIRE(elapsed < std::chrono::milliseconds(4000));
+}
+
 TEST_CASE("Child process with multiple arguments", "[utils]") {
 #if VISAGE_WINDOWS
   std::string command = "cmd.exe";
@@ -268,4 +294,146 @@ TEST_CASE("Child process with invalid PID handling", "[utils]") {
   std::string output;
   REQUIRE(spawnChildProcess(command, argument, output, 1000));
 #endif
-}
\ No newline at end of file
+}
+
+TEST_CASE("Async child process streams output", "[utils]") {
+#if VISAGE_WINDOWS
+  std::string command = "cmd.exe";
+  std::string argument = "/C echo streamed";
+#else
+  std::string command = "/bin/echo";
+  std::string argument = "streamed";
+#endif
+
+  std::mutex mutex;
+  std::string output;
+  std::atomic<bool> exit_reported = false;
+  ChildProcess process;
+  ChildProcess::Options options;
+  options.on_output = [&](const std::string& chunk) {
+    std::lock_guard<std::mutex> lock(mutex);
+    output += chunk;
+  };
+  options.on_exit = [&](ChildProcess::Result result, int exit_code) {
+    exit_reported = result == ChildProcess::Result::Exited && exit_code == 0;
+  };
+
+  REQUIRE(process.start(command, argument, options));
+  REQUIRE(process.waitForExit(5000));
+  REQUIRE(exit_reported);
+  REQUIRE(process.result() == ChildProcess::Result::Exited);
+  REQUIRE(process.exitCode() == 0);
+  REQUIRE(String(output).trim().toUtf8() == "streamed");
+}
+
+TEST_CASE("Async child process reports exit codes", "[utils]") {
+#if VISAGE_WINDOWS
+  std::string command = "cmd.exe";
+  std::string argument = "/C exit 1";
+#else
+  std::string command = "/bin/false";
+  std::string argument = "";
+#endif
+
+  ChildProcess process;
+  REQUIRE(process.start(command, argument, {}));
+  REQUIRE(process.waitForExit(5000));
+  REQUIRE(process.result() == ChildProcess::Result::Exited);
+  REQUIRE(process.exitCode() == 1);
+
+  ChildProcess missing;
+  REQUIRE_FALSE(missing.start("asdfjkasdfjkabjbizkejzvbieizieizeiezize", "", {}));
+  REQUIRE(missing.result() == ChildProcess::Result::NotStarted);
+}
+
+TEST_CASE("Async child process state is final when on_exit runs", "[utils]") {
+#if VISAGE_WINDOWS
+  std::string command = "cmd.exe";
+  std::string argument = "/C exit 1";
+#else
+  std::string command = "/bin/false";
+  std::string argument = "";
+#endif
+
+  ChildProcess process;
+  std::atomic<int> exit_code = 0;
+  std::atomic<bool> running = true;
+  std::atomic<bool> restart_exited = false;
+  ChildProcess::Options restart_options;
+  restart_options.on_exit = [&](ChildProcess::Result, int) { restart_exited = true; };
+  ChildProcess::Options options;
+  options.on_exit = [&](ChildProcess::Result, int) {
+    exit_code = process.exitCode();
+    running = process.running();
+    process.start(command, argument, restart_options);
+  };
+
+  REQUIRE(process.start(command, argument, options));
+  REQUIRE(process.waitForExit(5000));
+  REQUIRE(exit_code == 1);
+  REQUIRE_FALSE(running);
+  REQUIRE(restart_exited);
+  REQUIRE(process.result() == ChildProcess::Result::Exited);
+  REQUIRE(process.exitCode() == 1);
+}
+
+TEST_CASE("Async child process kill and timeout", "[utils]") {
+#if VISAGE_WINDOWS
+  std::string command = "cmd.exe";
+  std::string argument = "/C timeout /t 5 /nobreak";
+#else
+  std::string command = "/bin/sleep";
+  std::string argument = "5";
+#endif
+
+  auto start = std::chrono::steady_clock::now();
+  ChildProcess killed;
+  REQUIRE(killed.start(command, argument, {}));
+  REQUIRE(killed.running());
+  killed.kill();
+  REQUIRE(killed.waitForExit(3000));
+  REQUIRE(killed.result() == ChildProcess::Result::Killed);
+  REQUIRE(killed.exitCode() == -1);
+
+  ChildProcess timed_out;
+  ChildProcess::Options options;
+  options.timeout_ms = 100;
+  REQUIRE(timed_out.start(command, argument, options));
+  REQUIRE_FALSE(timed_out.waitForExit(10));
+  REQUIRE(timed_out.waitForExit(3000));
+  REQUIRE(timed_out.result() == ChildProcess::Result::TimedOut);
+  REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(4000));
+}
+
+TEST_CASE("Async child process callbacks go through the dispatcher", "[utils]") {
+#if VISAGE_WINDOWS
+  std::string command = "cmd.exe";
+  std::string argument = "/C echo dispatched";
+#else
+  std::string command = "/bin/echo";
+  std::string argument = "dispatched";
+#endif
+
+  std::mutex mutex;
+  std::vector<std::function<void()>> queued;
+  std::string output;
+  bool exited = false;
+  ChildProcess process;
+  ChildProcess::Options options;
+  options.dispatcher = [&](std::function<void()> callback) {
+    std::lock_guard<std::mutex> lock(mutex);
+    queued.push_back(std::move(callback));
+  };
+  options.on_output = [&](const std::string& chunk) { output += chunk; };
+  options.on_exit = [&](ChildProcess::Result, int) { exited = true; };
+
+  REQUIRE(process.start(command, argument, options));
+  REQUIRE(process.waitForExit(5000));
+  REQUIRE(output.empty());
+  REQUIRE_FALSE(exited);
+
+  for (auto& callback : queued)
+    callback();
+  REQUIRE(exited);
+  REQUIRE(String(output).trim().toUtf8() == "dispatched");
+}
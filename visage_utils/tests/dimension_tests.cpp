@@ -210,4 +210,20 @@ TEST_CASE("Dimension user-defined literal variants", "[utils]") {
   Dimension float_vmax = 30.5_vmax;
   REQUIRE(int_vmax.compute(1.0f, 200.0f, 100.0f) == Catch::Approx(60.0f));
   REQUIRE(float_vmax.compute(1.0f, 200.0f, 100.0f) == Catch::Approx(61.0f));
-}
\ No newline at end of file
+}
+
+TEST_CASE("Dimension expressions and custom functions", "[utils]") {
+  Dimension custom(25.0f, [](float amount, float scale, float, float) { return amount * scale; });
+  REQUIRE((custom * 2.0f).compute(2.0f, 100.0f, 100.0f) == 100.0f);
+  REQUIRE((-custom + 10_npx).compute(1.0f, 100.0f, 100.0f) == -15.0f);
+  REQUIRE(Dimension(1.0f, nullptr).compute(1.0f, 100.0f, 100.0f, 7.0f) == 7.0f);
+
+  Dimension nested = Dimension::max(10_px, 50_vw - 20_npx).min(100_vh) * 0.5f;
+  REQUIRE(nested.compute(1.0f, 100.0f, 100.0f) == 15.0f);
+  REQUIRE(nested.compute(1.0f, 400.0f, 100.0f) == 50.0f);
+  REQUIRE(nested.compute(4.0f, 20.0f, 100.0f) == 20.0f);
+
+  Dimension copy = nested;
+  REQUIRE(copy.expression == nested.expression);
+  REQUIRE((50_vw).expression == nullptr);
+}
@@ -158,6 +158,26 @@ TEST_CASE("CallbackList reset functionality", "[utils]") {
   REQUIRE(result == 100);
 }
 
+TEST_CASE("CallbackList keeps original until listeners change", "[utils]") {
+  int original_calls = 0;
+  CallbackList<int()> callbacks([&original_calls] { return ++original_calls; });
+  REQUIRE(callbacks.usesOriginal());
+  REQUIRE(callbacks.callback() == 1);
+
+  callbacks.remove([] { return 0; });
+  REQUIRE_FALSE(callbacks.usesOriginal());
+  REQUIRE(callbacks.callback() == 2);
+
+  callbacks.clear();
+  REQUIRE(callbacks.callback() == 0);
+  callbacks.reset();
+  REQUIRE(callbacks.usesOriginal());
+  REQUIRE(callbacks.callback() == 3);
+
+  CallbackList<int()> empty;
+  REQUIRE_FALSE(empty.usesOriginal());
+}
+
 TEST_CASE("CallbackList empty behavior", "[utils]") {
   CallbackList<int()> empty_callbacks;
   int result = empty_callbacks.callback();
@@ -20,11 +20,15 @@
  */
 
 #include "visage_utils/file_system.h"
+#include "visage_utils/file_watcher.h"
 
+#include <algorithm>
+#include <atomic>
 #include <catch2/catch_approx.hpp>
 #include <catch2/catch_test_macros.hpp>
 #include <chrono>
 #include <filesystem>
+#include <mutex>
 #include <thread>
 
 using namespace visage;
@@ -54,6 +58,26 @@ TEST_CASE("Replace file with text", "[utils]") {
   std::filesystem::remove(temp_file);
 }
 
+TEST_CASE("Mapped file matches the file contents", "[utils]") {
+  File temp_file = createTemporaryFile("bin");
+  std::vector<unsigned char> test_data(10000);
+  for (int i = 0; i < test_data.size(); ++i)
+    test_data[i] = static_cast<unsigned char>(i * 31);
+  REQUIRE(replaceFileWithData(temp_file, test_data.data(), test_data.size()));
+
+  {
+    MappedFile mapped(temp_file);
+    REQUIRE(mapped.data() != nullptr);
+    REQUIRE(mapped.size() == test_data.size());
+    REQUIRE(std::equal(test_data.begin(), test_data.end(), mapped.data()));
+  }
+
+  std::filesystem::remove(temp_file);
+  MappedFile missing(temp_file);
+  REQUIRE(missing.data() == nullptr);
+  REQUIRE(missing.size() == 0);
+}
+
 TEST_CASE("Replace file with binary data", "[utils]") {
   File temp_file = createTemporaryFile("bin");
 
@@ -222,6 +246,117 @@ TEST_CASE("Search in non-existent directory", "[utils]") {
   REQUIRE(dirs.empty());
 }
 
+TEST_CASE("File name matcher globs and extensions", "[utils]") {
+  FileNameMatcher glob("kick_??*.wav");
+  REQUIRE(glob.matches("kick_01.wav"));
+  REQUIRE(glob.matches("KICK_01_hard.WAV"));
+  REQUIRE_FALSE(glob.matches("kick_1.wav"));
+  REQUIRE_FALSE(glob.matches("kick_01.wav.bak"));
+
+  FileNameMatcher extensions("", { "wav", ".aif" });
+  REQUIRE(extensions.matches("snare.aif"));
+  REQUIRE(extensions.matches("snare.Wav"));
+  REQUIRE_FALSE(extensions.matches("snare.mp3"));
+
+  FileNameMatcher case_sensitive("*.wav", {}, true);
+  REQUIRE_FALSE(case_sensitive.matches("snare.WAV"));
+  REQUIRE(FileNameMatcher().matches("anything"));
+}
+
+TEST_CASE("File search streams batches from worker threads", "[utils]") {
+  File temp_dir = std::filesystem::temp_directory_path() / "visage_test_file_search";
+  std::filesystem::remove_all(temp_dir);
+  int num_wav_files = 0;
+  for (int i = 0; i < 8; ++i) {
+    File folder = temp_dir / ("folder" + std::to_string(i)) / "nested";
+    std::filesystem::create_directories(folder);
+    for (int f = 0; f < 10; ++f) {
+      (void)replaceFileWithText(folder / ("sample" + std::to_string(f) + ".wav"), "content");
+      (void)replaceFileWithText(folder / ("notes" + std::to_string(f) + ".txt"), "content");
+      num_wav_files++;
+    }
+  }
+
+  for (int num_threads : { 0, 3 }) {
+    std::mutex mutex;
+    std::vector<File> found;
+    int num_batches = 0;
+    size_t largest_batch = 0;
+    bool finished = false;
+    bool cancelled = true;
+
+    FileSearch search;
+    FileSearch::Options options;
+    options.extensions = { ".wav" };
+    options.batch_size = 16;
+    options.num_threads = num_threads;
+    search.start(
+        temp_dir, options,
+        [&](std::vector<File> batch) {
+          std::lock_guard<std::mutex> lock(mutex);
+          largest_batch = std::max(largest_batch, batch.size());
+          num_batches++;
+          found.insert(found.end(), batch.begin(), batch.end());
+        },
+        [&](bool was_cancelled) {
+          finished = true;
+          cancelled = was_cancelled;
+        });
+
+    REQUIRE(search.waitForEnd(10000));
+    REQUIRE(search.finished());
+    REQUIRE(finished);
+    REQUIRE_FALSE(cancelled);
+    REQUIRE(found.size() == num_wav_files);
+    REQUIRE(largest_batch <= 16);
+    REQUIRE(num_batches >= num_wav_files / 16);
+    for (const File& file : found)
+      REQUIRE(file.extension() == ".wav");
+  }
+
+  FileSearch directory_search;
+  FileSearch::Options directory_options;
+  directory_options.glob = "nest*";
+  directory_options.include_files = false;
+  directory_options.include_directories = true;
+  std::atomic<int> num_directories = 0;
+  directory_search.start(temp_dir, directory_options,
+                         [&](std::vector<File> batch) { num_directories += batch.size(); });
+  REQUIRE(directory_search.waitForEnd(10000));
+  REQUIRE(num_directories == 8);
+
+  std::filesystem::remove_all(temp_dir);
+}
+
+TEST_CASE("File search can be cancelled from a batch callback", "[utils]") {
+  File temp_dir = std::filesystem::temp_directory_path() / "visage_test_file_search_cancel";
+  std::filesystem::remove_all(temp_dir);
+  for (int i = 0; i < 20; ++i) {
+    File folder = temp_dir / ("folder" + std::to_string(i));
+    std::filesystem::create_directories(folder);
+    (void)replaceFileWithText(folder / "file.txt", "content");
+  }
+
+  FileSearch search;
+  FileSearch::Options options;
+  options.batch_size = 1;
+  std::atomic<int> num_batches = 0;
+  bool cancelled = false;
+  search.start(
+      temp_dir, options,
+      [&](std::vector<File>) {
+        num_batches++;
+        search.cancel();
+      },
+      [&](bool was_cancelled) { cancelled = was_cancelled; });
+
+  REQUIRE(search.waitForEnd(10000));
+  REQUIRE(cancelled);
+  REQUIRE(num_batches < 20);
+
+  std::filesystem::remove_all(temp_dir);
+}
+
 TEST_CASE("Write access check", "[utils]") {
   File temp_file = createTemporaryFile("access_test");
 
@@ -229,4 +364,33 @@ TEST_CASE("Write access check", "[utils]") {
   REQUIRE(hasWriteAccess(temp_file));
 
   std::filesystem::remove(temp_file);
-}
\ No newline at end of file
+}
+
+TEST_CASE("File watcher debounces changes to watched files", "[utils]") {
+  File directory = std::filesystem::temp_directory_path() / "visage_file_watcher_test";
+  std::filesystem::create_directories(directory);
+  File watched = directory / "watched.txt";
+  REQUIRE(replaceFileWithText(watched, "initial"));
+
+  std::atomic<int> file_changes = 0;
+  std::atomic<int> folder_changes = 0;
+  {
+    FileWatcher watcher(20);
+    watcher.watch(watched, [&](const File&) { file_changes++; });
+    watcher.watch(directory, [&](const File&) { folder_changes++; });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    for (int i = 0; i < 5; ++i)
+      replaceFileWithText(watched, "edit " + std::to_string(i));
+    replaceFileWithText(directory / "other.txt", "other");
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (folder_changes.load() < 2 && std::chrono::steady_clock::now() < deadline)
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+
+  REQUIRE(file_changes.load() == 1);
+  REQUIRE(folder_changes.load() == 2);
+  std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,155 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "visage_utils/lock_free_queue.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <thread>
+#include <vector>
+
+using namespace visage;
+
+TEST_CASE("InplaceTask stores small callables inline", "[utils]") {
+  int count = 0;
+  auto small = [&count] { count++; };
+  auto full = [&count, padding = std::array<char, InplaceTask::kStorageSize - sizeof(int*)> {}] {
+    count += padding.size();
+  };
+  auto large = [&count, padding = std::array<char, 128> {}] { count += padding.size(); };
+  REQUIRE(InplaceTask::storesInline<decltype(small)>());
+  REQUIRE(InplaceTask::storesInline<decltype(full)>());
+  REQUIRE_FALSE(InplaceTask::storesInline<decltype(large)>());
+
+  InplaceTask small_task(small);
+  InplaceTask large_task(large);
+  InplaceTask moved = std::move(large_task);
+  REQUIRE_FALSE(large_task);
+  REQUIRE(moved);
+
+  small_task();
+  moved();
+  REQUIRE(count == 129);
+}
+
+TEST_CASE("MpscQueue is bounded and first in first out", "[utils]") {
+  MpscQueue<int> queue(3);
+  REQUIRE(queue.capacity() == 4);
+  REQUIRE(queue.empty());
+
+  for (int i = 0; i < 4; ++i)
+    REQUIRE(queue.tryPush(int(i)));
+  REQUIRE_FALSE(queue.tryPush(4));
+
+  int value = -1;
+  for (int i = 0; i < 4; ++i) {
+    REQUIRE(queue.tryPop(value));
+    REQUIRE(value == i);
+  }
+  REQUIRE_FALSE(queue.tryPop(value));
+  REQUIRE(queue.tryPush(5));
+  REQUIRE_FALSE(queue.empty());
+}
+
+TEST_CASE("SpscRingBuffer wraps and drops values that don't fit", "[utils]") {
+  SpscRingBuffer<float> ring(6);
+  REQUIRE(ring.capacity() == 8);
+
+  float values[10] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+  REQUIRE(ring.write(values, 5) == 5);
+  float result[10] {};
+  REQUIRE(ring.read(result, 3) == 3);
+  REQUIRE(result[2] == 2.0f);
+
+  REQUIRE(ring.write(values, 10) == 6);
+  REQUIRE(ring.available() == 8);
+  REQUIRE(ring.read(result, 10) == 8);
+  REQUIRE(result[0] == 3.0f);
+  REQUIRE(result[1] == 4.0f);
+  REQUIRE(result[2] == 0.0f);
+  REQUIRE(result[7] == 5.0f);
+  REQUIRE(ring.available() == 0);
+}
+
+#if !VISAGE_EMSCRIPTEN
+TEST_CASE("MpscQueue with concurrent producers", "[utils]") {
+  static constexpr int kProducers = 4;
+  static constexpr int kPerProducer = 10000;
+  MpscQueue<InplaceTask> queue(64);
+  std::atomic<long long> sum = 0;
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; ++p) {
+    producers.emplace_back([&queue, &sum] {
+      for (int i = 0; i < kPerProducer; ++i) {
+        while (!queue.tryPush(InplaceTask([&sum, i] { sum += i; })))
+          std::this_thread::yield();
+      }
+    });
+  }
+
+  int num_popped = 0;
+  InplaceTask task;
+  while (num_popped < kProducers * kPerProducer) {
+    if (queue.tryPop(task)) {
+      task();
+      num_popped++;
+    }
+  }
+
+  for (auto& producer : producers)
+    producer.join();
+
+  REQUIRE(sum == kProducers * (kPerProducer - 1LL) * kPerProducer / 2);
+}
+
+TEST_CASE("SpscRingBuffer between two threads", "[utils]") {
+  static constexpr int kTotal = 100000;
+  SpscRingBuffer<int> ring(256);
+
+  std::thread producer([&ring] {
+    int block[37];
+    int next = 0;
+    while (next < kTotal) {
+      int count = std::min(37, kTotal - next);
+      for (int i = 0; i < count; ++i)
+        block[i] = next + i;
+      next += static_cast<int>(ring.write(block, count));
+      std::this_thread::yield();
+    }
+  });
+
+  bool in_order = true;
+  int expected = 0;
+  int block[64];
+  while (expected < kTotal) {
+    size_t count = ring.read(block, 64);
+    for (size_t i = 0; i < count; ++i)
+      in_order = in_order && block[i] == expected++;
+  }
+  producer.join();
+
+  REQUIRE(in_order);
+  REQUIRE(ring.available() == 0);
+}
+#endif
@@ -378,3 +378,74 @@ TEST_CASE("IBounds reduced asymmetric", "[utils]") {
     REQUIRE(reduced.height() == 0);
   }
 }
+
+TEST_CASE("IRegion union merges touching rects into bands", "[utils]") {
+  IRegion region;
+  region.add({ 0, 0, 10, 10 });
+  region.add({ 10, 0, 10, 10 });
+  REQUIRE(region.numRects() == 1);
+  REQUIRE(region.rects()[0] == IBounds(0, 0, 20, 10));
+
+  region.add({ 0, 10, 20, 5 });
+  REQUIRE(region.numRects() == 1);
+  REQUIRE(region.rects()[0] == IBounds(0, 0, 20, 15));
+
+  region.add({ 5, 5, 30, 5 });
+  REQUIRE(region.numRects() == 3);
+  REQUIRE(region.bounds() == IBounds(0, 0, 35, 15));
+  REQUIRE(region.contains(IBounds(0, 0, 20, 15)));
+  REQUIRE(region.contains(IBounds(5, 5, 30, 5)));
+  REQUIRE_FALSE(region.contains(IBounds(5, 0, 30, 10)));
+}
+
+TEST_CASE("IRegion subtract leaves non-overlapping rects", "[utils]") {
+  IRegion region(IBounds(0, 0, 30, 30));
+  region.subtract(IBounds(10, 10, 10, 10));
+  REQUIRE(region.numRects() == 4);
+  REQUIRE_FALSE(region.contains(15, 15));
+  REQUIRE(region.contains(5, 15));
+  REQUIRE(region.contains(25, 15));
+  REQUIRE_FALSE(region.overlaps(IBounds(10, 10, 10, 10)));
+
+  for (int i = 0; i < region.numRects(); ++i) {
+    for (int j = i + 1; j < region.numRects(); ++j)
+      REQUIRE_FALSE(region.rects()[i].overlaps(region.rects()[j]));
+  }
+
+  region.add(IBounds(10, 10, 10, 10));
+  REQUIRE(region == IRegion(IBounds(0, 0, 30, 30)));
+
+  region.subtract(IBounds(-10, -10, 100, 100));
+  REQUIRE(region.isEmpty());
+}
+
+TEST_CASE("IRegion intersect keeps only shared area", "[utils]") {
+  IRegion region(IBounds(0, 0, 20, 20));
+  region.add(IBounds(40, 0, 20, 20));
+
+  IRegion other(IBounds(10, 10, 40, 20));
+  region.intersect(other);
+  REQUIRE(region.numRects() == 2);
+  REQUIRE(region.rects()[0] == IBounds(10, 10, 10, 10));
+  REQUIRE(region.rects()[1] == IBounds(40, 10, 10, 10));
+
+  region.intersect(IBounds(0, 0, 15, 15));
+  REQUIRE(region.numRects() == 1);
+  REQUIRE(region.rects()[0] == IBounds(10, 10, 5, 5));
+
+  region.intersect(IBounds(100, 100, 10, 10));
+  REQUIRE(region.isEmpty());
+}
+
+TEST_CASE("IRegion has one representation for an area", "[utils]") {
+  IRegion by_rows;
+  for (int y = 0; y < 8; ++y)
+    by_rows.add({ 0, y, 8, 1 });
+
+  IRegion by_columns;
+  for (int x = 0; x < 8; ++x)
+    by_columns.add({ x, 0, 1, 8 });
+
+  REQUIRE(by_rows == by_columns);
+  REQUIRE(by_rows.numRects() == 1);
+}
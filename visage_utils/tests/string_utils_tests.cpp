@@ -35,6 +35,22 @@ TEST_CASE("String conversion", "[utils]") {
   REQUIRE(String(wide).toUtf32() == original);
 }
 
+TEST_CASE("String conversion around ASCII runs", "[utils]") {
+  std::string ascii = "The quick brown fox jumps over the lazy dog";
+  REQUIRE(String::convertToUtf32(ascii) == U"The quick brown fox jumps over the lazy dog");
+  REQUIRE(String::convertToUtf8(String::convertToUtf32(ascii)) == ascii);
+
+  for (int prefix = 0; prefix < 20; ++prefix) {
+    std::u32string original = std::u32string(prefix, U'a') + U"\u00E9\U0001F602b";
+    std::string utf8 = String::convertToUtf8(original);
+    REQUIRE(utf8.size() == prefix + 7);
+    REQUIRE(String::convertToUtf32(utf8) == original);
+  }
+
+  REQUIRE(String::convertToUtf32("").empty());
+  REQUIRE(String::convertToUtf8(std::u32string()).empty());
+}
+
 TEST_CASE("Base 64 conversion", "[utils]") {
   static constexpr int kMaxSize = 10000;
   int size = 1 + (rand() % (kMaxSize - 1));
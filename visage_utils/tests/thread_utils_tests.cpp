@@ -24,6 +24,10 @@
 #include <atomic>
 #include <catch2/catch_test_macros.hpp>
 #include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
 
 using namespace visage;
 
@@ -144,6 +148,119 @@ TEST_CASE("Thread task modification", "[utils]") {
   REQUIRE(second_task_executed);
 }
 
+TEST_CASE("Worker pool runs every task once", "[utils]") {
+  WorkerPool pool(4);
+  REQUIRE(pool.numThreads() == 4);
+
+  for (int run = 0; run < 20; ++run) {
+    std::vector<std::atomic<int>> counts(257);
+    pool.parallelFor(counts.size(), [&counts](int index) { counts[index]++; });
+    for (const auto& count : counts)
+      REQUIRE(count == 1);
+  }
+}
+
+TEST_CASE("Worker pool without threads runs serially", "[utils]") {
+  WorkerPool pool(0);
+  std::vector<int> order;
+  pool.parallelFor(5, [&order](int index) { order.push_back(index); });
+  REQUIRE(order == std::vector<int> { 0, 1, 2, 3, 4 });
+}
+
+TEST_CASE("Thread pool futures chain continuations", "[utils]") {
+  ThreadPool pool(3);
+  TaskFuture<int> value = pool.submit([] { return 21; });
+  TaskFuture<int> doubled = value.then([](int result) { return result * 2; });
+  std::atomic<bool> finished = false;
+  TaskFuture<void> done = doubled.then([&finished](int result) { finished = result == 42; });
+
+  REQUIRE(done.waitFor(5000));
+  REQUIRE(finished);
+  REQUIRE(doubled.get() == 42);
+
+  ThreadPool serial(0);
+  TaskFuture<int> inline_result = serial.submit([] { return 7; });
+  REQUIRE(inline_result.ready());
+  REQUIRE(inline_result.get() == 7);
+}
+
+TEST_CASE("Thread pool runs tasks posted from workers", "[utils]") {
+  ThreadPool pool(4);
+  std::atomic<int> count = 0;
+  for (int i = 0; i < 50; ++i) {
+    pool.post([&pool, &count] {
+      for (int t = 0; t < 10; ++t)
+        pool.post([&count] { count++; }, TaskPriority::Background);
+      count++;
+    });
+  }
+
+  pool.waitForIdle();
+  REQUIRE(count == 550);
+}
+
+TEST_CASE("Thread pool runs interactive tasks first", "[utils]") {
+  ThreadPool pool(1);
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool open = false;
+  pool.post([&] {
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [&open] { return open; });
+  });
+
+  std::vector<int> order;
+  for (int i = 0; i < 3; ++i)
+    pool.post([&order, i] { order.push_back(10 + i); }, TaskPriority::Background);
+  for (int i = 0; i < 3; ++i)
+    pool.post([&order, i] { order.push_back(i); }, TaskPriority::Interactive);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    open = true;
+  }
+  condition.notify_all();
+  pool.waitForIdle();
+  REQUIRE(order == std::vector<int> { 0, 1, 2, 10, 11, 12 });
+}
+
+TEST_CASE("Thread pool continuations resume through the main thread dispatcher", "[utils]") {
+  std::mutex mutex;
+  std::vector<std::function<void()>> main_thread_tasks;
+  ThreadPool::setMainThreadDispatcher([&](std::function<void()> task) {
+    std::lock_guard<std::mutex> lock(mutex);
+    main_thread_tasks.push_back(std::move(task));
+  });
+
+  ThreadPool pool(2);
+  bool resumed = false;
+  TaskFuture<int> result = pool.submit([] { return std::string("decoded"); })
+                               .thenOnMainThread([&resumed](const std::string& text) {
+                                 resumed = text == "decoded";
+                                 return static_cast<int>(text.size());
+                               });
+  pool.waitForIdle();
+  REQUIRE_FALSE(resumed);
+  REQUIRE_FALSE(result.ready());
+
+  ThreadPool::setMainThreadDispatcher(nullptr);
+  for (auto& task : main_thread_tasks)
+    task();
+  REQUIRE(resumed);
+  REQUIRE(result.get() == 7);
+}
+
+TEST_CASE("Thread wait for end wakes when the task completes", "[utils]") {
+  Thread thread;
+  thread.setThreadTask([] { Thread::sleep(20); });
+  thread.start();
+
+  long long start = time::milliseconds();
+  REQUIRE(thread.waitForEnd(1000));
+  REQUIRE(time::milliseconds() - start < 500);
+  REQUIRE(thread.waitForEnd(0));
+}
+
 #endif
 
 TEST_CASE("Main thread detection", "[utils]") {
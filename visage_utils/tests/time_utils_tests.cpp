@@ -78,12 +78,66 @@ TEST_CASE("Format time edge cases", "[utils]") {
 }
 
 TEST_CASE("Time consistency", "[utils]") {
-  Time time_point = now();
-  long long ms_from_function = milliseconds();
+  long long ns = nanoseconds();
+  long long us = microseconds();
+  long long ms = milliseconds();
+
+  REQUIRE(us >= ns / 1000);
+  REQUIRE(us - ns / 1000 < 10000);
+  REQUIRE(ms >= ns / 1000000);
+  REQUIRE(ms - ns / 1000000 < 10);
+}
+
+TEST_CASE("Monotonic time never goes backwards", "[utils]") {
+  long long previous = nanoseconds();
+  for (int i = 0; i < 1000; ++i) {
+    long long current = nanoseconds();
+    REQUIRE(current >= previous);
+    previous = current;
+  }
+}
+
+TEST_CASE("Frame pacer keeps absolute deadlines", "[utils]") {
+  visage::FramePacer pacer;
+  pacer.setInterval(1000);
+  REQUIRE(pacer.nextDeadline(5000) == 6000);
+  REQUIRE(pacer.nextDeadline(6200) == 7000);
+  REQUIRE(pacer.nextDeadline(7900) == 8000);
 
-  auto time_point_ms = std::chrono::duration_cast<std::chrono::milliseconds>(time_point.time_since_epoch())
-                           .count();
+  REQUIRE(pacer.nextDeadline(11500) == 12000);
+  REQUIRE(pacer.nextDeadline(12000) == 13000);
 
-  long long difference = std::abs(time_point_ms - ms_from_function);
-  REQUIRE(difference < 10);
-}
\ No newline at end of file
+  pacer.reset();
+  REQUIRE(pacer.nextDeadline(20300) == 21300);
+
+  pacer.setRefreshRate(50.0);
+  REQUIRE(pacer.interval() == 20000);
+  pacer.setInterval(10);
+  REQUIRE(pacer.interval() == visage::FramePacer::kMinIntervalUs);
+}
+
+TEST_CASE("Frame pacer measures tick jitter", "[utils]") {
+  visage::FramePacer pacer;
+  pacer.setInterval(1000);
+  REQUIRE(pacer.averageJitter() == 0.0);
+
+  pacer.tick(1000);
+  pacer.tick(2000);
+  pacer.tick(3100);
+  pacer.tick(3900);
+  pacer.tick(5000);
+  REQUIRE(pacer.numSamples() == 4);
+  REQUIRE(pacer.averageJitter() == 100.0);
+  REQUIRE(pacer.maxJitter() == 200);
+
+  pacer.tick(20000);
+  REQUIRE(pacer.numSamples() == 4);
+
+  for (int i = 1; i <= 2 * visage::FramePacer::kJitterWindow; ++i)
+    pacer.tick(20000 + i * 1000);
+  REQUIRE(pacer.numSamples() == visage::FramePacer::kJitterWindow);
+  REQUIRE(pacer.maxJitter() == 0);
+
+  pacer.clearStats();
+  REQUIRE(pacer.numSamples() == 0);
+}
@@ -0,0 +1,61 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "visage_utils/trace.h"
+
+#include <catch2/catch_test_macros.hpp>
+#include <thread>
+
+using namespace visage;
+
+TEST_CASE("Tracer records nothing until enabled", "[utils]") {
+  Tracer::clear();
+  { Tracer::Scope scope("disabled"); }
+  Tracer::addInstant("disabled instant");
+  REQUIRE(Tracer::numEvents() == 0);
+}
+
+TEST_CASE("Tracer exports scopes from each thread as Chrome trace JSON", "[utils]") {
+  Tracer::clear();
+  Tracer::setEnabled(true);
+  {
+    Tracer::Scope scope("outer", std::string("frame \"name\""));
+    Tracer::addInstant("marker");
+  }
+  std::thread thread([] { Tracer::Scope scope("worker"); });
+  thread.join();
+  Tracer::setEnabled(false);
+
+  REQUIRE(Tracer::numEvents() == 3);
+  REQUIRE(Tracer::numDroppedEvents() == 0);
+
+  std::string json = Tracer::chromeTraceJson();
+  REQUIRE(json.find("\"traceEvents\"") != std::string::npos);
+  REQUIRE(json.find("\"name\":\"outer\"") != std::string::npos);
+  REQUIRE(json.find("\"ph\":\"X\"") != std::string::npos);
+  REQUIRE(json.find("\"name\":\"marker\"") != std::string::npos);
+  REQUIRE(json.find("\"ph\":\"i\"") != std::string::npos);
+  REQUIRE(json.find("\"detail\":\"frame \\\"name\\\"\"") != std::string::npos);
+  REQUIRE(json.find("\"name\":\"worker\"") != std::string::npos);
+
+  Tracer::clear();
+  REQUIRE(Tracer::numEvents() == 0);
+}
@@ -0,0 +1,116 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "visage_utils/value_mirror.h"
+
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <thread>
+
+using namespace visage;
+
+TEST_CASE("ValueMirror only reports changes", "[utils]") {
+  ValueMirror<float> mirror(0.5f);
+  REQUIRE_FALSE(mirror.pull());
+  REQUIRE(mirror.value() == 0.5f);
+
+  mirror.set(0.5f);
+  REQUIRE_FALSE(mirror.pull());
+
+  mirror.set(0.25f);
+  mirror.set(0.75f);
+  REQUIRE(mirror.pull());
+  REQUIRE(mirror.value() == 0.75f);
+  REQUIRE_FALSE(mirror.pull());
+  REQUIRE(mirror.value() == 0.75f);
+}
+
+TEST_CASE("MeterChannel publishes peaks per block", "[utils]") {
+  MeterChannel meters(2);
+  REQUIRE(meters.numMeters() == 2);
+
+  float samples[] = { 0.1f, -0.8f, 0.3f };
+  meters.accumulate(0, samples, 3);
+  meters.accumulate(1, 0.2f);
+  REQUIRE_FALSE(meters.pull());
+
+  meters.publish();
+  REQUIRE(meters.pull());
+  REQUIRE(meters.value()[0] == 0.8f);
+  REQUIRE(meters.value()[1] == 0.2f);
+
+  meters.publish();
+  REQUIRE(meters.pull());
+  REQUIRE(meters.value()[0] == 0.0f);
+}
+
+TEST_CASE("MeterChannel keeps the loudest peak across unread blocks", "[utils]") {
+  MeterChannel meters(1);
+  meters.accumulate(0, -0.9f);
+  meters.publish();
+  meters.accumulate(0, 0.1f);
+  meters.publish();
+
+  REQUIRE(meters.pull());
+  REQUIRE(meters.value()[0] == 0.9f);
+  REQUIRE_FALSE(meters.pull());
+}
+
+#if !VISAGE_EMSCRIPTEN
+TEST_CASE("TripleBuffer hands off consistent values across threads", "[utils]") {
+  struct Pair {
+    int a = 0;
+    int b = 0;
+  };
+
+  static constexpr int kNumWrites = 100000;
+  TripleBuffer<Pair> buffer;
+  std::atomic<bool> done = false;
+
+  std::thread writer([&] {
+    for (int i = 1; i <= kNumWrites; ++i) {
+      buffer.writeBuffer() = { i, -i };
+      buffer.publish();
+    }
+    done = true;
+  });
+
+  int last = 0;
+  bool consistent = true;
+  bool ordered = true;
+  while (true) {
+    bool finished = done;
+    if (buffer.pull()) {
+      const Pair& pair = buffer.readBuffer();
+      consistent = consistent && pair.a == -pair.b;
+      ordered = ordered && pair.a > last;
+      last = pair.a;
+    }
+    else if (finished)
+      break;
+  }
+  writer.join();
+
+  REQUIRE(consistent);
+  REQUIRE(ordered);
+  REQUIRE(buffer.readBuffer().a == kNumWrites);
+}
+#endif
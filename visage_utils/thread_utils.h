@@ -22,13 +22,22 @@
 #pragma once
 
 #include "defines.h"
+#include "lock_free_queue.h"
 #include "time_utils.h"
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <thread>
+#include <type_traits>
+#include <vector>
 
 namespace visage {
   class Thread {
@@ -60,7 +69,7 @@ namespace visage {
 
     void start() {
       VISAGE_ASSERT(!running());
-#if VISAGE_EMSCRIPTEN
+#if VISAGE_EMSCRIPTEN && !defined(__EMSCRIPTEN_PTHREADS__)
       VISAGE_ASSERT(false);
 #endif
 
@@ -88,12 +97,11 @@ namespace visage {
     void setThreadTask(std::function<void()> task) { task_ = std::move(task); }
 
     bool waitForEnd(int ms_timeout) {
-      long long ms_start = time::milliseconds();
-      while (!completed()) {
-        if (time::milliseconds() - ms_start > ms_timeout)
+      {
+        std::unique_lock<std::mutex> lock(completion_mutex_);
+        if (!completion_condition_.wait_for(lock, std::chrono::milliseconds(ms_timeout),
+                                            [this] { return completed(); }))
           return false;
-
-        sleep(5);
       }
       stop();
       return true;
@@ -102,12 +110,19 @@ namespace visage {
     const std::string& name() const { return name_; }
     bool shouldRun() const { return should_run_.load(); }
     bool running() const { return thread_ && thread_->joinable(); }
+    // Set by the thread itself, so it's right even before start() returns.
+    bool isCurrentThread() const { return thread_id_.load() == std::this_thread::get_id(); }
     bool completed() const { return completed_.load(); }
 
   private:
     void startRun() {
+      thread_id_ = std::this_thread::get_id();
       run();
-      completed_ = true;
+      {
+        std::lock_guard<std::mutex> lock(completion_mutex_);
+        completed_ = true;
+      }
+      completion_condition_.notify_all();
     }
 
     std::string name_;
@@ -115,5 +130,434 @@ namespace visage {
     std::atomic<bool> should_run_ = true;
     std::function<void()> task_;
     std::unique_ptr<std::thread> thread_;
+    std::atomic<std::thread::id> thread_id_;
+    std::mutex completion_mutex_;
+    std::condition_variable completion_condition_;
+  };
+
+  class WorkerPool {
+  public:
+    explicit WorkerPool(int num_threads) {
+#if VISAGE_EMSCRIPTEN
+      num_threads = 0;
+#endif
+      for (int i = 0; i < num_threads; ++i) {
+        threads_.push_back(std::make_unique<Thread>("Worker Pool " + std::to_string(i)));
+        threads_.back()->setThreadTask([this] { workerLoop(); });
+        threads_.back()->start();
+      }
+    }
+
+    ~WorkerPool() {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+      }
+      work_condition_.notify_all();
+      for (auto& thread : threads_)
+        thread->stop();
+    }
+
+    int numThreads() const { return threads_.size(); }
+
+    void parallelFor(int num_tasks, const std::function<void(int)>& task) {
+      if (threads_.empty() || num_tasks <= 1) {
+        for (int i = 0; i < num_tasks; ++i)
+          task(i);
+        return;
+      }
+
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_condition_.wait(lock, [this] { return active_workers_ == 0; });
+        task_ = &task;
+        num_tasks_ = num_tasks;
+        next_task_ = 0;
+        completed_tasks_ = 0;
+        generation_++;
+      }
+      work_condition_.notify_all();
+
+      runTasks();
+
+      std::unique_lock<std::mutex> lock(mutex_);
+      done_condition_.wait(lock, [this] { return completed_tasks_ == num_tasks_ && active_workers_ == 0; });
+      task_ = nullptr;
+    }
+
+  private:
+    void runTasks() {
+      while (true) {
+        int index = next_task_.fetch_add(1);
+        if (index >= num_tasks_)
+          return;
+
+        (*task_)(index);
+        if (completed_tasks_.fetch_add(1) + 1 == num_tasks_) {
+          std::lock_guard<std::mutex> lock(mutex_);
+          done_condition_.notify_all();
+        }
+      }
+    }
+
+    void workerLoop() {
+      int generation = 0;
+      while (true) {
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          work_condition_.wait(lock, [this, generation] { return stopping_ || generation_ != generation; });
+          if (stopping_)
+            return;
+
+          generation = generation_;
+          active_workers_++;
+        }
+
+        runTasks();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        active_workers_--;
+        done_condition_.notify_all();
+      }
+    }
+
+    std::vector<std::unique_ptr<Thread>> threads_;
+    std::mutex mutex_;
+    std::condition_variable work_condition_;
+    std::condition_variable done_condition_;
+    const std::function<void(int)>* task_ = nullptr;
+    std::atomic<int> num_tasks_ = 0;
+    std::atomic<int> next_task_ = 0;
+    std::atomic<int> completed_tasks_ = 0;
+    int active_workers_ = 0;
+    int generation_ = 0;
+    bool stopping_ = false;
+  };
+
+  enum class TaskPriority {
+    Interactive,
+    Background,
+  };
+
+  class ThreadPool;
+
+  // Result of a task submitted to a ThreadPool. Continuations run once the result is ready,
+  // either on the pool or on the main thread.
+  template<typename T>
+  class TaskFuture {
+  public:
+    using Value = std::conditional_t<std::is_void_v<T>, bool, T>;
+
+    struct State {
+      void set(Value result) {
+        std::vector<std::function<void()>> continuations;
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          value = std::move(result);
+          continuations.swap(this->continuations);
+        }
+        condition.notify_all();
+        for (auto& continuation : continuations)
+          continuation();
+      }
+
+      void onReady(std::function<void()> continuation) {
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (!value.has_value()) {
+            continuations.push_back(std::move(continuation));
+            return;
+          }
+        }
+        continuation();
+      }
+
+      std::mutex mutex;
+      std::condition_variable condition;
+      std::optional<Value> value;
+      std::vector<std::function<void()>> continuations;
+    };
+
+    TaskFuture() = default;
+    TaskFuture(std::shared_ptr<State> state, ThreadPool* pool) :
+        state_(std::move(state)), pool_(pool) { }
+
+    bool valid() const { return state_ != nullptr; }
+
+    bool ready() const {
+      std::lock_guard<std::mutex> lock(state_->mutex);
+      return state_->value.has_value();
+    }
+
+    void wait() const {
+      std::unique_lock<std::mutex> lock(state_->mutex);
+      state_->condition.wait(lock, [this] { return state_->value.has_value(); });
+    }
+
+    bool waitFor(int ms_timeout) const {
+      std::unique_lock<std::mutex> lock(state_->mutex);
+      return state_->condition.wait_for(lock, std::chrono::milliseconds(ms_timeout),
+                                        [this] { return state_->value.has_value(); });
+    }
+
+    // Blocks until the task finishes. Calling this from a pool task can stall the pool.
+    decltype(auto) get() const {
+      wait();
+      if constexpr (!std::is_void_v<T>)
+        return static_cast<const T&>(*state_->value);
+    }
+
+    // function takes the result, or nothing for void tasks.
+    template<typename F>
+    auto then(F&& function, TaskPriority priority = TaskPriority::Background);
+    template<typename F>
+    auto thenOnMainThread(F&& function);
+
+  private:
+    template<typename F>
+    static decltype(auto) invokeWithResult(F& function, State& state) {
+      if constexpr (std::is_void_v<T>)
+        return function();
+      else
+        return function(static_cast<const T&>(*state.value));
+    }
+
+    template<typename F>
+    auto continueWith(F&& function, std::function<void(InplaceTask)> schedule);
+
+    std::shared_ptr<State> state_;
+    ThreadPool* pool_ = nullptr;
   };
-}
\ No newline at end of file
+
+  // Work stealing pool. Tasks posted from a worker go to the back of that worker's own queue
+  // and it runs them newest first, while idle workers steal the oldest work from the others.
+  // Tasks posted from other threads go to a shared queue. Interactive tasks always run before
+  // background ones.
+  class ThreadPool {
+  public:
+    using Dispatcher = std::function<void(std::function<void()> task)>;
+
+    // Shared by everything that runs work off the main thread.
+    static ThreadPool& shared() {
+      static ThreadPool pool(
+          std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1));
+      return pool;
+    }
+
+    // The event loop installs this so continuations can resume on the main thread. Without one,
+    // main thread continuations run where the task finished.
+    static void setMainThreadDispatcher(Dispatcher dispatcher) {
+      std::lock_guard<std::mutex> lock(dispatcher_mutex_);
+      main_thread_dispatcher_ = std::move(dispatcher);
+    }
+
+    static void runOnMainThread(std::function<void()> task) {
+      Dispatcher dispatcher;
+      {
+        std::lock_guard<std::mutex> lock(dispatcher_mutex_);
+        dispatcher = main_thread_dispatcher_;
+      }
+      if (dispatcher)
+        dispatcher(std::move(task));
+      else
+        task();
+    }
+
+    explicit ThreadPool(int num_threads) {
+#if VISAGE_EMSCRIPTEN && !defined(__EMSCRIPTEN_PTHREADS__)
+      num_threads = 0;
+#endif
+      queues_.resize(std::max(0, num_threads));
+      for (auto& queue : queues_)
+        queue = std::make_unique<WorkQueue>();
+      for (int i = 0; i < num_threads; ++i) {
+        threads_.push_back(std::make_unique<Thread>("Thread Pool " + std::to_string(i)));
+        threads_.back()->setThreadTask([this, i] { workerLoop(i); });
+        threads_.back()->start();
+      }
+    }
+
+    ~ThreadPool() {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+      }
+      work_condition_.notify_all();
+      for (auto& thread : threads_)
+        thread->stop();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int numThreads() const { return threads_.size(); }
+
+    // Runs the task on the calling thread when the pool has no threads.
+    void post(InplaceTask task, TaskPriority priority = TaskPriority::Interactive) {
+      if (threads_.empty()) {
+        task();
+        return;
+      }
+
+      int index = static_cast<int>(priority);
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        num_queued_++;
+        num_outstanding_++;
+        if (current_pool_ == this) {
+          WorkQueue& queue = *queues_[current_worker_];
+          std::lock_guard<std::mutex> queue_lock(queue.mutex);
+          queue.tasks[index].push_back(std::move(task));
+        }
+        else
+          shared_tasks_[index].push_back(std::move(task));
+      }
+      work_condition_.notify_one();
+    }
+
+    template<typename F>
+    auto submit(F&& function, TaskPriority priority = TaskPriority::Interactive) {
+      using Result = std::invoke_result_t<std::decay_t<F>&>;
+      auto state = std::make_shared<typename TaskFuture<Result>::State>();
+      post(
+          [state, function = std::forward<F>(function)]() mutable {
+            if constexpr (std::is_void_v<Result>) {
+              function();
+              state->set(true);
+            }
+            else
+              state->set(function());
+          },
+          priority);
+      return TaskFuture<Result>(state, this);
+    }
+
+    // Blocks until every posted task, including ones they post, has finished.
+    void waitForIdle() {
+      std::unique_lock<std::mutex> lock(mutex_);
+      idle_condition_.wait(lock, [this] { return num_outstanding_ == 0; });
+    }
+
+  private:
+    static constexpr int kNumPriorities = 2;
+
+    struct WorkQueue {
+      std::mutex mutex;
+      std::deque<InplaceTask> tasks[kNumPriorities];
+    };
+
+    bool popTask(int worker, InplaceTask& task) {
+      for (int priority = 0; priority < kNumPriorities; ++priority) {
+        {
+          WorkQueue& own = *queues_[worker];
+          std::lock_guard<std::mutex> lock(own.mutex);
+          if (!own.tasks[priority].empty()) {
+            task = std::move(own.tasks[priority].back());
+            own.tasks[priority].pop_back();
+            return true;
+          }
+        }
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          if (!shared_tasks_[priority].empty()) {
+            task = std::move(shared_tasks_[priority].front());
+            shared_tasks_[priority].pop_front();
+            return true;
+          }
+        }
+        int num_queues = queues_.size();
+        for (int i = 1; i < num_queues; ++i) {
+          WorkQueue& victim = *queues_[(worker + i) % num_queues];
+          std::lock_guard<std::mutex> lock(victim.mutex);
+          if (!victim.tasks[priority].empty()) {
+            task = std::move(victim.tasks[priority].front());
+            victim.tasks[priority].pop_front();
+            return true;
+          }
+        }
+      }
+      return false;
+    }
+
+    void workerLoop(int worker) {
+      current_pool_ = this;
+      current_worker_ = worker;
+      while (true) {
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          work_condition_.wait(lock, [this] { return stopping_ || num_queued_ > 0; });
+          if (stopping_)
+            break;
+          num_queued_--;
+        }
+
+        // Tasks are queued before they're counted, so a worker that claimed one always finds
+        // one, though maybe not the one that was counted.
+        InplaceTask task;
+        bool found = popTask(worker, task);
+        VISAGE_ASSERT(found);
+        if (found)
+          task();
+        task.reset();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--num_outstanding_ == 0)
+          idle_condition_.notify_all();
+      }
+      current_pool_ = nullptr;
+    }
+
+    static inline thread_local ThreadPool* current_pool_ = nullptr;
+    static inline thread_local int current_worker_ = 0;
+    static inline std::mutex dispatcher_mutex_;
+    static inline Dispatcher main_thread_dispatcher_;
+
+    std::vector<std::unique_ptr<Thread>> threads_;
+    std::vector<std::unique_ptr<WorkQueue>> queues_;
+    std::deque<InplaceTask> shared_tasks_[kNumPriorities];
+    std::mutex mutex_;
+    std::condition_variable work_condition_;
+    std::condition_variable idle_condition_;
+    int num_queued_ = 0;
+    int num_outstanding_ = 0;
+    bool stopping_ = false;
+  };
+
+  template<typename T>
+  template<typename F>
+  auto TaskFuture<T>::continueWith(F&& function, std::function<void(InplaceTask)> schedule) {
+    using Result = decltype(invokeWithResult(function, *state_));
+    auto next = std::make_shared<typename TaskFuture<Result>::State>();
+    auto state = state_;
+    state_->onReady([state, next, schedule = std::move(schedule),
+                     function = std::forward<F>(function)]() mutable {
+      schedule([state, next, function = std::move(function)]() mutable {
+        if constexpr (std::is_void_v<Result>) {
+          invokeWithResult(function, *state);
+          next->set(true);
+        }
+        else
+          next->set(invokeWithResult(function, *state));
+      });
+    });
+    return TaskFuture<Result>(next, pool_);
+  }
+
+  template<typename T>
+  template<typename F>
+  auto TaskFuture<T>::then(F&& function, TaskPriority priority) {
+    ThreadPool* pool = pool_;
+    return continueWith(std::forward<F>(function), [pool, priority](InplaceTask task) {
+      pool->post(std::move(task), priority);
+    });
+  }
+
+  template<typename T>
+  template<typename F>
+  auto TaskFuture<T>::thenOnMainThread(F&& function) {
+    return continueWith(std::forward<F>(function), [](InplaceTask task) {
+      auto shared_task = std::make_shared<InplaceTask>(std::move(task));
+      ThreadPool::runOnMainThread([shared_task] { (*shared_task)(); });
+    });
+  }
+}
@@ -21,6 +21,9 @@
 
 #include "time_utils.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace visage::time {
   std::string formatTime(const Time& time, const char* format_string) {
     static constexpr int kMaxLength = 100;
@@ -40,3 +43,65 @@ namespace visage::time {
     return buffer;
   }
 }
+
+namespace visage {
+  void FramePacer::setInterval(long long microseconds) {
+    interval_ = std::max(kMinIntervalUs, microseconds);
+    next_deadline_ = 0;
+  }
+
+  void FramePacer::setRefreshRate(double refresh_rate) {
+    if (refresh_rate > 0.0)
+      setInterval(std::llround(1000000.0 / refresh_rate));
+  }
+
+  long long FramePacer::nextDeadline(long long now) {
+    if (next_deadline_ == 0) {
+      next_deadline_ = now + interval_;
+      return next_deadline_;
+    }
+
+    next_deadline_ += interval_;
+    if (next_deadline_ <= now)
+      next_deadline_ += ((now - next_deadline_) / interval_ + 1) * interval_;
+    return next_deadline_;
+  }
+
+  void FramePacer::tick(long long now) {
+    long long last_tick = last_tick_;
+    last_tick_ = now;
+    if (last_tick == 0)
+      return;
+
+    long long elapsed = now - last_tick;
+    if (elapsed > 2 * interval_)
+      return;
+
+    deviations_[sample_index_] = std::abs(elapsed - interval_);
+    sample_index_ = (sample_index_ + 1) % kJitterWindow;
+    num_samples_ = std::min(num_samples_ + 1, kJitterWindow);
+  }
+
+  void FramePacer::clearStats() {
+    last_tick_ = 0;
+    num_samples_ = 0;
+    sample_index_ = 0;
+  }
+
+  double FramePacer::averageJitter() const {
+    if (num_samples_ == 0)
+      return 0.0;
+
+    long long total = 0;
+    for (int i = 0; i < num_samples_; ++i)
+      total += deviations_[i];
+    return total / static_cast<double>(num_samples_);
+  }
+
+  long long FramePacer::maxJitter() const {
+    long long result = 0;
+    for (int i = 0; i < num_samples_; ++i)
+      result = std::max(result, deviations_[i]);
+    return result;
+  }
+}
@@ -27,15 +27,16 @@
 namespace visage::time {
   typedef std::chrono::time_point<std::chrono::system_clock> Time;
 
-  inline long long milliseconds() {
-    auto now = std::chrono::system_clock::now().time_since_epoch();
-    return std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+  // Monotonic time from an unspecified start, for timers, frame pacing and animation. It never
+  // jumps with wall clock changes. Use now() for wall clock time.
+  inline long long nanoseconds() {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
   }
 
-  inline long long microseconds() {
-    auto now = std::chrono::system_clock::now().time_since_epoch();
-    return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
-  }
+  inline long long microseconds() { return nanoseconds() / 1000; }
+
+  inline long long milliseconds() { return nanoseconds() / 1000000; }
 
   inline int seconds() {
     auto now = std::chrono::system_clock::now().time_since_epoch();
@@ -48,3 +49,38 @@ namespace visage::time {
 
   std::string formatTime(const Time& time, const char* format_string);
 }
+
+namespace visage {
+  // Paces repeating ticks against absolute deadlines so sleep overshoot doesn't accumulate into
+  // drift, and measures how far the ticks that actually ran deviate from the ideal interval.
+  class FramePacer {
+  public:
+    static constexpr long long kDefaultIntervalUs = 16667;
+    static constexpr long long kMinIntervalUs = 1000;
+    static constexpr int kJitterWindow = 120;
+
+    void setInterval(long long microseconds);
+    void setRefreshRate(double refresh_rate);
+    long long interval() const { return interval_; }
+
+    // Deadline for the tick after now. Late ticks skip the intervals they missed instead of
+    // firing a burst to catch up, and the deadlines stay on the original phase.
+    long long nextDeadline(long long now);
+    void reset() { next_deadline_ = 0; }
+
+    void tick(long long now);
+    void clearStats();
+    int numSamples() const { return num_samples_; }
+    // Mean and worst absolute deviation of tick-to-tick time from the interval, in microseconds.
+    double averageJitter() const;
+    long long maxJitter() const;
+
+  private:
+    long long interval_ = kDefaultIntervalUs;
+    long long next_deadline_ = 0;
+    long long last_tick_ = 0;
+    long long deviations_[kJitterWindow] {};
+    int num_samples_ = 0;
+    int sample_index_ = 0;
+  };
+}
@@ -0,0 +1,164 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "trace.h"
+
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace visage {
+  struct TraceBuffer {
+    explicit TraceBuffer(int thread_index) :
+        thread_index(thread_index),
+        events(std::make_unique<TraceEvent[]>(Tracer::kEventsPerThread)) { }
+
+    int thread_index = 0;
+    std::unique_ptr<TraceEvent[]> events;
+    std::atomic<int> size { 0 };
+    std::atomic<int> dropped { 0 };
+  };
+
+  struct TraceBuffers {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<TraceBuffer>> buffers;
+  };
+
+  static TraceBuffers& traceBuffers() {
+    static TraceBuffers buffers;
+    return buffers;
+  }
+
+  // Registering takes the lock once per thread. Buffers outlive their threads so their events can
+  // still be exported.
+  static TraceBuffer* threadBuffer() {
+    thread_local TraceBuffer* buffer = nullptr;
+    if (buffer == nullptr) {
+      TraceBuffers& buffers = traceBuffers();
+      std::lock_guard<std::mutex> lock(buffers.mutex);
+      buffers.buffers.push_back(std::make_unique<TraceBuffer>(buffers.buffers.size() + 1));
+      buffer = buffers.buffers.back().get();
+    }
+    return buffer;
+  }
+
+  void Tracer::addEvent(const char* name, const char* detail, long long start, long long duration) {
+    TraceBuffer* buffer = threadBuffer();
+    int index = buffer->size.load(std::memory_order_relaxed);
+    if (index >= kEventsPerThread) {
+      buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    TraceEvent& event = buffer->events[index];
+    event.name = name;
+    event.detail[0] = '\0';
+    if (detail)
+      std::strncpy(event.detail, detail, TraceEvent::kMaxDetailLength);
+    event.start = start;
+    event.duration = duration;
+    buffer->size.store(index + 1, std::memory_order_release);
+  }
+
+  int Tracer::numEvents() {
+    TraceBuffers& buffers = traceBuffers();
+    std::lock_guard<std::mutex> lock(buffers.mutex);
+    int total = 0;
+    for (const auto& buffer : buffers.buffers)
+      total += buffer->size.load(std::memory_order_acquire);
+    return total;
+  }
+
+  int Tracer::numDroppedEvents() {
+    TraceBuffers& buffers = traceBuffers();
+    std::lock_guard<std::mutex> lock(buffers.mutex);
+    int total = 0;
+    for (const auto& buffer : buffers.buffers)
+      total += buffer->dropped.load(std::memory_order_relaxed);
+    return total;
+  }
+
+  static void appendJsonString(std::string& json, const char* text) {
+    json += '"';
+    for (const char* c = text; *c; ++c) {
+      if (*c == '"' || *c == '\\') {
+        json += '\\';
+        json += *c;
+      }
+      else if (static_cast<unsigned char>(*c) < 0x20) {
+        char escaped[8];
+        std::snprintf(escaped, sizeof(escaped), "\\u%04x", *c);
+        json += escaped;
+      }
+      else
+        json += *c;
+    }
+    json += '"';
+  }
+
+  std::string Tracer::chromeTraceJson() {
+    TraceBuffers& buffers = traceBuffers();
+    std::lock_guard<std::mutex> lock(buffers.mutex);
+
+    std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (const auto& buffer : buffers.buffers) {
+      std::string tid = std::to_string(buffer->thread_index);
+      int size = buffer->size.load(std::memory_order_acquire);
+      for (int i = 0; i < size; ++i) {
+        const TraceEvent& event = buffer->events[i];
+        json += first ? "\n" : ",\n";
+        first = false;
+
+        json += "{\"name\":";
+        appendJsonString(json, event.name);
+        json += ",\"cat\":\"visage\",\"pid\":1,\"tid\":" + tid;
+        json += ",\"ts\":" + std::to_string(event.start);
+        if (event.isInstant())
+          json += ",\"ph\":\"i\",\"s\":\"t\"";
+        else
+          json += ",\"ph\":\"X\",\"dur\":" + std::to_string(event.duration);
+        if (event.detail[0]) {
+          json += ",\"args\":{\"detail\":";
+          appendJsonString(json, event.detail);
+          json += "}";
+        }
+        json += "}";
+      }
+    }
+    json += "\n]}\n";
+    return json;
+  }
+
+  bool Tracer::saveChromeTrace(const File& file) {
+    return replaceFileWithText(file, chromeTraceJson());
+  }
+
+  void Tracer::clear() {
+    TraceBuffers& buffers = traceBuffers();
+    std::lock_guard<std::mutex> lock(buffers.mutex);
+    for (const auto& buffer : buffers.buffers) {
+      buffer->size.store(0, std::memory_order_release);
+      buffer->dropped.store(0, std::memory_order_relaxed);
+    }
+  }
+}
@@ -0,0 +1,116 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "file_system.h"
+#include "time_utils.h"
+
+#include <atomic>
+#include <cstring>
+#include <string>
+
+namespace visage {
+  struct TraceEvent {
+    static constexpr int kMaxDetailLength = 47;
+
+    const char* name = nullptr;
+    char detail[kMaxDetailLength + 1] {};
+    long long start = 0;
+    long long duration = -1;
+
+    bool isInstant() const { return duration < 0; }
+  };
+
+  // Collects timed scopes into one buffer per thread that only that thread writes, so markers
+  // never lock. Event names must be string literals. Export with chromeTraceJson() and open the
+  // result in chrome://tracing or ui.perfetto.dev. Markers are compiled in by VISAGE_TRACE_SCOPE
+  // only when the VISAGE_ENABLE_TRACING CMake option is on, and record nothing until enabled.
+  class Tracer {
+  public:
+    static constexpr int kEventsPerThread = 1 << 16;
+
+    class Scope {
+    public:
+      explicit Scope(const char* name, const char* detail = nullptr) {
+        if (!Tracer::enabled())
+          return;
+
+        name_ = name;
+        if (detail)
+          std::strncpy(detail_, detail, TraceEvent::kMaxDetailLength);
+        start_ = time::microseconds();
+      }
+
+      Scope(const char* name, const std::string& detail) : Scope(name, detail.c_str()) { }
+
+      ~Scope() {
+        if (name_)
+          Tracer::addEvent(name_, detail_, start_, time::microseconds() - start_);
+      }
+
+      Scope(const Scope&) = delete;
+      Scope& operator=(const Scope&) = delete;
+
+    private:
+      const char* name_ = nullptr;
+      char detail_[TraceEvent::kMaxDetailLength + 1] {};
+      long long start_ = 0;
+    };
+
+    static void setEnabled(bool enabled) {
+      enabledFlag().store(enabled, std::memory_order_relaxed);
+    }
+    static bool enabled() { return enabledFlag().load(std::memory_order_relaxed); }
+
+    static void addEvent(const char* name, const char* detail, long long start, long long duration);
+    static void addInstant(const char* name, const char* detail = nullptr) {
+      if (enabled())
+        addEvent(name, detail, time::microseconds(), -1);
+    }
+
+    // Events recorded so far and those dropped because a thread's buffer was full.
+    static int numEvents();
+    static int numDroppedEvents();
+
+    // Only call these while no thread is inside a trace scope.
+    static std::string chromeTraceJson();
+    static bool saveChromeTrace(const File& file);
+    static void clear();
+
+  private:
+    static std::atomic<bool>& enabledFlag() {
+      static std::atomic<bool> enabled { false };
+      return enabled;
+    }
+  };
+}
+
+#if VISAGE_TRACING
+#define VISAGE_TRACE_CONCAT_INNER(a, b) a##b
+#define VISAGE_TRACE_CONCAT(a, b) VISAGE_TRACE_CONCAT_INNER(a, b)
+#define VISAGE_TRACE_SCOPE(...) \
+  visage::Tracer::Scope VISAGE_TRACE_CONCAT(visage_trace_scope_, __LINE__)(__VA_ARGS__)
+#define VISAGE_TRACE_INSTANT(...) visage::Tracer::addInstant(__VA_ARGS__)
+#else
+#define VISAGE_TRACE_SCOPE(...)
+#define VISAGE_TRACE_INSTANT(...)
+#endif
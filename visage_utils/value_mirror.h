@@ -0,0 +1,145 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+namespace visage {
+  // Wait-free single producer, single consumer handoff of the latest value. The producer fills
+  // writeBuffer() and publishes it, the consumer pulls and reads the newest published buffer.
+  template<typename T>
+  class TripleBuffer {
+  public:
+    TripleBuffer() = default;
+    explicit TripleBuffer(const T& initial) : buffers_ { initial, initial, initial } { }
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    T& writeBuffer() { return buffers_[write_index_]; }
+
+    void publish() {
+      int previous = shared_.exchange(write_index_ | kNewData, std::memory_order_acq_rel);
+      write_index_ = previous & kIndexMask;
+    }
+
+    bool pull() {
+      if ((shared_.load(std::memory_order_relaxed) & kNewData) == 0)
+        return false;
+
+      int previous = shared_.exchange(read_index_, std::memory_order_acq_rel);
+      read_index_ = previous & kIndexMask;
+      return true;
+    }
+
+    const T& readBuffer() const { return buffers_[read_index_]; }
+
+  private:
+    static constexpr int kIndexMask = 3;
+    static constexpr int kNewData = 4;
+
+    T buffers_[3] {};
+    int write_index_ = 0;
+    int read_index_ = 1;
+    std::atomic<int> shared_ = 2;
+  };
+
+  // Mirrors a value set on the audio thread to the UI thread without locks or allocation.
+  // Setting the same value again isn't republished, so pull() only reports real changes.
+  template<typename T>
+  class ValueMirror {
+  public:
+    ValueMirror() = default;
+    explicit ValueMirror(const T& initial) : buffer_(initial), last_set_(initial) { }
+
+    void set(const T& value) {
+      if (value == last_set_)
+        return;
+
+      last_set_ = value;
+      buffer_.writeBuffer() = value;
+      buffer_.publish();
+    }
+
+    bool pull() { return buffer_.pull(); }
+    const T& value() const { return buffer_.readBuffer(); }
+
+  private:
+    TripleBuffer<T> buffer_;
+    T last_set_ {};
+  };
+
+  // Bulk peak meters. The audio thread accumulates absolute peaks and publishes once per block,
+  // folding them into one shared peak per meter. The UI thread's pull takes and resets those, so
+  // it gets the loudest peak of every block published since its last pull.
+  class MeterChannel {
+  public:
+    explicit MeterChannel(int num_meters) :
+        shared_(num_meters), peaks_(num_meters, 0.0f), values_(num_meters, 0.0f) {
+      for (auto& peak : shared_)
+        peak.store(0.0f, std::memory_order_relaxed);
+    }
+
+    int numMeters() const { return peaks_.size(); }
+
+    void accumulate(int index, float value) {
+      peaks_[index] = std::max(peaks_[index], std::abs(value));
+    }
+
+    void accumulate(int index, const float* samples, int num_samples) {
+      float peak = peaks_[index];
+      for (int i = 0; i < num_samples; ++i)
+        peak = std::max(peak, std::abs(samples[i]));
+      peaks_[index] = peak;
+    }
+
+    void publish() {
+      for (int i = 0; i < peaks_.size(); ++i) {
+        float current = shared_[i].load(std::memory_order_relaxed);
+        while (current < peaks_[i] &&
+               !shared_[i].compare_exchange_weak(current, peaks_[i], std::memory_order_relaxed)) { }
+        peaks_[i] = 0.0f;
+      }
+      new_data_.store(true, std::memory_order_release);
+    }
+
+    bool pull() {
+      if (!new_data_.exchange(false, std::memory_order_acquire))
+        return false;
+
+      for (int i = 0; i < values_.size(); ++i)
+        values_[i] = shared_[i].exchange(0.0f, std::memory_order_relaxed);
+      return true;
+    }
+
+    const std::vector<float>& value() const { return values_; }
+
+  private:
+    std::vector<std::atomic<float>> shared_;
+    std::atomic<bool> new_data_ = false;
+    std::vector<float> peaks_;
+    std::vector<float> values_;
+  };
+}
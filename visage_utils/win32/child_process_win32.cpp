@@ -25,11 +25,12 @@
 #define NOMINMAX 1
 #endif
 #include <sstream>
+#include <thread>
 #include <windows.h>
 
 namespace visage {
   bool spawnChildProcess(const std::string& command, const std::string& arguments,
-                         std::string& output, int timeout_ms) {
+                         std::string& output, int timeout_ms, const std::atomic<bool>* cancel) {
     STARTUPINFO si;
     PROCESS_INFORMATION pi;
 
@@ -109,7 +110,7 @@ namespace visage {
       if (read_available_output() && total_output_size >= kMaxOutputSize)
         break;
 
-      if (GetTickCount64() - start_time >= (DWORD)timeout_ms) {
+      if ((cancel && cancel->load()) || GetTickCount64() - start_time >= (DWORD)timeout_ms) {
         wait_result = WAIT_TIMEOUT;
         break;
       }
@@ -141,4 +142,155 @@ namespace visage {
 
     return success;
   }
+
+  struct ChildProcess::Handles {
+    HANDLE process = nullptr;
+    HANDLE out_read = nullptr;
+    HANDLE err_read = nullptr;
+    HANDLE kill_event = nullptr;
+  };
+
+  static void closeHandle(HANDLE& handle) {
+    if (handle)
+      CloseHandle(handle);
+    handle = nullptr;
+  }
+
+  static bool createOutputPipe(HANDLE& read, HANDLE& write) {
+    SECURITY_ATTRIBUTES sa;
+    ZeroMemory(&sa, sizeof(sa));
+    sa.nLength = sizeof(sa);
+    sa.bInheritHandle = TRUE;
+    sa.lpSecurityDescriptor = nullptr;
+
+    if (!CreatePipe(&read, &write, &sa, 0))
+      return false;
+    if (SetHandleInformation(read, HANDLE_FLAG_INHERIT, 0))
+      return true;
+
+    closeHandle(read);
+    closeHandle(write);
+    return false;
+  }
+
+  ChildProcess::ChildProcess() : handles_(std::make_unique<Handles>()) { }
+
+  ChildProcess::~ChildProcess() {
+    kill();
+    joinMonitor();
+  }
+
+  bool ChildProcess::start(const std::string& command, const std::string& arguments,
+                           Options options) {
+    if (running())
+      return false;
+
+    joinMonitor();
+    options_ = std::move(options);
+    kill_requested_ = false;
+
+    HANDLE out_write = nullptr;
+    HANDLE err_write = nullptr;
+    if (!createOutputPipe(handles_->out_read, out_write))
+      return false;
+    if (!createOutputPipe(handles_->err_read, err_write)) {
+      closeHandle(handles_->out_read);
+      closeHandle(out_write);
+      return false;
+    }
+
+    STARTUPINFO si;
+    ZeroMemory(&si, sizeof(si));
+    si.cb = sizeof(si);
+    si.hStdOutput = out_write;
+    si.hStdError = err_write;
+    si.dwFlags |= STARTF_USESTDHANDLES;
+    PROCESS_INFORMATION pi;
+    ZeroMemory(&pi, sizeof(pi));
+
+    std::string full_command = command + " " + arguments;
+    std::vector<char> command_buffer(full_command.begin(), full_command.end());
+    command_buffer.push_back('\0');
+    bool created = CreateProcess(nullptr, command_buffer.data(), nullptr, nullptr, TRUE,
+                                 CREATE_NO_WINDOW, nullptr, nullptr, &si, &pi);
+    closeHandle(out_write);
+    closeHandle(err_write);
+    handles_->kill_event = created ? CreateEvent(nullptr, TRUE, FALSE, nullptr) : nullptr;
+
+    if (!created || handles_->kill_event == nullptr) {
+      if (created) {
+        TerminateProcess(pi.hProcess, 1);
+        CloseHandle(pi.hProcess);
+        CloseHandle(pi.hThread);
+      }
+      closeHandle(handles_->out_read);
+      closeHandle(handles_->err_read);
+      return false;
+    }
+
+    CloseHandle(pi.hThread);
+    handles_->process = pi.hProcess;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      result_ = Result::Running;
+      exit_code_ = -1;
+      exit_reported_ = false;
+      run_++;
+    }
+
+    monitor_thread_ = std::make_unique<Thread>("Child Process " + command);
+    monitor_thread_->setThreadTask([this] { monitor(); });
+    monitor_thread_->start();
+    return true;
+  }
+
+  void ChildProcess::kill() {
+    kill_requested_ = true;
+    if (handles_->kill_event)
+      SetEvent(handles_->kill_event);
+  }
+
+  void ChildProcess::joinMonitor() {
+    stopMonitorThread();
+    closeHandle(handles_->kill_event);
+  }
+
+  void ChildProcess::monitor() {
+    Handles& handles = *handles_;
+
+    // Anonymous pipes can't be waited on, so each pipe gets a thread blocked in ReadFile.
+    auto read_pipe = [this](HANDLE pipe, const OutputCallback& callback) {
+      char buffer[4096];
+      DWORD bytes_read = 0;
+      while (ReadFile(pipe, buffer, sizeof(buffer), &bytes_read, nullptr) && bytes_read > 0)
+        deliverOutput(callback, buffer, bytes_read);
+    };
+    std::thread out_reader(read_pipe, handles.out_read, std::cref(options_.on_output));
+    std::thread err_reader(read_pipe, handles.err_read, std::cref(options_.on_error));
+
+    HANDLE wait_handles[] = { handles.process, handles.kill_event };
+    DWORD timeout = options_.timeout_ms >= 0 ? options_.timeout_ms : INFINITE;
+    DWORD wait_result = WaitForMultipleObjects(2, wait_handles, FALSE, timeout);
+
+    Result result = Result::Exited;
+    if (wait_result != WAIT_OBJECT_0) {
+      result = wait_result == WAIT_TIMEOUT ? Result::TimedOut : Result::Killed;
+      TerminateProcess(handles.process, 1);
+      WaitForSingleObject(handles.process, INFINITE);
+      CancelSynchronousIo(out_reader.native_handle());
+      CancelSynchronousIo(err_reader.native_handle());
+    }
+
+    out_reader.join();
+    err_reader.join();
+
+    DWORD exit_code = 0;
+    bool has_exit_code = result == Result::Exited &&
+                         GetExitCodeProcess(handles.process, &exit_code);
+    closeHandle(handles.process);
+    closeHandle(handles.out_read);
+    closeHandle(handles.err_read);
+    finish(result, has_exit_code ? static_cast<int>(exit_code) : -1);
+  }
 }
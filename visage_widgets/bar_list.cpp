@@ -30,10 +30,7 @@ namespace visage {
 
   void BarList::draw(Canvas& canvas) {
     canvas.setColor(BarColor);
-
-    for (int i = 0; i < num_bars_; ++i) {
-      const Bar& bar = bars_[i];
-      canvas.rectangle(bar.left, bar.top, bar.right - bar.left, bar.bottom - bar.top);
-    }
+    static_assert(sizeof(Bar) == 4 * sizeof(float), "Bars are passed as packed extents");
+    canvas.bars(reinterpret_cast<const float*>(bars_.get()), num_bars_);
   }
 }
\ No newline at end of file
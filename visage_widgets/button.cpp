@@ -58,10 +58,7 @@ namespace visage {
   VISAGE_THEME_VALUE(UiButtonHoverRoundingMult, 0.7f);
 
   void Button::draw(Canvas& canvas) {
-    draw(canvas, active_ ? hover_amount_.update() : 0.0f);
-
-    if (hover_amount_.isAnimating())
-      redraw();
+    draw(canvas, active_ ? hover_amount_.value() : 0.0f);
   }
 
   void Button::mouseEnter(const MouseEvent& e) {
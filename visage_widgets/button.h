@@ -27,6 +27,7 @@
 #include "visage_graphics/text.h"
 #include "visage_graphics/theme.h"
 #include "visage_ui/frame.h"
+#include "visage_ui/animation_scheduler.h"
 #include "visage_ui/svg_frame.h"
 
 #include <functional>
@@ -68,7 +69,7 @@ namespace visage {
 
   private:
     CallbackList<void(Button*, bool)> on_toggle_;
-    Animation<float> hover_amount_;
+    FrameAnimation<float> hover_amount_ { this };
     std::function<void()> undo_setup_function_ = nullptr;
 
     bool active_ = true;
@@ -29,29 +29,8 @@ namespace visage {
     int w = width();
     int h = height();
 
-    int yg_y = h / 6;
-    int gc_y = h / 3;
-    int cb_y = h / 2;
-    int bp_y = 2 * h / 3;
-    int pr_y = 5 * h / 6;
-
-    canvas.setColor(Brush::vertical(0xffff0000, 0xffffff00));
-    canvas.rectangle(0, 0, w, yg_y);
-
-    canvas.setColor(Brush::vertical(0xffffff00, 0xff00ff00));
-    canvas.rectangle(0, yg_y, w, gc_y - yg_y);
-
-    canvas.setColor(Brush::vertical(0xff00ff00, 0xff00ffff));
-    canvas.rectangle(0, gc_y, w, cb_y - gc_y);
-
-    canvas.setColor(Brush::vertical(0xff00ffff, 0xff0000ff));
-    canvas.rectangle(0, cb_y, w, bp_y - cb_y);
-
-    canvas.setColor(Brush::vertical(0xff0000ff, 0xffff00ff));
-    canvas.rectangle(0, bp_y, w, pr_y - bp_y);
-
-    canvas.setColor(Brush::vertical(0xffff00ff, 0xffff0000));
-    canvas.rectangle(0, pr_y, w, h - pr_y);
+    canvas.setColor(0xffffffff);
+    canvas.hueRectangle(0, 0, w, h);
 
     float y = h * hue_ / Color::kHueRange;
     canvas.setColor(0xff000000);
@@ -59,11 +38,8 @@ namespace visage {
   }
 
   void ValueSaturationEditor::draw(Canvas& canvas) {
-    canvas.setColor(Brush::horizontal(0xffffffff, hue_color_));
-    canvas.rectangle(0, 0, width(), height());
-
-    canvas.setColor(Brush::vertical(0x00000000, 0xff000000));
-    canvas.rectangle(0, 0, width(), height());
+    canvas.setColor(0xffffffff);
+    canvas.saturationValueRectangle(0, 0, width(), height(), hue_);
 
     float x = width() * saturation_;
     float y = height() * (1.0f - value_);
@@ -78,7 +54,7 @@ namespace visage {
     hue_.onEdit() = [this](float hue) {
       updateColor();
       notifyNewColor();
-      value_saturation_.setHueColor(Color::fromAHSV(1.0f, hue, 1.0f, 1.0f));
+      value_saturation_.setHue(hue);
       redraw();
     };
 
@@ -113,7 +89,7 @@ namespace visage {
       hue_.setHue(color_.hue());
       value_saturation_.setValue(color_.value());
       value_saturation_.setSaturation(color_.saturation());
-      value_saturation_.setHueColor(Color::fromAHSV(1.0f, hue_.hue(), 1.0f, 1.0f));
+      value_saturation_.setHue(hue_.hue());
       notifyNewColor();
       redraw();
     };
@@ -137,7 +113,7 @@ namespace visage {
     addChild(&hex_text_);
     addChild(&alpha_text_);
     addChild(&hdr_text_);
-    value_saturation_.setHueColor(Color::fromAHSV(1.0f, hue_.hue(), 1.0f, 1.0f));
+    value_saturation_.setHue(hue_.hue());
     updateColor();
   }
 
@@ -181,7 +157,7 @@ namespace visage {
 
   void ColorPicker::setColor(const Color& color) {
     hue_.setHue(color.hue());
-    value_saturation_.setHueColor(Color::fromAHSV(1.0f, hue_.hue(), 1.0f, 1.0f));
+    value_saturation_.setHue(hue_.hue());
     value_saturation_.setValue(color.value());
     value_saturation_.setSaturation(color.saturation());
     alpha_ = color.alpha();
@@ -88,17 +88,18 @@ namespace visage {
     }
     float saturation() const { return saturation_; }
 
-    void setHueColor(const Color& hue_color) {
-      hue_color_ = hue_color;
+    void setHue(float hue) {
+      hue_ = hue;
       redraw();
     }
+    float hue() const { return hue_; }
 
     auto& onEdit() { return on_edit_; }
 
   private:
     float value_ = 1.0f;
     float saturation_ = 1.0f;
-    Color hue_color_ = Color(0xffff00ff);
+    float hue_ = 300.0f;
     CallbackList<void(float, float)> on_edit_;
 
     VISAGE_LEAK_CHECKER(ValueSaturationEditor)
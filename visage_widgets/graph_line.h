@@ -54,7 +54,16 @@ namespace visage {
     float at(int index) const { return data_[index]; }
     void set(int index, float val) {
       VISAGE_ASSERT(index < data_.numPoints() && index >= 0);
-      data_[index] = val;
+      int version = data_.version();
+      data_.set(index, val);
+      if (data_.version() != version)
+        redraw();
+    }
+
+    void setStreaming(bool streaming) { data_.setStreaming(streaming); }
+    void setPrecision(DataPrecision precision) { data_.setPrecision(precision); }
+    void push(const float* values, int count) {
+      data_.push(values, count);
       redraw();
     }
 
@@ -50,7 +50,20 @@ namespace visage {
 
     float at(int x, int y) const { return data_.at(x, y); }
     void set(int x, int y, float val) {
+      int version = data_.version();
       data_.set(x, y, val);
+      if (data_.version() != version)
+        redraw();
+    }
+
+    void setStreaming(bool streaming) { data_.setStreaming(streaming); }
+    void setPrecision(DataPrecision precision) { data_.setPrecision(precision); }
+    void setValueRange(float min, float max, bool decibels = false) {
+      data_.setValueRange(min, max, decibels);
+      redraw();
+    }
+    void pushColumn(const float* column) {
+      data_.pushColumn(column);
       redraw();
     }
 
@@ -147,13 +147,17 @@ namespace visage {
     int w = width();
     int h = height();
     color_picker_from_.onColorChange() = [this](const Color& color) {
-      if (editing_ >= 0)
+      if (editing_ >= 0) {
         palette_->setColorIndexFrom(editing_, color);
+        notifyColorEdited();
+      }
       redraw();
     };
     color_picker_to_.onColorChange() = [this](const Color& color) {
-      if (editing_ >= 0)
+      if (editing_ >= 0) {
         palette_->setColorIndexTo(editing_, color);
+        notifyColorEdited();
+      }
       redraw();
     };
     color_picker_to_.setVisible(editing_gradient_);
@@ -251,6 +255,7 @@ namespace visage {
     bool toggle = e.isMiddleButton() || e.isAltDown();
     if (toggle && mouse_down_index_ >= 0 && mouse_down_index_ < palette_->numColors()) {
       palette_->toggleColorIndexStyle(mouse_down_index_);
+      on_edit_.callback(false);
       setEditingGradient(palette_->colorIndex(mouse_down_index_).gradient().resolution() > 1);
       mouse_down_index_ = -1;
       return;
@@ -273,6 +278,11 @@ namespace visage {
     mouseDrag(e);
   }
 
+  void PaletteColorEditor::notifyColorEdited() {
+    const Brush& brush = palette_->colorIndex(editing_);
+    on_edit_.callback(PackedBrush::isSolid(brush.gradient(), brush.position()));
+  }
+
   void PaletteColorEditor::mouseDrag(const MouseEvent& e) {
     dragging_ = mouse_down_index_;
     mouse_drag_x_ = e.position.x;
@@ -291,14 +301,17 @@ namespace visage {
         previous_color_index_ = palette_->colorMap(current_override_id_, temporary_set_);
         palette_->setColorMap(current_override_id_, temporary_set_, dragging_);
       }
+      on_edit_.callback(false);
     }
 
     redraw();
   }
 
   void PaletteColorEditor::mouseUp(const MouseEvent& e) {
-    if (dragging_ < 0 && temporary_set_.isValid())
+    if (dragging_ < 0 && temporary_set_.isValid()) {
       palette_->setColorMap(current_override_id_, temporary_set_, previous_color_index_);
+      on_edit_.callback(false);
+    }
 
     mouse_down_index_ = -1;
     dragging_ = -1;
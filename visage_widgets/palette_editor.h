@@ -94,8 +94,13 @@ namespace visage {
     theme::OverrideId currentOverrideId() const { return current_override_id_; }
     float colorHeight();
 
+    auto& onEdit() { return on_edit_; }
+
   private:
     void setEditingGradient(bool gradient);
+    void notifyColorEdited();
+
+    CallbackList<void(bool colors_only)> on_edit_;
 
     Palette* palette_ = nullptr;
     ScrollableFrame color_list_;
@@ -0,0 +1,124 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "profiler_overlay.h"
+
+#include "embedded/fonts.h"
+#include "visage_graphics/canvas.h"
+#include "visage_graphics/resource_usage.h"
+#include "visage_graphics/theme.h"
+
+#include <cstdio>
+
+namespace visage {
+  VISAGE_THEME_COLOR(ProfilerOverlayBackground, 0xcc111316);
+  VISAGE_THEME_COLOR(ProfilerOverlayCpu, 0xffaa88ff);
+  VISAGE_THEME_COLOR(ProfilerOverlayGpu, 0xff55ccaa);
+  VISAGE_THEME_COLOR(ProfilerOverlayTarget, 0x66ffffff);
+  VISAGE_THEME_COLOR(ProfilerOverlayText, 0xffdddddd);
+
+  static std::string formatMilliseconds(double milliseconds) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.2f ms", milliseconds);
+    return buffer;
+  }
+
+  static std::string formatMegabytes(long long bytes) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.1f MB", bytes / (1024.0 * 1024.0));
+    return buffer;
+  }
+
+  ProfilerOverlay::ProfilerOverlay() : font_(font_size_, fonts::Lato_Regular_ttf) {
+    setIgnoresMouseEvents(true, false);
+    startTimer(kRefreshMs);
+  }
+
+  void ProfilerOverlay::setFontSize(float font_size) {
+    font_size_ = font_size;
+    font_ = Font(font_size_, fonts::Lato_Regular_ttf);
+    redraw();
+  }
+
+  void ProfilerOverlay::draw(Canvas& canvas) {
+    FrameProfiler& profiler = canvas.profiler();
+    profiler.setEnabled(true);
+
+    canvas.setColor(ProfilerOverlayBackground);
+    canvas.fill(0, 0, width(), height());
+
+    std::vector<FrameProfile> history = profiler.history();
+    float graph_height = height() * 0.5f;
+    float max_time = std::max(2.0f * kTargetFrameMicroseconds,
+                              static_cast<float>(profiler.maxCpuMicroseconds()));
+    float bar_width = width() / kGraphFrames;
+    int start = std::max(0, static_cast<int>(history.size()) - kGraphFrames);
+    for (int i = start; i < history.size(); ++i) {
+      float x = (i - start) * bar_width;
+      float cpu_height = graph_height * history[i].cpu_microseconds / max_time;
+      float gpu_height = graph_height * history[i].gpu_milliseconds * 1000.0f / max_time;
+      canvas.setColor(ProfilerOverlayCpu);
+      canvas.fill(x, graph_height - cpu_height, bar_width * 0.5f, cpu_height);
+      canvas.setColor(ProfilerOverlayGpu);
+      canvas.fill(x + bar_width * 0.5f, graph_height - gpu_height, bar_width * 0.5f, gpu_height);
+    }
+
+    canvas.setColor(ProfilerOverlayTarget);
+    canvas.fill(0, graph_height * (1.0f - kTargetFrameMicroseconds / max_time), width(), 1);
+
+    const FrameProfile& last = profiler.lastFrame();
+    std::vector<std::string> lines;
+    lines.push_back("CPU " + formatMilliseconds(last.cpu_microseconds / 1000.0) + "  GPU " +
+                    formatMilliseconds(last.gpu_milliseconds));
+    for (const ProfileSample& sample : last.samples) {
+      std::string name = sample.name;
+      if (sample.index >= 0)
+        name += " " + std::to_string(sample.index);
+      lines.push_back(name + "  " + formatMilliseconds(sample.microseconds / 1000.0));
+    }
+    for (const ViewProfile& view : last.views) {
+      lines.push_back("View " + std::to_string(view.view) + "  " +
+                      formatMilliseconds(view.gpu_milliseconds));
+    }
+
+    ResourceUsage total = ResourceTracker::total();
+    lines.push_back("GPU memory " + formatMegabytes(total.bytes) + "  peak " +
+                    formatMegabytes(total.peak_bytes));
+    for (int i = 0; i < ResourceTracker::kNumCategories; ++i) {
+      auto category = static_cast<ResourceCategory>(i);
+      ResourceUsage usage = ResourceTracker::usage(category);
+      if (usage.handles == 0)
+        continue;
+      lines.push_back(std::string(ResourceTracker::name(category)) + "  " +
+                      formatMegabytes(usage.bytes) + "  " + std::to_string(usage.handles));
+    }
+
+    float line_height = font_size_ * 1.4f;
+    float y = graph_height;
+    canvas.setColor(ProfilerOverlayText);
+    for (const std::string& line : lines) {
+      if (y + line_height > height())
+        break;
+      canvas.text(line, font_, Font::kLeft, 4, y, width() - 8, line_height);
+      y += line_height;
+    }
+  }
+}
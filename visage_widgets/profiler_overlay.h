@@ -0,0 +1,51 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "visage_graphics/font.h"
+#include "visage_ui/events.h"
+#include "visage_ui/frame.h"
+
+namespace visage {
+  // Draws the canvas's frame profiles and GPU memory use. It refreshes on a timer instead of
+  // redrawing from draw(), which would keep the editor drawing every frame just for the overlay.
+  class ProfilerOverlay : public Frame,
+                          public EventTimer {
+  public:
+    static constexpr int kGraphFrames = 120;
+    static constexpr float kTargetFrameMicroseconds = 16667.0f;
+    static constexpr int kRefreshMs = 100;
+
+    ProfilerOverlay();
+    ~ProfilerOverlay() override = default;
+
+    void draw(Canvas& canvas) override;
+    void timerCallback() override { redraw(); }
+    void setFontSize(float font_size);
+
+  private:
+    float font_size_ = 11.0f;
+    Font font_;
+
+    VISAGE_LEAK_CHECKER(ProfilerOverlay)
+  };
+}
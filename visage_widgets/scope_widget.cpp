@@ -0,0 +1,92 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "scope_widget.h"
+
+namespace visage {
+  VISAGE_THEME_IMPLEMENT_COLOR(ScopeWidget, ScopeLineColor, 0xffaa88ff);
+  VISAGE_THEME_IMPLEMENT_VALUE(ScopeWidget, ScopeLineWidth, 1.5f);
+
+  ScopeWidget::ScopeWidget(int num_points, int buffer_size) :
+      incoming_(buffer_size), scratch_(buffer_size), data_(num_points) {
+    for (int i = 0; i < num_points; ++i)
+      data_[i] = displayValue(0.0f);
+    data_.setStreaming(true);
+    sample_watcher_.schedule();
+  }
+
+  ScopeWidget::~ScopeWidget() = default;
+
+  void ScopeWidget::setTriggered(bool triggered) {
+    if (triggered_ == triggered)
+      return;
+
+    triggered_ = triggered;
+    history_.clear();
+    data_.setStreaming(!triggered);
+    redraw();
+  }
+
+  int ScopeWidget::findTrigger() const {
+    int num_points = data_.numPoints();
+    int last_start = static_cast<int>(history_.size()) - num_points;
+    for (int i = last_start; i > 0; --i) {
+      if (history_[i - 1] < trigger_level_ && history_[i] >= trigger_level_)
+        return i;
+    }
+    return last_start;
+  }
+
+  void ScopeWidget::update() {
+    int num_read = static_cast<int>(incoming_.read(scratch_.data(), scratch_.size()));
+    if (num_read == 0)
+      return;
+
+    if (!triggered_) {
+      int start = std::max(0, num_read - data_.numPoints());
+      for (int i = start; i < num_read; ++i)
+        scratch_[i] = displayValue(scratch_[i]);
+      data_.push(scratch_.data() + start, num_read - start);
+      return;
+    }
+
+    int num_points = data_.numPoints();
+    int max_history = 2 * num_points;
+    history_.insert(history_.end(), scratch_.begin(), scratch_.begin() + num_read);
+    int history_size = static_cast<int>(history_.size());
+    if (history_size > max_history)
+      history_.erase(history_.begin(), history_.begin() + (history_size - max_history));
+    if (static_cast<int>(history_.size()) < num_points)
+      return;
+
+    int start = findTrigger();
+    for (int i = 0; i < num_points; ++i)
+      data_.set(i, displayValue(history_[start + i]));
+  }
+
+  void ScopeWidget::draw(Canvas& canvas) {
+    update();
+
+    canvas.setColor(ScopeLineColor);
+    float line_width = canvas.dpiScale() * paletteValue(ScopeLineWidth);
+    canvas.graphLine(data_, 0.0f, 0.0f, width(), height(), Dimension::nativePixels(line_width));
+  }
+}
@@ -0,0 +1,96 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "visage_graphics/theme.h"
+#include "visage_ui/animation_scheduler.h"
+#include "visage_ui/frame.h"
+#include "visage_utils/lock_free_queue.h"
+
+namespace visage {
+  // Oscilloscope fed from a single producer thread, usually the audio thread. pushSamples() never
+  // blocks or allocates; samples are drained into the displayed points when drawing. A free
+  // running scope scrolls through a streaming GraphData so only new samples are uploaded. A
+  // triggered scope shows the newest window starting at a rising crossing of the trigger level.
+  // The scope checks for pushed samples once per draw callback and only redraws when there are
+  // some, so a silent producer doesn't keep it drawing.
+  class ScopeWidget : public Frame {
+  public:
+    VISAGE_THEME_DEFINE_COLOR(ScopeLineColor);
+    VISAGE_THEME_DEFINE_VALUE(ScopeLineWidth);
+
+    static constexpr int kDefaultBufferSize = 1 << 15;
+
+    explicit ScopeWidget(int num_points = 512, int buffer_size = kDefaultBufferSize);
+    ~ScopeWidget() override;
+
+    void draw(Canvas& canvas) override;
+
+    // Safe to call from the producer thread. Returns the number of samples that fit.
+    int pushSamples(const float* samples, int count) {
+      return static_cast<int>(incoming_.write(samples, count));
+    }
+
+    // Moves pushed samples into the displayed points, called on draw.
+    void update();
+
+    void setTriggered(bool triggered);
+    bool triggered() const { return triggered_; }
+    void setTriggerLevel(float level) { trigger_level_ = level; }
+    float triggerLevel() const { return trigger_level_; }
+    void setGain(float gain) { gain_ = gain; }
+    float gain() const { return gain_; }
+
+    int numPoints() const { return data_.numPoints(); }
+    const GraphData& data() const { return data_; }
+
+  private:
+    class SampleWatcher : public ScheduledAnimation {
+    public:
+      explicit SampleWatcher(ScopeWidget* scope) : ScheduledAnimation(nullptr), scope_(scope) { }
+
+      bool step(long long ms) override {
+        if (scope_->incoming_.available())
+          scope_->redraw();
+        return true;
+      }
+
+    private:
+      ScopeWidget* scope_ = nullptr;
+    };
+
+    int findTrigger() const;
+    float displayValue(float sample) const { return 0.5f + 0.5f * gain_ * sample; }
+
+    SpscRingBuffer<float> incoming_;
+    std::vector<float> scratch_;
+    std::vector<float> history_;
+    GraphData data_;
+    SampleWatcher sample_watcher_ { this };
+
+    bool triggered_ = false;
+    float trigger_level_ = 0.0f;
+    float gain_ = 1.0f;
+
+    VISAGE_LEAK_CHECKER(ScopeWidget)
+  };
+}
@@ -28,6 +28,8 @@
 #include "visage_utils/child_process.h"
 #include "visage_utils/file_system.h"
 
+#include <set>
+
 namespace visage {
   static std::string shaderExecutable() {
 #if VISAGE_WINDOWS
@@ -37,12 +39,6 @@ namespace visage {
 #endif
   }
 
-  inline int shaderEditTime(const std::string& file_path) {
-    std::error_code error;
-    auto edit_time = std::filesystem::last_write_time(file_path, error).time_since_epoch();
-    return std::chrono::duration_cast<std::chrono::seconds>(edit_time).count();
-  }
-
   ShaderCompiler::ShaderCompiler() : Thread("Shader Compiler") {
     static constexpr int kMaxParentDirectories = 4;
     std::string executable = shaderExecutable();
@@ -75,57 +71,36 @@ namespace visage {
 
   void ShaderCompiler::run() {
     compileWaitingShader();
-
-    while (!watched_edit_times_.empty() && shouldRun()) {
-      sleep(100);
-      compileWaitingShader();
-
-      for (auto& shader : watched_edit_times_) {
-        if (!shouldRun())
-          break;
-        checkShaderForEdits(shader.first);
-      }
-    }
   }
 
   void ShaderCompiler::watchShaderFolder(const std::string& folder_path) {
-    std::vector<File> files = searchForFiles(folder_path, ".sc$");
-    for (const auto& file : files)
-      watched_edit_times_[file.string()] = shaderEditTime(file.string());
-
-#ifndef VISAGE_EMSCRIPTEN
-    if (!running())
-      start();
-#endif
+    file_watcher_->watch(folder_path, [this](const File& file) {
+      if (file.extension() == ".sc")
+        reloadShaderFile(file);
+    });
   }
 
   void ShaderCompiler::compileWaitingShader() {
-    while (new_code_.load())
-      compileShader();
+    while (new_code_.load() && shouldRun()) {
+      long long wait_ms = code_time_.load() + kDebounceMs - time::milliseconds();
+      if (wait_ms > 0)
+        sleep(std::min<long long>(wait_ms, kDebounceMs));
+      else
+        compileShader();
+    }
   }
 
-  void ShaderCompiler::loadShaderEditTimes() {
-    for (auto& shader : watched_edit_times_)
-      shader.second = shaderEditTime(shader.first);
-  }
+  void ShaderCompiler::reloadShaderFile(const File& file) {
+    if (!fileExists(file))
+      return;
 
-  void ShaderCompiler::checkShaderForEdits(const std::string& file_path) {
-    int seconds = shaderEditTime(file_path);
-    if (watched_edit_times_[file_path] < seconds) {
-      watched_edit_times_[file_path] = seconds;
-      std::string code = loadFileAsString(file_path);
-      std::string file_stem = fileStem(file_path);
-      setCode(file_stem, code, [](const std::string& error) {
-        if (!error.empty())
-          VISAGE_LOG(error);
-      });
-      compileShader();
-    }
+    compile(fileStem(file), loadFileAsString(file), [](const std::string& error) {
+      if (!error.empty())
+        VISAGE_LOG(error);
+    });
   }
 
   bool ShaderCompiler::compileShader() {
-    new_code_ = false;
-
     File compile_path = std::filesystem::temp_directory_path() / "shader_compiler";
     File include_path = compile_path / "includes";
     std::filesystem::create_directories(include_path);
@@ -173,7 +148,11 @@ namespace visage {
                             platform + " -p " + profile;
 
     std::string output;
-    if (!spawnChildProcess(compiler_path_, arguments, output)) {
+    if (!spawnChildProcess(compiler_path_, arguments, output, kDefaultChildProcessTimeoutMs,
+                           &cancel_compile_)) {
+      if (cancel_compile_.load())
+        return false;
+
       if (output.empty())
         output = "Failed to compile shader";
       runOnEventThread([callback, output]() { callback(output); });
@@ -181,6 +160,9 @@ namespace visage {
     }
 
     std::string compile_shader = loadFileAsString(output_file);
+    if (cancel_compile_.load())
+      return false;
+
     runOnEventThread([compile_shader, shader_name]() {
       if (ShaderCache::swapShader(shader_name, compile_shader.c_str(), compile_shader.size()))
         ProgramCache::refreshAllProgramsWithShader(shader_name);
@@ -191,6 +173,54 @@ namespace visage {
     return true;
   }
 
+  static std::vector<TextStyle> highlightShaderLine(const String& line) {
+    static const std::set<std::u32string> keywords = {
+      U"void", U"float", U"int", U"bool", U"vec2", U"vec3", U"vec4", U"mat2", U"mat3", U"mat4",
+      U"sampler2D", U"uniform", U"const", U"in", U"out", U"inout", U"if", U"else", U"for",
+      U"while", U"return", U"discard", U"break", U"continue", U"true", U"false", U"SAMPLER2D",
+    };
+    static const Brush keyword_brush = Brush::solid(0xff66aaff);
+    static const Brush number_brush = Brush::solid(0xffffaa66);
+    static const Brush comment_brush = Brush::solid(0xff778088);
+    static const Brush directive_brush = Brush::solid(0xffcc88ff);
+
+    auto is_word = [](char32_t c) {
+      return c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+    };
+
+    std::vector<TextStyle> styles;
+    int length = line.length();
+    int i = 0;
+    while (i < length && (line[i] == ' ' || line[i] == '\t'))
+      i++;
+    if (i < length && (line[i] == '#' || line[i] == '$')) {
+      styles.push_back({ i, length - i, directive_brush });
+      return styles;
+    }
+
+    while (i < length) {
+      if (line[i] == '/' && i + 1 < length && line[i + 1] == '/') {
+        styles.push_back({ i, length - i, comment_brush });
+        break;
+      }
+
+      if (!is_word(line[i])) {
+        i++;
+        continue;
+      }
+
+      int start = i;
+      while (i < length && (is_word(line[i]) || line[i] == '.'))
+        i++;
+
+      if (line[start] >= '0' && line[start] <= '9')
+        styles.push_back({ start, i - start, number_brush });
+      else if (keywords.count(std::u32string(line.c_str() + start, i - start)))
+        styles.push_back({ start, i - start, keyword_brush });
+    }
+    return styles;
+  }
+
   ShaderEditor::ShaderEditor() {
     addChild(&editor_);
     addChild(&error_);
@@ -200,6 +230,7 @@ namespace visage {
     editor_.setFont(Font(16, fonts::DroidSansMono_ttf));
     editor_.setJustification(Font::kTopLeft);
     editor_.setDefaultText("No shader set");
+    editor_.setHighlighter(highlightShaderLine);
 
     editor_.onTextChange() += [this] {
       if (shader_.data) {
@@ -24,7 +24,9 @@
 #include "text_editor.h"
 #include "visage_graphics/graphics_caches.h"
 #include "visage_ui/frame.h"
+#include "visage_utils/file_watcher.h"
 #include "visage_utils/thread_utils.h"
+#include "visage_utils/time_utils.h"
 
 #include <mutex>
 #include <string>
@@ -33,8 +35,13 @@
 // Not for production use.
 
 namespace visage {
+  // Compiles on its own thread. Code is compiled once it stops changing for kDebounceMs, and a
+  // compile still running when newer code arrives is cancelled and its result dropped. Watched
+  // shader files are recompiled when a FileWatcher reports they changed on disk.
   class ShaderCompiler : public Thread {
   public:
+    static constexpr int kDebounceMs = 150;
+
     enum class Platform {
       Linux,
       Mac,
@@ -56,7 +63,11 @@ namespace visage {
     };
 
     ShaderCompiler();
-    ~ShaderCompiler() override { stop(); }
+    ~ShaderCompiler() override {
+      file_watcher_ = nullptr;
+      cancel_compile_ = true;
+      stop();
+    }
 
     static constexpr const char* platformArgument(Platform platform) {
       switch (platform) {
@@ -109,18 +120,13 @@ namespace visage {
     void watchShaderFolder(const std::string& folder_path);
 
     void watchShaders(const std::vector<std::string>& shaders) {
-#if !VISAGE_EMSCRIPTEN
       for (const std::string& shader : shaders)
-        watched_edit_times_[shader] = 0;
-
-      start();
-#endif
+        file_watcher_->watch(shader, [this](const File& file) { reloadShaderFile(file); });
     }
 
   private:
     void compileWaitingShader();
-    void loadShaderEditTimes();
-    void checkShaderForEdits(const std::string& file_path);
+    void reloadShaderFile(const File& file);
     bool compileShader();
     bool compiling() const { return new_code_.load(); }
 
@@ -129,7 +135,9 @@ namespace visage {
       shader_name_ = shader_name;
       shader_code_ = std::move(code);
       callback_ = std::move(callback);
+      code_time_ = time::milliseconds();
       new_code_ = true;
+      cancel_compile_ = true;
     }
 
     void loadCode(std::string& shader_name, std::string& code, std::function<void(std::string)>& callback) {
@@ -138,15 +146,18 @@ namespace visage {
       code = shader_code_;
       callback = callback_;
       new_code_ = false;
+      cancel_compile_ = false;
     }
 
     std::atomic<bool> new_code_ = false;
+    std::atomic<bool> cancel_compile_ = false;
+    std::atomic<long long> code_time_ = 0;
     std::string compiler_path_;
     std::mutex code_mutex_;
     std::string shader_name_;
     std::function<void(std::string)> callback_ = nullptr;
     std::string shader_code_;
-    std::map<std::string, int> watched_edit_times_;
+    std::unique_ptr<FileWatcher> file_watcher_ = std::make_unique<FileWatcher>();
   };
 
   class ShaderEditor : public Frame {
@@ -0,0 +1,91 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "visage_graphics/canvas.h"
+#include "visage_widgets/scope_widget.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace visage;
+
+TEST_CASE("Free running scope streams only new samples", "[widgets]") {
+  ScopeWidget scope(16, 64);
+  REQUIRE(scope.data().streaming());
+
+  float samples[4] = { 1.0f, -1.0f, 0.5f, 0.0f };
+  REQUIRE(scope.pushSamples(samples, 4) == 4);
+  scope.data().markUploaded();
+  scope.update();
+
+  auto dirty = scope.data().dirtyColumns();
+  REQUIRE_FALSE(dirty.empty());
+  REQUIRE(dirty.front().second - dirty.front().first == 4);
+}
+
+TEST_CASE("Triggered scope starts at a rising crossing", "[widgets]") {
+  ScopeWidget scope(16, 64);
+  scope.setTriggered(true);
+  REQUIRE_FALSE(scope.data().streaming());
+
+  float samples[40];
+  for (int i = 0; i < 40; ++i)
+    samples[i] = (i % 10) < 5 ? 1.0f : -1.0f;
+  scope.pushSamples(samples, 10);
+  scope.pushSamples(samples + 10, 30);
+  scope.update();
+
+  for (int i = 0; i < 5; ++i)
+    REQUIRE(scope.data()[i] == 1.0f);
+  for (int i = 5; i < 10; ++i)
+    REQUIRE(scope.data()[i] == 0.0f);
+  REQUIRE(scope.data()[10] == 1.0f);
+}
+
+TEST_CASE("Scope redraws only when samples are pushed", "[widgets]") {
+  struct RedrawCounter : FrameEventHandler {
+    RedrawCounter() {
+      request_redraw = [this](Frame*) { count++; };
+    }
+    int count = 0;
+  };
+
+  Canvas canvas;
+  RedrawCounter handler;
+  ScopeWidget scope(16, 64);
+  scope.setBounds(0, 0, 100, 50);
+  scope.setEventHandler(&handler);
+  scope.drawToRegion(canvas);
+
+  handler.count = 0;
+  AnimationScheduler::instance().advance(0);
+  REQUIRE(handler.count == 0);
+
+  float samples[4] = { 1.0f, -1.0f, 0.5f, 0.0f };
+  scope.pushSamples(samples, 4);
+  AnimationScheduler::instance().advance(16);
+  REQUIRE(handler.count == 1);
+
+  scope.drawToRegion(canvas);
+  handler.count = 0;
+  AnimationScheduler::instance().advance(32);
+  REQUIRE(handler.count == 0);
+  scope.setEventHandler(nullptr);
+}
@@ -0,0 +1,251 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "visage_graphics/canvas.h"
+#include "visage_widgets/text_editor.h"
+
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace visage;
+
+namespace {
+  std::vector<std::pair<float, float>> caretPositions(const TextEditor& editor) {
+    std::vector<std::pair<float, float>> positions;
+    for (int i = 0; i <= editor.textLength(); ++i)
+      positions.push_back(editor.indexToPosition(i));
+    return positions;
+  }
+
+  void setupMultiLine(TextEditor& editor) {
+    editor.setMultiLine(true);
+    editor.setJustification(Font::kTopLeft);
+    editor.setBounds(0, 0, 120, 300);
+  }
+
+  void drawAll(Frame& frame, Canvas& canvas) {
+    frame.drawToRegion(canvas);
+    for (Frame* child : frame.children())
+      drawAll(*child, canvas);
+  }
+
+  int childIndex(const Frame& parent, const Frame* child) {
+    const std::vector<Frame*>& children = parent.children();
+    return std::find(children.begin(), children.end(), child) - children.begin();
+  }
+}
+
+TEST_CASE("TextEditor reflows only edited lines", "[widgets]") {
+  String paragraph = "The quick brown fox jumps over the lazy dog. ";
+  String text;
+  for (int i = 0; i < 6; ++i)
+    text += paragraph + paragraph + "\n";
+
+  TextEditor editor;
+  setupMultiLine(editor);
+  editor.setText(text);
+  int text_length = editor.textLength();
+
+  SECTION("Inserting a word") {
+    editor.moveCaretToTop(false);
+    for (int i = 0; i < 10; ++i)
+      editor.moveCaretRight(false, false);
+    editor.insertTextAtCaret("extraordinarily ");
+    REQUIRE(editor.textLength() == text_length + 16);
+  }
+
+  SECTION("Inserting a new line") {
+    editor.moveCaretToTop(false);
+    for (int i = 0; i < 70; ++i)
+      editor.moveCaretRight(false, false);
+    editor.insertTextAtCaret("\n");
+  }
+
+  SECTION("Deleting across paragraphs") {
+    editor.moveCaretToTop(false);
+    for (int i = 0; i < 80; ++i)
+      editor.moveCaretRight(false, false);
+    for (int i = 0; i < 30; ++i)
+      editor.moveCaretRight(false, true);
+    editor.deleteBackwards(false);
+    REQUIRE(editor.textLength() == text_length - 30);
+  }
+
+  SECTION("Deleting at the end") {
+    editor.moveCaretToEnd(false);
+    for (int i = 0; i < 12; ++i)
+      editor.deleteBackwards(false);
+  }
+
+  TextEditor expected;
+  setupMultiLine(expected);
+  expected.setText(editor.text());
+  REQUIRE(caretPositions(editor) == caretPositions(expected));
+}
+
+TEST_CASE("TextEditor rehighlights only edited lines", "[widgets]") {
+  int highlighted = 0;
+  auto highlighter = [&highlighted](const String& line) {
+    highlighted++;
+    std::vector<TextStyle> styles;
+    if (line.length() >= 2)
+      styles.push_back({ 0, 2, Brush::solid(0xffff0000) });
+    return styles;
+  };
+
+  TextEditor editor;
+  setupMultiLine(editor);
+  editor.setText("ab one\ncd two\nef three\ngh four");
+  editor.setHighlighter(highlighter);
+  REQUIRE(highlighted == 4);
+  REQUIRE(editor.textLength() == 30);
+
+  highlighted = 0;
+  editor.moveCaretToTop(false);
+  editor.moveCaretDown(false);
+  editor.insertTextAtCaret("x");
+  REQUIRE(highlighted == 1);
+
+  highlighted = 0;
+  editor.insertTextAtCaret("\n");
+  REQUIRE(highlighted == 2);
+
+  highlighted = 0;
+  editor.undo();
+  REQUIRE(editor.textLength() == 30);
+  REQUIRE(highlighted == 2);
+}
+
+TEST_CASE("TextEditor undo and redo replay edits", "[widgets]") {
+  TextEditor editor;
+  setupMultiLine(editor);
+  editor.setText("Hello world\nSecond line of text that wraps around the editor");
+
+  editor.moveCaretToEnd(false);
+  editor.insertTextAtCaret("!");
+  editor.insertTextAtCaret("!");
+  String typed = editor.text();
+
+  editor.moveCaretToTop(false);
+  for (int i = 0; i < 6; ++i)
+    editor.moveCaretRight(false, true);
+  editor.deleteBackwards(false);
+  String deleted = editor.text();
+  REQUIRE(deleted == "world\nSecond line of text that wraps around the editor!!");
+
+  editor.enterPressed();
+  String split = editor.text();
+  REQUIRE(split == "\nworld\nSecond line of text that wraps around the editor!!");
+
+  editor.undo();
+  REQUIRE(editor.text() == deleted);
+  editor.undo();
+  REQUIRE(editor.text() == typed);
+  editor.undo();
+  REQUIRE(editor.text() == "Hello world\nSecond line of text that wraps around the editor");
+
+  editor.redo();
+  REQUIRE(editor.text() == typed);
+  editor.redo();
+  editor.redo();
+  REQUIRE(editor.text() == split);
+  REQUIRE_FALSE(editor.redo());
+
+  TextEditor expected;
+  setupMultiLine(expected);
+  expected.setText(split);
+  REQUIRE(caretPositions(editor) == caretPositions(expected));
+
+  editor.setText("Reset");
+  editor.undo();
+  REQUIRE(editor.text() == "Reset");
+}
+
+TEST_CASE("TextEditor visible lines follow the scroll position", "[widgets]") {
+  String text;
+  for (int i = 0; i < 500; ++i)
+    text += String(i) + "\n";
+
+  TextEditor editor;
+  setupMultiLine(editor);
+  editor.setText(text);
+  editor.setYPosition(0.0f);
+
+  float line_height = editor.font().lineHeight();
+  std::pair<int, int> top = editor.visibleLines();
+  REQUIRE(top.first == 0);
+  int visible_count = top.second - top.first + 1;
+  REQUIRE(visible_count <= editor.height() / line_height + 2);
+
+  editor.setYPosition(200 * line_height + editor.yMargin());
+  std::pair<int, int> middle = editor.visibleLines();
+  REQUIRE(middle.first == 200);
+  REQUIRE(std::abs(middle.second - middle.first + 1 - visible_count) <= 1);
+
+  editor.moveCaretToEnd(false);
+  std::pair<int, int> bottom = editor.visibleLines();
+  REQUIRE(bottom.second == 500);
+  REQUIRE(bottom.first > 400);
+}
+
+TEST_CASE("TextEditor selection redraws under the text without redrawing it", "[widgets]") {
+  struct RedrawRecorder : FrameEventHandler {
+    RedrawRecorder() {
+      request_redraw = [this](Frame* frame) { frames.push_back(frame); };
+    }
+    std::vector<Frame*> frames;
+  };
+
+  Canvas canvas;
+  RedrawRecorder handler;
+  TextEditor editor;
+  setupMultiLine(editor);
+  editor.setText("Hello world\nSecond line");
+  editor.setEventHandler(&handler);
+  drawAll(editor, canvas);
+
+  handler.frames.clear();
+  editor.moveCaretLeft(false, true);
+  REQUIRE(handler.frames.size() == 1);
+  Frame* selection = handler.frames.front();
+  REQUIRE(selection->parent() == &editor);
+  REQUIRE(editor.selection() == "e");
+
+  drawAll(editor, canvas);
+  handler.frames.clear();
+  editor.moveCaretToTop(true);
+  REQUIRE(handler.frames == std::vector<Frame*> { selection });
+
+  editor.moveCaretToEnd(false);
+  drawAll(editor, canvas);
+  handler.frames.clear();
+  editor.insertTextAtCaret("x");
+  REQUIRE(editor.text() == "Hello world\nSecond linex");
+  REQUIRE(std::count(handler.frames.begin(), handler.frames.end(), &editor) == 0);
+  REQUIRE(std::count(handler.frames.begin(), handler.frames.end(), selection) == 1);
+  REQUIRE(handler.frames.size() == 2);
+
+  Frame* text = handler.frames.front() == selection ? handler.frames.back() : handler.frames.front();
+  REQUIRE(text->parent() == &editor);
+  REQUIRE(childIndex(editor, selection) < childIndex(editor, text));
+  REQUIRE(childIndex(editor, text) < childIndex(editor, &editor.scrollBar()));
+  editor.setEventHandler(nullptr);
+}
@@ -0,0 +1,52 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "visage_widgets/value_control.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace visage;
+
+TEST_CASE("Value controls clamp and notify on changes", "[widgets]") {
+  Knob knob;
+  int num_notifications = 0;
+  float notified = -1.0f;
+  knob.onValueChange() = [&](float value) {
+    num_notifications++;
+    notified = value;
+  };
+
+  knob.setValue(0.25f);
+  REQUIRE(knob.value() == 0.25f);
+  REQUIRE(num_notifications == 0);
+
+  knob.setValueAndNotify(2.0f);
+  REQUIRE(knob.value() == 1.0f);
+  REQUIRE(notified == 1.0f);
+  knob.setValueAndNotify(1.0f);
+  REQUIRE(num_notifications == 1);
+
+  Slider slider("slider", true);
+  REQUIRE(slider.vertical());
+  slider.setDefaultValue(0.5f);
+  slider.setValueAndNotify(-1.0f);
+  REQUIRE(slider.value() == 0.0f);
+}
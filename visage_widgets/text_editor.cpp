@@ -105,6 +105,19 @@ namespace visage {
     setAcceptsKeystrokes(true);
     text_.setFont(Font(10, fonts::Lato_Regular_ttf, 1.0f));
     default_text_.setFont(Font(10, fonts::Lato_Regular_ttf, 1.0f));
+
+    selection_frame_.setIgnoresMouseEvents(true, false);
+    selection_frame_.onDraw() = [this](Canvas& canvas) {
+      if (hasKeyboardFocus())
+        drawSelection(canvas);
+    };
+    text_frame_.setIgnoresMouseEvents(true, false);
+    text_frame_.onDraw() = [this](Canvas& canvas) { drawText(canvas); };
+
+    addChild(&selection_frame_);
+    addChild(&text_frame_);
+    removeChild(&scrollBar());
+    addChild(&scrollBar());
   }
 
   void TextEditor::drawBackground(Canvas& canvas) const {
@@ -171,12 +184,12 @@ namespace visage {
 
   void TextEditor::draw(Canvas& canvas) {
     drawBackground(canvas);
+  }
+
+  void TextEditor::drawText(Canvas& canvas) {
     float x_margin = xMargin();
     Bounds text_bounds(x_margin, 0.0f, width() - 2.0f * x_margin, std::max(height(), scrollableHeight()));
 
-    if (hasKeyboardFocus())
-      drawSelection(canvas);
-
     canvas.setPosition(0, yMargin());
     if (text_.text().isEmpty()) {
       bool center = (justification() & Font::kLeft) == 0 && (justification() & Font::kRight) == 0;
@@ -188,7 +201,18 @@ namespace visage {
     }
     else {
       canvas.setColor(TextEditorText);
-      if (justification() & Font::kLeft) {
+      if (text_.multiLine() && (justification() & Font::kTop)) {
+        if (justification() & Font::kLeft)
+          drawVisibleText(canvas, x_margin - x_position_, x_position_ + text_bounds.width());
+        else if (justification() & Font::kRight)
+          drawVisibleText(canvas, 0, x_margin + text_bounds.width() - x_position_);
+        else {
+          canvas.setPosition(-x_position_, 0.0f);
+          float expansion = std::abs(x_position_);
+          drawVisibleText(canvas, -expansion, text_bounds.width() + 2 * expansion);
+        }
+      }
+      else if (justification() & Font::kLeft) {
         canvas.text(&text_, x_margin - x_position_, -yPosition(), x_position_ + text_bounds.width(),
                     text_bounds.height());
       }
@@ -205,6 +229,120 @@ namespace visage {
     }
   }
 
+  void TextEditor::replaceText(int position, int count, const String& text) {
+    if (count == 0 && text.isEmpty())
+      return;
+
+    if (!undo_history_.empty())
+      undo_history_.back().edits.push_back({ position, text_.text().substring(position, count), text });
+
+    text_.replaceText(position, count, text);
+    updateLineBreaks(position, count, text.length());
+  }
+
+  void TextEditor::highlightLines(int start, int end) {
+    if (!highlighter_)
+      return;
+
+    const String& text = text_.text();
+    int length = text.length();
+    while (start > 0 && !Font::isNewLine(text[start - 1]))
+      start--;
+    while (end < length && !Font::isNewLine(text[end]))
+      end++;
+
+    std::vector<TextStyle> styles;
+    int line_start = start;
+    while (line_start <= end) {
+      int line_end = line_start;
+      while (line_end < end && !Font::isNewLine(text[line_end]))
+        line_end++;
+
+      for (TextStyle& style : highlighter_(text.substring(line_start, line_end - line_start))) {
+        style.start += line_start;
+        styles.push_back(std::move(style));
+      }
+      line_start = line_end + 1;
+    }
+
+    text_.restyle(start, end, styles);
+    visible_text_dirty_ = true;
+  }
+
+  void TextEditor::updateLineBreaks(int edit_start, int removed, int inserted) {
+    highlightLines(edit_start, edit_start + inserted);
+    visible_text_dirty_ = true;
+    text_frame_.redraw();
+    if (!text_.multiLine() || text_.font().packedFont() == nullptr)
+      return;
+
+    const char32_t* text = text_.text().c_str();
+    int length = textLength();
+    float line_width = width() - 2 * xMargin();
+
+    int start = edit_start;
+    while (start > 0 && !Font::isNewLine(text[start - 1]))
+      start--;
+
+    int delta = inserted - removed;
+    int inserted_end = edit_start + inserted;
+    auto kept = std::upper_bound(line_breaks_.begin(), line_breaks_.end(), start);
+    auto old_break = std::lower_bound(kept, line_breaks_.end(), edit_start + removed);
+
+    std::vector<int> reflowed;
+    int line_break = start;
+    while ((line_break = text_.font().nextLineBreak(text, length, line_break, line_width)) >= 0) {
+      if (line_break >= inserted_end) {
+        while (old_break != line_breaks_.end() && *old_break + delta < line_break)
+          ++old_break;
+        if (old_break != line_breaks_.end() && *old_break + delta == line_break)
+          break;
+      }
+      reflowed.push_back(line_break);
+    }
+
+    if (line_break < 0)
+      old_break = line_breaks_.end();
+
+    std::vector<int> tail(old_break, line_breaks_.end());
+    for (int& index : tail)
+      index += delta;
+
+    line_breaks_.erase(kept, line_breaks_.end());
+    line_breaks_.insert(line_breaks_.end(), reflowed.begin(), reflowed.end());
+    line_breaks_.insert(line_breaks_.end(), tail.begin(), tail.end());
+  }
+
+  std::pair<int, int> TextEditor::visibleLines() const {
+    float line_height = font().lineHeight();
+    int num_lines = line_breaks_.size() + 1;
+    if (line_height <= 0.0f)
+      return { 0, num_lines - 1 };
+
+    float top = yPosition() - yMargin();
+    int first = std::max(0, static_cast<int>(std::floor(top / line_height)));
+    int last = static_cast<int>(std::floor((top + height()) / line_height));
+    return { std::min(first, num_lines - 1), std::min(last, num_lines - 1) };
+  }
+
+  void TextEditor::drawVisibleText(Canvas& canvas, float x, float width) {
+    std::pair<int, int> lines = visibleLines();
+    int start = lines.first > 0 ? line_breaks_[lines.first - 1] : 0;
+    int end = lines.second < line_breaks_.size() ? line_breaks_[lines.second] : textLength();
+
+    if (visible_text_dirty_ || visible_range_ != std::pair<int, int>(start, end)) {
+      visible_text_dirty_ = false;
+      visible_range_ = { start, end };
+      visible_text_ = Text(text_.text().substring(start, end - start), font(), justification(), true);
+      visible_text_.setStyles(text_.stylesInRange(start, end));
+    }
+
+    float line_height = font().lineHeight();
+    int num_lines = lines.second - lines.first + 1;
+    canvas.text(&visible_text_, x, lines.first * line_height - yPosition(), width,
+                num_lines * line_height);
+  }
+
   std::pair<float, float> TextEditor::indexToPosition(int index) const {
     int line = 0;
     float line_height = font().lineHeight();
@@ -307,10 +445,7 @@ namespace visage {
       addUndoPosition();
     action_state_ = kDeleting;
 
-    String before = text_.text().substring(0, selectionStart());
-    String after = text_.text().substring(selectionEnd());
-    text_.setText(before + after);
-    setLineBreaks();
+    replaceText(selectionStart(), selectionEnd() - selectionStart(), {});
     caret_position_ = selectionStart();
     selection_position_ = caret_position_;
     makeCaretVisible();
@@ -322,6 +457,7 @@ namespace visage {
     if (font().packedFont() == nullptr || width() == 0.0f || height() == 0.0f)
       return;
 
+    float previous_x_position = x_position_;
     if (text_.multiLine()) {
       float min_view = yMargin() + yPosition();
       float max_view = yPosition() + height() - font().lineHeight();
@@ -368,7 +504,9 @@ namespace visage {
     setViewBounds();
     selection_start_point_ = indexToPosition(selectionStart());
     selection_end_point_ = indexToPosition(selectionEnd());
-    redraw();
+    if (x_position_ != previous_x_position)
+      text_frame_.redraw();
+    selection_frame_.redraw();
   }
 
   void TextEditor::setViewBounds() {
@@ -421,7 +559,7 @@ namespace visage {
       makeCaretVisible();
     }
 
-    redraw();
+    selection_frame_.redraw();
   }
 
   void TextEditor::mouseUp(const MouseEvent& e) {
@@ -432,7 +570,6 @@ namespace visage {
     if (!mouse_focus_)
       caret_position_ = positionToIndex({ e.position.x + x_position_, e.position.y + yPosition() });
     makeCaretVisible();
-    redraw();
   }
 
   void TextEditor::doubleClick(const MouseEvent& e) {
@@ -492,7 +629,7 @@ namespace visage {
   }
 
   bool TextEditor::keyPress(const KeyEvent& key) {
-    redraw();
+    selection_frame_.redraw();
 
     bool modifier = key.isMainModifier();
     if (key.isAltDown()) {
@@ -613,7 +750,8 @@ namespace visage {
   }
 
   void TextEditor::focusChanged(bool is_focused, bool was_clicked) {
-    redraw();
+    text_frame_.redraw();
+    selection_frame_.redraw();
     if (!is_focused) {
       if (dead_key_entry_ != DeadKey::None) {
         dead_key_entry_ = DeadKey::None;
@@ -805,13 +943,16 @@ namespace visage {
       return true;
 
     action_state_ = kNone;
-    undone_history_.emplace_back(text_.text(), caret_position_);
-    std::pair<String, int> state = undo_history_.back();
+    UndoStep step = std::move(undo_history_.back());
     undo_history_.pop_back();
-    text_.setText(state.first);
-    caret_position_ = state.second;
-    selection_position_ = state.second;
-    setLineBreaks();
+    for (auto edit = step.edits.rbegin(); edit != step.edits.rend(); ++edit) {
+      text_.replaceText(edit->position, edit->inserted.length(), edit->removed);
+      updateLineBreaks(edit->position, edit->inserted.length(), edit->removed.length());
+    }
+    step.caret_after = caret_position_;
+    caret_position_ = step.caret_before;
+    selection_position_ = step.caret_before;
+    undone_history_.push_back(std::move(step));
     makeCaretVisible();
     on_text_change_.callback();
     return true;
@@ -821,13 +962,16 @@ namespace visage {
     if (undone_history_.empty())
       return false;
 
-    addUndoPosition();
-    std::pair<String, int> state = undone_history_.back();
+    action_state_ = kNone;
+    UndoStep step = std::move(undone_history_.back());
     undone_history_.pop_back();
-    text_.setText(state.first);
-    caret_position_ = state.second;
-    selection_position_ = state.second;
-    setLineBreaks();
+    for (const TextEdit& edit : step.edits) {
+      text_.replaceText(edit.position, edit.removed.length(), edit.inserted);
+      updateLineBreaks(edit.position, edit.removed.length(), edit.inserted.length());
+    }
+    caret_position_ = step.caret_after;
+    selection_position_ = step.caret_after;
+    undo_history_.push_back(std::move(step));
     makeCaretVisible();
     on_text_change_.callback();
     return true;
@@ -848,21 +992,18 @@ namespace visage {
       addUndoPosition();
     action_state_ = kInserting;
 
-    String before = text_.text().substring(0, selectionStart());
-    String after = text_.text().substring(selectionEnd());
+    int start = selectionStart();
+    int removed = selectionEnd() - start;
     int max_text = text.length();
     if (max_characters_)
-      max_text = std::max(0, std::min<int>(max_text, max_characters_ - before.length() - after.length()));
+      max_text = std::max(0, std::min(max_text, max_characters_ - textLength() + removed));
 
-    String trimmed = text.substring(0, max_text);
-    text_.setText(before + trimmed + after);
-    setLineBreaks();
-    caret_position_ = before.length() + max_text;
+    replaceText(start, removed, text.substring(0, max_text));
+    caret_position_ = start + max_text;
     selection_position_ = caret_position_;
     makeCaretVisible();
 
     on_text_change_.callback();
-    redraw();
   }
 
   void TextEditor::setNumberEntry() {
@@ -22,6 +22,7 @@
 #pragma once
 
 #include "visage_graphics/font.h"
+#include "visage_graphics/text.h"
 #include "visage_ui/frame.h"
 #include "visage_ui/scroll_bar.h"
 
@@ -72,6 +73,9 @@ namespace visage {
     VISAGE_THEME_DEFINE_VALUE(TextEditorMarginX);
     VISAGE_THEME_DEFINE_VALUE(TextEditorMarginY);
 
+    // Styles one line of text, without its newline. Positions are relative to the line start.
+    using Highlighter = std::function<std::vector<TextStyle>(const String& line)>;
+
     explicit TextEditor(const std::string& name = "");
     ~TextEditor() override = default;
 
@@ -86,6 +90,7 @@ namespace visage {
 
     std::pair<float, float> indexToPosition(int index) const;
     std::pair<int, int> lineRange(int line) const;
+    std::pair<int, int> visibleLines() const;
     int positionToIndex(const std::pair<float, float>& position) const;
 
     void cancel();
@@ -103,6 +108,8 @@ namespace visage {
 
     void resized() override {
       ScrollableFrame::resized();
+      selection_frame_.setBounds(localBounds());
+      text_frame_.setBounds(localBounds());
       setBackgroundRounding(paletteValue(TextEditorRounding));
       setLineBreaks();
       makeCaretVisible();
@@ -112,6 +119,7 @@ namespace visage {
       Font f = font().withDpiScale(dpiScale());
       text_.setFont(f);
       default_text_.setFont(f);
+      visible_text_dirty_ = true;
     }
 
     void mouseEnter(const MouseEvent& e) override;
@@ -183,23 +191,40 @@ namespace visage {
     }
 
     void setLineBreaks() {
+      visible_text_dirty_ = true;
+      text_frame_.redraw();
       if (text_.multiLine() && text_.font().packedFont()) {
         line_breaks_ = text_.font().lineBreaks(text_.text().c_str(), text_.text().length(),
                                                width() - 2 * xMargin());
       }
     }
+    void updateLineBreaks(int edit_start, int removed, int inserted);
 
     void setText(const String& text) {
       if (max_characters_)
         text_.setText(text.substring(0, max_characters_));
       else
         text_.setText(text);
+      undo_history_.clear();
+      undone_history_.clear();
+      action_state_ = kNone;
       caret_position_ = text_.text().length();
       selection_position_ = caret_position_;
+      highlightLines(0, textLength());
       setLineBreaks();
       makeCaretVisible();
     }
 
+    // Lines are highlighted once and kept, edits only rehighlight the lines they touch. Styled
+    // text still draws in a single batch.
+    void setHighlighter(Highlighter highlighter) {
+      highlighter_ = std::move(highlighter);
+      text_.setStyles({});
+      highlightLines(0, textLength());
+      text_frame_.redraw();
+    }
+    const Highlighter& highlighter() const { return highlighter_; }
+
     void setFilteredCharacters(const std::string& characters) { filtered_characters_ = characters; }
     void setDefaultText(const String& default_text) { default_text_.setText(default_text); }
     void setMaxCharacters(int max) { max_characters_ = max; }
@@ -213,6 +238,8 @@ namespace visage {
     void setJustification(Font::Justification justification) {
       text_.setJustification(justification);
       default_text_.setJustification(justification);
+      visible_text_dirty_ = true;
+      text_frame_.redraw();
     }
     void setFont(const Font& font) {
       Font f = font.withDpiScale(dpiScale());
@@ -221,7 +248,13 @@ namespace visage {
       setLineBreaks();
       makeCaretVisible();
     }
-    void setActive(bool active) { active_ = active; }
+    void setActive(bool active) {
+      if (active_ == active)
+        return;
+
+      active_ = active;
+      focusOrderChanged();
+    }
     void setNumberEntry();
     void setTextFieldEntry();
 
@@ -232,20 +265,48 @@ namespace visage {
     void setBackgroundColorId(theme::ColorId color_id) { background_color_id_ = color_id; }
 
   private:
+    struct TextEdit {
+      int position = 0;
+      String removed;
+      String inserted;
+    };
+
+    struct UndoStep {
+      std::vector<TextEdit> edits;
+      int caret_before = 0;
+      int caret_after = 0;
+    };
+
     float xMarginSize() const {
       return set_x_margin_ ? set_x_margin_ : paletteValue(TextEditorMarginX);
     }
-    void addUndoPosition() { undo_history_.emplace_back(text_.text(), caret_position_); }
+    void addUndoPosition() { undo_history_.push_back({ {}, caret_position_, caret_position_ }); }
+    void replaceText(int position, int count, const String& text);
+    void highlightLines(int start, int end);
+    void drawVisibleText(Canvas& canvas, float x, float width);
+    void drawText(Canvas& canvas);
+    void scrolled() override {
+      selection_frame_.redraw();
+      text_frame_.redraw();
+    }
 
     CallbackList<void()> on_text_change_;
     CallbackList<void()> on_enter_key_;
     CallbackList<void()> on_escape_key_;
 
+    // Caret and selection draw in their own region under the text, so moving them doesn't
+    // redraw the text and the highlight stays behind the glyphs.
+    Frame selection_frame_;
+    Frame text_frame_;
     DeadKey dead_key_entry_ = DeadKey::None;
     Text text_;
     Text default_text_;
+    Text visible_text_;
+    std::pair<int, int> visible_range_;
+    bool visible_text_dirty_ = true;
     std::string filtered_characters_;
     std::vector<int> line_breaks_;
+    Highlighter highlighter_;
     int caret_position_ = 0;
     int selection_position_ = 0;
     std::pair<float, float> selection_start_point_;
@@ -263,8 +324,8 @@ namespace visage {
     float x_position_ = 0.0f;
 
     ActionState action_state_ = kNone;
-    std::vector<std::pair<String, int>> undo_history_;
-    std::vector<std::pair<String, int>> undone_history_;
+    std::vector<UndoStep> undo_history_;
+    std::vector<UndoStep> undone_history_;
 
     VISAGE_LEAK_CHECKER(TextEditor)
   };
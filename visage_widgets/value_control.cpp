@@ -0,0 +1,128 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "value_control.h"
+
+namespace visage {
+  VISAGE_THEME_IMPLEMENT_COLOR(ValueControl, ValueControlTrack, 0xff2c3033);
+  VISAGE_THEME_IMPLEMENT_COLOR(ValueControl, ValueControlValue, 0xffaa88ff);
+  VISAGE_THEME_IMPLEMENT_COLOR(ValueControl, ValueControlThumb, 0xffeeeeee);
+
+  VISAGE_THEME_IMPLEMENT_VALUE(ValueControl, ValueControlThickness, 4.0f);
+
+  ValueControl::ValueControl(const std::string& name) : Frame(name) {
+    addChild(&value_frame_);
+    value_frame_.setIgnoresMouseEvents(true, false);
+    value_frame_.onDraw() = [this](Canvas& canvas) { drawValue(canvas); };
+  }
+
+  void ValueControl::setValue(float value) {
+    value = std::max(0.0f, std::min(1.0f, value));
+    if (value_ == value)
+      return;
+
+    value_ = value;
+    value_frame_.redraw();
+  }
+
+  void ValueControl::setValueAndNotify(float value) {
+    float previous = value_;
+    setValue(value);
+    if (value_ != previous)
+      on_value_change_.callback(value_);
+  }
+
+  void ValueControl::mouseDown(const MouseEvent& e) {
+    if (e.repeatClickCount() == 2) {
+      setValueAndNotify(default_value_);
+      return;
+    }
+
+    drag_start_ = e.position;
+    drag_start_value_ = value_;
+  }
+
+  void ValueControl::mouseDrag(const MouseEvent& e) {
+    float mult = e.isShiftDown() ? kFineDragMult : 1.0f;
+    setValueAndNotify(drag_start_value_ + mult * dragAmount(e));
+  }
+
+  bool ValueControl::mouseWheel(const MouseEvent& e) {
+    if (e.precise_wheel_delta_y == 0.0f)
+      return false;
+
+    float mult = e.isShiftDown() ? kFineDragMult : 1.0f;
+    setValueAndNotify(value_ + mult * kWheelSensitivity * e.precise_wheel_delta_y);
+    return true;
+  }
+
+  void Knob::draw(Canvas& canvas) {
+    float size = std::min(width(), height());
+    float x = 0.5f * (width() - size);
+    float y = 0.5f * (height() - size);
+    canvas.setColor(ValueControlTrack);
+    canvas.roundedArc(x, y, size, thickness(), 0.0f, kMaxRadians);
+  }
+
+  void Knob::drawValue(Canvas& canvas) {
+    float size = std::min(width(), height());
+    float x = 0.5f * (width() - size);
+    float y = 0.5f * (height() - size);
+    float half_radians = kMaxRadians * value();
+    canvas.setColor(ValueControlValue);
+    canvas.roundedArc(x, y, size, thickness(), half_radians - kMaxRadians, half_radians);
+  }
+
+  float Slider::dragAmount(const MouseEvent& e) const {
+    if (vertical_)
+      return (dragStart().y - e.position.y) / trackLength();
+    return (e.position.x - dragStart().x) / trackLength();
+  }
+
+  void Slider::draw(Canvas& canvas) {
+    float t = thickness();
+    canvas.setColor(ValueControlTrack);
+    if (vertical_)
+      canvas.roundedRectangle(0.5f * (width() - t), 0.0f, t, height(), 0.5f * t);
+    else
+      canvas.roundedRectangle(0.0f, 0.5f * (height() - t), width(), t, 0.5f * t);
+  }
+
+  void Slider::drawValue(Canvas& canvas) {
+    float t = thickness();
+    float thumb = thumbWidth();
+    float position = value() * trackLength();
+
+    if (vertical_) {
+      float top = height() - thumb - position;
+      canvas.setColor(ValueControlValue);
+      canvas.roundedRectangle(0.5f * (width() - t), top, t, height() - top, 0.5f * t);
+      canvas.setColor(ValueControlThumb);
+      canvas.circle(0.5f * (width() - thumb), top, thumb);
+    }
+    else {
+      canvas.setColor(ValueControlValue);
+      canvas.roundedRectangle(0.0f, 0.5f * (height() - t), position + thumb, t, 0.5f * t);
+      canvas.setColor(ValueControlThumb);
+      canvas.circle(position, 0.5f * (height() - thumb), thumb);
+    }
+  }
+}
@@ -0,0 +1,117 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "visage_graphics/theme.h"
+#include "visage_ui/frame.h"
+
+namespace visage {
+  // Base for controls editing a normalized value. The control draws its static decoration in
+  // draw() and the value in a child frame, so a value change from automation only redraws the
+  // value arc or thumb and leaves the decoration's recorded shapes alone.
+  class ValueControl : public Frame {
+  public:
+    VISAGE_THEME_DEFINE_COLOR(ValueControlTrack);
+    VISAGE_THEME_DEFINE_COLOR(ValueControlValue);
+    VISAGE_THEME_DEFINE_COLOR(ValueControlThumb);
+
+    VISAGE_THEME_DEFINE_VALUE(ValueControlThickness);
+
+    static constexpr float kDragPixels = 200.0f;
+    static constexpr float kFineDragMult = 0.1f;
+    static constexpr float kWheelSensitivity = 0.05f;
+
+    explicit ValueControl(const std::string& name = "");
+    ~ValueControl() override = default;
+
+    auto& onValueChange() { return on_value_change_; }
+
+    float value() const { return value_; }
+    void setValue(float value);
+    void setValueAndNotify(float value);
+    void setDefaultValue(float value) { default_value_ = value; }
+    float defaultValue() const { return default_value_; }
+
+    void resized() override { value_frame_.setBounds(localBounds()); }
+    void mouseDown(const MouseEvent& e) override;
+    void mouseDrag(const MouseEvent& e) override;
+    bool mouseWheel(const MouseEvent& e) override;
+
+  protected:
+    virtual void drawValue(Canvas& canvas) = 0;
+    virtual float dragAmount(const MouseEvent& e) const = 0;
+
+    float thickness() const { return paletteValue(ValueControlThickness); }
+    Point dragStart() const { return drag_start_; }
+
+  private:
+    CallbackList<void(float)> on_value_change_;
+    Frame value_frame_;
+    float value_ = 0.0f;
+    float default_value_ = 0.0f;
+    float drag_start_value_ = 0.0f;
+    Point drag_start_;
+
+    VISAGE_LEAK_CHECKER(ValueControl)
+  };
+
+  class Knob : public ValueControl {
+  public:
+    static constexpr float kMaxRadians = 0.75f * 3.14159265358979323846f;
+
+    explicit Knob(const std::string& name = "") : ValueControl(name) { }
+
+    void draw(Canvas& canvas) override;
+
+  protected:
+    void drawValue(Canvas& canvas) override;
+    float dragAmount(const MouseEvent& e) const override {
+      return (dragStart().y - e.position.y) / kDragPixels;
+    }
+  };
+
+  class Slider : public ValueControl {
+  public:
+    explicit Slider(const std::string& name = "", bool vertical = false) :
+        ValueControl(name), vertical_(vertical) { }
+
+    void draw(Canvas& canvas) override;
+
+    void setVertical(bool vertical) {
+      vertical_ = vertical;
+      redrawAll();
+    }
+    bool vertical() const { return vertical_; }
+
+  protected:
+    void drawValue(Canvas& canvas) override;
+    float dragAmount(const MouseEvent& e) const override;
+
+  private:
+    float trackLength() const {
+      return std::max(1.0f, (vertical_ ? height() : width()) - thumbWidth());
+    }
+    float thumbWidth() const { return 2.0f * thickness(); }
+
+    bool vertical_ = false;
+  };
+}
@@ -26,6 +26,7 @@
 #include "visage_utils/time_utils.h"
 
 #include <emscripten/emscripten.h>
+#include <emscripten/eventloop.h>
 #include <emscripten/html5.h>
 #include <map>
 
@@ -175,10 +176,45 @@ namespace visage {
   }
 
   void WindowEmscripten::runLoopCallback() {
+    flushPendingMouseEvents();
+    long long ms_until_draw = msUntilDrawNeeded();
+    if (ms_until_draw != 0) {
+      suspendLoop(ms_until_draw);
+      return;
+    }
+
     long long delta = time::microseconds() - start_microseconds_;
     drawCallback(delta / 1000000.0);
   }
 
+  static void resumeLoop(void* user_data) {
+    static_cast<WindowEmscripten*>(user_data)->wakeDrawCallbacks();
+  }
+
+  void WindowEmscripten::suspendLoop(long long ms_until_draw) {
+    if (!loop_suspended_) {
+      loop_suspended_ = true;
+      emscripten_pause_main_loop();
+    }
+
+    if (resume_timeout_)
+      emscripten_clear_timeout(resume_timeout_);
+    double delay = ms_until_draw < 0 ? kMaxIdleMs : std::min(ms_until_draw, kMaxIdleMs);
+    resume_timeout_ = emscripten_set_timeout(resumeLoop, delay, this);
+  }
+
+  void WindowEmscripten::wakeDrawCallbacks() {
+    if (resume_timeout_) {
+      emscripten_clear_timeout(resume_timeout_);
+      resume_timeout_ = 0;
+    }
+
+    if (loop_suspended_) {
+      loop_suspended_ = false;
+      emscripten_resume_main_loop();
+    }
+  }
+
   WindowEmscripten* WindowEmscripten::running_instance_ = nullptr;
 
   WindowEmscripten::WindowEmscripten(int width, int height) :
@@ -243,6 +279,8 @@ namespace visage {
     if (event == nullptr || window == nullptr)
       return false;
 
+    window->wakeDrawCallbacks();
+
     float x = event->targetX - EM_ASM_DOUBLE({
                 var canvas = document.getElementById('canvas');
                 var rect = canvas.getBoundingClientRect();
@@ -281,6 +319,8 @@ namespace visage {
     if (event_type != EMSCRIPTEN_EVENT_WHEEL || window == nullptr)
       return true;
 
+    window->wakeDrawCallbacks();
+
     float delta_x = event->deltaX;
     float delta_y = -event->deltaY;
     if (event->deltaMode == DOM_DELTA_PIXEL) {
@@ -565,6 +605,7 @@ namespace visage {
     if (event == nullptr || window == nullptr)
       return false;
 
+    window->wakeDrawCallbacks();
     int modifier_state = keyboardModifiers(event);
     KeyCode code = translateKeyCode(event);
 
@@ -595,6 +636,7 @@ namespace visage {
     if (event == nullptr || window == nullptr)
       return false;
 
+    window->wakeDrawCallbacks();
     int new_width = event->windowInnerWidth;
     int new_height = event->windowInnerHeight;
     if (!window->maximized()) {
@@ -51,8 +51,11 @@ namespace visage {
 
     void handleWindowResize(int window_width, int window_height);
     void runLoopCallback();
+    void wakeDrawCallbacks() override;
 
   private:
+    void suspendLoop(long long ms_until_draw);
+
     int initial_width_ = 0;
     int initial_height_ = 0;
     float display_scale_ = 1.0f;
@@ -60,6 +63,8 @@ namespace visage {
     int mouse_x_ = 0;
     int mouse_y_ = 0;
     long long start_microseconds_ = 0;
+    bool loop_suspended_ = false;
+    long resume_timeout_ = 0;
   };
 }
 
@@ -549,6 +549,7 @@ namespace visage {
     x11_ = X11Connection::globalInstance();
 
     monitor_info_ = activeMonitorInfo();
+    setRefreshRate(monitor_info_.refresh_rate);
     X11Connection::DisplayLock lock(x11_);
     ::Display* display = x11_->display();
     IBounds bounds(x, y, width, height);
@@ -579,8 +580,17 @@ namespace visage {
   }
 
   static void threadTimerCallback(WindowX11* window) {
+    FramePacer pacer;
     while (window->timerThreadRunning()) {
-      Thread::sleep(window->timerMs());
+      if (pacer.interval() != window->timerMicroseconds())
+        pacer.setInterval(window->timerMicroseconds());
+
+      long long deadline = pacer.nextDeadline(time::microseconds());
+      long long wait = deadline - time::microseconds();
+      if (wait > 0)
+        std::this_thread::sleep_for(std::chrono::microseconds(wait));
+      if (window->tickSuppressed(deadline))
+        continue;
 
       X11Connection* x11 = window->x11Connection();
       X11Connection::DisplayLock lock(x11);
@@ -607,6 +617,7 @@ namespace visage {
     x11_ = plugin_x11_.get();
 
     monitor_info_ = activeMonitorInfo();
+    setRefreshRate(monitor_info_.refresh_rate);
     X11Connection::DisplayLock lock(x11_);
     ::Display* display = x11_->display();
 
@@ -638,16 +649,63 @@ namespace visage {
 
   WindowX11::~WindowX11() {
     NativeWindowLookup::instance().removeWindow(this);
+    stopTimerThread();
 
+    X11Connection::DisplayLock lock(x11_);
+    if (window_handle_)
+      XDestroyWindow(x11_->display(), window_handle_);
+  }
+
+  void WindowX11::stopTimerThread() {
     timer_thread_running_ = false;
     if (timer_thread_ && timer_thread_->joinable())
       timer_thread_->join();
 
     timer_thread_.reset();
+  }
 
-    X11Connection::DisplayLock lock(x11_);
-    if (window_handle_)
-      XDestroyWindow(x11_->display(), window_handle_);
+  void WindowX11::setRefreshRate(double refresh_rate) {
+    frame_pacer_.setRefreshRate(refresh_rate);
+    timer_microseconds_ = frame_pacer_.interval();
+  }
+
+  void WindowX11::pacedDrawCallback(long long microseconds, long long start_microseconds) {
+    frame_pacer_.tick(microseconds);
+    lateLatchDrawCallback((microseconds - start_microseconds) / 1000000.0, frame_pacer_.interval());
+    updateIdleDeadline();
+  }
+
+  static Bool isPendingInputEvent(Display*, XEvent* event, XPointer window) {
+    if (event->xany.window != *reinterpret_cast<::Window*>(window))
+      return False;
+
+    switch (event->type) {
+    case KeyPress:
+    case KeyRelease:
+    case ButtonPress:
+    case ButtonRelease:
+    case MotionNotify: return True;
+    default: return False;
+    }
+  }
+
+  void WindowX11::pumpInput() {
+    XEvent event;
+    while (true) {
+      {
+        X11Connection::DisplayLock lock(x11_);
+        if (!XCheckIfEvent(x11_->display(), &event, isPendingInputEvent,
+                           reinterpret_cast<XPointer>(&window_handle_)))
+          return;
+      }
+      processEvent(event);
+    }
+  }
+
+  void WindowX11::updateIdleDeadline() {
+    long long ms = msUntilDrawNeeded();
+    long long idle_ms = ms < 0 ? kMaxIdleMs : std::min(kMaxIdleMs, ms);
+    idle_until_us_ = time::microseconds() + idle_ms * 1000;
   }
 
   int WindowX11::resizeOperationForPosition(int x, int y) const {
@@ -1087,11 +1145,12 @@ namespace visage {
     XSendEvent(x11_->display(), receiver, False, NoEventMask, &message);
   }
 
-  void WindowX11::processPluginFdEvents() {
-    bool timer_fired = false;
+  bool WindowX11::processQueuedEvents(bool& timer_fired) {
+    bool had_events = false;
     XEvent event;
     while (XPending(x11_->display())) {
       XNextEvent(x11_->display(), &event);
+      had_events = true;
 
       if (event.xany.window == parent_handle_ && event.type == ConfigureNotify) {
         X11Connection::DisplayLock lock(x11_);
@@ -1100,16 +1159,56 @@ namespace visage {
         setNativeWindowSize(attributes.width, attributes.height);
       }
       else if (event.xany.window == window_handle_ && event.type == ClientMessage &&
-               event.xclient.message_type == x11_->timerEvent()) {
-        if (!timer_fired) {
-          timer_fired = true;
-          long long microseconds = time::microseconds() - start_draw_microseconds_;
-          drawCallback(microseconds / 1000000.0);
-        }
-      }
+               event.xclient.message_type == x11_->timerEvent())
+        timer_fired = true;
       else if (event.xany.window == window_handle_ || event.xany.window == parent_handle_)
         processEvent(event);
     }
+    return had_events;
+  }
+
+  void WindowX11::processPluginFdEvents() {
+    bool timer_fired = false;
+    processQueuedEvents(timer_fired);
+    if (timer_fired)
+      pacedDrawCallback(time::microseconds(), start_draw_microseconds_);
+    else
+      updateIdleDeadline();
+  }
+
+  long long WindowX11::nextWakeup() {
+    if (timer_thread_)
+      stopTimerThread();
+
+    long long now = time::microseconds();
+    if (next_tick_us_ == 0)
+      next_tick_us_ = frame_pacer_.nextDeadline(now);
+
+    {
+      X11Connection::DisplayLock lock(x11_);
+      if (XEventsQueued(x11_->display(), QueuedAlready))
+        return 0;
+    }
+
+    long long deadline = std::max(next_tick_us_, idle_until_us_.load());
+    return std::max(0LL, deadline - now);
+  }
+
+  void WindowX11::processPending() {
+    bool timer_fired = false;
+    bool had_events = processQueuedEvents(timer_fired);
+
+    long long now = time::microseconds();
+    if (now >= next_tick_us_) {
+      next_tick_us_ = frame_pacer_.nextDeadline(now);
+      if (!tickSuppressed(now)) {
+        pacedDrawCallback(now, start_draw_microseconds_);
+        return;
+      }
+    }
+
+    if (had_events)
+      updateIdleDeadline();
   }
 
   void WindowX11::processMessageWindowEvent(XEvent& event) {
@@ -1444,6 +1543,14 @@ namespace visage {
       }
       break;
     }
+    case VisibilityNotify: {
+      setVisible(event.xvisibility.state != VisibilityFullyObscured);
+      break;
+    }
+    case UnmapNotify: {
+      setVisible(false);
+      break;
+    }
     }
   }
 
@@ -1457,7 +1564,8 @@ namespace visage {
     unsigned int fd = ConnectionNumber(display);
 
     start_microseconds_ = time::microseconds();
-    long long last_timer_microseconds = start_microseconds_;
+    frame_pacer_.reset();
+    long long next_tick = frame_pacer_.nextDeadline(start_microseconds_);
 
     XEvent event;
     bool running = true;
@@ -1466,7 +1574,7 @@ namespace visage {
       FD_SET(fd, &read_fds);
 
       timeout.tv_sec = 0;
-      long long us_to_timer = timer_microseconds_ - (time::microseconds() - last_timer_microseconds);
+      long long us_to_timer = std::max(next_tick, idle_until_us_.load()) - time::microseconds();
       int result = 0;
       if (us_to_timer > 0) {
         timeout.tv_usec = us_to_timer;
@@ -1476,8 +1584,10 @@ namespace visage {
       if (result == -1)
         running = false;
 
+      bool had_events = false;
       while (running && XPending(x11_->display())) {
         XNextEvent(x11_->display(), &event);
+        had_events = true;
         WindowX11* window = NativeWindowLookup::instance().findWindow(event.xany.window);
         if (window == nullptr)
           continue;
@@ -1501,10 +1611,14 @@ namespace visage {
           window->processEvent(event);
       }
 
-      if (timer_microseconds_ - (time::microseconds() - last_timer_microseconds) <= 0) {
-        last_timer_microseconds = time::microseconds();
-        long long us_time = last_timer_microseconds - start_microseconds_;
-        drawCallback(us_time / 1000000.0);
+      if (had_events)
+        updateIdleDeadline();
+
+      long long now = time::microseconds();
+      if (now >= next_tick) {
+        next_tick = frame_pacer_.nextDeadline(now);
+        if (!tickSuppressed(now))
+          pacedDrawCallback(now, start_microseconds_);
       }
     }
   }
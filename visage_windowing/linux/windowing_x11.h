@@ -23,6 +23,7 @@
 
 #if VISAGE_LINUX
 #include "visage_utils/string_utils.h"
+#include "visage_utils/time_utils.h"
 #include "windowing.h"
 
 #include <atomic>
@@ -214,6 +215,8 @@ namespace visage {
 
     void runEventLoop() override;
     void processPluginFdEvents() override;
+    long long nextWakeup() override;
+    void processPending() override;
     void processMessageWindowEvent(XEvent& event);
     void processEvent(XEvent& event);
 
@@ -232,13 +235,20 @@ namespace visage {
     void close() override;
     bool isShowing() const override;
     void setFixedAspectRatio(bool fixed) override;
+    void wakeDrawCallbacks() override { idle_until_us_ = 0; }
+    void pumpInput() override;
 
     void setWindowTitle(const std::string& title) override;
     IPoint maxWindowDimensions() const override;
     MonitorInfo monitorInfo() { return monitor_info_; }
     X11Connection* x11Connection() { return x11_; }
     bool timerThreadRunning() { return timer_thread_running_.load(); }
-    int timerMs() const { return timer_microseconds_.load() / 1000; }
+    long long timerMicroseconds() const { return timer_microseconds_.load(); }
+    bool tickSuppressed(long long microseconds) const {
+      return microseconds < idle_until_us_.load();
+    }
+    // Tick-to-tick timing of the draw callbacks that actually ran.
+    const FramePacer& framePacer() const { return frame_pacer_; }
 
   private:
     static WindowX11* last_active_window_;
@@ -251,6 +261,11 @@ namespace visage {
     ::Window parentHandle() const { return parent_handle_; }
 
     void createWindow(IBounds bounds);
+    void setRefreshRate(double refresh_rate);
+    void pacedDrawCallback(long long microseconds, long long start_microseconds);
+    void updateIdleDeadline();
+    bool processQueuedEvents(bool& timer_fired);
+    void stopTimerThread();
     IPoint retrieveWindowDimensions();
     void passEventToParent(XEvent& event);
     int mouseButtonState() const;
@@ -286,7 +301,10 @@ namespace visage {
     ::Window parent_handle_ = 0;
     std::map<KeySym, bool> pressed_;
     long long start_microseconds_ = 0;
-    std::atomic<long long> timer_microseconds_ = 16667;
+    std::atomic<long long> timer_microseconds_ = FramePacer::kDefaultIntervalUs;
+    std::atomic<long long> idle_until_us_ = 0;
+    long long next_tick_us_ = 0;
+    FramePacer frame_pacer_;
     std::atomic<bool> timer_thread_running_ = false;
     std::unique_ptr<std::thread> timer_thread_;
   };
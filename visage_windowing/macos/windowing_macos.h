@@ -42,6 +42,7 @@ namespace visage {
 @property NSPoint mouse_down_screen_position;
 
 - (instancetype)initWithFrame:(NSRect)frame_rect inWindow:(visage::WindowMac*)window;
+- (void)resumeDisplayLink;
 @end
 
 @interface VisageAppWindowDelegate : NSObject <NSWindowDelegate>
@@ -80,6 +81,7 @@ namespace visage {
     void hide() final;
     void close() final;
     bool isShowing() const override;
+    void wakeDrawCallbacks() override;
 
     void setWindowTitle(const std::string& title) override;
     IPoint maxWindowDimensions() const override;
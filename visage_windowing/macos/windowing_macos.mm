@@ -25,6 +25,7 @@
 #include "visage_utils/file_system.h"
 #include "visage_utils/time_utils.h"
 
+#include <algorithm>
 #include <map>
 #include <atomic>
 #include <cstdarg>
@@ -348,7 +349,8 @@ namespace visage {
   NSTrackingArea* trackingArea;
   uint64_t last_display_log_us;
   uint64_t last_draw_log_us;
-  uint64_t last_render_us;  // Frame throttling: track last actual render
+  std::atomic<bool> display_pending;
+  BOOL display_link_paused;
   uint64_t display_count;
   uint64_t draw_count;
 }
@@ -362,7 +364,8 @@ namespace visage {
   trackingArea = nil;
   last_display_log_us = 0;
   last_draw_log_us = 0;
-  last_render_us = 0;
+  display_pending = false;
+  display_link_paused = NO;
   display_count = 0;
   draw_count = 0;
 
@@ -427,31 +430,58 @@ static CVReturn DisplayLinkCallback(CVDisplayLinkRef displayLink, const CVTimeSt
                                     const CVTimeStamp* outputTime, CVOptionFlags flagsIn,
                                     CVOptionFlags* flagsOut, void* displayLinkContext) {
   VisageAppView* view = (__bridge VisageAppView*)displayLinkContext;
+  [view displayLinkFired];
+  return kCVReturnSuccess;
+}
+
+// Called on the CVDisplayLink thread. At most one main queue block is in flight per view, so
+// ticks arriving while the main thread is busy are dropped instead of queueing up.
+- (void)displayLinkFired {
+  if (display_pending.exchange(true))
+    return;
+
   dispatch_async(dispatch_get_main_queue(), ^{
-    [view markNeedsDisplayFromDisplayLink];
+    display_pending = false;
+    [self markNeedsDisplayFromDisplayLink];
   });
-  return kCVReturnSuccess;
+}
+
+// Stops the display link while nothing needs drawing. It restarts when the contents request a
+// draw, or after a delay so timers and work posted from other threads still get serviced.
+- (void)pauseDisplayLink:(long long)ms_until_draw {
+  static constexpr long long kMaxIdleMs = visage::Window::kMaxIdleMs;
+
+  if (!display_link_paused) {
+    display_link_paused = YES;
+    CVDisplayLinkStop(displayLink);
+  }
+
+  long long delay_ms = ms_until_draw < 0 ? kMaxIdleMs : std::min(ms_until_draw, kMaxIdleMs);
+  __weak VisageAppView* weak_self = self;
+  dispatch_time_t wake_time = dispatch_time(DISPATCH_TIME_NOW, delay_ms * NSEC_PER_MSEC);
+  dispatch_after(wake_time, dispatch_get_main_queue(), ^{
+    [weak_self resumeDisplayLink];
+  });
+}
+
+- (void)resumeDisplayLink {
+  if (!display_link_paused)
+    return;
+
+  display_link_paused = NO;
+  CVDisplayLinkStart(displayLink);
 }
 
 // Triggered by CVDisplayLink on the main thread.
-// Frame throttling: limit effective frame rate to ~30Hz to avoid overwhelming
-// the JUCE message pump. CVDisplayLink fires at 60Hz+ but our UI only needs 30Hz.
 - (void)markNeedsDisplayFromDisplayLink {
   CAMetalLayer* metalLayer = (CAMetalLayer*)self.layer;
   display_count++;
 
-  // Throttling removed to allow 60Hz smooth rendering.
-  // The 'presentsWithTransaction = NO' fix resolves the main thread blocking issue,
-  // so we can now safely render at the native DisplayLink rate.
-  /*
-  // Frame throttling: skip if less than 30ms since last render (cap at ~33Hz)
-  // This prevents CVDisplayLink from flooding the main queue at 60Hz
-  static constexpr uint64_t kMinFrameIntervalUs = 30000;  // 30ms = ~33Hz
-  const uint64_t now_us = visage::time::microseconds();
-  if (last_render_us > 0 && (now_us - last_render_us) < kMinFrameIntervalUs) {
-    return;  // Skip this frame - too soon since last render
+  long long ms_until_draw = self.visage_window ? self.visage_window->msUntilDrawNeeded() : 0;
+  if (ms_until_draw != 0) {
+    [self pauseDisplayLink:ms_until_draw];
+    return;
   }
-  */
 
   if (visageDebugEnabled() && shouldLogEvery(last_display_log_us, 1000000)) {
     const CGSize bounds_size = self.bounds.size;
@@ -484,9 +514,6 @@ static CVReturn DisplayLinkCallback(CVDisplayLinkRef displayLink, const CVTimeSt
   const uint64_t end_us = visage::time::microseconds();
   const uint64_t duration_us = end_us - start_us;
 
-  // Update last render time for frame throttling
-  last_render_us = end_us;
-
   if (visageDebugEnabled() && (duration_us > 12000 || shouldLogEvery(last_draw_log_us, 1000000))) {
     const CGSize bounds_size = self.bounds.size;
     CAMetalLayer* metalLayer = (CAMetalLayer*)self.layer;
@@ -656,6 +683,12 @@ static CVReturn DisplayLinkCallback(CVDisplayLinkRef displayLink, const CVTimeSt
 - (void)cancelOperation:(id)sender {
 }
 
+// NSEvent timestamps count seconds since boot, measured against the same clock as systemUptime.
+- (long long)eventTimeUs:(NSEvent*)event {
+  NSTimeInterval age = [[NSProcessInfo processInfo] systemUptime] - [event timestamp];
+  return visage::time::microseconds() - std::max<long long>(0, std::llround(age * 1000000.0));
+}
+
 - (visage::Point)eventPosition:(NSEvent*)event {
   NSPoint location = [event locationInWindow];
   NSPoint view_location = [self convertPoint:location fromView:nil];
@@ -756,7 +789,7 @@ static CVReturn DisplayLinkCallback(CVDisplayLinkRef displayLink, const CVTimeSt
       visageDebugLog("mouseMoved", "point=%.1f,%.1f", point.x, point.y);
   }
   self.visage_window->handleMouseMove(point.x, point.y, [self mouseButtonState],
-                                      [self keyboardModifiers:event]);
+                                      [self keyboardModifiers:event], [self eventTimeUs:event]);
 }
 
 - (void)mouseEntered:(NSEvent*)event {
@@ -812,7 +845,7 @@ static CVReturn DisplayLinkCallback(CVDisplayLinkRef displayLink, const CVTimeSt
 - (void)mouseDragged:(NSEvent*)event {
   visage::Point point = [self eventPosition:event];
   self.visage_window->handleMouseMove(point.x, point.y, [self mouseButtonState],
-                                      [self keyboardModifiers:event]);
+                                      [self keyboardModifiers:event], [self eventTimeUs:event]);
   [self checkRelativeMode];
 }
 
@@ -833,7 +866,7 @@ static CVReturn DisplayLinkCallback(CVDisplayLinkRef displayLink, const CVTimeSt
 - (void)rightMouseDragged:(NSEvent*)event {
   visage::Point point = [self eventPosition:event];
   self.visage_window->handleMouseMove(point.x, point.y, [self mouseButtonState],
-                                      [self keyboardModifiers:event]);
+                                      [self keyboardModifiers:event], [self eventTimeUs:event]);
   [self checkRelativeMode];
 }
 
@@ -860,7 +893,7 @@ static CVReturn DisplayLinkCallback(CVDisplayLinkRef displayLink, const CVTimeSt
 - (void)otherMouseDragged:(NSEvent*)event {
   visage::Point point = [self eventPosition:event];
   self.visage_window->handleMouseMove(point.x, point.y, [self mouseButtonState],
-                                      [self keyboardModifiers:event]);
+                                      [self keyboardModifiers:event], [self eventTimeUs:event]);
   [self checkRelativeMode];
 }
 
@@ -1165,6 +1198,10 @@ namespace visage {
     NativeWindowLookup::instance().addWindow(this);
   }
 
+  void WindowMac::wakeDrawCallbacks() {
+    [view_ resumeDisplayLink];
+  }
+
   WindowMac::~WindowMac() {
     NativeWindowLookup::instance().removeWindow(this);
     hide();
@@ -0,0 +1,1430 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#if VISAGE_LINUX && VISAGE_WAYLAND
+#include "windowing_wayland.h"
+
+#include "fractional-scale-v1-client-protocol.h"
+#include "presentation-time-client-protocol.h"
+#include "viewporter-client-protocol.h"
+#include "visage_utils/string_utils.h"
+#include "xdg-decoration-unstable-v1-client-protocol.h"
+#include "xdg-shell-client-protocol.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/input-event-codes.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#include <wayland-cursor.h>
+
+namespace visage {
+  static constexpr const char* kTextMimeTypes[] = { "text/plain;charset=utf-8", "text/plain",
+                                                    "UTF8_STRING" };
+  static constexpr const char* kUriListMimeType = "text/uri-list";
+  static constexpr int kCursorSize = 24;
+  static constexpr double kWheelStep = 10.0;
+  static constexpr int kReceiveTimeoutMs = 1000;
+  static constexpr int kXkbKeycodeOffset = 8;
+
+  class WaylandWindowLookup {
+  public:
+    static WaylandWindowLookup& instance() {
+      static WaylandWindowLookup instance;
+      return instance;
+    }
+
+    void addWindow(WindowWayland* window) { windows_.insert(window); }
+    void removeWindow(WindowWayland* window) { windows_.erase(window); }
+
+    bool anyWindowOpen() const {
+      for (WindowWayland* window : windows_) {
+        if (window->isShowing())
+          return true;
+      }
+      return false;
+    }
+
+    void closeAll() const {
+      auto windows = windows_;
+      for (WindowWayland* window : windows)
+        window->close();
+    }
+
+  private:
+    WaylandWindowLookup() = default;
+    ~WaylandWindowLookup() = default;
+
+    std::set<WindowWayland*> windows_;
+  };
+
+  static KeyCode translateKeyCode(xkb_keysym_t keysym) {
+    keysym = xkb_keysym_to_lower(keysym);
+    bool letter = keysym >= XKB_KEY_a && keysym <= XKB_KEY_z;
+    if (letter || (keysym >= XKB_KEY_0 && keysym <= XKB_KEY_9))
+      return static_cast<KeyCode>(keysym);
+
+    switch (keysym) {
+    case XKB_KEY_Return: return KeyCode::Return;
+    case XKB_KEY_Escape: return KeyCode::Escape;
+    case XKB_KEY_BackSpace: return KeyCode::Backspace;
+    case XKB_KEY_Tab:
+    case XKB_KEY_ISO_Left_Tab: return KeyCode::Tab;
+    case XKB_KEY_space: return KeyCode::Space;
+    case XKB_KEY_minus: return KeyCode::Minus;
+    case XKB_KEY_equal: return KeyCode::Equals;
+    case XKB_KEY_bracketleft: return KeyCode::LeftBracket;
+    case XKB_KEY_bracketright: return KeyCode::RightBracket;
+    case XKB_KEY_backslash: return KeyCode::Backslash;
+    case XKB_KEY_semicolon: return KeyCode::Semicolon;
+    case XKB_KEY_apostrophe: return KeyCode::Apostrophe;
+    case XKB_KEY_grave: return KeyCode::Grave;
+    case XKB_KEY_comma: return KeyCode::Comma;
+    case XKB_KEY_period: return KeyCode::Period;
+    case XKB_KEY_slash: return KeyCode::Slash;
+    case XKB_KEY_Caps_Lock: return KeyCode::CapsLock;
+    case XKB_KEY_F1: return KeyCode::F1;
+    case XKB_KEY_F2: return KeyCode::F2;
+    case XKB_KEY_F3: return KeyCode::F3;
+    case XKB_KEY_F4: return KeyCode::F4;
+    case XKB_KEY_F5: return KeyCode::F5;
+    case XKB_KEY_F6: return KeyCode::F6;
+    case XKB_KEY_F7: return KeyCode::F7;
+    case XKB_KEY_F8: return KeyCode::F8;
+    case XKB_KEY_F9: return KeyCode::F9;
+    case XKB_KEY_F10: return KeyCode::F10;
+    case XKB_KEY_F11: return KeyCode::F11;
+    case XKB_KEY_F12: return KeyCode::F12;
+    case XKB_KEY_Print: return KeyCode::PrintScreen;
+    case XKB_KEY_Scroll_Lock: return KeyCode::ScrollLock;
+    case XKB_KEY_Pause: return KeyCode::Pause;
+    case XKB_KEY_Insert: return KeyCode::Insert;
+    case XKB_KEY_Home: return KeyCode::Home;
+    case XKB_KEY_Page_Up: return KeyCode::PageUp;
+    case XKB_KEY_Delete: return KeyCode::Delete;
+    case XKB_KEY_End: return KeyCode::End;
+    case XKB_KEY_Page_Down: return KeyCode::PageDown;
+    case XKB_KEY_Right: return KeyCode::Right;
+    case XKB_KEY_Left: return KeyCode::Left;
+    case XKB_KEY_Down: return KeyCode::Down;
+    case XKB_KEY_Up: return KeyCode::Up;
+    case XKB_KEY_Num_Lock: return KeyCode::NumLock;
+    case XKB_KEY_KP_Divide: return KeyCode::KPDivide;
+    case XKB_KEY_KP_Multiply: return KeyCode::KPMultiply;
+    case XKB_KEY_KP_Subtract: return KeyCode::KPMinus;
+    case XKB_KEY_KP_Add: return KeyCode::KPPlus;
+    case XKB_KEY_KP_Enter: return KeyCode::KPEnter;
+    case XKB_KEY_KP_1: return KeyCode::KP1;
+    case XKB_KEY_KP_2: return KeyCode::KP2;
+    case XKB_KEY_KP_3: return KeyCode::KP3;
+    case XKB_KEY_KP_4: return KeyCode::KP4;
+    case XKB_KEY_KP_5: return KeyCode::KP5;
+    case XKB_KEY_KP_6: return KeyCode::KP6;
+    case XKB_KEY_KP_7: return KeyCode::KP7;
+    case XKB_KEY_KP_8: return KeyCode::KP8;
+    case XKB_KEY_KP_9: return KeyCode::KP9;
+    case XKB_KEY_KP_0: return KeyCode::KP0;
+    case XKB_KEY_KP_Decimal: return KeyCode::KPPeriod;
+    default: return KeyCode::Unknown;
+    }
+  }
+
+  static const char* cursorName(MouseCursor style) {
+    switch (style) {
+    case MouseCursor::IBeam: return "xterm";
+    case MouseCursor::Crosshair: return "crosshair";
+    case MouseCursor::Pointing: return "hand2";
+    case MouseCursor::HorizontalResize: return "sb_h_double_arrow";
+    case MouseCursor::VerticalResize: return "sb_v_double_arrow";
+    case MouseCursor::TopLeftResize: return "top_left_corner";
+    case MouseCursor::TopRightResize: return "top_right_corner";
+    case MouseCursor::BottomLeftResize: return "bottom_left_corner";
+    case MouseCursor::BottomRightResize: return "bottom_right_corner";
+    case MouseCursor::Dragging:
+    case MouseCursor::MultiDirectionalResize: return "fleur";
+    default: return "left_ptr";
+    }
+  }
+
+  static MouseCursor resizeEdgesCursor(int edges) {
+    switch (edges) {
+    case XDG_TOPLEVEL_RESIZE_EDGE_TOP_LEFT: return MouseCursor::TopLeftResize;
+    case XDG_TOPLEVEL_RESIZE_EDGE_TOP_RIGHT: return MouseCursor::TopRightResize;
+    case XDG_TOPLEVEL_RESIZE_EDGE_BOTTOM_LEFT: return MouseCursor::BottomLeftResize;
+    case XDG_TOPLEVEL_RESIZE_EDGE_BOTTOM_RIGHT: return MouseCursor::BottomRightResize;
+    case XDG_TOPLEVEL_RESIZE_EDGE_LEFT:
+    case XDG_TOPLEVEL_RESIZE_EDGE_RIGHT: return MouseCursor::HorizontalResize;
+    case XDG_TOPLEVEL_RESIZE_EDGE_TOP:
+    case XDG_TOPLEVEL_RESIZE_EDGE_BOTTOM: return MouseCursor::VerticalResize;
+    default: return MouseCursor::Arrow;
+    }
+  }
+
+  WaylandConnection::WaylandConnection() {
+    static const wl_registry_listener kRegistryListener = { registryGlobal, registryGlobalRemove };
+
+    display_ = wl_display_connect(nullptr);
+    if (display_ == nullptr) {
+      VISAGE_LOG("Unable to connect to the Wayland display");
+      return;
+    }
+
+    xkb_context_ = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
+    registry_ = wl_display_get_registry(display_);
+    wl_registry_add_listener(registry_, &kRegistryListener, this);
+    wl_display_roundtrip(display_);
+
+    if (data_device_manager_ && seat_) {
+      static const wl_data_device_listener kDataDeviceListener = {
+        dataOffer, dataEnter, dataLeave, dataMotion, dataDrop, dataSelection
+      };
+      data_device_ = wl_data_device_manager_get_data_device(data_device_manager_, seat_);
+      wl_data_device_add_listener(data_device_, &kDataDeviceListener, this);
+    }
+    wl_display_roundtrip(display_);
+  }
+
+  WaylandConnection::~WaylandConnection() {
+    if (display_ == nullptr)
+      return;
+
+    if (cursor_theme_)
+      wl_cursor_theme_destroy(cursor_theme_);
+    if (cursor_surface_)
+      wl_surface_destroy(cursor_surface_);
+    if (xkb_state_)
+      xkb_state_unref(xkb_state_);
+    if (xkb_keymap_)
+      xkb_keymap_unref(xkb_keymap_);
+    xkb_context_unref(xkb_context_);
+    wl_display_disconnect(display_);
+  }
+
+  void WaylandConnection::registryGlobal(void* data, wl_registry* registry, uint32_t name,
+                                         const char* interface, uint32_t version) {
+    static const xdg_wm_base_listener kWmBaseListener = { wmBasePing };
+    static const wl_seat_listener kSeatListener = { seatCapabilities, seatName };
+    static const wl_output_listener kOutputListener = { outputGeometry, outputMode, outputDone,
+                                                        outputScale };
+
+    auto connection = static_cast<WaylandConnection*>(data);
+    auto bind = [registry, name, version](const wl_interface* type, uint32_t max_version) {
+      return wl_registry_bind(registry, name, type, std::min(version, max_version));
+    };
+
+    if (strcmp(interface, wl_compositor_interface.name) == 0)
+      connection->compositor_ = static_cast<wl_compositor*>(bind(&wl_compositor_interface, 4));
+    else if (strcmp(interface, wl_shm_interface.name) == 0)
+      connection->shm_ = static_cast<wl_shm*>(bind(&wl_shm_interface, 1));
+    else if (strcmp(interface, xdg_wm_base_interface.name) == 0) {
+      connection->wm_base_ = static_cast<xdg_wm_base*>(bind(&xdg_wm_base_interface, 2));
+      xdg_wm_base_add_listener(connection->wm_base_, &kWmBaseListener, connection);
+    }
+    else if (strcmp(interface, wl_seat_interface.name) == 0 && connection->seat_ == nullptr) {
+      connection->seat_ = static_cast<wl_seat*>(bind(&wl_seat_interface, 5));
+      wl_seat_add_listener(connection->seat_, &kSeatListener, connection);
+    }
+    else if (strcmp(interface, wl_output_interface.name) == 0) {
+      Output output;
+      output.name = name;
+      output.output = static_cast<wl_output*>(bind(&wl_output_interface, 2));
+      wl_output_add_listener(output.output, &kOutputListener, connection);
+      connection->outputs_.push_back(output);
+    }
+    else if (strcmp(interface, wl_data_device_manager_interface.name) == 0) {
+      connection->data_device_manager_ = static_cast<wl_data_device_manager*>(
+          bind(&wl_data_device_manager_interface, 3));
+    }
+    else if (strcmp(interface, wp_presentation_interface.name) == 0) {
+      connection->presentation_ = static_cast<wp_presentation*>(
+          bind(&wp_presentation_interface, 1));
+    }
+    else if (strcmp(interface, wp_viewporter_interface.name) == 0)
+      connection->viewporter_ = static_cast<wp_viewporter*>(bind(&wp_viewporter_interface, 1));
+    else if (strcmp(interface, wp_fractional_scale_manager_v1_interface.name) == 0) {
+      connection->fractional_scale_manager_ = static_cast<wp_fractional_scale_manager_v1*>(
+          bind(&wp_fractional_scale_manager_v1_interface, 1));
+    }
+    else if (strcmp(interface, zxdg_decoration_manager_v1_interface.name) == 0) {
+      connection->decoration_manager_ = static_cast<zxdg_decoration_manager_v1*>(
+          bind(&zxdg_decoration_manager_v1_interface, 1));
+    }
+  }
+
+  void WaylandConnection::registryGlobalRemove(void* data, wl_registry* registry, uint32_t name) {
+    auto connection = static_cast<WaylandConnection*>(data);
+    auto& outputs = connection->outputs_;
+    for (auto it = outputs.begin(); it != outputs.end(); ++it) {
+      if (it->name == name) {
+        wl_output_destroy(it->output);
+        outputs.erase(it);
+        return;
+      }
+    }
+  }
+
+  void WaylandConnection::wmBasePing(void* data, xdg_wm_base* wm_base, uint32_t serial) {
+    xdg_wm_base_pong(wm_base, serial);
+  }
+
+  void WaylandConnection::seatCapabilities(void* data, wl_seat* seat, uint32_t capabilities) {
+    static const wl_pointer_listener kPointerListener = {
+      pointerEnter, pointerLeave,      pointerMotion,   pointerButton,      pointerAxis,
+      pointerFrame, pointerAxisSource, pointerAxisStop, pointerAxisDiscrete
+    };
+    static const wl_keyboard_listener kKeyboardListener = { keyboardKeymap, keyboardEnter,
+                                                            keyboardLeave,  keyboardKey,
+                                                            keyboardModifiers, keyboardRepeatInfo };
+
+    auto connection = static_cast<WaylandConnection*>(data);
+    bool has_pointer = capabilities & WL_SEAT_CAPABILITY_POINTER;
+    if (has_pointer && connection->pointer_ == nullptr) {
+      connection->pointer_ = wl_seat_get_pointer(seat);
+      wl_pointer_add_listener(connection->pointer_, &kPointerListener, connection);
+    }
+    else if (!has_pointer && connection->pointer_) {
+      wl_pointer_release(connection->pointer_);
+      connection->pointer_ = nullptr;
+      connection->pointer_focus_ = nullptr;
+    }
+
+    bool has_keyboard = capabilities & WL_SEAT_CAPABILITY_KEYBOARD;
+    if (has_keyboard && connection->keyboard_ == nullptr) {
+      connection->keyboard_ = wl_seat_get_keyboard(seat);
+      wl_keyboard_add_listener(connection->keyboard_, &kKeyboardListener, connection);
+    }
+    else if (!has_keyboard && connection->keyboard_) {
+      wl_keyboard_release(connection->keyboard_);
+      connection->keyboard_ = nullptr;
+      connection->keyboard_focus_ = nullptr;
+      connection->repeat_key_ = 0;
+    }
+  }
+
+  WaylandConnection::Output* WaylandConnection::findOutput(wl_output* output) {
+    for (Output& entry : outputs_) {
+      if (entry.output == output)
+        return &entry;
+    }
+    return nullptr;
+  }
+
+  void WaylandConnection::outputGeometry(void* data, wl_output* output, int32_t x, int32_t y,
+                                         int32_t physical_width, int32_t physical_height,
+                                         int32_t subpixel, const char* make, const char* model,
+                                         int32_t transform) {
+    if (Output* entry = static_cast<WaylandConnection*>(data)->findOutput(output)) {
+      IBounds& bounds = entry->info.bounds;
+      bounds = { x, y, bounds.width(), bounds.height() };
+    }
+  }
+
+  void WaylandConnection::outputMode(void* data, wl_output* output, uint32_t flags, int32_t width,
+                                     int32_t height, int32_t refresh) {
+    Output* entry = static_cast<WaylandConnection*>(data)->findOutput(output);
+    if (entry == nullptr || (flags & WL_OUTPUT_MODE_CURRENT) == 0)
+      return;
+
+    IBounds& bounds = entry->info.bounds;
+    bounds = { bounds.x(), bounds.y(), width, height };
+    if (refresh > 0)
+      entry->info.refresh_rate = refresh / 1000.0;
+  }
+
+  void WaylandConnection::outputScale(void* data, wl_output* output, int32_t factor) {
+    if (Output* entry = static_cast<WaylandConnection*>(data)->findOutput(output))
+      entry->info.scale = std::max(1, factor);
+  }
+
+  MonitorInfo WaylandConnection::monitorInfo(wl_output* output) const {
+    for (const Output& entry : outputs_) {
+      if (entry.output == output)
+        return entry.info;
+    }
+    return activeMonitorInfo();
+  }
+
+  MonitorInfo WaylandConnection::activeMonitorInfo() const {
+    WindowWayland* window = WindowWayland::lastActiveWindow();
+    if (window) {
+      for (const Output& entry : outputs_) {
+        if (entry.output == window->output())
+          return entry.info;
+      }
+    }
+    if (!outputs_.empty())
+      return outputs_.front().info;
+
+    MonitorInfo result;
+    result.bounds = { 0, 0, MonitorInfo::kDefaultWidth, MonitorInfo::kDefaultHeight };
+    return result;
+  }
+
+  IPoint WaylandConnection::nativePosition(wl_fixed_t x, wl_fixed_t y) const {
+    float scale = pointer_focus_ ? pointer_focus_->scale() : 1.0f;
+    return { static_cast<int>(std::round(wl_fixed_to_double(x) * scale)),
+             static_cast<int>(std::round(wl_fixed_to_double(y) * scale)) };
+  }
+
+  void WaylandConnection::pointerEnter(void* data, wl_pointer* pointer, uint32_t serial,
+                                       wl_surface* surface, wl_fixed_t x, wl_fixed_t y) {
+    auto connection = static_cast<WaylandConnection*>(data);
+    connection->pointer_serial_ = serial;
+    connection->pointer_focus_ = WindowWayland::fromSurface(surface);
+    if (connection->pointer_focus_ == nullptr)
+      return;
+
+    connection->pointer_position_ = connection->nativePosition(x, y);
+    connection->applied_cursor_serial_ = 0;
+    connection->setCursorStyle(connection->cursor_style_);
+    connection->pointer_focus_->handleMouseEnter(connection->pointer_position_.x,
+                                                 connection->pointer_position_.y);
+  }
+
+  void WaylandConnection::pointerLeave(void* data, wl_pointer* pointer, uint32_t serial,
+                                       wl_surface* surface) {
+    auto connection = static_cast<WaylandConnection*>(data);
+    if (connection->pointer_focus_)
+      connection->pointer_focus_->handleMouseLeave(connection->button_state_,
+                                                   connection->modifierState());
+    connection->pointer_focus_ = nullptr;
+  }
+
+  void WaylandConnection::pointerMotion(void* data, wl_pointer* pointer, uint32_t time,
+                                        wl_fixed_t x, wl_fixed_t y) {
+    auto connection = static_cast<WaylandConnection*>(data);
+    if (connection->pointer_focus_ == nullptr)
+      return;
+
+    connection->pointer_position_ = connection->nativePosition(x, y);
+    connection->pointer_focus_->handlePointerMotion(connection->pointer_position_);
+  }
+
+  void WaylandConnection::pointerButton(void* data, wl_pointer* pointer, uint32_t serial,
+                                        uint32_t time, uint32_t button, uint32_t state) {
+    auto connection = static_cast<WaylandConnection*>(data);
+    connection->last_serial_ = serial;
+
+    MouseButton mouse_button = kMouseButtonNone;
+    if (button == BTN_LEFT)
+      mouse_button = kMouseButtonLeft;
+    else if (button == BTN_MIDDLE)
+      mouse_button = kMouseButtonMiddle;
+    else if (button == BTN_RIGHT)
+      mouse_button = kMouseButtonRight;
+    if (mouse_button == kMouseButtonNone)
+      return;
+
+    bool pressed = state == WL_POINTER_BUTTON_STATE_PRESSED;
+    if (pressed)
+      connection->button_state_ |= mouse_button;
+    else
+      connection->button_state_ &= ~mouse_button;
+
+    if (connection->pointer_focus_) {
+      connection->pointer_focus_->handlePointerButton(mouse_button, pressed,
+                                                      connection->pointer_position_, serial);
+    }
+  }
+
+  void WaylandConnection::pointerAxis(void* data, wl_pointer* pointer, uint32_t time,
+                                      uint32_t axis, wl_fixed_t value) {
+    auto connection = static_cast<WaylandConnection*>(data);
+    float delta = -wl_fixed_to_double(value) / kWheelStep;
+    if (axis == WL_POINTER_AXIS_VERTICAL_SCROLL)
+      connection->pointer_precise_wheel_.y += delta;
+    else
+      connection->pointer_precise_wheel_.x += delta;
+
+    if (wl_pointer_get_version(pointer) < WL_POINTER_FRAME_SINCE_VERSION)
+      pointerFrame(data, pointer);
+  }
+
+  void WaylandConnection::pointerAxisSource(void* data, wl_pointer* pointer, uint32_t source) {
+    auto connection = static_cast<WaylandConnection*>(data);
+    connection->pointer_wheel_finger_ = source == WL_POINTER_AXIS_SOURCE_FINGER;
+  }
+
+  void WaylandConnection::pointerAxisDiscrete(void* data, wl_pointer* pointer, uint32_t axis,
+                                              int32_t discrete) {
+    auto connection = static_cast<WaylandConnection*>(data);
+    connection->pointer_wheel_discrete_ = true;
+    if (axis == WL_POINTER_AXIS_VERTICAL_SCROLL)
+      connection->pointer_wheel_.y -= discrete;
+    else
+      connection->pointer_wheel_.x -= discrete;
+  }
+
+  void WaylandConnection::pointerFrame(void* data, wl_pointer* pointer) {
+    auto connection = static_cast<WaylandConnection*>(data);
+    Point precise = connection->pointer_precise_wheel_;
+    Point delta = connection->pointer_wheel_discrete_ ? Point(connection->pointer_wheel_) : precise;
+    connection->pointer_precise_wheel_ = {};
+    connection->pointer_wheel_ = {};
+    connection->pointer_wheel_discrete_ = false;
+    connection->pointer_wheel_finger_ = false;
+
+    WindowWayland* window = connection->pointer_focus_;
+    if (window == nullptr || (precise.x == 0.0f && precise.y == 0.0f && delta.x == 0.0f &&
+                              delta.y == 0.0f))
+      return;
+
+    IPoint position = connection->pointer_position_;
+    window->handleMouseWheel(delta.x, delta.y, precise.x, precise.y, position.x, position.y,
+                             connection->button_state_, connection->modifierState());
+  }
+
+  void WaylandConnection::keyboardKeymap(void* data, wl_keyboard* keyboard, uint32_t format,
+                                         int32_t fd, uint32_t size) {
+    auto connection = static_cast<WaylandConnection*>(data);
+    if (format != WL_KEYBOARD_KEYMAP_FORMAT_XKB_V1) {
+      close(fd);
+      return;
+    }
+
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+      return;
+
+    xkb_keymap* keymap = xkb_keymap_new_from_string(connection->xkb_context_,
+                                                    static_cast<const char*>(map),
+                                                    XKB_KEYMAP_FORMAT_TEXT_V1,
+                                                    XKB_KEYMAP_COMPILE_NO_FLAGS);
+    munmap(map, size);
+    if (keymap == nullptr)
+      return;
+
+    if (connection->xkb_state_)
+      xkb_state_unref(connection->xkb_state_);
+    if (connection->xkb_keymap_)
+      xkb_keymap_unref(connection->xkb_keymap_);
+    connection->xkb_keymap_ = keymap;
+    connection->xkb_state_ = xkb_state_new(keymap);
+  }
+
+  void WaylandConnection::keyboardEnter(void* data, wl_keyboard* keyboard, uint32_t serial,
+                                        wl_surface* surface, wl_array* keys) {
+    auto connection = static_cast<WaylandConnection*>(data);
+    connection->last_serial_ = serial;
+    connection->keyboard_focus_ = WindowWayland::fromSurface(surface);
+    if (connection->keyboard_focus_)
+      connection->keyboard_focus_->handleFocusGained();
+  }
+
+  void WaylandConnection::keyboardLeave(void* data, wl_keyboard* keyboard, uint32_t serial,
+                                        wl_surface* surface) {
+    auto connection = static_cast<WaylandConnection*>(data);
+    if (connection->keyboard_focus_)
+      connection->keyboard_focus_->handleFocusLost();
+    connection->keyboard_focus_ = nullptr;
+    connection->repeat_key_ = 0;
+  }
+
+  void WaylandConnection::keyboardKey(void* data, wl_keyboard* keyboard, uint32_t serial,
+                                      uint32_t time, uint32_t key, uint32_t state) {
+    auto connection = static_cast<WaylandConnection*>(data);
+    connection->last_serial_ = serial;
+    if (connection->xkb_state_ == nullptr || connection->keyboard_focus_ == nullptr)
+      return;
+
+    if (state == WL_KEYBOARD_KEY_STATE_PRESSED) {
+      connection->sendKey(key, false);
+      if (connection->repeat_rate_ > 0 &&
+          xkb_keymap_key_repeats(connection->xkb_keymap_, key + kXkbKeycodeOffset)) {
+        connection->repeat_key_ = key;
+        connection->repeat_next_us_ = time::microseconds() + connection->repeat_delay_ms_ * 1000LL;
+      }
+      return;
+    }
+
+    if (connection->repeat_key_ == key)
+      connection->repeat_key_ = 0;
+
+    KeyCode key_code = translateKeyCode(connection->baseKeysym(key));
+    if (key_code != KeyCode::Unknown)
+      connection->keyboard_focus_->handleKeyUp(key_code, connection->modifierState());
+  }
+
+  void WaylandConnection::keyboardModifiers(void* data, wl_keyboard* keyboard, uint32_t serial,
+                                            uint32_t depressed, uint32_t latched, uint32_t locked,
+                                            uint32_t group) {
+    auto connection = static_cast<WaylandConnection*>(data);
+    if (connection->xkb_state_)
+      xkb_state_update_mask(connection->xkb_state_, depressed, latched, locked, 0, 0, group);
+  }
+
+  void WaylandConnection::keyboardRepeatInfo(void* data, wl_keyboard* keyboard, int32_t rate,
+                                             int32_t delay) {
+    auto connection = static_cast<WaylandConnection*>(data);
+    connection->repeat_rate_ = rate;
+    connection->repeat_delay_ms_ = delay;
+  }
+
+  xkb_keysym_t WaylandConnection::baseKeysym(uint32_t key) const {
+    const xkb_keysym_t* syms = nullptr;
+    int num_syms = xkb_keymap_key_get_syms_by_level(xkb_keymap_, key + kXkbKeycodeOffset, 0, 0,
+                                                    &syms);
+    return num_syms > 0 ? syms[0] : XKB_KEY_NoSymbol;
+  }
+
+  int WaylandConnection::modifierState() const {
+    if (xkb_state_ == nullptr)
+      return 0;
+
+    auto active = [this](const char* name) {
+      return xkb_state_mod_name_is_active(xkb_state_, name, XKB_STATE_MODS_EFFECTIVE) > 0;
+    };
+
+    int result = 0;
+    if (active(XKB_MOD_NAME_SHIFT))
+      result = result | kModifierShift;
+    if (active(XKB_MOD_NAME_CTRL))
+      result = result | kModifierRegCtrl;
+    if (active(XKB_MOD_NAME_ALT))
+      result = result | kModifierAlt;
+    if (active(XKB_MOD_NAME_LOGO))
+      result = result | kModifierMeta;
+    return result;
+  }
+
+  void WaylandConnection::sendKey(uint32_t key, bool repeat) {
+    static constexpr int kMaxCharacters = 32;
+
+    WindowWayland* window = keyboard_focus_;
+    int modifier_state = modifierState();
+    char buffer[kMaxCharacters] {};
+    int length = xkb_state_key_get_utf8(xkb_state_, key + kXkbKeycodeOffset, buffer,
+                                        sizeof(buffer));
+    if ((modifier_state & kModifierAlt) == 0 && length > 0 && length < kMaxCharacters &&
+        buffer[0] != '\x7f')
+      window->handleTextInput(std::string(buffer, length));
+
+    KeyCode key_code = translateKeyCode(baseKeysym(key));
+    if (key_code != KeyCode::Unknown && keyboard_focus_ == window)
+      window->handleKeyDown(key_code, modifier_state, repeat);
+  }
+
+  void WaylandConnection::repeatKeys(long long microseconds) {
+    if (repeat_key_ == 0 || microseconds < repeat_next_us_ || keyboard_focus_ == nullptr)
+      return;
+
+    long long interval = 1000000LL / std::max(1, repeat_rate_);
+    repeat_next_us_ = std::max(repeat_next_us_ + interval, microseconds + interval / 2);
+    sendKey(repeat_key_, true);
+  }
+
+  int WaylandConnection::dispatch(int timeout_ms) {
+    if (display_ == nullptr)
+      return -1;
+
+    while (wl_display_prepare_read(display_) != 0) {
+      if (wl_display_dispatch_pending(display_) < 0)
+        return -1;
+    }
+
+    wl_display_flush(display_);
+    pollfd poll_fd = { wl_display_get_fd(display_), POLLIN, 0 };
+    int result = poll(&poll_fd, 1, timeout_ms);
+    if (result > 0 && (poll_fd.revents & POLLIN)) {
+      if (wl_display_read_events(display_) < 0)
+        return -1;
+    }
+    else {
+      wl_display_cancel_read(display_);
+      if ((result < 0 && errno != EINTR) || (poll_fd.revents & (POLLERR | POLLHUP)))
+        return -1;
+    }
+
+    return wl_display_dispatch_pending(display_);
+  }
+
+  void WaylandConnection::setCursorStyle(MouseCursor style) {
+    cursor_style_ = style;
+    if (pointer_ == nullptr || pointer_focus_ == nullptr)
+      return;
+    if (applied_cursor_serial_ == pointer_serial_ && applied_cursor_style_ == style)
+      return;
+
+    applied_cursor_serial_ = pointer_serial_;
+    applied_cursor_style_ = style;
+    if (style == MouseCursor::Invisible) {
+      wl_pointer_set_cursor(pointer_, pointer_serial_, nullptr, 0, 0);
+      return;
+    }
+
+    int scale = std::max(1, static_cast<int>(std::ceil(pointer_focus_->scale())));
+    if (cursor_theme_ == nullptr || cursor_theme_scale_ != scale) {
+      if (cursor_theme_)
+        wl_cursor_theme_destroy(cursor_theme_);
+      cursor_theme_ = shm_ ? wl_cursor_theme_load(nullptr, kCursorSize * scale, shm_) : nullptr;
+      cursor_theme_scale_ = scale;
+    }
+    if (cursor_theme_ == nullptr)
+      return;
+
+    wl_cursor* cursor = wl_cursor_theme_get_cursor(cursor_theme_, cursorName(style));
+    if (cursor == nullptr)
+      cursor = wl_cursor_theme_get_cursor(cursor_theme_, "left_ptr");
+    if (cursor == nullptr || cursor->image_count == 0)
+      return;
+
+    wl_cursor_image* image = cursor->images[0];
+    if (cursor_surface_ == nullptr)
+      cursor_surface_ = wl_compositor_create_surface(compositor_);
+
+    wl_surface_set_buffer_scale(cursor_surface_, scale);
+    wl_surface_attach(cursor_surface_, wl_cursor_image_get_buffer(image), 0, 0);
+    wl_surface_damage_buffer(cursor_surface_, 0, 0, image->width, image->height);
+    wl_surface_commit(cursor_surface_);
+    wl_pointer_set_cursor(pointer_, pointer_serial_, cursor_surface_, image->hotspot_x / scale,
+                          image->hotspot_y / scale);
+  }
+
+  Point WaylandConnection::cursorPosition() const {
+    if (pointer_focus_ == nullptr)
+      return { 0, 0 };
+    return pointer_focus_->convertToLogical(pointer_position_);
+  }
+
+  void WaylandConnection::dataOffer(void* data, wl_data_device* data_device, wl_data_offer* offer) {
+    static const wl_data_offer_listener kDataOfferListener = { dataOfferMimeType,
+                                                               dataOfferSourceActions,
+                                                               dataOfferAction };
+
+    auto connection = static_cast<WaylandConnection*>(data);
+    connection->offer_mime_types_[offer] = {};
+    wl_data_offer_add_listener(offer, &kDataOfferListener, connection);
+  }
+
+  void WaylandConnection::dataOfferMimeType(void* data, wl_data_offer* offer,
+                                            const char* mime_type) {
+    static_cast<WaylandConnection*>(data)->offer_mime_types_[offer].emplace_back(mime_type);
+  }
+
+  bool WaylandConnection::offersMimeType(wl_data_offer* offer, const char* mime_type) const {
+    auto it = offer_mime_types_.find(offer);
+    if (it == offer_mime_types_.end())
+      return false;
+    return std::find(it->second.begin(), it->second.end(), mime_type) != it->second.end();
+  }
+
+  void WaylandConnection::destroyOffer(wl_data_offer* offer) {
+    if (offer == nullptr)
+      return;
+
+    offer_mime_types_.erase(offer);
+    wl_data_offer_destroy(offer);
+  }
+
+  std::string WaylandConnection::receiveOffer(wl_data_offer* offer, const char* mime_type) {
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0)
+      return {};
+
+    wl_data_offer_receive(offer, mime_type, fds[1]);
+    close(fds[1]);
+    wl_display_flush(display_);
+
+    std::string result;
+    char buffer[4096];
+    pollfd poll_fd = { fds[0], POLLIN, 0 };
+    while (poll(&poll_fd, 1, kReceiveTimeoutMs) > 0) {
+      ssize_t bytes = read(fds[0], buffer, sizeof(buffer));
+      if (bytes <= 0)
+        break;
+      result.append(buffer, bytes);
+    }
+    close(fds[0]);
+    return result;
+  }
+
+  void WaylandConnection::dataEnter(void* data, wl_data_device* data_device, uint32_t serial,
+                                    wl_surface* surface, wl_fixed_t x, wl_fixed_t y,
+                                    wl_data_offer* offer) {
+    static const std::string kFilePrefix = "file://";
+
+    auto connection = static_cast<WaylandConnection*>(data);
+    if (connection->drag_offer_ != offer)
+      connection->destroyOffer(connection->drag_offer_);
+
+    connection->drag_offer_ = offer;
+    connection->drag_window_ = WindowWayland::fromSurface(surface);
+    connection->drag_files_.clear();
+    if (offer == nullptr)
+      return;
+
+    bool has_files = connection->offersMimeType(offer, kUriListMimeType);
+    if (connection->drag_window_ == nullptr || !has_files) {
+      wl_data_offer_accept(offer, serial, nullptr);
+      return;
+    }
+
+    wl_data_offer_accept(offer, serial, kUriListMimeType);
+    if (wl_data_offer_get_version(offer) >= WL_DATA_OFFER_SET_ACTIONS_SINCE_VERSION) {
+      wl_data_offer_set_actions(offer, WL_DATA_DEVICE_MANAGER_DND_ACTION_COPY,
+                                WL_DATA_DEVICE_MANAGER_DND_ACTION_COPY);
+    }
+
+    std::stringstream stream(connection->receiveOffer(offer, kUriListMimeType));
+    std::string line;
+    while (std::getline(stream, line)) {
+      std::string trimmed = String(line).trim().toUtf8();
+      if (trimmed.empty() || trimmed[0] == '#')
+        continue;
+      if (trimmed.substr(0, kFilePrefix.size()) == kFilePrefix)
+        connection->drag_files_.push_back(trimmed.substr(kFilePrefix.size()));
+      else
+        connection->drag_files_.push_back(trimmed);
+    }
+
+    IPoint position = connection->drag_window_->convertToNative(
+        { static_cast<float>(wl_fixed_to_double(x)), static_cast<float>(wl_fixed_to_double(y)) });
+    connection->drag_window_->handleFileDrag(position.x, position.y, connection->drag_files_);
+  }
+
+  void WaylandConnection::dataLeave(void* data, wl_data_device* data_device) {
+    auto connection = static_cast<WaylandConnection*>(data);
+    if (connection->drag_window_ && !connection->drag_files_.empty())
+      connection->drag_window_->handleFileDragLeave();
+
+    connection->destroyOffer(connection->drag_offer_);
+    connection->drag_offer_ = nullptr;
+    connection->drag_window_ = nullptr;
+    connection->drag_files_.clear();
+  }
+
+  void WaylandConnection::dataMotion(void* data, wl_data_device* data_device, uint32_t time,
+                                     wl_fixed_t x, wl_fixed_t y) {
+    auto connection = static_cast<WaylandConnection*>(data);
+    connection->drag_position_ = { static_cast<float>(wl_fixed_to_double(x)),
+                                   static_cast<float>(wl_fixed_to_double(y)) };
+    if (connection->drag_window_ == nullptr || connection->drag_files_.empty())
+      return;
+
+    IPoint position = connection->drag_window_->convertToNative(connection->drag_position_);
+    connection->drag_window_->handleFileDrag(position.x, position.y, connection->drag_files_);
+  }
+
+  void WaylandConnection::dataDrop(void* data, wl_data_device* data_device) {
+    auto connection = static_cast<WaylandConnection*>(data);
+    wl_data_offer* offer = connection->drag_offer_;
+    WindowWayland* window = connection->drag_window_;
+    connection->drag_window_ = nullptr;
+    if (offer == nullptr || window == nullptr || connection->drag_files_.empty())
+      return;
+
+    IPoint position = window->convertToNative(connection->drag_position_);
+    window->handleFileDrop(position.x, position.y, connection->drag_files_);
+    if (wl_data_offer_get_version(offer) >= WL_DATA_OFFER_FINISH_SINCE_VERSION)
+      wl_data_offer_finish(offer);
+  }
+
+  void WaylandConnection::dataSelection(void* data, wl_data_device* data_device,
+                                        wl_data_offer* offer) {
+    auto connection = static_cast<WaylandConnection*>(data);
+    if (connection->selection_offer_ != offer)
+      connection->destroyOffer(connection->selection_offer_);
+    connection->selection_offer_ = offer;
+  }
+
+  void WaylandConnection::dataSourceSend(void* data, wl_data_source* source, const char* mime_type,
+                                         int32_t fd) {
+    const std::string& text = static_cast<WaylandConnection*>(data)->clipboard_text_;
+    size_t written = 0;
+    while (written < text.size()) {
+      ssize_t bytes = write(fd, text.data() + written, text.size() - written);
+      if (bytes <= 0)
+        break;
+      written += bytes;
+    }
+    close(fd);
+  }
+
+  void WaylandConnection::dataSourceCancelled(void* data, wl_data_source* source) {
+    auto connection = static_cast<WaylandConnection*>(data);
+    if (connection->clipboard_source_ == source)
+      connection->clipboard_source_ = nullptr;
+    wl_data_source_destroy(source);
+  }
+
+  std::string WaylandConnection::readClipboardText() {
+    if (clipboard_source_)
+      return clipboard_text_;
+    if (selection_offer_ == nullptr)
+      return {};
+
+    for (const char* mime_type : kTextMimeTypes) {
+      if (offersMimeType(selection_offer_, mime_type))
+        return receiveOffer(selection_offer_, mime_type);
+    }
+    return {};
+  }
+
+  void WaylandConnection::setClipboardText(const std::string& text) {
+    static const wl_data_source_listener kDataSourceListener = {
+      dataSourceTarget,      dataSourceSend,       dataSourceCancelled,
+      dataSourceDropPerformed, dataSourceFinished, dataSourceAction
+    };
+
+    clipboard_text_ = text;
+    if (data_device_ == nullptr)
+      return;
+
+    if (clipboard_source_)
+      wl_data_source_destroy(clipboard_source_);
+
+    clipboard_source_ = wl_data_device_manager_create_data_source(data_device_manager_);
+    wl_data_source_add_listener(clipboard_source_, &kDataSourceListener, this);
+    for (const char* mime_type : kTextMimeTypes)
+      wl_data_source_offer(clipboard_source_, mime_type);
+    wl_data_device_set_selection(data_device_, clipboard_source_, last_serial_);
+    wl_display_flush(display_);
+  }
+
+  WindowWayland* WindowWayland::last_active_window_ = nullptr;
+
+  WindowWayland* WindowWayland::fromSurface(wl_surface* surface) {
+    if (surface == nullptr)
+      return nullptr;
+    return static_cast<WindowWayland*>(wl_surface_get_user_data(surface));
+  }
+
+  WindowWayland::WindowWayland(int width, int height, Decoration decoration) :
+      Window(width, height), decoration_(decoration) {
+    static const wl_surface_listener kSurfaceListener = { surfaceEnter, surfaceLeave };
+    static const wp_fractional_scale_v1_listener kFractionalScaleListener = { preferredScale };
+
+    wayland_ = WaylandConnection::globalInstance();
+    VISAGE_ASSERT(wayland_->display() && wayland_->compositor() && wayland_->wmBase());
+
+    MonitorInfo monitor_info = wayland_->activeMonitorInfo();
+    frame_pacer_.setRefreshRate(monitor_info.refresh_rate);
+    scale_ = monitor_info.scale;
+    setDpiScale(scale_);
+    logical_width_ = std::max(1, static_cast<int>(std::round(width / scale_)));
+    logical_height_ = std::max(1, static_cast<int>(std::round(height / scale_)));
+
+    surface_ = wl_compositor_create_surface(wayland_->compositor());
+    wl_surface_add_listener(surface_, &kSurfaceListener, this);
+    if (wayland_->viewporter())
+      viewport_ = wp_viewporter_get_viewport(wayland_->viewporter(), surface_);
+    if (viewport_ && wayland_->fractionalScaleManager()) {
+      fractional_scale_ = wp_fractional_scale_manager_v1_get_fractional_scale(
+          wayland_->fractionalScaleManager(), surface_);
+      wp_fractional_scale_v1_add_listener(fractional_scale_, &kFractionalScaleListener, this);
+    }
+    else
+      wl_surface_set_buffer_scale(surface_, monitor_info.scale);
+
+    start_microseconds_ = time::microseconds();
+    createToplevel();
+    WaylandWindowLookup::instance().addWindow(this);
+  }
+
+  WindowWayland::~WindowWayland() {
+    WaylandWindowLookup::instance().removeWindow(this);
+    if (last_active_window_ == this)
+      last_active_window_ = nullptr;
+
+    if (feedback_)
+      wp_presentation_feedback_destroy(feedback_);
+    if (fractional_scale_)
+      wp_fractional_scale_v1_destroy(fractional_scale_);
+    if (viewport_)
+      wp_viewport_destroy(viewport_);
+    destroyToplevel();
+    wl_surface_destroy(surface_);
+    wl_display_flush(wayland_->display());
+  }
+
+  void WindowWayland::createToplevel() {
+    static const xdg_surface_listener kXdgSurfaceListener = { xdgSurfaceConfigure };
+    static const xdg_toplevel_listener kToplevelListener = { toplevelConfigure, toplevelClose };
+
+    xdg_surface_ = xdg_wm_base_get_xdg_surface(wayland_->wmBase(), surface_);
+    xdg_surface_add_listener(xdg_surface_, &kXdgSurfaceListener, this);
+    toplevel_ = xdg_surface_get_toplevel(xdg_surface_);
+    xdg_toplevel_add_listener(toplevel_, &kToplevelListener, this);
+    xdg_toplevel_set_app_id(toplevel_, VISAGE_APPLICATION_NAME);
+    if (!title_.empty())
+      xdg_toplevel_set_title(toplevel_, title_.c_str());
+
+    int min_width = kMinWidth;
+    int min_height = kMinHeight;
+    handleAdjustResize(&min_width, &min_height, true, true);
+    xdg_toplevel_set_min_size(toplevel_, std::round(min_width / scale_),
+                              std::round(min_height / scale_));
+
+    if (wayland_->decorationManager() && decoration_ == Decoration::Native) {
+      toplevel_decoration_ = zxdg_decoration_manager_v1_get_toplevel_decoration(
+          wayland_->decorationManager(), toplevel_);
+      zxdg_toplevel_decoration_v1_set_mode(toplevel_decoration_,
+                                           ZXDG_TOPLEVEL_DECORATION_V1_MODE_SERVER_SIDE);
+    }
+
+    configured_ = false;
+    updateSurfaceSize();
+    wl_surface_commit(surface_);
+    while (!configured_ && wayland_->dispatch(-1) >= 0) {
+    }
+  }
+
+  void WindowWayland::destroyToplevel() {
+    if (toplevel_decoration_)
+      zxdg_toplevel_decoration_v1_destroy(toplevel_decoration_);
+    if (toplevel_)
+      xdg_toplevel_destroy(toplevel_);
+    if (xdg_surface_)
+      xdg_surface_destroy(xdg_surface_);
+
+    toplevel_decoration_ = nullptr;
+    toplevel_ = nullptr;
+    xdg_surface_ = nullptr;
+    configured_ = false;
+  }
+
+  void* WindowWayland::initWindow() const {
+    static wl_surface* init_surface = wl_compositor_create_surface(wayland_->compositor());
+    return init_surface;
+  }
+
+  void WindowWayland::surfaceEnter(void* data, wl_surface* surface, wl_output* output) {
+    auto window = static_cast<WindowWayland*>(data);
+    window->output_ = output;
+    MonitorInfo monitor_info = window->wayland_->monitorInfo(output);
+    if (window->feedback_interval_us_ == 0)
+      window->frame_pacer_.setRefreshRate(monitor_info.refresh_rate);
+    if (window->fractional_scale_ == nullptr) {
+      wl_surface_set_buffer_scale(surface, monitor_info.scale);
+      window->setScale(monitor_info.scale);
+    }
+  }
+
+  void WindowWayland::preferredScale(void* data, wp_fractional_scale_v1* fractional_scale,
+                                     uint32_t scale) {
+    static constexpr float kScaleDenominator = 120.0f;
+    static_cast<WindowWayland*>(data)->setScale(scale / kScaleDenominator);
+  }
+
+  void WindowWayland::setScale(float scale) {
+    if (scale == scale_ || scale <= 0.0f)
+      return;
+
+    scale_ = scale;
+    setDpiScale(scale);
+    handleResized(std::round(logical_width_ * scale_), std::round(logical_height_ * scale_));
+    updateSurfaceSize();
+    wakeDrawCallbacks();
+  }
+
+  void WindowWayland::updateSurfaceSize() {
+    if (fractional_scale_)
+      wp_viewport_set_destination(viewport_, logical_width_, logical_height_);
+    if (xdg_surface_)
+      xdg_surface_set_window_geometry(xdg_surface_, 0, 0, logical_width_, logical_height_);
+  }
+
+  void WindowWayland::toplevelConfigure(void* data, xdg_toplevel* toplevel, int32_t width,
+                                        int32_t height, wl_array* states) {
+    auto window = static_cast<WindowWayland*>(data);
+    window->pending_width_ = width;
+    window->pending_height_ = height;
+    window->maximized_ = false;
+
+    auto state = static_cast<const uint32_t*>(states->data);
+    size_t num_states = states->size / sizeof(uint32_t);
+    for (size_t i = 0; i < num_states; ++i) {
+      if (state[i] == XDG_TOPLEVEL_STATE_MAXIMIZED)
+        window->maximized_ = true;
+      else if (state[i] == XDG_TOPLEVEL_STATE_ACTIVATED)
+        last_active_window_ = window;
+    }
+  }
+
+  void WindowWayland::xdgSurfaceConfigure(void* data, xdg_surface* surface, uint32_t serial) {
+    auto window = static_cast<WindowWayland*>(data);
+    xdg_surface_ack_configure(surface, serial);
+    bool initial = !window->configured_;
+    window->configured_ = true;
+
+    int width = window->pending_width_;
+    int height = window->pending_height_;
+    if (width <= 0 || height <= 0 ||
+        (width == window->logical_width_ && height == window->logical_height_)) {
+      window->updateSurfaceSize();
+      if (!initial)
+        wl_surface_commit(window->surface_);
+      return;
+    }
+
+    int native_width = std::round(width * window->scale_);
+    int native_height = std::round(height * window->scale_);
+    if (!window->maximized_)
+      window->handleAdjustResize(&native_width, &native_height, true, true);
+
+    window->handleResized(native_width, native_height);
+    window->windowContentsResized(native_width, native_height);
+    window->wakeDrawCallbacks();
+  }
+
+  void WindowWayland::toplevelClose(void* data, xdg_toplevel* toplevel) {
+    static_cast<WindowWayland*>(data)->close();
+  }
+
+  void WindowWayland::feedbackPresented(void* data, wp_presentation_feedback* feedback,
+                                        uint32_t tv_sec_hi, uint32_t tv_sec_lo, uint32_t tv_nsec,
+                                        uint32_t refresh, uint32_t seq_hi, uint32_t seq_lo,
+                                        uint32_t flags) {
+    static constexpr long long kIntervalToleranceUs = 100;
+
+    auto window = static_cast<WindowWayland*>(data);
+    wp_presentation_feedback_destroy(feedback);
+    window->feedback_ = nullptr;
+    if (refresh == 0)
+      return;
+
+    long long interval = refresh / 1000;
+    window->feedback_interval_us_ = interval;
+    if (std::abs(interval - window->frame_pacer_.interval()) > kIntervalToleranceUs)
+      window->frame_pacer_.setInterval(interval);
+  }
+
+  void WindowWayland::feedbackDiscarded(void* data, wp_presentation_feedback* feedback) {
+    wp_presentation_feedback_destroy(feedback);
+    static_cast<WindowWayland*>(data)->feedback_ = nullptr;
+  }
+
+  void WindowWayland::pacedDrawCallback(long long microseconds) {
+    static const wp_presentation_feedback_listener kFeedbackListener = { feedbackSyncOutput,
+                                                                         feedbackPresented,
+                                                                         feedbackDiscarded };
+    if (!showing_ || !configured_)
+      return;
+
+    if (feedback_ == nullptr && wayland_->presentation()) {
+      feedback_ = wp_presentation_feedback(wayland_->presentation(), surface_);
+      wp_presentation_feedback_add_listener(feedback_, &kFeedbackListener, this);
+    }
+
+    frame_pacer_.tick(microseconds);
+    double time = (microseconds - start_microseconds_) / 1000000.0;
+    lateLatchDrawCallback(time, frame_pacer_.interval());
+    updateIdleDeadline();
+  }
+
+  void WindowWayland::updateIdleDeadline() {
+    long long ms = msUntilDrawNeeded();
+    long long idle_ms = ms < 0 ? kMaxIdleMs : std::min(kMaxIdleMs, ms);
+    idle_until_us_ = time::microseconds() + idle_ms * 1000;
+  }
+
+  void WindowWayland::checkTick() {
+    long long now = time::microseconds();
+    wayland_->repeatKeys(now);
+    if (now < next_tick_us_)
+      return;
+
+    next_tick_us_ = frame_pacer_.nextDeadline(now);
+    if (now >= idle_until_us_)
+      pacedDrawCallback(now);
+  }
+
+  void WindowWayland::runEventLoop() {
+    start_microseconds_ = time::microseconds();
+    frame_pacer_.reset();
+    next_tick_us_ = frame_pacer_.nextDeadline(start_microseconds_);
+
+    while (WaylandWindowLookup::instance().anyWindowOpen()) {
+      int timeout_ms = std::max(0LL, (nextWakeup() + 999) / 1000);
+      int dispatched = wayland_->dispatch(timeout_ms);
+      if (dispatched < 0)
+        break;
+      if (dispatched > 0)
+        updateIdleDeadline();
+      checkTick();
+    }
+  }
+
+  long long WindowWayland::nextWakeup() {
+    long long now = time::microseconds();
+    if (next_tick_us_ == 0)
+      next_tick_us_ = frame_pacer_.nextDeadline(now);
+
+    long long deadline = std::max(next_tick_us_, idle_until_us_);
+    if (long long repeat = wayland_->nextKeyRepeat())
+      deadline = std::min(deadline, repeat);
+    return std::max(0LL, deadline - now);
+  }
+
+  void WindowWayland::processPending() {
+    if (wayland_->dispatch(0) > 0)
+      updateIdleDeadline();
+    checkTick();
+  }
+
+  void WindowWayland::pumpInput() {
+    wayland_->dispatch(0);
+  }
+
+  int WindowWayland::resizeEdgesForPosition(IPoint position) const {
+    if (decoration_ != Decoration::Client || maximized_)
+      return 0;
+
+    int border = kClientResizeBorder * dpiScale();
+    int edges = XDG_TOPLEVEL_RESIZE_EDGE_NONE;
+    if (position.x <= border)
+      edges = XDG_TOPLEVEL_RESIZE_EDGE_LEFT;
+    else if (position.x >= clientWidth() - border)
+      edges = XDG_TOPLEVEL_RESIZE_EDGE_RIGHT;
+    if (position.y <= border)
+      edges |= XDG_TOPLEVEL_RESIZE_EDGE_TOP;
+    else if (position.y >= clientHeight() - border)
+      edges |= XDG_TOPLEVEL_RESIZE_EDGE_BOTTOM;
+    return edges;
+  }
+
+  void WindowWayland::handlePointerMotion(IPoint position) {
+    last_active_window_ = this;
+    int last_hover_edges = hover_edges_;
+    hover_edges_ = resizeEdgesForPosition(position);
+    if (hover_edges_)
+      wayland_->setCursorStyle(resizeEdgesCursor(hover_edges_));
+    else if (last_hover_edges)
+      wayland_->setCursorStyle(MouseCursor::Arrow);
+
+    handleMouseMove(position.x, position.y, wayland_->mouseButtonState(),
+                    wayland_->modifierState());
+  }
+
+  void WindowWayland::handlePointerButton(MouseButton button, bool pressed, IPoint position,
+                                          uint32_t serial) {
+    last_active_window_ = this;
+    int button_state = wayland_->mouseButtonState();
+    int modifier_state = wayland_->modifierState();
+    if (pressed) {
+      handleMouseDown(button, position.x, position.y, button_state, modifier_state);
+      if (button != kMouseButtonLeft || toplevel_ == nullptr)
+        return;
+
+      int edges = resizeEdgesForPosition(position);
+      if (edges)
+        xdg_toplevel_resize(toplevel_, wayland_->seat(), serial, edges);
+      else if (handleHitTest(position.x, position.y) == HitTestResult::TitleBar)
+        xdg_toplevel_move(toplevel_, wayland_->seat(), serial);
+      return;
+    }
+
+    HitTestResult hit_test = currentHitTest();
+    handleMouseUp(button, position.x, position.y, button_state, modifier_state);
+    if (button != kMouseButtonLeft || toplevel_ == nullptr ||
+        handleHitTest(position.x, position.y) != hit_test)
+      return;
+
+    if (hit_test == HitTestResult::CloseButton)
+      close();
+    else if (hit_test == HitTestResult::MaximizeButton) {
+      if (maximized_)
+        xdg_toplevel_unset_maximized(toplevel_);
+      else
+        xdg_toplevel_set_maximized(toplevel_);
+    }
+    else if (hit_test == HitTestResult::MinimizeButton)
+      xdg_toplevel_set_minimized(toplevel_);
+  }
+
+  void WindowWayland::windowContentsResized(int width, int height) {
+    logical_width_ = std::max(1, static_cast<int>(std::round(width / scale_)));
+    logical_height_ = std::max(1, static_cast<int>(std::round(height / scale_)));
+    updateSurfaceSize();
+  }
+
+  void WindowWayland::show() {
+    if (toplevel_ == nullptr)
+      createToplevel();
+
+    showing_ = true;
+    wakeDrawCallbacks();
+    notifyShow();
+  }
+
+  void WindowWayland::showMaximized() {
+    show();
+    xdg_toplevel_set_maximized(toplevel_);
+  }
+
+  void WindowWayland::hide() {
+    if (!showing_)
+      return;
+
+    showing_ = false;
+    destroyToplevel();
+    wl_surface_attach(surface_, nullptr, 0, 0);
+    wl_surface_commit(surface_);
+    wl_display_flush(wayland_->display());
+    notifyHide();
+  }
+
+  void WindowWayland::close() {
+    if (!closeRequested())
+      return;
+
+    hide();
+    WaylandWindowLookup::instance().removeWindow(this);
+  }
+
+  void WindowWayland::setFixedAspectRatio(bool fixed) {
+    Window::setFixedAspectRatio(fixed);
+  }
+
+  void WindowWayland::setWindowTitle(const std::string& title) {
+    title_ = title;
+    if (toplevel_)
+      xdg_toplevel_set_title(toplevel_, title.c_str());
+  }
+
+  IPoint WindowWayland::maxWindowDimensions() const {
+    MonitorInfo monitor_info = monitorInfo();
+    float monitor_scale = scale_ / monitor_info.scale;
+    int display_width = monitor_info.bounds.width() * monitor_scale;
+    int display_height = monitor_info.bounds.height() * monitor_scale;
+    float aspect_ratio = clientWidth() * 1.0f / clientHeight();
+    return { std::min<int>(display_width, display_height * aspect_ratio),
+             std::min<int>(display_height, display_width / aspect_ratio) };
+  }
+
+  void setCursorStyle(MouseCursor style) {
+    WaylandConnection::globalInstance()->setCursorStyle(style);
+  }
+
+  void setCursorVisible(bool visible) {
+    setCursorStyle(visible ? MouseCursor::Arrow : MouseCursor::Invisible);
+  }
+
+  Point cursorPosition() {
+    return WaylandConnection::globalInstance()->cursorPosition();
+  }
+
+  // Wayland doesn't let clients warp the pointer.
+  void setCursorPosition(Point window_position) { }
+
+  void setCursorScreenPosition(Point window_position) { }
+
+  bool isMobileDevice() {
+    return false;
+  }
+
+  // Runs a dialog tool and waits for it to close. Returns false if the tool isn't installed.
+  static bool runDialog(std::vector<std::string> arguments) {
+    std::vector<char*> argv;
+    for (std::string& argument : arguments)
+      argv.push_back(argument.data());
+    argv.push_back(nullptr);
+
+    pid_t pid = 0;
+    if (posix_spawnp(&pid, argv[0], nullptr, nullptr, argv.data(), environ) != 0)
+      return false;
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0) {
+      if (errno != EINTR)
+        return false;
+    }
+    return !WIFEXITED(status) || WEXITSTATUS(status) != 127;
+  }
+
+  // Wayland has no dialogs without a toolkit, so this blocks on zenity or kdialog like the other
+  // platforms' message boxes and only prints to stderr when neither is installed.
+  void showMessageBox(std::string title, std::string message) {
+    if (runDialog({ "zenity", "--error", "--no-markup", "--title", title, "--text", message }))
+      return;
+    if (runDialog({ "kdialog", "--title", title, "--error", message }))
+      return;
+
+    fprintf(stderr, "%s: %s\n", title.c_str(), message.c_str());
+  }
+
+  std::string readClipboardText() {
+    return WaylandConnection::globalInstance()->readClipboardText();
+  }
+
+  void setClipboardText(const std::string& text) {
+    WaylandConnection::globalInstance()->setClipboardText(text);
+  }
+
+  float defaultDpiScale() {
+    return WaylandConnection::globalInstance()->activeMonitorInfo().scale;
+  }
+
+  IBounds computeWindowBounds(const Dimension& x, const Dimension& y, const Dimension& width,
+                              const Dimension& height) {
+    MonitorInfo monitor_info = WaylandConnection::globalInstance()->activeMonitorInfo();
+    int monitor_width = monitor_info.bounds.width();
+    int monitor_height = monitor_info.bounds.height();
+    float dpi_scale = monitor_info.scale;
+    int result_w = width.computeInt(dpi_scale, monitor_width, monitor_height, 100);
+    int result_h = height.computeInt(dpi_scale, monitor_width, monitor_height, 100);
+    int result_x = x.computeInt(dpi_scale, monitor_width, monitor_height,
+                                (monitor_width - result_w) / 2);
+    int result_y = y.computeInt(dpi_scale, monitor_width, monitor_height,
+                                (monitor_height - result_h) / 2);
+    return { monitor_info.bounds.x() + result_x, monitor_info.bounds.y() + result_y, result_w,
+             result_h };
+  }
+
+  // Toplevel positions are chosen by the compositor, so x and y are ignored.
+  std::unique_ptr<Window> createWindow(const Dimension& x, const Dimension& y,
+                                       const Dimension& width, const Dimension& height,
+                                       Window::Decoration decoration) {
+    IBounds bounds = computeWindowBounds(width, height);
+    return std::make_unique<WindowWayland>(bounds.width(), bounds.height(), decoration);
+  }
+
+  void* headlessWindowHandle() {
+    return nullptr;
+  }
+
+  void closeApplication() {
+    WaylandWindowLookup::instance().closeAll();
+  }
+
+  // Wayland has no cross-client embedding, plugin editors open as their own toplevel.
+  std::unique_ptr<Window> createPluginWindow(const Dimension& width, const Dimension& height,
+                                             void* parent_handle) {
+    IBounds bounds = computeWindowBounds(width, height);
+    return std::make_unique<WindowWayland>(bounds.width(), bounds.height(),
+                                           Window::Decoration::Native);
+  }
+
+  int displayFps() {
+    return std::round(WaylandConnection::globalInstance()->activeMonitorInfo().refresh_rate);
+  }
+}
+#endif
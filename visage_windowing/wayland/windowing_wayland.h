@@ -0,0 +1,330 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#if VISAGE_LINUX && VISAGE_WAYLAND
+#include "visage_utils/time_utils.h"
+#include "windowing.h"
+
+#include <map>
+#include <set>
+#include <wayland-client.h>
+#include <xkbcommon/xkbcommon.h>
+
+struct wl_cursor_theme;
+struct wp_fractional_scale_manager_v1;
+struct wp_fractional_scale_v1;
+struct wp_presentation;
+struct wp_presentation_feedback;
+struct wp_viewport;
+struct wp_viewporter;
+struct xdg_surface;
+struct xdg_toplevel;
+struct xdg_wm_base;
+struct zxdg_decoration_manager_v1;
+struct zxdg_toplevel_decoration_v1;
+
+namespace visage {
+  class WindowWayland;
+
+  struct MonitorInfo {
+    static constexpr int kDefaultRefreshRate = 60;
+    static constexpr int kDefaultWidth = 1920;
+    static constexpr int kDefaultHeight = 1080;
+
+    IBounds bounds;
+    double refresh_rate = kDefaultRefreshRate;
+    int scale = 1;
+  };
+
+  class WaylandConnection {
+  public:
+    static WaylandConnection* globalInstance() {
+      static WaylandConnection connection;
+      return &connection;
+    }
+
+    WaylandConnection();
+    WaylandConnection(const WaylandConnection& copy) = delete;
+    ~WaylandConnection();
+
+    wl_display* display() const { return display_; }
+    wl_compositor* compositor() const { return compositor_; }
+    xdg_wm_base* wmBase() const { return wm_base_; }
+    wl_seat* seat() const { return seat_; }
+    wp_presentation* presentation() const { return presentation_; }
+    wp_viewporter* viewporter() const { return viewporter_; }
+    wp_fractional_scale_manager_v1* fractionalScaleManager() const {
+      return fractional_scale_manager_;
+    }
+    zxdg_decoration_manager_v1* decorationManager() const { return decoration_manager_; }
+    int fd() const { return display_ ? wl_display_get_fd(display_) : 0; }
+
+    // Reads and dispatches events, waiting up to timeout_ms for the first one. Returns the number
+    // of events dispatched or -1 when the connection is gone.
+    int dispatch(int timeout_ms);
+
+    MonitorInfo monitorInfo(wl_output* output) const;
+    MonitorInfo activeMonitorInfo() const;
+
+    void setCursorStyle(MouseCursor style);
+    Point cursorPosition() const;
+    std::string readClipboardText();
+    void setClipboardText(const std::string& text);
+
+    WindowWayland* pointerFocus() const { return pointer_focus_; }
+    WindowWayland* keyboardFocus() const { return keyboard_focus_; }
+    uint32_t lastSerial() const { return last_serial_; }
+    int mouseButtonState() const { return button_state_; }
+    int modifierState() const;
+    long long nextKeyRepeat() const { return repeat_key_ ? repeat_next_us_ : 0; }
+    void repeatKeys(long long microseconds);
+
+  private:
+    struct Output {
+      uint32_t name = 0;
+      wl_output* output = nullptr;
+      MonitorInfo info;
+    };
+
+    static void registryGlobal(void* data, wl_registry* registry, uint32_t name,
+                               const char* interface, uint32_t version);
+    static void registryGlobalRemove(void* data, wl_registry* registry, uint32_t name);
+    static void wmBasePing(void* data, xdg_wm_base* wm_base, uint32_t serial);
+    static void seatCapabilities(void* data, wl_seat* seat, uint32_t capabilities);
+    static void seatName(void* data, wl_seat* seat, const char* name) { }
+
+    static void outputGeometry(void* data, wl_output* output, int32_t x, int32_t y,
+                               int32_t physical_width, int32_t physical_height, int32_t subpixel,
+                               const char* make, const char* model, int32_t transform);
+    static void outputMode(void* data, wl_output* output, uint32_t flags, int32_t width,
+                           int32_t height, int32_t refresh);
+    static void outputDone(void* data, wl_output* output) { }
+    static void outputScale(void* data, wl_output* output, int32_t factor);
+
+    static void pointerEnter(void* data, wl_pointer* pointer, uint32_t serial, wl_surface* surface,
+                             wl_fixed_t x, wl_fixed_t y);
+    static void pointerLeave(void* data, wl_pointer* pointer, uint32_t serial, wl_surface* surface);
+    static void pointerMotion(void* data, wl_pointer* pointer, uint32_t time, wl_fixed_t x,
+                              wl_fixed_t y);
+    static void pointerButton(void* data, wl_pointer* pointer, uint32_t serial, uint32_t time,
+                              uint32_t button, uint32_t state);
+    static void pointerAxis(void* data, wl_pointer* pointer, uint32_t time, uint32_t axis,
+                            wl_fixed_t value);
+    static void pointerFrame(void* data, wl_pointer* pointer);
+    static void pointerAxisSource(void* data, wl_pointer* pointer, uint32_t source);
+    static void pointerAxisStop(void* data, wl_pointer* pointer, uint32_t time, uint32_t axis) { }
+    static void pointerAxisDiscrete(void* data, wl_pointer* pointer, uint32_t axis,
+                                    int32_t discrete);
+
+    static void keyboardKeymap(void* data, wl_keyboard* keyboard, uint32_t format, int32_t fd,
+                               uint32_t size);
+    static void keyboardEnter(void* data, wl_keyboard* keyboard, uint32_t serial,
+                              wl_surface* surface, wl_array* keys);
+    static void keyboardLeave(void* data, wl_keyboard* keyboard, uint32_t serial,
+                              wl_surface* surface);
+    static void keyboardKey(void* data, wl_keyboard* keyboard, uint32_t serial, uint32_t time,
+                            uint32_t key, uint32_t state);
+    static void keyboardModifiers(void* data, wl_keyboard* keyboard, uint32_t serial,
+                                  uint32_t depressed, uint32_t latched, uint32_t locked,
+                                  uint32_t group);
+    static void keyboardRepeatInfo(void* data, wl_keyboard* keyboard, int32_t rate, int32_t delay);
+
+    static void dataOffer(void* data, wl_data_device* data_device, wl_data_offer* offer);
+    static void dataEnter(void* data, wl_data_device* data_device, uint32_t serial,
+                          wl_surface* surface, wl_fixed_t x, wl_fixed_t y, wl_data_offer* offer);
+    static void dataLeave(void* data, wl_data_device* data_device);
+    static void dataMotion(void* data, wl_data_device* data_device, uint32_t time, wl_fixed_t x,
+                           wl_fixed_t y);
+    static void dataDrop(void* data, wl_data_device* data_device);
+    static void dataSelection(void* data, wl_data_device* data_device, wl_data_offer* offer);
+    static void dataOfferMimeType(void* data, wl_data_offer* offer, const char* mime_type);
+    static void dataOfferSourceActions(void* data, wl_data_offer* offer, uint32_t actions) { }
+    static void dataOfferAction(void* data, wl_data_offer* offer, uint32_t action) { }
+    static void dataSourceTarget(void* data, wl_data_source* source, const char* mime_type) { }
+    static void dataSourceSend(void* data, wl_data_source* source, const char* mime_type,
+                               int32_t fd);
+    static void dataSourceCancelled(void* data, wl_data_source* source);
+    static void dataSourceDropPerformed(void* data, wl_data_source* source) { }
+    static void dataSourceFinished(void* data, wl_data_source* source) { }
+    static void dataSourceAction(void* data, wl_data_source* source, uint32_t action) { }
+
+    Output* findOutput(wl_output* output);
+    IPoint nativePosition(wl_fixed_t x, wl_fixed_t y) const;
+    xkb_keysym_t baseKeysym(uint32_t key) const;
+    void sendKey(uint32_t key, bool repeat);
+    std::string receiveOffer(wl_data_offer* offer, const char* mime_type);
+    void destroyOffer(wl_data_offer* offer);
+    bool offersMimeType(wl_data_offer* offer, const char* mime_type) const;
+
+    wl_display* display_ = nullptr;
+    wl_registry* registry_ = nullptr;
+    wl_compositor* compositor_ = nullptr;
+    wl_shm* shm_ = nullptr;
+    xdg_wm_base* wm_base_ = nullptr;
+    wl_seat* seat_ = nullptr;
+    wl_pointer* pointer_ = nullptr;
+    wl_keyboard* keyboard_ = nullptr;
+    wp_presentation* presentation_ = nullptr;
+    wp_viewporter* viewporter_ = nullptr;
+    wp_fractional_scale_manager_v1* fractional_scale_manager_ = nullptr;
+    zxdg_decoration_manager_v1* decoration_manager_ = nullptr;
+    wl_data_device_manager* data_device_manager_ = nullptr;
+    wl_data_device* data_device_ = nullptr;
+    std::vector<Output> outputs_;
+
+    wl_cursor_theme* cursor_theme_ = nullptr;
+    int cursor_theme_scale_ = 0;
+    wl_surface* cursor_surface_ = nullptr;
+    MouseCursor cursor_style_ = MouseCursor::Arrow;
+    MouseCursor applied_cursor_style_ = MouseCursor::Arrow;
+    uint32_t applied_cursor_serial_ = 0;
+    uint32_t pointer_serial_ = 0;
+    uint32_t last_serial_ = 0;
+    WindowWayland* pointer_focus_ = nullptr;
+    IPoint pointer_position_;
+    int button_state_ = 0;
+    IPoint pointer_wheel_;
+    Point pointer_precise_wheel_;
+    bool pointer_wheel_discrete_ = false;
+    bool pointer_wheel_finger_ = false;
+
+    xkb_context* xkb_context_ = nullptr;
+    xkb_keymap* xkb_keymap_ = nullptr;
+    xkb_state* xkb_state_ = nullptr;
+    WindowWayland* keyboard_focus_ = nullptr;
+    int repeat_rate_ = 25;
+    int repeat_delay_ms_ = 600;
+    uint32_t repeat_key_ = 0;
+    long long repeat_next_us_ = 0;
+
+    std::map<wl_data_offer*, std::vector<std::string>> offer_mime_types_;
+    wl_data_offer* selection_offer_ = nullptr;
+    wl_data_offer* drag_offer_ = nullptr;
+    WindowWayland* drag_window_ = nullptr;
+    Point drag_position_;
+    std::vector<std::string> drag_files_;
+    wl_data_source* clipboard_source_ = nullptr;
+    std::string clipboard_text_;
+  };
+
+  class WindowWayland : public Window {
+  public:
+    static constexpr int kMinWidth = 80;
+    static constexpr int kMinHeight = 80;
+    static constexpr int kClientResizeBorder = 8;
+
+    static WindowWayland* lastActiveWindow() { return last_active_window_; }
+    static WindowWayland* fromSurface(wl_surface* surface);
+
+    WindowWayland(int width, int height, Decoration decoration);
+    ~WindowWayland() override;
+
+    void runEventLoop() override;
+    void processPluginFdEvents() override { processPending(); }
+    long long nextWakeup() override;
+    void processPending() override;
+    void pumpInput() override;
+
+    void* nativeHandle() const override { return surface_; }
+    void* initWindow() const override;
+    void* globalDisplay() const override { return wayland_->display(); }
+    int posixFd() const override { return wayland_->fd(); }
+
+    void windowContentsResized(int width, int height) override;
+    void show() override;
+    void showMaximized() override;
+    void hide() override;
+    void close() override;
+    bool isShowing() const override { return showing_; }
+    void setFixedAspectRatio(bool fixed) override;
+    void wakeDrawCallbacks() override { idle_until_us_ = 0; }
+
+    void setWindowTitle(const std::string& title) override;
+    IPoint maxWindowDimensions() const override;
+    MonitorInfo monitorInfo() const { return wayland_->monitorInfo(output_); }
+    wl_output* output() const { return output_; }
+    float scale() const { return scale_; }
+    Decoration decoration() const { return decoration_; }
+
+    void handlePointerButton(MouseButton button, bool pressed, IPoint position, uint32_t serial);
+    void handlePointerMotion(IPoint position);
+
+  private:
+    static WindowWayland* last_active_window_;
+
+    static void surfaceEnter(void* data, wl_surface* surface, wl_output* output);
+    static void surfaceLeave(void* data, wl_surface* surface, wl_output* output) { }
+    static void xdgSurfaceConfigure(void* data, xdg_surface* surface, uint32_t serial);
+    static void toplevelConfigure(void* data, xdg_toplevel* toplevel, int32_t width,
+                                  int32_t height, wl_array* states);
+    static void toplevelClose(void* data, xdg_toplevel* toplevel);
+    static void preferredScale(void* data, wp_fractional_scale_v1* fractional_scale,
+                               uint32_t scale);
+    static void feedbackSyncOutput(void* data, wp_presentation_feedback* feedback,
+                                   wl_output* output) { }
+    static void feedbackPresented(void* data, wp_presentation_feedback* feedback,
+                                  uint32_t tv_sec_hi, uint32_t tv_sec_lo, uint32_t tv_nsec,
+                                  uint32_t refresh, uint32_t seq_hi, uint32_t seq_lo,
+                                  uint32_t flags);
+    static void feedbackDiscarded(void* data, wp_presentation_feedback* feedback);
+
+    void createToplevel();
+    void destroyToplevel();
+    void setScale(float scale);
+    void updateSurfaceSize();
+    void pacedDrawCallback(long long microseconds);
+    void updateIdleDeadline();
+    void checkTick();
+    int resizeEdgesForPosition(IPoint position) const;
+
+    WaylandConnection* wayland_ = nullptr;
+    wl_surface* surface_ = nullptr;
+    xdg_surface* xdg_surface_ = nullptr;
+    xdg_toplevel* toplevel_ = nullptr;
+    zxdg_toplevel_decoration_v1* toplevel_decoration_ = nullptr;
+    wp_viewport* viewport_ = nullptr;
+    wp_fractional_scale_v1* fractional_scale_ = nullptr;
+    wp_presentation_feedback* feedback_ = nullptr;
+    wl_output* output_ = nullptr;
+
+    Decoration decoration_ = Decoration::Native;
+    std::string title_;
+    float scale_ = 1.0f;
+    int logical_width_ = 0;
+    int logical_height_ = 0;
+    int pending_width_ = 0;
+    int pending_height_ = 0;
+    bool configured_ = false;
+    bool showing_ = false;
+    bool maximized_ = false;
+    int hover_edges_ = 0;
+
+    long long start_microseconds_ = 0;
+    long long next_tick_us_ = 0;
+    long long idle_until_us_ = 0;
+    long long feedback_interval_us_ = 0;
+    FramePacer frame_pacer_;
+  };
+}
+
+#endif
@@ -38,8 +38,10 @@
 #include "visage_utils/thread_utils.h"
 
 #include <algorithm>
+#include <dwmapi.h>
 #include <dxgi1_4.h>
 #include <map>
+#include <mutex>
 #include <ShlObj.h>
 #include <string>
 #include <windowsx.h>
@@ -229,79 +231,141 @@ namespace visage {
     SetCursorPos(position.x, position.y);
   }
 
-  class VBlankThread : public Thread {
+  static IDXGIOutput* outputForMonitor(HMONITOR monitor) {
+    IDXGIFactory* factory = nullptr;
+    if (FAILED(CreateDXGIFactory(__uuidof(IDXGIFactory), reinterpret_cast<void**>(&factory))))
+      return nullptr;
+
+    IDXGIOutput* result = nullptr;
+    IDXGIAdapter* adapter = nullptr;
+    for (int i = 0; result == nullptr && factory->EnumAdapters(i, &adapter) != DXGI_ERROR_NOT_FOUND;
+         ++i) {
+      IDXGIOutput* output = nullptr;
+      for (int j = 0; adapter->EnumOutputs(j, &output) != DXGI_ERROR_NOT_FOUND; ++j) {
+        DXGI_OUTPUT_DESC desc;
+        if (result == nullptr && SUCCEEDED(output->GetDesc(&desc)) && desc.Monitor == monitor)
+          result = output;
+        else
+          output->Release();
+      }
+      adapter->Release();
+    }
+
+    factory->Release();
+    return result;
+  }
+
+  // Process wide vblank source. One thread waits on each monitor that has a window showing and
+  // posts one coalesced WM_VBLANK to every window on it, so windows never block the thread.
+  class VBlankService {
   public:
-    explicit VBlankThread(WindowWin32* window) : window_(window) { }
+    static constexpr int kFallbackIntervalMs = 16;
+
+    static VBlankService& instance() {
+      static VBlankService service;
+      return service;
+    }
 
-    ~VBlankThread() override {
-      stop();
-      clear();
+    void addWindow(WindowWin32* window) {
+      std::vector<std::unique_ptr<MonitorThread>> retired;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        windows_.push_back(window);
+        updateThreads(retired);
+      }
     }
 
-    void clear() {
-      if (factory_) {
-        factory_->Release();
-        factory_ = nullptr;
+    void removeWindow(WindowWin32* window) {
+      std::vector<std::unique_ptr<MonitorThread>> retired;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto pos = std::find(windows_.begin(), windows_.end(), window);
+        if (pos == windows_.end())
+          return;
+
+        windows_.erase(pos);
+        updateThreads(retired);
       }
+    }
 
-      for (auto& output : monitor_outputs_)
-        output.second->Release();
-      for (auto& adapter : adapters_)
-        adapter->Release();
+    void monitorsChanged() {
+      std::vector<std::unique_ptr<MonitorThread>> retired;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        updateThreads(retired);
+      }
+    }
 
-      monitor_outputs_.clear();
-      adapters_.clear();
+    double currentTime() const {
+      return (time::microseconds() - start_us_) * (1.0 / 1000000.0);
     }
 
-    void updateMonitors() {
-      clear();
-      if (FAILED(CreateDXGIFactory(__uuidof(IDXGIFactory), reinterpret_cast<void**>(&factory_)))) {
-        factory_ = nullptr;
-        return;
+  private:
+    class MonitorThread : public Thread {
+    public:
+      MonitorThread(VBlankService* service, HMONITOR monitor) :
+          Thread("VBlank"), service_(service), monitor_(monitor) { }
+
+      ~MonitorThread() override {
+        stop();
+        if (output_)
+          output_->Release();
       }
 
-      IDXGIAdapter* adapter = nullptr;
-      for (int i = 0; factory_->EnumAdapters(i, &adapter) != DXGI_ERROR_NOT_FOUND; ++i) {
-        adapters_.push_back(adapter);
-        IDXGIOutput* output = nullptr;
-        for (int j = 0; adapter->EnumOutputs(j, &output) != DXGI_ERROR_NOT_FOUND; ++j) {
-          DXGI_OUTPUT_DESC desc;
-          if (SUCCEEDED(output->GetDesc(&desc)))
-            monitor_outputs_[desc.Monitor] = output;
+      void run() override {
+        output_ = outputForMonitor(monitor_);
+        while (shouldRun()) {
+          if (output_ == nullptr || FAILED(output_->WaitForVBlank()))
+            sleep(kFallbackIntervalMs);
+          if (shouldRun())
+            service_->broadcast(monitor_);
         }
       }
-    }
 
-    void run() override {
-      updateMonitors();
-      start_us_ = time::microseconds();
+    private:
+      VBlankService* service_ = nullptr;
+      HMONITOR monitor_ = nullptr;
+      IDXGIOutput* output_ = nullptr;
+    };
 
-      while (shouldRun()) {
-        HMONITOR monitor = window_->monitor();
-        if (monitor_outputs_.count(monitor) == 0) {
-          updateMonitors();
-          sleep(1);
+    VBlankService() : start_us_(time::microseconds()) { }
+
+    void updateThreads(std::vector<std::unique_ptr<MonitorThread>>& retired) {
+      for (auto it = threads_.begin(); it != threads_.end();) {
+        HMONITOR monitor = it->first;
+        bool used = std::any_of(windows_.begin(), windows_.end(), [monitor](WindowWin32* window) {
+          return window->monitor() == monitor;
+        });
+        if (used)
+          ++it;
+        else {
+          retired.push_back(std::move(it->second));
+          it = threads_.erase(it);
         }
-        else if (SUCCEEDED(monitor_outputs_[monitor]->WaitForVBlank())) {
-          long long us = time::microseconds() - start_us_;
-          time_ = us * (1.0 / 1000000.0);
-          SendMessage(window_->windowHandle(), WM_VBLANK, 0, 0);
+      }
+
+      for (WindowWin32* window : windows_) {
+        HMONITOR monitor = window->monitor();
+        if (monitor && threads_.count(monitor) == 0) {
+          auto thread = std::make_unique<MonitorThread>(this, monitor);
+          thread->start();
+          threads_[monitor] = std::move(thread);
         }
-        else
-          sleep(1);
       }
     }
 
-    double vBlankTime() const { return time_.load(); }
-
-  private:
-    WindowWin32* window_ = nullptr;
-
-    IDXGIFactory* factory_ = nullptr;
-    std::vector<IDXGIAdapter*> adapters_;
-    std::map<HMONITOR, IDXGIOutput*> monitor_outputs_;
+    void broadcast(HMONITOR monitor) {
+      double vblank_time = currentTime();
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (WindowWin32* window : windows_) {
+        if (window->monitor() == monitor)
+          window->postVBlank(vblank_time);
+      }
+    }
 
-    std::atomic<double> time_ = 0.0;
+    std::mutex mutex_;
+    std::vector<WindowWin32*> windows_;
+    std::map<HMONITOR, std::unique_ptr<MonitorThread>> threads_;
     long long start_us_ = 0;
   };
 
@@ -998,6 +1062,12 @@ namespace visage {
     return true;
   }
 
+  static bool isWindowCloaked(HWND hwnd) {
+    BOOL cloaked = FALSE;
+    HRESULT result = DwmGetWindowAttribute(hwnd, DWMWA_CLOAKED, &cloaked, sizeof(cloaked));
+    return SUCCEEDED(result) && cloaked;
+  }
+
   static LRESULT WINAPI windowProcedure(HWND hwnd, UINT msg, WPARAM w_param, LPARAM l_param) {
     WindowWin32* window = reinterpret_cast<WindowWin32*>(GetWindowLongPtr(hwnd, GWLP_USERDATA));
     if (window == nullptr)
@@ -1019,10 +1089,68 @@ namespace visage {
     return { x, y, width, height };
   }
 
+  // WM_MOUSEMOVE only carries the latest position, Windows drops the ones in between when the
+  // queue isn't read fast enough. GetMouseMovePointsEx still has them, so fast strokes don't turn
+  // into straight segments.
+  void WindowWin32::addSkippedMousePoints(HWND hwnd, int x, int y) {
+    static constexpr int kMaxPoints = 64;
+
+    POINT screen_position = { x, y };
+    ClientToScreen(hwnd, &screen_position);
+    MOUSEMOVEPOINT current = {};
+    current.x = screen_position.x & 0xffff;
+    current.y = screen_position.y & 0xffff;
+    current.time = GetMessageTime();
+
+    MOUSEMOVEPOINT points[kMaxPoints];
+    int count = GetMouseMovePointsEx(sizeof(MOUSEMOVEPOINT), &current, points, kMaxPoints,
+                                     GMMP_USE_DISPLAY_POINTS);
+    MOUSEMOVEPOINT last_point = last_mouse_point_;
+    last_mouse_point_ = current;
+    if (count <= 1 || last_point.time == 0)
+      return;
+
+    // points[0] is the current position and older points follow, stop at the last one we've seen.
+    int num_skipped = 1;
+    for (; num_skipped < count; ++num_skipped) {
+      const MOUSEMOVEPOINT& point = points[num_skipped];
+      if (static_cast<LONG>(point.time - last_point.time) < 0 ||
+          (point.time == last_point.time && point.x == last_point.x && point.y == last_point.y))
+        break;
+    }
+
+    DWORD now_ms = GetTickCount();
+    long long now_us = time::microseconds();
+    for (int i = num_skipped - 1; i > 0; --i) {
+      POINT position = { points[i].x > 32767 ? points[i].x - 65536 : points[i].x,
+                         points[i].y > 32767 ? points[i].y - 65536 : points[i].y };
+      ScreenToClient(hwnd, &position);
+      long long age_us = std::max(0L, static_cast<LONG>(now_ms - points[i].time)) * 1000LL;
+      addSkippedMousePosition(position.x, position.y, now_us - age_us);
+    }
+  }
+
   LRESULT WindowWin32::handleWindowProc(HWND hwnd, UINT msg, WPARAM w_param, LPARAM l_param) {
     switch (msg) {
     case WM_VBLANK: {
-      drawCallback(v_blank_thread_->vBlankTime());
+      vblank_pending_ = false;
+      long long now = time::microseconds();
+      if (now - last_occlusion_check_us_ >= kOcclusionPollMs * 1000LL) {
+        last_occlusion_check_us_ = now;
+        updateOcclusion();
+        if (occluded_)
+          return 0;
+      }
+      lateLatchDrawCallback(vblank_time_.load(), refresh_interval_us_);
+      return 0;
+    }
+    case WM_TIMER: {
+      if (w_param != kOcclusionTimerId)
+        break;
+
+      updateOcclusion();
+      if (occluded_)
+        drawCallback(VBlankService::instance().currentTime());
       return 0;
     }
     case WM_SYSKEYDOWN:
@@ -1067,7 +1195,10 @@ namespace visage {
         TrackMouseEvent(&track);
       }
 
-      handleMouseMove(x, y, mouseButtonState(w_param), keyboardModifiers());
+      long long age_us = static_cast<LONG>(GetTickCount() - GetMessageTime()) * 1000LL;
+      addSkippedMousePoints(hwnd, x, y);
+      handleMouseMove(x, y, mouseButtonState(w_param), keyboardModifiers(),
+                      time::microseconds() - std::max(0LL, age_us));
       if (mouseRelativeMode()) {
         IPoint last_position = lastWindowMousePosition();
         POINT client_position = { last_position.x, last_position.y };
@@ -1085,6 +1216,7 @@ namespace visage {
       break;
     }
     case WM_MOUSELEAVE: {
+      last_mouse_point_ = {};
       if (currentHitTest() == HitTestResult::Client) {
         setMouseTracked(false);
         handleMouseLeave(mouseButtonState(0), keyboardModifiers());
@@ -1203,6 +1335,7 @@ namespace visage {
     }
     case WM_SIZE: {
       handleResizeEnd(hwnd);
+      updateOcclusion();
       return TRUE;
     }
     case WM_EXITSIZEMOVE: {
@@ -1514,6 +1647,8 @@ namespace visage {
   }
 
   WindowWin32::~WindowWin32() {
+    VBlankService::instance().removeWindow(this);
+
     if (drag_drop_target_) {
       RevokeDragDrop(window_handle_);
       drag_drop_target_->Release();
@@ -1524,6 +1659,7 @@ namespace visage {
 
     NativeWindowLookup::instance().removeWindow(this);
     KillTimer(window_handle_, kTimerId);
+    KillTimer(window_handle_, kOcclusionTimerId);
     DestroyWindow(window_handle_);
     UnregisterClass(window_class_.lpszClassName, module_handle_);
     OleUninitialize();
@@ -1552,9 +1688,9 @@ namespace visage {
     ShowWindow(window_handle_, show_flag);
     SetFocus(window_handle_);
 
-    if (v_blank_thread_ == nullptr) {
-      v_blank_thread_ = std::make_unique<VBlankThread>(this);
-      v_blank_thread_->start();
+    if (!vblank_subscribed_) {
+      vblank_subscribed_ = true;
+      VBlankService::instance().addWindow(this);
     }
     notifyShow();
   }
@@ -1750,7 +1886,59 @@ namespace visage {
   }
 
   void WindowWin32::updateMonitor() {
-    monitor_ = MonitorFromWindow(window_handle_, MONITOR_DEFAULTTONEAREST);
+    HMONITOR monitor = MonitorFromWindow(window_handle_, MONITOR_DEFAULTTONEAREST);
+    if (monitor_.exchange(monitor) == monitor)
+      return;
+
+    MONITORINFOEX monitor_info {};
+    monitor_info.cbSize = sizeof(monitor_info);
+    DEVMODE mode {};
+    mode.dmSize = sizeof(mode);
+    if (GetMonitorInfo(monitor, &monitor_info) &&
+        EnumDisplaySettings(monitor_info.szDevice, ENUM_CURRENT_SETTINGS, &mode) &&
+        mode.dmDisplayFrequency > 1) {
+      refresh_interval_us_ = 1000000 / mode.dmDisplayFrequency;
+    }
+
+    if (vblank_subscribed_)
+      VBlankService::instance().monitorsChanged();
+  }
+
+  void WindowWin32::pumpInput() {
+    MSG message;
+    while (PeekMessage(&message, window_handle_, WM_KEYFIRST, WM_KEYLAST, PM_REMOVE) ||
+           PeekMessage(&message, window_handle_, WM_MOUSEFIRST, WM_MOUSELAST, PM_REMOVE)) {
+      TranslateMessage(&message);
+      DispatchMessage(&message);
+    }
+  }
+
+  void WindowWin32::updateOcclusion() {
+    if (!IsWindowVisible(window_handle_))
+      return;
+
+    HWND root = GetAncestor(window_handle_, GA_ROOT);
+    bool occluded = IsIconic(root) || isWindowCloaked(root) || isWindowOccluded(window_handle_);
+    setVisible(!occluded);
+    if (occluded == occluded_)
+      return;
+
+    occluded_ = occluded;
+    if (occluded) {
+      VBlankService::instance().removeWindow(this);
+      SetTimer(window_handle_, kOcclusionTimerId, kOcclusionPollMs, nullptr);
+    }
+    else {
+      KillTimer(window_handle_, kOcclusionTimerId);
+      if (vblank_subscribed_)
+        VBlankService::instance().addWindow(this);
+    }
+  }
+
+  void WindowWin32::postVBlank(double time) {
+    vblank_time_ = time;
+    if (!vblank_pending_.exchange(true) && !PostMessage(window_handle_, WM_VBLANK, 0, 0))
+      vblank_pending_ = false;
   }
 }
 #endif
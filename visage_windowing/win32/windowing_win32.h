@@ -33,7 +33,6 @@
 
 namespace visage {
   class DragDropTarget;
-  class VBlankThread;
 
   class EventHooks {
   public:
@@ -50,6 +49,9 @@ namespace visage {
   class WindowWin32 : public Window {
   public:
     static constexpr int kTimerId = 1;
+    static constexpr int kOcclusionTimerId = 2;
+    // While minimized, cloaked or covered, vblanks stop and occlusion is polled at this rate.
+    static constexpr int kOcclusionPollMs = 250;
     static HCURSOR cursor_;
 
     static void setCursor(HCURSOR cursor);
@@ -78,10 +80,12 @@ namespace visage {
     void setWindowTitle(const std::string& title) override;
     IPoint maxWindowDimensions() const override;
     void setAlwaysOnTop(bool on_top) override;
+    void pumpInput() override;
 
     bool isMouseTracked() const { return mouse_tracked_; }
 
     void setMouseTracked(bool tracked) { mouse_tracked_ = tracked; }
+    void addSkippedMousePoints(HWND hwnd, int x, int y);
 
     bool handleCharacterEntry(wchar_t character);
     bool handleHookedMessage(const MSG* message);
@@ -89,7 +93,10 @@ namespace visage {
     void handleResizeEnd(HWND hwnd);
     void handleDpiChange(HWND hwnd, LPARAM l_param, WPARAM w_param);
     void updateMonitor();
+    void updateOcclusion();
     HMONITOR monitor() const { return monitor_.load(); }
+    // Called from the vblank thread. Posts at most one WM_VBLANK until the last one is handled.
+    void postVBlank(double time);
     WNDPROC parentWindowProc() const { return parent_window_proc_; }
     Window::Decoration decoration() const { return decoration_; }
 
@@ -106,13 +113,19 @@ namespace visage {
     WNDPROC parent_window_proc_ = nullptr;
     std::unique_ptr<EventHooks> event_hooks_;
     DragDropTarget* drag_drop_target_ = nullptr;
-    std::unique_ptr<VBlankThread> v_blank_thread_;
+    std::atomic<bool> vblank_pending_ = false;
+    std::atomic<double> vblank_time_ = 0.0;
+    long long refresh_interval_us_ = 16667;
+    bool vblank_subscribed_ = false;
+    bool occluded_ = false;
+    long long last_occlusion_check_us_ = 0;
 
     Window::Decoration decoration_ = Window::Decoration::Native;
     std::wstring utf16_string_entry_;
     bool initialized_ = false;
     bool mouse_tracked_ = false;
     int mouse_down_flags_ = 0;
+    MOUSEMOVEPOINT last_mouse_point_ = {};
   };
 }
 
@@ -34,16 +34,29 @@ namespace visage {
   }
 
   void Window::handleFocusLost() {
+    flushPendingMouseEvents();
     setMouseRelativeMode(false);
     if (event_handler_)
       event_handler_->handleFocusLost();
   }
 
   void Window::handleFocusGained() {
+    flushPendingMouseEvents();
     if (event_handler_)
       event_handler_->handleFocusGained();
   }
 
+  void Window::setVisible(bool visible) {
+    if (visible_ == visible)
+      return;
+
+    visible_ = visible;
+    if (visible)
+      wakeDrawCallbacks();
+    if (event_handler_)
+      event_handler_->handleVisibilityChanged(visible);
+  }
+
   void Window::handleResized(int width, int height) {
     VISAGE_ASSERT(width >= 0 && height >= 0);
     client_width_ = width;
@@ -58,6 +71,8 @@ namespace visage {
   }
 
   bool Window::handleKeyDown(KeyCode key_code, int modifiers, bool repeat) {
+    noteInput();
+    flushPendingMouseEvents();
     if (event_handler_ == nullptr)
       return false;
 
@@ -65,6 +80,8 @@ namespace visage {
   }
 
   bool Window::handleKeyUp(KeyCode key_code, int modifiers) {
+    noteInput();
+    flushPendingMouseEvents();
     if (event_handler_ == nullptr)
       return false;
 
@@ -72,6 +89,8 @@ namespace visage {
   }
 
   bool Window::handleTextInput(const std::string& text) {
+    noteInput();
+    flushPendingMouseEvents();
     if (event_handler_ == nullptr)
       return false;
 
@@ -105,6 +124,7 @@ namespace visage {
   }
 
   bool Window::handleFileDrag(int x, int y, const std::vector<std::string>& files) {
+    flushPendingMouseEvents();
     if (files.empty() || event_handler_ == nullptr)
       return false;
 
@@ -112,11 +132,13 @@ namespace visage {
   }
 
   void Window::handleFileDragLeave() {
+    flushPendingMouseEvents();
     if (event_handler_)
       event_handler_->handleFileDragLeave();
   }
 
   bool Window::handleFileDrop(int x, int y, const std::vector<std::string>& files) {
+    flushPendingMouseEvents();
     if (files.empty() || event_handler_ == nullptr)
       return false;
 
@@ -137,7 +159,101 @@ namespace visage {
     return event_handler_->currentHitTest();
   }
 
-  void Window::handleMouseMove(int x, int y, int button_state, int modifiers) {
+  void Window::drawCallback(double seconds) {
+    flushPendingMouseEvents();
+    long long start_us = time::microseconds();
+    if (draw_callback_)
+      draw_callback_(seconds);
+
+    long long end_us = time::microseconds();
+    long long duration_us = end_us - start_us;
+    if (duration_us > draw_time_estimate_us_)
+      draw_time_estimate_us_ = duration_us;
+    else
+      draw_time_estimate_us_ += (duration_us - draw_time_estimate_us_) / 16;
+
+    if (oldest_input_us_) {
+      long long latency_us = end_us - oldest_input_us_;
+      oldest_input_us_ = 0;
+      input_latency_.last_us = latency_us;
+      input_latency_.max_us = std::max(input_latency_.max_us, latency_us);
+      input_latency_.samples++;
+      double delta_us = latency_us - input_latency_.average_us;
+      input_latency_.average_us += delta_us / input_latency_.samples;
+    }
+  }
+
+  void Window::lateLatchDrawCallback(double seconds, long long frame_interval_us) {
+    if (low_latency_mode_) {
+      long long delay_us = frame_interval_us - draw_time_estimate_us_ - kLateLatchMarginUs;
+      if (delay_us > 0) {
+        Thread::sleepUs(static_cast<int>(delay_us));
+        seconds += delay_us * (1.0 / 1000000.0);
+      }
+      pumpInput();
+    }
+    drawCallback(seconds);
+  }
+
+  void Window::noteInput() {
+    if (oldest_input_us_ == 0)
+      oldest_input_us_ = time::microseconds();
+  }
+
+  void Window::flushPendingMouseEvents() {
+    PendingMouseEvent pending = pending_mouse_event_;
+    pending_mouse_event_.type = PendingMouseEvent::Type::None;
+    if (pending.type == PendingMouseEvent::Type::Move)
+      dispatchMouseMove(pending.x, pending.y, pending.button_state, pending.modifiers);
+    else if (pending.type == PendingMouseEvent::Type::Wheel) {
+      dispatchMouseWheel(pending.delta_x, pending.delta_y, pending.precise_x, pending.precise_y,
+                         pending.x, pending.y, pending.button_state, pending.modifiers, pending.momentum);
+    }
+    coalesced_mouse_positions_.clear();
+  }
+
+  void Window::addMouseSample(int x, int y, long long time_us) {
+    coalesced_mouse_positions_.insert(coalesced_mouse_positions_.end(),
+                                      skipped_mouse_positions_.begin(),
+                                      skipped_mouse_positions_.end());
+    skipped_mouse_positions_.clear();
+    coalesced_mouse_positions_.push_back({ { x, y }, time_us ? time_us : time::microseconds() });
+  }
+
+  void Window::handleMouseMove(int x, int y, int button_state, int modifiers, long long time_us) {
+    noteInput();
+    if (event_handler_ == nullptr) {
+      skipped_mouse_positions_.clear();
+      return;
+    }
+
+    if (!coalesce_mouse_events_ || mouseRelativeMode()) {
+      flushPendingMouseEvents();
+      addMouseSample(x, y, time_us);
+      dispatchMouseMove(x, y, button_state, modifiers);
+      coalesced_mouse_positions_.clear();
+      return;
+    }
+
+    PendingMouseEvent& pending = pending_mouse_event_;
+    if (pending.type != PendingMouseEvent::Type::Move || pending.button_state != button_state ||
+        pending.modifiers != modifiers) {
+      flushPendingMouseEvents();
+    }
+
+    bool waking = pending.type == PendingMouseEvent::Type::None;
+    pending.type = PendingMouseEvent::Type::Move;
+    pending.x = x;
+    pending.y = y;
+    pending.button_state = button_state;
+    pending.modifiers = modifiers;
+    addMouseSample(x, y, time_us);
+    // Coalesced events are dispatched on the next draw, which may be paused while idle.
+    if (waking)
+      wakeDrawCallbacks();
+  }
+
+  void Window::dispatchMouseMove(int x, int y, int button_state, int modifiers) {
     if (event_handler_ == nullptr)
       return;
 
@@ -151,6 +267,8 @@ namespace visage {
   }
 
   void Window::handleMouseDown(MouseButton button_id, int x, int y, int button_state, int modifiers) {
+    noteInput();
+    flushPendingMouseEvents();
     if (std::getenv("NUPG_VISAGE_DEBUG") && std::getenv("NUPG_VISAGE_DEBUG")[0] != '0') {
       fprintf(stderr, "[nuPG][Visage][Window::handleMouseDown] x=%d y=%d handler=%p\n",
               x, y, (void*)event_handler_);
@@ -171,6 +289,8 @@ namespace visage {
   }
 
   void Window::handleMouseUp(MouseButton button_id, int x, int y, int button_state, int modifiers) {
+    noteInput();
+    flushPendingMouseEvents();
     if (event_handler_ == nullptr)
       return;
 
@@ -178,12 +298,14 @@ namespace visage {
   }
 
   void Window::handleMouseEnter(int x, int y) {
+    flushPendingMouseEvents();
     last_window_mouse_position_ = { x, y };
     if (event_handler_)
       event_handler_->handleMouseEnter(x, y);
   }
 
   void Window::handleMouseLeave(int button_state, int modifiers) {
+    flushPendingMouseEvents();
     if (event_handler_) {
       event_handler_->handleMouseLeave(last_window_mouse_position_.x, last_window_mouse_position_.y,
                                        button_state, modifiers);
@@ -192,6 +314,41 @@ namespace visage {
 
   void Window::handleMouseWheel(float delta_x, float delta_y, float precise_x, float precise_y,
                                 int x, int y, int button_state, int modifiers, bool momentum) {
+    noteInput();
+    if (!coalesce_mouse_events_) {
+      flushPendingMouseEvents();
+      dispatchMouseWheel(delta_x, delta_y, precise_x, precise_y, x, y, button_state, modifiers, momentum);
+      return;
+    }
+
+    PendingMouseEvent& pending = pending_mouse_event_;
+    if (pending.type == PendingMouseEvent::Type::Wheel && pending.button_state == button_state &&
+        pending.modifiers == modifiers && pending.momentum == momentum) {
+      pending.delta_x += delta_x;
+      pending.delta_y += delta_y;
+      pending.precise_x += precise_x;
+      pending.precise_y += precise_y;
+      pending.x = x;
+      pending.y = y;
+      return;
+    }
+
+    flushPendingMouseEvents();
+    pending = { PendingMouseEvent::Type::Wheel,
+                x,
+                y,
+                button_state,
+                modifiers,
+                delta_x,
+                delta_y,
+                precise_x,
+                precise_y,
+                momentum };
+    wakeDrawCallbacks();
+  }
+
+  void Window::dispatchMouseWheel(float delta_x, float delta_y, float precise_x, float precise_y,
+                                  int x, int y, int button_state, int modifiers, bool momentum) {
     if (event_handler_)
       event_handler_->handleMouseWheel(delta_x, delta_y, precise_x, precise_y, x, y, button_state,
                                        modifiers, momentum);
@@ -34,9 +34,26 @@
 #include <vector>
 
 namespace visage {
+  // A window position in native pixels, stamped with time::microseconds() of when the pointer
+  // was there as near as the backend can tell.
+  struct MouseSample {
+    IPoint position;
+    long long time_us = 0;
+  };
+
   class Window {
   public:
     static constexpr float kDefaultDpi = 96.0f;
+    static constexpr long long kLateLatchMarginUs = 2000;
+    // Idle windows still tick this often so timers and work posted from other threads run.
+    static constexpr long long kMaxIdleMs = 250;
+
+    struct InputLatency {
+      long long last_us = 0;
+      long long max_us = 0;
+      double average_us = 0.0;
+      int samples = 0;
+    };
 
     enum class Decoration {
       Native,
@@ -75,6 +92,7 @@ namespace visage {
       virtual void handleAdjustResize(int* width, int* height, bool horizontal_resize,
                                       bool vertical_resize) { }
       virtual void handleResized(int width, int height) = 0;
+      virtual void handleVisibilityChanged(bool visible) { }
 
       virtual bool handleFileDrag(int x, int y, const std::vector<std::string>& files) = 0;
       virtual void handleFileDragLeave() = 0;
@@ -104,6 +122,11 @@ namespace visage {
     virtual void* globalDisplay() const { return nullptr; }
     virtual void processPluginFdEvents() { }
     virtual int posixFd() const { return 0; }
+    // For hosts that wait on posixFd() in their own loop: call processPending() when the fd is
+    // readable or nextWakeup() microseconds have passed, whichever is first. Negative means only
+    // the fd matters. Calling nextWakeup() hands frame pacing to the host.
+    virtual long long nextWakeup() { return -1; }
+    virtual void processPending() { processPluginFdEvents(); }
 
     virtual void show() = 0;
     virtual void showMaximized() = 0;
@@ -122,10 +145,35 @@ namespace visage {
       draw_callback_ = std::move(callback);
     }
 
-    void drawCallback(double time) const {
-      if (draw_callback_)
-        draw_callback_(time);
+    void drawCallback(double time);
+    // Platforms call this once per frame interval. In low latency mode it waits until just
+    // enough time is left to draw before the next vblank, then reads pending input again.
+    void lateLatchDrawCallback(double time, long long frame_interval_us);
+
+    // Trades idle GPU time for lower input-to-photon latency, see lateLatchDrawCallback.
+    // Renderer::setLowLatency is the matching swap chain setting.
+    void setLowLatencyMode(bool low_latency) { low_latency_mode_ = low_latency; }
+    bool lowLatencyMode() const { return low_latency_mode_; }
+    // Processes input events already queued by the platform without waiting for more.
+    virtual void pumpInput() { }
+    // Time from the first input event after a frame to the end of the draw that handled it.
+    const InputLatency& inputLatency() const { return input_latency_; }
+    void resetInputLatency() { input_latency_ = {}; }
+    long long drawTimeEstimate() const { return draw_time_estimate_us_; }
+
+    // Reports how many ms until the contents need another draw callback: 0 when something is
+    // stale or a coalesced mouse event waits for the next draw, negative when nothing is
+    // scheduled. Platforms pacing their own ticks skip idle ones.
+    void setDrawDeadlineCallback(std::function<long long()> callback) {
+      draw_deadline_callback_ = std::move(callback);
+    }
+    long long msUntilDrawNeeded() const {
+      if (pending_mouse_event_.type != PendingMouseEvent::Type::None)
+        return 0;
+      return draw_deadline_callback_ ? draw_deadline_callback_() : 0;
     }
+    // Restarts draw ticks that were skipped or paused because the contents were idle.
+    virtual void wakeDrawCallbacks() { }
 
     bool isVisible() const { return visible_; }
 
@@ -145,6 +193,20 @@ namespace visage {
       return { point.x / dpi_scale_, point.y / dpi_scale_ };
     }
 
+    // Merges mouse moves and sums wheel deltas until the next draw or other input event.
+    void setCoalesceMouseEvents(bool coalesce) {
+      if (!coalesce)
+        flushPendingMouseEvents();
+      coalesce_mouse_events_ = coalesce;
+    }
+    bool coalesceMouseEvents() const { return coalesce_mouse_events_; }
+    // Every position merged into the mouse move being dispatched, oldest first, including ones
+    // the backend recovered with addSkippedMousePosition.
+    const std::vector<MouseSample>& coalescedMousePositions() const {
+      return coalesced_mouse_positions_;
+    }
+    void flushPendingMouseEvents();
+
     void setMouseRelativeMode(bool relative) { mouse_relative_mode_ = relative; }
     virtual bool mouseRelativeMode() const { return mouse_relative_mode_; }
 
@@ -157,7 +219,13 @@ namespace visage {
 
     HitTestResult handleHitTest(int x, int y);
     HitTestResult currentHitTest() const;
-    void handleMouseMove(int x, int y, int button_state, int modifiers);
+    // time_us of 0 stamps the move with the current time.
+    void handleMouseMove(int x, int y, int button_state, int modifiers, long long time_us = 0);
+    // For backends that can read positions the OS merged before reporting the next move. They're
+    // delivered with that move, ahead of its own position.
+    void addSkippedMousePosition(int x, int y, long long time_us) {
+      skipped_mouse_positions_.push_back({ { x, y }, time_us });
+    }
     void handleMouseDown(MouseButton button_id, int x, int y, int button_state, int modifiers);
     void handleMouseUp(MouseButton button_id, int x, int y, int button_state, int modifiers);
     void handleMouseEnter(int x, int y);
@@ -184,21 +252,59 @@ namespace visage {
     bool isDragDropSource() const;
     std::string startDragDropSource();
     void cleanupDragDropSource();
-    void setVisible(bool visible) { visible_ = visible; }
+    // Backends report minimized or fully occluded windows as not visible. Drawing stops until the
+    // window is uncovered again.
+    void setVisible(bool visible);
 
   private:
     static int double_click_speed_;
 
+    void noteInput();
+
     struct RepeatClick {
       int click_count = 0;
       long long last_click_ms = 0;
     };
 
+    struct PendingMouseEvent {
+      enum class Type {
+        None,
+        Move,
+        Wheel
+      };
+
+      Type type = Type::None;
+      int x = 0;
+      int y = 0;
+      int button_state = 0;
+      int modifiers = 0;
+      float delta_x = 0.0f;
+      float delta_y = 0.0f;
+      float precise_x = 0.0f;
+      float precise_y = 0.0f;
+      bool momentum = false;
+    };
+
+    void dispatchMouseMove(int x, int y, int button_state, int modifiers);
+    void dispatchMouseWheel(float delta_x, float delta_y, float precise_x, float precise_y, int x,
+                            int y, int button_state, int modifiers, bool momentum);
+
     EventHandler* event_handler_ = nullptr;
     IPoint last_window_mouse_position_ = { 0, 0 };
     RepeatClick mouse_repeat_clicks_;
+    PendingMouseEvent pending_mouse_event_;
+    void addMouseSample(int x, int y, long long time_us);
+
+    std::vector<MouseSample> coalesced_mouse_positions_;
+    std::vector<MouseSample> skipped_mouse_positions_;
+    bool coalesce_mouse_events_ = false;
 
     std::function<void(double)> draw_callback_ = nullptr;
+    std::function<long long()> draw_deadline_callback_ = nullptr;
+    bool low_latency_mode_ = false;
+    long long draw_time_estimate_us_ = 0;
+    long long oldest_input_us_ = 0;
+    InputLatency input_latency_;
     CallbackList<void()> on_show_;
     CallbackList<void()> on_hide_;
     CallbackList<void()> on_contents_resized_;